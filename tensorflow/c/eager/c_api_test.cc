@@ -34,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/eager/tensor_handle.h"
 #include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/platform/casts.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/protobuf.h"
@@ -150,6 +151,56 @@ void BM_Execute_Identity(int iters, int async) {
 }
 BENCHMARK(BM_Execute_Identity)->Arg(0)->Arg(1);
 
+// Measures the dispatch overhead of tiny ops, executed synchronously from
+// `num_threads` threads that share a context. Reports the number of ops per
+// second as items per second.
+void BM_Execute_TinyOps(int iters, int num_threads) {
+  tensorflow::testing::StopTiming();
+  tensorflow::testing::UseRealTime();
+  TF_Status* status = TF_NewStatus();
+  TFE_ContextOptions* opts = TFE_NewContextOptions();
+  TFE_Context* ctx = TFE_NewContext(opts, status);
+  CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  TFE_DeleteContextOptions(opts);
+
+  TFE_TensorHandle* x = TestScalarTensorHandle(ctx, 1.0f);
+  auto run_ops = [ctx, x](int num_ops) {
+    TF_Status* status = TF_NewStatus();
+    TFE_Op* add = TFE_NewOp(ctx, "AddV2", status);
+    CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+    for (int i = 0; i < num_ops; ++i) {
+      TFE_OpReset(add, "AddV2", nullptr, status);
+      CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+      TFE_OpAddInput(add, x, status);
+      CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+      TFE_OpAddInput(add, x, status);
+      CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+      TFE_TensorHandle* retvals[1];
+      int num_retvals = 1;
+      TFE_Execute(add, &retvals[0], &num_retvals, status);
+      CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+      TFE_DeleteTensorHandle(retvals[0]);
+    }
+    TFE_DeleteOp(add);
+    TF_DeleteStatus(status);
+  };
+  tensorflow::testing::StartTiming();
+  {
+    std::vector<std::unique_ptr<tensorflow::Thread>> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back(tensorflow::Env::Default()->StartThread(
+          tensorflow::ThreadOptions(), "tiny_ops",
+          [&run_ops, iters, num_threads]() { run_ops(iters / num_threads); }));
+    }
+  }
+  tensorflow::testing::StopTiming();
+  tensorflow::testing::ItemsProcessed(iters / num_threads * num_threads);
+  TFE_DeleteTensorHandle(x);
+  TFE_DeleteContext(ctx);
+  TF_DeleteStatus(status);
+}
+BENCHMARK(BM_Execute_TinyOps)->Arg(1)->Arg(4)->Arg(8);
+
 TEST(CAPI, Context) {
   TF_Status* status = TF_NewStatus();
   TFE_ContextOptions* opts = TFE_NewContextOptions();
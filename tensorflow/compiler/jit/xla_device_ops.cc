@@ -67,7 +67,7 @@ void XlaAssignVariableOp::Compute(OpKernelContext* context) {
           DataTypeString(variable->tensor()->dtype()), " got ",
           DataTypeString(dtype_)));
   variable->is_initialized = true;
-  *variable->tensor() = value;
+  variable->SetTensor(value);
 }
 
 }  // namespace tensorflow
@@ -553,7 +553,7 @@ Status XlaComputationLaunchContext::PopulateOutputs(
     }
     output.set_buffer(se::OwningDeviceMemory(), {output_num});
     var->is_initialized |= write.modified;
-    *var->tensor() = output_tensor;
+    var->SetTensor(output_tensor);
     ++output_num;
   }
   return Status::OK();
@@ -1372,6 +1372,8 @@ Status DirectSession::CreateExecutors(
     params.device = device;
     params.session_metadata = session_metadata;
     params.function_library = lib;
+    params.use_critical_path_scheduling =
+        options_.config.experimental().use_critical_path_scheduling();
     auto opseg = device->op_segment();
     params.create_kernel =
         [this, lib, opseg](const std::shared_ptr<const NodeProperties>& props,
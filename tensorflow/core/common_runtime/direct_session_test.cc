@@ -2704,6 +2704,76 @@ BENCHMARK(BM_FeedFetchCallableSingleThreadExecutor)
     ->Arg(5)
     ->Arg(10);
 
+// A benchmark for the step latency of a graph with one long chain of matrix
+// multiplications and `num_branches` independent short ones. The branches
+// become ready before the chain, so unless the executor orders ready nodes by
+// their critical path, the chain starts only after the branches are done.
+void BM_BranchyGraph(::testing::benchmark::State& state) {
+  const int num_branches = state.range(0);
+  const bool use_critical_path_scheduling = state.range(1);
+  constexpr int kChainLength = 32;
+  constexpr int kMatrixSize = 128;
+
+  Graph g(OpRegistry::Global());
+  Node* a;
+  TF_CHECK_OK(NodeBuilder(g.NewName("Placeholder"), "Placeholder")
+                  .Attr("shape", TensorShape({kMatrixSize, kMatrixSize}))
+                  .Attr("dtype", DT_FLOAT)
+                  .Device("/cpu:0")
+                  .Finalize(&g, &a));
+  std::vector<Node*> branches;
+  for (int i = 0; i < num_branches; ++i) {
+    branches.push_back(test::graph::Matmul(&g, a, a, false, false));
+  }
+  Node* out = test::graph::Matmul(&g, a, a, false, false);
+  for (int i = 1; i < kChainLength; ++i) {
+    out = test::graph::Matmul(&g, out, a, false, false);
+  }
+  for (Node* branch : branches) {
+    out = test::graph::Add(&g, out, branch);
+  }
+  for (Node* n : g.op_nodes()) {
+    n->set_requested_device("/cpu:0");
+  }
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+
+  SessionOptions opts;
+  opts.config.set_inter_op_parallelism_threads(2);
+  opts.config.mutable_experimental()->set_use_critical_path_scheduling(
+      use_critical_path_scheduling);
+  // Keep the branches, which compute the same value, from being merged.
+  opts.config.mutable_graph_options()
+      ->mutable_optimizer_options()
+      ->set_opt_level(OptimizerOptions::L0);
+  opts.config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->set_disable_meta_optimizer(true);
+  std::unique_ptr<Session> session(NewSession(opts));
+  TF_CHECK_OK(session->Create(gd));
+
+  Tensor value(DT_FLOAT, TensorShape({kMatrixSize, kMatrixSize}));
+  value.flat<float>().setConstant(1.0f / kMatrixSize);
+  std::vector<std::pair<string, Tensor>> inputs = {{a->name() + ":0", value}};
+  std::vector<string> outputs = {out->name() + ":0"};
+  {
+    // Ignore the first run, which also records the costs from which the
+    // priorities are computed.
+    std::vector<Tensor> output_values;
+    TF_CHECK_OK(session->Run(inputs, outputs, {}, &output_values));
+  }
+  for (auto s : state) {
+    std::vector<Tensor> output_values;
+    TF_CHECK_OK(session->Run(inputs, outputs, {}, &output_values));
+  }
+}
+
+BENCHMARK(BM_BranchyGraph)
+    ->ArgPair(4, false)
+    ->ArgPair(4, true)
+    ->ArgPair(16, false)
+    ->ArgPair(16, true);
+
 }  // namespace
 
 class DirectSessionCollectiveTest : public ::testing::Test {
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/eager/context.h"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -382,6 +383,7 @@ void EagerContext::ClearCachesAndDefaultExecutor() {
   mutex_lock ml(cache_mu_);
   default_executor_.WaitForAllPendingNodes().IgnoreError();
   kernel_cache_.clear();
+  ClearThreadLocalKernelCaches();
   for (auto& entry : registered_functions_) {
     entry.second->cached_kernel_keys->clear();
   }
@@ -524,6 +526,12 @@ EagerContext::~EagerContext() {
   custom_devices_.clear();
 
   ClearCachesAndThreadExecutors();
+  {
+    // The threads may keep their caches after the context is destroyed, but
+    // the caches no longer hold kernels.
+    mutex_lock l(thread_local_kernel_caches_mu_);
+    thread_local_kernel_caches_.clear();
+  }
   std::unordered_map<std::thread::id, EagerExecutor*> executors_copy;
   {
     mutex_lock l(executor_map_mu_);
@@ -775,6 +783,7 @@ Status EagerContext::RemoveFunction(const string& func) {
       for (auto& key : *registered_function->cached_kernel_keys) {
         kernel_cache_.erase(key);
       }
+      ClearThreadLocalKernelCaches();
       registered_functions_.erase(func);
     }
     registered_function->Unref();
@@ -834,8 +843,101 @@ Status EagerContext::SyncExecutors() {
   return sg.as_summary_status();
 }
 
+int64 EagerContext::NewKernelCacheOwnerId() {
+  static std::atomic<int64> next_id{0};
+  return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EagerContext::ThreadLocalKernelCache::Clear() {
+  for (auto& kernel : kernels) {
+    kernel.reset();
+  }
+}
+
+EagerContext::ThreadLocalKernelCache*
+EagerContext::GetThreadLocalKernelCache() {
+  // Shares the caches of the calling thread with their contexts, and marks
+  // them as exited when the thread exits. Most threads only ever use one
+  // context, so the cache of the last one used by this thread is remembered.
+  struct ThreadCaches {
+    ~ThreadCaches() {
+      for (auto& cache : caches) {
+        mutex_lock l(cache->mu);
+        cache->thread_exited = true;
+        cache->Clear();
+      }
+    }
+
+    int64 last_owner_id = -1;
+    ThreadLocalKernelCache* last_cache = nullptr;
+    std::vector<std::shared_ptr<ThreadLocalKernelCache>> caches;
+  };
+  static thread_local ThreadCaches thread_caches;
+  if (thread_caches.last_owner_id == kernel_cache_owner_id_) {
+    return thread_caches.last_cache;
+  }
+
+  // Forget the caches of the destroyed contexts.
+  auto& caches = thread_caches.caches;
+  caches.erase(std::remove_if(caches.begin(), caches.end(),
+                              [](const auto& cache) {
+                                return cache.use_count() == 1;
+                              }),
+               caches.end());
+
+  mutex_lock l(thread_local_kernel_caches_mu_);
+  PruneThreadLocalKernelCachesLocked();
+  std::shared_ptr<ThreadLocalKernelCache>& cache =
+      thread_local_kernel_caches_[std::this_thread::get_id()];
+  if (cache == nullptr) {
+    cache = std::make_shared<ThreadLocalKernelCache>();
+    caches.push_back(cache);
+  }
+  thread_caches.last_owner_id = kernel_cache_owner_id_;
+  thread_caches.last_cache = cache.get();
+  return cache.get();
+}
+
+void EagerContext::ClearThreadLocalKernelCaches() {
+  mutex_lock l(thread_local_kernel_caches_mu_);
+  for (auto& entry : thread_local_kernel_caches_) {
+    mutex_lock cache_lock(entry.second->mu);
+    entry.second->Clear();
+  }
+  PruneThreadLocalKernelCachesLocked();
+}
+
+void EagerContext::PruneThreadLocalKernelCachesLocked() {
+  for (auto it = thread_local_kernel_caches_.begin();
+       it != thread_local_kernel_caches_.end();) {
+    bool thread_exited;
+    {
+      mutex_lock cache_lock(it->second->mu);
+      thread_exited = it->second->thread_exited;
+    }
+    if (thread_exited) {
+      it = thread_local_kernel_caches_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 core::RefCountPtr<KernelAndDevice> EagerContext::GetCachedKernel(
     Fprint128 cache_key) {
+  ThreadLocalKernelCache* local_cache = GetThreadLocalKernelCache();
+  const int index = cache_key.low64 % ThreadLocalKernelCache::kNumEntries;
+  {
+    mutex_lock cache_lock(local_cache->mu);
+    const auto& local_kernel = local_cache->kernels[index];
+    if (local_kernel != nullptr && local_cache->keys[index] == cache_key) {
+      local_kernel->Ref();
+      return core::RefCountPtr<KernelAndDevice>(local_kernel.get());
+    }
+  }
+
+  // `cache_mu_` is held while the kernel is copied to the thread-local cache,
+  // so that it is not copied after it was removed from `kernel_cache_`.
   tf_shared_lock l(cache_mu_);
   auto iter = kernel_cache_.find(cache_key);
   if (iter == kernel_cache_.end()) {
@@ -843,6 +945,10 @@ core::RefCountPtr<KernelAndDevice> EagerContext::GetCachedKernel(
   }
   core::RefCountPtr<KernelAndDevice> new_ref(iter->second.get());
   new_ref->Ref();
+  mutex_lock cache_lock(local_cache->mu);
+  iter->second->Ref();
+  local_cache->kernels[index].reset(iter->second.get());
+  local_cache->keys[index] = cache_key;
   return new_ref;
 }
 
@@ -851,7 +957,10 @@ void EagerContext::AddKernelToCache(Fprint128 cache_key,
   mutex_lock ml(cache_mu_);
   core::RefCountPtr<KernelAndDevice> new_ref(kernel);
   new_ref->Ref();
-  kernel_cache_[cache_key] = std::move(new_ref);
+  core::RefCountPtr<KernelAndDevice>& cached_kernel = kernel_cache_[cache_key];
+  // Threads must not keep using a replaced kernel.
+  if (cached_kernel != nullptr) ClearThreadLocalKernelCaches();
+  cached_kernel = std::move(new_ref);
   auto* registered_function =
       gtl::FindPtrOrNull(registered_functions_, kernel->name());
   // The kernel name can be either a primitive op or a function.
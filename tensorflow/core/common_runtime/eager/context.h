@@ -21,6 +21,8 @@ limitations under the License.
 #include <memory>
 #include <queue>
 #include <string>
+#include <thread>  // NOLINT
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -254,6 +256,10 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
 
   Status AsyncWait() override { return SyncExecutors(); }
 
+  // Returns the kernel cached under `cache_key`, or nullptr. Kernels that
+  // were recently used by the calling thread are found in a per-thread cache
+  // instead of under `cache_mu_`. The per-thread cache has its own mutex,
+  // which is only contended while another thread invalidates the cache.
   core::RefCountPtr<KernelAndDevice> GetCachedKernel(Fprint128 cache_key);
 
   void AddKernelToCache(Fprint128 cache_key, KernelAndDevice* kernel);
@@ -599,6 +605,39 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
   std::unordered_map<string, RegisteredFunction*> registered_functions_
       TF_GUARDED_BY(cache_mu_);
 
+  // A direct-mapped cache in front of `kernel_cache_` that is only used by
+  // one thread. Its mutex is only contended when other threads invalidate it.
+  struct ThreadLocalKernelCache {
+    static constexpr int kNumEntries = 64;
+
+    // Releases the cached kernels.
+    void Clear() TF_EXCLUSIVE_LOCKS_REQUIRED(mu);
+
+    mutex mu;
+    Fprint128 keys[kNumEntries] TF_GUARDED_BY(mu);
+    core::RefCountPtr<KernelAndDevice> kernels[kNumEntries] TF_GUARDED_BY(mu);
+    // Set when the thread using the cache exits.
+    bool thread_exited TF_GUARDED_BY(mu) = false;
+  };
+  // Returns the cache of the calling thread, creating it if necessary.
+  ThreadLocalKernelCache* GetThreadLocalKernelCache();
+  // Clears the caches of all threads. Must be called with `cache_mu_` held
+  // when kernels are removed from or replaced in `kernel_cache_`, so that no
+  // thread copies them again.
+  void ClearThreadLocalKernelCaches() TF_EXCLUSIVE_LOCKS_REQUIRED(cache_mu_);
+  // Drops the caches of the threads that exited.
+  void PruneThreadLocalKernelCachesLocked()
+      TF_EXCLUSIVE_LOCKS_REQUIRED(thread_local_kernel_caches_mu_);
+  static int64 NewKernelCacheOwnerId();
+
+  // Identifies this context in the thread-local pointers to its caches, which
+  // may outlive the context.
+  const int64 kernel_cache_owner_id_ = NewKernelCacheOwnerId();
+  mutex thread_local_kernel_caches_mu_ TF_ACQUIRED_AFTER(cache_mu_);
+  // The caches are shared with their threads, which mark them as exited.
+  std::unordered_map<std::thread::id, std::shared_ptr<ThreadLocalKernelCache>>
+      thread_local_kernel_caches_ TF_GUARDED_BY(thread_local_kernel_caches_mu_);
+
   // Whether we should compute RunMetadata.
   std::atomic<bool> should_store_graphs_{false};
   mutex metadata_mu_;
@@ -18,7 +18,10 @@ limitations under the License.
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -244,5 +247,120 @@ TEST_F(EagerContextTest, AddFunctionDefRepeatDifferent) {
   EXPECT_FALSE(s.ok());
 }
 
+// Returns a kernel that can be cached but not run.
+core::RefCountPtr<KernelAndDevice> MakeFunctionKernel(EagerContext* context,
+                                                      const string& name) {
+  return core::RefCountPtr<KernelAndDevice>(new KernelAndDeviceFunc(
+      /*flr=*/nullptr, context->pflr(), /*input_devices=*/{},
+      /*composite_devices=*/{}, /*input_resource_dtypes_and_shapes=*/{},
+      /*runner=*/nullptr, /*collective_executor=*/nullptr,
+      context->HostCPU(), name, /*outputs_on_op_device=*/false,
+      /*rendezvous_creator=*/nullptr, /*get_op_id=*/nullptr));
+}
+
+TEST_F(EagerContextTest, GetCachedKernel) {
+  InitContext(SessionOptions(), DEVICE_PLACEMENT_EXPLICIT);
+  const Fprint128 key = Fingerprint128("key");
+  EXPECT_EQ(context()->GetCachedKernel(key), nullptr);
+
+  core::RefCountPtr<KernelAndDevice> kernel =
+      MakeFunctionKernel(context(), "f");
+  context()->AddKernelToCache(key, kernel.get());
+  // The second lookup is served by the cache of this thread.
+  EXPECT_EQ(context()->GetCachedKernel(key).get(), kernel.get());
+  EXPECT_EQ(context()->GetCachedKernel(key).get(), kernel.get());
+  EXPECT_EQ(context()->GetCachedKernel(Fingerprint128("other_key")), nullptr);
+
+  context()->ClearCachesAndDefaultExecutor();
+  EXPECT_EQ(context()->GetCachedKernel(key), nullptr);
+  EXPECT_TRUE(kernel->RefCountIsOne());
+}
+
+TEST_F(EagerContextTest, GetCachedKernelFromOtherThread) {
+  InitContext(SessionOptions(), DEVICE_PLACEMENT_EXPLICIT);
+  const Fprint128 key = Fingerprint128("key");
+  core::RefCountPtr<KernelAndDevice> kernel =
+      MakeFunctionKernel(context(), "f");
+  context()->AddKernelToCache(key, kernel.get());
+
+  auto lookup = [this, &key]() {
+    KernelAndDevice* result = nullptr;
+    std::unique_ptr<Thread> thread(Env::Default()->StartThread(
+        ThreadOptions(), "lookup", [this, &key, &result]() {
+          result = context()->GetCachedKernel(key).get();
+        }));
+    thread.reset();  // Joins the thread.
+    return result;
+  };
+  EXPECT_EQ(lookup(), kernel.get());
+  EXPECT_EQ(context()->GetCachedKernel(key).get(), kernel.get());
+  context()->ClearCachesAndDefaultExecutor();
+  // No thread-local cache keeps the kernel alive.
+  EXPECT_TRUE(kernel->RefCountIsOne());
+  EXPECT_EQ(lookup(), nullptr);
+  EXPECT_EQ(context()->GetCachedKernel(key), nullptr);
+}
+
+TEST_F(EagerContextTest, AddKernelToCacheReplacesCachedKernels) {
+  InitContext(SessionOptions(), DEVICE_PLACEMENT_EXPLICIT);
+  const Fprint128 key = Fingerprint128("key");
+  core::RefCountPtr<KernelAndDevice> kernel =
+      MakeFunctionKernel(context(), "f");
+  context()->AddKernelToCache(key, kernel.get());
+
+  // A thread that keeps running with the kernel in its cache.
+  Notification looked_up;
+  Notification replaced;
+  KernelAndDevice* result = nullptr;
+  std::unique_ptr<Thread> thread(Env::Default()->StartThread(
+      ThreadOptions(), "lookup", [&]() {
+        EXPECT_EQ(context()->GetCachedKernel(key).get(), kernel.get());
+        looked_up.Notify();
+        replaced.WaitForNotification();
+        result = context()->GetCachedKernel(key).get();
+      }));
+  looked_up.WaitForNotification();
+  EXPECT_EQ(context()->GetCachedKernel(key).get(), kernel.get());
+
+  core::RefCountPtr<KernelAndDevice> new_kernel =
+      MakeFunctionKernel(context(), "f");
+  context()->AddKernelToCache(key, new_kernel.get());
+  EXPECT_TRUE(kernel->RefCountIsOne());
+  EXPECT_EQ(context()->GetCachedKernel(key).get(), new_kernel.get());
+  replaced.Notify();
+  thread.reset();  // Joins the thread.
+  EXPECT_EQ(result, new_kernel.get());
+}
+
+TEST_F(EagerContextTest, RemoveFunctionInvalidatesCachedKernels) {
+  InitContext(SessionOptions(), DEVICE_PLACEMENT_EXPLICIT);
+  const Tensor kTwo = test::AsScalar<int64>(2);
+  const FunctionDef x_times_two = FDH::Define(
+      // Name
+      "XTimesTwo",
+      // Args
+      {"x: T"},
+      // Return values
+      {"y: T"},
+      // Attr def
+      {"T: {float, double, int32, int64}"},
+      // Nodes
+      {
+          {{"two"}, "Const", {}, {{"value", kTwo}, {"dtype", DT_INT64}}},
+          {{"scale"}, "Cast", {"two"}, {{"SrcT", DT_INT64}, {"DstT", "$T"}}},
+          {{"y"}, "Mul", {"x", "scale"}, {{"T", "$T"}}},
+      });
+  TF_ASSERT_OK(context()->AddFunctionDef(x_times_two));
+  const Fprint128 key = Fingerprint128("XTimesTwo");
+  core::RefCountPtr<KernelAndDevice> kernel =
+      MakeFunctionKernel(context(), "XTimesTwo");
+  context()->AddKernelToCache(key, kernel.get());
+  EXPECT_EQ(context()->GetCachedKernel(key).get(), kernel.get());
+
+  TF_ASSERT_OK(context()->RemoveFunction("XTimesTwo"));
+  EXPECT_TRUE(kernel->RefCountIsOne());
+  EXPECT_EQ(context()->GetCachedKernel(key), nullptr);
+}
+
 }  // namespace
 }  // namespace tensorflow
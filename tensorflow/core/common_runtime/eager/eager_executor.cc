@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/eager/eager_executor.h"
 
+#include <algorithm>
 #include <forward_list>
 
 #include "tensorflow/core/lib/core/errors.h"
@@ -29,11 +30,26 @@ bool IsAsyncWaitForRemoteFunctionEnabled() {
                                  true, &enabled));
   return enabled;
 }
+
+int NumParallelThreads() {
+  int64 num_threads = 0;
+  TF_CHECK_OK(ReadInt64FromEnvVar("TF_EAGER_ASYNC_PARALLEL_THREADS", 0,
+                                  &num_threads));
+  return num_threads;
+}
 }  // namespace
 
 EagerExecutor::EagerExecutor(bool async)
+    : EagerExecutor(async, NumParallelThreads()) {}
+
+EagerExecutor::EagerExecutor(bool async, int num_parallel_threads)
     : next_node_id_(0),
       ok_(true),
+      thread_pool_(async && num_parallel_threads > 0
+                       ? new thread::ThreadPool(tensorflow::Env::Default(),
+                                                "eager_parallel_executor",
+                                                num_parallel_threads)
+                       : nullptr),
       thread_(async ? tensorflow::Env::Default()->StartThread(
                           tensorflow::ThreadOptions(), "eager_async_executor",
                           std::bind(&EagerExecutor::Run, this))
@@ -222,11 +238,12 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
   // If executing synchronously we don't need to notify if status is OK since
   // the node  was never added to the unfinished_nodes_ list and nobody should
   // ever be waiting for it.
-  if (status.ok() && !from_queue && !async) {
+  if (status.ok() && !from_queue && !async && !item->dispatched) {
     return;
   }
 
   std::forward_list<core::RefCountPtr<NodeItem>> items_to_destroy;
+  std::vector<core::RefCountPtr<NodeItem>> ready;
   {
     mutex_lock l(node_queue_mutex_);
     if (!status_.ok()) return;
@@ -236,11 +253,12 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
       // Since this was from the async queue, pop it from the front of the queue
       DCHECK(!node_queue_.empty() && item.get() == node_queue_.front().get());
       node_queue_.pop();
-    } else if (async) {
-      // If it is an Async node then we will find the node in the unfinished
-      // nodes list. However we only notify if we are at the front of the list
-      // since we don't want to notify any waiters of earlier nodes.
-      need_notification = item->id == unfinished_nodes_.begin()->first;
+    } else if (async || item->dispatched) {
+      // If it is an Async or dispatched node then we will find the node in the
+      // unfinished nodes list. However we only notify if we are at the front
+      // of the list since we don't want to notify any waiters of earlier
+      // nodes.
+      auto it = unfinished_nodes_.find(item->id);
       // Remove item if it exists in unfinished_nodes_.
       // With async execution, if two separate nodes failed and enter this
       // callback, then the second node might not find itself in
@@ -250,8 +268,15 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
       //   3) Callback of the second failed node is triggered
       // In this case, do not taint the executor status or other note items
       // because they are inserted after the ClearError.
-      auto result = unfinished_nodes_.erase(item->id);
-      if (result == 0) return;
+      if (it == unfinished_nodes_.end()) return;
+      need_notification = it == unfinished_nodes_.begin();
+      unfinished_nodes_.erase(it);
+      // The consumers of an async node are usually released once its
+      // RunAsync returns (see RunDispatchedItem), unless the callback comes
+      // first.
+      if (item->dispatched && (status.ok() || !item->node->Fatal())) {
+        ReleaseConsumersLocked(item.get(), &ready);
+      }
     }
 
     if (!status.ok() && item->node->Fatal()) {
@@ -272,15 +297,29 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
         node_queue_.pop();
       }
       for (auto& it : unfinished_nodes_) {
+        NodeItem* unfinished = it.second.get();
+        if (unfinished->dispatched) {
+          // Dispatched sync nodes that are already running are left to
+          // finish, and report their own status.
+          if (unfinished->started && unfinished->node->AsAsync() == nullptr) {
+            continue;
+          }
+          // Nodes scheduled on `thread_pool_` that did not start are skipped
+          // by RunDispatchedItem.
+          if (!unfinished->started) unfinished->state = NodeState::kDONE;
+        }
         items_to_destroy.push_front(std::move(it.second));
       }
       unfinished_nodes_.clear();
+      producers_.clear();
+      has_ordered_node_ = false;
     }
     if (need_notification) {
       NotifyWaiters(item->id);
     }
   }
 
+  ScheduleReady(&ready);
   for (auto& item : items_to_destroy) {
     item->node->Abort(status);
   }
@@ -326,21 +365,35 @@ void EagerExecutor::Run() {
       gtl::MakeCleanup([this] { thread_exited_notification_.Notify(); });
   while (true) {
     core::RefCountPtr<NodeItem> curr_item;
+    std::vector<core::RefCountPtr<NodeItem>> ready;
     {
       tensorflow::mutex_lock l(node_queue_mutex_);
       while (node_queue_.empty() || !status_.ok()) {
         if (state_ == ExecutorState::kShutDown) return;
         nodes_pending_.wait(l);
       }
-      // Obtain raw pointer since we don't want to remove from the queue until
-      // the node has been run. Otherwise, WaitForAllPendingNodes can return
-      // too early.
-      // Note, we don't std::move from the here because the front of the queue
-      // will then contain a nullptr. This can be a problem in
-      // WaitForAllPendingNodes where we get the top EagerNode pointer
-      // and register a notification for its completion.
-      curr_item.reset(node_queue_.front().get());
-      curr_item->Ref();
+      if (thread_pool_ != nullptr) {
+        // A parallel executor only dispatches the nodes here. They run on
+        // `thread_pool_` once the nodes they depend on are done.
+        if (state_ == ExecutorState::kShutDown) return;
+        while (!node_queue_.empty()) {
+          DispatchLocked(&ready);
+        }
+      } else {
+        // Obtain raw pointer since we don't want to remove from the queue until
+        // the node has been run. Otherwise, WaitForAllPendingNodes can return
+        // too early.
+        // Note, we don't std::move from the here because the front of the
+        // queue will then contain a nullptr. This can be a problem in
+        // WaitForAllPendingNodes where we get the top EagerNode pointer
+        // and register a notification for its completion.
+        curr_item.reset(node_queue_.front().get());
+        curr_item->Ref();
+      }
+    }
+    if (curr_item == nullptr) {
+      ScheduleReady(&ready);
+      continue;
     }
     Status status = RunItem(std::move(curr_item), /*from_queue=*/true);
     if (!status.ok()) {
@@ -353,30 +406,11 @@ Status EagerExecutor::RunItem(core::RefCountPtr<NodeItem> item,
                               bool from_queue) {
   DVLOG(3) << "Running Node: [id " << item->id << "] "
            << item->node->DebugString();
-  AsyncRemoteExecuteNode* async_remote_node =
-      item->node->AsAsyncRemoteExecuteNode();
-  if (enable_async_wait_for_remote_function_) {
-    if (async_remote_node != nullptr) {
-      if (last_eager_client_ != nullptr &&
-          async_remote_node->eager_client() != nullptr &&
-          last_eager_client_ != async_remote_node->eager_client()) {
-        // Running a remote function, need to sync if the function is going to
-        // different device than last time we run remote distributed function.
-        DVLOG(3) << "Executing Sync Executor for node" << item->id;
-        tensorflow::Status status = async_remote_node->SyncExecutors();
-        if (!status.ok()) {
-          NodeDone(item, status, from_queue);
-          return status;
-        }
-        last_eager_client_ = nullptr;
-      }
-      if (async_remote_node->eager_client() != nullptr &&
-          async_remote_node->needs_remote_inputs() &&
-          async_remote_node->allow_multiple_pending_requests()) {
-        // We are running remote distributed function, update
-        // last_remote_device_name_.
-        last_eager_client_ = async_remote_node->eager_client();
-      }
+  {
+    tensorflow::Status status = MaybeSyncRemoteExecutors(*item);
+    if (!status.ok()) {
+      NodeDone(item, status, from_queue);
+      return status;
     }
   }
 
@@ -402,6 +436,72 @@ Status EagerExecutor::RunItem(core::RefCountPtr<NodeItem> item,
   return status();
 }
 
+void EagerExecutor::RunDispatchedItem(core::RefCountPtr<NodeItem> item) {
+  DVLOG(3) << "Running dispatched Node: [id " << item->id << "] "
+           << item->node->DebugString();
+  {
+    tensorflow::mutex_lock l(node_queue_mutex_);
+    // The node was aborted by an error after it was scheduled.
+    if (item->state == NodeState::kDONE) return;
+    item->started = true;
+  }
+  Status status = MaybeSyncRemoteExecutors(*item);
+  if (!status.ok()) {
+    NodeDone(item, status, /*from_queue=*/false);
+    return;
+  }
+
+  AsyncEagerNode* async_node = item->node->AsAsync();
+  if (async_node == nullptr) {
+    NodeDone(item, item->node->Run(), /*from_queue=*/false);
+    return;
+  }
+
+  auto async_ref = item.get();
+  async_ref->Ref();
+  async_node->RunAsync([this, async_ref](const Status& status) {
+    core::RefCountPtr<NodeItem> async_item(async_ref);
+    NodeDone(async_item, status, false);
+  });
+
+  // As when nodes are run one at a time, the nodes after an async node do not
+  // wait for its callback. Nodes dispatched after this release do not wait
+  // for it either (see DispatchLocked).
+  std::vector<core::RefCountPtr<NodeItem>> ready;
+  {
+    tensorflow::mutex_lock l(node_queue_mutex_);
+    if (status_.ok() && !item->released) {
+      ReleaseConsumersLocked(item.get(), &ready);
+    }
+  }
+  ScheduleReady(&ready);
+}
+
+Status EagerExecutor::MaybeSyncRemoteExecutors(const NodeItem& item) {
+  AsyncRemoteExecuteNode* async_remote_node =
+      item.node->AsAsyncRemoteExecuteNode();
+  if (!enable_async_wait_for_remote_function_ || async_remote_node == nullptr) {
+    return Status::OK();
+  }
+  if (last_eager_client_ != nullptr &&
+      async_remote_node->eager_client() != nullptr &&
+      last_eager_client_ != async_remote_node->eager_client()) {
+    // Running a remote function, need to sync if the function is going to
+    // different device than last time we run remote distributed function.
+    DVLOG(3) << "Executing Sync Executor for node" << item.id;
+    TF_RETURN_IF_ERROR(async_remote_node->SyncExecutors());
+    last_eager_client_ = nullptr;
+  }
+  if (async_remote_node->eager_client() != nullptr &&
+      async_remote_node->needs_remote_inputs() &&
+      async_remote_node->allow_multiple_pending_requests()) {
+    // We are running remote distributed function, update
+    // last_remote_device_name_.
+    last_eager_client_ = async_remote_node->eager_client();
+  }
+  return Status::OK();
+}
+
 Status EagerExecutor::MoveToUnfinished(core::RefCountPtr<NodeItem> item,
                                        bool from_queue) {
   tensorflow::mutex_lock l(node_queue_mutex_);
@@ -421,6 +521,96 @@ Status EagerExecutor::MoveToUnfinished(core::RefCountPtr<NodeItem> item,
   return Status::OK();
 }
 
+void EagerExecutor::DispatchLocked(
+    std::vector<core::RefCountPtr<NodeItem>>* ready) {
+  core::RefCountPtr<NodeItem> item = std::move(node_queue_.front());
+  node_queue_.pop();
+  item->dispatched = true;
+
+  gtl::InlinedVector<TensorHandle*, 4> inputs;
+  item->parallel = item->node->GetDataDependencies(&inputs, &item->outputs);
+  gtl::InlinedVector<uint64, 4> dependencies;
+  if (item->parallel) {
+    // Wait for the nodes producing the inputs, and for the last ordered node.
+    for (const TensorHandle* input : inputs) {
+      auto it = producers_.find(input);
+      if (it != producers_.end()) {
+        dependencies.push_back(it->second);
+      }
+    }
+    if (has_ordered_node_) {
+      auto it = unfinished_nodes_.find(last_ordered_node_id_);
+      if (it != unfinished_nodes_.end() && !it->second->released) {
+        dependencies.push_back(last_ordered_node_id_);
+      }
+    }
+    std::sort(dependencies.begin(), dependencies.end());
+    dependencies.erase(std::unique(dependencies.begin(), dependencies.end()),
+                       dependencies.end());
+    for (const TensorHandle* output : item->outputs) {
+      producers_[output] = item->id;
+    }
+  } else {
+    // An ordered node waits for all unfinished nodes, except the async nodes
+    // whose RunAsync already returned.
+    for (const auto& it : unfinished_nodes_) {
+      if (!it.second->released) dependencies.push_back(it.first);
+    }
+    last_ordered_node_id_ = item->id;
+    has_ordered_node_ = true;
+  }
+
+  for (uint64 id : dependencies) {
+    unfinished_nodes_[id]->consumers.push_back(item->id);
+  }
+  item->num_pending = dependencies.size();
+  DVLOG(3) << "Dispatch Node: [id " << item->id << "] waiting for "
+           << item->num_pending << " nodes.";
+  if (item->num_pending == 0) {
+    item->state = NodeState::kSCHEDULED;
+    item->Ref();
+    ready->emplace_back(item.get());
+  }
+  unfinished_nodes_.emplace_hint(unfinished_nodes_.end(), item->id,
+                                 std::move(item));
+}
+
+void EagerExecutor::ReleaseConsumersLocked(
+    NodeItem* item, std::vector<core::RefCountPtr<NodeItem>>* ready) {
+  item->released = true;
+  for (const TensorHandle* output : item->outputs) {
+    auto it = producers_.find(output);
+    if (it != producers_.end() && it->second == item->id) {
+      producers_.erase(it);
+    }
+  }
+  // Nodes are no longer scheduled once the executor is being destroyed.
+  if (state_ == ExecutorState::kShutDown) return;
+  for (uint64 id : item->consumers) {
+    auto it = unfinished_nodes_.find(id);
+    // The consumer was aborted if it is not found.
+    if (it == unfinished_nodes_.end()) continue;
+    NodeItem* consumer = it->second.get();
+    if (--consumer->num_pending == 0) {
+      consumer->state = NodeState::kSCHEDULED;
+      consumer->Ref();
+      ready->emplace_back(consumer);
+    }
+  }
+  item->consumers.clear();
+}
+
+void EagerExecutor::ScheduleReady(
+    std::vector<core::RefCountPtr<NodeItem>>* ready) {
+  for (auto& item : *ready) {
+    auto ref = item.release();
+    thread_pool_->Schedule([this, ref]() {
+      RunDispatchedItem(core::RefCountPtr<NodeItem>(ref));
+    });
+  }
+  ready->clear();
+}
+
 void EagerExecutor::AddCleanup(intptr_t key, std::function<void()> callback) {
   cleanups_[key].push_back(callback);
 }
@@ -21,6 +21,7 @@ limitations under the License.
 #include <memory>
 #include <queue>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "tensorflow/core/common_runtime/device_factory.h"
@@ -31,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
@@ -40,6 +42,7 @@ namespace tensorflow {
 
 class AsyncEagerNode;
 class AsyncRemoteExecuteNode;
+class TensorHandle;
 namespace eager {
 class EagerClient;
 }
@@ -75,6 +78,18 @@ class EagerNode {
 
   // Indicates whether a node failure should make the executor unusable.
   virtual bool Fatal() const { return true; }
+
+  // Returns true if the only effect of running this node is to read `inputs`
+  // and produce `outputs`. An executor running nodes in parallel may then
+  // reorder it with other such nodes, as long as it runs after the nodes
+  // producing its inputs. Nodes returning false keep their place in the
+  // order: they start after all earlier nodes are done, and later nodes start
+  // after them.
+  virtual bool GetDataDependencies(
+      gtl::InlinedVector<TensorHandle*, 4>* inputs,
+      gtl::InlinedVector<TensorHandle*, 4>* outputs) const {
+    return false;
+  }
 };
 
 class AsyncEagerNode : public EagerNode {
@@ -106,13 +121,19 @@ class AsyncRemoteExecuteNode : public AsyncEagerNode {
 // TODO(agarwal): TFE_OpAddInput may currently block if it tries to access the
 // device of the input handle. Fix that.
 // TODO(agarwal): Implement support for control dependencies.
-// TODO(agarwal): Support out-of-order execution and dispatching multiple
-// EagerNode in parallel.
 // TODO(agarwal): Implement optimizations over EagerNode traces.
 class EagerExecutor {
  public:
+  // The number of parallel threads of an async executor is read from the
+  // TF_EAGER_ASYNC_PARALLEL_THREADS environment variable.
   explicit EagerExecutor(bool async);
 
+  // If `async` and `num_parallel_threads` > 0, nodes are run out of order on
+  // a pool with `num_parallel_threads` threads as soon as the nodes they
+  // depend on are done (see EagerNode::GetDataDependencies). Otherwise, nodes
+  // are run one at a time in the order they were added.
+  EagerExecutor(bool async, int num_parallel_threads);
+
   ~EagerExecutor();
 
   // Puts this in a shutdown state. In this state, AddOrExecute() will return an
@@ -188,6 +209,24 @@ class EagerExecutor {
     uint64 id;
     std::unique_ptr<EagerNode> node;
     NodeState state;
+
+    // The fields below are only used by a parallel executor, and are guarded
+    // by node_queue_mutex_ once the node is dispatched.
+    // Whether the node was dispatched to `thread_pool_`.
+    bool dispatched = false;
+    // Whether the node started running on `thread_pool_`. Nodes that did not
+    // start are aborted if the executor fails.
+    bool started = false;
+    // Whether the consumers of the node were released. Later nodes do not
+    // wait for a released node: its RunAsync returned, or it is done.
+    bool released = false;
+    // Whether the node may run out of order, and the handles it produces.
+    bool parallel = false;
+    gtl::InlinedVector<TensorHandle*, 4> outputs;
+    // The number of unfinished nodes this node waits for, and the ids of the
+    // nodes waiting for this one.
+    int num_pending = 0;
+    gtl::InlinedVector<uint64, 4> consumers;
   };
 
   const char* StateStringLocked()
@@ -204,8 +243,24 @@ class EagerExecutor {
   void Run();
 
   Status RunItem(core::RefCountPtr<NodeItem> item, bool from_queue);
+  // Runs a dispatched item on `thread_pool_`.
+  void RunDispatchedItem(core::RefCountPtr<NodeItem> item);
+  // Syncs the remote executors if `item` runs a remote function on a
+  // different worker than the last one.
+  Status MaybeSyncRemoteExecutors(const NodeItem& item);
   Status MoveToUnfinished(core::RefCountPtr<NodeItem> item, bool from_queue);
 
+  // Moves the front of `node_queue_` to `unfinished_nodes_` and records the
+  // unfinished nodes it depends on. Appends it to `ready` if there are none.
+  void DispatchLocked(std::vector<core::RefCountPtr<NodeItem>>* ready)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(node_queue_mutex_);
+  // Releases the consumers of the done `item`, appending the ones that no
+  // longer wait for any node to `ready`.
+  void ReleaseConsumersLocked(NodeItem* item,
+                              std::vector<core::RefCountPtr<NodeItem>>* ready)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(node_queue_mutex_);
+  void ScheduleReady(std::vector<core::RefCountPtr<NodeItem>>* ready);
+
   // The impl of WaitForAllPendingNodes
   // `lock` is the lock that holds node_queue_mutex_.
   Status WaitForAllPendingNodesLocked(mutex_lock* lock)
@@ -240,6 +295,14 @@ class EagerExecutor {
   std::multimap<uint64, condition_variable*, std::less<uint64>>
       node_done_notifications_ TF_GUARDED_BY(node_queue_mutex_);
 
+  // Maps the outputs of unfinished parallel nodes to the ids of those nodes.
+  std::unordered_map<const TensorHandle*, uint64> producers_
+      TF_GUARDED_BY(node_queue_mutex_);
+
+  // The id of the last ordered node dispatched by a parallel executor.
+  uint64 last_ordered_node_id_ TF_GUARDED_BY(node_queue_mutex_) = 0;
+  bool has_ordered_node_ TF_GUARDED_BY(node_queue_mutex_) = false;
+
   // thread_exited_notification_ is notified by the `thread_` right before it
   // exits.
   Notification thread_exited_notification_;
@@ -249,6 +312,11 @@ class EagerExecutor {
   ExecutorState state_ TF_GUARDED_BY(node_queue_mutex_) =
       ExecutorState::kActive;
 
+  // Runs the dispatched nodes of a parallel executor. It is `nullptr` if
+  // nodes are run one at a time. It is declared before `thread_` so that the
+  // thread stops dispatching nodes before the pool is destroyed.
+  const std::unique_ptr<thread::ThreadPool> thread_pool_;
+
   // Thread object that calls the `Run` method in async mode.This thread runs
   // until state_ is set to kShuttingDown. It is `nullptr` in sync mode.
   const std::unique_ptr<Thread> thread_;
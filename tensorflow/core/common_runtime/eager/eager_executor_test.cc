@@ -0,0 +1,235 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/eager/eager_executor.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/eager/tensor_handle.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// A node running `fn`, that only depends on `inputs` and `outputs` if it is
+// `parallel`. Notifies `aborted` if it is aborted.
+class TestNode : public EagerNode {
+ public:
+  TestNode(std::function<Status()> fn, bool parallel,
+           std::vector<TensorHandle*> inputs,
+           std::vector<TensorHandle*> outputs,
+           Notification* aborted = nullptr)
+      : fn_(std::move(fn)),
+        parallel_(parallel),
+        inputs_(std::move(inputs)),
+        outputs_(std::move(outputs)),
+        aborted_(aborted) {}
+
+  Status Run() override { return fn_(); }
+
+  void Abort(Status status) override {
+    if (aborted_ != nullptr) aborted_->Notify();
+  }
+
+  bool GetDataDependencies(
+      gtl::InlinedVector<TensorHandle*, 4>* inputs,
+      gtl::InlinedVector<TensorHandle*, 4>* outputs) const override {
+    inputs->assign(inputs_.begin(), inputs_.end());
+    outputs->assign(outputs_.begin(), outputs_.end());
+    return parallel_;
+  }
+
+  string DebugString() const override { return "[TestNode]"; }
+
+ private:
+  std::function<Status()> fn_;
+  const bool parallel_;
+  std::vector<TensorHandle*> inputs_;
+  std::vector<TensorHandle*> outputs_;
+  Notification* aborted_;
+};
+
+// An async node passing its done callback to `fn`.
+class AsyncTestNode : public AsyncEagerNode {
+ public:
+  explicit AsyncTestNode(std::function<void(StatusCallback)> fn)
+      : fn_(std::move(fn)) {}
+
+  void RunAsync(StatusCallback done) override { fn_(std::move(done)); }
+
+  void Abort(Status status) override {}
+
+  string DebugString() const override { return "[AsyncTestNode]"; }
+
+ private:
+  std::function<void(StatusCallback)> fn_;
+};
+
+class ParallelEagerExecutorTest : public ::testing::Test {
+ protected:
+  ParallelEagerExecutorTest()
+      : executor_(/*async=*/true, /*num_parallel_threads=*/4) {
+    for (int i = 0; i < 4; ++i) {
+      handles_.push_back(TensorHandle::CreateLocalHandle(Tensor(1.0f)));
+    }
+  }
+
+  ~ParallelEagerExecutorTest() override {
+    TF_EXPECT_OK(executor_.ShutDown());
+    for (TensorHandle* handle : handles_) {
+      handle->Unref();
+    }
+  }
+
+  // Adds a node appending `id` to `order_` when it runs.
+  void AddNode(int id, bool parallel, std::vector<TensorHandle*> inputs,
+               std::vector<TensorHandle*> outputs) {
+    TF_ASSERT_OK(executor_.AddOrExecute(absl::make_unique<TestNode>(
+        [this, id]() {
+          mutex_lock l(mu_);
+          order_.push_back(id);
+          return Status::OK();
+        },
+        parallel, std::move(inputs), std::move(outputs))));
+  }
+
+  int Position(int id) {
+    mutex_lock l(mu_);
+    return std::find(order_.begin(), order_.end(), id) - order_.begin();
+  }
+
+  EagerExecutor executor_;
+  std::vector<TensorHandle*> handles_;
+  mutex mu_;
+  std::vector<int> order_ TF_GUARDED_BY(mu_);
+};
+
+TEST_F(ParallelEagerExecutorTest, IndependentNodesRunConcurrently) {
+  // The first node only returns once the second one has run.
+  Notification second_done;
+  TF_ASSERT_OK(executor_.AddOrExecute(absl::make_unique<TestNode>(
+      [&second_done]() {
+        second_done.WaitForNotification();
+        return Status::OK();
+      },
+      /*parallel=*/true, std::vector<TensorHandle*>{handles_[0]},
+      std::vector<TensorHandle*>{handles_[1]})));
+  TF_ASSERT_OK(executor_.AddOrExecute(absl::make_unique<TestNode>(
+      [&second_done]() {
+        second_done.Notify();
+        return Status::OK();
+      },
+      /*parallel=*/true, std::vector<TensorHandle*>{handles_[0]},
+      std::vector<TensorHandle*>{handles_[2]})));
+  TF_EXPECT_OK(executor_.WaitForAllPendingNodes());
+}
+
+TEST_F(ParallelEagerExecutorTest, ConsumersRunAfterProducers) {
+  // 0 -> 1 -> 3 and 0 -> 2 -> 3.
+  AddNode(0, /*parallel=*/true, {}, {handles_[0]});
+  AddNode(1, /*parallel=*/true, {handles_[0]}, {handles_[1]});
+  AddNode(2, /*parallel=*/true, {handles_[0]}, {handles_[2]});
+  AddNode(3, /*parallel=*/true, {handles_[1], handles_[2]}, {handles_[3]});
+  TF_ASSERT_OK(executor_.WaitForAllPendingNodes());
+  EXPECT_LT(Position(0), Position(1));
+  EXPECT_LT(Position(0), Position(2));
+  EXPECT_LT(Position(1), Position(3));
+  EXPECT_LT(Position(2), Position(3));
+  EXPECT_EQ(Position(3), 3);
+}
+
+TEST_F(ParallelEagerExecutorTest, OrderedNodesKeepTheirPlace) {
+  AddNode(0, /*parallel=*/true, {}, {handles_[0]});
+  AddNode(1, /*parallel=*/true, {}, {handles_[1]});
+  AddNode(2, /*parallel=*/false, {}, {});
+  AddNode(3, /*parallel=*/true, {}, {handles_[2]});
+  AddNode(4, /*parallel=*/true, {}, {handles_[3]});
+  TF_ASSERT_OK(executor_.WaitForAllPendingNodes());
+  EXPECT_EQ(Position(2), 2);
+  EXPECT_GT(Position(3), 2);
+  EXPECT_GT(Position(4), 2);
+}
+
+TEST_F(ParallelEagerExecutorTest, ErrorAbortsWaitingNodes) {
+  Notification may_fail;
+  TF_ASSERT_OK(executor_.AddOrExecute(absl::make_unique<TestNode>(
+      [&may_fail]() {
+        may_fail.WaitForNotification();
+        return errors::Internal("Failed");
+      },
+      /*parallel=*/true, std::vector<TensorHandle*>{},
+      std::vector<TensorHandle*>{handles_[0]})));
+  Notification aborted;
+  TF_ASSERT_OK(executor_.AddOrExecute(absl::make_unique<TestNode>(
+      []() { return Status::OK(); }, /*parallel=*/true,
+      std::vector<TensorHandle*>{handles_[0]},
+      std::vector<TensorHandle*>{handles_[1]}, &aborted)));
+  may_fail.Notify();
+  Status status = executor_.WaitForAllPendingNodes();
+  EXPECT_EQ(status.code(), error::INTERNAL);
+  aborted.WaitForNotification();
+
+  // The executor runs new nodes once the error is cleared.
+  executor_.ClearError();
+  AddNode(0, /*parallel=*/true, {handles_[0]}, {handles_[1]});
+  TF_ASSERT_OK(executor_.WaitForAllPendingNodes());
+  EXPECT_EQ(Position(0), 0);
+}
+
+TEST_F(ParallelEagerExecutorTest, AsyncNodesReleaseLaterNodes) {
+  // The first async node is only done once all the other nodes were added.
+  Notification first_started;
+  StatusCallback first_done;
+  TF_ASSERT_OK(executor_.AddOrExecute(
+      absl::make_unique<AsyncTestNode>([&](StatusCallback done) {
+        first_done = std::move(done);
+        first_started.Notify();
+      })));
+  first_started.WaitForNotification();
+
+  // Async nodes ordered after the first one, done from other threads, and a
+  // sync node ordered after them.
+  for (int id = 0; id < 4; ++id) {
+    TF_ASSERT_OK(executor_.AddOrExecute(
+        absl::make_unique<AsyncTestNode>([this, id](StatusCallback done) {
+          Env::Default()->SchedClosure([this, id, done]() {
+            {
+              mutex_lock l(mu_);
+              order_.push_back(id);
+            }
+            done(Status::OK());
+          });
+        })));
+  }
+  AddNode(4, /*parallel=*/false, {}, {});
+
+  first_done(Status::OK());
+  TF_ASSERT_OK(executor_.WaitForAllPendingNodes());
+  for (int id = 0; id <= 4; ++id) {
+    EXPECT_LT(Position(id), 5);
+  }
+}
+
+}  // namespace
+}  // namespace tensorflow
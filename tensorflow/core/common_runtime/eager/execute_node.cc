@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/common_runtime/eager/execute_node.h"
 
+#include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/lib/core/errors.h"
 
 namespace tensorflow {
@@ -148,4 +149,26 @@ Status ExecuteNodeArgs::GetLocalArg(const FunctionArgIndex& index,
   }
 }
 
+bool AsyncExecuteNode::GetDataDependencies(
+    gtl::InlinedVector<TensorHandle*, 4>* inputs,
+    gtl::InlinedVector<TensorHandle*, 4>* outputs) const {
+  const OpKernel* op_kernel = kernel_->kernel();
+  if (op_kernel == nullptr || kernel_->IsFunction() ||
+      remote_func_params_.has_value() || graph_collector_ != nullptr) {
+    return false;
+  }
+  for (DataType dtype : kernel_->input_dtypes()) {
+    if (dtype == DT_RESOURCE) return false;
+  }
+  const OpDef* op_def = nullptr;
+  if (!OpRegistry::Global()->LookUpOpDef(op_kernel->type_string(), &op_def)
+           .ok() ||
+      op_def->is_stateful()) {
+    return false;
+  }
+  inputs->assign(inputs_.begin(), inputs_.end());
+  outputs->assign(retvals_.begin(), retvals_.end());
+  return true;
+}
+
 }  // namespace tensorflow
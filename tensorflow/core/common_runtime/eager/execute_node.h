@@ -212,6 +212,12 @@ class AsyncExecuteNode : public EagerNode {
     return Status::OK();
   }
 
+  // Local primitive ops that are not stateful and do not read resources only
+  // depend on their inputs.
+  bool GetDataDependencies(
+      gtl::InlinedVector<TensorHandle*, 4>* inputs,
+      gtl::InlinedVector<TensorHandle*, 4>* outputs) const override;
+
   void Abort(Status status) override {
     int i = 0;
     for (auto handle : retvals_) {
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/executor.h"
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <vector>
@@ -139,7 +140,9 @@ class ExecutorImpl : public Executor {
 
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
-    kernel_stats_.Initialize(immutable_state_.graph_view());
+    kernel_stats_.Initialize(
+        immutable_state_.graph_view(),
+        immutable_state_.params().use_critical_path_scheduling);
     return Status::OK();
   }
 
@@ -154,7 +157,7 @@ class ExecutorImpl : public Executor {
    public:
     KernelStats() = default;
 
-    void Initialize(const GraphView& gview) {
+    void Initialize(const GraphView& gview, bool use_critical_path_scheduling) {
       is_expensive_ = absl::make_unique<std::atomic<bool>[]>(gview.num_nodes());
       cost_estimates_ =
           absl::make_unique<std::atomic_uint_fast64_t[]>(gview.num_nodes());
@@ -165,6 +168,9 @@ class ExecutorImpl : public Executor {
           cost_estimates_[i] = kInitialCostEstimateCycles;
         }
       }
+      if (use_critical_path_scheduling) {
+        InitializeCriticalPath(gview);
+      }
     }
 
     // Returns true iff the given node is considered "expensive". The
@@ -200,16 +206,125 @@ class ExecutorImpl : public Executor {
       }
     }
 
+    // Returns true iff the executor records the cost of every kernel and
+    // orders ready nodes by their critical path priority.
+    bool UseCriticalPathScheduling() const { return graph_view_ != nullptr; }
+
+    // Records the cost of one execution of `node`. Unlike the estimate used by
+    // `IsExpensive()`, which starts out high, this is an average of observed
+    // costs only, and is tracked for inexpensive kernels as well.
+    //
+    // REQUIRES: `UseCriticalPathScheduling()`.
+    void RecordCost(const NodeItem& node, uint64 elapsed_cycles) {
+      std::atomic_uint_fast64_t& cost = observed_costs_[node.node_id];
+      const uint64 old_cost = cost.load(std::memory_order_relaxed);
+      cost.store(old_cost == 0 ? elapsed_cycles
+                               : (kCostDecay - 1) * old_cost / kCostDecay +
+                                     elapsed_cycles / kCostDecay,
+                 std::memory_order_relaxed);
+    }
+
+    // Returns the estimated number of cycles between the start of `node` and
+    // the end of the longest chain of nodes that depends on it. Returns 0 until
+    // the priorities have been computed.
+    //
+    // REQUIRES: `UseCriticalPathScheduling()`.
+    uint64 Priority(const NodeItem& node) const {
+      return priorities_[node.node_id].load(std::memory_order_relaxed);
+    }
+
+    // Called at the start of every run. Recomputes the priorities from the
+    // costs recorded by previous runs after the first run, and then every
+    // `kPriorityUpdateIntervalRuns` runs.
+    void MaybeUpdatePriorities() {
+      if (!UseCriticalPathScheduling()) return;
+      const int64 run = num_runs_.fetch_add(1, std::memory_order_relaxed);
+      if (run % kPriorityUpdateIntervalRuns != 1) return;
+      // Concurrent runs may read the priorities while they are updated. A mix
+      // of old and new values only affects the order in which nodes run.
+      if (!priorities_mu_.try_lock()) return;
+      for (auto it = topological_order_.rbegin();
+           it != topological_order_.rend(); ++it) {
+        const NodeItem& item = *graph_view_->node(*it);
+        uint64 successor_priority = 0;
+        ForEachSuccessor(item, [this, &successor_priority](int32 dst_id) {
+          successor_priority = std::max<uint64>(
+              successor_priority,
+              priorities_[dst_id].load(std::memory_order_relaxed));
+        });
+        priorities_[*it].store(
+            observed_costs_[*it].load(std::memory_order_relaxed) +
+                successor_priority,
+            std::memory_order_relaxed);
+      }
+      priorities_mu_.unlock();
+    }
+
    private:
+    // Invokes `fn` with the id of every node that consumes an output of
+    // `item`, ignoring the back edges of while loops.
+    template <typename Fn>
+    void ForEachSuccessor(const NodeItem& item, Fn fn) const {
+      if (item.is_next_iteration) return;
+      for (const EdgeInfo& e : item.output_edges()) fn(e.dst_id);
+      for (const ControlEdgeInfo& e : item.output_control_edges()) {
+        fn(e.dst_id);
+      }
+    }
+
+    // Computes a topological order of the nodes in `gview`, in which the
+    // priorities are later propagated from the sinks to the sources.
+    void InitializeCriticalPath(const GraphView& gview) {
+      const int32 num_nodes = gview.num_nodes();
+      graph_view_ = &gview;
+      observed_costs_ =
+          absl::make_unique<std::atomic_uint_fast64_t[]>(num_nodes);
+      priorities_ = absl::make_unique<std::atomic_uint_fast64_t[]>(num_nodes);
+      std::vector<int32> num_pending(num_nodes, 0);
+      for (int32 i = 0; i < num_nodes; ++i) {
+        observed_costs_[i] = 0;
+        priorities_[i] = 0;
+        if (gview.node(i)) {
+          ForEachSuccessor(*gview.node(i), [&num_pending](int32 dst_id) {
+            ++num_pending[dst_id];
+          });
+        }
+      }
+      topological_order_.clear();
+      topological_order_.reserve(num_nodes);
+      for (int32 i = 0; i < num_nodes; ++i) {
+        if (gview.node(i) && num_pending[i] == 0) {
+          topological_order_.push_back(i);
+        }
+      }
+      for (size_t i = 0; i < topological_order_.size(); ++i) {
+        ForEachSuccessor(*gview.node(topological_order_[i]),
+                         [this, &num_pending](int32 dst_id) {
+                           if (--num_pending[dst_id] == 0) {
+                             topological_order_.push_back(dst_id);
+                           }
+                         });
+      }
+    }
+
     // Initial time (in CPU cycles) we expect an operation to take.  Used to
     // determine whether an operation should be place in a threadpool.
     // Operations start out "expensive".
     static constexpr uint64 kInitialCostEstimateCycles = 100 * 1000 * 1000;
     static constexpr uint64 kOpIsExpensiveThresholdCycles = 5000;
     static constexpr uint64 kCostDecay = 10;
+    static constexpr int64 kPriorityUpdateIntervalRuns = 100;
 
     std::unique_ptr<std::atomic<bool>[]> is_expensive_;
     std::unique_ptr<std::atomic_uint_fast64_t[]> cost_estimates_;
+
+    // The following are only set if critical path scheduling is enabled.
+    const GraphView* graph_view_ = nullptr;
+    std::vector<int32> topological_order_;
+    std::unique_ptr<std::atomic_uint_fast64_t[]> observed_costs_;
+    std::unique_ptr<std::atomic_uint_fast64_t[]> priorities_;
+    std::atomic<int64> num_runs_{0};
+    mutex priorities_mu_;
   };
 
   ImmutableExecutorState immutable_state_;
@@ -569,10 +684,16 @@ Status ExecutorState<PropagatorStateType>::ProcessSync(
     device->Compute(op_kernel, &ctx);
   } else {
     // In the common case, avoid creating any tracing objects.
-    if (is_expensive) {
+    if (is_expensive || kernel_stats_->UseCriticalPathScheduling()) {
       KernelTimer timer;
       device->Compute(op_kernel, &ctx);
-      kernel_stats_->UpdateCostEstimate(item, timer.ElapsedCycles());
+      const uint64 elapsed_cycles = timer.ElapsedCycles();
+      if (is_expensive) {
+        kernel_stats_->UpdateCostEstimate(item, elapsed_cycles);
+      }
+      if (kernel_stats_->UseCriticalPathScheduling()) {
+        kernel_stats_->RecordCost(item, elapsed_cycles);
+      }
     } else {
       device->Compute(op_kernel, &ctx);
     }
@@ -1160,6 +1281,16 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
       }
     }
   } else {
+    const bool prioritize =
+        kernel_stats_->UseCriticalPathScheduling() && ready->size() > 1;
+    if (prioritize) {
+      // Start the nodes on the longest remaining paths first.
+      std::stable_sort(ready->begin(), ready->end(),
+                       [this](const TaggedNode& a, const TaggedNode& b) {
+                         return kernel_stats_->Priority(*a.node_item) >
+                                kernel_stats_->Priority(*b.node_item);
+                       });
+    }
     const TaggedNode* curr_expensive_node = nullptr;
     if (inline_ready == nullptr) {
       // Schedule to run all the ready ops in thread pool.
@@ -1172,6 +1303,11 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
         if (tagged_node.get_is_dead() || !kernel_stats_->IsExpensive(item)) {
           // Inline this inexpensive node.
           inline_ready->push_back(tagged_node);
+        } else if (prioritize && curr_expensive_node) {
+          // Keep the most critical expensive node for this thread, and
+          // dispatch the others in order of priority.
+          RunTask(std::bind(&ExecutorState::Process, this, tagged_node,
+                            scheduled_nsec));
         } else {
           if (curr_expensive_node) {
             // Dispatch to another thread since there is plenty of work to
@@ -1333,6 +1469,7 @@ void ExecutorState<PropagatorStateType>::Finish() {
 }
 
 void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
+  kernel_stats_.MaybeUpdatePriorities();
   if (immutable_state_.requires_control_flow_support()) {
     (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
         ->RunAsync(std::move(done));
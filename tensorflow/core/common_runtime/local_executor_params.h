@@ -47,6 +47,11 @@ struct LocalExecutorParams {
                        OpKernel**)>
       create_kernel;
   std::function<void(OpKernel*)> delete_kernel;
+
+  // If true, the executor records the cost of every kernel, and dispatches
+  // ready nodes in order of the estimated length of the longest path that
+  // depends on them, based on the costs observed in previous runs.
+  bool use_critical_path_scheduling = false;
 };
 
 }  // end namespace tensorflow
@@ -21,8 +21,7 @@ limitations under the License.
 namespace tensorflow {
 namespace data {
 
-Status CompressElement(const std::vector<Tensor>& element,
-                       CompressedElement* out) {
+Status PackElement(const std::vector<Tensor>& element, CompressedElement* out) {
   // Step 1: Determine the total uncompressed size. This requires serializing
   // non-memcopyable tensors, which we save to use again later.
   std::vector<TensorProto> non_memcpy_components;
@@ -39,12 +38,11 @@ Status CompressElement(const std::vector<Tensor>& element,
     }
   }
 
-  // Step 2: Write the tensor data to a buffer, and compress that buffer.
-  // We use tstring for access to resize_uninitialized.
-  tstring uncompressed;
-  uncompressed.resize_uninitialized(total_size);
-  // Position in `uncompressed` to write the next component.
-  char* position = uncompressed.mdata();
+  // Step 2: Write the tensor data directly into the output buffer.
+  std::string* data = out->mutable_data();
+  data->resize(total_size);
+  // Position in `data` to write the next component.
+  char* position = &(*data)[0];
   int non_memcpy_component_index = 0;
   for (auto& component : element) {
     CompressedComponentMetadata* metadata =
@@ -62,22 +60,91 @@ Status CompressElement(const std::vector<Tensor>& element,
     }
     position += metadata->tensor_size_bytes();
   }
-  DCHECK_EQ(position, uncompressed.mdata() + total_size);
+  DCHECK_EQ(position, data->data() + total_size);
+  out->set_compression(CompressedElement::UNCOMPRESSED);
+  return Status::OK();
+}
 
-  if (!port::Snappy_Compress(uncompressed.mdata(), total_size,
-                             out->mutable_data())) {
+Status CompressPackedElement(CompressedElement* element) {
+  if (element->compression() != CompressedElement::UNCOMPRESSED) {
+    return Status::OK();
+  }
+  const std::string& uncompressed = element->data();
+  std::string compressed;
+  if (!port::Snappy_Compress(uncompressed.data(), uncompressed.size(),
+                             &compressed)) {
     return errors::Internal("Failed to compress using snappy.");
   }
-  VLOG(3) << "Compressed element from " << total_size << " bytes to "
-          << out->data().size() << " bytes";
+  VLOG(3) << "Compressed element from " << uncompressed.size() << " bytes to "
+          << compressed.size() << " bytes";
+  if (compressed.size() >= uncompressed.size()) {
+    return Status::OK();
+  }
+  element->mutable_data()->swap(compressed);
+  element->set_compression(CompressedElement::SNAPPY);
+  return Status::OK();
+}
+
+Status CompressElement(const std::vector<Tensor>& element,
+                       CompressedElement* out) {
+  TF_RETURN_IF_ERROR(PackElement(element, out));
+  return CompressPackedElement(out);
+}
+
+namespace {
+
+// Uncompresses an element whose `data` holds the component bytes as-is. The
+// bytes are copied straight into the buffers of the output tensors.
+Status UnpackElement(const CompressedElement& packed,
+                     std::vector<Tensor>* out) {
+  const std::string& data = packed.data();
+  int64 offset = 0;
+  for (const auto& metadata : packed.component_metadata()) {
+    const int64 size = metadata.tensor_size_bytes();
+    if (size < 0 || offset + size > static_cast<int64>(data.size())) {
+      return errors::Internal("Component of ", size, " bytes at offset ",
+                              offset, " exceeds the ", data.size(),
+                              " bytes of element data");
+    }
+    if (DataTypeCanUseMemcpy(metadata.dtype())) {
+      out->emplace_back(metadata.dtype(), metadata.tensor_shape());
+      TensorBuffer* buffer = DMAHelper::buffer(&out->back());
+      if (buffer->size() != size) {
+        return errors::Internal("Expected ", buffer->size(),
+                                " bytes for a tensor of shape ",
+                                out->back().shape().DebugString(), ", got ",
+                                size);
+      }
+      memcpy(buffer->data(), data.data() + offset, size);
+    } else {
+      TensorProto tp;
+      if (!tp.ParseFromArray(data.data() + offset, size)) {
+        return errors::Internal("Could not parse TensorProto");
+      }
+      out->emplace_back();
+      if (!out->back().FromProto(tp)) {
+        return errors::Internal("Could not parse Tensor");
+      }
+    }
+    offset += size;
+  }
+  if (offset != static_cast<int64>(data.size())) {
+    return errors::Internal("Element data has ", data.size(),
+                            " bytes, but its components only use ", offset);
+  }
   return Status::OK();
 }
 
+}  // namespace
+
 Status UncompressElement(const CompressedElement& compressed,
                          std::vector<Tensor>* out) {
   int num_components = compressed.component_metadata_size();
   out->clear();
   out->reserve(num_components);
+  if (compressed.compression() == CompressedElement::UNCOMPRESSED) {
+    return UnpackElement(compressed, out);
+  }
 
   // Step 1: Prepare the memory that we will uncompress into.
   std::vector<struct iovec> iov(num_components);
@@ -29,6 +29,16 @@ namespace data {
 Status CompressElement(const std::vector<Tensor>& element,
                        CompressedElement* out);
 
+// Writes the components of `element` into the `CompressedElement` proto
+// without compressing them. The result can be compressed later with
+// `CompressPackedElement`, or uncompressed directly.
+Status PackElement(const std::vector<Tensor>& element, CompressedElement* out);
+
+// Snappy-compresses the data of an element produced by `PackElement`. Leaves
+// the element uncompressed if compression doesn't make it smaller. Elements
+// which are already compressed are left unchanged.
+Status CompressPackedElement(CompressedElement* element);
+
 // Uncompresses a `CompressedElement` into a vector of tensor components.
 Status UncompressElement(const CompressedElement& compressed,
                          std::vector<Tensor>* out);
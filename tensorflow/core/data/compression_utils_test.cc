@@ -35,6 +35,33 @@ TEST_P(ParameterizedCompressionUtilsTest, RoundTrip) {
       ExpectEqual(element, round_trip_element, /*compare_order=*/true));
 }
 
+TEST_P(ParameterizedCompressionUtilsTest, PackedRoundTrip) {
+  std::vector<Tensor> element = GetParam();
+  CompressedElement packed;
+  TF_ASSERT_OK(PackElement(element, &packed));
+  EXPECT_EQ(packed.compression(), CompressedElement::UNCOMPRESSED);
+  std::vector<Tensor> round_trip_element;
+  TF_ASSERT_OK(UncompressElement(packed, &round_trip_element));
+  TF_EXPECT_OK(
+      ExpectEqual(element, round_trip_element, /*compare_order=*/true));
+
+  TF_ASSERT_OK(CompressPackedElement(&packed));
+  TF_ASSERT_OK(UncompressElement(packed, &round_trip_element));
+  TF_EXPECT_OK(
+      ExpectEqual(element, round_trip_element, /*compare_order=*/true));
+}
+
+TEST(CompressionUtilsTest, CompressPackedElement) {
+  std::vector<Tensor> element = {Tensor(DT_INT64, TensorShape({1024}))};
+  element[0].flat<int64>().setZero();
+  CompressedElement packed;
+  TF_ASSERT_OK(PackElement(element, &packed));
+  EXPECT_EQ(packed.data().size(), 1024 * sizeof(int64));
+  TF_ASSERT_OK(CompressPackedElement(&packed));
+  EXPECT_EQ(packed.compression(), CompressedElement::SNAPPY);
+  EXPECT_LT(packed.data().size(), 1024 * sizeof(int64));
+}
+
 std::vector<std::vector<Tensor>> TestCases() {
   return {
       CreateTensors<int64>(TensorShape{1}, {{1}}),             // int64
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/grpc_util.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/platform/env_time.h"
 
 namespace tensorflow {
 namespace data {
@@ -29,6 +30,25 @@ namespace data {
 namespace {
 constexpr const char kParallelEpochs[] = "parallel_epochs";
 constexpr const char kDistributedEpoch[] = "distributed_epoch";
+
+// Conservative single-core snappy throughputs in bytes per second, used to
+// estimate the CPU cost of compressing elements.
+constexpr double kSnappyCompressBytesPerSecond = 250e6;
+constexpr double kSnappyUncompressBytesPerSecond = 500e6;
+// Weight of the newest measurement in the transfer estimates.
+constexpr double kTransferEstimateWeight = 0.1;
+// When compression is off in AUTO mode, every this many elements one is
+// requested compressed to keep the compression ratio estimate up to date.
+constexpr int64 kCompressionProbeInterval = 64;
+
+void UpdateEstimate(double measurement, double& estimate) {
+  if (estimate <= 0) {
+    estimate = measurement;
+  } else {
+    estimate = (1 - kTransferEstimateWeight) * estimate +
+               kTransferEstimateWeight * measurement;
+  }
+}
 }  // namespace
 
 Status ParseProcessingMode(const std::string& s, ProcessingMode& mode) {
@@ -56,6 +76,7 @@ std::string ProcessingModeToString(ProcessingMode mode) {
 
 Status DataServiceDispatcherClient::WorkerHeartbeat(
     const std::string& worker_address, const std::vector<int64>& current_tasks,
+    const ElementCacheStats* element_cache_stats,
     std::vector<TaskDef>& new_tasks, std::vector<int64>& tasks_to_delete) {
   TF_RETURN_IF_ERROR(EnsureInitialized());
   WorkerHeartbeatRequest req;
@@ -63,6 +84,9 @@ Status DataServiceDispatcherClient::WorkerHeartbeat(
   for (int64 task : current_tasks) {
     req.add_current_tasks(task);
   }
+  if (element_cache_stats != nullptr) {
+    *req.mutable_element_cache_stats() = *element_cache_stats;
+  }
   WorkerHeartbeatResponse resp;
   grpc::ClientContext client_ctx;
   grpc::Status status = stub_->WorkerHeartbeat(&client_ctx, req, &resp);
@@ -262,19 +286,78 @@ Status DataServiceWorkerClient::GetElement(int64 task_id,
   TF_RETURN_IF_ERROR(EnsureInitialized());
   GetElementRequest req;
   req.set_task_id(task_id);
+  bool compress;
+  {
+    mutex_lock l(mu_);
+    compress = ShouldCompress();
+  }
+  req.set_skip_compression(!compress);
   GetElementResponse resp;
   grpc::ClientContext ctx;
+  const int64 start_micros = EnvTime::NowMicros();
   grpc::Status s = stub_->GetElement(&ctx, req, &resp);
   if (!s.ok()) {
     return grpc_util::WrapError("Failed to get element", s);
   }
   end_of_sequence = resp.end_of_sequence();
   if (!end_of_sequence) {
+    {
+      mutex_lock l(mu_);
+      RecordTransfer(resp.compressed_element(), compress,
+                     EnvTime::NowMicros() - start_micros -
+                         resp.processing_time_micros());
+    }
     element = std::move(*resp.mutable_compressed_element());
   }
   return Status::OK();
 }
 
+bool DataServiceWorkerClient::ShouldCompress() {
+  switch (compression_) {
+    case TransferCompression::ALWAYS:
+      return true;
+    case TransferCompression::NEVER:
+      return false;
+    case TransferCompression::AUTO:
+      break;
+  }
+  if (bytes_per_second_ <= 0 || compression_ratio_ <= 0 ||
+      elements_since_compression_ >= kCompressionProbeInterval) {
+    return true;
+  }
+  // Compressing a byte saves `1 - compression_ratio_` bytes on the wire, and
+  // costs compressing it on the worker and uncompressing it here.
+  const double saved_seconds_per_byte =
+      (1 - compression_ratio_) / bytes_per_second_;
+  const double cost_seconds_per_byte = 1 / kSnappyCompressBytesPerSecond +
+                                       1 / kSnappyUncompressBytesPerSecond;
+  return saved_seconds_per_byte > cost_seconds_per_byte;
+}
+
+void DataServiceWorkerClient::RecordTransfer(const CompressedElement& element,
+                                             bool requested_compression,
+                                             int64 transfer_micros) {
+  int64 uncompressed_bytes = 0;
+  for (const auto& metadata : element.component_metadata()) {
+    uncompressed_bytes += metadata.tensor_size_bytes();
+  }
+  const int64 wire_bytes = element.data().size();
+  if (requested_compression) {
+    elements_since_compression_ = 0;
+    if (uncompressed_bytes > 0) {
+      // Workers send elements uncompressed when compression doesn't make
+      // them smaller.
+      UpdateEstimate(static_cast<double>(wire_bytes) / uncompressed_bytes,
+                     compression_ratio_);
+    }
+  } else {
+    elements_since_compression_++;
+  }
+  if (transfer_micros > 0 && wire_bytes > 0) {
+    UpdateEstimate(wire_bytes * 1e6 / transfer_micros, bytes_per_second_);
+  }
+}
+
 Status DataServiceWorkerClient::EnsureInitialized() {
   mutex_lock l(mu_);
   if (stub_) {
@@ -302,8 +385,10 @@ Status CreateDataServiceDispatcherClient(
 
 Status CreateDataServiceWorkerClient(
     const std::string& address, const std::string& protocol,
-    std::unique_ptr<DataServiceWorkerClient>& out) {
-  auto client = absl::make_unique<DataServiceWorkerClient>(address, protocol);
+    std::unique_ptr<DataServiceWorkerClient>& out,
+    TransferCompression compression) {
+  auto client = absl::make_unique<DataServiceWorkerClient>(address, protocol,
+                                                           compression);
   TF_RETURN_IF_ERROR(client->Initialize());
   out = std::move(client);
   return Status::OK();
@@ -41,6 +41,18 @@ Status ParseProcessingMode(const std::string& s, ProcessingMode& mode);
 // Converts a processing mode to its corresponding string.
 std::string ProcessingModeToString(ProcessingMode mode);
 
+// Modes for whether tf.data service workers compress elements before sending
+// them to clients.
+enum class TransferCompression : int64 {
+  // Compress elements when the transfer rate observed by the client is low
+  // enough that the time saved on the wire outweighs the compression CPU time.
+  AUTO = 0,
+  // Always compress elements.
+  ALWAYS = 1,
+  // Send the component bytes of elements without compressing them.
+  NEVER = 2,
+};
+
 // Base class for data service clients. Data service clients are
 // threadsafe.
 class DataServiceClientBase {
@@ -78,9 +90,11 @@ class DataServiceDispatcherClient : public DataServiceClientBase {
   // registered with the dispatcher, this will register the worker. The
   // dispatcher will report which new tasks the worker should run, and which
   // tasks it should delete. This is stored into `new_tasks` and
-  // `tasks_to_delete`.
+  // `tasks_to_delete`. `element_cache_stats` is reported to the dispatcher if
+  // it is not null.
   Status WorkerHeartbeat(const std::string& worker_address,
                          const std::vector<int64>& current_tasks,
+                         const ElementCacheStats* element_cache_stats,
                          std::vector<TaskDef>& new_tasks,
                          std::vector<int64>& tasks_to_delete);
 
@@ -139,9 +153,10 @@ class DataServiceDispatcherClient : public DataServiceClientBase {
 // Client for communicating with the tf.data service worker.
 class DataServiceWorkerClient : public DataServiceClientBase {
  public:
-  DataServiceWorkerClient(const std::string& address,
-                          const std::string& protocol)
-      : DataServiceClientBase(address, protocol) {}
+  DataServiceWorkerClient(
+      const std::string& address, const std::string& protocol,
+      TransferCompression compression = TransferCompression::AUTO)
+      : DataServiceClientBase(address, protocol), compression_(compression) {}
 
   // Fetches the next element for the specified task_id. The element's
   // compressed tensors will be stored in `element`. If no element is available,
@@ -153,10 +168,27 @@ class DataServiceWorkerClient : public DataServiceClientBase {
   Status EnsureInitialized() override;
 
  private:
+  // Returns whether to ask the worker to compress the next element.
+  bool ShouldCompress() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Updates the transfer estimates with an element that took
+  // `transfer_micros` to transfer. `requested_compression` is whether the
+  // worker was asked to compress the element.
+  void RecordTransfer(const CompressedElement& element,
+                      bool requested_compression, int64 transfer_micros)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const TransferCompression compression_;
   mutex mu_;
   // Initialization is guarded by `mu_`, but using the stub does not require
   // holding `mu_`
   std::unique_ptr<WorkerService::Stub> stub_;
+  // Moving averages of the transfer rate from the worker in bytes per second,
+  // and of the ratio of compressed to uncompressed element sizes. Zero until
+  // the first measurement.
+  double bytes_per_second_ TF_GUARDED_BY(mu_) = 0;
+  double compression_ratio_ TF_GUARDED_BY(mu_) = 0;
+  // Number of elements received since the last compressed one.
+  int64 elements_since_compression_ TF_GUARDED_BY(mu_) = 0;
 };
 
 // Creates and initializes a new tf.data service dispatcher client.
@@ -167,7 +199,8 @@ Status CreateDataServiceDispatcherClient(
 // Creates and initializes a new tf.data service worker client.
 Status CreateDataServiceWorkerClient(
     const std::string& address, const std::string& protocol,
-    std::unique_ptr<DataServiceWorkerClient>& out);
+    std::unique_ptr<DataServiceWorkerClient>& out,
+    TransferCompression compression = TransferCompression::AUTO);
 
 }  // namespace data
 }  // namespace tensorflow
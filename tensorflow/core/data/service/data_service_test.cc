@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/data/service/data_service.h"
 
+#include <algorithm>
+#include <numeric>
+
 #include "grpcpp/create_channel.h"
 #include "grpcpp/security/credentials.h"
 #include "absl/strings/str_split.h"
@@ -27,18 +30,192 @@ limitations under the License.
 #include "tensorflow/core/data/service/test_util.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
 #include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/function_testlib.h"
 #include "tensorflow/core/kernels/data/dataset_test_base.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace data {
 
 namespace {
 constexpr const char kProtocol[] = "grpc+local";
+
+using test::function::GDef;
+using test::function::NDef;
+
+// Returns the graph of a dataset which repeats a float tensor of
+// `num_floats` elements forever, as prepared for the tf.data service, i.e.
+// `tf.data.Dataset.from_tensors(t).repeat().map(compress)`.
+GraphDef RepeatedTensorGraph(int64 num_floats) {
+  Tensor tensor(DT_FLOAT, TensorShape({num_floats}));
+  // Mildly compressible contents.
+  auto flat = tensor.flat<float>();
+  for (int64 i = 0; i < num_floats; ++i) {
+    flat(i) = i % 256;
+  }
+  FunctionDef compress = FunctionDefHelper::Create(
+      "Compress", {"x: float"}, {"y: variant"}, {},
+      {{{"c"},
+        "CompressElement",
+        {"x"},
+        {{"input_types", DataTypeSlice{DT_FLOAT}}}}},
+      {{"y", "c:compressed:0"}});
+  const std::vector<PartialTensorShape> tensor_shapes = {
+      PartialTensorShape({num_floats})};
+  const std::vector<PartialTensorShape> scalar_shapes = {
+      PartialTensorShape({})};
+  return GDef(
+      {NDef("tensor", "Const", {}, {{"dtype", DT_FLOAT}, {"value", tensor}}),
+       NDef("tensor_dataset", "TensorDataset", {"tensor"},
+            {{"Toutput_types", DataTypeSlice{DT_FLOAT}},
+             {"output_shapes", tensor_shapes}}),
+       NDef("count", "Const", {},
+            {{"dtype", DT_INT64}, {"value", test::AsScalar<int64>(-1)}}),
+       NDef("repeat", "RepeatDataset", {"tensor_dataset", "count"},
+            {{"output_types", DataTypeSlice{DT_FLOAT}},
+             {"output_shapes", tensor_shapes}}),
+       NDef("map", "MapDataset", {"repeat"},
+            {{"f", FunctionDefHelper::FunctionRef("Compress")},
+             {"Targuments", DataTypeSlice{}},
+             {"output_types", DataTypeSlice{DT_VARIANT}},
+             {"output_shapes", scalar_shapes},
+             {"use_inter_op_parallelism", true},
+             {"preserve_cardinality", false}}),
+       NDef("retval", "_Retval", {"map"}, {{"T", DT_VARIANT}, {"index", 0}})},
+      {compress});
+}
+
+// Returns the graph of `tf.data.Dataset.range(num_elements).map(compress)`,
+// optionally shuffled with `reshuffle_each_iteration=True` before the map. If
+// `add_noise` is true, the map adds a random integer to the elements before
+// compressing them.
+GraphDef RangeGraph(int64 num_elements, bool shuffle, bool add_noise = false) {
+  std::vector<FunctionDefHelper::Node> compress_nodes;
+  std::string compress_input = "x";
+  if (add_noise) {
+    compress_nodes = {
+        {{"shape"},
+         "Const",
+         {},
+         {{"dtype", DT_INT32}, {"value", test::AsTensor<int32>({})}}},
+        {{"minval"},
+         "Const",
+         {},
+         {{"dtype", DT_INT64}, {"value", test::AsScalar<int64>(0)}}},
+        {{"maxval"},
+         "Const",
+         {},
+         {{"dtype", DT_INT64}, {"value", test::AsScalar<int64>(1000)}}},
+        {{"noise"},
+         "RandomUniformInt",
+         {"shape:output:0", "minval:output:0", "maxval:output:0"},
+         {{"T", DT_INT32}, {"Tout", DT_INT64}}},
+        {{"sum"}, "AddV2", {"x", "noise:output:0"}, {{"T", DT_INT64}}}};
+    compress_input = "sum:z:0";
+  }
+  compress_nodes.push_back({{"c"},
+                            "CompressElement",
+                            {compress_input},
+                            {{"input_types", DataTypeSlice{DT_INT64}}}});
+  FunctionDef compress =
+      FunctionDefHelper::Create("Compress", {"x: int64"}, {"y: variant"}, {},
+                                compress_nodes, {{"y", "c:compressed:0"}});
+  const std::vector<PartialTensorShape> scalar_shapes = {
+      PartialTensorShape({})};
+  auto scalar = [](const std::string& name, int64 value) {
+    return NDef(name, "Const", {},
+                {{"dtype", DT_INT64}, {"value", test::AsScalar<int64>(value)}});
+  };
+  std::vector<NodeDef> nodes = {
+      scalar("start", 0), scalar("stop", num_elements), scalar("step", 1),
+      NDef("range", "RangeDataset", {"start", "stop", "step"},
+           {{"output_types", DataTypeSlice{DT_INT64}},
+            {"output_shapes", scalar_shapes}})};
+  std::string input = "range";
+  if (shuffle) {
+    nodes.push_back(scalar("buffer_size", num_elements));
+    nodes.push_back(scalar("seed", 0));
+    nodes.push_back(scalar("seed2", 0));
+    nodes.push_back(
+        NDef("shuffle", "ShuffleDataset",
+             {"range", "buffer_size", "seed", "seed2"},
+             {{"reshuffle_each_iteration", true},
+              {"output_types", DataTypeSlice{DT_INT64}},
+              {"output_shapes", scalar_shapes}}));
+    input = "shuffle";
+  }
+  nodes.push_back(NDef("map", "MapDataset", {input},
+                       {{"f", FunctionDefHelper::FunctionRef("Compress")},
+                        {"Targuments", DataTypeSlice{}},
+                        {"output_types", DataTypeSlice{DT_VARIANT}},
+                        {"output_shapes", scalar_shapes},
+                        {"use_inter_op_parallelism", true},
+                        {"preserve_cardinality", false}}));
+  nodes.push_back(
+      NDef("retval", "_Retval", {"map"}, {{"T", DT_VARIANT}, {"index", 0}}));
+  return GDef(nodes, {compress});
+}
+
+// Reads all elements of `task` and stores their int64 values in `values`.
+Status ReadTask(const TaskInfo& task, std::vector<int64>& values) {
+  DataServiceWorkerClient worker(task.worker_address(), kProtocol);
+  while (true) {
+    CompressedElement compressed;
+    bool end_of_sequence;
+    TF_RETURN_IF_ERROR(
+        worker.GetElement(task.task_id(), compressed, end_of_sequence));
+    if (end_of_sequence) {
+      return Status::OK();
+    }
+    std::vector<Tensor> components;
+    TF_RETURN_IF_ERROR(UncompressElement(compressed, &components));
+    values.push_back(components[0].scalar<int64>()());
+  }
+}
+
+// Returns the element cache stats of the only worker of `cluster`, as of its
+// last heartbeat.
+Status GetElementCacheStats(TestCluster& cluster, ElementCacheStats& stats) {
+  DataServiceDispatcherClient dispatcher(cluster.DispatcherAddress(),
+                                         kProtocol);
+  std::vector<WorkerInfo> workers;
+  TF_RETURN_IF_ERROR(dispatcher.GetWorkers(workers));
+  if (workers.size() != 1) {
+    return errors::Internal("Expected 1 worker, got ", workers.size());
+  }
+  stats = workers[0].element_cache_stats();
+  return Status::OK();
 }
 
+// Registers `graph_def` with the dispatcher of `cluster`, starts a job, and
+// stores its first task in `task`.
+Status StartJob(TestCluster& cluster, const GraphDef& graph_def,
+                TaskInfo& task) {
+  DataServiceDispatcherClient dispatcher(cluster.DispatcherAddress(),
+                                         kProtocol);
+  int64 dataset_id;
+  TF_RETURN_IF_ERROR(dispatcher.RegisterDataset(graph_def, dataset_id));
+  int64 job_client_id;
+  TF_RETURN_IF_ERROR(dispatcher.CreateJob(
+      dataset_id, ProcessingMode::PARALLEL_EPOCHS, job_client_id));
+  std::vector<TaskInfo> tasks;
+  bool job_finished;
+  while (tasks.empty()) {
+    TF_RETURN_IF_ERROR(dispatcher.GetTasks(job_client_id, tasks,
+                                           job_finished));
+    if (tasks.empty()) {
+      Env::Default()->SleepForMicroseconds(10 * 1000);
+    }
+  }
+  task = tasks[0];
+  return Status::OK();
+}
+}  // namespace
+
 TEST(DataService, ParseParallelEpochsProcessingMode) {
   ProcessingMode mode;
   TF_ASSERT_OK(ParseProcessingMode("parallel_epochs", mode));
@@ -74,5 +251,174 @@ TEST(DataService, GetWorkers) {
   EXPECT_EQ(1, workers.size());
 }
 
+class TransferCompressionTest
+    : public ::testing::TestWithParam<TransferCompression> {};
+
+TEST_P(TransferCompressionTest, GetElement) {
+  constexpr int64 kNumFloats = 1000;
+  TestCluster cluster(1);
+  TF_ASSERT_OK(cluster.Initialize());
+  TaskInfo task;
+  TF_ASSERT_OK(StartJob(cluster, RepeatedTensorGraph(kNumFloats), task));
+  DataServiceWorkerClient worker(task.worker_address(), kProtocol, GetParam());
+  for (int i = 0; i < 3; ++i) {
+    CompressedElement compressed;
+    bool end_of_sequence;
+    TF_ASSERT_OK(worker.GetElement(task.task_id(), compressed,
+                                   end_of_sequence));
+    ASSERT_FALSE(end_of_sequence);
+    if (GetParam() == TransferCompression::NEVER) {
+      EXPECT_EQ(compressed.compression(), CompressedElement::UNCOMPRESSED);
+    }
+    if (GetParam() == TransferCompression::ALWAYS) {
+      EXPECT_EQ(compressed.compression(), CompressedElement::SNAPPY);
+    }
+    std::vector<Tensor> components;
+    TF_ASSERT_OK(UncompressElement(compressed, &components));
+    ASSERT_EQ(components.size(), 1);
+    ASSERT_EQ(components[0].NumElements(), kNumFloats);
+    EXPECT_EQ(components[0].flat<float>()(kNumFloats - 1),
+              (kNumFloats - 1) % 256);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Compression, TransferCompressionTest,
+                         ::testing::Values(TransferCompression::AUTO,
+                                           TransferCompression::ALWAYS,
+                                           TransferCompression::NEVER));
+
+constexpr int64 kHeartbeatIntervalMs = 10;
+
+experimental::WorkerConfig ElementCacheWorkerConfig(int64 memory_bytes) {
+  experimental::WorkerConfig config;
+  config.set_heartbeat_interval_ms(kHeartbeatIntervalMs);
+  config.set_element_cache_memory_bytes(memory_bytes);
+  return config;
+}
+
+TEST(DataService, ElementCacheResumesAfterPrefix) {
+  constexpr int64 kNumElements = 20;
+  // Only a prefix of the dataset fits in the cache, so the second job reads
+  // the prefix from the cache and resumes from its checkpoint.
+  TestCluster cluster(1, ElementCacheWorkerConfig(/*memory_bytes=*/256));
+  TF_ASSERT_OK(cluster.Initialize());
+  std::vector<int64> expected(kNumElements);
+  std::iota(expected.begin(), expected.end(), 0);
+  for (int job = 0; job < 2; ++job) {
+    TaskInfo task;
+    TF_ASSERT_OK(StartJob(cluster, RangeGraph(kNumElements, false), task));
+    std::vector<int64> values;
+    TF_ASSERT_OK(ReadTask(task, values));
+    EXPECT_EQ(values, expected);
+  }
+
+  ElementCacheStats stats;
+  do {
+    Env::Default()->SleepForMicroseconds(kHeartbeatIntervalMs * 1000);
+    TF_ASSERT_OK(GetElementCacheStats(cluster, stats));
+  } while (stats.hits() == 0);
+  EXPECT_LT(stats.hits(), kNumElements);
+  EXPECT_GT(stats.memory_bytes(), 0);
+}
+
+TEST(DataService, ElementCacheBypassesReshuffledDatasets) {
+  constexpr int64 kNumElements = 20;
+  TestCluster cluster(1, ElementCacheWorkerConfig(/*memory_bytes=*/1 << 20));
+  TF_ASSERT_OK(cluster.Initialize());
+  for (int job = 0; job < 2; ++job) {
+    TaskInfo task;
+    TF_ASSERT_OK(StartJob(cluster, RangeGraph(kNumElements, true), task));
+    std::vector<int64> values;
+    TF_ASSERT_OK(ReadTask(task, values));
+    std::sort(values.begin(), values.end());
+    std::vector<int64> expected(kNumElements);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(values, expected);
+  }
+
+  // Wait for a few heartbeats to report the stats after the jobs.
+  Env::Default()->SleepForMicroseconds(10 * kHeartbeatIntervalMs * 1000);
+  ElementCacheStats stats;
+  TF_ASSERT_OK(GetElementCacheStats(cluster, stats));
+  EXPECT_EQ(stats.hits(), 0);
+  EXPECT_EQ(stats.misses(), 0);
+  EXPECT_EQ(stats.memory_bytes(), 0);
+}
+
+TEST(DataService, ElementCacheBypassesRandomMaps) {
+  constexpr int64 kNumElements = 20;
+  TestCluster cluster(1, ElementCacheWorkerConfig(/*memory_bytes=*/1 << 20));
+  TF_ASSERT_OK(cluster.Initialize());
+  for (int job = 0; job < 2; ++job) {
+    TaskInfo task;
+    TF_ASSERT_OK(StartJob(
+        cluster, RangeGraph(kNumElements, false, /*add_noise=*/true), task));
+    std::vector<int64> values;
+    TF_ASSERT_OK(ReadTask(task, values));
+    EXPECT_EQ(static_cast<int64>(values.size()), kNumElements);
+  }
+
+  // Wait for a few heartbeats to report the stats after the jobs.
+  Env::Default()->SleepForMicroseconds(10 * kHeartbeatIntervalMs * 1000);
+  ElementCacheStats stats;
+  TF_ASSERT_OK(GetElementCacheStats(cluster, stats));
+  EXPECT_EQ(stats.hits(), 0);
+  EXPECT_EQ(stats.misses(), 0);
+  EXPECT_EQ(stats.memory_bytes(), 0);
+}
+
+// Measures fetching and decoding elements from a worker over the loopback
+// interface.
+void TransferBenchmarkLoop(::testing::benchmark::State& state,
+                           TransferCompression compression) {
+  const int64 num_floats = state.range(0);
+  TestCluster cluster(1);
+  TF_CHECK_OK(cluster.Initialize());
+  TaskInfo task;
+  TF_CHECK_OK(StartJob(cluster, RepeatedTensorGraph(num_floats), task));
+  DataServiceWorkerClient worker(task.worker_address(), kProtocol,
+                                 compression);
+  TF_CHECK_OK(worker.Initialize());
+
+  for (auto s : state) {
+    CompressedElement compressed;
+    bool end_of_sequence;
+    TF_CHECK_OK(worker.GetElement(task.task_id(), compressed,
+                                  end_of_sequence));
+    std::vector<Tensor> components;
+    TF_CHECK_OK(UncompressElement(compressed, &components));
+  }
+  state.SetBytesProcessed(static_cast<int64>(state.iterations()) *
+                          num_floats * sizeof(float));
+}
+
+static void BM_TransferAlwaysCompress(::testing::benchmark::State& state) {
+  TransferBenchmarkLoop(state, TransferCompression::ALWAYS);
+}
+
+static void BM_TransferNeverCompress(::testing::benchmark::State& state) {
+  TransferBenchmarkLoop(state, TransferCompression::NEVER);
+}
+
+static void BM_TransferAutoCompress(::testing::benchmark::State& state) {
+  TransferBenchmarkLoop(state, TransferCompression::AUTO);
+}
+
+BENCHMARK(BM_TransferAlwaysCompress)
+    ->UseRealTime()
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20);
+BENCHMARK(BM_TransferNeverCompress)
+    ->UseRealTime()
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20);
+BENCHMARK(BM_TransferAutoCompress)
+    ->UseRealTime()
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20);
+
 }  // namespace data
 }  // namespace tensorflow
@@ -221,6 +221,9 @@ Status DataServiceDispatcherImpl::WorkerHeartbeat(
     TF_RETURN_IF_ERROR(CreateTasksForWorker(worker_address));
     TF_RETURN_IF_ERROR(state_.TasksForWorker(worker_address, correct_tasks));
   }
+  if (request->has_element_cache_stats()) {
+    element_cache_stats_[worker_address] = request->element_cache_stats();
+  }
 
   absl::flat_hash_set<int64> current_tasks;
   current_tasks.insert(request->current_tasks().cbegin(),
@@ -247,6 +250,7 @@ Status DataServiceDispatcherImpl::WorkerHeartbeat(
       task_def->set_path(path);
     }
     task_def->set_dataset_id(task->dataset_id);
+    task_def->set_dataset_fingerprint(dataset->fingerprint);
     task_def->set_job_id(task->job_id);
     task_def->set_task_id(task->task_id);
     task_def->set_processing_mode(ProcessingModeDef(task->processing_mode));
@@ -639,6 +643,7 @@ Status DataServiceDispatcherImpl::AssignTask(std::shared_ptr<const Task> task)
     mutex_lock l(mu_);
     std::shared_ptr<const Dataset> dataset;
     TF_RETURN_IF_ERROR(state_.DatasetFromId(task->dataset_id, dataset));
+    task_def->set_dataset_fingerprint(dataset->fingerprint);
     std::string dataset_key =
         DatasetKey(dataset->dataset_id, dataset->fingerprint);
     if (config_.work_dir().empty()) {
@@ -704,6 +709,10 @@ Status DataServiceDispatcherImpl::GetWorkers(const GetWorkersRequest* request,
   for (const auto& worker : workers) {
     WorkerInfo* info = response->add_workers();
     info->set_address(worker->address);
+    auto it = element_cache_stats_.find(worker->address);
+    if (it != element_cache_stats_.end()) {
+      *info->mutable_element_cache_stats() = it->second;
+    }
   }
   VLOG(3) << "Returning list of " << response->workers_size()
           << " workers from GetWorkers";
@@ -183,6 +183,11 @@ class DataServiceDispatcherImpl {
   absl::optional<std::unique_ptr<JournalWriter>> journal_writer_
       TF_GUARDED_BY(mu_);
   DispatcherState state_ TF_GUARDED_BY(mu_);
+  // Element cache statistics reported by the workers in their latest
+  // heartbeats, keyed by worker address. These are soft state which is not
+  // journaled, and are repopulated by the next heartbeats after a restart.
+  absl::flat_hash_map<std::string, ElementCacheStats> element_cache_stats_
+      TF_GUARDED_BY(mu_);
   // Condition variable for waking up the job gc thread.
   condition_variable job_gc_thread_cv_;
   std::unique_ptr<Thread> job_gc_thread_;
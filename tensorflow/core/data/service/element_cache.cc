@@ -0,0 +1,347 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/element_cache.h"
+
+#include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/strcat.h"
+
+namespace tensorflow {
+namespace data {
+
+ElementCache::ElementCache(Env* env, const Options& options)
+    : env_(env), options_(options) {
+  if (!options_.directory.empty()) {
+    Status s = env_->RecursivelyCreateDir(options_.directory);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to create element cache directory "
+                   << options_.directory << ": " << s;
+    }
+  }
+}
+
+ElementCache::~ElementCache() {
+  std::vector<std::string> file_names;
+  {
+    mutex_lock l(mu_);
+    for (const auto& it : datasets_) {
+      ClearDataset(it.first, it.second, &file_names);
+    }
+  }
+  DeleteFiles(file_names);
+}
+
+bool ElementCache::Lookup(int64 dataset_fingerprint, int64 element_index,
+                          CompressedElement* element) {
+  std::string file_name;
+  {
+    mutex_lock l(mu_);
+    DatasetEntry* entry = FindDataset(dataset_fingerprint);
+    if (entry != nullptr && element_index < entry->num_elements) {
+      TouchDataset(*entry);
+      const int64 num_memory_elements = entry->memory_elements.size();
+      if (element_index < num_memory_elements) {
+        if (element->ParseFromString(entry->memory_elements[element_index])) {
+          stats_.hits++;
+          return true;
+        }
+      } else {
+        file_name =
+            FileName(dataset_fingerprint, entry->generation, element_index);
+      }
+    }
+    if (file_name.empty()) {
+      stats_.misses++;
+      return false;
+    }
+  }
+  // The file is deleted concurrently if the dataset is evicted in the
+  // meantime, in which case the lookup is a miss.
+  std::string serialized;
+  Status s = ReadFileToString(env_, file_name, &serialized);
+  const bool hit = s.ok() && element->ParseFromString(serialized);
+  if (!hit) {
+    VLOG(1) << "Failed to read cached element " << file_name << ": " << s;
+  }
+  mutex_lock l(mu_);
+  if (hit) {
+    stats_.hits++;
+  } else {
+    stats_.misses++;
+  }
+  return hit;
+}
+
+bool ElementCache::IsEndOfSequence(int64 dataset_fingerprint,
+                                   int64 element_index) {
+  mutex_lock l(mu_);
+  DatasetEntry* entry = FindDataset(dataset_fingerprint);
+  return entry != nullptr && entry->complete &&
+         element_index >= entry->num_elements;
+}
+
+bool ElementCache::CanServe(int64 dataset_fingerprint) {
+  mutex_lock l(mu_);
+  DatasetEntry* entry = FindDataset(dataset_fingerprint);
+  return entry != nullptr && (entry->complete || entry->has_checkpoint);
+}
+
+ElementCache::InsertResult ElementCache::Insert(
+    int64 dataset_fingerprint, int64 element_index,
+    const CompressedElement& element) {
+  std::string serialized = element.SerializeAsString();
+  const int64 size = serialized.size();
+  const bool has_disk_tier = !options_.directory.empty();
+  // Files of evicted datasets are deleted once the lock is released.
+  std::vector<std::string> file_names;
+  auto delete_files =
+      gtl::MakeCleanup([this, &file_names]() { DeleteFiles(file_names); });
+  std::string file_name;
+  int64 generation;
+  bool close = false;
+  {
+    mutex_lock l(mu_);
+    if (disabled_datasets_.contains(dataset_fingerprint)) {
+      return InsertResult::kNotAdmitted;
+    }
+    DatasetEntry* entry = FindDataset(dataset_fingerprint);
+    if (entry == nullptr) {
+      if (element_index != 0) {
+        return InsertResult::kNotAdmitted;
+      }
+      entry = &AddDataset(dataset_fingerprint);
+    }
+    TouchDataset(*entry);
+    if (entry->closed || entry->complete || entry->insert_pending ||
+        element_index != entry->num_elements) {
+      return InsertResult::kNotAdmitted;
+    }
+    // Elements go to memory until the first one that doesn't fit, and to disk
+    // from then on. Other datasets are evicted when both tiers are full.
+    bool to_memory;
+    while (true) {
+      if (entry->disk_bytes == 0 &&
+          stats_.memory_bytes + size <= options_.memory_bytes) {
+        to_memory = true;
+        break;
+      }
+      if (has_disk_tier && stats_.disk_bytes + size <= options_.disk_bytes) {
+        to_memory = false;
+        break;
+      }
+      if (EvictOtherDataset(dataset_fingerprint, &file_names)) {
+        continue;
+      }
+      // The cache is full: this element is the last one of the prefix, so that
+      // the prefix ends where the caller's iterator is positioned.
+      close = true;
+      to_memory = entry->disk_bytes == 0 && size <= options_.memory_bytes;
+      if (!to_memory && !(has_disk_tier && size <= options_.disk_bytes)) {
+        // The element doesn't fit in the cache at all.
+        DisableDataset(dataset_fingerprint, &file_names);
+        return InsertResult::kNotAdmitted;
+      }
+      break;
+    }
+
+    if (to_memory) {
+      entry->memory_elements.push_back(std::move(serialized));
+      entry->memory_bytes += size;
+      stats_.memory_bytes += size;
+      entry->num_elements++;
+      if (close) {
+        entry->closed = true;
+        return InsertResult::kPrefixClosed;
+      }
+      return InsertResult::kAdmitted;
+    }
+    // Reserve the disk space of the element while it is written.
+    entry->insert_pending = true;
+    entry->disk_bytes += size;
+    stats_.disk_bytes += size;
+    generation = entry->generation;
+    file_name = FileName(dataset_fingerprint, generation, element_index);
+  }
+
+  Status s = WriteStringToFile(env_, file_name, serialized);
+  mutex_lock l(mu_);
+  DatasetEntry* entry = FindDataset(dataset_fingerprint);
+  if (entry == nullptr || entry->generation != generation) {
+    // The dataset was evicted or disabled during the write, which released
+    // the reserved space.
+    file_names.push_back(file_name);
+    return InsertResult::kNotAdmitted;
+  }
+  entry->insert_pending = false;
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to spill cached element to " << file_name << ": "
+                 << s;
+    file_names.push_back(file_name);
+    DisableDataset(dataset_fingerprint, &file_names);
+    return InsertResult::kNotAdmitted;
+  }
+  entry->num_elements++;
+  if (close) {
+    entry->closed = true;
+    return InsertResult::kPrefixClosed;
+  }
+  return InsertResult::kAdmitted;
+}
+
+void ElementCache::InsertEndOfSequence(int64 dataset_fingerprint,
+                                       int64 num_elements) {
+  mutex_lock l(mu_);
+  DatasetEntry* entry = FindDataset(dataset_fingerprint);
+  if (entry == nullptr || entry->num_elements != num_elements) {
+    return;
+  }
+  TouchDataset(*entry);
+  entry->complete = true;
+  entry->checkpoint.clear();
+  entry->has_checkpoint = false;
+}
+
+void ElementCache::InsertCheckpoint(int64 dataset_fingerprint,
+                                    int64 element_index,
+                                    std::vector<std::string> checkpoint) {
+  mutex_lock l(mu_);
+  DatasetEntry* entry = FindDataset(dataset_fingerprint);
+  if (entry == nullptr || !entry->closed || entry->complete ||
+      element_index != entry->num_elements) {
+    return;
+  }
+  TouchDataset(*entry);
+  entry->checkpoint = std::move(checkpoint);
+  entry->has_checkpoint = true;
+}
+
+bool ElementCache::LookupCheckpoint(int64 dataset_fingerprint,
+                                    int64* element_index,
+                                    std::vector<std::string>* checkpoint) {
+  mutex_lock l(mu_);
+  DatasetEntry* entry = FindDataset(dataset_fingerprint);
+  if (entry == nullptr || !entry->has_checkpoint) {
+    return false;
+  }
+  *element_index = entry->num_elements;
+  *checkpoint = entry->checkpoint;
+  return true;
+}
+
+void ElementCache::Disable(int64 dataset_fingerprint) {
+  std::vector<std::string> file_names;
+  {
+    mutex_lock l(mu_);
+    DisableDataset(dataset_fingerprint, &file_names);
+  }
+  DeleteFiles(file_names);
+}
+
+ElementCache::Stats ElementCache::GetStats() {
+  mutex_lock l(mu_);
+  return stats_;
+}
+
+ElementCache::DatasetEntry* ElementCache::FindDataset(
+    int64 dataset_fingerprint) {
+  auto it = datasets_.find(dataset_fingerprint);
+  return it == datasets_.end() ? nullptr : &it->second;
+}
+
+ElementCache::DatasetEntry& ElementCache::AddDataset(
+    int64 dataset_fingerprint) {
+  dataset_lru_.push_front(dataset_fingerprint);
+  DatasetEntry& entry = datasets_[dataset_fingerprint];
+  entry.lru_position = dataset_lru_.begin();
+  entry.generation = next_generation_++;
+  return entry;
+}
+
+void ElementCache::TouchDataset(DatasetEntry& entry) {
+  dataset_lru_.splice(dataset_lru_.begin(), dataset_lru_, entry.lru_position);
+}
+
+bool ElementCache::EvictOtherDataset(int64 dataset_fingerprint,
+                                     std::vector<std::string>* file_names) {
+  for (auto lru_it = dataset_lru_.rbegin(); lru_it != dataset_lru_.rend();
+       ++lru_it) {
+    const int64 fingerprint = *lru_it;
+    if (fingerprint == dataset_fingerprint) {
+      continue;
+    }
+    VLOG(2) << "Evicting dataset " << fingerprint << " from the element cache";
+    RemoveDataset(fingerprint, file_names);
+    return true;
+  }
+  return false;
+}
+
+void ElementCache::DisableDataset(int64 dataset_fingerprint,
+                                  std::vector<std::string>* file_names) {
+  if (datasets_.contains(dataset_fingerprint)) {
+    RemoveDataset(dataset_fingerprint, file_names);
+  }
+  if (!disabled_datasets_.insert(dataset_fingerprint).second) {
+    return;
+  }
+  disabled_order_.push_back(dataset_fingerprint);
+  if (static_cast<int64>(disabled_order_.size()) >
+      options_.max_disabled_datasets) {
+    disabled_datasets_.erase(disabled_order_.front());
+    disabled_order_.pop_front();
+  }
+}
+
+void ElementCache::RemoveDataset(int64 dataset_fingerprint,
+                                 std::vector<std::string>* file_names) {
+  auto it = datasets_.find(dataset_fingerprint);
+  ClearDataset(dataset_fingerprint, it->second, file_names);
+  dataset_lru_.erase(it->second.lru_position);
+  datasets_.erase(it);
+}
+
+void ElementCache::ClearDataset(int64 dataset_fingerprint,
+                                const DatasetEntry& entry,
+                                std::vector<std::string>* file_names) {
+  // The bytes reserved for an element being written are released as well,
+  // but its file is deleted by the writer.
+  for (int64 i = entry.memory_elements.size(); i < entry.num_elements; ++i) {
+    file_names->push_back(FileName(dataset_fingerprint, entry.generation, i));
+  }
+  stats_.memory_bytes -= entry.memory_bytes;
+  stats_.disk_bytes -= entry.disk_bytes;
+}
+
+void ElementCache::DeleteFiles(const std::vector<std::string>& file_names) {
+  for (const std::string& file_name : file_names) {
+    Status s = env_->DeleteFile(file_name);
+    if (!s.ok()) {
+      VLOG(1) << "Failed to delete cached element " << file_name << ": " << s;
+    }
+  }
+}
+
+std::string ElementCache::FileName(int64 dataset_fingerprint,
+                                   int64 generation,
+                                   int64 element_index) const {
+  return io::JoinPath(
+      options_.directory,
+      strings::StrCat(strings::Hex(dataset_fingerprint, strings::kZeroPad16),
+                      "_", generation, "_", element_index, ".element"));
+}
+
+}  // namespace data
+}  // namespace tensorflow
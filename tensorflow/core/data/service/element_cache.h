@@ -0,0 +1,229 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_ELEMENT_CACHE_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_ELEMENT_CACHE_H_
+
+#include <deque>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/data/dataset.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace data {
+
+// A cache of the elements produced by a tf.data service worker.
+//
+// Elements are keyed by the fingerprint of the dataset that produced them and
+// their index within the dataset, so repeated jobs and epochs over the same
+// dataset definition can be served without recomputing the elements.
+//
+// For every dataset, the cache keeps a prefix of its elements: elements are
+// only admitted in order, and once the cache is full the prefix is closed and
+// no further elements of the dataset are admitted. A pass over a dataset which
+// doesn't fit in the cache therefore doesn't evict the elements that the next
+// pass reads first, as it would in a least-recently-used cache: every pass
+// reads the prefix from the cache. The first elements of a prefix are kept in
+// memory, the following ones in a local directory if one is configured. Whole
+// datasets are evicted in least-recently-used order to make room for the
+// prefixes of other datasets.
+//
+// Along with a closed prefix, the cache keeps a checkpoint of an iterator
+// positioned right after it, so that readers can produce the following
+// elements without recomputing the prefix.
+//
+// ElementCache is thread-safe. Reads, writes and deletions of the disk tier
+// happen without holding the cache lock.
+class ElementCache {
+ public:
+  struct Options {
+    // Maximum number of bytes of serialized elements to keep in memory.
+    int64 memory_bytes = 0;
+    // Local directory for the elements which don't fit in memory. The empty
+    // string disables the disk tier.
+    std::string directory;
+    // Maximum number of bytes of serialized elements to keep in `directory`.
+    int64 disk_bytes = 0;
+    // Maximum number of disabled datasets to remember. The elements of the
+    // datasets disabled least recently are admitted again beyond this limit.
+    int64 max_disabled_datasets = 1024;
+  };
+
+  // Statistics about the cache.
+  struct Stats {
+    int64 hits = 0;
+    int64 misses = 0;
+    int64 memory_bytes = 0;
+    int64 disk_bytes = 0;
+  };
+
+  // The outcome of `Insert`.
+  enum class InsertResult {
+    // The element was not admitted.
+    kNotAdmitted,
+    // The element was appended to the prefix of its dataset.
+    kAdmitted,
+    // The element was appended to the prefix of its dataset and closed it. The
+    // caller should insert a checkpoint of its iterator with
+    // `InsertCheckpoint`.
+    kPrefixClosed,
+  };
+
+  ElementCache(Env* env, const Options& options);
+  ~ElementCache();
+  ElementCache(const ElementCache&) = delete;
+  ElementCache& operator=(const ElementCache&) = delete;
+
+  // Looks up the element at `element_index` of the dataset with the given
+  // fingerprint. Returns true and stores the element in `element` on a hit.
+  bool Lookup(int64 dataset_fingerprint, int64 element_index,
+              CompressedElement* element) TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns true if the dataset with the given fingerprint is known to end
+  // at or before `element_index`.
+  bool IsEndOfSequence(int64 dataset_fingerprint, int64 element_index)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns true if a reader of the dataset with the given fingerprint can
+  // read the elements of the cached prefix and then resume from the
+  // checkpoint, or if the whole dataset is cached.
+  bool CanServe(int64 dataset_fingerprint) TF_LOCKS_EXCLUDED(mu_);
+
+  // Inserts the element at `element_index` of the dataset with the given
+  // fingerprint. The element is only admitted if it extends the prefix of the
+  // dataset. The last element of a prefix may exceed the size limits of the
+  // cache by one element.
+  InsertResult Insert(int64 dataset_fingerprint, int64 element_index,
+                      const CompressedElement& element)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Records that the dataset with the given fingerprint has `num_elements`
+  // elements. If they are all cached, the dataset can be served entirely from
+  // the cache.
+  void InsertEndOfSequence(int64 dataset_fingerprint, int64 num_elements)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Inserts the checkpoint of an iterator of the dataset with the given
+  // fingerprint which will produce the element at `element_index` next.
+  // `checkpoint` holds the serialized `VariantTensorDataProto`s of the
+  // iterator state.
+  void InsertCheckpoint(int64 dataset_fingerprint, int64 element_index,
+                        std::vector<std::string> checkpoint)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Looks up the checkpoint of the dataset with the given fingerprint. Returns
+  // true and stores the checkpoint and the index of the element its iterator
+  // produces next on a hit.
+  bool LookupCheckpoint(int64 dataset_fingerprint, int64* element_index,
+                        std::vector<std::string>* checkpoint)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Drops the elements of the dataset with the given fingerprint and stops
+  // admitting new ones, e.g. because its iterators can't be checkpointed. Only
+  // the `max_disabled_datasets` most recently disabled datasets stay disabled.
+  void Disable(int64 dataset_fingerprint) TF_LOCKS_EXCLUDED(mu_);
+
+  Stats GetStats() TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  using DatasetLru = std::list<int64>;
+
+  struct DatasetEntry {
+    DatasetLru::iterator lru_position;
+    // Distinguishes the disk tier files of this entry from those of earlier
+    // entries of the same dataset, which may still be read or deleted.
+    int64 generation = 0;
+    // The first `memory_elements.size()` elements of the prefix are in
+    // memory, the remaining ones up to `num_elements` on disk.
+    std::vector<std::string> memory_elements;
+    int64 num_elements = 0;
+    int64 memory_bytes = 0;
+    int64 disk_bytes = 0;
+    // Whether no more elements are admitted.
+    bool closed = false;
+    // Whether the dataset has exactly `num_elements` elements.
+    bool complete = false;
+    // Whether element `num_elements` is being written to disk. Its bytes are
+    // already included in `disk_bytes`.
+    bool insert_pending = false;
+    // The checkpoint of an iterator which produces element `num_elements`
+    // next, if any.
+    std::vector<std::string> checkpoint;
+    bool has_checkpoint = false;
+  };
+
+  // Returns the entry for the dataset with the given fingerprint, or nullptr
+  // if there is none.
+  DatasetEntry* FindDataset(int64 dataset_fingerprint)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Creates the entry for the dataset with the given fingerprint.
+  DatasetEntry& AddDataset(int64 dataset_fingerprint)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Marks `entry` as the most recently used one.
+  void TouchDataset(DatasetEntry& entry) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Evicts the least recently used dataset other than `dataset_fingerprint`,
+  // and appends the files to delete to `file_names`. Returns false if there
+  // is none.
+  bool EvictOtherDataset(int64 dataset_fingerprint,
+                         std::vector<std::string>* file_names)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Removes the entry of the dataset with the given fingerprint, if any, and
+  // stops admitting its elements.
+  void DisableDataset(int64 dataset_fingerprint,
+                      std::vector<std::string>* file_names)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Removes the entry of the dataset with the given fingerprint.
+  void RemoveDataset(int64 dataset_fingerprint,
+                     std::vector<std::string>* file_names)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Releases the cached elements of `entry` and appends the files to delete to
+  // `file_names`.
+  void ClearDataset(int64 dataset_fingerprint, const DatasetEntry& entry,
+                    std::vector<std::string>* file_names)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Deletes disk tier files.
+  void DeleteFiles(const std::vector<std::string>& file_names)
+      TF_LOCKS_EXCLUDED(mu_);
+  // Returns the file name of the disk tier entry for an element.
+  std::string FileName(int64 dataset_fingerprint, int64 generation,
+                       int64 element_index) const;
+
+  Env* const env_;
+  const Options options_;
+
+  mutex mu_;
+  absl::flat_hash_map<int64, DatasetEntry> datasets_ TF_GUARDED_BY(mu_);
+  // Fingerprints of the cached datasets. Most recently used datasets are at
+  // the front.
+  DatasetLru dataset_lru_ TF_GUARDED_BY(mu_);
+  int64 next_generation_ TF_GUARDED_BY(mu_) = 0;
+  // Fingerprints of the datasets whose elements are not admitted, and the
+  // order in which they were disabled.
+  absl::flat_hash_set<int64> disabled_datasets_ TF_GUARDED_BY(mu_);
+  std::deque<int64> disabled_order_ TF_GUARDED_BY(mu_);
+  Stats stats_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_ELEMENT_CACHE_H_
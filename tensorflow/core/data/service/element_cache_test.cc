@@ -0,0 +1,278 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/element_cache.h"
+
+#include <memory>
+
+#include "tensorflow/core/data/dataset.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+
+namespace {
+constexpr int64 kFingerprint = 0x1234;
+constexpr int64 kElementSize = 100;
+
+std::string NewCacheDir() {
+  std::string dir = io::JoinPath(testing::TmpDir(), "element_cache");
+  if (Env::Default()->FileExists(dir).ok()) {
+    int64 undeleted_files;
+    int64 undeleted_dirs;
+    CHECK(Env::Default()
+              ->DeleteRecursively(dir, &undeleted_files, &undeleted_dirs)
+              .ok());
+  }
+  CHECK(Env::Default()->RecursivelyCreateDir(dir).ok());
+  return dir;
+}
+
+CompressedElement MakeElement(int64 index) {
+  CompressedElement element;
+  element.set_data(std::string(kElementSize, 'a' + index % 26));
+  return element;
+}
+
+int64 SerializedSize() { return MakeElement(0).SerializeAsString().size(); }
+}  // namespace
+
+TEST(ElementCacheTest, MemoryHitAndMiss) {
+  ElementCache::Options options;
+  options.memory_bytes = 10 * SerializedSize();
+  ElementCache cache(Env::Default(), options);
+  CompressedElement element;
+  EXPECT_FALSE(cache.Lookup(kFingerprint, 0, &element));
+  EXPECT_EQ(cache.Insert(kFingerprint, 0, MakeElement(0)),
+            ElementCache::InsertResult::kAdmitted);
+  ASSERT_TRUE(cache.Lookup(kFingerprint, 0, &element));
+  EXPECT_EQ(element.data(), MakeElement(0).data());
+  EXPECT_FALSE(cache.Lookup(kFingerprint + 1, 0, &element));
+  EXPECT_FALSE(cache.Lookup(kFingerprint, 1, &element));
+
+  ElementCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 3);
+  EXPECT_EQ(stats.memory_bytes, SerializedSize());
+  EXPECT_EQ(stats.disk_bytes, 0);
+}
+
+TEST(ElementCacheTest, AdmitPrefixOnly) {
+  ElementCache::Options options;
+  options.memory_bytes = 10 * SerializedSize();
+  ElementCache cache(Env::Default(), options);
+  EXPECT_EQ(cache.Insert(kFingerprint, 1, MakeElement(1)),
+            ElementCache::InsertResult::kNotAdmitted);
+  EXPECT_EQ(cache.Insert(kFingerprint, 0, MakeElement(0)),
+            ElementCache::InsertResult::kAdmitted);
+  EXPECT_EQ(cache.Insert(kFingerprint, 0, MakeElement(0)),
+            ElementCache::InsertResult::kNotAdmitted);
+  CompressedElement element;
+  EXPECT_FALSE(cache.Lookup(kFingerprint, 1, &element));
+  EXPECT_EQ(cache.GetStats().memory_bytes, SerializedSize());
+}
+
+TEST(ElementCacheTest, ClosePrefixWhenFull) {
+  ElementCache::Options options;
+  options.memory_bytes = 2 * SerializedSize();
+  ElementCache cache(Env::Default(), options);
+  EXPECT_EQ(cache.Insert(kFingerprint, 0, MakeElement(0)),
+            ElementCache::InsertResult::kAdmitted);
+  EXPECT_EQ(cache.Insert(kFingerprint, 1, MakeElement(1)),
+            ElementCache::InsertResult::kAdmitted);
+  // The prefix ends with the element which doesn't fit, and later elements of
+  // the scan don't evict it.
+  EXPECT_EQ(cache.Insert(kFingerprint, 2, MakeElement(2)),
+            ElementCache::InsertResult::kPrefixClosed);
+  EXPECT_EQ(cache.Insert(kFingerprint, 3, MakeElement(3)),
+            ElementCache::InsertResult::kNotAdmitted);
+  EXPECT_FALSE(cache.CanServe(kFingerprint));
+
+  cache.InsertCheckpoint(kFingerprint, 3, {"checkpoint"});
+  EXPECT_TRUE(cache.CanServe(kFingerprint));
+  int64 index;
+  std::vector<std::string> checkpoint;
+  ASSERT_TRUE(cache.LookupCheckpoint(kFingerprint, &index, &checkpoint));
+  EXPECT_EQ(index, 3);
+  EXPECT_EQ(checkpoint, std::vector<std::string>({"checkpoint"}));
+
+  CompressedElement element;
+  for (int64 i = 0; i < 3; ++i) {
+    ASSERT_TRUE(cache.Lookup(kFingerprint, i, &element));
+    EXPECT_EQ(element.data(), MakeElement(i).data());
+  }
+  EXPECT_FALSE(cache.Lookup(kFingerprint, 3, &element));
+}
+
+TEST(ElementCacheTest, IgnoreCheckpointOfOpenPrefix) {
+  ElementCache::Options options;
+  options.memory_bytes = 10 * SerializedSize();
+  ElementCache cache(Env::Default(), options);
+  cache.Insert(kFingerprint, 0, MakeElement(0));
+  cache.InsertCheckpoint(kFingerprint, 1, {"checkpoint"});
+  EXPECT_FALSE(cache.CanServe(kFingerprint));
+  int64 index;
+  std::vector<std::string> checkpoint;
+  EXPECT_FALSE(cache.LookupCheckpoint(kFingerprint, &index, &checkpoint));
+}
+
+TEST(ElementCacheTest, EvictLeastRecentlyUsedDataset) {
+  ElementCache::Options options;
+  options.memory_bytes = 4 * SerializedSize();
+  ElementCache cache(Env::Default(), options);
+  for (int64 fingerprint = 0; fingerprint < 2; ++fingerprint) {
+    for (int64 i = 0; i < 2; ++i) {
+      cache.Insert(fingerprint, i, MakeElement(i));
+    }
+  }
+  CompressedElement element;
+  // Touch dataset 0 so that dataset 1 is evicted next.
+  ASSERT_TRUE(cache.Lookup(0, 0, &element));
+  EXPECT_EQ(cache.Insert(2, 0, MakeElement(0)),
+            ElementCache::InsertResult::kAdmitted);
+  EXPECT_TRUE(cache.Lookup(0, 1, &element));
+  EXPECT_FALSE(cache.Lookup(1, 0, &element));
+  EXPECT_TRUE(cache.Lookup(2, 0, &element));
+  EXPECT_EQ(cache.GetStats().memory_bytes, 3 * SerializedSize());
+}
+
+TEST(ElementCacheTest, SpillToDisk) {
+  ElementCache::Options options;
+  options.memory_bytes = SerializedSize();
+  options.directory = NewCacheDir();
+  options.disk_bytes = 2 * SerializedSize();
+  ElementCache cache(Env::Default(), options);
+  for (int64 i = 0; i < 3; ++i) {
+    EXPECT_EQ(cache.Insert(kFingerprint, i, MakeElement(i)),
+              ElementCache::InsertResult::kAdmitted);
+  }
+  EXPECT_EQ(cache.Insert(kFingerprint, 3, MakeElement(3)),
+            ElementCache::InsertResult::kPrefixClosed);
+  ElementCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.memory_bytes, SerializedSize());
+  EXPECT_EQ(stats.disk_bytes, 3 * SerializedSize());
+
+  CompressedElement element;
+  for (int64 i = 0; i < 4; ++i) {
+    ASSERT_TRUE(cache.Lookup(kFingerprint, i, &element));
+    EXPECT_EQ(element.data(), MakeElement(i).data());
+  }
+}
+
+TEST(ElementCacheTest, EndOfSequence) {
+  ElementCache::Options options;
+  options.memory_bytes = 10 * SerializedSize();
+  ElementCache cache(Env::Default(), options);
+  EXPECT_FALSE(cache.IsEndOfSequence(kFingerprint, 3));
+  // Only a fully cached dataset can be served without an iterator.
+  cache.InsertEndOfSequence(kFingerprint, 3);
+  EXPECT_FALSE(cache.IsEndOfSequence(kFingerprint, 3));
+  EXPECT_FALSE(cache.CanServe(kFingerprint));
+
+  for (int64 i = 0; i < 3; ++i) {
+    cache.Insert(kFingerprint, i, MakeElement(i));
+  }
+  cache.InsertEndOfSequence(kFingerprint, 3);
+  EXPECT_TRUE(cache.CanServe(kFingerprint));
+  EXPECT_FALSE(cache.IsEndOfSequence(kFingerprint, 2));
+  EXPECT_TRUE(cache.IsEndOfSequence(kFingerprint, 3));
+  EXPECT_FALSE(cache.IsEndOfSequence(kFingerprint + 1, 3));
+}
+
+TEST(ElementCacheTest, Disable) {
+  ElementCache::Options options;
+  options.memory_bytes = 10 * SerializedSize();
+  ElementCache cache(Env::Default(), options);
+  cache.Insert(kFingerprint, 0, MakeElement(0));
+  cache.Disable(kFingerprint);
+  EXPECT_EQ(cache.GetStats().memory_bytes, 0);
+  EXPECT_EQ(cache.Insert(kFingerprint, 1, MakeElement(1)),
+            ElementCache::InsertResult::kNotAdmitted);
+  CompressedElement element;
+  EXPECT_FALSE(cache.Lookup(kFingerprint, 0, &element));
+  EXPECT_FALSE(cache.CanServe(kFingerprint));
+}
+
+TEST(ElementCacheTest, ForgetLeastRecentlyDisabledDatasets) {
+  ElementCache::Options options;
+  options.memory_bytes = 10 * SerializedSize();
+  options.max_disabled_datasets = 2;
+  ElementCache cache(Env::Default(), options);
+  for (int64 fingerprint = 0; fingerprint < 3; ++fingerprint) {
+    cache.Disable(fingerprint);
+  }
+  EXPECT_EQ(cache.Insert(0, 0, MakeElement(0)),
+            ElementCache::InsertResult::kAdmitted);
+  EXPECT_EQ(cache.Insert(1, 0, MakeElement(0)),
+            ElementCache::InsertResult::kNotAdmitted);
+  EXPECT_EQ(cache.Insert(2, 0, MakeElement(0)),
+            ElementCache::InsertResult::kNotAdmitted);
+}
+
+TEST(ElementCacheTest, DeleteFilesOfEvictedDataset) {
+  ElementCache::Options options;
+  options.directory = NewCacheDir();
+  options.disk_bytes = 2 * SerializedSize();
+  ElementCache cache(Env::Default(), options);
+  for (int64 fingerprint = 0; fingerprint < 2; ++fingerprint) {
+    for (int64 i = 0; i < 2; ++i) {
+      cache.Insert(fingerprint, i, MakeElement(i));
+    }
+  }
+  std::vector<std::string> children;
+  TF_ASSERT_OK(Env::Default()->GetChildren(options.directory, &children));
+  EXPECT_EQ(children.size(), 2);
+  CompressedElement element;
+  EXPECT_FALSE(cache.Lookup(0, 0, &element));
+  EXPECT_TRUE(cache.Lookup(1, 1, &element));
+}
+
+TEST(ElementCacheTest, ConcurrentInsertAndLookup) {
+  ElementCache::Options options;
+  options.memory_bytes = 2 * SerializedSize();
+  options.directory = NewCacheDir();
+  options.disk_bytes = 4 * SerializedSize();
+  ElementCache cache(Env::Default(), options);
+  constexpr int64 kNumDatasets = 4;
+  constexpr int64 kNumElements = 4;
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int64 fingerprint = 0; fingerprint < kNumDatasets; ++fingerprint) {
+    threads.emplace_back(Env::Default()->StartThread(
+        {}, "reader", [&cache, fingerprint]() {
+          for (int64 pass = 0; pass < 10; ++pass) {
+            for (int64 i = 0; i < kNumElements; ++i) {
+              // Datasets evict each other, so a lookup may miss at any time,
+              // but a hit must return the element of the right dataset.
+              const int64 index = fingerprint * kNumElements + i;
+              CompressedElement element;
+              if (cache.Lookup(fingerprint, i, &element)) {
+                EXPECT_EQ(element.data(), MakeElement(index).data());
+              } else {
+                cache.Insert(fingerprint, i, MakeElement(index));
+              }
+            }
+          }
+        }));
+  }
+  threads.clear();
+  ElementCache::Stats stats = cache.GetStats();
+  EXPECT_LE(stats.memory_bytes, options.memory_bytes + SerializedSize());
+  EXPECT_LE(stats.disk_bytes, options.disk_bytes + SerializedSize());
+}
+
+}  // namespace data
+}  // namespace tensorflow
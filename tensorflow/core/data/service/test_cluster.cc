@@ -40,6 +40,10 @@ Status AddressFromTarget(absl::string_view target, std::string* address) {
 
 TestCluster::TestCluster(int num_workers) : num_workers_(num_workers) {}
 
+TestCluster::TestCluster(int num_workers,
+                         const experimental::WorkerConfig& worker_config)
+    : num_workers_(num_workers), worker_config_(worker_config) {}
+
 Status TestCluster::Initialize() {
   if (initialized_) {
     return errors::FailedPrecondition(
@@ -62,7 +66,7 @@ Status TestCluster::Initialize() {
 
 Status TestCluster::AddWorker() {
   std::unique_ptr<WorkerGrpcDataServer> worker;
-  experimental::WorkerConfig config;
+  experimental::WorkerConfig config = worker_config_;
   config.set_port(0);
   config.set_protocol(kProtocol);
   config.set_dispatcher_address(dispatcher_address_);
@@ -17,8 +17,10 @@ limitations under the License.
 
 #include "grpcpp/create_channel.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/match.h"
 #include "tensorflow/c/c_api_internal.h"
 #include "tensorflow/c/tf_status_helper.h"
+#include "tensorflow/core/data/compression_utils.h"
 #include "tensorflow/core/data/dataset.pb.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/credentials_factory.h"
@@ -30,9 +32,12 @@ limitations under the License.
 #include "tensorflow/core/data/service/utils.h"
 #include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/variant_tensor_data.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/io/zlib_outputbuffer.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/platform/env_time.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/platform/snappy.h"
@@ -48,12 +53,78 @@ auto* tf_data_service_created =
     monitoring::Gauge<bool, 0>::New("/tensorflow/data/service/created",
                                     "Whether a tf.data service server "
                                     "has been created.");
+
+// Returns whether the dataset graph shuffles its elements differently in each
+// iteration, in which case its elements can't be cached by index.
+bool ReshufflesEachIteration(const GraphDef& graph) {
+  auto reshuffles = [](const NodeDef& node) {
+    if (!absl::StartsWith(node.op(), "Shuffle")) {
+      return false;
+    }
+    auto it = node.attr().find("reshuffle_each_iteration");
+    return it == node.attr().end() || it->second.b();
+  };
+  for (const NodeDef& node : graph.node()) {
+    if (reshuffles(node)) {
+      return true;
+    }
+  }
+  for (const FunctionDef& function : graph.library().function()) {
+    for (const NodeDef& node : function.node_def()) {
+      if (reshuffles(node)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Returns the compressed element of `outputs`, which must hold a single scalar
+// variant tensor.
+Status GetCompressedElement(std::vector<Tensor>& outputs,
+                            CompressedElement*& element) {
+  if (outputs.size() != 1) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a single scalar variant tensor, but the "
+        "dataset produced ",
+        outputs.size(), " outputs");
+  }
+  if (outputs[0].dtype() != DT_VARIANT) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a single scalar variant tensor, but "
+        "the dataset produced a tensor with type ",
+        DataTypeString(outputs[0].dtype()));
+  }
+  if (!TensorShapeUtils::IsScalar(outputs[0].shape())) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a single scalar variant tensor, but "
+        "the dataset produced a tensor with shape ",
+        outputs[0].shape());
+  }
+  Variant& variant = outputs[0].scalar<Variant>()();
+  element = variant.get<CompressedElement>();
+  if (element == nullptr) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a CompressedElement variant tensor, but "
+        "it produced ",
+        variant.TypeName());
+  }
+  return Status::OK();
+}
 }  // namespace
 
 DataServiceWorkerImpl::DataServiceWorkerImpl(
     const experimental::WorkerConfig& config)
     : config_(config) {
   tf_data_service_created->GetCell()->Set(true);
+  if (config_.element_cache_memory_bytes() > 0 ||
+      !config_.element_cache_dir().empty()) {
+    ElementCache::Options options;
+    options.memory_bytes = config_.element_cache_memory_bytes();
+    options.directory = config_.element_cache_dir();
+    options.disk_bytes = config_.element_cache_disk_bytes();
+    element_cache_ = absl::make_unique<ElementCache>(Env::Default(), options);
+  }
 }
 
 DataServiceWorkerImpl::~DataServiceWorkerImpl() {
@@ -124,13 +195,13 @@ Status DataServiceWorkerImpl::EnsureTaskInitialized(
   }
   standalone::Dataset::Params params;
 
+  DatasetDef def;
+  const GraphDef* graph = nullptr;
   switch (task.task_def.dataset_case()) {
     case TaskDef::kDatasetDef:
-      TF_RETURN_IF_ERROR(standalone::Dataset::FromGraph(
-          params, task.task_def.dataset_def().graph(), &task.dataset));
+      graph = &task.task_def.dataset_def().graph();
       break;
     case TaskDef::kPath: {
-      DatasetDef def;
       Status s = ReadDatasetDef(task.task_def.path(), def);
       if (!s.ok()) {
         LOG(INFO) << "Failed to read dataset from " << task.task_def.path()
@@ -138,14 +209,46 @@ Status DataServiceWorkerImpl::EnsureTaskInitialized(
         TF_RETURN_IF_ERROR(
             dispatcher_->GetDatasetDef(task.task_def.dataset_id(), def));
       }
-      TF_RETURN_IF_ERROR(
-          standalone::Dataset::FromGraph(params, def.graph(), &task.dataset));
+      graph = &def.graph();
       break;
     }
     case TaskDef::DATASET_NOT_SET:
       return errors::Internal("Unrecognized dataset case: ",
                               task.task_def.dataset_case());
   }
+  TF_RETURN_IF_ERROR(
+      standalone::Dataset::FromGraph(params, *graph, &task.dataset));
+  task.use_element_cache = UseElementCache(task, *graph);
+  // Tasks which use the element cache create their iterator on the first
+  // cache miss.
+  if (!task.use_element_cache) {
+    TF_RETURN_IF_ERROR(MakeTaskIterator(task));
+  }
+  task.initialized = true;
+  return Status::OK();
+}
+
+bool DataServiceWorkerImpl::UseElementCache(const Task& task,
+                                            const GraphDef& graph) const {
+  // Splits of DISTRIBUTED_EPOCH tasks differ from task to task, so only
+  // PARALLEL_EPOCHS tasks produce the same elements at the same indices.
+  if (element_cache_ == nullptr ||
+      task.task_def.processing_mode() != PARALLEL_EPOCHS ||
+      ReshufflesEachIteration(graph)) {
+    return false;
+  }
+  // Input pipelines with external state, e.g. random ops in a map function,
+  // may produce different elements in each iteration.
+  Status s = task.dataset->CheckExternalState();
+  if (!s.ok()) {
+    VLOG(1) << "Not caching elements of task " << task.task_def.task_id()
+            << " because its dataset has external state: " << s;
+    return false;
+  }
+  return true;
+}
+
+Status DataServiceWorkerImpl::MakeTaskIterator(Task& task) {
   switch (task.task_def.processing_mode()) {
     case DISTRIBUTED_EPOCH: {
       auto split_provider = absl::make_unique<DataServiceSplitProvider>(
@@ -155,23 +258,117 @@ Status DataServiceWorkerImpl::EnsureTaskInitialized(
                                                     &task.iterator));
       break;
     }
-    case PARALLEL_EPOCHS:
+    case PARALLEL_EPOCHS: {
+      const int64 dataset_fingerprint = task.task_def.dataset_fingerprint();
+      int64 checkpoint_index;
+      std::vector<std::string> checkpoint;
+      if (task.use_element_cache && task.next_element_index > 0 &&
+          element_cache_->LookupCheckpoint(dataset_fingerprint,
+                                           &checkpoint_index, &checkpoint) &&
+          checkpoint_index <= task.next_element_index) {
+        std::vector<VariantTensorData> data(checkpoint.size());
+        std::vector<const VariantTensorData*> data_ptrs;
+        bool parsed = true;
+        for (int64 i = 0; i < static_cast<int64>(checkpoint.size()); ++i) {
+          VariantTensorDataProto proto;
+          parsed = parsed && proto.ParseFromString(checkpoint[i]) &&
+                   data[i].FromProto(std::move(proto));
+          data_ptrs.push_back(&data[i]);
+        }
+        VariantTensorDataReader reader(data_ptrs);
+        Status s = parsed ? task.dataset->MakeIteratorFromCheckpoint(
+                                &reader, &task.iterator)
+                          : errors::DataLoss("Failed to parse checkpoint");
+        if (s.ok()) {
+          task.iterator_position = checkpoint_index;
+          VLOG(3) << "Restored iterator for task " << task.task_def.task_id()
+                  << " at element " << checkpoint_index;
+          return Status::OK();
+        }
+        LOG(WARNING) << "Failed to restore iterator for task "
+                     << task.task_def.task_id()
+                     << " from the element cache: " << s;
+      }
       TF_RETURN_IF_ERROR(task.dataset->MakeIterator(&task.iterator));
+      task.iterator_position = 0;
       break;
+    }
     default:
       return errors::InvalidArgument("Unrecognized processing mode: ",
                                      task.task_def.processing_mode());
   }
-  task.initialized = true;
   VLOG(3) << "Created iterator for task " << task.task_def.task_id();
   return Status::OK();
 }
 
+Status DataServiceWorkerImpl::GetNextFromIterator(Task& task,
+                                                  std::vector<Tensor>& outputs,
+                                                  bool& end_of_sequence) {
+  if (!task.iterator) {
+    TF_RETURN_IF_ERROR(MakeTaskIterator(task));
+  }
+  if (task.iterator_position < task.next_element_index) {
+    // The cached prefix of the dataset was evicted while the task was reading
+    // it, so the iterator has to recompute the elements served from it.
+    VLOG(1) << "Fast-forwarding iterator of task " << task.task_def.task_id()
+            << " from element " << task.iterator_position << " to element "
+            << task.next_element_index;
+  }
+  while (task.iterator_position < task.next_element_index) {
+    outputs.clear();
+    TF_RETURN_IF_ERROR(task.iterator->GetNext(&outputs, &end_of_sequence));
+    if (end_of_sequence) {
+      return Status::OK();
+    }
+    task.iterator_position++;
+  }
+  outputs.clear();
+  TF_RETURN_IF_ERROR(task.iterator->GetNext(&outputs, &end_of_sequence));
+  if (!end_of_sequence) {
+    task.iterator_position++;
+  }
+  return Status::OK();
+}
+
+void DataServiceWorkerImpl::InsertIntoElementCache(
+    Task& task, const CompressedElement& element) {
+  const int64 dataset_fingerprint = task.task_def.dataset_fingerprint();
+  const int64 element_index = task.next_element_index;
+  if (element_cache_->Insert(dataset_fingerprint, element_index, element) !=
+      ElementCache::InsertResult::kPrefixClosed) {
+    return;
+  }
+  // Later readers of the dataset resume from the end of the cached prefix,
+  // which is where the task iterator is now.
+  VariantTensorDataWriter writer;
+  Status s = task.iterator->Save(&writer);
+  if (!s.ok()) {
+    VLOG(1) << "Not caching elements of dataset " << dataset_fingerprint
+            << " because its iterator can't be saved: " << s;
+    element_cache_->Disable(dataset_fingerprint);
+    return;
+  }
+  std::vector<std::unique_ptr<VariantTensorData>> data;
+  writer.ReleaseData(&data);
+  std::vector<std::string> checkpoint;
+  checkpoint.reserve(data.size());
+  for (const auto& d : data) {
+    VariantTensorDataProto proto;
+    d->ToProto(&proto);
+    checkpoint.push_back(proto.SerializeAsString());
+  }
+  element_cache_->InsertCheckpoint(dataset_fingerprint, element_index + 1,
+                                   std::move(checkpoint));
+}
+
 Status DataServiceWorkerImpl::GetElement(const GetElementRequest* request,
                                          GetElementResponse* response) {
   VLOG(3) << "Received GetElement request for task " << request->task_id();
+  const int64 start_micros = EnvTime::NowMicros();
   bool end_of_sequence = false;
   std::vector<tensorflow::Tensor> outputs;
+  CompressedElement* compressed = nullptr;
+  bool cache_hit = false;
   {
     mutex_lock l(mu_);
     if (!registered_) {
@@ -188,8 +385,38 @@ Status DataServiceWorkerImpl::GetElement(const GetElementRequest* request,
     }
     auto& task = it->second;
     TF_RETURN_IF_ERROR(EnsureTaskInitialized(*task));
-    TF_RETURN_IF_ERROR(task->iterator->GetNext(&outputs, &end_of_sequence));
-    if (end_of_sequence) {
+    const int64 dataset_fingerprint = task->task_def.dataset_fingerprint();
+    const int64 element_index = task->next_element_index;
+    // Tasks read the cached prefix of the dataset until their first miss, and
+    // then produce the remaining elements with their iterator.
+    if (task->use_element_cache && !task->iterator &&
+        (element_index > 0 || element_cache_->CanServe(dataset_fingerprint))) {
+      if (element_cache_->IsEndOfSequence(dataset_fingerprint,
+                                          element_index)) {
+        end_of_sequence = true;
+      } else if (element_cache_->Lookup(
+                     dataset_fingerprint, element_index,
+                     response->mutable_compressed_element())) {
+        VLOG(3) << "Serving element " << element_index << " of task "
+                << request->task_id() << " from the element cache";
+        cache_hit = true;
+      }
+    }
+    if (!end_of_sequence && !cache_hit) {
+      TF_RETURN_IF_ERROR(GetNextFromIterator(*task, outputs, end_of_sequence));
+      if (!end_of_sequence) {
+        TF_RETURN_IF_ERROR(GetCompressedElement(outputs, compressed));
+        if (task->use_element_cache) {
+          InsertIntoElementCache(*task, *compressed);
+        }
+      } else if (task->use_element_cache) {
+        element_cache_->InsertEndOfSequence(dataset_fingerprint,
+                                            element_index);
+      }
+    }
+    if (!end_of_sequence) {
+      task->next_element_index++;
+    } else {
       VLOG(3) << "Reached end_of_sequence for task " << request->task_id();
       task->finished = true;
       pending_completed_tasks_.insert(request->task_id());
@@ -197,37 +424,16 @@ Status DataServiceWorkerImpl::GetElement(const GetElementRequest* request,
     }
   }
 
-  if (!end_of_sequence) {
+  if (!end_of_sequence && !cache_hit) {
     VLOG(3) << "Producing an element for task " << request->task_id();
-    if (outputs.size() != 1) {
-      return errors::FailedPrecondition(
-          "Expected dataset to produce a single scalar variant tensor, but the "
-          "dataset produced ",
-          outputs.size(), " outputs");
-    }
-    if (outputs[0].dtype() != DT_VARIANT) {
-      return errors::FailedPrecondition(
-          "Expected dataset to produce a single scalar variant tensor, but "
-          "the dataset produced a tensor with type ",
-          DataTypeString(outputs[0].dtype()));
-    }
-    if (!TensorShapeUtils::IsScalar(outputs[0].shape())) {
-      return errors::FailedPrecondition(
-          "Expected dataset to produce a single scalar variant tensor, but "
-          "the dataset produced a tensor with shape ",
-          outputs[0].shape());
-    }
-    Variant& variant = outputs[0].scalar<Variant>()();
-    CompressedElement* compressed = variant.get<CompressedElement>();
-    if (compressed == nullptr) {
-      return errors::FailedPrecondition(
-          "Expected dataset to produce a CompressedElement variant tensor, but "
-          "it produced ",
-          variant.TypeName());
-    }
     compressed->Swap(response->mutable_compressed_element());
   }
+  if (!end_of_sequence && !request->skip_compression()) {
+    TF_RETURN_IF_ERROR(
+        CompressPackedElement(response->mutable_compressed_element()));
+  }
   response->set_end_of_sequence(end_of_sequence);
+  response->set_processing_time_micros(EnvTime::NowMicros() - start_micros);
 
   return Status::OK();
 }
@@ -329,10 +535,20 @@ Status DataServiceWorkerImpl::Heartbeat() TF_LOCKS_EXCLUDED(mu_) {
       current_tasks.push_back(task.first);
     }
   }
+  ElementCacheStats element_cache_stats;
+  if (element_cache_) {
+    ElementCache::Stats stats = element_cache_->GetStats();
+    element_cache_stats.set_hits(stats.hits);
+    element_cache_stats.set_misses(stats.misses);
+    element_cache_stats.set_memory_bytes(stats.memory_bytes);
+    element_cache_stats.set_disk_bytes(stats.disk_bytes);
+  }
   std::vector<TaskDef> new_tasks;
   std::vector<int64> tasks_to_delete;
   TF_RETURN_IF_ERROR(dispatcher_->WorkerHeartbeat(
-      worker_address_, current_tasks, new_tasks, tasks_to_delete));
+      worker_address_, current_tasks,
+      element_cache_ ? &element_cache_stats : nullptr, new_tasks,
+      tasks_to_delete));
   mutex_lock l(mu_);
   for (const auto& task : new_tasks) {
     Status s = ProcessTaskInternal(task);
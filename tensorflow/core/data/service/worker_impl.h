@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/data_service.h"
 #include "tensorflow/core/data/service/dispatcher.grpc.pb.h"
+#include "tensorflow/core/data/service/element_cache.h"
 #include "tensorflow/core/data/service/worker.pb.h"
 #include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -61,6 +62,14 @@ class DataServiceWorkerImpl {
     mutex mu;
     bool initialized TF_GUARDED_BY(mu) = false;
     bool finished = false;
+    // Whether elements of the task are served from and inserted into
+    // `element_cache_`.
+    bool use_element_cache = false;
+    // Index of the next element to produce for the task.
+    int64 next_element_index = 0;
+    // Index of the next element produced by `iterator`. This lags behind
+    // `next_element_index` when elements are served from `element_cache_`.
+    int64 iterator_position = 0;
     // TODO(aaudibert): Have standalone::Iterator own a reference to
     // standalone::Dataset so that we don't need to store the dataset here.
     std::unique_ptr<standalone::Dataset> dataset;
@@ -73,6 +82,22 @@ class DataServiceWorkerImpl {
   Status ProcessTaskInternal(const TaskDef& task)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   Status EnsureTaskInitialized(Task& task);
+  // Returns whether elements of `task`, whose dataset has the given graph, may
+  // be served from and inserted into `element_cache_`.
+  bool UseElementCache(const Task& task, const GraphDef& graph) const;
+  // Creates the iterator of `task`. Iterators of tasks which use
+  // `element_cache_` are restored from its checkpoint when possible.
+  Status MakeTaskIterator(Task& task);
+  // Produces the element at `task.next_element_index` from the task iterator,
+  // creating it if elements were served from `element_cache_` so far.
+  Status GetNextFromIterator(Task& task, std::vector<Tensor>& outputs,
+                             bool& end_of_sequence)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Inserts `element`, the element at `task.next_element_index`, into
+  // `element_cache_`, and checkpoints the task iterator if the element closes
+  // the cached prefix of the dataset.
+  void InsertIntoElementCache(Task& task, const CompressedElement& element)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // A thread for notifying the dispatcher when tasks complete.
   void TaskCompletionThread() TF_LOCKS_EXCLUDED(mu_);
   // A thread for doing periodic heartbeats to the dispatcher.
@@ -84,6 +109,8 @@ class DataServiceWorkerImpl {
   // The worker's own address.
   std::string worker_address_;
   std::unique_ptr<DataServiceDispatcherClient> dispatcher_;
+  // Cache of produced elements, or null if element caching is disabled.
+  std::unique_ptr<ElementCache> element_cache_;
 
   mutex mu_;
   // Information about tasks, keyed by task ids.
@@ -39,6 +39,14 @@ Status Iterator::GetNext(std::vector<Tensor>* outputs, bool* end_of_input) {
   return iterator_->GetNext(ctx_.get(), outputs, end_of_input);
 }
 
+Status Iterator::Save(IteratorStateWriter* writer) {
+  SerializationContext::Params params;
+  params.external_state_policy =
+      SerializationContext::ExternalStatePolicy::kFail;
+  SerializationContext ctx(params);
+  return iterator_->Save(&ctx, writer);
+}
+
 Iterator::Iterator(IteratorBase* iterator, IteratorContext* ctx)
     : iterator_(iterator), ctx_(ctx) {}
 
@@ -100,6 +108,18 @@ Status Dataset::FromGraph(Params params, const GraphDef& graph_def,
 
 Status Dataset::MakeIterator(std::unique_ptr<SplitProvider> split_provider,
                              std::unique_ptr<Iterator>* result) {
+  return MakeIteratorInternal(std::move(split_provider), /*reader=*/nullptr,
+                              result);
+}
+
+Status Dataset::MakeIteratorFromCheckpoint(IteratorStateReader* reader,
+                                           std::unique_ptr<Iterator>* result) {
+  return MakeIteratorInternal(/*split_provider=*/nullptr, reader, result);
+}
+
+Status Dataset::MakeIteratorInternal(
+    std::unique_ptr<SplitProvider> split_provider, IteratorStateReader* reader,
+    std::unique_ptr<Iterator>* result) {
   // Create an `IteratorContext`, which bundles together the necessary runtime
   // support to create and get elements from an iterator.
   std::unique_ptr<IteratorContext> ctx;
@@ -123,8 +143,13 @@ Status Dataset::MakeIterator(std::unique_ptr<SplitProvider> split_provider,
 
   // Create the iterator from the dataset.
   std::unique_ptr<IteratorBase> iterator;
-  TF_RETURN_IF_ERROR(dataset_->MakeIterator(ctx.get(), /*parent=*/nullptr,
-                                            "Iterator", &iterator));
+  if (reader == nullptr) {
+    TF_RETURN_IF_ERROR(dataset_->MakeIterator(ctx.get(), /*parent=*/nullptr,
+                                              "Iterator", &iterator));
+  } else {
+    TF_RETURN_IF_ERROR(dataset_->MakeIteratorFromCheckpoint(
+        ctx.get(), "Iterator", reader, &iterator));
+  }
 
   *result = WrapUnique(new Iterator(iterator.release(), ctx.release()));
 
@@ -139,6 +164,10 @@ Status Dataset::MakeSplitProvider(std::unique_ptr<SplitProvider>* result) {
   return dataset_->MakeSplitProvider(result);
 }
 
+Status Dataset::CheckExternalState() const {
+  return dataset_->CheckExternalState();
+}
+
 Dataset::Dataset(DatasetBase* dataset, DeviceMgr* device_mgr,
                  ProcessFunctionLibraryRuntime* pflr,
                  FunctionLibraryDefinition* flib_def, thread::ThreadPool* pool)
@@ -72,6 +72,10 @@ class Iterator {
   // indication of whether the end of the input pipeline has been reached.
   Status GetNext(std::vector<Tensor>* outputs, bool* end_of_input);
 
+  // Saves the state of the iterator to `writer`. Fails if the input pipeline
+  // has external state, e.g. stateful functions, which can't be saved.
+  Status Save(IteratorStateWriter* writer);
+
  private:
   friend class Dataset;
 
@@ -101,15 +105,27 @@ class Dataset {
   // Creates an iterator, optionally with a split provider.
   Status MakeIterator(std::unique_ptr<SplitProvider> split_provider,
                       std::unique_ptr<Iterator>* result);
+  // Creates an iterator restored from the state saved by `Iterator::Save` on
+  // an iterator of the same dataset.
+  Status MakeIteratorFromCheckpoint(IteratorStateReader* reader,
+                                    std::unique_ptr<Iterator>* result);
 
   // Creates a split provider for this dataset.
   Status MakeSplitProvider(std::unique_ptr<SplitProvider>* result);
+  // Returns an error if the input pipeline depends on external state, e.g.
+  // stateful functions, so that its iterations may produce different elements.
+  Status CheckExternalState() const;
 
  private:
   Dataset(DatasetBase* dataset, DeviceMgr* device_mgr,
           ProcessFunctionLibraryRuntime* pflr,
           FunctionLibraryDefinition* flib_def, thread::ThreadPool* pool);
 
+  // Creates an iterator, restored from `reader` if it is not null.
+  Status MakeIteratorInternal(std::unique_ptr<SplitProvider> split_provider,
+                              IteratorStateReader* reader,
+                              std::unique_ptr<Iterator>* result);
+
   DatasetBase* dataset_;  // owned
   std::unique_ptr<DeviceMgr> device_mgr_;
   std::unique_ptr<FunctionLibraryDefinition> flib_def_;
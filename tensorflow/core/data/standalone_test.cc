@@ -19,6 +19,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
 
@@ -301,6 +302,37 @@ TEST(Scalar, Standalone) {
   }
 }
 
+TEST(Scalar, SaveAndRestore) {
+  GraphDef graph_def;
+  protobuf::TextFormat::ParseFromString(kMapGraphProto, &graph_def);
+  std::unique_ptr<Dataset> dataset;
+  TF_ASSERT_OK(Dataset::FromGraph({}, graph_def, &dataset));
+  std::unique_ptr<Iterator> iterator;
+  TF_ASSERT_OK(dataset->MakeIterator(&iterator));
+  bool end_of_input = false;
+  for (int i = 0; i < 4; ++i) {
+    std::vector<tensorflow::Tensor> outputs;
+    TF_ASSERT_OK(iterator->GetNext(&outputs, &end_of_input));
+  }
+
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(iterator->Save(&writer));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  std::unique_ptr<Iterator> restored;
+  TF_ASSERT_OK(dataset->MakeIteratorFromCheckpoint(&reader, &restored));
+  for (int64 i = 4; i < 10; ++i) {
+    std::vector<tensorflow::Tensor> outputs;
+    TF_ASSERT_OK(restored->GetNext(&outputs, &end_of_input));
+    ASSERT_FALSE(end_of_input);
+    EXPECT_EQ(outputs[0].scalar<int64>()(), i * i);
+  }
+  std::vector<tensorflow::Tensor> outputs;
+  TF_ASSERT_OK(restored->GetNext(&outputs, &end_of_input));
+  EXPECT_TRUE(end_of_input);
+}
+
 }  // namespace
 }  // namespace standalone
 }  // namespace data
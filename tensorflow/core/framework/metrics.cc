@@ -144,6 +144,16 @@ auto* build_graph_time_usecs = monitoring::Counter<0>::New(
     "spent optimizing the graph with Grappler, and time spent pruning the "
     "sub-graph.");
 
+auto* grappler_cache_lookups = monitoring::Counter<1>::New(
+    "/tensorflow/core/grappler_cache_lookups",
+    "The number of lookups of the Grappler optimization cache, by result.",
+    "result");
+
+auto* grappler_cache_saved_usecs = monitoring::Counter<0>::New(
+    "/tensorflow/core/grappler_cache_saved_usecs",
+    "The time it took to optimize the graphs that were later found in the "
+    "Grappler optimization cache, in microseconds.");
+
 auto* xla_compilations = monitoring::Counter<0>::New(
     "/tensorflow/core/xla_compilations",
     "The number of XLA compilations used to collect "
@@ -282,6 +292,18 @@ void UpdateGrapplerPassTime(const string& pass_name,
   }
 }
 
+void RecordGrapplerCacheHit(const uint64 saved_usecs) {
+  static auto* hits_cell = grappler_cache_lookups->GetCell("hit");
+  static auto* saved_usecs_cell = grappler_cache_saved_usecs->GetCell();
+  hits_cell->IncrementBy(1);
+  saved_usecs_cell->IncrementBy(saved_usecs);
+}
+
+void RecordGrapplerCacheMiss() {
+  static auto* misses_cell = grappler_cache_lookups->GetCell("miss");
+  misses_cell->IncrementBy(1);
+}
+
 void UpdateGraphBuildTime(const uint64 running_time_usecs) {
   if (running_time_usecs > 0) {
     static auto* build_graph_calls_cell = build_graph_calls->GetCell();
@@ -124,6 +124,11 @@ void UpdateGraphOptimizationPassTime(const string& pass_name,
 void UpdateGrapplerPassTime(const string& pass_name,
                             const uint64 running_time_usecs);
 
+// Records a hit of the Grappler optimization cache, which saved the
+// `saved_usecs` it took to optimize the cached graph, or a miss.
+void RecordGrapplerCacheHit(const uint64 saved_usecs);
+void RecordGrapplerCacheMiss();
+
 // Updates the metrics stored about time XLA spents compiling graphs.
 void UpdateXlaCompilationTime(const uint64 compilation_time_usecs);
 
@@ -1386,6 +1386,9 @@ void Model::Optimize(AutotuneAlgorithm algorithm, int64 cpu_budget,
     case AutotuneAlgorithm::GRADIENT_DESCENT:
       OptimizeGradientDescent(cpu_budget, ram_budget, model_input_time);
       break;
+    case AutotuneAlgorithm::MEMORY_AWARE:
+      OptimizeMemoryAware(cpu_budget, ram_budget, model_input_time);
+      break;
   }
 }
 
@@ -1571,6 +1574,113 @@ void Model::OptimizeHillClimb(int64 cpu_budget, int64 ram_budget,
   }
 }
 
+void Model::OptimizeMemoryAware(int64 cpu_budget, int64 ram_budget,
+                                double model_input_time) {
+  std::shared_ptr<Node> snapshot;
+  {
+    tf_shared_lock lock(mu_);
+    snapshot = output_->Snapshot();
+  }
+  VLOG(2) << "Starting optimization of tunable parameters with MemoryAware";
+  const double processing_time = TotalProcessingTime(snapshot);
+  auto parameters = CollectTunableParameters(snapshot);
+  // Buffers are shrunk only as long as the output time stays within this
+  // relative slack of the output time reached while growing them.
+  constexpr double kOutputTimeSlack = 0.05L;
+  // Parameters whose increment does not add buffered bytes (e.g. because no
+  // element has been buffered yet) are charged this many bytes so that their
+  // output time improvement per byte remains finite.
+  constexpr double kMinBytesDelta = 1.0L;
+
+  for (auto& pair : parameters) {
+    pair.second->value = pair.second->min;
+  }
+  const double target_output_time = processing_time / cpu_budget;
+  double output_time =
+      OutputTime(snapshot, model_input_time, /*gradients=*/nullptr);
+  double buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+
+  // Grow the parameters with the best output time improvement per byte until
+  // the target output time is reached or no parameter fits the RAM budget.
+  while (output_time > target_output_time) {
+    double best_score = 0.0L;
+    double best_output_time = output_time;
+    double best_buffered_bytes = buffered_bytes;
+    Parameter* best_parameter = nullptr;
+    for (auto& pair : parameters) {
+      if (pair.second->value >= pair.second->max) {
+        continue;
+      }
+      pair.second->value++;
+      double new_output_time =
+          OutputTime(snapshot, model_input_time, /*gradients=*/nullptr);
+      double new_buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+      pair.second->value--;
+      if (new_buffered_bytes > ram_budget) {
+        continue;
+      }
+      double delta = output_time - new_output_time;
+      double score =
+          delta / std::max(new_buffered_bytes - buffered_bytes, kMinBytesDelta);
+      if (delta > 0 && score > best_score) {
+        best_score = score;
+        best_output_time = new_output_time;
+        best_buffered_bytes = new_buffered_bytes;
+        best_parameter = pair.second.get();
+      }
+    }
+    if (!best_parameter) {
+      break;
+    }
+    best_parameter->value++;
+    output_time = best_output_time;
+    buffered_bytes = best_buffered_bytes;
+  }
+
+  // Shrink the parameters that free the most memory without increasing the
+  // output time beyond the slack. If the consumer is the bottleneck, the wait
+  // time is insensitive to buffer size and buffers shrink towards the minimum.
+  const double output_time_limit =
+      std::max(output_time, target_output_time) * (1.0L + kOutputTimeSlack);
+  while (true) {
+    double best_saved_bytes = 0.0L;
+    double best_buffered_bytes = buffered_bytes;
+    Parameter* best_parameter = nullptr;
+    for (auto& pair : parameters) {
+      if (pair.second->value <= pair.second->min) {
+        continue;
+      }
+      pair.second->value--;
+      double new_output_time =
+          OutputTime(snapshot, model_input_time, /*gradients=*/nullptr);
+      double new_buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+      pair.second->value++;
+      double saved_bytes = buffered_bytes - new_buffered_bytes;
+      if (new_output_time <= output_time_limit &&
+          saved_bytes > best_saved_bytes) {
+        best_saved_bytes = saved_bytes;
+        best_buffered_bytes = new_buffered_bytes;
+        best_parameter = pair.second.get();
+      }
+    }
+    if (!best_parameter) {
+      break;
+    }
+    best_parameter->value--;
+    buffered_bytes = best_buffered_bytes;
+  }
+  VLOG(2) << "Number of tunable parameters: " << parameters.size()
+          << ", maximum buffered bytes: " << buffered_bytes;
+  for (auto& pair : parameters) {
+    auto& parameter = pair.second;
+    VLOG(2) << "Setting tunable parameter " << pair.first << " to "
+            << parameter->value;
+    mutex_lock l(*parameter->state->mu);
+    parameter->state->value = parameter->value;
+    parameter->state->cond_var->notify_all();
+  }
+}
+
 double Model::OutputTime(std::shared_ptr<Node> node, double model_input_time,
                          absl::flat_hash_map<string, double>* gradients) {
   // To store the input time for each node.
@@ -48,6 +48,7 @@ constexpr char kModelInputTimeKey[] = "model_input_time";
 enum class AutotuneAlgorithm {
   HILL_CLIMB = 0,
   GRADIENT_DESCENT = 1,
+  MEMORY_AWARE = 2,
 };
 
 enum class TraversalOrder {
@@ -674,6 +675,19 @@ class Model {
   void OptimizeGradientDescent(int64 cpu_budget, int64 ram_budget,
                                double model_input_time);
 
+  // This optimization algorithm minimizes the total buffered bytes subject to
+  // a target output time. It starts by setting all tunable parameters to the
+  // minimum value and then repeatedly increments the parameter with the best
+  // output time improvement per additional buffered byte (as estimated by
+  // `TotalMaximumBufferedBytes`), skipping increments that would exceed the
+  // RAM budget, until the output time reaches the processing time needed to
+  // produce an element divided by CPU budget. It then repeatedly decrements
+  // the parameter that frees the most memory while keeping the output time
+  // within a small slack of the value reached, which shrinks buffers that do
+  // not contribute to throughput (e.g. when the consumer is the bottleneck).
+  void OptimizeMemoryAware(int64 cpu_budget, int64 ram_budget,
+                           double model_input_time);
+
   // Collects the output time and if `gradients` is not `nullptr`, the output
   // time gradient w.r.t. tunable parameters of the subtree rooted in the given
   // node.
@@ -947,7 +947,102 @@ TEST_P(OptimizeZeroRamBudgetTest, Model) {
 }
 
 INSTANTIATE_TEST_SUITE_P(Test, OptimizeZeroRamBudgetTest,
-                         ::testing::Values(0, 1));
+                         ::testing::Values(0, 1, 2));
+
+// Parameter values, modeled output time and worst-case buffered bytes of a
+// model after optimization.
+struct OptimizedModel {
+  int64 buffer_size;
+  int64 parallelism;
+  double output_time;
+  double buffered_bytes;
+};
+
+// Optimizes a model with a `buffer_size` and a `parallelism` parameter using
+// `algorithm`.
+OptimizedModel OptimizeBufferedModel(AutotuneAlgorithm algorithm,
+                                     int64 cpu_budget, int64 ram_budget) {
+  std::shared_ptr<mutex> mutex1 = std::make_shared<mutex>();
+  std::shared_ptr<condition_variable> cv1 =
+      std::make_shared<condition_variable>();
+  std::shared_ptr<Node> node1 = model::MakeAsyncKnownRatioNode(
+      {1, "1", nullptr}, 1,
+      {model::MakeParameter("buffer_size",
+                            std::make_shared<SharedState>(-1, mutex1, cv1), 1,
+                            10)});
+  node1->record_buffer_event(100, 1);
+  node1->add_processing_time(100);
+  node1->record_bytes_produced(100);
+  node1->record_element();
+
+  std::shared_ptr<mutex> mutex2 = std::make_shared<mutex>();
+  std::shared_ptr<condition_variable> cv2 =
+      std::make_shared<condition_variable>();
+  std::shared_ptr<Node> node2 = model::MakeAsyncKnownRatioNode(
+      {2, "2", node1}, 1,
+      {model::MakeParameter("parallelism",
+                            std::make_shared<SharedState>(-1, mutex2, cv2), 1,
+                            10)});
+  node2->record_buffer_event(10, 1);
+  node2->add_processing_time(1000);
+  node2->record_bytes_produced(10);
+  node2->record_element();
+
+  model::Model model;
+  model.AddNode([&node1](model::Node::Args args) { return node1; }, "1",
+                nullptr, &node1);
+  model.AddNode([&node2](model::Node::Args args) { return node2; }, "2", node1,
+                &node2);
+
+  model.Optimize(algorithm, cpu_budget, ram_budget, 0);
+  absl::flat_hash_map<string, double> input_times;
+  input_times[kModelInputTimeKey] = 0;
+  return {static_cast<int64>(node1->parameter_value("buffer_size")),
+          static_cast<int64>(node2->parameter_value("parallelism")),
+          node1->OutputTime(&input_times, nullptr),
+          node1->TotalMaximumBufferedBytes()};
+}
+
+class OptimizeMemoryAwareTest : public ::testing::TestWithParam<int64> {};
+
+TEST_P(OptimizeMemoryAwareTest, Model) {
+  const int64 ram_budget = GetParam();
+  OptimizedModel memory_aware =
+      OptimizeBufferedModel(AutotuneAlgorithm::MEMORY_AWARE, 40, ram_budget);
+  EXPECT_GE(memory_aware.buffer_size, 1);
+  EXPECT_LE(memory_aware.buffer_size, 10);
+  EXPECT_GE(memory_aware.parallelism, 1);
+  EXPECT_LE(memory_aware.parallelism, 10);
+  // The minimum configuration buffers 110 bytes, so any larger budget must be
+  // respected by the optimized configuration.
+  EXPECT_LE(memory_aware.buffered_bytes, std::max<double>(ram_budget, 110));
+}
+
+INSTANTIATE_TEST_SUITE_P(Test, OptimizeMemoryAwareTest,
+                         ::testing::Values(0, 110, 150, 500, 1 << 20));
+
+class OptimizeMemoryAwareVsHillClimbTest
+    : public ::testing::TestWithParam<int64> {};
+
+TEST_P(OptimizeMemoryAwareVsHillClimbTest, Model) {
+  const int64 cpu_budget = GetParam();
+  // The model spends 1100 time units processing each element.
+  const double target_output_time = 1100.0 / cpu_budget;
+  OptimizedModel hill_climb = OptimizeBufferedModel(
+      AutotuneAlgorithm::HILL_CLIMB, cpu_budget, /*ram_budget=*/1 << 20);
+  OptimizedModel memory_aware = OptimizeBufferedModel(
+      AutotuneAlgorithm::MEMORY_AWARE, cpu_budget, /*ram_budget=*/1 << 20);
+  // Both algorithms reach the target throughput, up to the slack the
+  // memory-aware algorithm allows itself while shrinking buffers ...
+  EXPECT_LE(hill_climb.output_time, target_output_time);
+  EXPECT_LE(memory_aware.output_time, target_output_time * 1.05);
+  // ... but the memory-aware algorithm gets there with fewer buffered bytes.
+  EXPECT_LE(memory_aware.buffer_size, hill_climb.buffer_size);
+  EXPECT_LT(memory_aware.buffered_bytes, hill_climb.buffered_bytes);
+}
+
+INSTANTIATE_TEST_SUITE_P(Test, OptimizeMemoryAwareVsHillClimbTest,
+                         ::testing::Values(4, 6, 8));
 
 }  // namespace
 }  // namespace model
@@ -16,10 +16,87 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_RESOURCE_VAR_H_
 #define TENSORFLOW_CORE_FRAMEWORK_RESOURCE_VAR_H_
 
+#include <atomic>
+#include <thread>
+
 #include "tensorflow/core/framework/resource_mgr.h"
 
 namespace tensorflow {
 
+// Holds the value of a read-mostly variable for readers that do not take the
+// variable's lock.
+//
+// Readers pin the published tensor with a `Reader`, which only increments a
+// counter. Writers, which must be serialized by the caller, replace the
+// published tensor and then wait until no reader can still see the previous one
+// before deleting it, in the style of read-copy-update. A published tensor is
+// never modified, and writes pay for waiting on readers, so this only suits
+// variables that are rarely or never updated.
+class ReadMostlyTensor {
+ public:
+  // Pins the published tensor for the lifetime of the reader.
+  class Reader {
+   public:
+    explicit Reader(const ReadMostlyTensor& t)
+        : counter_(t.EnterRead()), tensor_(t.published_.load()) {}
+    ~Reader() { counter_->fetch_sub(1); }
+
+    const Tensor& tensor() const { return *tensor_; }
+
+   private:
+    // Registering on `counter_` must happen before loading `tensor_`.
+    std::atomic<int64>* const counter_;
+    const Tensor* const tensor_;
+
+    TF_DISALLOW_COPY_AND_ASSIGN(Reader);
+  };
+
+  ReadMostlyTensor() {}
+  ~ReadMostlyTensor() { delete published_.load(); }
+
+  // Publishes `value` to new readers, and returns once the previously
+  // published tensor has no readers left.
+  void Publish(const Tensor& value) {
+    const Tensor* previous = published_.exchange(new Tensor(value));
+    // Only readers registered before the exchange can hold `previous`. Each
+    // round steers new readers to the other epoch and waits for the counters of
+    // the current one to drain, so two rounds cover every such reader.
+    for (int round = 0; round < 2; ++round) {
+      const int epoch = epoch_.fetch_xor(1);
+      for (Counter& counter : counters_[epoch]) {
+        while (counter.value.load() != 0) {
+          std::this_thread::yield();
+        }
+      }
+    }
+    delete previous;
+  }
+
+ private:
+  static constexpr int kNumCounters = 16;
+
+  // Each counter sits on its own cache line, so that readers on different
+  // threads do not contend.
+  struct alignas(64) Counter {
+    std::atomic<int64> value{0};
+  };
+
+  std::atomic<int64>* EnterRead() const {
+    static std::atomic<int> num_threads{0};
+    static thread_local const int slot =
+        num_threads.fetch_add(1) % kNumCounters;
+    std::atomic<int64>* counter = &counters_[epoch_.load()][slot].value;
+    counter->fetch_add(1);
+    return counter;
+  }
+
+  std::atomic<int> epoch_{0};
+  mutable Counter counters_[2][kNumCounters];
+  std::atomic<const Tensor*> published_{nullptr};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ReadMostlyTensor);
+};
+
 // Resource stored by variables in the resource manager (new, resource-style
 // version).
 //
@@ -57,6 +134,17 @@ namespace tensorflow {
 // mutex as desired. To access the variable in dense mode grab the mutex either
 // directly or via `MaybeLockVariableInputMutexesInOrder` on all variables being
 // modified and then call `PrepareToUpdateVariable` on them in any order.
+//
+// Variables that are rarely or never updated, such as the embeddings of a
+// model being served, can additionally be switched to read-mostly mode with
+// `PublishReadMostly()`. Their value is then published in a `ReadMostlyTensor`,
+// and dense reads and gathers use it without grabbing the mutex. In this mode
+// the variable's buffer may be in use by lock-free readers at any time, so it
+// must never be updated in place: the only supported write is replacing the
+// whole tensor under an exclusive lock with `SetTensor()`, which publishes it
+// again. In-place writers check `ValidateVariableForUpdate()` while holding the
+// mutex, and `EnsureSparseVariableAccess()` fails on read-mostly variables.
+// Transitioning out of read-mostly mode is not supported.
 class Var : public ResourceBase {
  public:
   explicit Var(DataType dtype) : tensor_(dtype) {}
@@ -87,11 +175,44 @@ class Var : public ResourceBase {
   // so desired.
   std::atomic<bool> copy_on_read_mode{false};
 
+  // Returns the published value of the variable if it is in read-mostly mode,
+  // nullptr otherwise.
+  const ReadMostlyTensor* read_mostly_tensor() const {
+    return read_mostly_.load();
+  }
+
+  // Replaces the value of the variable with `tensor`, publishing it if the
+  // variable is in read-mostly mode. Must be called with the mutex held
+  // exclusively. Writers that replace the whole tensor should use this rather
+  // than assigning through `tensor()`, so lock-free readers never miss an
+  // update.
+  void SetTensor(const Tensor& tensor) {
+    tensor_ = tensor;
+    if (read_mostly_.load() != nullptr) PublishReadMostly();
+  }
+
+  // Publishes the current value of the variable to lock-free readers,
+  // switching it to read-mostly mode if needed. Must be called with the mutex
+  // held exclusively, after any change to the tensor of a read-mostly
+  // variable.
+  void PublishReadMostly() {
+    ReadMostlyTensor* read_mostly = read_mostly_.load();
+    if (read_mostly == nullptr) {
+      read_mostly = new ReadMostlyTensor;
+      read_mostly->Publish(tensor_);
+      read_mostly_.store(read_mostly);
+    } else {
+      read_mostly->Publish(tensor_);
+    }
+  }
+
  private:
   mutex mu_;
   Tensor tensor_;
+  // Set once, when the variable switches to read-mostly mode.
+  std::atomic<ReadMostlyTensor*> read_mostly_{nullptr};
 
-  ~Var() override {}
+  ~Var() override { delete read_mostly_.load(); }
   TF_DISALLOW_COPY_AND_ASSIGN(Var);
 };
 
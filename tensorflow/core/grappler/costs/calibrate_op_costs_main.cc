@@ -0,0 +1,89 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This program measures a sweep of common ops and shapes on the CPU of the
+// host, and writes the calibration of the OpLevelCostEstimator fitted from
+// these measurements as a text proto. The estimator loads the calibration from
+// the file named by the TF_GRAPPLER_COST_CALIBRATION environment variable.
+//
+// Usage:
+//   calibrate_op_costs --output=/path/to/calibration.pbtxt
+#include <iostream>
+#include <vector>
+
+#include "tensorflow/core/grappler/clusters/single_machine.h"
+#include "tensorflow/core/grappler/costs/op_cost_calibration.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/util/command_line_flags.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+Status Calibrate(const string& output, int32 num_runs, int32 num_cores) {
+  if (num_cores < 1) num_cores = port::NumSchedulableCPUs();
+  SingleMachine cluster(/*timeout_s=*/600, num_cores, /*num_gpus=*/0);
+  cluster.DisableOptimizer(true);
+  TF_RETURN_IF_ERROR(cluster.Provision());
+
+  std::vector<GrapplerItem> items;
+  TF_RETURN_IF_ERROR(MakeOpCostCalibrationItems(&items));
+  OpPerformanceList measurements;
+  TF_RETURN_IF_ERROR(MeasureOpCosts(&cluster, items, num_runs, &measurements));
+  TF_RETURN_IF_ERROR(cluster.Shutdown());
+
+  OpCostCalibration calibration;
+  TF_RETURN_IF_ERROR(FitOpCostCalibration(measurements, &calibration));
+  for (const auto& op : calibration.ops()) {
+    LOG(INFO) << op.first << ": overhead " << op.second.overhead_ns()
+              << " ns, scale " << op.second.scale();
+  }
+  return WriteTextProto(Env::Default(), output, calibration);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
+
+int main(int argc, char** argv) {
+  tensorflow::string output;
+  tensorflow::int32 num_runs = 10;
+  tensorflow::int32 num_cores = -1;
+  std::vector<tensorflow::Flag> flag_list = {
+      tensorflow::Flag("output", &output,
+                       "Path of the calibration text proto to write."),
+      tensorflow::Flag("num_runs", &num_runs,
+                       "Number of measured runs of each microbenchmark."),
+      tensorflow::Flag("num_cores", &num_cores,
+                       "Number of CPU cores to run the ops on, or -1 to use "
+                       "all the cores of the host.")};
+  std::string usage = tensorflow::Flags::Usage(argv[0], flag_list);
+  bool parsed_values_ok = tensorflow::Flags::Parse(&argc, argv, flag_list);
+  if (!parsed_values_ok || output.empty() || num_runs < 1) {
+    std::cerr << usage << std::endl;
+    return 2;
+  }
+  tensorflow::port::InitMain(argv[0], &argc, &argv);
+
+  tensorflow::Status s =
+      tensorflow::grappler::Calibrate(output, num_runs, num_cores);
+  if (!s.ok()) {
+    std::cerr << "Failed to calibrate the op costs: " << s << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -36,7 +36,9 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/topological_sort.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/gtl/flatset.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/fingerprint.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -437,6 +439,85 @@ NodeDef MakeConstNodeDefFromShape(InferenceContext* ic,
       ic, MakeTensorProtoFromShape(ic, shape, tensor_as_shape, dtype), dtype);
 }
 
+// Returns true if the properties previously inferred for a tensor of type
+// `dtype` are less precise than inferring them again: they don't capture the
+// shapes held by resources and variants, nor the partially known shapes that
+// integer tensors often hold.
+bool InferAgainOnIncrementalInference(DataType dtype) {
+  return dtype == DT_RESOURCE || dtype == DT_VARIANT || dtype == DT_INT32 ||
+         dtype == DT_INT64;
+}
+
+// Finds the nodes whose properties must be inferred again once the nodes in
+// `updated_nodes` changed: these nodes, the nodes that have no previous output
+// properties, and their transitive fanout go in `updated_fanout`. The nodes in
+// their transitive fanin that must be inferred again for their properties to
+// be precise go in `updated_fanin`. Returns false if more than `max_nodes`
+// nodes must be inferred again.
+bool FindNodesToInferAgain(
+    const GraphView& graph_view,
+    const absl::flat_hash_map<string, std::vector<OpInfo::TensorProperties>>&
+        previous_output_properties,
+    const absl::flat_hash_set<string>& updated_nodes, int max_nodes,
+    absl::flat_hash_set<const NodeDef*>* updated_fanout,
+    absl::flat_hash_set<const NodeDef*>* updated_fanin) {
+  std::vector<const NodeDef*> queue;
+  for (const string& node_name : updated_nodes) {
+    const NodeDef* node = graph_view.GetNode(node_name);
+    if (node != nullptr && updated_fanout->insert(node).second) {
+      queue.push_back(node);
+    }
+  }
+  for (const NodeDef& node : graph_view.graph()->node()) {
+    if (previous_output_properties.find(node.name()) ==
+            previous_output_properties.end() &&
+        updated_fanout->insert(&node).second) {
+      queue.push_back(&node);
+    }
+  }
+  while (!queue.empty()) {
+    if (updated_fanout->size() > static_cast<size_t>(max_nodes)) return false;
+    const NodeDef* node = queue.back();
+    queue.pop_back();
+    for (const GraphView::InputPort& fanout :
+         graph_view.GetFanouts(*node, /*include_controlled_nodes=*/false)) {
+      if (updated_fanout->insert(fanout.node).second) {
+        queue.push_back(fanout.node);
+      }
+    }
+  }
+
+  queue.assign(updated_fanout->begin(), updated_fanout->end());
+  while (!queue.empty()) {
+    const NodeDef* node = queue.back();
+    queue.pop_back();
+    for (const GraphView::OutputPort& fanin :
+         graph_view.GetFanins(*node, /*include_controlling_nodes=*/false)) {
+      if (updated_fanout->contains(fanin.node) ||
+          updated_fanin->contains(fanin.node)) {
+        continue;
+      }
+      bool infer_again = !HasRegularInputs(*fanin.node);
+      if (!infer_again) {
+        const auto& properties =
+            previous_output_properties.at(fanin.node->name());
+        infer_again = fanin.port_id >= static_cast<int>(properties.size()) ||
+                      InferAgainOnIncrementalInference(
+                          properties[fanin.port_id].dtype());
+      }
+      if (infer_again) {
+        updated_fanin->insert(fanin.node);
+        queue.push_back(fanin.node);
+        if (updated_fanout->size() + updated_fanin->size() >
+            static_cast<size_t>(max_nodes)) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 // Note that tensor_as_shape input should not include kUnknownDimFromConst.
@@ -1311,6 +1392,52 @@ class SymbolicShapeRefiner {
     return Status::OK();
   }
 
+  // Sets the output shapes and values of `node` to `output_properties`,
+  // inferred earlier, instead of inferring them from its inputs. The unknown
+  // dimensions that share a symbolic id share the handle in `symbolic_dims`.
+  // The properties must outlive the refiner.
+  Status SetOutputProperties(
+      const NodeDef* node,
+      const std::vector<OpInfo::TensorProperties>& output_properties,
+      absl::flat_hash_map<int64, DimensionHandle>* symbolic_dims) {
+    TF_RETURN_IF_ERROR(AddNode(node));
+    NodeContext* ctx = CHECK_NOTNULL(GetNodeContext(node));
+    InferenceContext* ic = ctx->inference_context.get();
+    if (output_properties.size() != static_cast<size_t>(ic->num_outputs())) {
+      return errors::Internal("Node ", node->name(), " has ",
+                              ic->num_outputs(), " outputs, but ",
+                              output_properties.size(),
+                              " output properties");
+    }
+    ctx->output_tensor_protos.resize(ic->num_outputs(), nullptr);
+    for (int i = 0; i < ic->num_outputs(); ++i) {
+      const OpInfo::TensorProperties& properties = output_properties[i];
+      if (properties.shape().unknown_rank()) {
+        ic->set_output(i, ic->UnknownShape());
+      } else {
+        std::vector<DimensionHandle> dims;
+        for (const auto& dim : properties.shape().dim()) {
+          if (dim.size() >= 0) {
+            dims.push_back(ic->MakeDim(dim.size()));
+          } else if (dim.size() == -1) {
+            dims.push_back(ic->UnknownDim());
+          } else {
+            auto it = symbolic_dims->find(dim.size());
+            if (it == symbolic_dims->end()) {
+              it = symbolic_dims->emplace(dim.size(), ic->UnknownDim()).first;
+            }
+            dims.push_back(it->second);
+          }
+        }
+        ic->set_output(i, ic->MakeShape(dims));
+      }
+      if (properties.has_value()) {
+        ctx->output_tensor_protos[i] = &properties.value();
+      }
+    }
+    return Status::OK();
+  }
+
   Status AddNode(const NodeDef* node) {
     NodeContext& node_ctx = node_to_context_[node];
     NameAttrList function;
@@ -2043,6 +2170,9 @@ class SymbolicShapeManager {
     return dims_.Merge(d1, d2);
   }
 
+  // Returns the value or symbolic id that AsTensorProperties uses for `dim`.
+  int64 AsDim(DimensionHandle dim) { return dims_.GetMergedValue(dim); }
+
   void AsTensorProperties(const ShapeHandle& shape, const DataType& type,
                           OpInfo::TensorProperties* properties) {
     properties->set_dtype(type);
@@ -2348,6 +2478,54 @@ Status GraphProperties::InferStatically(bool assume_valid_feeds,
                                         bool aggressive_shape_inference,
                                         bool include_input_tensor_values,
                                         bool include_output_tensor_values) {
+  const InferenceOptions options{assume_valid_feeds, aggressive_shape_inference,
+                                 include_input_tensor_values,
+                                 include_output_tensor_values};
+  GraphPropertiesCache* cache = GraphPropertiesCache::Current();
+  if (cache != nullptr) {
+    return cache->InferStatically(this, options);
+  }
+  return InferStaticallyInternal(options, nullptr, nullptr, nullptr);
+}
+
+Status GraphProperties::InferStaticallyIncrementally(
+    const GraphProperties& previous,
+    const absl::flat_hash_set<string>& updated_nodes, bool assume_valid_feeds,
+    bool aggressive_shape_inference, bool include_input_tensor_values,
+    bool include_output_tensor_values) {
+  const InferenceOptions options{assume_valid_feeds, aggressive_shape_inference,
+                                 include_input_tensor_values,
+                                 include_output_tensor_values};
+  if (!previous.inferred_options_.has_value() ||
+      !(*previous.inferred_options_ == options)) {
+    return InferStaticallyInternal(options, nullptr, nullptr, nullptr);
+  }
+  if (&previous == this) {
+    // Updating the properties in place: they are cleared before the inference.
+    const PropertiesMap input_properties = std::move(input_properties_);
+    const PropertiesMap output_properties = std::move(output_properties_);
+    return InferStaticallyInternal(options, &input_properties,
+                                   &output_properties, &updated_nodes);
+  }
+  return InferStaticallyInternal(options, &previous.input_properties_,
+                                 &previous.output_properties_, &updated_nodes);
+}
+
+Status GraphProperties::InferStaticallyInternal(
+    const InferenceOptions& options,
+    const PropertiesMap* previous_input_properties,
+    const PropertiesMap* previous_output_properties,
+    const absl::flat_hash_set<string>* updated_nodes) {
+  const bool assume_valid_feeds = options.assume_valid_feeds;
+  const bool aggressive_shape_inference = options.aggressive_shape_inference;
+  const bool include_input_tensor_values = options.include_input_tensor_values;
+  const bool include_output_tensor_values =
+      options.include_output_tensor_values;
+  inferred_options_.reset();
+  input_properties_.clear();
+  output_properties_.clear();
+  incompatible_shape_nodes_.clear();
+
   FunctionLibraryDefinition function_library(OpRegistry::Global(),
                                              item_.graph.library());
   absl::flat_hash_map<string, absl::flat_hash_set<int>> fed_ports;
@@ -2437,24 +2615,78 @@ Status GraphProperties::InferStatically(bool assume_valid_feeds,
   auto refiner = absl::make_unique<SymbolicShapeRefiner>(
       graph_view, fed_ports, aggressive_shape_inference);
 
-  TopoQueue new_shapes(topo_order);
-  // Also seed the propagation of shapes in the fanout of primary inputs.
-  for (const NodeDef* node : primary_inputs) {
-    new_shapes.push(node);
-  }
-  // Also seed the propagation of shapes in the fanout of fed nodes.
-  for (const NodeDef* node : fed_nodes) {
-    new_shapes.push(node);
+  // Only infer the shapes of the updated nodes and their fanout again if it
+  // is a small part of the graph. Without loops or queues, the graph is then a
+  // DAG whose shapes can be inferred in a single pass in topological order.
+  absl::flat_hash_set<const NodeDef*> updated_fanout;
+  absl::flat_hash_set<const NodeDef*> updated_fanin;
+  const bool incremental =
+      updated_nodes != nullptr && !aggressive_shape_inference &&
+      num_loops == 0 && resources.empty() &&
+      FindNodesToInferAgain(graph_view, *previous_output_properties,
+                            *updated_nodes,
+                            /*max_nodes=*/item_.graph.node_size() / 2,
+                            &updated_fanout, &updated_fanin);
+  if (updated_nodes != nullptr) {
+    VLOG(1) << "Inferring the shapes of "
+            << (incremental ? updated_fanout.size() + updated_fanin.size()
+                            : item_.graph.node_size())
+            << " nodes out of " << item_.graph.node_size()
+            << " incrementally";
+  }
+
+  // The symbolic dimensions of the properties taken from
+  // `previous_output_properties`.
+  absl::flat_hash_map<int64, DimensionHandle> symbolic_dims;
+  if (incremental) {
+    // Take the outputs of the fanins of the nodes to infer from the previous
+    // properties.
+    for (const NodeDef& node : item_.graph.node()) {
+      if (!updated_fanout.contains(&node) && !updated_fanin.contains(&node)) {
+        continue;
+      }
+      for (const GraphView::OutputPort& fanin :
+           graph_view.GetFanins(node, /*include_controlling_nodes=*/false)) {
+        if (updated_fanout.contains(fanin.node) ||
+            updated_fanin.contains(fanin.node) ||
+            refiner->GetContext(fanin.node) != nullptr) {
+          continue;
+        }
+        TF_RETURN_IF_ERROR(refiner->SetOutputProperties(
+            fanin.node, previous_output_properties->at(fanin.node->name()),
+            &symbolic_dims));
+      }
+    }
+    for (const NodeDef* node : topo_order) {
+      if (updated_fanout.contains(node) || updated_fanin.contains(node)) {
+        bool unused_new_shapes = false;
+        TF_RETURN_IF_ERROR(UpdateShapes(refiner.get(), resource_handles, node,
+                                        &unused_new_shapes));
+      }
+    }
+  } else {
+    TopoQueue new_shapes(topo_order);
+    // Also seed the propagation of shapes in the fanout of primary inputs.
+    for (const NodeDef* node : primary_inputs) {
+      new_shapes.push(node);
+    }
+    // Also seed the propagation of shapes in the fanout of fed nodes.
+    for (const NodeDef* node : fed_nodes) {
+      new_shapes.push(node);
+    }
+    // Propagate shapes normally.
+    TF_RETURN_IF_ERROR(PropagateShapes(refiner.get(), &new_shapes,
+                                       resource_handles, num_loops));
   }
-  // Propagate shapes normally.
-  TF_RETURN_IF_ERROR(
-      PropagateShapes(refiner.get(), &new_shapes, resource_handles, num_loops));
 
   // Track shapes globally across the graph.
   std::unique_ptr<SymbolicShapeManager> shape_manager =
       absl::make_unique<SymbolicShapeManager>();
   bool found_error = false;
   for (const NodeDef& node : item_.graph.node()) {
+    if (incremental && !updated_fanout.contains(&node)) {
+      continue;
+    }
     auto node_ctx = refiner->GetContext(&node);
     if (!node_ctx) {
       continue;
@@ -2486,6 +2718,9 @@ Status GraphProperties::InferStatically(bool assume_valid_feeds,
   }
 
   for (const NodeDef& node : item_.graph.node()) {
+    if (incremental && !updated_fanout.contains(&node)) {
+      continue;
+    }
     VLOG(3) << "Filling in graph properties for node: " << node.name();
     auto ctx = refiner->GetNodeContext(&node);
     if (!ctx) {
@@ -2576,6 +2811,57 @@ Status GraphProperties::InferStatically(bool assume_valid_feeds,
     LOG(WARNING) << incompatible_shape_nodes_.size()
                  << " nodes have incompatible output shapes.";
 
+  if (incremental) {
+    // Renumber the symbolic dimensions of the inferred properties: the ones
+    // taken from the previous properties keep their id, and the new ones get
+    // ids the previous properties don't use.
+    int64 next_id = -2;
+    for (const PropertiesMap* properties_map :
+         {previous_input_properties, previous_output_properties}) {
+      for (const auto& node_properties : *properties_map) {
+        for (const auto& properties : node_properties.second) {
+          for (const auto& dim : properties.shape().dim()) {
+            next_id = std::min<int64>(next_id, dim.size() - 1);
+          }
+        }
+      }
+    }
+    absl::flat_hash_map<int64, int64> ids;
+    for (const auto& symbolic_dim : symbolic_dims) {
+      const int64 id = shape_manager->AsDim(symbolic_dim.second);
+      if (id < -1) ids.emplace(id, symbolic_dim.first);
+    }
+    for (const NodeDef* node : updated_fanout) {
+      for (PropertiesMap* properties_map :
+           {&input_properties_, &output_properties_}) {
+        auto it = properties_map->find(node->name());
+        if (it == properties_map->end()) continue;
+        for (auto& properties : it->second) {
+          for (auto& dim : *properties.mutable_shape()->mutable_dim()) {
+            if (dim.size() >= -1) continue;
+            auto id = ids.emplace(dim.size(), next_id);
+            if (id.second) --next_id;
+            dim.set_size(id.first->second);
+          }
+        }
+      }
+    }
+
+    // Take the properties of the other nodes from the previous properties.
+    for (const NodeDef& node : item_.graph.node()) {
+      if (updated_fanout.contains(&node)) continue;
+      auto it = previous_input_properties->find(node.name());
+      if (it != previous_input_properties->end()) {
+        input_properties_[node.name()] = it->second;
+      }
+      it = previous_output_properties->find(node.name());
+      if (it != previous_output_properties->end()) {
+        output_properties_[node.name()] = it->second;
+      }
+    }
+  }
+  inferred_options_ = options;
+
   // Help trace the unknown dimensions to their origins.
   VerboseLogUnknownDimensionSources(item_.graph, input_properties_,
                                     output_properties_);
@@ -2682,5 +2968,80 @@ void GraphProperties::ClearOutputProperties(const string& node_name) {
   output_properties_.erase(node_name);
 }
 
+namespace {
+
+// The cache used by the InferStatically calls of the current thread.
+thread_local GraphPropertiesCache* current_graph_properties_cache = nullptr;
+
+uint64 FingerprintProto(const protobuf::MessageLite& proto) {
+  string serialized;
+  SerializeToStringDeterministic(proto, &serialized);
+  return Fingerprint64(serialized);
+}
+
+}  // namespace
+
+GraphPropertiesCache::Scope::Scope(GraphPropertiesCache* cache)
+    : previous_(current_graph_properties_cache) {
+  current_graph_properties_cache = cache;
+}
+
+GraphPropertiesCache::Scope::~Scope() {
+  current_graph_properties_cache = previous_;
+}
+
+GraphPropertiesCache* GraphPropertiesCache::Current() {
+  return current_graph_properties_cache;
+}
+
+Status GraphPropertiesCache::InferStatically(
+    GraphProperties* properties,
+    const GraphProperties::InferenceOptions& options) {
+  const GrapplerItem& item = properties->item_;
+  uint64 item_fingerprint = FingerprintProto(item.graph.library());
+  for (const auto& feed : item.feed) {
+    item_fingerprint = FingerprintCat64(item_fingerprint,
+                                        Fingerprint64(feed.first));
+  }
+  absl::flat_hash_map<string, uint64> node_fingerprints;
+  node_fingerprints.reserve(item.graph.node_size());
+  for (const NodeDef& node : item.graph.node()) {
+    node_fingerprints[node.name()] = FingerprintProto(node);
+  }
+
+  Status s;
+  auto it = entries_.find(item.id);
+  if (it != entries_.end() && it->second.options == options &&
+      it->second.item_fingerprint == item_fingerprint) {
+    const Entry& entry = it->second;
+    absl::flat_hash_set<string> updated_nodes;
+    for (const auto& node : node_fingerprints) {
+      auto previous = entry.node_fingerprints.find(node.first);
+      if (previous == entry.node_fingerprints.end() ||
+          previous->second != node.second) {
+        updated_nodes.insert(node.first);
+      }
+    }
+    s = properties->InferStaticallyInternal(options, &entry.input_properties,
+                                            &entry.output_properties,
+                                            &updated_nodes);
+  } else {
+    s = properties->InferStaticallyInternal(options, nullptr, nullptr,
+                                            nullptr);
+  }
+  if (!s.ok()) {
+    entries_.erase(item.id);
+    return s;
+  }
+
+  Entry& entry = entries_[item.id];
+  entry.options = options;
+  entry.item_fingerprint = item_fingerprint;
+  entry.node_fingerprints = std::move(node_fingerprints);
+  entry.input_properties = properties->input_properties_;
+  entry.output_properties = properties->output_properties_;
+  return Status::OK();
+}
+
 }  // end namespace grappler
 }  // end namespace tensorflow
@@ -21,10 +21,13 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/optional.h"
 #include "tensorflow/core/framework/shape_inference.h"
 #include "tensorflow/core/grappler/clusters/cluster.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
 #include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/platform/macros.h"
 
 namespace tensorflow {
 
@@ -114,6 +117,19 @@ class GraphProperties {
                            /*aggressive_shape_inference=*/false,
                            /*include_tensor_values=*/true);
   }
+  // Same as InferStatically, but reuses the properties `previous` inferred
+  // with the same options for an earlier version of the graph: only the nodes
+  // in `updated_nodes`, the nodes `previous` has no properties for, and their
+  // transitive fanout are inferred again. `updated_nodes` must contain all the
+  // nodes that were added or modified since then, including the ones whose
+  // inputs changed. Falls back to inferring the shapes of the whole graph if
+  // the options differ, if aggressive_shape_inference is set, if the graph has
+  // loops or queues, or if most of the graph must be inferred again anyway.
+  Status InferStaticallyIncrementally(
+      const GraphProperties& previous,
+      const absl::flat_hash_set<string>& updated_nodes,
+      bool assume_valid_feeds, bool aggressive_shape_inference,
+      bool include_input_tensor_values, bool include_output_tensor_values);
   // Infer the shape by running the graph on the specified cluster and recording
   // the shapes of the processed tensors.
   Status InferDynamically(Cluster* cluster);
@@ -158,6 +174,37 @@ class GraphProperties {
   }
 
  private:
+  friend class GraphPropertiesCache;
+
+  using PropertiesMap =
+      absl::flat_hash_map<string, std::vector<OpInfo::TensorProperties>>;
+
+  // The options of InferStatically.
+  struct InferenceOptions {
+    bool assume_valid_feeds;
+    bool aggressive_shape_inference;
+    bool include_input_tensor_values;
+    bool include_output_tensor_values;
+
+    bool operator==(const InferenceOptions& other) const {
+      return assume_valid_feeds == other.assume_valid_feeds &&
+             aggressive_shape_inference == other.aggressive_shape_inference &&
+             include_input_tensor_values ==
+                 other.include_input_tensor_values &&
+             include_output_tensor_values == other.include_output_tensor_values;
+    }
+  };
+
+  // Infers the shapes of the whole graph if `updated_nodes` is null.
+  // Otherwise, only infers the shapes of the nodes in `updated_nodes`, of the
+  // nodes missing from `previous_output_properties`, and of their transitive
+  // fanout, and takes the properties of the other nodes from `previous_*`.
+  Status InferStaticallyInternal(
+      const InferenceOptions& options,
+      const PropertiesMap* previous_input_properties,
+      const PropertiesMap* previous_output_properties,
+      const absl::flat_hash_set<string>* updated_nodes);
+
   // Relaxes shapes <shapes_and_types>, determined from an EnqueueV2 node, into
   // <*queue_shapes_and_types>.
   static Status RelaxEnqueueShapesAndMergeTypes(
@@ -201,17 +248,73 @@ class GraphProperties {
 
   // Data members
   const GrapplerItem& item_;
-  absl::flat_hash_map<string, std::vector<OpInfo::TensorProperties>>
-      input_properties_;
-  absl::flat_hash_map<string, std::vector<OpInfo::TensorProperties>>
-      output_properties_;
+  PropertiesMap input_properties_;
+  PropertiesMap output_properties_;
   const std::vector<OpInfo::TensorProperties> missing_properties_;
 
+  // The options of the last successful static inference, if any.
+  absl::optional<InferenceOptions> inferred_options_;
+
   // Nodes with output shape incompatible between shape inference and
   // annotation.
   std::unordered_set<string> incompatible_shape_nodes_;
 };
 
+// Keeps the properties statically inferred for the last version of each graph,
+// identified by the id of its GrapplerItem, so that the shapes of a later
+// version are inferred incrementally: the nodes that changed are found by
+// comparing the nodes of both versions. The InferStatically calls made by a
+// thread holding a GraphPropertiesCache::Scope go through the cache. This
+// lets the successive optimizers run by the MetaOptimizer on a graph reuse the
+// shapes inferred by the previous ones.
+//
+// This class is not thread-safe.
+class GraphPropertiesCache {
+ public:
+  GraphPropertiesCache() = default;
+
+  // Makes the InferStatically calls of the current thread use `cache`, which
+  // may be null, until the scope is destroyed.
+  class Scope {
+   public:
+    explicit Scope(GraphPropertiesCache* cache);
+    ~Scope();
+
+   private:
+    GraphPropertiesCache* const previous_;
+
+    TF_DISALLOW_COPY_AND_ASSIGN(Scope);
+  };
+
+  // Returns the cache used by the current thread, or null.
+  static GraphPropertiesCache* Current();
+
+  // The number of graphs with cached properties.
+  int num_entries() const { return entries_.size(); }
+
+ private:
+  friend class GraphProperties;
+
+  struct Entry {
+    GraphProperties::InferenceOptions options;
+    // Fingerprint of the function library and feeds of the graph.
+    uint64 item_fingerprint;
+    absl::flat_hash_map<string, uint64> node_fingerprints;
+    GraphProperties::PropertiesMap input_properties;
+    GraphProperties::PropertiesMap output_properties;
+  };
+
+  // Infers the properties of the graph of `properties`, incrementally if the
+  // properties of a previous version of the graph are cached, and caches
+  // them.
+  Status InferStatically(GraphProperties* properties,
+                         const GraphProperties::InferenceOptions& options);
+
+  absl::flat_hash_map<string, Entry> entries_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(GraphPropertiesCache);
+};
+
 // Helper function for GraphProperties.
 bool IsShapeFullyDefinedIntegerVectorOrScalar(
     shape_inference::InferenceContext* ic,
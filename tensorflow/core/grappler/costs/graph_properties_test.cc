@@ -2433,6 +2433,109 @@ TEST(HelperFunctions, IsShapeFullyDefinedIntegerVectorOrScalar) {
   EXPECT_FALSE(IsShapeFullyDefinedIntegerVectorOrScalar(
       &ic, fully_defined_vector, vector_with_unknown_from_const, DT_INT32));
 }
+
+// Returns a graph with a [?, 10] input, a fanout that depends on the shape of
+// its nodes, and a longer branch ending in "u".
+GrapplerItem MakeIncrementalInferenceItem() {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x =
+      ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                       ops::Placeholder::Shape(PartialTensorShape({-1, 10})));
+  Output y = ops::Square(s.WithOpName("y"), x);
+  Output z = ops::Neg(s.WithOpName("z"), y);
+  Output shape = ops::Shape(s.WithOpName("shape"), z);
+  Output w = ops::Reshape(s.WithOpName("w"), y, shape);
+  Output u = x;
+  for (int i = 0; i < 8; ++i) {
+    u = ops::Sqrt(s.WithOpName(i == 7 ? "u" : strings::StrCat("sqrt", i)), u);
+  }
+  GrapplerItem item;
+  item.id = "tf_graph";
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  return item;
+}
+
+// Replaces the Neg node of the graph with a Relu, and adds a Tanh node in its
+// fanout.
+void UpdateIncrementalInferenceItem(GrapplerItem* item) {
+  for (NodeDef& node : *item->graph.mutable_node()) {
+    if (node.name() == "z") node.set_op("Relu");
+  }
+  NodeDef* v = item->graph.add_node();
+  v->set_name("v");
+  v->set_op("Tanh");
+  v->add_input("z");
+  (*v->mutable_attr())["T"].set_type(DT_FLOAT);
+}
+
+TEST_F(GraphPropertiesTest, InferStaticallyIncrementally) {
+  GrapplerItem item = MakeIncrementalInferenceItem();
+  GraphProperties previous(item);
+  TF_ASSERT_OK(previous.InferStatically(/*assume_valid_feeds=*/false));
+
+  GrapplerItem updated_item = item;
+  UpdateIncrementalInferenceItem(&updated_item);
+  GraphProperties properties(updated_item);
+  TF_ASSERT_OK(properties.InferStaticallyIncrementally(
+      previous, /*updated_nodes=*/{"z", "v"}, /*assume_valid_feeds=*/false,
+      /*aggressive_shape_inference=*/false,
+      /*include_input_tensor_values=*/true,
+      /*include_output_tensor_values=*/true));
+
+  GraphProperties expected(updated_item);
+  TF_ASSERT_OK(expected.InferStatically(/*assume_valid_feeds=*/false));
+  for (const NodeDef& node : updated_item.graph.node()) {
+    const auto& inputs = properties.GetInputProperties(node.name());
+    const auto& expected_inputs = expected.GetInputProperties(node.name());
+    ASSERT_EQ(inputs.size(), expected_inputs.size()) << node.name();
+    for (int i = 0; i < inputs.size(); ++i) {
+      EXPECT_EQ(PropToString(inputs[i]), PropToString(expected_inputs[i]));
+    }
+    const auto& outputs = properties.GetOutputProperties(node.name());
+    const auto& expected_outputs = expected.GetOutputProperties(node.name());
+    ASSERT_EQ(outputs.size(), expected_outputs.size()) << node.name();
+    for (int i = 0; i < outputs.size(); ++i) {
+      EXPECT_EQ(PropToString(outputs[i]), PropToString(expected_outputs[i]));
+    }
+  }
+  EXPECT_EQ("float: [-1,10]",
+            PropToString(properties.GetOutputProperties("v")[0]));
+
+  // The symbolic dimensions of the nodes that were inferred again match the
+  // ones of the other nodes.
+  const int64 batch_size =
+      properties.GetOutputProperties("x")[0].shape().dim(0).size();
+  EXPECT_LT(batch_size, -1);
+  EXPECT_EQ(batch_size,
+            properties.GetOutputProperties("u")[0].shape().dim(0).size());
+  EXPECT_EQ(batch_size,
+            properties.GetOutputProperties("v")[0].shape().dim(0).size());
+  EXPECT_EQ(batch_size,
+            properties.GetOutputProperties("w")[0].shape().dim(0).size());
+}
+
+TEST_F(GraphPropertiesTest, GraphPropertiesCache) {
+  GrapplerItem item = MakeIncrementalInferenceItem();
+  GrapplerItem updated_item = item;
+  UpdateIncrementalInferenceItem(&updated_item);
+
+  GraphPropertiesCache cache;
+  {
+    GraphPropertiesCache::Scope scope(&cache);
+    EXPECT_EQ(&cache, GraphPropertiesCache::Current());
+    GraphProperties previous(item);
+    TF_ASSERT_OK(previous.InferStatically(/*assume_valid_feeds=*/false));
+    GraphProperties properties(updated_item);
+    TF_ASSERT_OK(properties.InferStatically(/*assume_valid_feeds=*/false));
+    EXPECT_EQ(1, cache.num_entries());
+    EXPECT_EQ("float: [-1,10]",
+              PropToString(properties.GetOutputProperties("v")[0]));
+    EXPECT_EQ(properties.GetOutputProperties("x")[0].shape().dim(0).size(),
+              properties.GetOutputProperties("v")[0].shape().dim(0).size());
+  }
+  EXPECT_EQ(nullptr, GraphPropertiesCache::Current());
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
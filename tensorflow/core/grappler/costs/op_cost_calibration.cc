@@ -0,0 +1,273 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_calibration.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/grappler/costs/op_context.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/robust_stats.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// The name of the benchmarked op in the calibration items.
+constexpr char kOpName[] = "op";
+
+// Builds an item running a single op on random inputs.
+class CalibrationItemBuilder {
+ public:
+  explicit CalibrationItemBuilder(const string& id) { item_.id = id; }
+
+  // Adds a constant int32 vector, and returns its name.
+  string AddConst(const std::vector<int32>& values) {
+    Tensor tensor(DT_INT32, TensorShape({static_cast<int64>(values.size())}));
+    std::copy(values.begin(), values.end(), tensor.flat<int32>().data());
+    const string name = absl::StrCat("const_", item_.graph.node_size());
+    AddNode(NodeDefBuilder(name, "Const")
+                .Attr("dtype", DT_INT32)
+                .Attr("value", tensor));
+    return name;
+  }
+
+  // Adds a random float tensor of shape `dims`, and returns its name.
+  string AddRandomInput(const std::vector<int32>& dims) {
+    const string shape = AddConst(dims);
+    const string name = absl::StrCat("input_", item_.graph.node_size());
+    AddNode(NodeDefBuilder(name, "RandomUniform")
+                .Input(shape, 0, DT_INT32)
+                .Attr("dtype", DT_FLOAT));
+    return name;
+  }
+
+  // Adds the benchmarked op, and appends the item to `items`.
+  Status Build(NodeDefBuilder& op, std::vector<GrapplerItem>* items) {
+    AddNode(op);
+    TF_RETURN_IF_ERROR(status_);
+    item_.fetch.push_back(kOpName);
+    items->push_back(std::move(item_));
+    return Status::OK();
+  }
+
+ private:
+  void AddNode(NodeDefBuilder& builder) {
+    if (status_.ok()) status_ = builder.Finalize(item_.graph.add_node());
+  }
+
+  GrapplerItem item_;
+  Status status_;
+};
+
+// Fits the overhead and scale of `op_calibration` to the pairs of estimated
+// and measured execution times in `samples`.
+void FitOverheadAndScale(const std::vector<std::pair<double, double>>& samples,
+                         OpCostCalibration::OpCalibration* op_calibration) {
+  const double n = samples.size();
+  double sum_x = 0.0;
+  double sum_y = 0.0;
+  double sum_xx = 0.0;
+  double sum_xy = 0.0;
+  for (const auto& sample : samples) {
+    sum_x += sample.first;
+    sum_y += sample.second;
+    sum_xx += sample.first * sample.first;
+    sum_xy += sample.first * sample.second;
+  }
+
+  double overhead = 0.0;
+  double scale = 0.0;
+  const double variance_x = sum_xx - sum_x * sum_x / n;
+  if (variance_x > 0.0) {
+    scale = (sum_xy - sum_x * sum_y / n) / variance_x;
+    overhead = (sum_y - scale * sum_x) / n;
+    if (scale < 0.0) {
+      // The measured times do not grow with the estimates.
+      scale = 0.0;
+      overhead = sum_y / n;
+    } else if (overhead < 0.0) {
+      overhead = 0.0;
+      scale = sum_xy / sum_xx;
+    }
+  } else if (sum_xx > 0.0) {
+    // All the estimates are the same: attribute the times to the estimates.
+    scale = sum_xy / sum_xx;
+  } else {
+    overhead = sum_y / n;
+  }
+  op_calibration->set_overhead_ns(overhead);
+  op_calibration->set_scale(scale);
+  op_calibration->set_num_measurements(samples.size());
+}
+
+}  // namespace
+
+Status MakeOpCostCalibrationItems(std::vector<GrapplerItem>* items) {
+  const std::vector<int32> element_counts = {1 << 10, 1 << 14, 1 << 18,
+                                             1 << 22};
+  for (const char* op : {"Exp", "Relu", "Sigmoid", "Square", "Tanh"}) {
+    for (int32 count : element_counts) {
+      CalibrationItemBuilder builder(absl::StrCat(op, "_", count));
+      const string x = builder.AddRandomInput({count});
+      TF_RETURN_IF_ERROR(builder.Build(
+          NodeDefBuilder(kOpName, op).Input(x, 0, DT_FLOAT), items));
+    }
+  }
+  for (const char* op : {"AddV2", "Mul"}) {
+    for (int32 count : element_counts) {
+      CalibrationItemBuilder builder(absl::StrCat(op, "_", count));
+      const string x = builder.AddRandomInput({count});
+      const string y = builder.AddRandomInput({count});
+      TF_RETURN_IF_ERROR(builder.Build(NodeDefBuilder(kOpName, op)
+                                           .Input(x, 0, DT_FLOAT)
+                                           .Input(y, 0, DT_FLOAT),
+                                       items));
+    }
+  }
+  // Reductions and bias additions over the innermost dimension.
+  constexpr int32 kDepth = 256;
+  for (int32 count : element_counts) {
+    CalibrationItemBuilder builder(absl::StrCat("Sum_", count));
+    const string x = builder.AddRandomInput({count / kDepth, kDepth});
+    const string axis = builder.AddConst({1});
+    TF_RETURN_IF_ERROR(builder.Build(NodeDefBuilder(kOpName, "Sum")
+                                         .Input(x, 0, DT_FLOAT)
+                                         .Input(axis, 0, DT_INT32),
+                                     items));
+  }
+  for (int32 count : element_counts) {
+    CalibrationItemBuilder builder(absl::StrCat("BiasAdd_", count));
+    const string x = builder.AddRandomInput({count / kDepth, kDepth});
+    const string bias = builder.AddRandomInput({kDepth});
+    TF_RETURN_IF_ERROR(builder.Build(NodeDefBuilder(kOpName, "BiasAdd")
+                                         .Input(x, 0, DT_FLOAT)
+                                         .Input(bias, 0, DT_FLOAT),
+                                     items));
+  }
+  for (int32 size : {32, 128, 512, 1024}) {
+    CalibrationItemBuilder builder(absl::StrCat("MatMul_", size));
+    const string a = builder.AddRandomInput({size, size});
+    const string b = builder.AddRandomInput({size, size});
+    TF_RETURN_IF_ERROR(builder.Build(NodeDefBuilder(kOpName, "MatMul")
+                                         .Input(a, 0, DT_FLOAT)
+                                         .Input(b, 0, DT_FLOAT),
+                                     items));
+  }
+  // Input and filter shapes of typical image model convolutions.
+  const std::vector<std::pair<std::vector<int32>, std::vector<int32>>>
+      conv_shapes = {{{1, 112, 112, 32}, {1, 1, 32, 64}},
+                     {{1, 56, 56, 64}, {3, 3, 64, 64}},
+                     {{8, 28, 28, 128}, {3, 3, 128, 128}},
+                     {{1, 14, 14, 256}, {3, 3, 256, 256}},
+                     {{1, 7, 7, 512}, {1, 1, 512, 2048}}};
+  for (const auto& shapes : conv_shapes) {
+    CalibrationItemBuilder builder(
+        absl::StrCat("Conv2D_", absl::StrJoin(shapes.first, "x"), "_",
+                     absl::StrJoin(shapes.second, "x")));
+    const string input = builder.AddRandomInput(shapes.first);
+    const string filter = builder.AddRandomInput(shapes.second);
+    TF_RETURN_IF_ERROR(builder.Build(NodeDefBuilder(kOpName, "Conv2D")
+                                         .Input(input, 0, DT_FLOAT)
+                                         .Input(filter, 0, DT_FLOAT)
+                                         .Attr("strides", {1, 1, 1, 1})
+                                         .Attr("padding", "SAME"),
+                                     items));
+  }
+  return Status::OK();
+}
+
+Status MeasureOpCosts(Cluster* cluster, const std::vector<GrapplerItem>& items,
+                      int num_runs, OpPerformanceList* measurements) {
+  for (const GrapplerItem& item : items) {
+    if (item.fetch.size() != 1) {
+      return errors::InvalidArgument("Item ", item.id,
+                                     " must fetch exactly one op");
+    }
+    TF_RETURN_IF_ERROR(cluster->Initialize(item));
+    RunMetadata metadata;
+    TF_RETURN_IF_ERROR(cluster->Run(item, &metadata));
+
+    std::vector<double> times;
+    OpPerformance performance;
+    for (int i = 0; i < num_runs; ++i) {
+      metadata.Clear();
+      TF_RETURN_IF_ERROR(cluster->Run(item, &metadata));
+      OpPerformanceList run =
+          CostGraphToOpPerformanceData(metadata.cost_graph(), item.graph);
+      for (OpPerformance& op_performance : *run.mutable_op_performance()) {
+        if (op_performance.node() == item.fetch[0]) {
+          times.push_back(op_performance.compute_cost());
+          performance.Swap(&op_performance);
+          break;
+        }
+      }
+    }
+    if (times.empty()) {
+      LOG(WARNING) << "No cost measured for " << item.id;
+      continue;
+    }
+    performance.set_compute_cost(RobustStats(std::move(times)).mean());
+    VLOG(1) << "Measured " << item.id << " in " << performance.compute_cost()
+            << " ns";
+    measurements->add_op_performance()->Swap(&performance);
+  }
+  return Status::OK();
+}
+
+Status FitOpCostCalibration(const OpPerformanceList& measurements,
+                            OpCostCalibration* calibration) {
+  calibration->Clear();
+  if (measurements.op_performance().empty()) {
+    return errors::InvalidArgument("No measurements to fit");
+  }
+  *calibration->mutable_device() =
+      measurements.op_performance(0).op().device();
+
+  OpLevelCostEstimator estimator;
+  estimator.set_calibration(nullptr);
+  // Pairs of estimated and measured execution times of each op.
+  std::map<string, std::vector<std::pair<double, double>>> samples;
+  for (const OpPerformance& performance : measurements.op_performance()) {
+    if (performance.op().device().type() != calibration->device().type() ||
+        performance.compute_cost() <= 0) {
+      continue;
+    }
+    OpContext op_context;
+    op_context.name = performance.node();
+    op_context.op_info = performance.op();
+    const Costs costs = estimator.PredictCosts(op_context);
+    samples[performance.op().op()].emplace_back(
+        costs.execution_time.count(), performance.compute_cost());
+  }
+
+  for (const auto& op_samples : samples) {
+    FitOverheadAndScale(op_samples.second,
+                        &(*calibration->mutable_ops())[op_samples.first]);
+  }
+  return Status::OK();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
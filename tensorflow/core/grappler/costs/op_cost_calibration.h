@@ -0,0 +1,50 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_CALIBRATION_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_CALIBRATION_H_
+
+#include <vector>
+
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Returns a sweep of microbenchmarks over common ops and shapes: elementwise
+// ops, reductions, MatMul and Conv2D. Each item runs a single op on random
+// inputs, and fetches it.
+Status MakeOpCostCalibrationItems(std::vector<GrapplerItem>* items);
+
+// Runs each of `items` `num_runs` times on `cluster`, after a warmup run, and
+// appends the robust mean of the measured execution times of the fetched op to
+// `measurements`.
+Status MeasureOpCosts(Cluster* cluster, const std::vector<GrapplerItem>& items,
+                      int num_runs, OpPerformanceList* measurements);
+
+// Fits the calibration of each op in `measurements`, on the device of the
+// first measurement. The measured execution times are fitted by least squares
+// to an overhead plus a multiple of the times estimated by an uncalibrated
+// OpLevelCostEstimator, with both coefficients kept non-negative.
+Status FitOpCostCalibration(const OpPerformanceList& measurements,
+                            OpCostCalibration* calibration);
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_CALIBRATION_H_
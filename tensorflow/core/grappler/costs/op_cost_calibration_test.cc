@@ -0,0 +1,131 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_calibration.h"
+
+#include <memory>
+
+#include "tensorflow/core/grappler/clusters/single_machine.h"
+#include "tensorflow/core/grappler/costs/op_context.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+OpContext DescribeMatMul(int size) {
+  OpContext op_context;
+  OpInfo& op_info = op_context.op_info;
+  op_info.set_op("MatMul");
+  DeviceProperties* device = op_info.mutable_device();
+  device->set_type("CPU");
+  device->set_num_cores(10);
+  device->set_bandwidth(10000000);
+  device->set_frequency(1000);
+  for (int i = 0; i < 2; ++i) {
+    OpInfo::TensorProperties* input = op_info.add_inputs();
+    input->set_dtype(DT_FLOAT);
+    input->mutable_shape()->add_dim()->set_size(size);
+    input->mutable_shape()->add_dim()->set_size(size);
+  }
+  return op_context;
+}
+
+double UncalibratedTime(const OpContext& op_context) {
+  OpLevelCostEstimator estimator;
+  estimator.set_calibration(nullptr);
+  return estimator.PredictCosts(op_context).execution_time.count();
+}
+
+TEST(OpCostCalibrationTest, FitsOverheadAndScale) {
+  OpPerformanceList measurements;
+  for (int size : {16, 64, 256, 1024}) {
+    const OpContext op_context = DescribeMatMul(size);
+    OpPerformance* performance = measurements.add_op_performance();
+    *performance->mutable_op() = op_context.op_info;
+    performance->set_compute_cost(5000 + 3 * UncalibratedTime(op_context));
+  }
+
+  auto calibration = std::make_shared<OpCostCalibration>();
+  TF_ASSERT_OK(FitOpCostCalibration(measurements, calibration.get()));
+  EXPECT_EQ(calibration->device().type(), "CPU");
+  ASSERT_EQ(calibration->ops().size(), 1);
+  const OpCostCalibration::OpCalibration& op_calibration =
+      calibration->ops().at("MatMul");
+  EXPECT_NEAR(op_calibration.overhead_ns(), 5000, 10);
+  EXPECT_NEAR(op_calibration.scale(), 3, 1e-3);
+  EXPECT_EQ(op_calibration.num_measurements(), 4);
+
+  const OpContext op_context = DescribeMatMul(128);
+  OpLevelCostEstimator estimator;
+  estimator.set_calibration(calibration);
+  EXPECT_NEAR(estimator.PredictCosts(op_context).execution_time.count(),
+              5000 + 3 * UncalibratedTime(op_context), 10);
+
+  // The estimates of ops on other types of devices are not calibrated.
+  OpContext gpu_op_context = op_context;
+  gpu_op_context.op_info.mutable_device()->set_type("GPU");
+  EXPECT_EQ(estimator.PredictCosts(gpu_op_context).execution_time.count(),
+            UncalibratedTime(gpu_op_context));
+}
+
+TEST(OpCostCalibrationTest, KeepsCoefficientsNonNegative) {
+  OpPerformanceList measurements;
+  // The measured times decrease with the estimates.
+  for (int size : {16, 64, 256}) {
+    OpPerformance* performance = measurements.add_op_performance();
+    *performance->mutable_op() = DescribeMatMul(size).op_info;
+    performance->set_compute_cost(100000 / size);
+  }
+
+  OpCostCalibration calibration;
+  TF_ASSERT_OK(FitOpCostCalibration(measurements, &calibration));
+  const OpCostCalibration::OpCalibration& op_calibration =
+      calibration.ops().at("MatMul");
+  EXPECT_EQ(op_calibration.scale(), 0);
+  EXPECT_NEAR(op_calibration.overhead_ns(), (6250 + 1562 + 390) / 3.0, 1);
+
+  EXPECT_FALSE(FitOpCostCalibration(OpPerformanceList(), &calibration).ok());
+}
+
+TEST(OpCostCalibrationTest, MeasuresOpCosts) {
+  std::vector<GrapplerItem> items;
+  TF_ASSERT_OK(MakeOpCostCalibrationItems(&items));
+  ASSERT_FALSE(items.empty());
+  for (const GrapplerItem& item : items) {
+    ASSERT_EQ(item.fetch.size(), 1) << item.id;
+  }
+
+  SingleMachine cluster(/*timeout_s=*/60, /*num_cpu_cores=*/2,
+                        /*num_gpus=*/0);
+  cluster.DisableOptimizer(true);
+  TF_ASSERT_OK(cluster.Provision());
+  // The first item is the smallest elementwise op.
+  items.resize(1);
+  OpPerformanceList measurements;
+  TF_ASSERT_OK(MeasureOpCosts(&cluster, items, /*num_runs=*/3, &measurements));
+  TF_ASSERT_OK(cluster.Shutdown());
+  ASSERT_EQ(measurements.op_performance_size(), 1);
+  const OpPerformance& performance = measurements.op_performance(0);
+  EXPECT_EQ(performance.op().op(), "Exp");
+  EXPECT_EQ(performance.op().device().type(), "CPU");
+  EXPECT_GE(performance.compute_cost(), 0);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
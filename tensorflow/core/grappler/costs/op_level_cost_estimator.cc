@@ -26,6 +26,8 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/utils.h"
 #include "tensorflow/core/grappler/costs/op_context.h"
 #include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -636,9 +638,50 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
 
   // By default, use sum of memory_time and compute_time for execution_time.
   compute_memory_overlap_ = false;
+
+  // The calibration is read once, and shared by all the estimators.
+  static const std::shared_ptr<const OpCostCalibration>* default_calibration =
+      []() {
+        auto* calibration = new std::shared_ptr<const OpCostCalibration>();
+        string path;
+        Status s = ReadStringFromEnvVar("TF_GRAPPLER_COST_CALIBRATION", "",
+                                        &path);
+        if (s.ok() && !path.empty()) {
+          auto proto = std::make_shared<OpCostCalibration>();
+          s = ReadTextOrBinaryProto(Env::Default(), path, proto.get());
+          if (s.ok()) *calibration = std::move(proto);
+        }
+        if (!s.ok()) {
+          LOG(WARNING) << "Ignoring the op cost calibration: " << s;
+        }
+        return calibration;
+      }();
+  calibration_ = *default_calibration;
 }
 
 Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
+  Costs costs = PredictUncalibratedCosts(op_context);
+  if (calibration_ != nullptr) CalibrateCosts(op_context.op_info, &costs);
+  return costs;
+}
+
+void OpLevelCostEstimator::CalibrateCosts(const OpInfo& op_info,
+                                          Costs* costs) const {
+  if (op_info.device().type() != calibration_->device().type()) return;
+  auto it = calibration_->ops().find(op_info.op());
+  if (it == calibration_->ops().end()) return;
+  const OpCostCalibration::OpCalibration& op_calibration = it->second;
+  const double execution_time_ns =
+      op_calibration.overhead_ns() +
+      op_calibration.scale() * costs->execution_time.count();
+  VLOG(1) << "Calibrated the execution time of operation " << op_info.op()
+          << " from " << costs->execution_time.count() << " to "
+          << execution_time_ns << " ns.";
+  costs->execution_time = Costs::NanoSeconds(execution_time_ns);
+}
+
+Costs OpLevelCostEstimator::PredictUncalibratedCosts(
+    const OpContext& op_context) const {
   const auto& op_info = op_context.op_info;
   auto it = device_cost_impl_.find(op_info.op());
   if (it != device_cost_impl_.end()) {
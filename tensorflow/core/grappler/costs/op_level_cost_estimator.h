@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_OP_LEVEL_COST_ESTIMATOR_H_
 #define TENSORFLOW_CORE_GRAPPLER_COSTS_OP_LEVEL_COST_ESTIMATOR_H_
 
+#include <memory>
+
 #include "tensorflow/core/grappler/costs/cost_estimator.h"
 #include "tensorflow/core/grappler/costs/op_context.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
@@ -39,7 +41,19 @@ class OpLevelCostEstimator {
   // Returns basic device performance info.
   virtual DeviceInfo GetDeviceInfo(const DeviceProperties& device) const;
 
+  // Calibrates the predicted execution times with `calibration`, typically
+  // fitted by FitOpCostCalibration, or disables the calibration if null. By
+  // default, the calibration is read from the file named by the
+  // TF_GRAPPLER_COST_CALIBRATION environment variable, if it is set.
+  void set_calibration(std::shared_ptr<const OpCostCalibration> calibration) {
+    calibration_ = std::move(calibration);
+  }
+
  protected:
+  // Predicts the costs of an op from the roofline model of its device, before
+  // calibration.
+  Costs PredictUncalibratedCosts(const OpContext& op_context) const;
+
   // Predict cost of an op for which no accurate estimator is defined.
   Costs PredictCostOfAnUnknownOp(const OpContext& op_context) const;
 
@@ -212,6 +226,10 @@ class OpLevelCostEstimator {
   std::set<string> persistent_ops_;
 
  private:
+  void CalibrateCosts(const OpInfo& op_info, Costs* costs) const;
+
+  std::shared_ptr<const OpCostCalibration> calibration_;
+
   friend class OpLevelCostEstimatorTest;
 };
 
@@ -0,0 +1,439 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/cpu_blocked_layout_optimizer.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/symbolic_shapes.h"
+#include "tensorflow/core/kernels/direct_conv2d_tile.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// The optimizer works in three steps:
+//
+// 1. Find the candidate nodes that have a blocked layout implementation:
+//    convolutions with shallow inputs (at most direct_conv2d::kMaxInDepth
+//    channels), bias additions and poolings, and the element-wise ops whose
+//    data inputs are all produced by candidates. Element-wise ops run
+//    unchanged on blocked tensors: the layout only permutes the elements.
+// 2. Group the candidates in connected chains, and drop the chains without a
+//    convolution or with a single node, where the layout conversions would
+//    cost more than the blocked kernels save.
+// 3. Rewrite every node 'X' of a chain to a blocked node 'X/blocked' that
+//    reads the blocked outputs of the chain, inserting a _ToBlockedLayout node
+//    per tensor entering the chain. 'X' itself is replaced with a
+//    _FromBlockedLayout node of 'X/blocked' if it is still consumed outside
+//    of the chain, and removed otherwise.
+
+namespace {
+
+constexpr char kBlockedSuffix[] = "/blocked";
+constexpr char kToBlockedSuffix[] = "/to_blocked";
+
+enum class CandidateKind { kNone, kAnchor, kUnary, kBinary };
+
+bool IsLayoutAgnosticUnaryOp(const NodeDef& node) {
+  static const auto* ops = new absl::flat_hash_set<string>{
+      "Elu", "LeakyRelu", "Relu", "Relu6", "Sigmoid", "Tanh"};
+  return ops->contains(node.op());
+}
+
+bool IsLayoutAgnosticBinaryOp(const NodeDef& node) {
+  static const auto* ops = new absl::flat_hash_set<string>{
+      "Add", "AddV2", "Maximum", "Minimum", "Mul", "Sub"};
+  return ops->contains(node.op());
+}
+
+bool HasNhwcDataFormat(const NodeDef& node) {
+  const AttrValue* data_format = AttrSlice(node).Find("data_format");
+  return data_format == nullptr || data_format->s() == "NHWC";
+}
+
+bool HasBlockedPadding(const NodeDef& node) {
+  const AttrValue* padding = AttrSlice(node).Find("padding");
+  return padding != nullptr &&
+         (padding->s() == "SAME" || padding->s() == "VALID");
+}
+
+// Returns true if the NHWC 'attr' has 1 for the batch and channels.
+bool IsSpatialWindowAttr(const NodeDef& node, const string& attr) {
+  const AttrValue* value = AttrSlice(node).Find(attr);
+  if (value == nullptr) return attr == "dilations";
+  const auto& list = value->list().i();
+  return list.size() == 4 && list[0] == 1 && list[3] == 1;
+}
+
+bool IsSupportedFusedConv2D(const NodeDef& node) {
+  const AttrValue* fused_ops = AttrSlice(node).Find("fused_ops");
+  if (fused_ops == nullptr) return false;
+  const auto& ops = fused_ops->list().s();
+  if (ops.empty() || ops.size() > 2 || ops[0] != "BiasAdd") return false;
+  if (ops.size() == 1) return true;
+  return ops[1] == "Relu" || ops[1] == "Relu6" || ops[1] == "Elu" ||
+         ops[1] == "LeakyRelu";
+}
+
+// Returns the static NHWC shape of output 0 of 'node' if it has rank 4 and a
+// known number of channels.
+const TensorShapeProto* Nhwc4DOutputShape(const GraphProperties& properties,
+                                          const NodeDef& node) {
+  if (!properties.HasOutputProperties(node.name())) return nullptr;
+  const auto& outputs = properties.GetOutputProperties(node.name());
+  if (outputs.empty()) return nullptr;
+  const TensorShapeProto& shape = outputs[0].shape();
+  if (shape.unknown_rank() || shape.dim_size() != 4 ||
+      shape.dim(3).size() <= 0) {
+    return nullptr;
+  }
+  return &shape;
+}
+
+CandidateKind GetCandidateKind(const GraphProperties& properties,
+                               const NodeDef& node) {
+  if (!NodeIsOnCpu(&node) || GetDataTypeFromAttr(node, "T") != DT_FLOAT ||
+      !HasNhwcDataFormat(node) ||
+      Nhwc4DOutputShape(properties, node) == nullptr) {
+    return CandidateKind::kNone;
+  }
+
+  if (node.op() == "Conv2D" || node.op() == "_FusedConv2D") {
+    if (!HasBlockedPadding(node) || !IsSpatialWindowAttr(node, "strides") ||
+        !IsSpatialWindowAttr(node, "dilations")) {
+      return CandidateKind::kNone;
+    }
+    if (node.op() == "_FusedConv2D" && !IsSupportedFusedConv2D(node)) {
+      return CandidateKind::kNone;
+    }
+    // Grouped convolutions are not supported.
+    const auto& inputs = properties.GetInputProperties(node.name());
+    if (inputs.size() < 2 || inputs[0].shape().dim_size() != 4 ||
+        inputs[1].shape().dim_size() != 4 ||
+        inputs[0].shape().dim(3).size() <= 0 ||
+        inputs[0].shape().dim(3).size() != inputs[1].shape().dim(2).size()) {
+      return CandidateKind::kNone;
+    }
+    // _BlockedConv2D is a direct convolution: like DirectConv2D, it is only
+    // faster than the GEMM based Conv2D for shallow inputs.
+    if (inputs[0].shape().dim(3).size() > direct_conv2d::kMaxInDepth) {
+      return CandidateKind::kNone;
+    }
+    return CandidateKind::kAnchor;
+  }
+  if (node.op() == "MaxPool" || node.op() == "AvgPool") {
+    return HasBlockedPadding(node) && IsSpatialWindowAttr(node, "ksize") &&
+                   IsSpatialWindowAttr(node, "strides")
+               ? CandidateKind::kAnchor
+               : CandidateKind::kNone;
+  }
+  if (node.op() == "BiasAdd") return CandidateKind::kAnchor;
+  if (IsLayoutAgnosticUnaryOp(node)) return CandidateKind::kUnary;
+  if (IsLayoutAgnosticBinaryOp(node)) {
+    // Both inputs must have the output shape: broadcasting does not commute
+    // with the layout conversion.
+    const auto& inputs = properties.GetInputProperties(node.name());
+    const TensorShapeProto* output = Nhwc4DOutputShape(properties, node);
+    if (inputs.size() == 2 && ShapesSymbolicallyEqual(inputs[0].shape(),
+                                                      *output) &&
+        ShapesSymbolicallyEqual(inputs[1].shape(), *output) &&
+        ShapeIsSymbolicallyDefined(*output)) {
+      return CandidateKind::kBinary;
+    }
+  }
+  return CandidateKind::kNone;
+}
+
+// Returns the number of data inputs of a candidate that read the blocked
+// layout. The other inputs (filters, biases) keep their layout.
+int NumBlockedInputs(CandidateKind kind) {
+  return kind == CandidateKind::kBinary ? 2 : 1;
+}
+
+// Union-find over node indices.
+int FindRoot(std::vector<int>* parents, int i) {
+  while ((*parents)[i] != i) {
+    (*parents)[i] = (*parents)[(*parents)[i]];
+    i = (*parents)[i];
+  }
+  return i;
+}
+
+// Returns a node name starting with 'prefix' that is not in 'names', and adds
+// it to 'names'.
+string UniqueNodeName(const string& prefix,
+                      absl::flat_hash_set<string>* names) {
+  string name = prefix;
+  for (int i = 1; names->contains(name); ++i) {
+    name = absl::StrCat(prefix, "_", i);
+  }
+  names->insert(name);
+  return name;
+}
+
+// Sets up 'blocked' as the blocked version of the candidate 'node'.
+void MakeBlockedNode(const NodeDef& node, NodeDef* blocked) {
+  const auto copy_attr = [&node, blocked](const string& attr) {
+    const AttrValue* value = AttrSlice(node).Find(attr);
+    if (value != nullptr) (*blocked->mutable_attr())[attr] = *value;
+  };
+  blocked->set_device(node.device());
+  copy_attr("T");
+  if (node.op() == "Conv2D" || node.op() == "_FusedConv2D") {
+    blocked->set_op("_BlockedConv2D");
+    copy_attr("strides");
+    copy_attr("padding");
+    copy_attr("dilations");
+    if (node.op() == "_FusedConv2D") {
+      copy_attr("fused_ops");
+      copy_attr("num_args");
+      copy_attr("leakyrelu_alpha");
+    } else {
+      (*blocked->mutable_attr())["num_args"].set_i(0);
+    }
+  } else if (node.op() == "BiasAdd") {
+    blocked->set_op("_BlockedBiasAdd");
+  } else if (node.op() == "MaxPool" || node.op() == "AvgPool") {
+    blocked->set_op(absl::StrCat("_Blocked", node.op()));
+    copy_attr("ksize");
+    copy_attr("strides");
+    copy_attr("padding");
+  } else {
+    // Layout agnostic element-wise ops keep their op and attributes.
+    blocked->set_op(node.op());
+    *blocked->mutable_attr() = node.attr();
+  }
+}
+
+}  // namespace
+
+Status CpuBlockedLayoutOptimizer::Optimize(Cluster* cluster,
+                                           const GrapplerItem& item,
+                                           GraphDef* optimized_graph) {
+  const GraphDef& graph = item.graph;
+  // Skip the shape inference of graphs without CPU convolutions.
+  const bool has_cpu_conv = std::any_of(
+      graph.node().begin(), graph.node().end(), [](const NodeDef& node) {
+        return (node.op() == "Conv2D" || node.op() == "_FusedConv2D") &&
+               NodeIsOnCpu(&node);
+      });
+  if (!has_cpu_conv) {
+    return errors::Aborted("Nothing to do.");
+  }
+
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(
+      /*assume_valid_feeds=*/false, /*aggressive_shape_inference=*/false,
+      /*include_tensor_values=*/false));
+
+  const int num_nodes = graph.node_size();
+  absl::flat_hash_map<string, int> node_index;
+  for (int i = 0; i < num_nodes; ++i) {
+    node_index[graph.node(i).name()] = i;
+  }
+  // Returns the index of the node producing the data input 'input', or -1 if
+  // it is not an output 0, the only output of the blocked ops.
+  const auto producer_index = [&node_index](const string& input) {
+    const TensorId id = ParseTensorName(input);
+    if (id.index() != 0) return -1;
+    auto it = node_index.find(id.node());
+    return it == node_index.end() ? -1 : it->second;
+  };
+
+  // 1. Find the candidates, adding element-wise ops until all their data
+  // inputs are produced by candidates. Fed nodes are not converted: their
+  // consumers must read the fed value.
+  absl::flat_hash_set<string> fed_nodes;
+  for (const auto& feed : item.feed) {
+    fed_nodes.insert(string(ParseTensorName(feed.first).node()));
+  }
+  std::vector<CandidateKind> kinds(num_nodes, CandidateKind::kNone);
+  std::vector<bool> in_set(num_nodes, false);
+  bool has_anchor = false;
+  for (int i = 0; i < num_nodes; ++i) {
+    if (fed_nodes.contains(graph.node(i).name())) continue;
+    kinds[i] = GetCandidateKind(properties, graph.node(i));
+    in_set[i] = kinds[i] == CandidateKind::kAnchor;
+    has_anchor |= in_set[i];
+  }
+  if (!has_anchor) {
+    return errors::Aborted("Nothing to do.");
+  }
+  const auto inputs_in_set = [&](int i) {
+    const NodeDef& node = graph.node(i);
+    const int num_blocked_inputs = NumBlockedInputs(kinds[i]);
+    if (node.input_size() < num_blocked_inputs) return false;
+    for (int k = 0; k < num_blocked_inputs; ++k) {
+      const int producer = producer_index(node.input(k));
+      if (producer < 0 || !in_set[producer]) return false;
+    }
+    return true;
+  };
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (int i = 0; i < num_nodes; ++i) {
+      if (in_set[i] || kinds[i] == CandidateKind::kNone ||
+          kinds[i] == CandidateKind::kAnchor || !inputs_in_set(i)) {
+        continue;
+      }
+      in_set[i] = true;
+      changed = true;
+    }
+  }
+
+  // 2. Group the candidates in chains connected by blocked inputs, and keep
+  // the chains with a convolution and at least two nodes.
+  std::vector<int> parents(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) parents[i] = i;
+  for (int i = 0; i < num_nodes; ++i) {
+    if (!in_set[i]) continue;
+    const NodeDef& node = graph.node(i);
+    for (int k = 0; k < NumBlockedInputs(kinds[i]); ++k) {
+      const int producer = producer_index(node.input(k));
+      if (producer >= 0 && in_set[producer]) {
+        parents[FindRoot(&parents, i)] = FindRoot(&parents, producer);
+      }
+    }
+  }
+  std::vector<int> chain_size(num_nodes, 0);
+  std::vector<bool> chain_has_conv(num_nodes, false);
+  for (int i = 0; i < num_nodes; ++i) {
+    if (!in_set[i]) continue;
+    const int root = FindRoot(&parents, i);
+    ++chain_size[root];
+    const string& op = graph.node(i).op();
+    if (op == "Conv2D" || op == "_FusedConv2D") chain_has_conv[root] = true;
+  }
+  bool rewrite = false;
+  for (int i = 0; i < num_nodes; ++i) {
+    if (!in_set[i]) continue;
+    const int root = FindRoot(&parents, i);
+    in_set[i] = chain_has_conv[root] && chain_size[root] >= 2;
+    rewrite |= in_set[i];
+  }
+  if (!rewrite) {
+    return errors::Aborted("Nothing to do.");
+  }
+
+  // A node of a chain must keep its NHWC output if it is preserved, or
+  // consumed outside of its chain, by a control dependency, or by an input
+  // that is not blocked.
+  const std::unordered_set<string> nodes_to_preserve = item.NodesToPreserve();
+  std::vector<bool> keep_output(num_nodes, false);
+  for (int i = 0; i < num_nodes; ++i) {
+    const NodeDef& node = graph.node(i);
+    if (in_set[i] && nodes_to_preserve.count(node.name()) > 0) {
+      keep_output[i] = true;
+    }
+    const int num_blocked_inputs = in_set[i] ? NumBlockedInputs(kinds[i]) : 0;
+    for (int k = 0; k < node.input_size(); ++k) {
+      const TensorId id = ParseTensorName(node.input(k));
+      auto it = node_index.find(id.node());
+      if (it == node_index.end() || !in_set[it->second]) continue;
+      if (k >= num_blocked_inputs || id.index() != 0) {
+        keep_output[it->second] = true;
+      }
+    }
+  }
+
+  // 3. Rewrite the chains.
+  absl::flat_hash_set<string> names;
+  for (const NodeDef& node : graph.node()) names.insert(node.name());
+  std::vector<string> blocked_names(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    if (in_set[i]) {
+      blocked_names[i] =
+          UniqueNodeName(graph.node(i).name() + kBlockedSuffix, &names);
+    }
+  }
+
+  optimized_graph->Clear();
+  *optimized_graph->mutable_versions() = graph.versions();
+  *optimized_graph->mutable_library() = graph.library();
+  // The _ToBlockedLayout node of each tensor entering a chain.
+  absl::flat_hash_map<string, string> to_blocked_names;
+  for (int i = 0; i < num_nodes; ++i) {
+    const NodeDef& node = graph.node(i);
+    if (!in_set[i]) {
+      *optimized_graph->add_node() = node;
+      continue;
+    }
+
+    NodeDef* blocked = optimized_graph->add_node();
+    blocked->set_name(blocked_names[i]);
+    MakeBlockedNode(node, blocked);
+    const int num_blocked_inputs = NumBlockedInputs(kinds[i]);
+    for (int k = 0; k < node.input_size(); ++k) {
+      const string& input = node.input(k);
+      if (k >= num_blocked_inputs || IsControlInput(input)) {
+        blocked->add_input(input);
+        continue;
+      }
+      const int producer = producer_index(input);
+      if (producer >= 0 && in_set[producer]) {
+        blocked->add_input(blocked_names[producer]);
+        continue;
+      }
+      const TensorId id = ParseTensorName(input);
+      const string tensor = TensorIdToString(id);
+      auto it = to_blocked_names.find(tensor);
+      if (it == to_blocked_names.end()) {
+        const string name = UniqueNodeName(
+            id.index() == 0
+                ? absl::StrCat(id.node(), kToBlockedSuffix)
+                : absl::StrCat(id.node(), "_", id.index(), kToBlockedSuffix),
+            &names);
+        NodeDef* to_blocked = optimized_graph->add_node();
+        to_blocked->set_name(name);
+        to_blocked->set_op("_ToBlockedLayout");
+        to_blocked->set_device(node.device());
+        to_blocked->add_input(tensor);
+        (*to_blocked->mutable_attr())["T"].set_type(DT_FLOAT);
+        it = to_blocked_names.emplace(tensor, name).first;
+      }
+      blocked->add_input(it->second);
+    }
+
+    if (keep_output[i]) {
+      NodeDef* from_blocked = optimized_graph->add_node();
+      from_blocked->set_name(node.name());
+      from_blocked->set_op("_FromBlockedLayout");
+      from_blocked->set_device(node.device());
+      from_blocked->add_input(blocked_names[i]);
+      (*from_blocked->mutable_attr())["T"].set_type(DT_FLOAT);
+      (*from_blocked->mutable_attr())["channels"].set_i(
+          Nhwc4DOutputShape(properties, node)->dim(3).size());
+    }
+  }
+
+  VLOG(2) << "Converted to the blocked layout: "
+          << std::count(in_set.begin(), in_set.end(), true) << " nodes, with "
+          << to_blocked_names.size() << " layout conversions to the chains.";
+  return Status::OK();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
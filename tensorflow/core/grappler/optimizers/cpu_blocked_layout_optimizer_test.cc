@@ -0,0 +1,276 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/cpu_blocked_layout_optimizer.h"
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+
+class CpuBlockedLayoutOptimizerTest : public GrapplerTest {
+ protected:
+  // Places all the nodes of 'item' on CPU.
+  void PlaceOnCpu(GrapplerItem* item) {
+    for (int i = 0; i < item->graph.node_size(); ++i) {
+      item->graph.mutable_node(i)->set_device("/device:CPU:0");
+    }
+  }
+
+  // Checks that 'output' computes the fetches of 'item'.
+  void ExpectSameFetches(const GrapplerItem& item, const GraphDef& output) {
+    auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+    auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+    ASSERT_EQ(tensors.size(), tensors_expected.size());
+    for (int i = 0; i < tensors.size(); ++i) {
+      test::ExpectTensorNear<float>(tensors[i], tensors_expected[i], 1e-4);
+    }
+  }
+
+  // Returns the node of 'graph' named 'name', or nullptr.
+  const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) return &node;
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(CpuBlockedLayoutOptimizerTest, ConvertsConvolutionChain) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto input = ops::Placeholder(s.WithOpName("input"), DT_FLOAT,
+                                ops::Placeholder::Shape({2, 9, 9, 3}));
+  auto filter1 = ops::Const(s.WithOpName("filter1"),
+                            GenerateRandomTensor<DT_FLOAT>({3, 3, 3, 12}));
+  auto bias1 = ops::Const(s.WithOpName("bias1"),
+                          GenerateRandomTensor<DT_FLOAT>({12}));
+  auto filter2 = ops::Const(s.WithOpName("filter2"),
+                            GenerateRandomTensor<DT_FLOAT>({3, 3, 12, 12}));
+
+  auto conv1 =
+      ops::Conv2D(s.WithOpName("conv1"), input, filter1, {1, 1, 1, 1}, "SAME");
+  auto bias_add = ops::BiasAdd(s.WithOpName("bias_add"), conv1, bias1);
+  auto relu = ops::Relu(s.WithOpName("relu"), bias_add);
+  auto conv2 =
+      ops::Conv2D(s.WithOpName("conv2"), relu, filter2, {1, 1, 1, 1}, "SAME");
+  auto add = ops::AddV2(s.WithOpName("add"), conv2, relu);
+  auto pool = ops::MaxPool(s.WithOpName("pool"), add, {1, 2, 2, 1},
+                           {1, 2, 2, 1}, "VALID");
+  auto fetch = ops::Identity(s.WithOpName("fetch"), pool);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"input", GenerateRandomTensor<DT_FLOAT>({2, 9, 9, 3})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  CpuBlockedLayoutOptimizer optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // The input enters the chain through one layout conversion.
+  const NodeDef* to_blocked = FindNode(output, "input/to_blocked");
+  ASSERT_NE(to_blocked, nullptr);
+  EXPECT_EQ(to_blocked->op(), "_ToBlockedLayout");
+  EXPECT_EQ(to_blocked->input(0), "input");
+
+  const NodeDef* conv1_blocked = FindNode(output, "conv1/blocked");
+  ASSERT_NE(conv1_blocked, nullptr);
+  EXPECT_EQ(conv1_blocked->op(), "_BlockedConv2D");
+  EXPECT_EQ(conv1_blocked->input(0), "input/to_blocked");
+  EXPECT_EQ(conv1_blocked->input(1), "filter1");
+
+  const NodeDef* relu_blocked = FindNode(output, "relu/blocked");
+  ASSERT_NE(relu_blocked, nullptr);
+  EXPECT_EQ(relu_blocked->op(), "Relu");
+  EXPECT_EQ(relu_blocked->input(0), "bias_add/blocked");
+
+  const NodeDef* add_blocked = FindNode(output, "add/blocked");
+  ASSERT_NE(add_blocked, nullptr);
+  EXPECT_EQ(add_blocked->input(0), "conv2/blocked");
+  EXPECT_EQ(add_blocked->input(1), "relu/blocked");
+
+  EXPECT_EQ(FindNode(output, "bias_add/blocked")->op(), "_BlockedBiasAdd");
+  EXPECT_EQ(FindNode(output, "pool/blocked")->op(), "_BlockedMaxPool");
+
+  // Only the end of the chain is converted back to NHWC.
+  const NodeDef* pool_node = FindNode(output, "pool");
+  ASSERT_NE(pool_node, nullptr);
+  EXPECT_EQ(pool_node->op(), "_FromBlockedLayout");
+  EXPECT_EQ(pool_node->input(0), "pool/blocked");
+  EXPECT_EQ(pool_node->attr().at("channels").i(), 12);
+  for (const string& name : {"conv1", "bias_add", "relu", "conv2", "add"}) {
+    EXPECT_EQ(FindNode(output, name), nullptr) << name;
+  }
+
+  ExpectSameFetches(item, output);
+}
+
+TEST_F(CpuBlockedLayoutOptimizerTest, KeepsOutputsConsumedOutsideChain) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto input = ops::Placeholder(s.WithOpName("input"), DT_FLOAT,
+                                ops::Placeholder::Shape({1, 6, 6, 10}));
+  auto filter = ops::Const(s.WithOpName("filter"),
+                           GenerateRandomTensor<DT_FLOAT>({1, 1, 10, 20}));
+  auto bias = ops::Const(s.WithOpName("bias"),
+                         GenerateRandomTensor<DT_FLOAT>({20}));
+
+  auto conv =
+      ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1}, "VALID");
+  auto bias_add = ops::BiasAdd(s.WithOpName("bias_add"), conv, bias);
+  auto tanh = ops::Tanh(s.WithOpName("tanh"), bias_add);
+  // 'mean' reads the NHWC output of 'bias_add' outside of the chain.
+  auto mean = ops::Mean(s.WithOpName("mean"), bias_add, {1, 2});
+
+  GrapplerItem item;
+  item.fetch = {"tanh", "mean"};
+  item.feed = {{"input", GenerateRandomTensor<DT_FLOAT>({1, 6, 6, 10})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  CpuBlockedLayoutOptimizer optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(FindNode(output, "conv"), nullptr);
+  for (const string& name : {"bias_add", "tanh"}) {
+    const NodeDef* node = FindNode(output, name);
+    ASSERT_NE(node, nullptr) << name;
+    EXPECT_EQ(node->op(), "_FromBlockedLayout");
+    EXPECT_EQ(node->input(0), name + "/blocked");
+    EXPECT_EQ(node->attr().at("channels").i(), 20);
+  }
+  EXPECT_EQ(FindNode(output, "mean")->input(0), "bias_add");
+
+  ExpectSameFetches(item, output);
+}
+
+TEST_F(CpuBlockedLayoutOptimizerTest, ConvertsFusedConv2D) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto input = ops::Placeholder(s.WithOpName("input"), DT_FLOAT,
+                                ops::Placeholder::Shape({1, 7, 7, 5}));
+  auto filter = ops::Const(s.WithOpName("filter"),
+                           GenerateRandomTensor<DT_FLOAT>({3, 3, 5, 9}));
+  auto bias = ops::Const(s.WithOpName("bias"),
+                         GenerateRandomTensor<DT_FLOAT>({9}));
+  auto conv =
+      ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 2, 2, 1}, "SAME");
+  auto pool = ops::AvgPool(s.WithOpName("pool"), conv, {1, 3, 3, 1},
+                           {1, 1, 1, 1}, "SAME");
+
+  GrapplerItem item;
+  item.fetch = {"pool"};
+  item.feed = {{"input", GenerateRandomTensor<DT_FLOAT>({1, 7, 7, 5})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  // Turn 'conv' into a _FusedConv2D with BiasAdd and Relu, as the remapper
+  // does.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    NodeDef* node = item.graph.mutable_node(i);
+    if (node->name() != "conv") continue;
+    node->set_op("_FusedConv2D");
+    node->add_input("bias");
+    (*node->mutable_attr())["num_args"].set_i(1);
+    auto* fused_ops = (*node->mutable_attr())["fused_ops"].mutable_list();
+    fused_ops->add_s("BiasAdd");
+    fused_ops->add_s("Relu");
+  }
+
+  CpuBlockedLayoutOptimizer optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const NodeDef* conv_blocked = FindNode(output, "conv/blocked");
+  ASSERT_NE(conv_blocked, nullptr);
+  EXPECT_EQ(conv_blocked->op(), "_BlockedConv2D");
+  ASSERT_EQ(conv_blocked->input_size(), 3);
+  EXPECT_EQ(conv_blocked->input(2), "bias");
+  EXPECT_EQ(conv_blocked->attr().at("fused_ops").list().s_size(), 2);
+  EXPECT_EQ(FindNode(output, "pool/blocked")->op(), "_BlockedAvgPool");
+
+  ExpectSameFetches(item, output);
+}
+
+TEST_F(CpuBlockedLayoutOptimizerTest, SkipsChainsWithoutConvolution) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto input = ops::Placeholder(s.WithOpName("input"), DT_FLOAT,
+                                ops::Placeholder::Shape({1, 4, 4, 8}));
+  auto bias = ops::Const(s.WithOpName("bias"),
+                         GenerateRandomTensor<DT_FLOAT>({8}));
+  auto bias_add = ops::BiasAdd(s.WithOpName("bias_add"), input, bias);
+  auto relu = ops::Relu(s.WithOpName("relu"), bias_add);
+  auto pool = ops::MaxPool(s.WithOpName("pool"), relu, {1, 2, 2, 1},
+                           {1, 2, 2, 1}, "VALID");
+
+  GrapplerItem item;
+  item.fetch = {"pool"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  CpuBlockedLayoutOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status)) << status;
+}
+
+TEST_F(CpuBlockedLayoutOptimizerTest, SkipsDeepConvolutions) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto input = ops::Placeholder(s.WithOpName("input"), DT_FLOAT,
+                                ops::Placeholder::Shape({1, 4, 4, 128}));
+  auto filter = ops::Const(s.WithOpName("filter"),
+                           GenerateRandomTensor<DT_FLOAT>({3, 3, 128, 8}));
+  auto conv =
+      ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1}, "SAME");
+  auto relu = ops::Relu(s.WithOpName("relu"), conv);
+
+  GrapplerItem item;
+  item.fetch = {"relu"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  CpuBlockedLayoutOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status)) << status;
+}
+
+TEST_F(CpuBlockedLayoutOptimizerTest, SkipsNodesNotOnCpu) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto input = ops::Placeholder(s.WithOpName("input"), DT_FLOAT,
+                                ops::Placeholder::Shape({1, 4, 4, 8}));
+  auto filter = ops::Const(s.WithOpName("filter"),
+                           GenerateRandomTensor<DT_FLOAT>({3, 3, 8, 8}));
+  auto conv =
+      ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1}, "SAME");
+  auto relu = ops::Relu(s.WithOpName("relu"), conv);
+
+  GrapplerItem item;
+  item.fetch = {"relu"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  CpuBlockedLayoutOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status)) << status;
+}
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,394 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/decode_and_resize_fusion.h"
+
+#include <algorithm>
+#include <array>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/function_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kFusedOp[] = "DecodeAndResizeJpeg";
+
+constexpr std::array<const char*, 4> kMapDatasetOps = {
+    "MapDataset", "ParallelMapDataset", "ParallelMapDatasetV2",
+    "MapAndBatchDataset"};
+
+// Returns the number of times the outputs of node `name` are referenced by
+// the nodes and return values of `function`, including control edges.
+int NumReferences(const string& name, const FunctionDef& function) {
+  const string prefix = strings::StrCat(name, ":");
+  const string control = strings::StrCat("^", name);
+  int count = 0;
+  for (const NodeDef& node : function.node_def()) {
+    for (const string& input : node.input()) {
+      if (absl::StartsWith(input, prefix) || input == control) ++count;
+    }
+  }
+  for (const auto& ret : function.ret()) {
+    if (absl::StartsWith(ret.second, prefix)) ++count;
+  }
+  return count;
+}
+
+// Returns the only consumer of `tensor`, which must be output 0 of its node,
+// or nullptr if the node's outputs are used anywhere else.
+const NodeDef* GetSoleConsumer(const string& tensor,
+                               const FunctionDef& function) {
+  const function_utils::FunctionDefTensorDesc desc(tensor);
+  if (NumReferences(desc.node_name, function) != 1) return nullptr;
+  for (const NodeDef& node : function.node_def()) {
+    for (const string& input : node.input()) {
+      if (input == tensor) return &node;
+    }
+  }
+  return nullptr;
+}
+
+bool HasControlInputs(const NodeDef& node) {
+  for (const string& input : node.input()) {
+    if (IsControlInput(input)) return true;
+  }
+  return false;
+}
+
+// Reads the value of `tensor` if it is produced by a scalar constant.
+template <typename T>
+bool GetScalarConstValue(const string& tensor, const FunctionDef& function,
+                         T* value) {
+  const function_utils::FunctionDefTensorDesc desc(tensor);
+  const int index = function_utils::FindFunctionNodeWithName(desc.node_name,
+                                                             function);
+  if (index < 0) return false;
+  const NodeDef& node = function.node_def(index);
+  if (node.op() != "Const" || node.attr().at("dtype").type() !=
+                                  DataTypeToEnum<T>::value) {
+    return false;
+  }
+  Tensor t;
+  if (!t.FromProto(node.attr().at("value").tensor()) || t.NumElements() != 1) {
+    return false;
+  }
+  *value = t.flat<T>()(0);
+  return true;
+}
+
+// Reads an integer scalar constant of either int32 or int64 type.
+bool GetScalarIntConstValue(const string& tensor, const FunctionDef& function,
+                            int64* value) {
+  int32 value32;
+  if (GetScalarConstValue(tensor, function, &value32)) {
+    *value = value32;
+    return true;
+  }
+  return GetScalarConstValue(tensor, function, value);
+}
+
+// Returns the attribute `name` of `node`, or `default_value` if the node does
+// not set it.
+AttrValue GetAttrOrDefault(const NodeDef& node, const string& name,
+                           AttrValue default_value) {
+  const AttrValue* attr = gtl::FindOrNull(node.attr(), name);
+  return attr != nullptr ? *attr : default_value;
+}
+
+AttrValue MakeAttr(bool b) {
+  AttrValue value;
+  value.set_b(b);
+  return value;
+}
+
+AttrValue MakeAttr(int64 i) {
+  AttrValue value;
+  value.set_i(i);
+  return value;
+}
+
+AttrValue MakeAttr(float f) {
+  AttrValue value;
+  value.set_f(f);
+  return value;
+}
+
+AttrValue MakeAttr(const string& s) {
+  AttrValue value;
+  value.set_s(s);
+  return value;
+}
+
+bool GetBoolAttr(const NodeDef& node, const string& name) {
+  return GetAttrOrDefault(node, name, MakeAttr(false)).b();
+}
+
+// A decode-resize-normalize chain found in a map function.
+struct Chain {
+  const NodeDef* decode = nullptr;
+  const NodeDef* resize = nullptr;
+  // Names of the nodes replaced by the fused op.
+  absl::flat_hash_set<string> nodes;
+  // The tensor that the fused op replaces.
+  string output;
+  float scale = 1.0f;
+  float offset = 0.0f;
+};
+
+// Folds `node`, a float Mul, RealDiv, Add, AddV2 or Sub of `tensor` with a
+// scalar constant, into `chain`. Returns false if `node` is something else.
+bool FoldNormalization(const NodeDef& node, const string& tensor,
+                       const FunctionDef& function, Chain* chain) {
+  const string& op = node.op();
+  if (op != "Mul" && op != "RealDiv" && op != "Add" && op != "AddV2" &&
+      op != "Sub") {
+    return false;
+  }
+  if (node.input_size() != 2 || node.attr().at("T").type() != DT_FLOAT) {
+    return false;
+  }
+  const bool tensor_first = node.input(0) == tensor;
+  float c;
+  if (!GetScalarConstValue(node.input(tensor_first ? 1 : 0), function, &c)) {
+    return false;
+  }
+  if (op == "Mul") {
+    chain->scale *= c;
+    chain->offset *= c;
+  } else if (op == "RealDiv") {
+    if (!tensor_first || c == 0.0f) return false;
+    chain->scale /= c;
+    chain->offset /= c;
+  } else if (op == "Sub") {
+    if (tensor_first) {
+      chain->offset -= c;
+    } else {
+      chain->scale = -chain->scale;
+      chain->offset = c - chain->offset;
+    }
+  } else {
+    chain->offset += c;
+  }
+  return true;
+}
+
+// Matches `decode`, `Cast` to float (optional), `ExpandDims(_, 0)`,
+// `ResizeBilinear`, `Squeeze([0])` and any number of normalization ops, each
+// consuming the previous one only. This is what `tf.image.decode_jpeg`,
+// `tf.image.resize` and `(image - mean) / stddev` produce.
+bool MatchChain(const NodeDef& decode, const FunctionDef& function,
+                Chain* chain) {
+  if (decode.op() != "DecodeJpeg" && decode.op() != "DecodeAndCropJpeg") {
+    return false;
+  }
+  if (GetAttrOrDefault(decode, "ratio", MakeAttr(int64{1})).i() != 1 ||
+      GetBoolAttr(decode, "try_recover_truncated") ||
+      GetAttrOrDefault(decode, "acceptable_fraction", MakeAttr(1.0f)).f() !=
+          1.0f ||
+      HasControlInputs(decode)) {
+    return false;
+  }
+  const int64 channels =
+      GetAttrOrDefault(decode, "channels", MakeAttr(int64{0})).i();
+  if (channels != 0 && channels != 1 && channels != 3) return false;
+  chain->decode = &decode;
+  chain->nodes.insert(decode.name());
+  string tensor = strings::StrCat(decode.name(), ":image:0");
+
+  const NodeDef* node = GetSoleConsumer(tensor, function);
+  if (node != nullptr && node->op() == "Cast") {
+    if (node->attr().at("DstT").type() != DT_FLOAT ||
+        GetBoolAttr(*node, "Truncate") || HasControlInputs(*node)) {
+      return false;
+    }
+    chain->nodes.insert(node->name());
+    tensor = strings::StrCat(node->name(), ":y:0");
+    node = GetSoleConsumer(tensor, function);
+  }
+
+  int64 axis;
+  if (node == nullptr || node->op() != "ExpandDims" ||
+      HasControlInputs(*node) || node->input(0) != tensor ||
+      !GetScalarIntConstValue(node->input(1), function, &axis) || axis != 0) {
+    return false;
+  }
+  chain->nodes.insert(node->name());
+  tensor = strings::StrCat(node->name(), ":output:0");
+
+  node = GetSoleConsumer(tensor, function);
+  if (node == nullptr || node->op() != "ResizeBilinear" ||
+      HasControlInputs(*node) || node->input(0) != tensor) {
+    return false;
+  }
+  chain->resize = node;
+  chain->nodes.insert(node->name());
+  tensor = strings::StrCat(node->name(), ":resized_images:0");
+
+  node = GetSoleConsumer(tensor, function);
+  if (node == nullptr || node->op() != "Squeeze" || HasControlInputs(*node)) {
+    return false;
+  }
+  const AttrValue squeeze_dims =
+      GetAttrOrDefault(*node, "squeeze_dims", AttrValue());
+  if (squeeze_dims.list().i_size() != 1 || squeeze_dims.list().i(0) != 0) {
+    return false;
+  }
+  chain->nodes.insert(node->name());
+  tensor = strings::StrCat(node->name(), ":output:0");
+
+  for (node = GetSoleConsumer(tensor, function);
+       node != nullptr && !HasControlInputs(*node) &&
+       FoldNormalization(*node, tensor, function, chain);
+       node = GetSoleConsumer(tensor, function)) {
+    chain->nodes.insert(node->name());
+    tensor = strings::StrCat(node->name(), ":z:0");
+  }
+  chain->output = tensor;
+  return true;
+}
+
+// Replaces the nodes of `chain` with a `DecodeAndResizeJpeg` node.
+void FuseChain(const Chain& chain, FunctionDef* function) {
+  const NodeDef& decode = *chain.decode;
+  string crop_window;
+  if (decode.op() == "DecodeAndCropJpeg") {
+    crop_window = decode.input(1);
+  } else {
+    // An empty crop window selects the whole image.
+    Tensor zeros(DT_INT32, TensorShape({4}));
+    zeros.vec<int32>().setZero();
+    AttrValue value;
+    zeros.AsProtoTensorContent(value.mutable_tensor());
+    AttrValue dtype;
+    dtype.set_type(DT_INT32);
+    NodeDef* node = function_utils::AddNode(
+        "", "Const", {}, {{"dtype", dtype}, {"value", value}}, function);
+    function_utils::SetUniqueFunctionNodeName("crop_window", function, node);
+    crop_window = strings::StrCat(node->name(), ":output:0");
+  }
+
+  NodeDef fused;
+  function_utils::SetUniqueFunctionNodeName("decode_and_resize", function,
+                                            &fused);
+  fused.set_op(kFusedOp);
+  fused.add_input(decode.input(0));
+  fused.add_input(crop_window);
+  fused.add_input(chain.resize->input(1));
+  auto& attr = *fused.mutable_attr();
+  attr["channels"] = GetAttrOrDefault(decode, "channels", MakeAttr(int64{0}));
+  attr["fancy_upscaling"] =
+      GetAttrOrDefault(decode, "fancy_upscaling", MakeAttr(true));
+  attr["dct_method"] =
+      GetAttrOrDefault(decode, "dct_method", MakeAttr(string()));
+  attr["align_corners"] = MakeAttr(GetBoolAttr(*chain.resize, "align_corners"));
+  attr["half_pixel_centers"] =
+      MakeAttr(GetBoolAttr(*chain.resize, "half_pixel_centers"));
+  attr["scale"] = MakeAttr(chain.scale);
+  attr["offset"] = MakeAttr(chain.offset);
+
+  const string output = strings::StrCat(fused.name(), ":image:0");
+  const string replaced = chain.output;
+  const absl::flat_hash_set<string> nodes = chain.nodes;
+  // `chain` points into `function`, so it is not used after this point.
+  auto* node_defs = function->mutable_node_def();
+  int kept = 0;
+  for (int i = 0; i < node_defs->size(); ++i) {
+    if (nodes.contains(node_defs->Get(i).name())) continue;
+    node_defs->SwapElements(kept++, i);
+  }
+  node_defs->DeleteSubrange(kept, node_defs->size() - kept);
+  *node_defs->Add() = std::move(fused);
+  function_utils::ReplaceReferences(replaced, output, function);
+}
+
+// Fuses all chains in `function` and returns the number of fused chains.
+int FuseChains(FunctionDef* function) {
+  int num_fused = 0;
+  bool fused;
+  do {
+    fused = false;
+    for (const NodeDef& node : function->node_def()) {
+      Chain chain;
+      if (MatchChain(node, *function, &chain)) {
+        FuseChain(chain, function);
+        fused = true;
+        ++num_fused;
+        break;
+      }
+    }
+  } while (fused);
+  return num_fused;
+}
+
+}  // namespace
+
+Status DecodeAndResizeFusion::OptimizeAndCollectStats(
+    Cluster* cluster, const GrapplerItem& item, GraphDef* output,
+    OptimizationStats* stats) {
+  *output = item.graph;
+  FunctionLibraryDefinition function_library(OpRegistry::Global(),
+                                             item.graph.library());
+
+  for (NodeDef& node : *output->mutable_node()) {
+    if (std::find(kMapDatasetOps.begin(), kMapDatasetOps.end(), node.op()) ==
+        kMapDatasetOps.end()) {
+      continue;
+    }
+    AttrValue* f = gtl::FindOrNull(*node.mutable_attr(), "f");
+    if (f == nullptr) continue;
+    const FunctionDef* function = function_library.Find(f->func().name());
+    if (function == nullptr) continue;
+
+    FunctionDef fused_function = *function;
+    const int num_fused = FuseChains(&fused_function);
+    if (num_fused == 0) continue;
+
+    graph_utils::SetUniqueGraphFunctionName(
+        strings::StrCat(function->signature().name(), "_decode_and_resize"),
+        output->mutable_library(), &fused_function);
+    f->mutable_func()->set_name(fused_function.signature().name());
+    TF_RETURN_IF_ERROR(function_library.AddFunctionDef(fused_function));
+    *output->mutable_library()->add_function() = std::move(fused_function);
+    stats->num_changes += num_fused;
+  }
+  return Status::OK();
+}
+
+void DecodeAndResizeFusion::Feedback(Cluster* cluster,
+                                     const GrapplerItem& item,
+                                     const GraphDef& optimize_output,
+                                     double result) {
+  // no-op
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(DecodeAndResizeFusion, "decode_and_resize_fusion");
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,58 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_DECODE_AND_RESIZE_FUSION_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_DECODE_AND_RESIZE_FUSION_H_
+
+#include "tensorflow/core/grappler/optimizers/data/optimizer_base.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// This optimization rewrites map functions in which a JPEG image is decoded
+// (`DecodeJpeg` or `DecodeAndCropJpeg`), resized with `ResizeBilinear` and
+// then scaled and shifted by scalar constants into a single
+// `DecodeAndResizeJpeg` op. The fused op decodes at a reduced DCT scale when
+// the output is small enough, and does not materialize the decoded and
+// resized intermediate images.
+//
+// DCT downscaling averages pixels instead of sampling them, so the rewritten
+// pipeline does not produce bitwise identical results.
+class DecodeAndResizeFusion : public TFDataOptimizerBase {
+ public:
+  DecodeAndResizeFusion() = default;
+  ~DecodeAndResizeFusion() override = default;
+
+  string name() const override { return "decode_and_resize_fusion"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(
+      const tensorflow::RewriterConfig_CustomGraphOptimizer* config) override {
+    return Status::OK();
+  }
+
+  Status OptimizeAndCollectStats(Cluster* cluster, const GrapplerItem& item,
+                                 GraphDef* output,
+                                 OptimizationStats* stats) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimize_output, double result) override;
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_DECODE_AND_RESIZE_FUSION_H_
@@ -0,0 +1,193 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/decode_and_resize_fusion.h"
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/data/function_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_test_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using FDH = FunctionDefHelper;
+
+// Returns the nodes that `tf.image.decode_jpeg`, `tf.image.resize` and
+// `(image - 127.5) / 127.5` add to a map function, ending in `output`.
+std::vector<FDH::Node> DecodeResizeNormalizeNodes(const string& decode_op,
+                                                  std::vector<string> inputs) {
+  return {
+      {{"decode"}, decode_op, std::move(inputs), {{"channels", 3}}},
+      {{"axis"},
+       "Const",
+       {},
+       {{"value", test::AsScalar<int32>(0)}, {"dtype", DT_INT32}}},
+      {{"expand"},
+       "ExpandDims",
+       {"decode:image:0", "axis:output:0"},
+       {{"T", DT_UINT8}, {"Tdim", DT_INT32}}},
+      {{"size"},
+       "Const",
+       {},
+       {{"value", test::AsTensor<int32>({224, 224})}, {"dtype", DT_INT32}}},
+      {{"resize"},
+       "ResizeBilinear",
+       {"expand:output:0", "size:output:0"},
+       {{"T", DT_UINT8}, {"half_pixel_centers", true}}},
+      {{"squeeze"},
+       "Squeeze",
+       {"resize:resized_images:0"},
+       {{"T", DT_FLOAT}, {"squeeze_dims", gtl::ArraySlice<int64>{0}}}},
+      {{"mean"},
+       "Const",
+       {},
+       {{"value", test::AsScalar<float>(127.5f)}, {"dtype", DT_FLOAT}}},
+      {{"sub"},
+       "Sub",
+       {"squeeze:output:0", "mean:output:0"},
+       {{"T", DT_FLOAT}}},
+      {{"stddev"},
+       "Const",
+       {},
+       {{"value", test::AsScalar<float>(127.5f)}, {"dtype", DT_FLOAT}}},
+      {{"div"}, "RealDiv", {"sub:z:0", "stddev:output:0"}, {{"T", DT_FLOAT}}}};
+}
+
+FunctionDef DecodeResizeNormalize() {
+  return FDH::Create("DecodeResizeNormalize", {"contents: string"},
+                     {"image: float"}, {},
+                     DecodeResizeNormalizeNodes("DecodeJpeg", {"contents"}),
+                     {{"image", "div:z:0"}});
+}
+
+GrapplerItem MakeItem(const FunctionDef& function) {
+  using test::function::NDef;
+  GrapplerItem item;
+  item.graph = test::function::GDef(
+      {NDef("filename", "Const", {}, {{"value", ""}, {"dtype", DT_STRING}}),
+       NDef("tensor_slices", "TensorSliceDataset", {"filename"},
+            {{"output_shapes", gtl::ArraySlice<TensorShape>{}},
+             {"Toutput_types", gtl::ArraySlice<DataType>{DT_STRING}}}),
+       graph_tests_utils::MakeMapNode("map", "tensor_slices",
+                                      function.signature().name())},
+      {function});
+  return item;
+}
+
+const FunctionDef& GetMapFunction(const GraphDef& graph) {
+  const NodeDef& map =
+      graph.node(graph_utils::FindGraphNodeWithName("map", graph));
+  const int index = graph_utils::FindGraphFunctionWithName(
+      map.attr().at("f").func().name(), graph.library());
+  CHECK_GE(index, 0);
+  return graph.library().function(index);
+}
+
+TEST(DecodeAndResizeFusionTest, FusesDecodeResizeNormalize) {
+  GrapplerItem item = MakeItem(DecodeResizeNormalize());
+  DecodeAndResizeFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const FunctionDef& function = GetMapFunction(output);
+  EXPECT_NE(function.signature().name(), "DecodeResizeNormalize");
+  for (const char* op :
+       {"DecodeJpeg", "ExpandDims", "ResizeBilinear", "Squeeze", "RealDiv"}) {
+    EXPECT_FALSE(function_utils::ContainsFunctionNodeWithOp(op, function))
+        << op;
+  }
+  const int index =
+      function_utils::FindFunctionNodeWithOp("DecodeAndResizeJpeg", function);
+  ASSERT_GE(index, 0);
+  const NodeDef& fused = function.node_def(index);
+  ASSERT_EQ(fused.input_size(), 3);
+  EXPECT_EQ(fused.input(0), "contents");
+  EXPECT_EQ(fused.input(2), "size:output:0");
+  EXPECT_EQ(fused.attr().at("channels").i(), 3);
+  EXPECT_TRUE(fused.attr().at("half_pixel_centers").b());
+  EXPECT_FLOAT_EQ(fused.attr().at("scale").f(), 1.0f / 127.5f);
+  EXPECT_FLOAT_EQ(fused.attr().at("offset").f(), -1.0f);
+  EXPECT_EQ(function.ret().at("image"),
+            strings::StrCat(fused.name(), ":image:0"));
+
+  // The original function is left for other users.
+  EXPECT_TRUE(graph_utils::ContainsGraphFunctionWithName(
+      "DecodeResizeNormalize", output.library()));
+}
+
+TEST(DecodeAndResizeFusionTest, FusesDecodeAndCrop) {
+  GrapplerItem item = MakeItem(FDH::Create(
+      "DecodeAndCrop", {"contents: string", "crop_window: int32"},
+      {"image: float"}, {},
+      DecodeResizeNormalizeNodes("DecodeAndCropJpeg",
+                                 {"contents", "crop_window"}),
+      {{"image", "div:z:0"}}));
+  DecodeAndResizeFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const FunctionDef& function = GetMapFunction(output);
+  const int index =
+      function_utils::FindFunctionNodeWithOp("DecodeAndResizeJpeg", function);
+  ASSERT_GE(index, 0);
+  EXPECT_EQ(function.node_def(index).input(1), "crop_window");
+}
+
+TEST(DecodeAndResizeFusionTest, StopsAtSharedIntermediate) {
+  // The resized image is returned as well, so only the normalization that
+  // follows it can't be fused.
+  GrapplerItem item = MakeItem(FDH::Create(
+      "SharedResize", {"contents: string"}, {"image: float", "resized: float"},
+      {}, DecodeResizeNormalizeNodes("DecodeJpeg", {"contents"}),
+      {{"image", "div:z:0"}, {"resized", "squeeze:output:0"}}));
+  DecodeAndResizeFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const FunctionDef& function = GetMapFunction(output);
+  const int index =
+      function_utils::FindFunctionNodeWithOp("DecodeAndResizeJpeg", function);
+  ASSERT_GE(index, 0);
+  const NodeDef& fused = function.node_def(index);
+  EXPECT_FLOAT_EQ(fused.attr().at("scale").f(), 1.0f);
+  EXPECT_FLOAT_EQ(fused.attr().at("offset").f(), 0.0f);
+  EXPECT_TRUE(function_utils::ContainsFunctionNodeWithOp("Sub", function));
+  EXPECT_EQ(function.ret().at("resized"),
+            strings::StrCat(fused.name(), ":image:0"));
+}
+
+TEST(DecodeAndResizeFusionTest, DoesNotFuseSharedDecode) {
+  GrapplerItem item = MakeItem(FDH::Create(
+      "SharedDecode", {"contents: string"}, {"image: float", "decoded: uint8"},
+      {}, DecodeResizeNormalizeNodes("DecodeJpeg", {"contents"}),
+      {{"image", "div:z:0"}, {"decoded", "decode:image:0"}}));
+  DecodeAndResizeFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(GetMapFunction(output).signature().name(), "SharedDecode");
+  EXPECT_EQ(output.library().function_size(), 1);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
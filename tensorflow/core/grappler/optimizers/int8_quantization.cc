@@ -0,0 +1,593 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/int8_quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/evaluation_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/kernels/int8_gemm.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// The optimizer works in three steps:
+//
+// 1. Find the candidate nodes: float CPU MatMul and NHWC Conv2D nodes, fused
+//    with an optional bias and activation, whose weights and bias are
+//    constants.
+// 2. Calibrate: evaluate the fanin of the candidates node by node on the fed
+//    tensors, and choose the uint8 quantization of each candidate input from
+//    the range of its values.
+// 3. Quantize the weights of each candidate and evaluate the int8 node on its
+//    calibration input. The candidate is rewritten in place to the int8 node,
+//    reading new constants '<name>/int8_weights', '<name>/int8_scales' and
+//    '<name>/int8_offsets' (made unique if needed), if its relative L2 error
+//    against the float output is at most kMaxRelativeError, and if the int8
+//    kernel runs at least min_speedup times faster than the float kernel on
+//    the calibration input.
+//
+// The per node errors and timings and a summary are logged with VLOG(1), as
+// the accuracy report of the quantized graph.
+
+constexpr float Int8QuantizationOptimizer::kMaxRelativeError;
+constexpr float Int8QuantizationOptimizer::kMinSpeedup;
+
+namespace {
+
+constexpr char kWeightsSuffix[] = "/int8_weights";
+constexpr char kScalesSuffix[] = "/int8_scales";
+constexpr char kOffsetsSuffix[] = "/int8_offsets";
+
+// Number of evaluations of the float and int8 kernels of a candidate, the
+// fastest of which is its latency.
+constexpr int kTimingRuns = 5;
+
+using TensorVector = gtl::InlinedVector<TensorValue, 4>;
+
+// A node to quantize, with its float parameters.
+struct Candidate {
+  int index;
+  bool is_matmul;
+  // Weights as a [depth, channels] matrix.
+  Tensor weights;
+  // Window of a convolution, 1x1 for a MatMul.
+  int64 filter_rows;
+  int64 filter_cols;
+  // Bias of size channels, or uninitialized.
+  Tensor bias;
+  // Fused activation, or "None".
+  string activation;
+  // Name of the weights constant, whose control inputs are copied to the new
+  // constants.
+  string weights_node;
+  // Number of data inputs of the float node.
+  int num_data_inputs;
+};
+
+// Returns the float tensor held by the constant producing 'input', or an
+// uninitialized tensor.
+Tensor GetConstantValue(const NodeMap& node_map, const string& input) {
+  Tensor tensor;
+  const NodeDef* node = node_map.GetNode(input);
+  if (node == nullptr || !IsConstant(*node) ||
+      GetDataTypeFromAttr(*node, "dtype") != DT_FLOAT) {
+    return tensor;
+  }
+  const AttrValue* value = AttrSlice(*node).Find("value");
+  if (value == nullptr || !tensor.FromProto(value->tensor())) {
+    return Tensor();
+  }
+  return tensor;
+}
+
+// Returns the fused activation of a _FusedMatMul or _FusedConv2D 'node' with a
+// bias, or an empty string if the fused ops are not supported.
+string GetFusedActivation(const NodeDef& node) {
+  const AttrValue* fused_ops = AttrSlice(node).Find("fused_ops");
+  const AttrValue* num_args = AttrSlice(node).Find("num_args");
+  if (fused_ops == nullptr || num_args == nullptr || num_args->i() != 1) {
+    return "";
+  }
+  const auto& ops = fused_ops->list().s();
+  if (ops.empty() || ops.size() > 2 || ops[0] != "BiasAdd") return "";
+  if (ops.size() == 1) return "None";
+  if (ops[1] == "Relu" || ops[1] == "Relu6" || ops[1] == "Elu" ||
+      ops[1] == "LeakyRelu") {
+    return ops[1];
+  }
+  return "";
+}
+
+bool IsUnitNhwcWindowAttr(const NodeDef& node, const string& attr) {
+  const AttrValue* value = AttrSlice(node).Find(attr);
+  if (value == nullptr) return attr == "dilations";
+  const auto& list = value->list().i();
+  return list.size() == 4 && list[0] == 1 && list[3] == 1 && list[1] > 0 &&
+         list[2] > 0;
+}
+
+bool IsConvCandidateOp(const NodeDef& node) {
+  if (node.op() != "Conv2D" && node.op() != "_FusedConv2D") return false;
+  const AttrValue* data_format = AttrSlice(node).Find("data_format");
+  const AttrValue* padding = AttrSlice(node).Find("padding");
+  return (data_format == nullptr || data_format->s() == "NHWC") &&
+         padding != nullptr &&
+         (padding->s() == "SAME" || padding->s() == "VALID") &&
+         IsUnitNhwcWindowAttr(node, "strides") &&
+         IsUnitNhwcWindowAttr(node, "dilations");
+}
+
+// Sets up 'candidate' and returns true if 'node' can be quantized.
+bool GetCandidate(const NodeMap& node_map, const NodeDef& node,
+                  Candidate* candidate) {
+  if (!NodeIsOnCpu(&node) || GetDataTypeFromAttr(node, "T") != DT_FLOAT) {
+    return false;
+  }
+  const bool is_matmul = node.op() == "MatMul" || node.op() == "_FusedMatMul";
+  if (!is_matmul && !IsConvCandidateOp(node)) return false;
+  candidate->is_matmul = is_matmul;
+  const bool is_fused = node.op()[0] == '_';
+  candidate->activation = is_fused ? GetFusedActivation(node) : "None";
+  if (candidate->activation.empty()) return false;
+  const int num_data_inputs = is_fused ? 3 : 2;
+  if (node.input_size() < num_data_inputs ||
+      IsControlInput(node.input(num_data_inputs - 1))) {
+    return false;
+  }
+
+  const Tensor weights = GetConstantValue(node_map, node.input(1));
+  if (!weights.IsInitialized()) return false;
+  if (is_matmul) {
+    const AttrValue* transpose_a = AttrSlice(node).Find("transpose_a");
+    const AttrValue* transpose_b = AttrSlice(node).Find("transpose_b");
+    if ((transpose_a != nullptr && transpose_a->b()) || weights.dims() != 2) {
+      return false;
+    }
+    if (transpose_b != nullptr && transpose_b->b()) {
+      const int64 rows = weights.dim_size(0);
+      const int64 cols = weights.dim_size(1);
+      candidate->weights = Tensor(DT_FLOAT, {cols, rows});
+      const auto in = weights.matrix<float>();
+      auto out = candidate->weights.matrix<float>();
+      for (int64 r = 0; r < rows; ++r) {
+        for (int64 c = 0; c < cols; ++c) out(c, r) = in(r, c);
+      }
+    } else {
+      candidate->weights = weights;
+    }
+    candidate->filter_rows = 1;
+    candidate->filter_cols = 1;
+  } else {
+    if (weights.dims() != 4) return false;
+    // HWIO filters are row-major [rows * cols * in_depth, out_depth]
+    // matrices.
+    candidate->weights = Tensor(DT_FLOAT);
+    if (!candidate->weights.CopyFrom(
+            weights, TensorShape({weights.dim_size(0) * weights.dim_size(1) *
+                                      weights.dim_size(2),
+                                  weights.dim_size(3)}))) {
+      return false;
+    }
+    candidate->filter_rows = weights.dim_size(0);
+    candidate->filter_cols = weights.dim_size(1);
+  }
+
+  candidate->bias = Tensor();
+  if (is_fused) {
+    candidate->bias = GetConstantValue(node_map, node.input(2));
+    if (!candidate->bias.IsInitialized() || candidate->bias.dims() != 1 ||
+        candidate->bias.dim_size(0) != candidate->weights.dim_size(1)) {
+      return false;
+    }
+  }
+  candidate->weights_node = NodeName(node.input(1));
+  candidate->num_data_inputs = num_data_inputs;
+  return true;
+}
+
+// Evaluates the nodes needed to compute the nodes 'targets' on the fed
+// tensors of 'item', in topological order. Nodes that cannot be evaluated, such
+// as stateful nodes, nodes without a CPU kernel or nodes with an input that
+// cannot be evaluated, get no values.
+Status EvaluateFanin(const GrapplerItem& item,
+                     const absl::flat_hash_set<string>& targets,
+                     DeviceBase* cpu_device, ResourceMgr* resource_mgr,
+                     absl::flat_hash_map<string, std::vector<Tensor>>* values) {
+  GraphDef graph = item.graph;
+  TF_RETURN_IF_ERROR(TopologicalSort(&graph));
+
+  absl::flat_hash_map<string, const NodeDef*> nodes;
+  for (const NodeDef& node : graph.node()) nodes[node.name()] = &node;
+  absl::flat_hash_set<string> needed;
+  std::vector<string> stack(targets.begin(), targets.end());
+  while (!stack.empty()) {
+    const string name = stack.back();
+    stack.pop_back();
+    if (!needed.insert(name).second) continue;
+    auto it = nodes.find(name);
+    if (it == nodes.end()) continue;
+    for (const string& input : it->second->input()) {
+      if (!IsControlInput(input)) stack.push_back(NodeName(input));
+    }
+  }
+
+  absl::flat_hash_map<string, std::vector<Tensor>> fed;
+  for (const auto& feed : item.feed) {
+    const TensorId id = ParseTensorName(feed.first);
+    std::vector<Tensor>& tensors = fed[id.node()];
+    if (static_cast<int>(tensors.size()) <= id.index()) {
+      tensors.resize(id.index() + 1);
+    }
+    tensors[id.index()] = feed.second;
+  }
+
+  for (const NodeDef& node : graph.node()) {
+    if (!needed.contains(node.name())) continue;
+    auto fed_it = fed.find(node.name());
+    if (fed_it != fed.end()) {
+      (*values)[node.name()] = fed_it->second;
+      continue;
+    }
+    if (IsStateful(node)) continue;
+
+    TensorVector inputs;
+    bool has_inputs = true;
+    for (const string& input : node.input()) {
+      if (IsControlInput(input)) break;
+      const TensorId id = ParseTensorName(input);
+      auto it = values->find(id.node());
+      if (it == values->end() ||
+          static_cast<int>(it->second.size()) <= id.index() ||
+          !it->second[id.index()].IsInitialized()) {
+        has_inputs = false;
+        break;
+      }
+      inputs.emplace_back(&it->second[id.index()]);
+    }
+    if (!has_inputs) continue;
+
+    TensorVector outputs;
+    const Status status =
+        EvaluateNode(node, inputs, cpu_device, resource_mgr, &outputs);
+    std::vector<Tensor> node_values;
+    for (const TensorValue& output : outputs) {
+      node_values.push_back(output.tensor ? *output.tensor : Tensor());
+      delete output.tensor;
+    }
+    if (!status.ok()) {
+      VLOG(2) << "Could not evaluate " << node.name() << ": " << status;
+      continue;
+    }
+    (*values)[node.name()] = std::move(node_values);
+  }
+  return Status::OK();
+}
+
+// Returns the relative L2 error of 'actual' against 'expected'.
+double RelativeError(const Tensor& expected, const Tensor& actual) {
+  const auto e = expected.flat<float>();
+  const auto a = actual.flat<float>();
+  double error = 0;
+  double norm = 0;
+  for (int64 i = 0; i < e.size(); ++i) {
+    error += (static_cast<double>(a(i)) - e(i)) * (a(i) - e(i));
+    norm += static_cast<double>(e(i)) * e(i);
+  }
+  if (norm == 0) return error == 0 ? 0 : std::numeric_limits<double>::max();
+  return std::sqrt(error / norm);
+}
+
+// Returns the lowest latency of kTimingRuns evaluations of 'node' on 'inputs',
+// in nanoseconds, or -1 if the node cannot be evaluated.
+int64 TimeNode(const NodeDef& node, const TensorVector& inputs,
+               DeviceBase* cpu_device, ResourceMgr* resource_mgr) {
+  int64 latency = -1;
+  for (int i = 0; i < kTimingRuns; ++i) {
+    TensorVector outputs;
+    const uint64 start = Env::Default()->NowNanos();
+    const Status status =
+        EvaluateNode(node, inputs, cpu_device, resource_mgr, &outputs);
+    const int64 elapsed = Env::Default()->NowNanos() - start;
+    for (const TensorValue& output : outputs) delete output.tensor;
+    if (!status.ok()) return -1;
+    if (latency < 0 || elapsed < latency) latency = elapsed;
+  }
+  return latency;
+}
+
+// Returns a node name starting with 'prefix' that is not in 'names', and adds
+// it to 'names'.
+string UniqueNodeName(const string& prefix,
+                      absl::flat_hash_set<string>* names) {
+  string name = prefix;
+  for (int i = 1; names->contains(name); ++i) {
+    name = absl::StrCat(prefix, "_", i);
+  }
+  names->insert(name);
+  return name;
+}
+
+// Names of the constants read by an int8 node.
+struct Int8ConstantNames {
+  string weights;
+  string scales;
+  string offsets;
+};
+
+// Returns a constant node named 'name' holding 'value'.
+NodeDef MakeConstant(const string& name, const NodeDef& weights,
+                     const Tensor& value) {
+  NodeDef constant;
+  constant.set_name(name);
+  constant.set_op("Const");
+  constant.set_device(weights.device());
+  // Keep the frame of the float weights.
+  for (const string& input : weights.input()) {
+    if (IsControlInput(input)) constant.add_input(input);
+  }
+  (*constant.mutable_attr())["dtype"].set_type(value.dtype());
+  value.AsProtoTensorContent(
+      (*constant.mutable_attr())["value"].mutable_tensor());
+  return constant;
+}
+
+// Sets up 'int8_node' as the int8 version of the candidate 'node', for inputs
+// quantized with 'input', reading the constants named 'constants'.
+void MakeInt8Node(const NodeDef& node, const Candidate& candidate,
+                  const int8_gemm::InputQuantization& input,
+                  const Int8ConstantNames& constants, NodeDef* int8_node) {
+  const auto copy_attr = [&node, int8_node](const string& attr) {
+    const AttrValue* value = AttrSlice(node).Find(attr);
+    if (value != nullptr) (*int8_node->mutable_attr())[attr] = *value;
+  };
+  int8_node->set_name(node.name());
+  int8_node->set_device(node.device());
+  int8_node->add_input(node.input(0));
+  int8_node->add_input(constants.weights);
+  int8_node->add_input(constants.scales);
+  int8_node->add_input(constants.offsets);
+  for (const string& node_input : node.input()) {
+    if (IsControlInput(node_input)) int8_node->add_input(node_input);
+  }
+  auto* attr = int8_node->mutable_attr();
+  if (candidate.is_matmul) {
+    int8_node->set_op("_Int8MatMul");
+  } else {
+    int8_node->set_op("_Int8Conv2D");
+    (*attr)["filter_rows"].set_i(candidate.filter_rows);
+    (*attr)["filter_cols"].set_i(candidate.filter_cols);
+    copy_attr("strides");
+    copy_attr("padding");
+    if (node.attr().count("dilations")) {
+      copy_attr("dilations");
+    } else {
+      for (int i = 0; i < 4; ++i) (*attr)["dilations"].mutable_list()->add_i(1);
+    }
+  }
+  (*attr)["input_scale"].set_f(input.scale);
+  (*attr)["input_zero_point"].set_i(input.zero_point);
+  (*attr)["activation"].set_s(candidate.activation);
+  const AttrValue* alpha = AttrSlice(node).Find("leakyrelu_alpha");
+  (*attr)["leakyrelu_alpha"].set_f(alpha != nullptr ? alpha->f() : 0.2f);
+}
+
+}  // namespace
+
+Status Int8QuantizationOptimizer::Optimize(Cluster* cluster,
+                                           const GrapplerItem& item,
+                                           GraphDef* optimized_graph) {
+  const GraphDef& graph = item.graph;
+
+  // 1. Find the candidates. Fed nodes are not rewritten: their consumers must
+  // read the fed value.
+  absl::flat_hash_set<string> fed_nodes;
+  for (const auto& feed : item.feed) {
+    fed_nodes.insert(string(ParseTensorName(feed.first).node()));
+  }
+  NodeMap node_map(const_cast<GraphDef*>(&graph));
+  absl::flat_hash_set<string> names;
+  for (const NodeDef& node : graph.node()) names.insert(node.name());
+  std::vector<Candidate> candidates;
+  absl::flat_hash_set<string> targets;
+  for (int i = 0; i < graph.node_size(); ++i) {
+    const NodeDef& node = graph.node(i);
+    Candidate candidate;
+    if (fed_nodes.contains(node.name()) ||
+        !GetCandidate(node_map, node, &candidate)) {
+      continue;
+    }
+    candidate.index = i;
+    candidates.push_back(std::move(candidate));
+    targets.insert(node.name());
+  }
+  if (candidates.empty()) {
+    return errors::Aborted("Nothing to do.");
+  }
+  // Calibration needs the values of the fed tensors.
+  for (const auto& feed : item.feed) {
+    if (!feed.second.IsInitialized()) {
+      return errors::Aborted("Calibration needs initialized feeds, but ",
+                             feed.first, " is not initialized.");
+    }
+  }
+
+  // 2. Calibrate.
+  std::unique_ptr<DeviceBase> owned_device;
+  DeviceBase* cpu_device = cpu_device_;
+  if (cpu_device == nullptr) {
+    owned_device.reset(new DeviceSimple());
+    cpu_device = owned_device.get();
+  }
+  ResourceMgr resource_mgr;
+  absl::flat_hash_map<string, std::vector<Tensor>> values;
+  TF_RETURN_IF_ERROR(
+      EvaluateFanin(item, targets, cpu_device, &resource_mgr, &values));
+  const auto get_value = [&values](const string& input) -> const Tensor* {
+    const TensorId id = ParseTensorName(input);
+    auto it = values.find(id.node());
+    if (it == values.end() ||
+        static_cast<int>(it->second.size()) <= id.index() ||
+        !it->second[id.index()].IsInitialized()) {
+      return nullptr;
+    }
+    return &it->second[id.index()];
+  };
+
+  // 3. Quantize the candidates and check their accuracy.
+  *optimized_graph = graph;
+  int num_quantized = 0;
+  double total_error = 0;
+  for (const Candidate& candidate : candidates) {
+    const NodeDef& node = graph.node(candidate.index);
+    const Tensor* input = get_value(node.input(0));
+    const Tensor* expected = get_value(node.name());
+    if (input == nullptr || expected == nullptr ||
+        input->dtype() != DT_FLOAT || input->NumElements() == 0) {
+      VLOG(1) << "int8 quantization: no calibration values for "
+              << node.name();
+      continue;
+    }
+    const int64 depth = candidate.weights.dim_size(0);
+    const int64 channels = candidate.weights.dim_size(1);
+    // Grouped convolutions are not supported.
+    const int expected_dims = candidate.is_matmul ? 2 : 4;
+    if (input->dims() != expected_dims ||
+        input->dim_size(expected_dims - 1) * candidate.filter_rows *
+                candidate.filter_cols !=
+            depth) {
+      continue;
+    }
+    const auto in = input->flat<float>();
+    float min = in(0);
+    float max = in(0);
+    for (int64 i = 1; i < in.size(); ++i) {
+      min = std::min(min, in(i));
+      max = std::max(max, in(i));
+    }
+    if (!std::isfinite(min) || !std::isfinite(max)) continue;
+    const int8_gemm::InputQuantization quantization =
+        int8_gemm::ChooseInputQuantization(min, max);
+
+    Tensor quantized(DT_QUINT8, {depth, channels});
+    Tensor scales(DT_FLOAT, {channels});
+    Tensor offsets(DT_FLOAT, {channels});
+    int8_gemm::PrepareWeights(
+        candidate.weights.flat<float>().data(),
+        candidate.bias.IsInitialized() ? candidate.bias.flat<float>().data()
+                                       : nullptr,
+        depth, channels, quantization,
+        reinterpret_cast<uint8*>(quantized.flat<quint8>().data()),
+        scales.flat<float>().data(), offsets.flat<float>().data());
+
+    // The constant names are only reserved if the node is rewritten.
+    absl::flat_hash_set<string> new_names = names;
+    Int8ConstantNames constants;
+    constants.weights =
+        UniqueNodeName(absl::StrCat(node.name(), kWeightsSuffix), &new_names);
+    constants.scales =
+        UniqueNodeName(absl::StrCat(node.name(), kScalesSuffix), &new_names);
+    constants.offsets =
+        UniqueNodeName(absl::StrCat(node.name(), kOffsetsSuffix), &new_names);
+    NodeDef int8_node;
+    MakeInt8Node(node, candidate, quantization, constants, &int8_node);
+    TensorVector inputs = {TensorValue(const_cast<Tensor*>(input)),
+                           TensorValue(&quantized), TensorValue(&scales),
+                           TensorValue(&offsets)};
+    TensorVector outputs;
+    const Status status =
+        EvaluateNode(int8_node, inputs, cpu_device, &resource_mgr, &outputs);
+    double error = std::numeric_limits<double>::max();
+    if (status.ok() && outputs.size() == 1 && outputs[0].tensor != nullptr &&
+        outputs[0].tensor->shape() == expected->shape()) {
+      error = RelativeError(*expected, *outputs[0].tensor);
+    }
+    for (const TensorValue& output : outputs) delete output.tensor;
+    if (!status.ok() || error > kMaxRelativeError) {
+      VLOG(1) << "int8 quantization: keeping " << node.name()
+              << " in float, relative error " << error << ", " << status;
+      continue;
+    }
+
+    // Only keep the int8 node if it is faster than the float node.
+    TensorVector float_inputs;
+    for (int i = 0; i < candidate.num_data_inputs; ++i) {
+      const Tensor* value = get_value(node.input(i));
+      if (value == nullptr) break;
+      float_inputs.emplace_back(const_cast<Tensor*>(value));
+    }
+    const int64 float_latency =
+        static_cast<int>(float_inputs.size()) == candidate.num_data_inputs
+            ? TimeNode(node, float_inputs, cpu_device, &resource_mgr)
+            : -1;
+    const int64 int8_latency =
+        TimeNode(int8_node, inputs, cpu_device, &resource_mgr);
+    if (float_latency < 0 || int8_latency < 0 ||
+        int8_latency * min_speedup_ > float_latency) {
+      VLOG(1) << "int8 quantization: keeping " << node.name()
+              << " in float, int8 latency " << int8_latency
+              << "ns, float latency " << float_latency << "ns";
+      continue;
+    }
+    VLOG(1) << "int8 quantization: " << node.name() << " (" << node.op()
+            << ", depth " << depth << ", " << channels
+            << " channels), input range [" << min << ", " << max
+            << "], relative error " << error << ", int8 latency "
+            << int8_latency << "ns, float latency " << float_latency << "ns";
+
+    names = std::move(new_names);
+    const NodeDef& weights = *node_map.GetNode(candidate.weights_node);
+    *optimized_graph->add_node() =
+        MakeConstant(constants.weights, weights, quantized);
+    *optimized_graph->add_node() =
+        MakeConstant(constants.scales, weights, scales);
+    *optimized_graph->add_node() =
+        MakeConstant(constants.offsets, weights, offsets);
+    optimized_graph->mutable_node(candidate.index)->Swap(&int8_node);
+    ++num_quantized;
+    total_error += error;
+  }
+
+  VLOG(1) << "int8 quantization: quantized " << num_quantized << " of "
+          << candidates.size() << " candidate nodes"
+          << (num_quantized > 0
+                  ? absl::StrCat(", mean relative error ",
+                                 total_error / num_quantized)
+                  : "");
+  if (num_quantized == 0) {
+    return errors::Aborted("Nothing to do.");
+  }
+  return Status::OK();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
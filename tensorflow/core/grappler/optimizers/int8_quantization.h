@@ -0,0 +1,71 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_INT8_QUANTIZATION_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_INT8_QUANTIZATION_H_
+
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Post-training quantization of float CPU inference graphs: replaces MatMul
+// and Conv2D nodes (and their _Fused variants with a bias and an activation)
+// that have constant weights with the int8 kernels _Int8MatMul and
+// _Int8Conv2D.
+//
+// The input ranges are calibrated by evaluating the graph on the tensors fed
+// in the GrapplerItem, so the optimizer does nothing unless the item has
+// initialized feeds. A node is only rewritten if its int8 output on the
+// calibration feeds is within a relative L2 error of the float output, and if
+// the int8 kernel is faster than the float kernel on the calibration input.
+class Int8QuantizationOptimizer : public GraphOptimizer {
+ public:
+  // Maximum relative L2 error of a rewritten node on the calibration feeds.
+  static constexpr float kMaxRelativeError = 0.05f;
+  // Default minimum ratio of the float latency of a rewritten node to its int8
+  // latency.
+  static constexpr float kMinSpeedup = 1.1f;
+
+  explicit Int8QuantizationOptimizer(DeviceBase* cpu_device = nullptr,
+                                     float min_speedup = kMinSpeedup)
+      : cpu_device_(cpu_device), min_speedup_(min_speedup) {}
+
+  ~Int8QuantizationOptimizer() override {}
+
+  string name() const override { return "int8_quantization"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override {}
+
+ private:
+  // Points to an externally provided device, or is null to evaluate nodes on
+  // a DeviceSimple.
+  DeviceBase* cpu_device_;
+  // Minimum ratio of the float latency of a node to its int8 latency for the
+  // node to be rewritten.
+  float min_speedup_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_INT8_QUANTIZATION_H_
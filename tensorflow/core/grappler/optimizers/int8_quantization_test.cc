@@ -0,0 +1,295 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/int8_quantization.h"
+
+#include <cmath>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+
+class Int8QuantizationOptimizerTest : public GrapplerTest {
+ protected:
+  // Places all the nodes of 'item' on CPU.
+  void PlaceOnCpu(GrapplerItem* item) {
+    for (int i = 0; i < item->graph.node_size(); ++i) {
+      item->graph.mutable_node(i)->set_device("/device:CPU:0");
+    }
+  }
+
+  // Checks that the fetches of 'output' are within a relative L2 error of 0.05
+  // of the fetches of 'item'.
+  void ExpectCloseFetches(const GrapplerItem& item, const GraphDef& output) {
+    auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+    auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+    ASSERT_EQ(tensors.size(), tensors_expected.size());
+    for (int i = 0; i < tensors.size(); ++i) {
+      ASSERT_EQ(tensors[i].shape(), tensors_expected[i].shape());
+      const auto expected = tensors_expected[i].flat<float>();
+      const auto actual = tensors[i].flat<float>();
+      double error = 0;
+      double norm = 0;
+      for (int64 j = 0; j < expected.size(); ++j) {
+        error += (actual(j) - expected(j)) * (actual(j) - expected(j));
+        norm += expected(j) * expected(j);
+      }
+      EXPECT_LT(std::sqrt(error / norm), 0.05) << item.fetch[i];
+    }
+  }
+
+  // Returns the node of 'graph' named 'name', or nullptr.
+  const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) return &node;
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(Int8QuantizationOptimizerTest, QuantizesMatMulAndConv2D) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto image = ops::Placeholder(s.WithOpName("image"), DT_FLOAT,
+                                ops::Placeholder::Shape({2, 9, 9, 3}));
+  auto filter = ops::Const(s.WithOpName("filter"),
+                           GenerateRandomTensor<DT_FLOAT>({3, 3, 3, 20}));
+  auto conv = ops::Conv2D(s.WithOpName("conv"), image, filter, {1, 2, 2, 1},
+                          "SAME");
+  auto conv_fetch = ops::Identity(s.WithOpName("conv_fetch"), conv);
+
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({7, 33}));
+  auto weights = ops::Const(s.WithOpName("weights"),
+                            GenerateRandomTensor<DT_FLOAT>({18, 33}));
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), x, weights,
+                            ops::MatMul::TransposeB(true));
+  auto matmul_fetch = ops::Identity(s.WithOpName("matmul_fetch"), matmul);
+
+  GrapplerItem item;
+  item.fetch = {"conv_fetch", "matmul_fetch"};
+  item.feed = {{"image", GenerateRandomTensor<DT_FLOAT>({2, 9, 9, 3})},
+               {"x", GenerateRandomTensor<DT_FLOAT>({7, 33})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  // Rewrites accurate nodes regardless of their latency.
+  Int8QuantizationOptimizer optimizer(/*cpu_device=*/nullptr,
+                                      /*min_speedup=*/0);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const NodeDef* conv_node = FindNode(output, "conv");
+  ASSERT_NE(conv_node, nullptr);
+  EXPECT_EQ(conv_node->op(), "_Int8Conv2D");
+  ASSERT_EQ(conv_node->input_size(), 4);
+  EXPECT_EQ(conv_node->input(0), "image");
+  EXPECT_EQ(conv_node->input(1), "conv/int8_weights");
+  EXPECT_EQ(conv_node->input(2), "conv/int8_scales");
+  EXPECT_EQ(conv_node->input(3), "conv/int8_offsets");
+  EXPECT_EQ(conv_node->attr().at("filter_rows").i(), 3);
+  EXPECT_EQ(conv_node->attr().at("filter_cols").i(), 3);
+  EXPECT_EQ(conv_node->attr().at("activation").s(), "None");
+
+  const NodeDef* matmul_node = FindNode(output, "matmul");
+  ASSERT_NE(matmul_node, nullptr);
+  EXPECT_EQ(matmul_node->op(), "_Int8MatMul");
+  EXPECT_EQ(matmul_node->input(0), "x");
+  const NodeDef* quantized = FindNode(output, "matmul/int8_weights");
+  ASSERT_NE(quantized, nullptr);
+  EXPECT_EQ(quantized->op(), "Const");
+  EXPECT_EQ(quantized->attr().at("dtype").type(), DT_QUINT8);
+
+  ExpectCloseFetches(item, output);
+}
+
+TEST_F(Int8QuantizationOptimizerTest, QuantizesFusedMatMul) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({5, 40}));
+  auto weights = ops::Const(s.WithOpName("weights"),
+                            GenerateRandomTensor<DT_FLOAT>({40, 24}));
+  auto bias =
+      ops::Const(s.WithOpName("bias"), GenerateRandomTensor<DT_FLOAT>({24}));
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"x", GenerateRandomTensor<DT_FLOAT>({5, 40})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  NodeDef* fused = item.graph.add_node();
+  fused->set_name("fused");
+  fused->set_op("_FusedMatMul");
+  fused->add_input("x");
+  fused->add_input("weights");
+  fused->add_input("bias");
+  AddNodeAttr("T", DT_FLOAT, fused);
+  AddNodeAttr("transpose_a", false, fused);
+  AddNodeAttr("transpose_b", false, fused);
+  AddNodeAttr("num_args", 1, fused);
+  AddNodeAttr("fused_ops", std::vector<string>{"BiasAdd", "Relu"}, fused);
+  AddNodeAttr("epsilon", 0.0001f, fused);
+  NodeDef* fetch = item.graph.add_node();
+  fetch->set_name("fetch");
+  fetch->set_op("Identity");
+  fetch->add_input("fused");
+  AddNodeAttr("T", DT_FLOAT, fetch);
+  PlaceOnCpu(&item);
+
+  // Rewrites accurate nodes regardless of their latency.
+  Int8QuantizationOptimizer optimizer(/*cpu_device=*/nullptr,
+                                      /*min_speedup=*/0);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const NodeDef* fused_node = FindNode(output, "fused");
+  ASSERT_NE(fused_node, nullptr);
+  EXPECT_EQ(fused_node->op(), "_Int8MatMul");
+  EXPECT_EQ(fused_node->attr().at("activation").s(), "Relu");
+  ExpectCloseFetches(item, output);
+}
+
+TEST_F(Int8QuantizationOptimizerTest, MakesConstantNamesUnique) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 16}));
+  auto weights = ops::Const(s.WithOpName("weights"),
+                            GenerateRandomTensor<DT_FLOAT>({16, 8}));
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), x, weights);
+  // A node already has the name of the quantized weights.
+  auto taken = ops::Identity(s.WithOpName("matmul/int8_weights"), matmul);
+
+  GrapplerItem item;
+  item.fetch = {"matmul/int8_weights"};
+  item.feed = {{"x", GenerateRandomTensor<DT_FLOAT>({4, 16})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  Int8QuantizationOptimizer optimizer(/*cpu_device=*/nullptr,
+                                      /*min_speedup=*/0);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const NodeDef* matmul_node = FindNode(output, "matmul");
+  ASSERT_NE(matmul_node, nullptr);
+  EXPECT_EQ(matmul_node->op(), "_Int8MatMul");
+  EXPECT_EQ(matmul_node->input(1), "matmul/int8_weights_1");
+  const NodeDef* taken_node = FindNode(output, "matmul/int8_weights");
+  ASSERT_NE(taken_node, nullptr);
+  EXPECT_EQ(taken_node->op(), "Identity");
+  ExpectCloseFetches(item, output);
+}
+
+TEST_F(Int8QuantizationOptimizerTest, KeepsSlowerNodesInFloat) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 16}));
+  auto weights = ops::Const(s.WithOpName("weights"),
+                            GenerateRandomTensor<DT_FLOAT>({16, 8}));
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), x, weights);
+
+  GrapplerItem item;
+  item.fetch = {"matmul"};
+  item.feed = {{"x", GenerateRandomTensor<DT_FLOAT>({4, 16})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  // No int8 kernel is a million times faster than its float kernel.
+  Int8QuantizationOptimizer optimizer(/*cpu_device=*/nullptr,
+                                      /*min_speedup=*/1e6f);
+  GraphDef output;
+  const Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status)) << status;
+}
+
+TEST_F(Int8QuantizationOptimizerTest, KeepsInaccurateNodesInFloat) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 16}));
+  // The outlier of x in column 0 is multiplied by zero weights, so the output
+  // only depends on small values of x that quantize to 0.
+  Tensor weights_value = GenerateRandomTensor<DT_FLOAT>({16, 8});
+  for (int n = 0; n < 8; ++n) weights_value.matrix<float>()(0, n) = 0;
+  auto weights = ops::Const(s.WithOpName("weights"), weights_value);
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), x, weights);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), matmul);
+
+  Tensor x_value(DT_FLOAT, {4, 16});
+  x_value.flat<float>().setConstant(1e-3f);
+  x_value.matrix<float>()(0, 0) = 1e3f;
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"x", x_value}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  Int8QuantizationOptimizer optimizer(/*cpu_device=*/nullptr,
+                                      /*min_speedup=*/0);
+  GraphDef output;
+  const Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status)) << status;
+}
+
+TEST_F(Int8QuantizationOptimizerTest, NeedsCalibrationFeeds) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 16}));
+  auto weights = ops::Const(s.WithOpName("weights"),
+                            GenerateRandomTensor<DT_FLOAT>({16, 8}));
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), x, weights);
+
+  GrapplerItem item;
+  item.fetch = {"matmul"};
+  // The feeds of a session run are not initialized.
+  item.feed = {{"x", Tensor()}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  Int8QuantizationOptimizer optimizer;
+  GraphDef output;
+  const Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status)) << status;
+}
+
+TEST_F(Int8QuantizationOptimizerTest, IgnoresNonConstantWeights) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 16}));
+  auto y = ops::Placeholder(s.WithOpName("y"), DT_FLOAT,
+                            ops::Placeholder::Shape({16, 8}));
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), x, y);
+
+  GrapplerItem item;
+  item.fetch = {"matmul"};
+  item.feed = {{"x", GenerateRandomTensor<DT_FLOAT>({4, 16})},
+               {"y", GenerateRandomTensor<DT_FLOAT>({16, 8})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  Int8QuantizationOptimizer optimizer;
+  GraphDef output;
+  const Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status)) << status;
+}
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -35,6 +35,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/mutable_graph_view.h"
 #include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/memory_scheduler.h"
 #include "tensorflow/core/grappler/optimizers/static_schedule.h"
 #include "tensorflow/core/grappler/utils.h"
 #include "tensorflow/core/grappler/utils/topological_sort.h"
@@ -1376,6 +1377,93 @@ Status FindAssignNodesToRelax(const GraphDef& graph,
   return Status::OK();
 }
 
+// Logs the peak memory usage of `item` on the devices of `cluster` simulated
+// by GraphMemory.
+void LogSimulatedPeakMemoryUsage(Cluster* cluster, const GrapplerItem& item,
+                                 const string& description) {
+  GraphMemory memory(item);
+  Status s = memory.InferStatically(cluster->GetDevices());
+  if (!s.ok()) {
+    VLOG(1) << "Failed to infer memory usage: " << s.error_message();
+    return;
+  }
+  for (const auto& device : cluster->GetDevices()) {
+    VLOG(1) << "Simulated peak memory usage of " << item.id << " on "
+            << device.first << " " << description << ": "
+            << memory.GetPeakMemoryUsage(device.first).used_memory
+            << " bytes";
+  }
+}
+
+// Adds control dependencies enforcing the order computed by
+// ComputeMemorySchedule, if it lowers the estimated peak memory usage. Only the
+// nodes allocating or freeing a significant part of the peak memory are
+// chained, one chain per device, so that the other nodes still run in
+// parallel.
+bool PeakMemorySchedulingPass(Cluster* cluster, GrapplerItem* item) {
+  for (const NodeDef& node : item->graph.node()) {
+    // The executor schedules the iterations of loops dynamically.
+    if (IsControlFlow(node)) return false;
+  }
+
+  GraphProperties properties(*item);
+  Status s = properties.InferStatically(/*assume_valid_feeds=*/false);
+  if (!s.ok()) {
+    VLOG(1) << "Failed to infer shapes: " << s.error_message();
+    return false;
+  }
+  MemorySchedule schedule;
+  s = ComputeMemorySchedule(*item, properties, &schedule);
+  if (!s.ok()) {
+    VLOG(1) << "Failed to compute the memory schedule: " << s.error_message();
+    return false;
+  }
+  if (schedule.peak_memory >= schedule.default_peak_memory) return false;
+
+  const bool log_simulated_memory = VLOG_IS_ON(1) && cluster != nullptr;
+  if (log_simulated_memory) {
+    LogSimulatedPeakMemoryUsage(cluster, *item, "before scheduling");
+  }
+
+  NodeMap node_map(&item->graph);
+  std::unordered_map<string, const NodeDef*> last_node_per_device;
+  int num_control_dependencies = 0;
+  for (int i = 0; i < static_cast<int>(schedule.nodes.size()); ++i) {
+    const NodeDef* node = schedule.nodes[i];
+    const int64 bytes =
+        std::max(schedule.allocated_bytes[i], schedule.freed_bytes[i]);
+    if (bytes * 100 < schedule.peak_memory || NumNonControlInputs(*node) == 0) {
+      continue;
+    }
+    const NodeDef*& last_node = last_node_per_device[node->device()];
+    if (last_node != nullptr) {
+      bool has_fanin = false;
+      for (const string& input : node->input()) {
+        if (ParseTensorName(input).node() == last_node->name()) {
+          has_fanin = true;
+          break;
+        }
+      }
+      if (!has_fanin) {
+        NodeDef* mutable_node = node_map.GetNode(node->name());
+        mutable_node->add_input(AsControlDependency(*last_node));
+        ++num_control_dependencies;
+      }
+    }
+    last_node = node;
+  }
+  VLOG(1) << "Added " << num_control_dependencies
+          << " control dependencies to " << item->id
+          << ", lowering its estimated peak memory usage from "
+          << schedule.default_peak_memory << " to " << schedule.peak_memory
+          << " bytes";
+
+  if (log_simulated_memory) {
+    LogSimulatedPeakMemoryUsage(cluster, *item, "after scheduling");
+  }
+  return num_control_dependencies > 0;
+}
+
 }  // namespace
 
 Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
@@ -1400,6 +1488,12 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                                &optimized_item.graph, item);
   }
 
+  if (optimization_level_ == RewriterConfig::PEAK_MEMORY_SCHEDULING &&
+      !item.fetch.empty()) {
+    GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+    PeakMemorySchedulingPass(cluster, &optimized_item);
+  }
+
   std::unordered_set<string> skip_list;
   // Bound the number of rewrite passes to avoid long processing times on graphs
   // that simply won't fit in memory.
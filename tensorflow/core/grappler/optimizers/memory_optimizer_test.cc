@@ -448,6 +448,43 @@ TEST_F(MemoryOptimizerTest, AccumulationRewrites) {
   }
 }
 
+TEST_F(MemoryOptimizerTest, PeakMemoryScheduling) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice("/cpu:0");
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                              ops::Placeholder::Shape({256, 256}));
+  Output axis = ops::Const(s.WithOpName("axis"), {0, 1}, {2});
+  Output a1 = ops::Square(s.WithOpName("a1"), x);
+  Output a2 = ops::Exp(s.WithOpName("a2"), x);
+  Output r1 = ops::Sum(s.WithOpName("r1"), a1, axis);
+  Output r2 = ops::Sum(s.WithOpName("r2"), a2, axis);
+  Output out = ops::Add(s.WithOpName("out"), r1, r2);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"out"};
+
+  MemoryOptimizer optimizer(RewriterConfig::PEAK_MEMORY_SCHEDULING);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(/*cluster=*/nullptr, item, &output));
+
+  // The second large tensor is only computed once the first one is reduced.
+  ASSERT_EQ(item.graph.node_size(), output.node_size());
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "a2") {
+      ASSERT_EQ(2, node.input_size());
+      EXPECT_EQ("^r1", node.input(1));
+    } else {
+      EXPECT_EQ(NumControlInputs(node), 0) << node.name();
+    }
+  }
+
+  auto x_t = GenerateRandomTensor<DT_FLOAT>(TensorShape({256, 256}));
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, {{"x", x_t}});
+  auto tensors = EvaluateNodes(output, item.fetch, {{"x", x_t}});
+  ASSERT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-3);
+}
+
 class RelaxAllocatorConstraintsTest : public GrapplerTest {};
 
 TEST_F(RelaxAllocatorConstraintsTest, SameDevice) {
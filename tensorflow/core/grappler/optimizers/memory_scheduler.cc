@@ -0,0 +1,404 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/memory_scheduler.h"
+
+#include <algorithm>
+#include <queue>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/graph/tensor_id.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Returns the input whose buffer the output `port` of `node` forwards, or -1
+// if the output is allocated by the node.
+int ForwardedInput(const NodeDef& node, int port) {
+  if (IsIdentityN(node)) return port;
+  if (IsIdentity(node) || IsReshape(node) || IsSqueeze(node) ||
+      node.op() == "ExpandDims") {
+    return port == 0 ? 0 : -1;
+  }
+  return -1;
+}
+
+// The buffers allocated and used by the nodes of a graph, indexed by their
+// position in the graph.
+class MemoryModel {
+ public:
+  Status Init(const GrapplerItem& item, const GraphProperties& properties);
+
+  int num_nodes() const { return nodes_.size(); }
+  const NodeDef* node(int i) const { return nodes_[i]; }
+  // Returns the index of the node, or -1 if it is not in the graph.
+  int index(const NodeDef* node) const {
+    auto it = node_index_.find(node->name());
+    return it == node_index_.end() || nodes_[it->second] != node ? -1
+                                                                 : it->second;
+  }
+  const std::vector<int>& default_order() const { return default_order_; }
+  int64 allocated_bytes(int i) const {
+    int64 bytes = 0;
+    for (int buffer : allocated_buffers_[i]) bytes += buffer_sizes_[buffer];
+    return bytes;
+  }
+
+  // Returns the peak memory usage of executing the nodes in `order`. If
+  // `freed_bytes` is not null, it is set to the bytes of the inputs freed by
+  // each node of `order`.
+  int64 PeakMemoryUsage(const std::vector<int>& order,
+                        std::vector<int64>* freed_bytes = nullptr) const;
+
+  // Returns the order computed by a list scheduler that runs the ready node
+  // with the largest difference between the bytes it frees and the bytes it
+  // allocates.
+  std::vector<int> ListSchedule() const;
+
+  // Returns the post order of a depth first traversal of the graph, which
+  // visits the fanins of each node by decreasing size of their own fanin.
+  std::vector<int> DfsSchedule() const;
+
+ private:
+  int BufferOf(const TensorId& tensor) const;
+
+  std::vector<const NodeDef*> nodes_;
+  absl::flat_hash_map<string, int> node_index_;
+  // Regular and control fanins and fanouts.
+  std::vector<std::vector<int>> fanins_;
+  std::vector<std::vector<int>> fanouts_;
+  std::vector<int> default_order_;
+
+  // The buffer of each node output, or -1 if it is unknown.
+  std::vector<std::vector<int>> output_buffers_;
+  // The buffers each node allocates, and the distinct buffers it reads.
+  std::vector<std::vector<int>> allocated_buffers_;
+  std::vector<std::vector<int>> used_buffers_;
+  std::vector<int64> buffer_sizes_;
+  std::vector<std::vector<int>> buffer_users_;
+  // The number of nodes using each buffer, plus one if it is fetched.
+  std::vector<int> buffer_uses_;
+};
+
+Status MemoryModel::Init(const GrapplerItem& item,
+                         const GraphProperties& properties) {
+  const GraphDef& graph = item.graph;
+  const int num_nodes = graph.node_size();
+  nodes_.reserve(num_nodes);
+  for (const NodeDef& node : graph.node()) {
+    node_index_[node.name()] = nodes_.size();
+    nodes_.push_back(&node);
+  }
+
+  fanins_.resize(num_nodes);
+  fanouts_.resize(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    for (const string& input : nodes_[i]->input()) {
+      auto it = node_index_.find(ParseTensorName(input).node());
+      if (it == node_index_.end()) {
+        return errors::InvalidArgument("Node ", nodes_[i]->name(),
+                                       " has an unknown input ", input);
+      }
+      fanins_[i].push_back(it->second);
+    }
+    std::sort(fanins_[i].begin(), fanins_[i].end());
+    fanins_[i].erase(std::unique(fanins_[i].begin(), fanins_[i].end()),
+                     fanins_[i].end());
+    for (int fanin : fanins_[i]) {
+      fanouts_[fanin].push_back(i);
+    }
+  }
+
+  std::vector<const NodeDef*> topo_order;
+  TF_RETURN_IF_ERROR(ComputeTopologicalOrder(graph, &topo_order));
+  default_order_.reserve(num_nodes);
+  for (const NodeDef* node : topo_order) {
+    default_order_.push_back(node_index_.at(node->name()));
+  }
+
+  // Assign the buffers in topological order, so that forwarded buffers are
+  // known when the forwarding node is processed.
+  output_buffers_.resize(num_nodes);
+  allocated_buffers_.resize(num_nodes);
+  used_buffers_.resize(num_nodes);
+  for (int i : default_order_) {
+    const NodeDef& node = *nodes_[i];
+    const std::vector<OpInfo::TensorProperties>& outputs =
+        properties.GetOutputProperties(node.name());
+    const bool persistent = IsConstant(node) || IsVariable(node);
+    output_buffers_[i].resize(outputs.size(), -1);
+    for (int port = 0; port < static_cast<int>(outputs.size()); ++port) {
+      const int input = ForwardedInput(node, port);
+      if (input >= 0 && input < node.input_size() &&
+          !IsControlInput(node.input(input))) {
+        output_buffers_[i][port] = BufferOf(ParseTensorName(node.input(input)));
+        continue;
+      }
+      output_buffers_[i][port] = buffer_sizes_.size();
+      allocated_buffers_[i].push_back(buffer_sizes_.size());
+      buffer_sizes_.push_back(persistent ? 0
+                                         : CalculateTensorSize(outputs[port]));
+    }
+
+    for (const string& input : node.input()) {
+      const TensorId tensor = ParseTensorName(input);
+      if (tensor.index() < 0) break;
+      const int buffer = BufferOf(tensor);
+      if (buffer >= 0 && std::find(used_buffers_[i].begin(),
+                                   used_buffers_[i].end(),
+                                   buffer) == used_buffers_[i].end()) {
+        used_buffers_[i].push_back(buffer);
+      }
+    }
+  }
+
+  buffer_users_.resize(buffer_sizes_.size());
+  buffer_uses_.resize(buffer_sizes_.size(), 0);
+  for (int i = 0; i < num_nodes; ++i) {
+    for (int buffer : used_buffers_[i]) {
+      buffer_users_[buffer].push_back(i);
+      ++buffer_uses_[buffer];
+    }
+  }
+  for (const string& fetch : item.fetch) {
+    const TensorId tensor = ParseTensorName(fetch);
+    if (tensor.index() < 0 || node_index_.find(tensor.node()) ==
+                                  node_index_.end()) {
+      continue;
+    }
+    const int buffer = BufferOf(tensor);
+    if (buffer >= 0) ++buffer_uses_[buffer];
+  }
+  return Status::OK();
+}
+
+int MemoryModel::BufferOf(const TensorId& tensor) const {
+  const std::vector<int>& buffers =
+      output_buffers_[node_index_.at(tensor.node())];
+  return tensor.index() < static_cast<int>(buffers.size())
+             ? buffers[tensor.index()]
+             : -1;
+}
+
+int64 MemoryModel::PeakMemoryUsage(const std::vector<int>& order,
+                                   std::vector<int64>* freed_bytes) const {
+  std::vector<int> remaining_uses = buffer_uses_;
+  int64 memory = 0;
+  int64 peak_memory = 0;
+  if (freed_bytes != nullptr) freed_bytes->assign(order.size(), 0);
+  for (int pos = 0; pos < static_cast<int>(order.size()); ++pos) {
+    const int i = order[pos];
+    memory += allocated_bytes(i);
+    peak_memory = std::max(peak_memory, memory);
+    for (int buffer : used_buffers_[i]) {
+      if (--remaining_uses[buffer] > 0) continue;
+      memory -= buffer_sizes_[buffer];
+      if (freed_bytes != nullptr) (*freed_bytes)[pos] += buffer_sizes_[buffer];
+    }
+    // Outputs that nothing uses are freed right away.
+    for (int buffer : allocated_buffers_[i]) {
+      if (remaining_uses[buffer] == 0) memory -= buffer_sizes_[buffer];
+    }
+  }
+  return peak_memory;
+}
+
+std::vector<int> MemoryModel::ListSchedule() const {
+  const int num_nodes = nodes_.size();
+  std::vector<int> remaining_uses = buffer_uses_;
+  std::vector<int> num_pending_fanins(num_nodes);
+  std::vector<bool> ready(num_nodes, false);
+  std::vector<bool> scheduled(num_nodes, false);
+  // Entries of the queue are ignored once the priority of their node changed.
+  std::vector<int> versions(num_nodes, 0);
+
+  struct Entry {
+    int64 priority;
+    int node;
+    int version;
+    bool operator<(const Entry& other) const {
+      // Break the ties by the order of the nodes in the graph.
+      return priority < other.priority ||
+             (priority == other.priority && node > other.node);
+    }
+  };
+  std::priority_queue<Entry> queue;
+  auto push = [&](int i) {
+    int64 priority = 0;
+    for (int buffer : used_buffers_[i]) {
+      if (remaining_uses[buffer] == 1) priority += buffer_sizes_[buffer];
+    }
+    for (int buffer : allocated_buffers_[i]) {
+      if (remaining_uses[buffer] > 0) priority -= buffer_sizes_[buffer];
+    }
+    queue.push({priority, i, versions[i]});
+  };
+
+  for (int i = 0; i < num_nodes; ++i) {
+    num_pending_fanins[i] = fanins_[i].size();
+    if (num_pending_fanins[i] == 0) {
+      ready[i] = true;
+      push(i);
+    }
+  }
+
+  std::vector<int> order;
+  order.reserve(num_nodes);
+  while (!queue.empty()) {
+    const Entry entry = queue.top();
+    queue.pop();
+    const int i = entry.node;
+    if (scheduled[i] || entry.version != versions[i]) continue;
+    scheduled[i] = true;
+    order.push_back(i);
+    for (int buffer : used_buffers_[i]) {
+      // The last user of the buffer now frees it.
+      if (--remaining_uses[buffer] != 1) continue;
+      for (int user : buffer_users_[buffer]) {
+        if (ready[user] && !scheduled[user]) {
+          ++versions[user];
+          push(user);
+        }
+      }
+    }
+    for (int fanout : fanouts_[i]) {
+      if (--num_pending_fanins[fanout] == 0) {
+        ready[fanout] = true;
+        push(fanout);
+      }
+    }
+  }
+  return order;
+}
+
+std::vector<int> MemoryModel::DfsSchedule() const {
+  const int num_nodes = nodes_.size();
+  // The total size of the buffers allocated in the fanin of each node,
+  // counting the shared fanins once per path.
+  constexpr int64 kMaxTotalSize = kint64max / 4;
+  std::vector<int64> total_sizes(num_nodes, 0);
+  for (int i : default_order_) {
+    int64 total_size = allocated_bytes(i);
+    for (int fanin : fanins_[i]) {
+      total_size = std::min(kMaxTotalSize, total_size + total_sizes[fanin]);
+    }
+    total_sizes[i] = total_size;
+  }
+
+  std::vector<std::vector<int>> sorted_fanins = fanins_;
+  for (std::vector<int>& fanins : sorted_fanins) {
+    std::sort(fanins.begin(), fanins.end(), [&](int a, int b) {
+      return total_sizes[a] > total_sizes[b] ||
+             (total_sizes[a] == total_sizes[b] && a < b);
+    });
+  }
+
+  std::vector<int> order;
+  order.reserve(num_nodes);
+  std::vector<bool> visited(num_nodes, false);
+  // Pairs of a node and the position of its next fanin to visit.
+  std::vector<std::pair<int, int>> stack;
+  for (int root = 0; root < num_nodes; ++root) {
+    if (!fanouts_[root].empty() || visited[root]) continue;
+    visited[root] = true;
+    stack.emplace_back(root, 0);
+    while (!stack.empty()) {
+      std::pair<int, int>& top = stack.back();
+      const std::vector<int>& fanins = sorted_fanins[top.first];
+      if (top.second < static_cast<int>(fanins.size())) {
+        const int fanin = fanins[top.second++];
+        if (!visited[fanin]) {
+          visited[fanin] = true;
+          stack.emplace_back(fanin, 0);
+        }
+      } else {
+        order.push_back(top.first);
+        stack.pop_back();
+      }
+    }
+  }
+  return order;
+}
+
+}  // namespace
+
+Status EstimatePeakMemoryUsage(const GrapplerItem& item,
+                               const GraphProperties& properties,
+                               const std::vector<const NodeDef*>& nodes,
+                               int64* peak_memory) {
+  MemoryModel model;
+  TF_RETURN_IF_ERROR(model.Init(item, properties));
+  if (static_cast<int>(nodes.size()) != model.num_nodes()) {
+    return errors::InvalidArgument("The order has ", nodes.size(),
+                                   " nodes, but the graph has ",
+                                   model.num_nodes());
+  }
+  std::vector<int> order;
+  order.reserve(nodes.size());
+  for (const NodeDef* node : nodes) {
+    const int i = model.index(node);
+    if (i < 0) {
+      return errors::InvalidArgument("Node ", node->name(),
+                                     " is not in the graph");
+    }
+    order.push_back(i);
+  }
+  *peak_memory = model.PeakMemoryUsage(order);
+  return Status::OK();
+}
+
+Status ComputeMemorySchedule(const GrapplerItem& item,
+                             const GraphProperties& properties,
+                             MemorySchedule* schedule) {
+  MemoryModel model;
+  TF_RETURN_IF_ERROR(model.Init(item, properties));
+
+  std::vector<int> best_order = model.default_order();
+  int64 best_peak_memory = model.PeakMemoryUsage(best_order);
+  schedule->default_peak_memory = best_peak_memory;
+  std::vector<std::vector<int>> orders = {model.ListSchedule(),
+                                          model.DfsSchedule()};
+  for (std::vector<int>& order : orders) {
+    const int64 peak_memory = model.PeakMemoryUsage(order);
+    if (peak_memory < best_peak_memory) {
+      best_order = std::move(order);
+      best_peak_memory = peak_memory;
+    }
+  }
+  VLOG(1) << "Estimated peak memory usage of " << item.id << ": "
+          << schedule->default_peak_memory << " bytes in the default order, "
+          << best_peak_memory << " bytes in the best order";
+
+  schedule->nodes.clear();
+  schedule->allocated_bytes.clear();
+  schedule->nodes.reserve(best_order.size());
+  schedule->allocated_bytes.reserve(best_order.size());
+  for (int i : best_order) {
+    schedule->nodes.push_back(model.node(i));
+    schedule->allocated_bytes.push_back(model.allocated_bytes(i));
+  }
+  schedule->peak_memory =
+      model.PeakMemoryUsage(best_order, &schedule->freed_bytes);
+  return Status::OK();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
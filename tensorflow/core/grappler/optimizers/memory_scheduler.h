@@ -0,0 +1,68 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_MEMORY_SCHEDULER_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_MEMORY_SCHEDULER_H_
+
+#include <vector>
+
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// An order in which to execute the nodes of a graph, and its estimated peak
+// memory usage in bytes.
+struct MemorySchedule {
+  std::vector<const NodeDef*> nodes;
+  // The bytes allocated for the outputs of each node in `nodes`, and the bytes
+  // of its inputs it frees.
+  std::vector<int64> allocated_bytes;
+  std::vector<int64> freed_bytes;
+  int64 peak_memory = 0;
+  // The estimated peak memory usage of the default topological order of the
+  // graph, for comparison.
+  int64 default_peak_memory = 0;
+};
+
+// Estimates the peak memory usage of executing the nodes of `item` in the
+// topological order `nodes`. A tensor is live from the execution of its
+// producer until the execution of its last consumer, or until the end if it is
+// fetched. The outputs of the ops forwarding their input, such as Identity or
+// Reshape, share the buffer of their input. The tensor sizes are taken from
+// `properties`, with unknown dimensions assumed to be 1. Constants and
+// variables are not counted, since they are live regardless of the order.
+Status EstimatePeakMemoryUsage(const GrapplerItem& item,
+                               const GraphProperties& properties,
+                               const std::vector<const NodeDef*>& nodes,
+                               int64* peak_memory);
+
+// Computes a topological order of the nodes of `item` that minimizes their
+// peak memory usage, as estimated by EstimatePeakMemoryUsage. Like XLA's
+// memory schedulers, it tries a list scheduler that greedily runs the ready
+// node freeing the most memory, and a depth first scheduler that runs the
+// largest fanin subgraphs of each node first, and keeps the best of these and
+// of the default topological order. Fails if the graph has a cycle.
+Status ComputeMemorySchedule(const GrapplerItem& item,
+                             const GraphProperties& properties,
+                             MemorySchedule* schedule);
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_MEMORY_SCHEDULER_H_
@@ -0,0 +1,112 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/memory_scheduler.h"
+
+#include <algorithm>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr int64 kTensorBytes = 256 * 256 * sizeof(float);
+
+// Builds a graph reducing two large functions of the same input. Running
+// both functions before the reductions keeps three large tensors alive,
+// whereas reducing each function right away keeps only two.
+GrapplerItem MakeItem() {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                              ops::Placeholder::Shape({256, 256}));
+  Output axis = ops::Const(s.WithOpName("axis"), {0, 1}, {2});
+  Output a1 = ops::Square(s.WithOpName("a1"), x);
+  Output a2 = ops::Exp(s.WithOpName("a2"), x);
+  Output r1 = ops::Sum(s.WithOpName("r1"), a1, axis);
+  Output r2 = ops::Sum(s.WithOpName("r2"), a2, axis);
+  Output out = ops::Add(s.WithOpName("out"), r1, r2);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"out"};
+  return item;
+}
+
+int Position(const std::vector<const NodeDef*>& nodes, const string& name) {
+  auto it = std::find_if(
+      nodes.begin(), nodes.end(),
+      [&name](const NodeDef* node) { return node->name() == name; });
+  return it - nodes.begin();
+}
+
+TEST(MemorySchedulerTest, LowersPeakMemoryUsage) {
+  const GrapplerItem item = MakeItem();
+  GraphProperties properties(item);
+  TF_ASSERT_OK(properties.InferStatically(/*assume_valid_feeds=*/false));
+
+  MemorySchedule schedule;
+  TF_ASSERT_OK(ComputeMemorySchedule(item, properties, &schedule));
+  EXPECT_EQ(schedule.default_peak_memory, 3 * kTensorBytes);
+  EXPECT_EQ(schedule.peak_memory, 2 * kTensorBytes + sizeof(float));
+  ASSERT_EQ(schedule.nodes.size(), item.graph.node_size());
+  ASSERT_EQ(schedule.allocated_bytes.size(), item.graph.node_size());
+  ASSERT_EQ(schedule.freed_bytes.size(), item.graph.node_size());
+  EXPECT_LT(Position(schedule.nodes, "r1"), Position(schedule.nodes, "a2"));
+  EXPECT_EQ(schedule.allocated_bytes[Position(schedule.nodes, "a1")],
+            kTensorBytes);
+  EXPECT_EQ(schedule.freed_bytes[Position(schedule.nodes, "r1")],
+            kTensorBytes);
+
+  int64 peak_memory = 0;
+  TF_ASSERT_OK(EstimatePeakMemoryUsage(item, properties, schedule.nodes,
+                                       &peak_memory));
+  EXPECT_EQ(peak_memory, schedule.peak_memory);
+}
+
+TEST(MemorySchedulerTest, ForwardedTensorsShareTheirBuffer) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                              ops::Placeholder::Shape({256, 256}));
+  Output shape = ops::Const(s.WithOpName("shape"), {256 * 256}, {1});
+  Output reshape = ops::Reshape(s.WithOpName("reshape"), x, shape);
+  Output identity = ops::Identity(s.WithOpName("identity"), reshape);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"identity"};
+  GraphProperties properties(item);
+  TF_ASSERT_OK(properties.InferStatically(/*assume_valid_feeds=*/false));
+
+  std::vector<const NodeDef*> nodes;
+  for (const NodeDef& node : item.graph.node()) {
+    nodes.push_back(&node);
+  }
+  int64 peak_memory = 0;
+  TF_ASSERT_OK(EstimatePeakMemoryUsage(item, properties, nodes, &peak_memory));
+  EXPECT_EQ(peak_memory, kTensorBytes);
+
+  nodes.pop_back();
+  EXPECT_FALSE(
+      EstimatePeakMemoryUsage(item, properties, nodes, &peak_memory).ok());
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -27,19 +27,23 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
 #include "tensorflow/core/grappler/optimizers/arithmetic_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/auto_mixed_precision.h"
 #include "tensorflow/core/grappler/optimizers/auto_parallel.h"
 #include "tensorflow/core/grappler/optimizers/common_subgraph_elimination.h"
 #include "tensorflow/core/grappler/optimizers/constant_folding.h"
+#include "tensorflow/core/grappler/optimizers/cpu_blocked_layout_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
 #include "tensorflow/core/grappler/optimizers/debug_stripper.h"
 #include "tensorflow/core/grappler/optimizers/dependency_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/function_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/generic_layout_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/implementation_selector.h"
+#include "tensorflow/core/grappler/optimizers/int8_quantization.h"
 #include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/meta_optimizer_cache.h"
 #include "tensorflow/core/grappler/optimizers/model_pruner.h"
 #include "tensorflow/core/grappler/optimizers/pin_to_host_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/remapper.h"
@@ -52,7 +56,10 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/tpu.h"
 #include "tensorflow/core/grappler/verifiers/structure_verifier.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/dump_graph.h"
 #include "tensorflow/core/util/ptr_util.h"
 #include "tensorflow/core/util/xla_config_registry.h"
@@ -90,7 +97,66 @@ int NumIterations(const RewriterConfig& cfg) {
 bool IsRunOnceOptimizer(const string& name) {
   return name == "layout" || name == "memory_optimizer" ||
          name == "loop_optimizer" || name == "auto_mixed_precision" ||
-         name == "auto_mixed_precision_mkl";
+         name == "auto_mixed_precision_mkl" || name == "cpu_blocked_layout" ||
+         name == "int8_quantization";
+}
+
+// The result of optimizing one function of the library.
+struct FunctionOptimization {
+  GrapplerFunctionItem item;
+  GraphDef optimized_graph;
+  Status status;
+};
+
+thread::ThreadPool* FunctionOptimizationThreadPool() {
+  static thread::ThreadPool* pool = new thread::ThreadPool(
+      Env::Default(), "grappler_function_optimizer", port::MaxParallelism());
+  return pool;
+}
+
+// Calls `fn(i)` for each i in [0, n), on `pool` and on the calling thread, or
+// only on the calling thread if `pool` is null. The calling thread only waits
+// for the calls that already started on other threads, so it does not block
+// when the pool is busy, even when called from the pool itself.
+void RunInParallel(thread::ThreadPool* pool, int n,
+                   const std::function<void(int)>& fn) {
+  if (pool == nullptr || n <= 1) {
+    for (int i = 0; i < n; ++i) fn(i);
+    return;
+  }
+
+  struct State {
+    State(int n, const std::function<void(int)>& fn) : n(n), fn(fn) {}
+    const int n;
+    const std::function<void(int)>& fn;
+    mutex mu;
+    condition_variable done;
+    int next TF_GUARDED_BY(mu) = 0;
+    int num_running TF_GUARDED_BY(mu) = 0;
+  };
+  // Closures that start after this function returned find no work left, and
+  // only touch `state`.
+  auto state = std::make_shared<State>(n, fn);
+  const auto work = [state]() {
+    while (true) {
+      int i;
+      {
+        mutex_lock l(state->mu);
+        if (state->next == state->n) return;
+        i = state->next++;
+        ++state->num_running;
+      }
+      state->fn(i);
+      mutex_lock l(state->mu);
+      if (--state->num_running == 0) state->done.notify_all();
+    }
+  };
+  for (int i = 1; i < std::min(n, pool->NumThreads() + 1); ++i) {
+    pool->Schedule(work);
+  }
+  work();
+  mutex_lock l(state->mu);
+  while (state->num_running > 0) state->done.wait(l);
 }
 
 // Creates a function library stub from a real function library: copy only
@@ -187,6 +253,8 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
              cfg_.experimental_disable_compressed_tensor_optimization()));
   MK_OPT("shape", new ShapeOptimizer());
   MK_OPT("remap", new Remapper(cfg_.remapping()));
+  MK_OPT("int8_quantization", new Int8QuantizationOptimizer(cpu_device_));
+  MK_OPT("cpu_blocked_layout", new CpuBlockedLayoutOptimizer());
   MK_OPT("layout", new GenericLayoutOptimizer(
                        /*optimization level*/ cfg_.layout_optimizer(),
                        /*CPU layout conversion*/ cfg_.cpu_layout_conversion()));
@@ -216,7 +284,8 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
 MetaOptimizer::MetaOptimizer(DeviceBase* cpu_device, const ConfigProto& cfg)
     : cpu_device_(cpu_device),
       config_proto_(cfg),
-      cfg_(*config_proto_.mutable_graph_options()->mutable_rewrite_options()) {
+      cfg_(*config_proto_.mutable_graph_options()->mutable_rewrite_options()),
+      cache_(MetaOptimizerCache::Global()) {
   DCHECK(cpu_device_ == nullptr ||
          cpu_device_->attributes().device_type() == "CPU");
 }
@@ -276,6 +345,12 @@ Status MetaOptimizer::InitializeOptimizers(
   if (cfg_.remapping() != RewriterConfig::OFF) {
     optimizers->push_back(MakeUnique<Remapper>(cfg_.remapping()));
   }
+  if (cfg_.int8_quantization() == RewriterConfig::ON) {
+    optimizers->push_back(MakeUnique<Int8QuantizationOptimizer>(cpu_device_));
+  }
+  if (cfg_.cpu_blocked_layout() == RewriterConfig::ON) {
+    optimizers->push_back(MakeUnique<CpuBlockedLayoutOptimizer>());
+  }
   if (cfg_.loop_optimization() != RewriterConfig::OFF) {
     optimizers->push_back(
         MakeUnique<LoopOptimizer>(cfg_.loop_optimization(), cpu_device_));
@@ -457,6 +532,13 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
     CompressConstants(optimized_graph);
   }
 
+  // Let the optimizers only infer again the shapes of the nodes that changed
+  // since the previous optimizer inferred them.
+  GraphPropertiesCache graph_properties_cache;
+  GraphPropertiesCache::Scope graph_properties_scope(
+      cfg_.experimental_incremental_shape_inference() ? &graph_properties_cache
+                                                      : nullptr);
+
   for (int iteration = 0; iteration < NumIterations(cfg_); ++iteration) {
     // Don't bother optimizing further if the graph is already tiny.
     if (optimized_graph->node_size() < min_graph_nodes) {
@@ -529,7 +611,10 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
                                    }) != optimization_result.results.end();
 
   // Record graph optimization result.
-  optimization_results_.push_back(optimization_result);
+  {
+    mutex_lock l(optimization_results_mu_);
+    optimization_results_.push_back(optimization_result);
+  }
 
   if (is_optimized) {
     TF_RETURN_IF_ERROR(TopologicalSort(optimized_graph));
@@ -673,7 +758,10 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   const uint64 start_us = Env::Default()->NowMicros();
 
   VLOG(1) << "Starting optimization for grappler item: " << item.id;
-  optimization_results_.clear();
+  {
+    mutex_lock l(optimization_results_mu_);
+    optimization_results_.clear();
+  }
 
   // Constructs a FunctionLibraryDefinition with functions that are reachable
   // from the nodes of the graph.
@@ -697,6 +785,17 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
       "Deleted $0 unreachable functions from the graph (library size = $1)",
       old_library_size - new_library_size, new_library_size);
 
+  // Skip the optimization if the same item was optimized before.
+  string cache_key;
+  if (cache_ != nullptr) {
+    cache_key = MetaOptimizerCache::Key(item, config_proto_, cluster);
+    if (cache_->Lookup(cache_key, optimized_graph)) {
+      VLOG(1) << "Found optimized graph for grappler item " << item.id
+              << " in the cache: " << cache_key;
+      return Status::OK();
+    }
+  }
+
   // Save a few small fields from item before we move it.
   bool optimize_function_library =
       item.optimization_options().optimize_function_library;
@@ -778,15 +877,21 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   // Propagate `_tf_data_function` attributes from functions to their callees.
   PropagateTFDataAttrs(flib, *optimized_graph->mutable_library());
 
+  // Functions are optimized on the calling thread only if the session is
+  // limited to a single thread.
+  thread::ThreadPool* function_optimization_pool =
+      config_proto_.inter_op_parallelism_threads() == 1
+          ? nullptr
+          : FunctionOptimizationThreadPool();
+
   // Optimize each function only once.
   absl::flat_hash_set<string> optimized_funcs;
   while (optimize_function_library) {
     optimize_function_library = false;
 
-    int function_idx = 0;
+    // Collect the functions to optimize in this pass.
+    std::vector<const FunctionDef*> funcs;
     for (const FunctionDef& func : optimized_graph->library().function()) {
-      GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
-
       const string& func_name = func.signature().name();
 
       // Skip functions that are not reachable from the optimized graph.
@@ -806,17 +911,28 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
       // and in function instantiation.
       if (data::IsTFDataFunction(func)) continue;
 
-      VLOG(3) << "Optimize function: function=" << func_name << " ["
-              << function_idx++ << " of "
-              << optimized_graph->library().function_size() << "]";
-
       // Function optimization might specialize nested function calls, so we
       // have to reset the flag and do at least one more pass over the library.
       optimize_function_library = true;
       optimized_funcs.insert(func_name);
+      funcs.push_back(&func);
+    }
+
+    // With a pool, the functions are optimized independently of each other,
+    // against the library as it was at the start of the pass, so that they can
+    // run in parallel and the result does not depend on the order they finish
+    // in. Without one, each function is optimized against the library updated
+    // with the functions optimized before it.
+    std::vector<FunctionOptimization> optimizations(funcs.size());
+    const auto optimize_function = [&](int i) -> Status {
+      GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+      const FunctionDef& func = *funcs[i];
+      const string& func_name = func.signature().name();
+      VLOG(3) << "Optimize function: function=" << func_name << " [" << i
+              << " of " << funcs.size() << "]";
 
       // Make a GrapplerItem from a FunctionDef.
-      GrapplerFunctionItem func_item;
+      GrapplerFunctionItem& func_item = optimizations[i].item;
       TF_RETURN_IF_ERROR(
           MakeGrapplerFunctionItem(func, flib, producer, &func_item));
 
@@ -841,7 +957,7 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
           false;
 
       // Optimize function body graph.
-      GraphDef optimized_func_graph;
+      GraphDef& optimized_func_graph = optimizations[i].optimized_graph;
       if (IsTPUGraphDef(*optimized_graph)) {
         // Skip optimizing functions if this is a TPU graph. Currently, Grappler
         // passes do not handle TPU functions correctly in a variety of ways
@@ -863,18 +979,22 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
         *func_item.graph.mutable_library() =
             GetFunctionDefLibraryStub(func_item_function_library);
 
-        TF_RETURN_IF_ERROR(implementation_selector.Optimize(
-            cluster, func_item, &optimized_func_graph));
-      } else {
-        GrapplerFunctionItem func_item_copy = func_item;
-        TF_RETURN_IF_ERROR(OptimizeGraph(cluster, std::move(func_item_copy),
-                                         &optimized_func_graph));
+        return implementation_selector.Optimize(cluster, func_item,
+                                                &optimized_func_graph);
       }
+      GrapplerFunctionItem func_item_copy = func_item;
+      return OptimizeGraph(cluster, std::move(func_item_copy),
+                           &optimized_func_graph);
+    };
+    // Merges the optimized function `i` into the library.
+    const auto merge_function = [&](int i) -> Status {
+      FunctionOptimization& optimization = optimizations[i];
+      TF_RETURN_IF_ERROR(optimization.status);
 
       // Function body optimization might have created new specialized
       // functions for each instantiation context. Add them to the library.
       for (const FunctionDef& func_def :
-           optimized_func_graph.library().function()) {
+           optimization.optimized_graph.library().function()) {
         if (flib.Find(func_def.signature().name()) == nullptr) {
           TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
         }
@@ -882,11 +1002,29 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
 
       // Convert optimized graph back to FunctionDef.
       FunctionDef optimized_func;
-      func_item.SwapFunctionBody(std::move(optimized_func_graph));
-      TF_RETURN_IF_ERROR(MakeFunctionDef(func_item, flib, &optimized_func));
+      optimization.item.SwapFunctionBody(
+          std::move(optimization.optimized_graph));
+      TF_RETURN_IF_ERROR(
+          MakeFunctionDef(optimization.item, flib, &optimized_func));
 
       // Replace optimized function with a new FunctionDef.
-      TF_RETURN_IF_ERROR(flib.ReplaceFunction(func_name, optimized_func));
+      return flib.ReplaceFunction(funcs[i]->signature().name(),
+                                  optimized_func);
+    };
+    const int num_funcs = funcs.size();
+    if (function_optimization_pool == nullptr) {
+      for (int i = 0; i < num_funcs; ++i) {
+        optimizations[i].status = optimize_function(i);
+        TF_RETURN_IF_ERROR(merge_function(i));
+      }
+    } else {
+      RunInParallel(function_optimization_pool, num_funcs, [&](int i) {
+        optimizations[i].status = optimize_function(i);
+      });
+      // Merge the optimized functions into the library in library order.
+      for (int i = 0; i < num_funcs; ++i) {
+        TF_RETURN_IF_ERROR(merge_function(i));
+      }
     }
 
     // If optimized at least one function, update the graph library.
@@ -907,12 +1045,16 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
 
   const uint64 end_us = Env::Default()->NowMicros();
   metrics::UpdateGrapplerPassTime("*", end_us - start_us);
+  if (cache_ != nullptr) {
+    cache_->Insert(cache_key, *optimized_graph, end_us - start_us);
+  }
 
   return Status::OK();
 }
 
 string MetaOptimizer::GetResultString() const {
   std::string result_string;
+  mutex_lock l(optimization_results_mu_);
   for (const GraphOptimizationResult& graph_result : optimization_results_) {
     absl::StrAppend(&result_string,
                     "Optimization results for grappler item: ", graph_result.id,
@@ -947,6 +1089,8 @@ bool MetaOptimizerEnabled(const ConfigProto& cfg) {
          rewrite_cfg.debug_stripper() == RewriterConfig::ON ||
          rewrite_cfg.scoped_allocator_optimization() == RewriterConfig::ON ||
          rewrite_cfg.pin_to_host_optimization() == RewriterConfig::ON ||
+         rewrite_cfg.cpu_blocked_layout() == RewriterConfig::ON ||
+         rewrite_cfg.int8_quantization() == RewriterConfig::ON ||
          AutoMixedPrecisionEnabled(rewrite_cfg.auto_mixed_precision()) ||
          AutoMixedPrecisionEnabled(rewrite_cfg.auto_mixed_precision_mkl()) ||
          !rewrite_cfg.optimizers().empty() ||
@@ -0,0 +1,250 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/meta_optimizer_cache.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/coding.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/raw_coding.h"
+#include "tensorflow/core/public/version.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Files in the cache directory hold the optimization time as a fixed64,
+// followed by the serialized GraphDef.
+constexpr char kFileSuffix[] = ".graph";
+
+string FingerprintString(StringPiece s) {
+  const Fprint128 fingerprint = Fingerprint128(s);
+  return strings::Printf("%016llx%016llx",
+                         static_cast<unsigned long long>(fingerprint.high64),
+                         static_cast<unsigned long long>(fingerprint.low64));
+}
+
+}  // namespace
+
+MetaOptimizerCache* MetaOptimizerCache::Global() {
+  static MetaOptimizerCache* cache = []() -> MetaOptimizerCache* {
+    int64 capacity_mb = 0;
+    string dir;
+    Status s =
+        ReadInt64FromEnvVar("TF_GRAPPLER_CACHE_SIZE_MB", 0, &capacity_mb);
+    if (s.ok()) s = ReadStringFromEnvVar("TF_GRAPPLER_CACHE_DIR", "", &dir);
+    if (!s.ok()) {
+      LOG(WARNING) << "Disabling the Grappler optimization cache: " << s;
+      return nullptr;
+    }
+    if (capacity_mb <= 0) return nullptr;
+    return new MetaOptimizerCache(capacity_mb << 20, dir);
+  }();
+  return cache;
+}
+
+MetaOptimizerCache::MetaOptimizerCache(int64 capacity_bytes,
+                                       const string& dir)
+    : capacity_bytes_(capacity_bytes), dir_(dir) {
+  if (!dir_.empty()) {
+    Status s = Env::Default()->RecursivelyCreateDir(dir_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to create the Grappler cache directory " << dir_
+                   << ": " << s;
+    }
+  }
+}
+
+string MetaOptimizerCache::Key(const GrapplerItem& item,
+                               const ConfigProto& config,
+                               const Cluster* cluster) {
+  string graph;
+  SerializeToStringDeterministic(item.graph, &graph);
+
+  // The session metadata only identifies the model, and does not affect the
+  // optimization.
+  ConfigProto config_copy = config;
+  config_copy.mutable_experimental()->clear_session_metadata();
+  string config_string;
+  SerializeToStringDeterministic(config_copy, &config_string);
+
+  string key =
+      absl::StrCat(TF_VERSION_STRING, ";", TF_GRAPH_DEF_VERSION, ";", item.id,
+                   ";", FingerprintString(graph), ";", config_string, ";");
+  for (const auto& feed : item.feed) {
+    absl::StrAppend(&key, feed.first, ":", DataTypeString(feed.second.dtype()),
+                    feed.second.shape().DebugString(), ",");
+  }
+  absl::StrAppend(&key, ";", absl::StrJoin(item.fetch, ","), ";",
+                  absl::StrJoin(item.init_ops, ","), ";",
+                  absl::StrJoin(item.keep_ops, ","), ";", item.save_op, ";",
+                  item.restore_op, ";", item.save_restore_loc_tensor, ";");
+  for (const QueueRunnerDef& queue_runner : item.queue_runners) {
+    string queue_runner_string;
+    SerializeToStringDeterministic(queue_runner, &queue_runner_string);
+    absl::StrAppend(&key, FingerprintString(queue_runner_string), ",");
+  }
+
+  std::vector<string> devices(item.devices().begin(), item.devices().end());
+  std::sort(devices.begin(), devices.end());
+  absl::StrAppend(&key, ";", absl::StrJoin(devices, ","), ";");
+  if (cluster != nullptr) {
+    // Some optimizers depend on the hardware, e.g. auto_mixed_precision on the
+    // GPU architecture, so the key covers the properties of the devices.
+    const std::map<string, DeviceProperties> cluster_devices(
+        cluster->GetDevices().begin(), cluster->GetDevices().end());
+    absl::StrAppend(&key, cluster->type(), ":");
+    for (const auto& device : cluster_devices) {
+      string properties_string;
+      SerializeToStringDeterministic(device.second, &properties_string);
+      absl::StrAppend(&key, device.first, "=",
+                      FingerprintString(properties_string), ",");
+    }
+  }
+
+  const GrapplerItem::OptimizationOptions& options =
+      item.optimization_options();
+  absl::StrAppend(&key, ";", options.allow_non_differentiable_rewrites,
+                  options.allow_pruning_stateful_and_dataset_ops,
+                  options.optimize_function_library, options.is_eager_mode);
+  return FingerprintString(key);
+}
+
+bool MetaOptimizerCache::Lookup(const string& key, GraphDef* optimized_graph) {
+  std::shared_ptr<const GraphDef> graph;
+  uint64 optimization_usecs = 0;
+  {
+    mutex_lock l(mu_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      graph = it->second->graph;
+      optimization_usecs = it->second->optimization_usecs;
+    }
+  }
+  if (graph != nullptr) {
+    *optimized_graph = *graph;
+  } else if (dir_.empty() ||
+             !ReadFromDir(key, optimized_graph, &optimization_usecs)) {
+    metrics::RecordGrapplerCacheMiss();
+    return false;
+  } else {
+    InsertInMemory(key, std::make_shared<const GraphDef>(*optimized_graph),
+                   optimization_usecs);
+  }
+  metrics::RecordGrapplerCacheHit(optimization_usecs);
+  return true;
+}
+
+void MetaOptimizerCache::Insert(const string& key,
+                                const GraphDef& optimized_graph,
+                                uint64 optimization_usecs) {
+  InsertInMemory(key, std::make_shared<const GraphDef>(optimized_graph),
+                 optimization_usecs);
+  if (!dir_.empty()) WriteToDir(key, optimized_graph, optimization_usecs);
+}
+
+void MetaOptimizerCache::InsertInMemory(const string& key,
+                                        std::shared_ptr<const GraphDef> graph,
+                                        uint64 optimization_usecs) {
+  const int64 bytes = graph->ByteSizeLong();
+  if (bytes > capacity_bytes_) return;
+
+  mutex_lock l(mu_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    size_bytes_ -= it->second->bytes;
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+  while (size_bytes_ + bytes > capacity_bytes_) {
+    const Entry& last = entries_.back();
+    VLOG(2) << "Evicting graph " << last.key << " from the Grappler cache";
+    size_bytes_ -= last.bytes;
+    index_.erase(last.key);
+    entries_.pop_back();
+  }
+  entries_.push_front({key, std::move(graph), optimization_usecs, bytes});
+  index_[key] = entries_.begin();
+  size_bytes_ += bytes;
+}
+
+bool MetaOptimizerCache::ReadFromDir(const string& key, GraphDef* graph,
+                                     uint64* optimization_usecs) const {
+  const string path = io::JoinPath(dir_, absl::StrCat(key, kFileSuffix));
+  Env* env = Env::Default();
+  if (!env->FileExists(path).ok()) return false;
+  string contents;
+  Status s = ReadFileToString(env, path, &contents);
+  if (!s.ok() || contents.size() < sizeof(uint64) ||
+      !graph->ParseFromArray(contents.data() + sizeof(uint64),
+                             contents.size() - sizeof(uint64))) {
+    LOG(WARNING) << "Ignoring invalid Grappler cache file " << path << ": "
+                 << s;
+    return false;
+  }
+  *optimization_usecs = core::DecodeFixed64(contents.data());
+  return true;
+}
+
+void MetaOptimizerCache::WriteToDir(const string& key, const GraphDef& graph,
+                                    uint64 optimization_usecs) const {
+  const string path = io::JoinPath(dir_, absl::StrCat(key, kFileSuffix));
+  Env* env = Env::Default();
+  if (env->FileExists(path).ok()) return;
+
+  string contents;
+  core::PutFixed64(&contents, optimization_usecs);
+  if (!graph.AppendToString(&contents)) {
+    LOG(WARNING) << "Failed to serialize the graph cached for " << key;
+    return;
+  }
+  // Write to a temporary file first, so that concurrent readers, possibly in
+  // other processes, never see a partial file.
+  string tmp_path = path;
+  if (!env->CreateUniqueFileName(&tmp_path, ".tmp")) return;
+  Status s = WriteStringToFile(env, tmp_path, contents);
+  if (s.ok()) s = env->RenameFile(tmp_path, path);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to write Grappler cache file " << path << ": "
+                 << s;
+    env->DeleteFile(tmp_path).IgnoreError();
+  }
+}
+
+int64 MetaOptimizerCache::num_entries() const {
+  mutex_lock l(mu_);
+  return entries_.size();
+}
+
+int64 MetaOptimizerCache::size_bytes() const {
+  mutex_lock l(mu_);
+  return size_bytes_;
+}
+
+}  // namespace grappler
+}  // namespace tensorflow
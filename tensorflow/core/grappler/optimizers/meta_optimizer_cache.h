@@ -0,0 +1,106 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_CACHE_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// A cache of the graphs produced by the MetaOptimizer, keyed by a fingerprint
+// of everything the optimization depends on. Model servers loading several
+// versions or replicas of a model, and functions that are instantiated
+// again, can then skip the optimization of graphs that were seen before.
+//
+// The cached graphs are evicted in least recently used order once their total
+// size exceeds the capacity. If a directory is given, the graphs are also
+// written to it, and graphs missing from memory are looked up there, so that
+// they survive the process.
+//
+// This class is thread-safe.
+class MetaOptimizerCache {
+ public:
+  // Returns the process-wide cache, or nullptr if caching is disabled. The
+  // capacity in megabytes is read from the TF_GRAPPLER_CACHE_SIZE_MB
+  // environment variable, and caching is disabled if it is 0 (the default).
+  // The directory is read from TF_GRAPPLER_CACHE_DIR.
+  static MetaOptimizerCache* Global();
+
+  MetaOptimizerCache(int64 capacity_bytes, const string& dir);
+
+  // Returns the key of the graph the MetaOptimizer configured with `config`
+  // produces for `item` on `cluster`, which may be null.
+  static string Key(const GrapplerItem& item, const ConfigProto& config,
+                    const Cluster* cluster);
+
+  // Copies the graph cached for `key` to `optimized_graph` and returns true,
+  // or returns false if there is none.
+  bool Lookup(const string& key, GraphDef* optimized_graph);
+
+  // Caches `optimized_graph` for `key`. It took `optimization_usecs` to
+  // produce, which is reported as saved by later hits.
+  void Insert(const string& key, const GraphDef& optimized_graph,
+              uint64 optimization_usecs);
+
+  // The number of graphs and bytes cached in memory.
+  int64 num_entries() const;
+  int64 size_bytes() const;
+
+ private:
+  struct Entry {
+    string key;
+    std::shared_ptr<const GraphDef> graph;
+    uint64 optimization_usecs;
+    int64 bytes;
+  };
+
+  void InsertInMemory(const string& key,
+                      std::shared_ptr<const GraphDef> graph,
+                      uint64 optimization_usecs);
+  bool ReadFromDir(const string& key, GraphDef* graph,
+                   uint64* optimization_usecs) const;
+  void WriteToDir(const string& key, const GraphDef& graph,
+                  uint64 optimization_usecs) const;
+
+  const int64 capacity_bytes_;
+  const string dir_;
+
+  mutable mutex mu_;
+  // Most recently used first.
+  std::list<Entry> entries_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<string, std::list<Entry>::iterator> index_
+      TF_GUARDED_BY(mu_);
+  int64 size_bytes_ TF_GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MetaOptimizerCache);
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_CACHE_H_
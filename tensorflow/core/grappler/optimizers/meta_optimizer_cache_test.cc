@@ -0,0 +1,148 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/meta_optimizer_cache.h"
+
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+GraphDef MakeGraph(const string& name) {
+  GraphDef graph;
+  NodeDef* node = graph.add_node();
+  node->set_name(name);
+  node->set_op("NoOp");
+  return graph;
+}
+
+GrapplerItem MakeItem() {
+  GrapplerItem item;
+  item.id = "tf_graph";
+  item.graph = MakeGraph("a");
+  item.fetch.push_back("a");
+  return item;
+}
+
+TEST(MetaOptimizerCacheTest, KeyDependsOnItemAndConfig) {
+  const GrapplerItem item = MakeItem();
+  const ConfigProto config;
+  const string key = MetaOptimizerCache::Key(item, config, nullptr);
+  EXPECT_EQ(key, MetaOptimizerCache::Key(MakeItem(), config, nullptr));
+
+  GrapplerItem other = MakeItem();
+  other.graph = MakeGraph("b");
+  EXPECT_NE(key, MetaOptimizerCache::Key(other, config, nullptr));
+
+  other = MakeItem();
+  other.fetch.clear();
+  EXPECT_NE(key, MetaOptimizerCache::Key(other, config, nullptr));
+
+  other = MakeItem();
+  TF_ASSERT_OK(other.AddDevice("/job:localhost/replica:0/task:0/device:CPU:0"));
+  EXPECT_NE(key, MetaOptimizerCache::Key(other, config, nullptr));
+
+  other = MakeItem();
+  other.optimization_options().allow_pruning_stateful_and_dataset_ops = false;
+  EXPECT_NE(key, MetaOptimizerCache::Key(other, config, nullptr));
+
+  ConfigProto other_config;
+  other_config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->set_constant_folding(RewriterConfig::OFF);
+  EXPECT_NE(key, MetaOptimizerCache::Key(item, other_config, nullptr));
+
+  // The session metadata does not affect the optimized graph.
+  other_config = config;
+  other_config.mutable_experimental()->mutable_session_metadata()->set_name(
+      "model");
+  EXPECT_EQ(key, MetaOptimizerCache::Key(item, other_config, nullptr));
+}
+
+TEST(MetaOptimizerCacheTest, KeyDependsOnDeviceProperties) {
+  const GrapplerItem item = MakeItem();
+  const ConfigProto config;
+  const string kGpu = "/job:localhost/replica:0/task:0/device:GPU:0";
+  DeviceProperties gpu;
+  gpu.set_type("GPU");
+  gpu.set_vendor("NVIDIA");
+  gpu.set_model("Tesla V100");
+  (*gpu.mutable_environment())["architecture"] = "7.0";
+  VirtualCluster volta({{kGpu, gpu}});
+  const string key = MetaOptimizerCache::Key(item, config, &volta);
+  VirtualCluster same_gpu({{kGpu, gpu}});
+  EXPECT_EQ(key, MetaOptimizerCache::Key(item, config, &same_gpu));
+
+  // The same device name on different hardware gives a different key.
+  gpu.set_model("Tesla P100");
+  (*gpu.mutable_environment())["architecture"] = "6.0";
+  VirtualCluster pascal({{kGpu, gpu}});
+  EXPECT_NE(key, MetaOptimizerCache::Key(item, config, &pascal));
+}
+
+TEST(MetaOptimizerCacheTest, LookupInsertedGraph) {
+  MetaOptimizerCache cache(/*capacity_bytes=*/1 << 20, /*dir=*/"");
+  GraphDef graph;
+  EXPECT_FALSE(cache.Lookup("key", &graph));
+
+  cache.Insert("key", MakeGraph("a"), /*optimization_usecs=*/10);
+  ASSERT_TRUE(cache.Lookup("key", &graph));
+  ASSERT_EQ(graph.node_size(), 1);
+  EXPECT_EQ(graph.node(0).name(), "a");
+  EXPECT_FALSE(cache.Lookup("other_key", &graph));
+}
+
+TEST(MetaOptimizerCacheTest, EvictsLeastRecentlyUsedGraphs) {
+  const int64 graph_bytes = MakeGraph("a").ByteSizeLong();
+  MetaOptimizerCache cache(/*capacity_bytes=*/2 * graph_bytes, /*dir=*/"");
+  cache.Insert("a", MakeGraph("a"), /*optimization_usecs=*/10);
+  cache.Insert("b", MakeGraph("b"), /*optimization_usecs=*/10);
+  GraphDef graph;
+  ASSERT_TRUE(cache.Lookup("a", &graph));
+
+  cache.Insert("c", MakeGraph("c"), /*optimization_usecs=*/10);
+  EXPECT_EQ(cache.num_entries(), 2);
+  EXPECT_EQ(cache.size_bytes(), 2 * graph_bytes);
+  EXPECT_TRUE(cache.Lookup("a", &graph));
+  EXPECT_FALSE(cache.Lookup("b", &graph));
+  EXPECT_TRUE(cache.Lookup("c", &graph));
+}
+
+TEST(MetaOptimizerCacheTest, PersistsGraphsInDir) {
+  const string dir = io::JoinPath(testing::TmpDir(), "meta_optimizer_cache");
+  {
+    MetaOptimizerCache cache(/*capacity_bytes=*/1 << 20, dir);
+    cache.Insert("key", MakeGraph("a"), /*optimization_usecs=*/10);
+  }
+
+  MetaOptimizerCache cache(/*capacity_bytes=*/1 << 20, dir);
+  EXPECT_EQ(cache.num_entries(), 0);
+  GraphDef graph;
+  ASSERT_TRUE(cache.Lookup("key", &graph));
+  ASSERT_EQ(graph.node_size(), 1);
+  EXPECT_EQ(graph.node(0).name(), "a");
+  EXPECT_EQ(cache.num_entries(), 1);
+  EXPECT_FALSE(cache.Lookup("other_key", &graph));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -18,6 +18,7 @@ limitations under the License.
 #include <atomic>
 
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -34,6 +35,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 
 namespace tensorflow {
@@ -177,6 +179,37 @@ TEST_F(MetaOptimizerTest, RunsCustomOptimizerWithParams) {
   EXPECT_TRUE(TestOptimizer::IsOptimized());
 }
 
+TEST_F(MetaOptimizerTest, SkipsOptimizationOfCachedGraphs) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+  GrapplerItem item;
+  ASSERT_TRUE(fake_input.NextItem(&item));
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.add_optimizers("TestOptimizer");
+  rewriter_config.set_min_graph_nodes(-1);
+
+  MetaOptimizerCache cache(/*capacity_bytes=*/1 << 20, /*dir=*/"");
+  GraphDef output;
+  {
+    TestOptimizer::SetOptimized(false);
+    MetaOptimizer optimizer(nullptr, config_proto);
+    optimizer.set_cache(&cache);
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+    EXPECT_TRUE(TestOptimizer::IsOptimized());
+    EXPECT_EQ(cache.num_entries(), 1);
+  }
+
+  TestOptimizer::SetOptimized(false);
+  MetaOptimizer optimizer(nullptr, config_proto);
+  optimizer.set_cache(&cache);
+  GraphDef cached_output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &cached_output));
+  EXPECT_FALSE(TestOptimizer::IsOptimized());
+  CompareGraphs(output, cached_output);
+}
+
 TEST_F(MetaOptimizerTest, RunsCustomOptimizerAndCustomGraphOptimizer) {
   TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
   GrapplerItem item;
@@ -1253,6 +1286,113 @@ INSTANTIATE_TEST_SUITE_P(
       return test_name;
     });
 
+TEST_F(MetaOptimizerTest, IncrementalShapeInferenceGivesSameGraph) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+  GrapplerItem item;
+  ASSERT_TRUE(fake_input.NextItem(&item));
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.set_min_graph_nodes(-1);
+  rewriter_config.set_meta_optimizer_iterations(RewriterConfig::TWO);
+  MetaOptimizer optimizer(nullptr, config_proto);
+  optimizer.set_cache(nullptr);
+  GraphDef expected;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &expected));
+
+  rewriter_config.set_experimental_incremental_shape_inference(true);
+  MetaOptimizer incremental_optimizer(nullptr, config_proto);
+  incremental_optimizer.set_cache(nullptr);
+  GraphDef output;
+  TF_ASSERT_OK(incremental_optimizer.Optimize(nullptr, item, &output));
+  CompareGraphs(expected, output);
+}
+
+// Returns a graph calling `num_functions` non-inlined functions, each with a
+// chain of `num_nodes` nodes that the optimizers can simplify.
+GrapplerItem MakeFunctionHeavyItem(int num_functions, int num_nodes) {
+  using test::function::NDef;
+
+  std::vector<FunctionDef> funcs;
+  std::vector<NodeDef> nodes = {
+      NDef("x", "Placeholder", {}, {{"dtype", DT_FLOAT}}, kDevice)};
+  GrapplerItem item;
+  item.id = "tf_graph";
+  for (int i = 0; i < num_functions; ++i) {
+    std::vector<FunctionDefHelper::Node> func_nodes;
+    string output = "x";
+    for (int j = 0; j < num_nodes; ++j) {
+      const string add = absl::StrCat("add_", j);
+      const string neg = absl::StrCat("neg_", j);
+      func_nodes.push_back({{add}, "Add", {output, "x"}, {{"T", DT_FLOAT}}});
+      func_nodes.push_back(
+          {{neg}, "Neg", {absl::StrCat(add, ":z:0")}, {{"T", DT_FLOAT}}});
+      output = absl::StrCat(neg, ":y:0");
+    }
+    const string func_name = absl::StrCat("Func", i);
+    FunctionDef func = FunctionDefHelper::Create(
+        func_name, {"x:float"}, {"z:float"}, {}, func_nodes,
+        /*ret_def=*/{{"z", output}});
+    (*func.mutable_attr())["_noinline"].set_b(true);
+    funcs.push_back(func);
+
+    const string call = absl::StrCat("call_", i);
+    nodes.push_back(NDef(call, func_name, {"x"}, {}, kDevice));
+    item.fetch.push_back(call);
+  }
+  item.graph = test::function::GDef(nodes, funcs);
+  return item;
+}
+
+TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryInParallel) {
+  const GrapplerItem item =
+      MakeFunctionHeavyItem(/*num_functions=*/32, /*num_nodes=*/4);
+
+  ConfigProto config_proto;
+  config_proto.set_inter_op_parallelism_threads(1);
+  MetaOptimizer serial_optimizer(nullptr, config_proto);
+  serial_optimizer.set_cache(nullptr);
+  GraphDef serial_output;
+  TF_ASSERT_OK(serial_optimizer.Optimize(nullptr, item, &serial_output));
+
+  // Optimizing the functions in parallel gives the same graph.
+  config_proto.set_inter_op_parallelism_threads(0);
+  for (int i = 0; i < 3; ++i) {
+    MetaOptimizer optimizer(nullptr, config_proto);
+    optimizer.set_cache(nullptr);
+    GraphDef output;
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+    CompareGraphs(serial_output, output);
+    CompareFunctions(serial_output.library().function(),
+                     output.library().function());
+  }
+}
+
+static void BM_OptimizeFunctionLibrary(::testing::benchmark::State& state) {
+  const int num_functions = state.range(0);
+  const bool parallel = state.range(1);
+  const GrapplerItem item = MakeFunctionHeavyItem(num_functions,
+                                                  /*num_nodes=*/16);
+  ConfigProto config_proto;
+  config_proto.set_inter_op_parallelism_threads(parallel ? 0 : 1);
+
+  for (auto s : state) {
+    MetaOptimizer optimizer(nullptr, config_proto);
+    optimizer.set_cache(nullptr);
+    GraphDef output;
+    TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+  }
+  state.SetItemsProcessed(state.iterations() * num_functions);
+}
+
+BENCHMARK(BM_OptimizeFunctionLibrary)
+    ->UseRealTime()
+    ->ArgPair(16, false)
+    ->ArgPair(16, true)
+    ->ArgPair(256, false)
+    ->ArgPair(256, true);
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
@@ -59,6 +60,13 @@ namespace grappler {
 //   (1) FusedBatchNorm + <Activation>
 //   (2) FusedBatchNorm + SideInput + <Activation>
 //
+// SparseSegment{Sum,Mean,SqrtN} + ... -> FusedEmbeddingLookupSparse (on CPU):
+//   (1) Unique + ResourceGather + <Identity> + SparseSegment{Sum,Mean,SqrtN}
+//
+// Element-wise ops -> _FusedElementwise (on CPU, AGGRESSIVE only):
+//   (1) Tree of connected unary and binary element-wise ops, whose inputs are
+//       broadcast from scalars or trailing dimensions of the output.
+//
 // In all cases, the supported activation functions are Relu, Relu6, and Elu.
 //
 // Both Conv2D and MatMul implemented as Tensor contraction (on CPU), so all the
@@ -69,6 +77,8 @@ constexpr char kFusedConv2D[] = "_FusedConv2D";
 constexpr char kFusedMatMul[] = "_FusedMatMul";
 constexpr char kFusedDepthwiseConv2dNative[] = "_FusedDepthwiseConv2dNative";
 constexpr char kFusedBatchNormEx[] = "_FusedBatchNormEx";
+constexpr char kFusedEmbeddingLookupSparse[] = "FusedEmbeddingLookupSparse";
+constexpr char kFusedElementwise[] = "_FusedElementwise";
 
 constexpr char kDataFormat[] = "data_format";
 constexpr char kIsTraining[] = "is_training";
@@ -108,6 +118,27 @@ struct FusedBatchNormEx {
   int invalidated = kMissingIndex;
 };
 
+// Unweighted embedding_lookup_sparse of a single resource variable: rows
+// gathered at the unique ids, reduced by a sparse segment reduction.
+struct EmbeddingLookupSparse {
+  EmbeddingLookupSparse() = default;
+
+  int unique = kMissingIndex;
+  int gather = kMissingIndex;
+  int identity = kMissingIndex;  // optional
+  int segment_reduction = kMissingIndex;
+};
+
+// Connected element-wise ops evaluated by a single _FusedElementwise.
+struct FusedElementwise {
+  FusedElementwise() = default;
+
+  int root = kMissingIndex;
+  std::vector<int> ops;        // fused nodes in evaluation order, root last
+  std::vector<string> inputs;  // distinct tensors read by the fused nodes
+  std::vector<int> operands;   // "operands" attribute of _FusedElementwise
+};
+
 // Contraction node followed by a BiasAdd.
 struct ContractionWithBiasAdd {
   ContractionWithBiasAdd() = default;
@@ -960,6 +991,234 @@ bool FindFusedBatchNormEx(const RemapperContext& ctx, int node_index,
   return false;
 }
 
+bool IsSparseSegmentReduction(const NodeDef& node) {
+  return node.op() == "SparseSegmentSum" || node.op() == "SparseSegmentMean" ||
+         node.op() == "SparseSegmentSqrtN";
+}
+
+bool FindEmbeddingLookupSparse(const RemapperContext& ctx, int node_index,
+                               EmbeddingLookupSparse* matched) {
+  const auto* node_view = ctx.graph_view.GetNode(node_index);
+  // Root of the pattern must be a sparse segment reduction on CPU.
+  if (HasControlFaninOrFanout(*node_view)) return false;
+
+  const auto* node_def = node_view->node();
+  if (!IsSparseSegmentReduction(*node_def) || !NodeIsOnCpu(node_def))
+    return false;
+  const DataType dtype = GetDataTypeFromAttr(*node_def, "T");
+  if (dtype != DT_FLOAT && dtype != DT_DOUBLE) return false;
+  if (node_view->NumRegularFanins() != 3) return false;
+
+  // Nodes between the variable and the reduction are removed by the fusion,
+  // so the reduction must be their only consumer.
+  const auto is_removable = [&](const utils::MutableNodeView& view) {
+    return !HasControlFaninOrFanout(view) && view.NumRegularFanouts() == 1 &&
+           !IsInPreserveSet(ctx, view.node());
+  };
+
+  // Data input is a ResourceGather, optionally read through an Identity.
+  EmbeddingLookupSparse pattern;
+  pattern.segment_reduction = node_index;
+  const auto* data_view = node_view->GetRegularFanin(0).node_view();
+  if (IsIdentity(*data_view->node())) {
+    if (!is_removable(*data_view)) return false;
+    pattern.identity = data_view->node_index();
+    data_view = data_view->GetRegularFanin(0).node_view();
+  }
+  const auto* gather_def = data_view->node();
+  if (gather_def->op() != "ResourceGather" || !is_removable(*data_view) ||
+      gather_def->device() != node_def->device())
+    return false;
+  int batch_dims = 0;
+  if (TryGetNodeAttr(*gather_def, "batch_dims", &batch_dims) && batch_dims != 0)
+    return false;
+  if (GetDataTypeFromAttr(*gather_def, "dtype") != dtype) return false;
+  pattern.gather = data_view->node_index();
+
+  // Gather indices and segment indices are both outputs of the same Unique.
+  const auto& gather_indices = data_view->GetRegularFanin(1);
+  const auto& segment_indices = node_view->GetRegularFanin(1);
+  if (!IsUnique(*gather_indices.node_view()->node()) ||
+      gather_indices.node_index() != segment_indices.node_index() ||
+      gather_indices.index() != 0 || segment_indices.index() != 1)
+    return false;
+  pattern.unique = gather_indices.node_index();
+
+  // We successfully found an embedding lookup pattern.
+  *matched = pattern;
+
+  return true;
+}
+
+// Maximum number of ops fused into one _FusedElementwise. The kernel keeps a
+// tile buffer per input and op, which should stay in the cache.
+constexpr int kMaxFusedElementwiseOps = 32;
+
+// Returns the number of inputs of an element-wise op supported by the
+// _FusedElementwise kernel, or 0 if the op is not supported.
+int FusableElementwiseOpArity(const NodeDef& node) {
+  static const auto* arities = new absl::flat_hash_map<string, int>{
+      {"Abs", 1},
+      {"Ceil", 1},
+      {"Elu", 1},
+      {"Exp", 1},
+      {"Floor", 1},
+      {"Log", 1},
+      {"Neg", 1},
+      {"Reciprocal", 1},
+      {"Relu", 1},
+      {"Relu6", 1},
+      {"Rsqrt", 1},
+      {"Sigmoid", 1},
+      {"Sqrt", 1},
+      {"Square", 1},
+      {"Tanh", 1},
+      {"Add", 2},
+      {"AddV2", 2},
+      {"Div", 2},
+      {"Maximum", 2},
+      {"Minimum", 2},
+      {"Mul", 2},
+      {"RealDiv", 2},
+      {"SquaredDifference", 2},
+      {"Sub", 2},
+  };
+  const auto it = arities->find(node.op());
+  return it == arities->end() ? 0 : it->second;
+}
+
+bool IsFusableElementwiseOp(const utils::MutableNodeView& node_view) {
+  const auto* node_def = node_view.node();
+  const int arity = FusableElementwiseOpArity(*node_def);
+  if (arity == 0 || node_view.NumRegularFanins() != arity) return false;
+  if (!NodeIsOnCpu(node_def)) return false;
+  const DataType dtype = GetDataTypeFromAttr(*node_def, "T");
+  return dtype == DT_FLOAT || dtype == DT_DOUBLE;
+}
+
+// Returns true if the node is an activation that the patterns above fuse into
+// its BiasAdd or FusedBatchNorm input, which is preferred.
+bool IsActivationOfFusableNode(const utils::MutableNodeView& node_view) {
+  if (!IsSupportedActivation(*node_view.node())) return false;
+  const auto* input = node_view.GetRegularFanin(0).node_view()->node();
+  return IsBiasAdd(*input) || IsFusedBatchNorm(*input);
+}
+
+// Returns true if a tensor of shape 'input' can be an input of a
+// _FusedElementwise with output shape 'output': it has the same shape, a
+// single element, or the shape of trailing dimensions of the output.
+bool IsBroadcastableElementwiseInput(const TensorShapeProto& input,
+                                     const TensorShapeProto& output) {
+  if (ShapesSymbolicallyEqual(input, output)) return true;
+  if (input.unknown_rank() || output.unknown_rank()) return false;
+
+  int leading_ones = 0;
+  while (leading_ones < input.dim_size() &&
+         input.dim(leading_ones).size() == 1) {
+    ++leading_ones;
+  }
+  const int suffix_dims = input.dim_size() - leading_ones;
+  if (suffix_dims > output.dim_size()) return false;
+  for (int d = 1; d <= suffix_dims; ++d) {
+    const auto& input_dim = input.dim(input.dim_size() - d);
+    const auto& output_dim = output.dim(output.dim_size() - d);
+    if (!IsKnownSymbolically(input_dim) ||
+        input_dim.size() != output_dim.size())
+      return false;
+  }
+  return true;
+}
+
+bool FindFusedElementwise(const RemapperContext& ctx, int node_index,
+                          FusedElementwise* matched) {
+  const auto* node_view = ctx.graph_view.GetNode(node_index);
+  // Root of the pattern must be a supported element-wise op on CPU.
+  if (!IsFusableElementwiseOp(*node_view)) return false;
+  if (IsActivationOfFusableNode(*node_view)) return false;
+
+  const auto* node_def = node_view->node();
+  const auto& root_props =
+      ctx.graph_properties.GetOutputProperties(node_def->name());
+  if (root_props.empty()) return false;
+  const TensorShapeProto& shape = root_props[0].shape();
+  if (!ShapeIsSymbolicallyDefined(shape)) return false;
+  const DataType dtype = GetDataTypeFromAttr(*node_def, "T");
+
+  // Fused nodes are removed, so the pattern can only grow into nodes whose
+  // output is read once, by the pattern, and has the shape of the root.
+  const auto is_fusable_fanin = [&](const utils::MutableNodeView& view) {
+    const auto* fanin_def = view.node();
+    if (!IsFusableElementwiseOp(view) || IsActivationOfFusableNode(view) ||
+        HasControlFaninOrFanout(view) || view.NumRegularFanouts() != 1 ||
+        IsInPreserveSet(ctx, fanin_def) ||
+        fanin_def->device() != node_def->device() ||
+        GetDataTypeFromAttr(*fanin_def, "T") != dtype)
+      return false;
+    const auto& props =
+        ctx.graph_properties.GetOutputProperties(fanin_def->name());
+    return !props.empty() && ShapesSymbolicallyEqual(props[0].shape(), shape);
+  };
+
+  // An operand is an input of the pattern, or the result of one of its ops.
+  struct Operand {
+    bool is_op = false;
+    int index = kMissingIndex;
+  };
+  FusedElementwise pattern;
+  pattern.root = node_index;
+  absl::flat_hash_map<string, int> input_indices;
+  std::vector<Operand> operands;
+  int num_ops = 0;
+  bool is_valid = true;
+  bool has_full_input = false;
+  // Adds the ops of the tree rooted at 'view' in post-order.
+  std::function<Operand(const utils::MutableNodeView&)> add_op =
+      [&](const utils::MutableNodeView& view) -> Operand {
+    ++num_ops;
+    const auto* view_def = view.node();
+    const auto& input_props =
+        ctx.graph_properties.GetInputProperties(view_def->name());
+    Operand view_operands[2];
+    for (int i = 0; is_valid && i < view.NumRegularFanins(); ++i) {
+      const auto* fanin_view = view.GetRegularFanin(i).node_view();
+      if (num_ops < kMaxFusedElementwiseOps && is_fusable_fanin(*fanin_view)) {
+        view_operands[i] = add_op(*fanin_view);
+        continue;
+      }
+      if (input_props.size() <= i ||
+          !IsBroadcastableElementwiseInput(input_props[i].shape(), shape)) {
+        is_valid = false;
+        break;
+      }
+      has_full_input |= ShapesSymbolicallyEqual(input_props[i].shape(), shape);
+      const string& input = view_def->input(i);
+      const auto it = input_indices.emplace(input, pattern.inputs.size());
+      if (it.second) pattern.inputs.push_back(input);
+      view_operands[i].index = it.first->second;
+    }
+    operands.push_back(view_operands[0]);
+    operands.push_back(view_operands[1]);
+    pattern.ops.push_back(view.node_index());
+    return {/*is_op=*/true, static_cast<int>(pattern.ops.size()) - 1};
+  };
+  add_op(*node_view);
+
+  if (!is_valid || !has_full_input || pattern.ops.size() < 2) return false;
+
+  // Result of op j is operand N + j of the _FusedElementwise, and the second
+  // operand of unary ops is -1.
+  const int num_inputs = pattern.inputs.size();
+  for (const Operand& operand : operands) {
+    pattern.operands.push_back(operand.is_op ? num_inputs + operand.index
+                                             : operand.index);
+  }
+
+  // We successfully found a fusable group of element-wise ops.
+  *matched = std::move(pattern);
+
+  return true;
+}
+
 void CopyConv2DAttributes(const NodeDef& conv2d, NodeDef* fused_conv2d,
                           const NodeDef* activation = nullptr) {
   DCHECK(IsConv2D(conv2d)) << "Input node must be a Conv2D";
@@ -1620,6 +1879,117 @@ Status AddBatchNormNodes(RemapperContext* ctx, const FusedBatchNorm& matched) {
   return mutation->Apply();
 }
 
+Status AddFusedEmbeddingLookupSparseNode(
+    RemapperContext* ctx, const EmbeddingLookupSparse& matched,
+    std::vector<bool>* invalidated_nodes, std::vector<bool>* nodes_to_delete) {
+  const GraphDef* graph = ctx->graph_view.graph();
+  const NodeDef& segment_reduction = graph->node(matched.segment_reduction);
+  const NodeDef& gather = graph->node(matched.gather);
+  const NodeDef& unique = graph->node(matched.unique);
+
+  VLOG(2) << "Fuse " << segment_reduction.op() << " with ResourceGather:"
+          << " segment_reduction=" << segment_reduction.name()
+          << " gather=" << gather.name() << " unique=" << unique.name();
+
+  const DataType dtype = GetDataTypeFromAttr(gather, "dtype");
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+
+  // Empty weights select the unweighted reduction. The control dependency
+  // keeps the constant in the same frame as the ids.
+  NodeDef weights;
+  weights.set_name(
+      AddPrefixToNodeName("EmptyWeights", segment_reduction.name()));
+  weights.set_op("Const");
+  weights.set_device(segment_reduction.device());
+  *weights.add_input() = AsControlDependency(NodeName(unique.input(0)));
+  (*weights.mutable_attr())["dtype"].set_type(dtype);
+  Tensor empty(dtype, {0});
+  empty.AsProtoTensorContent(
+      (*weights.mutable_attr())["value"].mutable_tensor());
+
+  NodeDef fused_op;
+  fused_op.set_op(kFusedEmbeddingLookupSparse);
+  fused_op.set_name(segment_reduction.name());
+  fused_op.set_device(segment_reduction.device());
+
+  fused_op.add_input(gather.input(0));             // 0: resource
+  fused_op.add_input(unique.input(0));             // 1: ids
+  fused_op.add_input(weights.name());              // 2: weights
+  fused_op.add_input(segment_reduction.input(2));  // 3: segment_ids
+
+  string combiner = "sqrtn";
+  if (segment_reduction.op() == "SparseSegmentSum") {
+    combiner = "sum";
+  } else if (segment_reduction.op() == "SparseSegmentMean") {
+    combiner = "mean";
+  }
+  auto* attrs = fused_op.mutable_attr();
+  SetAttrValue(combiner, &(*attrs)["combiner"]);
+  (*attrs)["dtype"].set_type(dtype);
+  (*attrs)["Tindices"] = gather.attr().at("Tindices");
+  if (segment_reduction.attr().count("Tsegmentids") > 0) {
+    (*attrs)["Tsegmentids"] = segment_reduction.attr().at("Tsegmentids");
+  } else {
+    (*attrs)["Tsegmentids"].set_type(DT_INT32);
+  }
+
+  mutation->AddNode(std::move(weights), &status);
+  TF_RETURN_IF_ERROR(status);
+  mutation->AddNode(std::move(fused_op), &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(mutation->Apply());
+
+  (*invalidated_nodes)[matched.segment_reduction] = true;
+  (*nodes_to_delete)[matched.gather] = true;
+  if (matched.identity != kMissingIndex) {
+    (*nodes_to_delete)[matched.identity] = true;
+  }
+
+  return Status::OK();
+}
+
+Status AddFusedElementwiseNode(RemapperContext* ctx,
+                               const FusedElementwise& matched,
+                               std::vector<bool>* invalidated_nodes,
+                               std::vector<bool>* nodes_to_delete) {
+  const GraphDef* graph = ctx->graph_view.graph();
+  const NodeDef& root = graph->node(matched.root);
+
+  std::vector<string> ops;
+  for (int op : matched.ops) ops.push_back(graph->node(op).op());
+  VLOG(2) << "Fuse " << ops.size() << " element-wise ops:"
+          << " root=" << root.name() << " inputs=" << matched.inputs.size();
+
+  NodeDef fused_op;
+  fused_op.set_op(kFusedElementwise);
+  fused_op.set_name(root.name());
+  fused_op.set_device(root.device());
+  for (const string& input : matched.inputs) fused_op.add_input(input);
+  for (const string& input : root.input()) {
+    if (IsControlInput(input)) fused_op.add_input(input);
+  }
+
+  auto* attrs = fused_op.mutable_attr();
+  (*attrs)["T"] = root.attr().at("T");
+  SetAttrValue(static_cast<int>(matched.inputs.size()), &(*attrs)["N"]);
+  SetAttrValue(ops, &(*attrs)["ops"]);
+  SetAttrValue(matched.operands, &(*attrs)["operands"]);
+
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  mutation->AddNode(std::move(fused_op), &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(mutation->Apply());
+
+  (*invalidated_nodes)[matched.root] = true;
+  for (int op : matched.ops) {
+    if (op != matched.root) (*nodes_to_delete)[op] = true;
+  }
+
+  return Status::OK();
+}
+
 #ifdef INTEL_MKL
 bool IsConv2DWithAdd(const RemapperContext& ctx, int node_index) {
   const auto* node_view = ctx.graph_view.GetNode(node_index);
@@ -1667,7 +2037,9 @@ bool IsConv2DWithAdd(const RemapperContext& ctx, int node_index) {
 //   (2) Fusing side input and/or activation into FusedBatchNorm.
 //   (3) Fusing Conv2D biasadd and relu on GPU
 //   (4) INTEL_MKL specific: Conv2D -> Add or Conv2D -> BiasAdd -> Add.
-bool RequiresInferredShapes(const RemapperContext& ctx, int node_index) {
+//   (5) Fusing element-wise ops, if 'fuse_elementwise_ops' is true.
+bool RequiresInferredShapes(const RemapperContext& ctx, int node_index,
+                            bool fuse_elementwise_ops) {
   // Candidate for a FusedBatchNorm splitting.
   const auto* node_view = ctx.graph_view.GetNode(node_index);
   const auto* node_def = node_view->node();
@@ -1737,12 +2109,23 @@ bool RequiresInferredShapes(const RemapperContext& ctx, int node_index) {
     return false;
   };
 
+  // Candidate for an element-wise fusion.
+  const auto is_elementwise_fusion_candidate = [&]() -> bool {
+    if (!fuse_elementwise_ops || !IsFusableElementwiseOp(*node_view))
+      return false;
+    for (int i = 0; i < node_view->NumRegularFanins(); ++i) {
+      if (IsFusableElementwiseOp(*node_view->GetRegularFanin(i).node_view()))
+        return true;
+    }
+    return false;
+  };
+
 #ifdef INTEL_MKL
   return is_batch_norm_candidate() || is_batch_norm_fusion_candidate() ||
-         IsConv2DWithAdd(ctx, node_index);
+         IsConv2DWithAdd(ctx, node_index) || is_elementwise_fusion_candidate();
 #else
   return is_relu_biasadd_conv2d_candidate() || is_batch_norm_candidate() ||
-         is_batch_norm_fusion_candidate();
+         is_batch_norm_fusion_candidate() || is_elementwise_fusion_candidate();
 #endif  // INTEL_MKL
 }
 
@@ -1770,6 +2153,12 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
   bool allow_non_differentiable_rewrites =
       item.optimization_options().allow_non_differentiable_rewrites;
 
+  // _FusedElementwise groups most element-wise ops of a graph, so it is only
+  // created at the aggressive level.
+  const bool fuse_elementwise_ops =
+      allow_non_differentiable_rewrites &&
+      opt_level_ == RewriterConfig::AGGRESSIVE;
+
   for (int i = num_nodes - 1; i >= 0; --i) {
     // Check if node was invalidated by one of the previous remaps.
     if (invalidated_nodes[i] || nodes_to_delete[i]) {
@@ -1777,7 +2166,8 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
     }
 
     // Infer properties lazily in case they are not needed.
-    if (!ctx.inferred_graph_properties && RequiresInferredShapes(ctx, i)) {
+    if (!ctx.inferred_graph_properties &&
+        RequiresInferredShapes(ctx, i, fuse_elementwise_ops)) {
       const bool assume_valid_feeds = opt_level_ == RewriterConfig::AGGRESSIVE;
       TF_RETURN_IF_ERROR(ctx.graph_properties.InferStatically(
           assume_valid_feeds,
@@ -1813,7 +2203,8 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
 #endif  //! INTEL_MKL
 
     // Infer properties lazily in case they are not needed.
-    if (!ctx.inferred_graph_properties && RequiresInferredShapes(ctx, i)) {
+    if (!ctx.inferred_graph_properties &&
+        RequiresInferredShapes(ctx, i, fuse_elementwise_ops)) {
       const bool assume_valid_feeds = opt_level_ == RewriterConfig::AGGRESSIVE;
       TF_RETURN_IF_ERROR(ctx.graph_properties.InferStatically(
           assume_valid_feeds,
@@ -1894,6 +2285,17 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
       continue;
     }
 
+    // Remap Unique+ResourceGather+SparseSegment{Sum,Mean,SqrtN} into the
+    // FusedEmbeddingLookupSparse. Grappler runs after gradients are built, so
+    // the rewrite is only safe because the gather must have a single consumer:
+    // a gather that is also read by gradient ops is never fused.
+    EmbeddingLookupSparse embedding_lookup_sparse;
+    if (FindEmbeddingLookupSparse(ctx, i, &embedding_lookup_sparse)) {
+      TF_RETURN_IF_ERROR(AddFusedEmbeddingLookupSparseNode(
+          &ctx, embedding_lookup_sparse, &invalidated_nodes, &nodes_to_delete));
+      continue;
+    }
+
     // During inference, most of the inputs to FusedBatchNorm are constant, and
     // we can therefore replace the op with a much cheaper set of primitives.
     FusedBatchNorm fused_batch_norm;
@@ -1901,6 +2303,15 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
       TF_RETURN_IF_ERROR(AddBatchNormNodes(&ctx, fused_batch_norm));
       continue;
     }
+
+    // Remap connected element-wise ops into the _FusedElementwise.
+    FusedElementwise fused_elementwise;
+    if (fuse_elementwise_ops &&
+        FindFusedElementwise(ctx, i, &fused_elementwise)) {
+      TF_RETURN_IF_ERROR(AddFusedElementwiseNode(
+          &ctx, fused_elementwise, &invalidated_nodes, &nodes_to_delete));
+      continue;
+    }
   }
 
   // Remove invalidated nodes.
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 
 #include "tensorflow/cc/ops/nn_ops_internal.h"
+#include "tensorflow/cc/ops/resource_variable_ops.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
@@ -980,5 +981,233 @@ TEST_F(RemapperTest, FuseConv2DWithSqueezeAndBias) {
 }
 #endif  // !INTEL_MKL
 
+TEST_F(RemapperTest, FuseEmbeddingLookupSparse) {
+  using ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto ids = Placeholder(s.WithOpName("ids"), DT_INT64,
+                         ops::Placeholder::Shape({-1}));
+  auto segment_ids = Placeholder(s.WithOpName("segment_ids"), DT_INT32,
+                                 ops::Placeholder::Shape({-1}));
+  auto var = ops::VarHandleOp(s.WithOpName("var"), DT_FLOAT,
+                              TensorShape({100, 16}));
+
+  auto unique = ops::Unique(s.WithOpName("unique"), ids);
+  auto gather = ops::ResourceGather(s.WithOpName("gather"), var, unique.y,
+                                    DT_FLOAT);
+  auto identity = ops::Identity(s.WithOpName("identity"), gather);
+  auto mean = ops::SparseSegmentMean(s.WithOpName("mean"), identity,
+                                     unique.idx, segment_ids);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), mean);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.name(), "gather");
+    EXPECT_NE(node.name(), "identity");
+    if (node.name() == "mean") {
+      EXPECT_EQ(node.op(), "FusedEmbeddingLookupSparse");
+      ASSERT_EQ(node.input_size(), 4);
+      EXPECT_EQ(node.input(0), "var");
+      EXPECT_EQ(node.input(1), "ids");
+      EXPECT_EQ(node.input(2), "mean/EmptyWeights");
+      EXPECT_EQ(node.input(3), "segment_ids");
+      EXPECT_EQ(node.attr().at("combiner").s(), "mean");
+      EXPECT_EQ(node.attr().at("dtype").type(), DT_FLOAT);
+      EXPECT_EQ(node.attr().at("Tindices").type(), DT_INT64);
+      EXPECT_EQ(node.attr().at("Tsegmentids").type(), DT_INT32);
+      found++;
+    } else if (node.name() == "mean/EmptyWeights") {
+      // Unweighted lookup.
+      EXPECT_EQ(node.op(), "Const");
+      EXPECT_EQ(node.attr().at("dtype").type(), DT_FLOAT);
+      EXPECT_EQ(node.attr().at("value").tensor().tensor_shape().dim(0).size(),
+                0);
+      found++;
+    }
+  }
+  EXPECT_EQ(found, 2);
+}
+
+TEST_F(RemapperTest, DoNotFuseEmbeddingLookupSparseWithSharedGather) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto ids = ops::Placeholder(s.WithOpName("ids"), DT_INT64);
+  auto segment_ids = ops::Placeholder(s.WithOpName("segment_ids"), DT_INT32);
+  auto var = ops::VarHandleOp(s.WithOpName("var"), DT_FLOAT,
+                              TensorShape({100, 16}));
+
+  auto unique = ops::Unique(s.WithOpName("unique"), ids);
+  auto gather = ops::ResourceGather(s.WithOpName("gather"), var, unique.y,
+                                    DT_FLOAT);
+  auto sum = ops::SparseSegmentSum(s.WithOpName("sum"), gather, unique.idx,
+                                   segment_ids);
+  auto rows = ops::Identity(s.WithOpName("rows"), gather);
+
+  GrapplerItem item;
+  item.fetch = {"sum", "rows"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "sum") EXPECT_EQ(node.op(), "SparseSegmentSum");
+  }
+}
+
+TEST_F(RemapperTest, FuseElementwiseOps) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({8, 64}));
+  auto bias = ops::Placeholder(s.WithOpName("bias"), DT_FLOAT,
+                               ops::Placeholder::Shape({64}));
+  auto scale = ops::Const(s.WithOpName("scale"), 0.75f, {});
+
+  // y = Tanh(x * scale + bias) * x
+  auto mul = ops::Mul(s.WithOpName("mul"), x, scale);
+  auto add = ops::AddV2(s.WithOpName("add"), mul, bias);
+  auto tanh = ops::Tanh(s.WithOpName("tanh"), add);
+  auto y = ops::Mul(s.WithOpName("y"), tanh, x);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), y);
+
+  auto x_t = GenerateRandomTensor<DT_FLOAT>({8, 64});
+  auto bias_t = GenerateRandomTensor<DT_FLOAT>({64});
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"x", x_t}, {"bias", bias_t}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  // The fusion is only enabled at the aggressive level.
+  {
+    Remapper optimizer(RewriterConfig::ON);
+    GraphDef output;
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+    for (const NodeDef& node : output.node()) {
+      EXPECT_NE(node.op(), "_FusedElementwise");
+    }
+  }
+
+  Remapper optimizer(RewriterConfig::AGGRESSIVE);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.name(), "mul");
+    EXPECT_NE(node.name(), "add");
+    EXPECT_NE(node.name(), "tanh");
+    if (node.name() == "y") {
+      EXPECT_EQ(node.op(), "_FusedElementwise");
+      ASSERT_EQ(node.input_size(), 3);
+      EXPECT_EQ(node.input(0), "x");
+      EXPECT_EQ(node.input(1), "scale");
+      EXPECT_EQ(node.input(2), "bias");
+
+      const auto ops = node.attr().at("ops").list().s();
+      EXPECT_EQ(std::vector<string>(ops.begin(), ops.end()),
+                std::vector<string>({"Mul", "AddV2", "Tanh", "Mul"}));
+      const auto operands = node.attr().at("operands").list().i();
+      EXPECT_EQ(std::vector<int64>(operands.begin(), operands.end()),
+                std::vector<int64>({0, 1, 3, 2, 4, -1, 5, 0}));
+      found++;
+    }
+  }
+  EXPECT_EQ(found, 1);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-5);
+}
+
+TEST_F(RemapperTest, FuseElementwiseOpsWithSharedIntermediate) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({8, 64}));
+  auto bias = ops::Placeholder(s.WithOpName("bias"), DT_FLOAT,
+                               ops::Placeholder::Shape({1, 64}));
+
+  // Relu(x - bias) is also fetched, so "relu" is an input of "y" instead of
+  // being fused into it.
+  auto sub = ops::Sub(s.WithOpName("sub"), x, bias);
+  auto relu = ops::Relu(s.WithOpName("relu"), sub);
+  auto tanh = ops::Tanh(s.WithOpName("tanh"), relu);
+  auto y = ops::Mul(s.WithOpName("y"), tanh, x);
+  auto fetch_y = ops::Identity(s.WithOpName("fetch_y"), y);
+  auto fetch_relu = ops::Identity(s.WithOpName("fetch_relu"), relu);
+
+  GrapplerItem item;
+  item.fetch = {"fetch_y", "fetch_relu"};
+  item.feed = {{"x", GenerateRandomTensor<DT_FLOAT>({8, 64})},
+               {"bias", GenerateRandomTensor<DT_FLOAT>({1, 64})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::AGGRESSIVE);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.name(), "tanh");
+    EXPECT_NE(node.name(), "sub");
+    if (node.name() == "y") {
+      EXPECT_EQ(node.op(), "_FusedElementwise");
+      ASSERT_EQ(node.input_size(), 2);
+      EXPECT_EQ(node.input(0), "relu");
+      EXPECT_EQ(node.input(1), "x");
+      found++;
+    }
+    if (node.name() == "relu") {
+      EXPECT_EQ(node.op(), "_FusedElementwise");
+      ASSERT_EQ(node.input_size(), 2);
+      EXPECT_EQ(node.input(0), "x");
+      EXPECT_EQ(node.input(1), "bias");
+      found++;
+    }
+  }
+  EXPECT_EQ(found, 2);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 2);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 2);
+  for (int i = 0; i < 2; ++i) {
+    test::ExpectTensorNear<float>(tensors[i], tensors_expected[i], 1e-5);
+  }
+}
+
 }  // namespace grappler
 }  // namespace tensorflow
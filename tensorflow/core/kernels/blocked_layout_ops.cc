@@ -0,0 +1,589 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/nn_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <cmath>
+
+#include "tensorflow/core/framework/kernel_shape_util.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/kernels/direct_conv2d_tile.h"
+#include "tensorflow/core/kernels/fused_eigen_output_kernels.h"
+#include "tensorflow/core/util/padding.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+// The blocked CPU layout stores a [batch, rows, cols, channels] tensor as
+//
+//   [batch, ceil(channels / kBlock), rows, cols, kBlock]
+//
+// so that kBlock consecutive channels of a pixel, one vector register of
+// floats, are contiguous, and a whole [rows, cols] plane of a channel block
+// is contiguous. The kernels below vectorize over the kBlock lanes of a
+// block. The padding lanes of the last channel block have unspecified values:
+// kernels never read them to compute the value of a real channel.
+
+namespace {
+
+constexpr int64 kBlock = 8;
+
+// _BlockedConv2D computes the output channels of a block with the register
+// tile of DirectConv2D.
+static_assert(kBlock == direct_conv2d::kOutDepthBlock,
+              "The blocked layout must match the direct convolution tile");
+using direct_conv2d::kOutColBlock;
+
+int64 NumBlocks(int64 channels) { return (channels + kBlock - 1) / kBlock; }
+
+Status CheckBlockedInput(const Tensor& input) {
+  if (input.dims() != 5 || input.dim_size(4) != kBlock) {
+    return errors::InvalidArgument(
+        "input must be a 5-dimensional tensor in the blocked layout with ",
+        kBlock, " channels per block: ", input.shape().DebugString());
+  }
+  return Status::OK();
+}
+
+// Window geometry of a NHWC convolution or pooling op along rows and columns.
+struct WindowDimensions {
+  int64 window_rows;
+  int64 window_cols;
+  int64 stride_rows;
+  int64 stride_cols;
+  int64 dilation_rows;
+  int64 dilation_cols;
+
+  int64 input_rows;
+  int64 input_cols;
+  int64 out_rows;
+  int64 out_cols;
+  int64 pad_rows;
+  int64 pad_cols;
+};
+
+Status ComputeWindowDimensions(const std::vector<int32>& strides,
+                               const std::vector<int32>& dilations,
+                               Padding padding, int64 window_rows,
+                               int64 window_cols, const Tensor& input,
+                               WindowDimensions* dims) {
+  dims->window_rows = window_rows;
+  dims->window_cols = window_cols;
+  dims->stride_rows = strides[1];
+  dims->stride_cols = strides[2];
+  dims->dilation_rows = dilations[1];
+  dims->dilation_cols = dilations[2];
+  dims->input_rows = input.dim_size(2);
+  dims->input_cols = input.dim_size(3);
+  int64 pad_after;
+  TF_RETURN_IF_ERROR(GetWindowedOutputSizeVerboseV2(
+      dims->input_rows, window_rows, dims->dilation_rows, dims->stride_rows,
+      padding, &dims->out_rows, &dims->pad_rows, &pad_after));
+  return GetWindowedOutputSizeVerboseV2(
+      dims->input_cols, window_cols, dims->dilation_cols, dims->stride_cols,
+      padding, &dims->out_cols, &dims->pad_cols, &pad_after);
+}
+
+// Validates the NHWC 'strides' and 'dilations' attributes.
+Status CheckWindowAttributes(const std::vector<int32>& strides,
+                             const std::vector<int32>& dilations) {
+  if (strides.size() != 4 || strides[0] != 1 || strides[3] != 1 ||
+      strides[1] <= 0 || strides[2] <= 0) {
+    return errors::InvalidArgument(
+        "strides must have 4 positive elements, with 1 for the batch and "
+        "channels");
+  }
+  if (dilations.size() != 4 || dilations[0] != 1 || dilations[3] != 1 ||
+      dilations[1] <= 0 || dilations[2] <= 0) {
+    return errors::InvalidArgument(
+        "dilations must have 4 positive elements, with 1 for the batch and "
+        "channels");
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+template <typename T>
+class ToBlockedLayoutOp : public OpKernel {
+ public:
+  explicit ToBlockedLayoutOp(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    OP_REQUIRES(context, input.dims() == 4,
+                errors::InvalidArgument("input must be 4-dimensional: ",
+                                        input.shape().DebugString()));
+    const int64 batch = input.dim_size(0);
+    const int64 rows = input.dim_size(1);
+    const int64 cols = input.dim_size(2);
+    const int64 channels = input.dim_size(3);
+    const int64 blocks = NumBlocks(channels);
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({batch, blocks, rows, cols, kBlock}),
+                       &output));
+    if (output->NumElements() == 0) return;
+
+    const T* in = input.flat<T>().data();
+    T* out = output->flat<T>().data();
+    // Each shard unit is one row of one channel block.
+    auto shard = [=](int64 start, int64 limit) {
+      for (int64 unit = start; unit < limit; ++unit) {
+        const int64 r = unit % rows;
+        const int64 b = (unit / rows) % blocks;
+        const int64 n = unit / (rows * blocks);
+        const int64 num_lanes = std::min(kBlock, channels - b * kBlock);
+        const T* in_row = in + ((n * rows + r) * cols) * channels + b * kBlock;
+        T* out_row = out + unit * cols * kBlock;
+        for (int64 c = 0; c < cols; ++c) {
+          T* out_pixel = out_row + c * kBlock;
+          std::copy_n(in_row + c * channels, num_lanes, out_pixel);
+          std::fill(out_pixel + num_lanes, out_pixel + kBlock, T(0));
+        }
+      }
+    };
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          batch * blocks * rows, cols * kBlock, shard);
+  }
+};
+
+template <typename T>
+class FromBlockedLayoutOp : public OpKernel {
+ public:
+  explicit FromBlockedLayoutOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("channels", &channels_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    OP_REQUIRES_OK(context, CheckBlockedInput(input));
+    const int64 batch = input.dim_size(0);
+    const int64 blocks = input.dim_size(1);
+    const int64 rows = input.dim_size(2);
+    const int64 cols = input.dim_size(3);
+    const int64 channels = channels_;
+    OP_REQUIRES(context, blocks == NumBlocks(channels),
+                errors::InvalidArgument("input has ", blocks,
+                                        " channel blocks, but ", channels,
+                                        " channels were expected"));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({batch, rows, cols, channels}), &output));
+    if (output->NumElements() == 0) return;
+
+    const T* in = input.flat<T>().data();
+    T* out = output->flat<T>().data();
+    // Each shard unit is one output row.
+    auto shard = [=](int64 start, int64 limit) {
+      for (int64 unit = start; unit < limit; ++unit) {
+        const int64 r = unit % rows;
+        const int64 n = unit / rows;
+        T* out_row = out + unit * cols * channels;
+        for (int64 b = 0; b < blocks; ++b) {
+          const int64 num_lanes = std::min(kBlock, channels - b * kBlock);
+          const T* in_row = in + ((n * blocks + b) * rows + r) * cols * kBlock;
+          for (int64 c = 0; c < cols; ++c) {
+            std::copy_n(in_row + c * kBlock, num_lanes,
+                        out_row + c * channels + b * kBlock);
+          }
+        }
+      }
+    };
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers, batch * rows,
+          cols * channels, shard);
+  }
+
+ private:
+  int channels_;
+};
+
+template <typename T>
+class BlockedBiasAddOp : public OpKernel {
+ public:
+  explicit BlockedBiasAddOp(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    const Tensor& bias = context->input(1);
+    OP_REQUIRES_OK(context, CheckBlockedInput(input));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(bias.shape()),
+                errors::InvalidArgument("bias must be 1-dimensional: ",
+                                        bias.shape().DebugString()));
+    const int64 blocks = input.dim_size(1);
+    const int64 channels = bias.dim_size(0);
+    OP_REQUIRES(context, blocks == NumBlocks(channels),
+                errors::InvalidArgument("input has ", blocks,
+                                        " channel blocks, but bias has ",
+                                        channels, " channels"));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->forward_input_or_allocate_output(
+                                {0}, 0, input.shape(), &output));
+    if (output->NumElements() == 0) return;
+
+    const int64 plane_size = input.dim_size(2) * input.dim_size(3);
+    const T* in = input.flat<T>().data();
+    const T* bias_data = bias.flat<T>().data();
+    T* out = output->flat<T>().data();
+    // Each shard unit is one [rows, cols] plane of a channel block.
+    auto shard = [=](int64 start, int64 limit) {
+      for (int64 unit = start; unit < limit; ++unit) {
+        const int64 b = unit % blocks;
+        T bias_block[kBlock] = {};
+        std::copy_n(bias_data + b * kBlock,
+                    std::min(kBlock, channels - b * kBlock), bias_block);
+        const T* in_plane = in + unit * plane_size * kBlock;
+        T* out_plane = out + unit * plane_size * kBlock;
+        for (int64 p = 0; p < plane_size * kBlock; p += kBlock) {
+          for (int64 k = 0; k < kBlock; ++k) {
+            out_plane[p + k] = in_plane[p + k] + bias_block[k];
+          }
+        }
+      }
+    };
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          input.dim_size(0) * blocks, plane_size * kBlock, shard);
+  }
+};
+
+enum class BlockedPoolingType { kMax, kAvg };
+
+template <typename T, BlockedPoolingType pooling_type>
+class BlockedPoolOp : public OpKernel {
+ public:
+  explicit BlockedPoolOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("ksize", &ksize_));
+    OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
+    OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+    OP_REQUIRES(context,
+                ksize_.size() == 4 && ksize_[0] == 1 && ksize_[3] == 1 &&
+                    ksize_[1] > 0 && ksize_[2] > 0,
+                errors::InvalidArgument(
+                    "ksize must have 4 positive elements, with 1 for the "
+                    "batch and channels"));
+    OP_REQUIRES_OK(context, CheckWindowAttributes(strides_, {1, 1, 1, 1}));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    OP_REQUIRES_OK(context, CheckBlockedInput(input));
+    WindowDimensions dims;
+    OP_REQUIRES_OK(context, ComputeWindowDimensions(
+                                strides_, {1, 1, 1, 1}, padding_, ksize_[1],
+                                ksize_[2], input, &dims));
+    const int64 batch = input.dim_size(0);
+    const int64 blocks = input.dim_size(1);
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0,
+                       TensorShape({batch, blocks, dims.out_rows,
+                                    dims.out_cols, kBlock}),
+                       &output));
+    if (output->NumElements() == 0) return;
+
+    const T* in = input.flat<T>().data();
+    T* out = output->flat<T>().data();
+    // Each shard unit is one output row of one channel block.
+    auto shard = [=](int64 start, int64 limit) {
+      for (int64 unit = start; unit < limit; ++unit) {
+        const int64 out_r = unit % dims.out_rows;
+        const int64 plane = unit / dims.out_rows;
+        const T* in_plane =
+            in + plane * dims.input_rows * dims.input_cols * kBlock;
+        const int64 r_start = out_r * dims.stride_rows - dims.pad_rows;
+        const int64 r_end = std::min(r_start + dims.window_rows,
+                                     dims.input_rows);
+        T* out_row = out + unit * dims.out_cols * kBlock;
+
+        for (int64 out_c = 0; out_c < dims.out_cols; ++out_c) {
+          const int64 c_start = out_c * dims.stride_cols - dims.pad_cols;
+          const int64 c_end = std::min(c_start + dims.window_cols,
+                                       dims.input_cols);
+          T acc[kBlock];
+          std::fill_n(acc, kBlock,
+                      pooling_type == BlockedPoolingType::kMax
+                          ? Eigen::NumTraits<T>::lowest()
+                          : T(0));
+          int64 count = 0;
+          for (int64 r = std::max<int64>(r_start, 0); r < r_end; ++r) {
+            for (int64 c = std::max<int64>(c_start, 0); c < c_end; ++c) {
+              const T* pixel = in_plane + (r * dims.input_cols + c) * kBlock;
+              for (int64 k = 0; k < kBlock; ++k) {
+                if (pooling_type == BlockedPoolingType::kMax) {
+                  acc[k] = std::max(acc[k], pixel[k]);
+                } else {
+                  acc[k] += pixel[k];
+                }
+              }
+              ++count;
+            }
+          }
+          // Like AvgPool, the average is over the input pixels in the window,
+          // excluding the padding.
+          if (pooling_type == BlockedPoolingType::kAvg) {
+            const T scale = T(1) / static_cast<T>(std::max<int64>(count, 1));
+            for (int64 k = 0; k < kBlock; ++k) acc[k] *= scale;
+          }
+          std::copy_n(acc, kBlock, out_row + out_c * kBlock);
+        }
+      }
+    };
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          batch * blocks * dims.out_rows,
+          dims.out_cols * dims.window_rows * dims.window_cols * kBlock, shard);
+  }
+
+ private:
+  std::vector<int32> ksize_;
+  std::vector<int32> strides_;
+  Padding padding_;
+};
+
+// BlockedConv2D computes a NHWC convolution directly on the blocked layout:
+//
+// *) The HWIO filter is repacked into blocks of kBlock output channels:
+//
+//      [out_blocks, filter_rows, filter_cols, in_depth, kBlock]
+//
+//    zero padding the last block.
+// *) For every output row of an output channel block, output pixels are
+//    computed in [kOutColBlock, kBlock] register tiles with the DirectConv2D
+//    tile code (see direct_conv2d_tile.h), reading the input one channel block
+//    plane at a time. Only the real input channels are read, never the padding
+//    lanes of the input.
+// *) The fused bias and activation are applied to the accumulator tile before
+//    it is stored, so the output is written once.
+// *) Work is sharded across (batch, out_block, out_row) output rows.
+//
+// Like DirectConv2D, this is only faster than the im2col and GEMM based Conv2D
+// for shallow inputs: CpuBlockedLayoutOptimizer only rewrites convolutions with
+// at most direct_conv2d::kMaxInDepth input channels.
+template <typename T>
+class BlockedConv2DOp : public OpKernel {
+ public:
+  explicit BlockedConv2DOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
+    OP_REQUIRES_OK(context, context->GetAttr("dilations", &dilations_));
+    OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+    OP_REQUIRES_OK(context, CheckWindowAttributes(strides_, dilations_));
+
+    std::vector<string> fused_ops;
+    OP_REQUIRES_OK(context, context->GetAttr("fused_ops", &fused_ops));
+    OP_REQUIRES_OK(context, context->GetAttr("num_args", &num_args_));
+    fused_computation_ = FusedComputationType::kUndefined;
+    if (fused_ops.empty()) {
+      OP_REQUIRES(context, num_args_ == 0,
+                  errors::InvalidArgument(
+                      "_BlockedConv2D without fused ops must have no "
+                      "arguments"));
+    } else {
+      using FCT = FusedComputationType;
+      std::vector<FusedComputationPattern> patterns = {
+          {FCT::kBiasAdd, {"BiasAdd"}},
+          {FCT::kBiasAddWithRelu, {"BiasAdd", "Relu"}},
+          {FCT::kBiasAddWithRelu6, {"BiasAdd", "Relu6"}},
+          {FCT::kBiasAddWithElu, {"BiasAdd", "Elu"}},
+          {FCT::kBiasAddWithLeakyRelu, {"BiasAdd", "LeakyRelu"}},
+      };
+      FusedComputationArgs fused_computation_args;
+      OP_REQUIRES_OK(context, InitializeFusedComputation(
+                                  context, "_BlockedConv2D", patterns,
+                                  &fused_computation_,
+                                  &fused_computation_args));
+      leakyrelu_alpha_ = fused_computation_args.leakyrelu_alpha;
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    const Tensor& filter = context->input(1);
+    OP_REQUIRES_OK(context, CheckBlockedInput(input));
+    OP_REQUIRES(context, filter.dims() == 4,
+                errors::InvalidArgument("filter must be 4-dimensional: ",
+                                        filter.shape().DebugString()));
+    const int64 in_depth = filter.dim_size(2);
+    const int64 out_depth = filter.dim_size(3);
+    const int64 in_blocks = input.dim_size(1);
+    OP_REQUIRES(context, in_blocks == NumBlocks(in_depth),
+                errors::InvalidArgument("input has ", in_blocks,
+                                        " channel blocks, but filter has ",
+                                        in_depth, " input channels"));
+    const T* bias_data = nullptr;
+    if (num_args_ == 1) {
+      const Tensor& bias = context->input(2);
+      OP_REQUIRES(context,
+                  TensorShapeUtils::IsVector(bias.shape()) &&
+                      bias.dim_size(0) == out_depth,
+                  errors::InvalidArgument("bias must be a vector of size ",
+                                          out_depth, ": ",
+                                          bias.shape().DebugString()));
+      bias_data = bias.flat<T>().data();
+    }
+
+    WindowDimensions dims;
+    OP_REQUIRES_OK(context, ComputeWindowDimensions(
+                                strides_, dilations_, padding_,
+                                filter.dim_size(0), filter.dim_size(1), input,
+                                &dims));
+    const int64 batch = input.dim_size(0);
+    const int64 out_blocks = NumBlocks(out_depth);
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0,
+                       TensorShape({batch, out_blocks, dims.out_rows,
+                                    dims.out_cols, kBlock}),
+                       &output));
+    if (output->NumElements() == 0) return;
+
+    // Repack the filter into [out_blocks, filter_rows, filter_cols, in_depth,
+    // kBlock].
+    const int64 num_taps = dims.window_rows * dims.window_cols * in_depth;
+    Tensor packed_filter_tensor;
+    OP_REQUIRES_OK(context, context->allocate_temp(
+                                DataTypeToEnum<T>::value,
+                                TensorShape({out_blocks, num_taps * kBlock}),
+                                &packed_filter_tensor));
+    T* packed_filter = packed_filter_tensor.flat<T>().data();
+    direct_conv2d::PackFilter<T>(filter.flat<T>().data(), num_taps, out_depth,
+                                 packed_filter);
+
+    const T* in = input.flat<T>().data();
+    T* out = output->flat<T>().data();
+    const int64 in_plane_size = dims.input_rows * dims.input_cols * kBlock;
+    direct_conv2d::TileGeometry geo;
+    geo.filter_rows = dims.window_rows;
+    geo.filter_cols = dims.window_cols;
+    geo.in_depth = in_depth;
+    geo.stride_rows = dims.stride_rows;
+    geo.stride_cols = dims.stride_cols;
+    geo.dilation_rows = dims.dilation_rows;
+    geo.dilation_cols = dims.dilation_cols;
+    geo.input_rows = dims.input_rows;
+    geo.input_cols = dims.input_cols;
+    geo.pad_rows = dims.pad_rows;
+    geo.pad_cols = dims.pad_cols;
+    geo.channel_block = kBlock;
+    geo.plane_size = in_plane_size;
+    const FusedComputationType fused_computation = fused_computation_;
+    const T leakyrelu_alpha = static_cast<T>(leakyrelu_alpha_);
+
+    auto shard = [=](int64 start, int64 limit) {
+      for (int64 unit = start; unit < limit; ++unit) {
+        const int64 out_r = unit % dims.out_rows;
+        const int64 ob = (unit / dims.out_rows) % out_blocks;
+        const int64 n = unit / (dims.out_rows * out_blocks);
+        const T* in_image = in + n * in_blocks * in_plane_size;
+        const T* filter_block = packed_filter + ob * num_taps * kBlock;
+        T* out_row = out + unit * dims.out_cols * kBlock;
+
+        T bias_block[kBlock] = {};
+        if (bias_data != nullptr) {
+          std::copy_n(bias_data + ob * kBlock,
+                      std::min(kBlock, out_depth - ob * kBlock), bias_block);
+        }
+
+        for (int64 out_c = 0; out_c < dims.out_cols; out_c += kOutColBlock) {
+          const int64 num_cols =
+              std::min<int64>(kOutColBlock, dims.out_cols - out_c);
+          T acc[kOutColBlock][kBlock] = {};
+          direct_conv2d::ComputeOutputTile<T>(geo, in_image, filter_block,
+                                              out_r, out_c, num_cols, acc);
+          for (int64 j = 0; j < num_cols; ++j) {
+            T* out_pixel = out_row + (out_c + j) * kBlock;
+            for (int64 k = 0; k < kBlock; ++k) {
+              out_pixel[k] = Activation(fused_computation, leakyrelu_alpha,
+                                        acc[j][k] + bias_block[k]);
+            }
+          }
+        }
+      }
+    };
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          batch * out_blocks * dims.out_rows,
+          dims.out_cols * num_taps * kBlock, shard);
+  }
+
+ private:
+  static T Activation(FusedComputationType fused_computation,
+                      T leakyrelu_alpha, T x) {
+    switch (fused_computation) {
+      case FusedComputationType::kBiasAddWithRelu:
+        return std::max(x, T(0));
+      case FusedComputationType::kBiasAddWithRelu6:
+        return std::min(std::max(x, T(0)), T(6));
+      case FusedComputationType::kBiasAddWithElu:
+        return x < T(0) ? std::expm1(x) : x;
+      case FusedComputationType::kBiasAddWithLeakyRelu:
+        return x < T(0) ? x * leakyrelu_alpha : x;
+      default:
+        return x;
+    }
+  }
+
+  std::vector<int32> strides_;
+  std::vector<int32> dilations_;
+  Padding padding_;
+  int num_args_;
+  FusedComputationType fused_computation_;
+  float leakyrelu_alpha_ = 0.0;
+};
+
+#define REGISTER_CPU(T)                                                     \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("_ToBlockedLayout").Device(DEVICE_CPU).TypeConstraint<T>("T"),   \
+      ToBlockedLayoutOp<T>);                                                \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("_FromBlockedLayout").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      FromBlockedLayoutOp<T>);                                              \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("_BlockedConv2D").Device(DEVICE_CPU).TypeConstraint<T>("T"),     \
+      BlockedConv2DOp<T>);                                                  \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("_BlockedBiasAdd").Device(DEVICE_CPU).TypeConstraint<T>("T"),    \
+      BlockedBiasAddOp<T>);                                                 \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("_BlockedMaxPool").Device(DEVICE_CPU).TypeConstraint<T>("T"),    \
+      BlockedPoolOp<T, BlockedPoolingType::kMax>);                          \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("_BlockedAvgPool").Device(DEVICE_CPU).TypeConstraint<T>("T"),    \
+      BlockedPoolOp<T, BlockedPoolingType::kAvg>);
+
+TF_CALL_float(REGISTER_CPU);
+#undef REGISTER_CPU
+
+}  // namespace tensorflow
@@ -0,0 +1,375 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr int kBlock = 8;
+
+// Returns a tensor of deterministic pseudo random values in [-1, 1].
+Tensor MakeInput(const TensorShape& shape, int seed) {
+  Tensor t(DT_FLOAT, shape);
+  auto flat = t.flat<float>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = static_cast<float>((i * 37 + seed * 101) % 97) / 48.f - 1.f;
+  }
+  return t;
+}
+
+// Converts a NHWC tensor to the blocked layout, setting padding lanes to NaN
+// to check that the kernels never read them.
+Tensor ToBlocked(const Tensor& nhwc) {
+  const int64 channels = nhwc.dim_size(3);
+  const int64 blocks = (channels + kBlock - 1) / kBlock;
+  Tensor blocked(DT_FLOAT, {nhwc.dim_size(0), blocks, nhwc.dim_size(1),
+                            nhwc.dim_size(2), kBlock});
+  const auto in = nhwc.tensor<float, 4>();
+  auto out = blocked.tensor<float, 5>();
+  for (int64 n = 0; n < nhwc.dim_size(0); ++n) {
+    for (int64 b = 0; b < blocks; ++b) {
+      for (int64 r = 0; r < nhwc.dim_size(1); ++r) {
+        for (int64 c = 0; c < nhwc.dim_size(2); ++c) {
+          for (int64 k = 0; k < kBlock; ++k) {
+            const int64 d = b * kBlock + k;
+            out(n, b, r, c, k) = d < channels
+                                     ? in(n, r, c, d)
+                                     : std::numeric_limits<float>::quiet_NaN();
+          }
+        }
+      }
+    }
+  }
+  return blocked;
+}
+
+// Converts a tensor in the blocked layout to NHWC with 'channels' channels.
+Tensor FromBlocked(const Tensor& blocked, int64 channels) {
+  Tensor nhwc(DT_FLOAT, {blocked.dim_size(0), blocked.dim_size(2),
+                         blocked.dim_size(3), channels});
+  const auto in = blocked.tensor<float, 5>();
+  auto out = nhwc.tensor<float, 4>();
+  for (int64 n = 0; n < nhwc.dim_size(0); ++n) {
+    for (int64 r = 0; r < nhwc.dim_size(1); ++r) {
+      for (int64 c = 0; c < nhwc.dim_size(2); ++c) {
+        for (int64 d = 0; d < channels; ++d) {
+          out(n, r, c, d) = in(n, d / kBlock, r, c, d % kBlock);
+        }
+      }
+    }
+  }
+  return nhwc;
+}
+
+// Computes the output size and the padding before the first window of a
+// windowed op along one dimension.
+void WindowedOutputSize(int64 size, int64 window, int64 stride,
+                        int64 dilation, const string& padding, int64* out_size,
+                        int64* pad) {
+  const int64 effective = (window - 1) * dilation + 1;
+  if (padding == "VALID") {
+    *out_size = (size - effective) / stride + 1;
+    *pad = 0;
+  } else {
+    *out_size = (size + stride - 1) / stride;
+    *pad = std::max<int64>(0, (*out_size - 1) * stride + effective - size) / 2;
+  }
+}
+
+class BlockedLayoutOpsTest : public OpsTestBase {
+ protected:
+  // Checks _BlockedConv2D against a NHWC convolution computed one output
+  // element at a time, followed by 'fused_ops'.
+  void VerifyConv2D(const TensorShape& image_shape, int filter_size,
+                    int out_depth, int stride, int dilation,
+                    const string& padding,
+                    const std::vector<string>& fused_ops) {
+    const int64 in_depth = image_shape.dim_size(3);
+    const Tensor image = MakeInput(image_shape, 1);
+    const Tensor filter =
+        MakeInput({filter_size, filter_size, in_depth, out_depth}, 2);
+    const Tensor bias = MakeInput({out_depth}, 3);
+    const int num_args = fused_ops.empty() ? 0 : 1;
+
+    TF_ASSERT_OK(NodeDefBuilder("blocked_conv", "_BlockedConv2D")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(num_args, DT_FLOAT))
+                     .Attr("strides", {1, stride, stride, 1})
+                     .Attr("dilations", {1, dilation, dilation, 1})
+                     .Attr("padding", padding)
+                     .Attr("fused_ops", fused_ops)
+                     .Attr("num_args", num_args)
+                     .Attr("leakyrelu_alpha", 0.3f)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    const Tensor blocked_image = ToBlocked(image);
+    AddInputFromArray<float>(blocked_image.shape(),
+                             blocked_image.flat<float>());
+    AddInputFromArray<float>(filter.shape(), filter.flat<float>());
+    if (num_args == 1) {
+      AddInputFromArray<float>(bias.shape(), bias.flat<float>());
+    }
+    TF_ASSERT_OK(RunOpKernel());
+
+    int64 out_rows, out_cols, pad_rows, pad_cols;
+    WindowedOutputSize(image_shape.dim_size(1), filter_size, stride, dilation,
+                       padding, &out_rows, &pad_rows);
+    WindowedOutputSize(image_shape.dim_size(2), filter_size, stride, dilation,
+                       padding, &out_cols, &pad_cols);
+    Tensor expected(DT_FLOAT,
+                    {image_shape.dim_size(0), out_rows, out_cols, out_depth});
+    const auto in = image.tensor<float, 4>();
+    const auto f = filter.tensor<float, 4>();
+    auto out = expected.tensor<float, 4>();
+    for (int64 n = 0; n < image_shape.dim_size(0); ++n) {
+      for (int64 r = 0; r < out_rows; ++r) {
+        for (int64 c = 0; c < out_cols; ++c) {
+          for (int64 od = 0; od < out_depth; ++od) {
+            float sum = 0;
+            for (int64 fr = 0; fr < filter_size; ++fr) {
+              const int64 in_r = r * stride - pad_rows + fr * dilation;
+              if (in_r < 0 || in_r >= image_shape.dim_size(1)) continue;
+              for (int64 fc = 0; fc < filter_size; ++fc) {
+                const int64 in_c = c * stride - pad_cols + fc * dilation;
+                if (in_c < 0 || in_c >= image_shape.dim_size(2)) continue;
+                for (int64 d = 0; d < in_depth; ++d) {
+                  sum += in(n, in_r, in_c, d) * f(fr, fc, d, od);
+                }
+              }
+            }
+            if (num_args == 1) sum += bias.flat<float>()(od);
+            if (fused_ops.size() == 2) {
+              const string& activation = fused_ops[1];
+              if (activation == "Relu" || activation == "Relu6") {
+                sum = std::max(sum, 0.f);
+              }
+              if (activation == "Relu6") sum = std::min(sum, 6.f);
+              if (activation == "Elu" && sum < 0) sum = std::expm1(sum);
+              if (activation == "LeakyRelu" && sum < 0) sum *= 0.3f;
+            }
+            out(n, r, c, od) = sum;
+          }
+        }
+      }
+    }
+
+    ASSERT_EQ(GetOutput(0)->dims(), 5);
+    test::ExpectTensorNear<float>(expected,
+                                  FromBlocked(*GetOutput(0), out_depth), 1e-4);
+  }
+
+  // Checks _BlockedMaxPool or _BlockedAvgPool against a NHWC pooling computed
+  // one output element at a time.
+  void VerifyPool(const string& op, const TensorShape& image_shape, int ksize,
+                  int stride, const string& padding) {
+    const Tensor image = MakeInput(image_shape, 4);
+    TF_ASSERT_OK(NodeDefBuilder("blocked_pool", op)
+                     .Input(FakeInput(DT_FLOAT))
+                     .Attr("ksize", {1, ksize, ksize, 1})
+                     .Attr("strides", {1, stride, stride, 1})
+                     .Attr("padding", padding)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    const Tensor blocked_image = ToBlocked(image);
+    AddInputFromArray<float>(blocked_image.shape(),
+                             blocked_image.flat<float>());
+    TF_ASSERT_OK(RunOpKernel());
+
+    const bool is_max = op == "_BlockedMaxPool";
+    int64 out_rows, out_cols, pad_rows, pad_cols;
+    WindowedOutputSize(image_shape.dim_size(1), ksize, stride, 1, padding,
+                       &out_rows, &pad_rows);
+    WindowedOutputSize(image_shape.dim_size(2), ksize, stride, 1, padding,
+                       &out_cols, &pad_cols);
+    const int64 depth = image_shape.dim_size(3);
+    Tensor expected(DT_FLOAT,
+                    {image_shape.dim_size(0), out_rows, out_cols, depth});
+    const auto in = image.tensor<float, 4>();
+    auto out = expected.tensor<float, 4>();
+    for (int64 n = 0; n < image_shape.dim_size(0); ++n) {
+      for (int64 r = 0; r < out_rows; ++r) {
+        for (int64 c = 0; c < out_cols; ++c) {
+          for (int64 d = 0; d < depth; ++d) {
+            float acc = is_max ? std::numeric_limits<float>::lowest() : 0.f;
+            int count = 0;
+            for (int64 wr = 0; wr < ksize; ++wr) {
+              const int64 in_r = r * stride - pad_rows + wr;
+              if (in_r < 0 || in_r >= image_shape.dim_size(1)) continue;
+              for (int64 wc = 0; wc < ksize; ++wc) {
+                const int64 in_c = c * stride - pad_cols + wc;
+                if (in_c < 0 || in_c >= image_shape.dim_size(2)) continue;
+                acc = is_max ? std::max(acc, in(n, in_r, in_c, d))
+                             : acc + in(n, in_r, in_c, d);
+                ++count;
+              }
+            }
+            out(n, r, c, d) = is_max ? acc : acc / count;
+          }
+        }
+      }
+    }
+
+    test::ExpectTensorNear<float>(expected, FromBlocked(*GetOutput(0), depth),
+                                  1e-5);
+  }
+};
+
+TEST_F(BlockedLayoutOpsTest, ToBlockedLayout) {
+  TF_ASSERT_OK(NodeDefBuilder("to_blocked", "_ToBlockedLayout")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  const Tensor image = MakeInput({2, 3, 5, 11}, 0);
+  AddInputFromArray<float>(image.shape(), image.flat<float>());
+  TF_ASSERT_OK(RunOpKernel());
+
+  const Tensor& output = *GetOutput(0);
+  EXPECT_EQ(output.shape(), TensorShape({2, 2, 3, 5, kBlock}));
+  test::ExpectTensorEqual<float>(image, FromBlocked(output, 11));
+  // The padding lanes of the last block are zeros.
+  const auto out = output.tensor<float, 5>();
+  for (int k = 11 - kBlock; k < kBlock; ++k) {
+    EXPECT_EQ(out(1, 1, 2, 4, k), 0.f);
+  }
+}
+
+TEST_F(BlockedLayoutOpsTest, FromBlockedLayout) {
+  TF_ASSERT_OK(NodeDefBuilder("from_blocked", "_FromBlockedLayout")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("channels", 11)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  const Tensor image = MakeInput({2, 3, 5, 11}, 0);
+  const Tensor blocked = ToBlocked(image);
+  AddInputFromArray<float>(blocked.shape(), blocked.flat<float>());
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<float>(image, *GetOutput(0));
+}
+
+TEST_F(BlockedLayoutOpsTest, FromBlockedLayoutChecksChannels) {
+  TF_ASSERT_OK(NodeDefBuilder("from_blocked", "_FromBlockedLayout")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("channels", 17)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  const Tensor blocked = ToBlocked(MakeInput({1, 2, 2, 11}, 0));
+  AddInputFromArray<float>(blocked.shape(), blocked.flat<float>());
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+TEST_F(BlockedLayoutOpsTest, BiasAdd) {
+  TF_ASSERT_OK(NodeDefBuilder("bias_add", "_BlockedBiasAdd")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  const Tensor image = MakeInput({2, 3, 4, 13}, 0);
+  const Tensor bias = MakeInput({13}, 1);
+  const Tensor blocked = ToBlocked(image);
+  AddInputFromArray<float>(blocked.shape(), blocked.flat<float>());
+  AddInputFromArray<float>(bias.shape(), bias.flat<float>());
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected = image;
+  auto e = expected.tensor<float, 4>();
+  for (int n = 0; n < 2; ++n) {
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 4; ++c) {
+        for (int d = 0; d < 13; ++d) e(n, r, c, d) += bias.flat<float>()(d);
+      }
+    }
+  }
+  test::ExpectTensorNear<float>(expected, FromBlocked(*GetOutput(0), 13),
+                                1e-6);
+}
+
+TEST_F(BlockedLayoutOpsTest, Conv2DSame) {
+  VerifyConv2D({2, 7, 9, 3}, 3, 16, 1, 1, "SAME", {});
+}
+
+TEST_F(BlockedLayoutOpsTest, Conv2DValidStrided) {
+  VerifyConv2D({1, 11, 10, 13}, 3, 12, 2, 1, "VALID", {});
+}
+
+TEST_F(BlockedLayoutOpsTest, Conv2DDilated) {
+  VerifyConv2D({1, 9, 9, 8}, 3, 5, 1, 2, "SAME", {});
+}
+
+TEST_F(BlockedLayoutOpsTest, Conv2DPointwise) {
+  VerifyConv2D({2, 5, 6, 20}, 1, 24, 1, 1, "VALID", {"BiasAdd"});
+}
+
+TEST_F(BlockedLayoutOpsTest, Conv2DWithBiasAddAndRelu) {
+  VerifyConv2D({1, 6, 7, 17}, 3, 9, 1, 1, "SAME", {"BiasAdd", "Relu"});
+}
+
+TEST_F(BlockedLayoutOpsTest, Conv2DWithBiasAddAndRelu6) {
+  VerifyConv2D({1, 6, 7, 4}, 5, 8, 2, 1, "SAME", {"BiasAdd", "Relu6"});
+}
+
+TEST_F(BlockedLayoutOpsTest, Conv2DWithBiasAddAndElu) {
+  VerifyConv2D({1, 5, 5, 9}, 3, 11, 1, 1, "VALID", {"BiasAdd", "Elu"});
+}
+
+TEST_F(BlockedLayoutOpsTest, Conv2DWithBiasAddAndLeakyRelu) {
+  VerifyConv2D({1, 5, 5, 9}, 3, 11, 1, 1, "SAME", {"BiasAdd", "LeakyRelu"});
+}
+
+TEST_F(BlockedLayoutOpsTest, Conv2DUnsupportedFusion) {
+  TF_ASSERT_OK(NodeDefBuilder("blocked_conv", "_BlockedConv2D")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(1, DT_FLOAT))
+                   .Attr("strides", {1, 1, 1, 1})
+                   .Attr("padding", "SAME")
+                   .Attr("fused_ops", {"Relu"})
+                   .Attr("num_args", 1)
+                   .Finalize(node_def()));
+  Status s = InitOp();
+  EXPECT_TRUE(errors::IsUnimplemented(s)) << s;
+}
+
+TEST_F(BlockedLayoutOpsTest, MaxPoolSame) {
+  VerifyPool("_BlockedMaxPool", {2, 7, 8, 11}, 3, 2, "SAME");
+}
+
+TEST_F(BlockedLayoutOpsTest, MaxPoolValid) {
+  VerifyPool("_BlockedMaxPool", {1, 8, 8, 16}, 2, 2, "VALID");
+}
+
+TEST_F(BlockedLayoutOpsTest, AvgPoolSame) {
+  VerifyPool("_BlockedAvgPool", {2, 7, 8, 11}, 3, 2, "SAME");
+}
+
+TEST_F(BlockedLayoutOpsTest, AvgPoolValid) {
+  VerifyPool("_BlockedAvgPool", {1, 9, 6, 5}, 3, 1, "VALID");
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -26,6 +26,8 @@ limitations under the License.
 
 #include <string.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <map>
 #include <vector>
@@ -42,13 +44,17 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/conv_2d.h"
 #include "tensorflow/core/kernels/deep_conv2d.h"
+#include "tensorflow/core/kernels/direct_conv2d.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/padding.h"
 #include "tensorflow/core/util/tensor_format.h"
 #include "tensorflow/core/util/use_cudnn.h"
@@ -271,6 +277,241 @@ class LaunchDeepConvOp<CPUDevice, float> {
   }
 };
 
+// Conv2D algorithms the CPU kernel can choose from for float NHWC inputs.
+enum class CpuConv2DAlgorithm {
+  kDefault,      // LaunchConv2DOp: Eigen SpatialConvolution or MatMul.
+  kWinograd2x2,  // DeepConv2D with Winograd F(2x2, 3x3).
+  kWinograd4x4,  // DeepConv2D with Winograd F(4x4, 3x3).
+  kDirect,       // DirectConv2D.
+};
+
+// Reads the CPU Conv2D algorithm forced by the TF_CONV2D_CPU_ALGORITHM
+// environment variable. Returns kDefault if the variable is not set.
+static Status ReadCpuConv2DAlgorithmFromEnvVar(
+    CpuConv2DAlgorithm* algorithm) {
+  string name;
+  TF_RETURN_IF_ERROR(
+      ReadStringFromEnvVar("TF_CONV2D_CPU_ALGORITHM", "", &name));
+  if (name.empty() || name == "default") {
+    *algorithm = CpuConv2DAlgorithm::kDefault;
+  } else if (name == "winograd_2x2") {
+    *algorithm = CpuConv2DAlgorithm::kWinograd2x2;
+  } else if (name == "winograd_4x4") {
+    *algorithm = CpuConv2DAlgorithm::kWinograd4x4;
+  } else if (name == "direct") {
+    *algorithm = CpuConv2DAlgorithm::kDirect;
+  } else {
+    return errors::InvalidArgument(
+        "Invalid value for TF_CONV2D_CPU_ALGORITHM: ", name,
+        ". Expected one of: default, winograd_2x2, winograd_4x4, direct.");
+  }
+  return Status::OK();
+}
+
+// Returns true if CPU Conv2D autotuning is enabled by the
+// TF_CONV2D_CPU_AUTOTUNE_ENABLE environment variable.
+static bool CpuConv2DAutotuneEnable() {
+  bool value;
+  Status status =
+      ReadBoolFromEnvVar("TF_CONV2D_CPU_AUTOTUNE_ENABLE", false, &value);
+  if (!status.ok()) {
+    LOG(ERROR) << status.error_message();
+  }
+  return value;
+}
+
+// Caches the fastest CPU Conv2D algorithm for each convolution shape and
+// number of worker threads. This is the CPU counterpart of the AutoTuneMap
+// used by the GPU kernels, without its re-validation of cached winners: CPU
+// timings are stable enough that a single measurement is kept.
+class CpuConv2DAutotuneMap {
+ public:
+  typedef std::array<int64, 19> Key;
+
+  static CpuConv2DAutotuneMap* Global() {
+    static CpuConv2DAutotuneMap* map = new CpuConv2DAutotuneMap;
+    return map;
+  }
+
+  static Key MakeKey(const Conv2DDimensions& dims, int num_threads) {
+    return {dims.batch,           dims.input_rows,      dims.input_cols,
+            dims.in_depth,        dims.filter_rows,     dims.filter_cols,
+            dims.patch_depth,     dims.out_depth,       dims.stride_rows,
+            dims.stride_cols,     dims.dilation_rows,   dims.dilation_cols,
+            dims.out_rows,        dims.out_cols,        dims.pad_rows_before,
+            dims.pad_rows_after,  dims.pad_cols_before, dims.pad_cols_after,
+            num_threads};
+  }
+
+  bool Find(const Key& key, CpuConv2DAlgorithm* algorithm) const {
+    mutex_lock l(mu_);
+    auto it = algorithms_.find(key);
+    if (it == algorithms_.end()) return false;
+    *algorithm = it->second;
+    return true;
+  }
+
+  void Insert(const Key& key, CpuConv2DAlgorithm algorithm) {
+    mutex_lock l(mu_);
+    algorithms_[key] = algorithm;
+  }
+
+ private:
+  mutable mutex mu_;
+  std::map<Key, CpuConv2DAlgorithm> algorithms_ TF_GUARDED_BY(mu_);
+};
+
+template <typename Device, typename T>
+class LaunchAutotunedConvOp {
+ public:
+  static bool Run(OpKernelContext* ctx, const Conv2DParameters& params,
+                  const Conv2DDimensions& dimensions, const Tensor& input,
+                  const Tensor& filter, Tensor* output, bool autotune,
+                  CpuConv2DAlgorithm forced_algorithm) {
+    return false;
+  }
+};
+
+// Runs float NHWC convolutions with the algorithm forced by
+// 'forced_algorithm', or, if 'autotune' is true, with the algorithm measured
+// to be fastest for the convolution shape the first time it was seen. Returns
+// false if neither applies, and the caller should use its default path.
+template <>
+class LaunchAutotunedConvOp<CPUDevice, float> {
+ public:
+  static bool Run(OpKernelContext* ctx, const Conv2DParameters& params,
+                  const Conv2DDimensions& dimensions, const Tensor& input,
+                  const Tensor& filter, Tensor* output, bool autotune,
+                  CpuConv2DAlgorithm forced_algorithm) {
+    if (params.data_format != FORMAT_NHWC) return false;
+    if (!autotune && forced_algorithm == CpuConv2DAlgorithm::kDefault) {
+      return false;
+    }
+
+    std::vector<CpuConv2DAlgorithm> candidates =
+        GetCandidates(params, dimensions);
+    // Only the default algorithm applies.
+    if (candidates.size() == 1) return false;
+
+    CpuConv2DAlgorithm algorithm;
+    if (forced_algorithm != CpuConv2DAlgorithm::kDefault) {
+      if (std::find(candidates.begin(), candidates.end(), forced_algorithm) ==
+          candidates.end()) {
+        return false;
+      }
+      algorithm = forced_algorithm;
+    } else {
+      const auto key = CpuConv2DAutotuneMap::MakeKey(
+          dimensions,
+          ctx->device()->tensorflow_cpu_worker_threads()->num_threads);
+      if (!CpuConv2DAutotuneMap::Global()->Find(key, &algorithm)) {
+        algorithm = Autotune(ctx, params, dimensions, input, filter, output,
+                             candidates);
+        if (!ctx->status().ok()) return true;
+        CpuConv2DAutotuneMap::Global()->Insert(key, algorithm);
+      }
+    }
+    Launch(ctx, algorithm, params, dimensions, input, filter, output);
+    return true;
+  }
+
+ private:
+  // Returns the algorithms that support the convolution, starting with
+  // kDefault which supports all of them.
+  static std::vector<CpuConv2DAlgorithm> GetCandidates(
+      const Conv2DParameters& params, const Conv2DDimensions& dimensions) {
+    std::vector<CpuConv2DAlgorithm> candidates = {CpuConv2DAlgorithm::kDefault};
+    // DeepConv2D supports stride 1, undilated 3x3 filters with the same
+    // padding on both sides.
+    if (params.padding != EXPLICIT &&
+        dimensions.in_depth == dimensions.patch_depth &&
+        dimensions.filter_rows == 3 && dimensions.filter_cols == 3 &&
+        dimensions.stride_rows == 1 && dimensions.stride_cols == 1 &&
+        dimensions.dilation_rows == 1 && dimensions.dilation_cols == 1) {
+      candidates.push_back(CpuConv2DAlgorithm::kWinograd2x2);
+      candidates.push_back(CpuConv2DAlgorithm::kWinograd4x4);
+    }
+    if (CanUseDirectConv2D(dimensions)) {
+      candidates.push_back(CpuConv2DAlgorithm::kDirect);
+    }
+    return candidates;
+  }
+
+  // Times every candidate on the op's inputs, and returns the fastest. Each
+  // candidate runs twice, and the faster run is used to discount one-time
+  // costs such as page faults on newly allocated buffers.
+  static CpuConv2DAlgorithm Autotune(
+      OpKernelContext* ctx, const Conv2DParameters& params,
+      const Conv2DDimensions& dimensions, const Tensor& input,
+      const Tensor& filter, Tensor* output,
+      const std::vector<CpuConv2DAlgorithm>& candidates) {
+    Env* env = Env::Default();
+    CpuConv2DAlgorithm best_algorithm = CpuConv2DAlgorithm::kDefault;
+    uint64 best_micros = kuint64max;
+    for (CpuConv2DAlgorithm algorithm : candidates) {
+      for (int i = 0; i < 2; ++i) {
+        const uint64 start_micros = env->NowMicros();
+        Launch(ctx, algorithm, params, dimensions, input, filter, output);
+        if (!ctx->status().ok()) return best_algorithm;
+        const uint64 micros = env->NowMicros() - start_micros;
+        if (micros < best_micros) {
+          best_micros = micros;
+          best_algorithm = algorithm;
+        }
+      }
+    }
+    VLOG(1) << "Conv2D CPU autotune selected algorithm "
+            << static_cast<int>(best_algorithm) << " (" << best_micros
+            << "us) for input " << input.shape().DebugString() << " and filter "
+            << filter.shape().DebugString();
+    return best_algorithm;
+  }
+
+  static void Launch(OpKernelContext* ctx, CpuConv2DAlgorithm algorithm,
+                     const Conv2DParameters& params,
+                     const Conv2DDimensions& dimensions, const Tensor& input,
+                     const Tensor& filter, Tensor* output) {
+    const float* input_ptr = input.flat<float>().data();
+    const float* filter_ptr = filter.flat<float>().data();
+    float* output_ptr = output->flat<float>().data();
+
+    switch (algorithm) {
+      case CpuConv2DAlgorithm::kDefault:
+        LaunchConv2DOp<CPUDevice, float>()(
+            ctx, /*use_cudnn=*/false, /*cudnn_use_autotune=*/false, input,
+            filter, dimensions.dilation_rows, dimensions.dilation_cols,
+            dimensions.stride_rows, dimensions.stride_cols, params.padding,
+            params.explicit_paddings, output, params.data_format);
+        break;
+      case CpuConv2DAlgorithm::kWinograd2x2:
+      case CpuConv2DAlgorithm::kWinograd4x4: {
+        Conv2DArgs args;
+        args.batch = dimensions.batch;
+        args.in_rows = dimensions.input_rows;
+        args.in_cols = dimensions.input_cols;
+        args.in_depth = dimensions.in_depth;
+        args.filter_rows = dimensions.filter_rows;
+        args.filter_cols = dimensions.filter_cols;
+        args.pad_rows = dimensions.pad_rows_before;
+        args.pad_cols = dimensions.pad_cols_before;
+        args.out_rows = dimensions.out_rows;
+        args.out_cols = dimensions.out_cols;
+        args.out_depth = dimensions.out_depth;
+        functor::DeepConv2D<CPUDevice, float>()(
+            ctx, args, input_ptr, filter_ptr, output_ptr,
+            algorithm == CpuConv2DAlgorithm::kWinograd2x2
+                ? DeepConv2DTransformType::kWinograd2x2
+                : DeepConv2DTransformType::kWinograd4x4);
+        break;
+      }
+      case CpuConv2DAlgorithm::kDirect:
+        functor::DirectConv2D<CPUDevice, float>()(ctx, dimensions, input_ptr,
+                                                  filter_ptr, output_ptr);
+        break;
+    }
+  }
+};
+
 #ifdef TENSORFLOW_USE_LIBXSMM_CONVOLUTIONS
 template <typename Device, typename T>
 class LaunchXsmmConvOp {
@@ -513,6 +754,8 @@ class Conv2DOp : public BinaryOp<T> {
 
     OP_REQUIRES_OK(context, context->GetAttr("use_cudnn_on_gpu", &use_cudnn_));
     cudnn_use_autotune_ = CudnnUseAutotune();
+    cpu_autotune_ = CpuConv2DAutotuneEnable();
+    OP_REQUIRES_OK(context, ReadCpuConv2DAlgorithmFromEnvVar(&cpu_algorithm_));
   }
 
   void Compute(OpKernelContext* context) override {
@@ -568,6 +811,12 @@ class Conv2DOp : public BinaryOp<T> {
     }
 #endif
 
+    if (LaunchAutotunedConvOp<Device, T>::Run(context, params_, dimensions,
+                                              input, filter, output,
+                                              cpu_autotune_, cpu_algorithm_)) {
+      return;
+    }
+
     if (params_.padding != EXPLICIT &&
         LaunchDeepConvOp<Device, T>::Run(
             context, input, filter, dimensions.batch, dimensions.input_rows,
@@ -590,6 +839,8 @@ class Conv2DOp : public BinaryOp<T> {
   Conv2DParameters params_;
   bool use_cudnn_;
   bool cudnn_use_autotune_;
+  bool cpu_autotune_;
+  CpuConv2DAlgorithm cpu_algorithm_;
 
   LaunchConv2DOp<Device, T> launcher_;
 
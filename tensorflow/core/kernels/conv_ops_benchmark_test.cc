@@ -521,6 +521,60 @@ BM_FusedConv2DWithBatchNormAndRelu(16, 32, 32, 128, 3, 3, 1024, cpu,
 BM_FusedConv2DWithBatchNormAndRelu(32, 32, 32, 128, 3, 3, 1024, cpu,
                                    "3x3 /b 32");
 
+// -------------------------------------------------------------------------- //
+// Small-channel convolutions (mobile CNNs) with each CPU Conv2D algorithm.
+// -------------------------------------------------------------------------- //
+
+// ALGO: default, winograd_2x2, winograd_4x4 or direct. The algorithm is forced
+// with TF_CONV2D_CPU_ALGORITHM, which is read when the kernel is created.
+#define BM_Conv2DAlgorithm(N, H, W, C, FW, FH, FC, ALGO, LABEL)            \
+  static void BM_NAME(BM_Conv2D_##ALGO, cpu, N, H, W, C, FW, FH,           \
+                      FC)(::testing::benchmark::State & state) {           \
+    setenv("TF_CONV2D_CPU_ALGORITHM", #ALGO, 1 /* replace */);             \
+    test::Benchmark benchmark("cpu", Conv2D<float>(N, H, W, C, FW, FH, FC) \
+                                         .graph,                           \
+                              /*old_benchmark_api=*/false);                \
+    unsetenv("TF_CONV2D_CPU_ALGORITHM");                                   \
+    benchmark.Run(state);                                                  \
+    BM_SET_INFO(N, H, W, C, cpu, LABEL, Conv2D);                           \
+  }                                                                        \
+  BENCHMARK(BM_NAME(BM_Conv2D_##ALGO, cpu, N, H, W, C, FW, FH, FC));
+
+// Picks the fastest algorithm at the first run of each shape.
+#define BM_Conv2DAutotune(N, H, W, C, FW, FH, FC, LABEL)                   \
+  static void BM_NAME(BM_Conv2D_autotune, cpu, N, H, W, C, FW, FH,         \
+                      FC)(::testing::benchmark::State & state) {           \
+    setenv("TF_CONV2D_CPU_AUTOTUNE_ENABLE", "1", 1 /* replace */);         \
+    test::Benchmark benchmark("cpu", Conv2D<float>(N, H, W, C, FW, FH, FC) \
+                                         .graph,                           \
+                              /*old_benchmark_api=*/false);                \
+    unsetenv("TF_CONV2D_CPU_AUTOTUNE_ENABLE");                             \
+    benchmark.Run(state);                                                  \
+    BM_SET_INFO(N, H, W, C, cpu, LABEL, Conv2D);                           \
+  }                                                                        \
+  BENCHMARK(BM_NAME(BM_Conv2D_autotune, cpu, N, H, W, C, FW, FH, FC));
+
+#define BM_Conv2DAllAlgorithms(N, H, W, C, FW, FH, FC, LABEL)       \
+  BM_Conv2DAlgorithm(N, H, W, C, FW, FH, FC, default, LABEL);       \
+  BM_Conv2DAlgorithm(N, H, W, C, FW, FH, FC, winograd_2x2, LABEL);  \
+  BM_Conv2DAlgorithm(N, H, W, C, FW, FH, FC, winograd_4x4, LABEL);  \
+  BM_Conv2DAlgorithm(N, H, W, C, FW, FH, FC, direct, LABEL);        \
+  BM_Conv2DAutotune(N, H, W, C, FW, FH, FC, LABEL)
+
+// MobileNet / ResNet stem.
+BM_Conv2DAllAlgorithms(1, 224, 224, 3, 3, 3, 32, "3x3 stem /b 1");
+BM_Conv2DAllAlgorithms(8, 112, 112, 3, 3, 3, 16, "3x3 stem /b 8");
+
+// Narrow 3x3 layers.
+BM_Conv2DAllAlgorithms(1, 112, 112, 16, 3, 3, 16, "3x3 /b 1");
+BM_Conv2DAllAlgorithms(1, 56, 56, 24, 3, 3, 24, "3x3 /b 1");
+BM_Conv2DAllAlgorithms(8, 56, 56, 32, 3, 3, 32, "3x3 /b 8");
+BM_Conv2DAllAlgorithms(8, 28, 28, 64, 3, 3, 64, "3x3 /b 8");
+
+// Narrow 1x1 layers.
+BM_Conv2DAllAlgorithms(1, 56, 56, 16, 1, 1, 64, "1x1 /b 1");
+BM_Conv2DAllAlgorithms(8, 28, 28, 32, 1, 1, 128, "1x1 /b 8");
+
 #if GOOGLE_CUDA
 // -------------------------------------------------------------------------- //
 // 1x1 Convolution
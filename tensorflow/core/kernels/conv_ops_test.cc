@@ -530,6 +530,155 @@ TEST_F(ConvOpTest, HandwrittenConv) { HandwrittenConv(); }
 
 TEST_F(ConvOpTest, AnisotropicStride) { AnisotropicStrides(); }
 
+// Runs CPU Conv2D with the algorithm named by the test parameter, forced by
+// the TF_CONV2D_CPU_ALGORITHM environment variable, and compares it with a
+// reference convolution. Shapes the algorithm does not support fall back to
+// the default implementation.
+class CpuConv2DAlgorithmTest : public OpsTestBase,
+                               public ::testing::WithParamInterface<string> {
+ protected:
+  void VerifyConv2D(int batch, int rows, int cols, int in_depth,
+                    int filter_size, int out_depth, int stride, int dilation,
+                    const string& padding) {
+    setenv("TF_CONV2D_CPU_ALGORITHM", GetParam().c_str(), 1 /* replace */);
+    TF_ASSERT_OK(NodeDefBuilder("conv_op", "Conv2D")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Attr("T", DT_FLOAT)
+                     .Attr("strides", {1, stride, stride, 1})
+                     .Attr("dilations", {1, dilation, dilation, 1})
+                     .Attr("padding", padding)
+                     .Finalize(node_def()));
+    Status init_status = InitOp();
+    unsetenv("TF_CONV2D_CPU_ALGORITHM");
+    TF_ASSERT_OK(init_status);
+
+    Tensor image(DT_FLOAT, {batch, rows, cols, in_depth});
+    image.flat<float>().setRandom();
+    Tensor filter(DT_FLOAT, {filter_size, filter_size, in_depth, out_depth});
+    filter.flat<float>().setRandom();
+    AddInputFromArray<float>(image.shape(), image.flat<float>());
+    AddInputFromArray<float>(filter.shape(), filter.flat<float>());
+    TF_ASSERT_OK(RunOpKernel());
+
+    const Tensor expected =
+        ReferenceConv2D(image, filter, stride, dilation, padding);
+    test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-3);
+  }
+
+ private:
+  // Computes a NHWC convolution one output element at a time.
+  static Tensor ReferenceConv2D(const Tensor& image, const Tensor& filter,
+                                int stride, int dilation,
+                                const string& padding) {
+    const auto in = image.tensor<float, 4>();
+    const auto f = filter.tensor<float, 4>();
+    const int rows = image.dim_size(1);
+    const int cols = image.dim_size(2);
+    const int filter_size = filter.dim_size(0);
+    const int effective_size = (filter_size - 1) * dilation + 1;
+
+    int out_rows, out_cols, pad_rows = 0, pad_cols = 0;
+    if (padding == "VALID") {
+      out_rows = (rows - effective_size) / stride + 1;
+      out_cols = (cols - effective_size) / stride + 1;
+    } else {
+      out_rows = (rows + stride - 1) / stride;
+      out_cols = (cols + stride - 1) / stride;
+      pad_rows = std::max(0, (out_rows - 1) * stride + effective_size - rows);
+      pad_cols = std::max(0, (out_cols - 1) * stride + effective_size - cols);
+      pad_rows /= 2;
+      pad_cols /= 2;
+    }
+
+    Tensor output(DT_FLOAT, {image.dim_size(0), out_rows, out_cols,
+                             filter.dim_size(3)});
+    auto out = output.tensor<float, 4>();
+    for (int b = 0; b < image.dim_size(0); ++b) {
+      for (int r = 0; r < out_rows; ++r) {
+        for (int c = 0; c < out_cols; ++c) {
+          for (int od = 0; od < filter.dim_size(3); ++od) {
+            float sum = 0;
+            for (int fr = 0; fr < filter_size; ++fr) {
+              const int in_r = r * stride - pad_rows + fr * dilation;
+              if (in_r < 0 || in_r >= rows) continue;
+              for (int fc = 0; fc < filter_size; ++fc) {
+                const int in_c = c * stride - pad_cols + fc * dilation;
+                if (in_c < 0 || in_c >= cols) continue;
+                for (int d = 0; d < image.dim_size(3); ++d) {
+                  sum += in(b, in_r, in_c, d) * f(fr, fc, d, od);
+                }
+              }
+            }
+            out(b, r, c, od) = sum;
+          }
+        }
+      }
+    }
+    return output;
+  }
+};
+
+TEST_P(CpuConv2DAlgorithmTest, Conv3x3Same) {
+  VerifyConv2D(/*batch=*/2, /*rows=*/13, /*cols=*/11, /*in_depth=*/3,
+               /*filter_size=*/3, /*out_depth=*/10, /*stride=*/1,
+               /*dilation=*/1, "SAME");
+}
+
+TEST_P(CpuConv2DAlgorithmTest, Conv3x3Valid) {
+  VerifyConv2D(/*batch=*/1, /*rows=*/9, /*cols=*/14, /*in_depth=*/8,
+               /*filter_size=*/3, /*out_depth=*/16, /*stride=*/1,
+               /*dilation=*/1, "VALID");
+}
+
+TEST_P(CpuConv2DAlgorithmTest, Conv3x3Strided) {
+  VerifyConv2D(/*batch=*/2, /*rows=*/12, /*cols=*/9, /*in_depth=*/4,
+               /*filter_size=*/3, /*out_depth=*/5, /*stride=*/2,
+               /*dilation=*/1, "SAME");
+}
+
+TEST_P(CpuConv2DAlgorithmTest, Conv3x3Dilated) {
+  VerifyConv2D(/*batch=*/1, /*rows=*/10, /*cols=*/10, /*in_depth=*/2,
+               /*filter_size=*/3, /*out_depth=*/7, /*stride=*/1,
+               /*dilation=*/2, "SAME");
+}
+
+TEST_P(CpuConv2DAlgorithmTest, Conv5x5) {
+  VerifyConv2D(/*batch=*/1, /*rows=*/8, /*cols=*/7, /*in_depth=*/3,
+               /*filter_size=*/5, /*out_depth=*/9, /*stride=*/1,
+               /*dilation=*/1, "SAME");
+}
+
+TEST_P(CpuConv2DAlgorithmTest, Conv1x1) {
+  VerifyConv2D(/*batch=*/2, /*rows=*/5, /*cols=*/6, /*in_depth=*/6,
+               /*filter_size=*/1, /*out_depth=*/12, /*stride=*/1,
+               /*dilation=*/1, "VALID");
+}
+
+INSTANTIATE_TEST_SUITE_P(CpuConv2DAlgorithms, CpuConv2DAlgorithmTest,
+                         ::testing::Values("default", "winograd_2x2",
+                                           "winograd_4x4", "direct"));
+
+TEST_F(ConvOpTest, CpuAutotunePicksWorkingAlgorithm) {
+  setenv("TF_CONV2D_CPU_AUTOTUNE_ENABLE", "1", 1 /* replace */);
+  HandwrittenConv();
+  unsetenv("TF_CONV2D_CPU_AUTOTUNE_ENABLE");
+}
+
+TEST_F(ConvOpTest, InvalidCpuAlgorithm) {
+  setenv("TF_CONV2D_CPU_ALGORITHM", "fft", 1 /* replace */);
+  TF_ASSERT_OK(NodeDefBuilder("conv_op", "Conv2D")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("T", DT_FLOAT)
+                   .Attr("strides", {1, 1, 1, 1})
+                   .Attr("padding", "SAME")
+                   .Finalize(node_def()));
+  Status s = InitOp();
+  unsetenv("TF_CONV2D_CPU_ALGORITHM");
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
 template <typename T>
 class FusedConv2DOpTest : public OpsTestBase {
  protected:
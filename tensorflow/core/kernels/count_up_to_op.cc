@@ -87,8 +87,8 @@ class ResourceCountUpToOp : public OpKernel {
     Tensor* tmp;
     OP_REQUIRES_OK(context, context->allocate_persistent(
                                 dtype_, TensorShape({}), &unused, &tmp, attr));
-    *variable->tensor() = *tmp;
     tmp->scalar<T>()() = before_increment.scalar<T>()() + 1;
+    variable->SetTensor(*tmp);
     context->set_output(0, before_increment);
   }
 
@@ -31,7 +31,9 @@ void CompressElementOp::Compute(OpKernelContext* ctx) {
     components.push_back(ctx->input(i));
   }
   CompressedElement compressed;
-  OP_REQUIRES_OK(ctx, CompressElement(components, &compressed));
+  // The snappy pass is deferred to whoever transfers the element, e.g. the
+  // tf.data service worker, which knows whether compression pays off.
+  OP_REQUIRES_OK(ctx, PackElement(components, &compressed));
 
   Tensor* output;
   OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({}), &output));
@@ -0,0 +1,913 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/decode_and_resize_jpeg_batch_dataset_op.h"
+
+#include <deque>
+#include <utility>
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/core/common_runtime/metrics.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/kernels/data/name_utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/stringprintf.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+#include "tensorflow/core/profiler/lib/traceme_encode.h"
+#include "tensorflow/core/util/batch_util.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kDatasetType;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kInputDataset;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kBatchSize;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kNumParallelCalls;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kDropRemainder;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kSize;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kChannels;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kFancyUpscaling;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kDctMethod;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kHalfPixelCenters;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kScale;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kOffset;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kOutputTypes;
+/* static */ constexpr const char* const
+    DecodeAndResizeJpegBatchDatasetOp::kOutputShapes;
+
+namespace {
+
+// Maximum number of batch results to buffer.
+constexpr int64 kMaxBatchResults = 16;
+constexpr char kParallelism[] = "parallelism";
+constexpr char kTFDataDecodeAndResizeJpegBatch[] =
+    "tf_data_decode_and_resize_jpeg_batch";
+constexpr char kTFDataDecodeAndResizeJpegWorker[] =
+    "tf_data_decode_and_resize_jpeg_worker";
+constexpr char kCallCounter[] = "call_counter";
+constexpr char kBatchResultsSize[] = "batch_results_size";
+constexpr char kBatchResults[] = "batch_results";
+constexpr char kEndOfInput[] = "end_of_input";
+constexpr char kNumElements[] = "num_elements";
+constexpr char kOutputSize[] = "output_size";
+constexpr char kOutput[] = "output";
+constexpr char kStatus[] = "status";
+constexpr char kCode[] = "code";
+constexpr char kMessage[] = "msg";
+
+// Computes ceil(x / y).
+inline int64 CeilDiv(int64 x, int64 y) { return (x + y - 1) / y; }
+
+}  // namespace
+
+class DecodeAndResizeJpegBatchDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 batch_size,
+          int64 num_parallel_calls, bool drop_remainder, int32 height,
+          int32 width, int64 channels, const string& dct_method,
+          const DecodeAndResizeJpegOptions& options,
+          const DataTypeVector& output_types,
+          const std::vector<PartialTensorShape>& output_shapes)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        batch_size_(batch_size),
+        num_parallel_calls_(num_parallel_calls),
+        drop_remainder_(drop_remainder),
+        height_(height),
+        width_(width),
+        channels_(channels),
+        dct_method_(dct_method),
+        options_(options),
+        output_types_(output_types),
+        output_shapes_(output_shapes),
+        traceme_metadata_(
+            {{"autotune",
+              num_parallel_calls == model::kAutotune ? "true" : "false"},
+             {"batch_size",
+              strings::Printf("%lld", static_cast<long long>(batch_size))},
+             {"drop_remainder", drop_remainder ? "true" : "false"}}) {
+    input_->Ref();
+  }
+
+  ~Dataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return absl::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  const DataTypeVector& output_dtypes() const override { return output_types_; }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return output_shapes_;
+  }
+
+  string DebugString() const override {
+    return name_utils::DatasetDebugString(kDatasetType);
+  }
+
+  int64 Cardinality() const override {
+    int64 n = input_->Cardinality();
+    if (n == kInfiniteCardinality || n == kUnknownCardinality) {
+      return n;
+    }
+    return n / batch_size_ + (n % batch_size_ == 0 || drop_remainder_ ? 0 : 1);
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return Status::OK();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_graph_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+    Node* batch_size_node;
+    TF_RETURN_IF_ERROR(b->AddScalar(batch_size_, &batch_size_node));
+    Node* num_parallel_calls_node;
+    TF_RETURN_IF_ERROR(
+        b->AddScalar(num_parallel_calls_, &num_parallel_calls_node));
+    Node* drop_remainder_node;
+    TF_RETURN_IF_ERROR(b->AddScalar(drop_remainder_, &drop_remainder_node));
+    Node* size_node;
+    TF_RETURN_IF_ERROR(
+        b->AddVector(std::vector<int32>({height_, width_}), &size_node));
+    AttrValue channels_attr;
+    b->BuildAttrValue(channels_, &channels_attr);
+    AttrValue fancy_upscaling_attr;
+    b->BuildAttrValue(options_.flags.fancy_upscaling, &fancy_upscaling_attr);
+    AttrValue dct_method_attr;
+    b->BuildAttrValue(dct_method_, &dct_method_attr);
+    AttrValue half_pixel_centers_attr;
+    b->BuildAttrValue(options_.half_pixel_centers, &half_pixel_centers_attr);
+    AttrValue scale_attr;
+    b->BuildAttrValue(options_.scale, &scale_attr);
+    AttrValue offset_attr;
+    b->BuildAttrValue(options_.offset, &offset_attr);
+
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {input_graph_node, batch_size_node, num_parallel_calls_node,
+         drop_remainder_node, size_node},
+        {std::make_pair(kChannels, channels_attr),
+         std::make_pair(kFancyUpscaling, fancy_upscaling_attr),
+         std::make_pair(kDctMethod, dct_method_attr),
+         std::make_pair(kHalfPixelCenters, half_pixel_centers_attr),
+         std::make_pair(kScale, scale_attr),
+         std::make_pair(kOffset, offset_attr)},
+        output));
+    return Status::OK();
+  }
+
+ private:
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params),
+          mu_(std::make_shared<mutex>()),
+          cond_var_(std::make_shared<condition_variable>()),
+          num_parallel_calls_(std::make_shared<model::SharedState>(
+              params.dataset->num_parallel_calls_, mu_, cond_var_)) {
+      max_batch_results_ = std::min(
+          kMaxBatchResults,
+          CeilDiv(params.dataset->num_parallel_calls_ == model::kAutotune
+                      ? port::NumSchedulableCPUs()  // maximum parallelism
+                      : params.dataset->num_parallel_calls_,
+                  params.dataset->batch_size_));
+    }
+
+    ~Iterator() override {
+      CancelThreads(/*wait=*/true);
+      if (deregister_fn_) deregister_fn_();
+    }
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(*mu_);
+      // The worker pool is sized for the largest parallelism the autotuner
+      // may pick; `num_parallel_calls_` bounds how many of its threads are
+      // busy at any time.
+      int max_parallelism = num_parallel_calls_->value;
+      if (num_parallel_calls_->value == model::kAutotune) {
+        max_parallelism = ctx->runner_threadpool_size();
+        num_parallel_calls_->value = max_parallelism;
+      }
+      thread_pool_ = ctx->CreateThreadPool(kTFDataDecodeAndResizeJpegWorker,
+                                           max_parallelism);
+      TF_RETURN_IF_ERROR(RegisterCancellationCallback(
+          ctx->cancellation_manager(),
+          [this]() { CancelThreads(/*wait=*/false); }, &deregister_fn_));
+      return dataset()->input_->MakeIterator(ctx, this, prefix(),
+                                             &input_impl_);
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      std::shared_ptr<BatchResult> result;
+      {
+        mutex_lock l(*mu_);
+        EnsureRunnerThreadStarted(ctx);
+        while (!cancelled_ && (batch_results_.empty() ||
+                               batch_results_.front()->num_calls > 0)) {
+          ++waiting_;
+          RecordStop(ctx);
+          cond_var_->wait(l);
+          RecordStart(ctx);
+          --waiting_;
+        }
+        if (cancelled_) {
+          return errors::Cancelled("Iterator was cancelled");
+        }
+        std::swap(result, batch_results_.front());
+        batch_results_.pop_front();
+        cond_var_->notify_all();
+      }
+      profiler::TraceMe traceme([&] {
+        return profiler::TraceMeEncode("DecodeAndResizeJpegBatchConsume",
+                                       {{"element_id", result->id}});
+      });
+      return ProcessResult(ctx, result, out_tensors, end_of_sequence);
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeAsyncKnownRatioNode(
+          std::move(args), dataset()->batch_size_,
+          {model::MakeParameter(kParallelism, num_parallel_calls_, /*min=*/1,
+                                /*max=*/ctx->runner_threadpool_size())});
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(*mu_);
+      // Wait for all in-flight calls to complete.
+      while (num_calls_ > 0) {
+        cond_var_->wait(l);
+      }
+      DCHECK_EQ(num_calls_, 0);
+      TF_RETURN_IF_ERROR(SaveInput(ctx, writer, input_impl_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kCallCounter), call_counter_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kBatchResultsSize),
+                                             batch_results_.size()));
+      for (size_t i = 0; i < batch_results_.size(); ++i) {
+        TF_RETURN_IF_ERROR(WriteBatchResult(writer, i));
+      }
+      return Status::OK();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(*mu_);
+      TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kCallCounter), &call_counter_));
+      int64 batch_results_size;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kBatchResultsSize),
+                                            &batch_results_size));
+      for (int i = 0; i < batch_results_size; ++i) {
+        TF_RETURN_IF_ERROR(ReadBatchResult(ctx, reader, i));
+      }
+      return Status::OK();
+    }
+
+    TraceMeMetadata GetTraceMeMetadata() const override {
+      long long parallelism = -1;  // NOLINT
+      // NOTE: We only set the parallelism value if the lock can be acquired
+      // right away to avoid introducing tracing overhead.
+      if (mu_->try_lock()) {
+        parallelism = num_parallel_calls_->value;
+        mu_->unlock();
+      }
+      auto result = dataset()->traceme_metadata_;
+      result.push_back(std::make_pair(
+          "parallelism",
+          strings::Printf("%lld", static_cast<long long>(parallelism))));
+      return result;
+    }
+
+   private:
+    // BatchResult holds an output batch, into which the images are decoded
+    // directly, and the state of the calls that fill it.
+    struct BatchResult {
+      explicit BatchResult(int64 batch_size, int64 id = -1)
+          : num_calls(batch_size), id(id) {}
+
+      // Keeps the status of the earliest failed element, so that errors are
+      // reported as they would be by a sequential decode followed by batch.
+      void UpdateStatus(const Status& s, int64 offset) {
+        if (TF_PREDICT_FALSE(!s.ok())) {
+          mutex_lock l(mu);
+          if (status.ok() || offset < status_offset) {
+            status = s;
+            status_offset = offset;
+          }
+        }
+      }
+
+      mutex mu;
+      bool end_of_input TF_GUARDED_BY(mu) = false;
+      int64 num_elements TF_GUARDED_BY(mu) = 0;
+      std::vector<Tensor> output;
+      bool output_allocated TF_GUARDED_BY(mu) = false;
+      Status status TF_GUARDED_BY(mu);
+      int64 status_offset TF_GUARDED_BY(mu) = -1;
+      // Counts the number of outstanding calls for this batch.
+      int64 num_calls;  // access guarded by owner's mutex
+      int64 id;
+    };
+
+    // Returns a decoder context from the pool, creating one if all of them
+    // are in use. There are at most as many contexts as concurrent calls,
+    // and each keeps its buffers between images.
+    std::unique_ptr<DecodeAndResizeJpegContext> AcquireDecoder()
+        TF_LOCKS_EXCLUDED(decoders_mu_) {
+      {
+        mutex_lock l(decoders_mu_);
+        if (!decoders_.empty()) {
+          std::unique_ptr<DecodeAndResizeJpegContext> decoder =
+              std::move(decoders_.back());
+          decoders_.pop_back();
+          return decoder;
+        }
+      }
+      return absl::make_unique<DecodeAndResizeJpegContext>(
+          dataset()->options_);
+    }
+
+    void ReleaseDecoder(std::unique_ptr<DecodeAndResizeJpegContext> decoder)
+        TF_LOCKS_EXCLUDED(decoders_mu_) {
+      mutex_lock l(decoders_mu_);
+      decoders_.push_back(std::move(decoder));
+    }
+
+    void CallCompleted(const std::shared_ptr<IteratorContext>& ctx,
+                       const std::shared_ptr<BatchResult>& result)
+        TF_LOCKS_EXCLUDED(*mu_) {
+      mutex_lock l(*mu_);
+      num_calls_--;
+      result->num_calls--;
+      cond_var_->notify_all();
+    }
+
+    // Reads the next input element on the runner thread and hands it to the
+    // worker pool for decoding.
+    void CallDecode(const std::shared_ptr<IteratorContext>& ctx,
+                    const std::shared_ptr<BatchResult>& result, int64 offset)
+        TF_LOCKS_EXCLUDED(*mu_) {
+      std::vector<Tensor> input_element;
+      bool end_of_input = false;
+      Status status =
+          input_impl_->GetNext(ctx.get(), &input_element, &end_of_input);
+      bool return_early;
+      {
+        mutex_lock l(result->mu);
+        result->end_of_input = result->end_of_input || end_of_input;
+        result->status.Update(status);
+        return_early = result->end_of_input || !result->status.ok();
+      }
+      if (return_early) {
+        CallCompleted(ctx, result);
+        return;
+      }
+      thread_pool_->Schedule(
+          [this, ctx, result, offset,
+           input_element = std::move(input_element)]() mutable {
+            profiler::TraceMe traceme([&] {
+              return profiler::TraceMeEncode("DecodeAndResizeJpegBatchProduce",
+                                             {{"element_id", result->id}});
+            });
+            RecordStart(ctx.get());
+            Status status = DecodeIntoBatch(ctx, result, offset,
+                                            std::move(input_element));
+            if (status.ok()) {
+              mutex_lock l(result->mu);
+              result->num_elements++;
+            } else {
+              result->UpdateStatus(status, offset);
+            }
+            RecordStop(ctx.get());
+            // The iterator may be destroyed once the last call completes, so
+            // this must come last.
+            CallCompleted(ctx, result);
+          });
+    }
+
+    // Decodes the image of `input_element` into slot `offset` of the batch,
+    // and copies the other components into their batches.
+    Status DecodeIntoBatch(const std::shared_ptr<IteratorContext>& ctx,
+                           const std::shared_ptr<BatchResult>& result,
+                           int64 offset, std::vector<Tensor> input_element) {
+      const Tensor& contents = input_element[0];
+      if (contents.dtype() != DT_STRING ||
+          !TensorShapeUtils::IsScalar(contents.shape())) {
+        return errors::InvalidArgument(
+            "The first component of the input must be a scalar string, got ",
+            DataTypeString(contents.dtype()), " tensor of shape ",
+            contents.shape().DebugString());
+      }
+      TF_RETURN_IF_ERROR(EnsureOutputAllocated(ctx, result, input_element));
+
+      std::unique_ptr<DecodeAndResizeJpegContext> decoder = AcquireDecoder();
+      Status status = decoder->Decode(
+          contents.scalar<tstring>()(), /*crop_y=*/0, /*crop_x=*/0,
+          /*crop_height=*/0, /*crop_width=*/0, dataset()->height_,
+          dataset()->width_);
+      if (status.ok()) {
+        DCHECK_EQ(decoder->channels(), dataset()->channels_);
+        Tensor* images = &result->output[0];
+        decoder->Resize(images->flat<float>().data() +
+                        offset * (images->NumElements() / images->dim_size(0)));
+      }
+      ReleaseDecoder(std::move(decoder));
+      TF_RETURN_IF_ERROR(status);
+
+      for (size_t i = 1; i < input_element.size(); ++i) {
+        Tensor& tensor = input_element[i];
+        Tensor* batch = &result->output[i];
+        if (tensor.NumElements() !=
+            (batch->NumElements() / batch->dim_size(0))) {
+          TensorShape batch_shape = batch->shape();
+          batch_shape.RemoveDim(0);
+          return errors::InvalidArgument(
+              "Cannot add tensor to the batch: number of elements does not "
+              "match. Shapes are: [tensor]: ",
+              tensor.shape().DebugString(),
+              ", [batch]: ", batch_shape.DebugString());
+        }
+        TF_RETURN_IF_ERROR(
+            batch_util::CopyElementToSlice(std::move(tensor), batch, offset));
+      }
+      return Status::OK();
+    }
+
+    void CancelThreads(bool wait) TF_LOCKS_EXCLUDED(mu_) {
+      mutex_lock l(*mu_);
+      cancelled_ = true;
+      cond_var_->notify_all();
+      // Wait for all in-flight calls to complete.
+      while (wait && num_calls_ > 0) {
+        cond_var_->wait(l);
+      }
+    }
+
+    Status CopyPartialBatch(Tensor* output, const Tensor& value,
+                            int64 num_elements) {
+      switch (value.dtype()) {
+#define HANDLE_TYPE(type)                                         \
+  case DataTypeToEnum<type>::value: {                             \
+    auto output_t = output->flat_outer_dims<type>();              \
+    auto value_t = value.flat_outer_dims<type>();                 \
+    for (size_t i = 0; i < num_elements; i++) {                   \
+      output_t.template chip<0>(i) = value_t.template chip<0>(i); \
+    }                                                             \
+    return Status::OK();                                          \
+  }
+        TF_CALL_DATASET_TYPES(HANDLE_TYPE);
+#undef HANDLE_TYPE
+        default:
+          return errors::InvalidArgument("Unsupported data type: ",
+                                         DataTypeString(value.dtype()));
+      }
+      return Status::OK();
+    }
+
+    void EnsureRunnerThreadStarted(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      if (!runner_thread_) {
+        auto ctx_copy = std::make_shared<IteratorContext>(*ctx);
+        runner_thread_ = ctx->StartThread(
+            kTFDataDecodeAndResizeJpegBatch,
+            std::bind(&Iterator::RunnerThread, this, ctx_copy));
+      }
+    }
+
+    Status EnsureOutputAllocated(const std::shared_ptr<IteratorContext>& ctx,
+                                 const std::shared_ptr<BatchResult>& result,
+                                 const std::vector<Tensor>& input_element) {
+      mutex_lock l(result->mu);
+      if (result->output_allocated) {
+        return Status::OK();
+      }
+      const size_t num_components = input_element.size();
+      result->output.reserve(num_components);
+      AllocatorAttributes attr;
+      attr.set_gpu_compatible(true);
+      result->output.emplace_back(
+          ctx->allocator(attr), DT_FLOAT,
+          TensorShape({dataset()->batch_size_, dataset()->height_,
+                       dataset()->width_, dataset()->channels_}));
+      for (size_t i = 1; i < num_components; ++i) {
+        TensorShape component_shape({dataset()->batch_size_});
+        component_shape.AppendShape(input_element[i].shape());
+        result->output.emplace_back(ctx->allocator(attr),
+                                    input_element[i].dtype(), component_shape);
+      }
+      for (size_t i = 0; i < num_components; ++i) {
+        if (!result->output[i].IsInitialized()) {
+          return errors::ResourceExhausted(
+              "Failed to allocate memory for the batch of component ", i);
+        }
+      }
+      RecordBufferEnqueue(ctx.get(), result->output);
+      result->output_allocated = true;
+      return Status::OK();
+    }
+
+    Status ProcessResult(IteratorContext* ctx,
+                         const std::shared_ptr<BatchResult>& result,
+                         std::vector<Tensor>* out_tensors,
+                         bool* end_of_sequence) {
+      mutex_lock l(result->mu);
+      if (result->output_allocated) {
+        RecordBufferDequeue(ctx, result->output);
+      }
+      if (result->num_elements == 0) {
+        if (result->status.ok() || errors::IsOutOfRange(result->status)) {
+          *end_of_sequence = true;
+          return Status::OK();
+        } else {
+          *end_of_sequence = false;
+          return result->status;
+        }
+      }
+      if (!result->status.ok() && !errors::IsOutOfRange(result->status)) {
+        // Deallocate tensors allocated for the output.
+        result->output.clear();
+        *end_of_sequence = false;
+        return result->status;
+      }
+      if (result->num_elements < dataset()->batch_size_) {
+        if (dataset()->drop_remainder_) {
+          // Deallocate tensors allocated for the output.
+          result->output.clear();
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        const std::vector<Tensor>& output = result->output;
+        for (size_t i = 0; i < output.size(); ++i) {
+          TensorShape component_shape(result->output[i].shape());
+          component_shape.set_dim(0, result->num_elements);
+          AllocatorAttributes attr;
+          attr.set_gpu_compatible(true);
+          out_tensors->emplace_back(ctx->allocator(attr), output[i].dtype(),
+                                    component_shape);
+          if (!out_tensors->back().IsInitialized()) {
+            return errors::ResourceExhausted(
+                "Failed to allocate memory for the batch of component ", i);
+          }
+          TF_RETURN_IF_ERROR(CopyPartialBatch(&out_tensors->back(), output[i],
+                                              result->num_elements));
+        }
+        // Deallocate tensors allocated for the output.
+        result->output.clear();
+      } else {
+        *out_tensors = std::move(result->output);
+      }
+      *end_of_sequence = false;
+      return Status::OK();
+    }
+
+    void RunnerThread(const std::shared_ptr<IteratorContext>& ctx)
+        TF_LOCKS_EXCLUDED(*mu_) {
+      std::vector<std::pair<std::shared_ptr<BatchResult>, int64>> new_calls;
+      RecordStart(ctx.get());
+      auto stop_cleanup =
+          gtl::MakeCleanup([this, &ctx]() { RecordStop(ctx.get()); });
+      {
+        tf_shared_lock l(*mu_);  // mu_ == num_parallel_calls_->mu
+        new_calls.reserve(num_parallel_calls_->value);
+      }
+      auto busy = [this]() TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) -> bool {
+        int64 num_parallel_calls = num_parallel_calls_->value;
+        return num_calls_ >= num_parallel_calls ||
+               (batch_results_.size() > max_batch_results_ ||
+                (batch_results_.size() == max_batch_results_ &&
+                 call_counter_ % dataset()->batch_size_ == 0));
+      };
+      // Counts the total number of batches to use as an id of BatchResult.
+      int64 num_total_batches = 1;
+      while (true) {
+        {
+          mutex_lock l(*mu_);
+          while (!cancelled_ && busy()) {
+            if (waiting_ > 0 && num_calls_ < num_parallel_calls_->value &&
+                max_batch_results_ < kMaxBatchResults) {
+              // A caller is waiting and not all decoders are busy, so add a
+              // batch slot instead of waiting for one to open up.
+              max_batch_results_++;
+              continue;
+            }
+            RecordStop(ctx.get());
+            cond_var_->wait(l);
+            RecordStart(ctx.get());
+          }
+
+          if (cancelled_) {
+            return;
+          }
+
+          while (!busy()) {
+            if (call_counter_ % dataset()->batch_size_ == 0) {
+              batch_results_.push_back(std::make_shared<BatchResult>(
+                  dataset()->batch_size_, num_total_batches++));
+            }
+            int64 offset = call_counter_++ % dataset()->batch_size_;
+            new_calls.emplace_back(batch_results_.back(), offset);
+            num_calls_++;
+          }
+        }
+        for (const auto& call : new_calls) {
+          CallDecode(ctx, call.first, call.second);
+        }
+        new_calls.clear();
+      }
+    }
+
+    Status ReadBatchResult(IteratorContext* ctx, IteratorStateReader* reader,
+                           size_t index) TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      // Restored batches have no outstanding calls.
+      batch_results_.push_back(std::make_shared<BatchResult>(/*batch_size=*/0));
+      std::shared_ptr<BatchResult> result = batch_results_.back();
+      string prefix = strings::StrCat(kBatchResults, "_", index);
+      mutex_lock l(result->mu);
+      result->end_of_input = reader->Contains(
+          full_name(strings::StrCat(prefix, "_", kEndOfInput)));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(
+          full_name(strings::StrCat(prefix, "_", kNumElements)),
+          &result->num_elements));
+      int64 output_size;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(
+          full_name(strings::StrCat(prefix, "_", kOutputSize)), &output_size));
+      result->output.reserve(output_size);
+      for (int i = 0; i < output_size; i++) {
+        Tensor t;
+        TF_RETURN_IF_ERROR(reader->ReadTensor(
+            full_name(strings::StrCat(prefix, "_", kOutput, "_", i)), &t));
+        // Only the filled part of the batch is saved, but `ProcessResult`
+        // expects the leading dimension to be the batch size.
+        if (t.dim_size(0) < dataset()->batch_size_) {
+          TensorShape component_shape(t.shape());
+          component_shape.set_dim(0, dataset()->batch_size_);
+          AllocatorAttributes attr;
+          attr.set_gpu_compatible(true);
+          Tensor new_t(ctx->allocator(attr), t.dtype(), component_shape);
+          TF_RETURN_IF_ERROR(CopyPartialBatch(&new_t, t, t.dim_size(0)));
+          result->output.emplace_back(std::move(new_t));
+        } else {
+          result->output.emplace_back(std::move(t));
+        }
+      }
+      result->output_allocated = output_size > 0;
+      return ReadStatus(reader, strings::StrCat(prefix, "_", kStatus),
+                        &result->status);
+    }
+
+    Status ReadStatus(IteratorStateReader* reader, const string& prefix,
+                      Status* status) TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      int64 code_int;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(
+          full_name(strings::StrCat(prefix, "_", kCode)), &code_int));
+      error::Code code = static_cast<error::Code>(code_int);
+
+      if (code != error::Code::OK) {
+        tstring error_message;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            full_name(strings::StrCat(prefix, "_", kMessage)), &error_message));
+        *status = Status(code, error_message);
+      } else {
+        *status = Status::OK();
+      }
+      return Status::OK();
+    }
+
+    Status WriteBatchResult(IteratorStateWriter* writer, size_t index)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      std::shared_ptr<BatchResult> result = batch_results_[index];
+      string prefix = strings::StrCat(kBatchResults, "_", index);
+      mutex_lock l(result->mu);
+      if (result->end_of_input) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(strings::StrCat(prefix, "_", kEndOfInput)), ""));
+      }
+      TF_RETURN_IF_ERROR(writer->WriteScalar(
+          full_name(strings::StrCat(prefix, "_", kNumElements)),
+          result->num_elements));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(
+          full_name(strings::StrCat(prefix, "_", kOutputSize)),
+          result->output.size()));
+      for (int i = 0; i < result->output.size(); i++) {
+        // If the batch is not full, we only store the first `num_elements`
+        // values. The rest of the batch tensor is *uninitialized* and
+        // accessing that will raise msan errors.
+        if (result->num_elements < dataset()->batch_size_) {
+          TF_RETURN_IF_ERROR(writer->WriteTensor(
+              full_name(strings::StrCat(prefix, "_", kOutput, "_", i)),
+              result->output[i].Slice(0, result->num_elements)));
+        } else {
+          TF_RETURN_IF_ERROR(writer->WriteTensor(
+              full_name(strings::StrCat(prefix, "_", kOutput, "_", i)),
+              result->output[i]));
+        }
+      }
+      return WriteStatus(writer, strings::StrCat(prefix, "_", kStatus),
+                         result->status);
+    }
+
+    Status WriteStatus(IteratorStateWriter* writer, const string& prefix,
+                       const Status& status) TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(strings::StrCat(prefix, "_", kCode)),
+                              static_cast<int64>(status.code())));
+      if (!status.ok()) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(strings::StrCat(prefix, "_", kMessage)),
+            status.error_message()));
+      }
+      return Status::OK();
+    }
+
+    // Used for coordination between the main thread, the runner thread, and
+    // the worker threads.
+    const std::shared_ptr<mutex> mu_;
+    // Used for coordination between the main thread, the runner thread, and
+    // the worker threads. In particular, the runner thread should only
+    // schedule new calls when the number of in-flight calls is less than
+    // `num_parallel_calls_->value` and there are slots available in the
+    // `batch_results_` buffer.
+    const std::shared_ptr<condition_variable> cond_var_;
+    // Identifies the maximum number of parallel calls.
+    const std::shared_ptr<model::SharedState> num_parallel_calls_;
+
+    // Counts the number of outstanding calls.
+    int64 num_calls_ TF_GUARDED_BY(*mu_) = 0;
+    // Counts the total number of calls.
+    int64 call_counter_ TF_GUARDED_BY(*mu_) = 0;
+    std::unique_ptr<IteratorBase> input_impl_;
+    // Buffer for storing the (intermediate) batch results.
+    std::deque<std::shared_ptr<BatchResult>> batch_results_ TF_GUARDED_BY(*mu_);
+    // Background thread used for coordinating input processing.
+    std::unique_ptr<Thread> runner_thread_ TF_GUARDED_BY(*mu_);
+    // Determines whether the transformation has been cancelled.
+    bool cancelled_ TF_GUARDED_BY(*mu_) = false;
+    // Identifies the number of callers currently waiting for a batch result.
+    int64 waiting_ TF_GUARDED_BY(*mu_) = 0;
+    // Identifies the maximum number of batch results to store.
+    int64 max_batch_results_ TF_GUARDED_BY(*mu_);
+
+    // Decoder contexts that are not in use by a worker.
+    mutex decoders_mu_;
+    std::vector<std::unique_ptr<DecodeAndResizeJpegContext>> decoders_
+        TF_GUARDED_BY(decoders_mu_);
+
+    // Method for deregistering the cancellation callback.
+    std::function<void()> deregister_fn_;
+
+    // Threads that decode the images. Declared last so that it is destroyed,
+    // and its threads are joined, before the state they use.
+    std::unique_ptr<thread::ThreadPool> thread_pool_;
+  };
+
+  const DatasetBase* const input_;
+  const int64 batch_size_;
+  const int64 num_parallel_calls_;
+  const bool drop_remainder_;
+  const int32 height_;
+  const int32 width_;
+  const int64 channels_;
+  const string dct_method_;
+  const DecodeAndResizeJpegOptions options_;
+  const DataTypeVector output_types_;
+  const std::vector<PartialTensorShape> output_shapes_;
+  const TraceMeMetadata traceme_metadata_;
+};
+
+DecodeAndResizeJpegBatchDatasetOp::DecodeAndResizeJpegBatchDatasetOp(
+    OpKernelConstruction* ctx)
+    : UnaryDatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kChannels, &channels_));
+  OP_REQUIRES(ctx, channels_ == 1 || channels_ == 3,
+              errors::InvalidArgument("channels must be 1 or 3, got ",
+                                      channels_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kFancyUpscaling,
+                                   &options_.flags.fancy_upscaling));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kDctMethod, &dct_method_));
+  OP_REQUIRES(
+      ctx,
+      (dct_method_.empty() || dct_method_ == "INTEGER_FAST" ||
+       dct_method_ == "INTEGER_ACCURATE"),
+      errors::InvalidArgument("dct_method must be one of "
+                              "{'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}"));
+  options_.flags.dct_method =
+      dct_method_ == "INTEGER_ACCURATE" ? JDCT_ISLOW : JDCT_IFAST;
+  options_.flags.components = channels_;
+  OP_REQUIRES_OK(ctx,
+                 ctx->GetAttr(kHalfPixelCenters, &options_.half_pixel_centers));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kScale, &options_.scale));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOffset, &options_.offset));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputTypes, &output_types_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputShapes, &output_shapes_));
+  OP_REQUIRES(ctx, output_types_[0] == DT_FLOAT,
+              errors::InvalidArgument(
+                  "The first output component must be float, got ",
+                  DataTypeString(output_types_[0])));
+}
+
+void DecodeAndResizeJpegBatchDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                                    DatasetBase* input,
+                                                    DatasetBase** output) {
+  int64 batch_size = 0;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, kBatchSize, &batch_size));
+  OP_REQUIRES(ctx, batch_size > 0,
+              errors::InvalidArgument("batch_size must be greater than zero."));
+
+  int64 num_parallel_calls = 0;
+  OP_REQUIRES_OK(
+      ctx, ParseScalarArgument(ctx, kNumParallelCalls, &num_parallel_calls));
+  OP_REQUIRES(
+      ctx, num_parallel_calls > 0 || num_parallel_calls == model::kAutotune,
+      errors::InvalidArgument("num_parallel_calls must be greater than zero."));
+
+  bool drop_remainder;
+  OP_REQUIRES_OK(ctx,
+                 ParseScalarArgument(ctx, kDropRemainder, &drop_remainder));
+
+  std::vector<int32> size;
+  OP_REQUIRES_OK(ctx, ParseVectorArgument(ctx, kSize, &size));
+  OP_REQUIRES(ctx, size.size() == 2 && size[0] > 0 && size[1] > 0,
+              errors::InvalidArgument(
+                  "size must contain two positive elements, got [",
+                  absl::StrJoin(size, ", "), "]"));
+
+  OP_REQUIRES(
+      ctx,
+      input->output_dtypes()[0] == DT_STRING &&
+          input->output_shapes()[0].IsCompatibleWith(PartialTensorShape({})),
+      errors::InvalidArgument(
+          "The first component of the input dataset must be a scalar string, "
+          "got ",
+          DataTypeString(input->output_dtypes()[0]), " elements of shape ",
+          input->output_shapes()[0].DebugString()));
+  OP_REQUIRES(ctx, input->output_dtypes().size() == output_types_.size(),
+              errors::InvalidArgument(
+                  "The input dataset has ", input->output_dtypes().size(),
+                  " components, but ", output_types_.size(),
+                  " output types were given"));
+
+  if (num_parallel_calls == model::kAutotune) {
+    metrics::RecordTFDataAutotune(kDatasetType);
+  }
+
+  *output = new Dataset(ctx, input, batch_size, num_parallel_calls,
+                        drop_remainder, size[0], size[1], channels_,
+                        dct_method_, options_, output_types_, output_shapes_);
+}
+
+namespace {
+REGISTER_KERNEL_BUILDER(
+    Name("DecodeAndResizeJpegBatchDataset").Device(DEVICE_CPU),
+    DecodeAndResizeJpegBatchDatasetOp);
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,335 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/decode_and_resize_jpeg_batch_dataset_op.h"
+
+#include "tensorflow/core/kernels/data/dataset_test_base.h"
+#include "tensorflow/core/kernels/image/decode_and_resize_jpeg.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kNodeName[] = "decode_and_resize_jpeg_batch_dataset";
+constexpr int kOutHeight = 8;
+constexpr int kOutWidth = 12;
+constexpr int kNumImages = 5;
+
+class DecodeAndResizeJpegBatchDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  DecodeAndResizeJpegBatchDatasetParams(
+      T input_dataset_params, int64 batch_size, int64 num_parallel_calls,
+      bool drop_remainder, std::vector<int32> size, int64 channels,
+      DataTypeVector output_dtypes,
+      std::vector<PartialTensorShape> output_shapes, string node_name)
+      : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
+                      std::move(node_name)),
+        batch_size_(batch_size),
+        num_parallel_calls_(num_parallel_calls),
+        drop_remainder_(drop_remainder),
+        size_(std::move(size)),
+        channels_(channels) {
+    input_dataset_params_.push_back(absl::make_unique<T>(input_dataset_params));
+    iterator_prefix_ =
+        name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
+                                   input_dataset_params.iterator_prefix());
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    return {CreateTensor<int64>(TensorShape({}), {batch_size_}),
+            CreateTensor<int64>(TensorShape({}), {num_parallel_calls_}),
+            CreateTensor<bool>(TensorShape({}), {drop_remainder_}),
+            CreateTensor<int32>(
+                TensorShape({static_cast<int64>(size_.size())}), size_)};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {DecodeAndResizeJpegBatchDatasetOp::kInputDataset,
+                    DecodeAndResizeJpegBatchDatasetOp::kBatchSize,
+                    DecodeAndResizeJpegBatchDatasetOp::kNumParallelCalls,
+                    DecodeAndResizeJpegBatchDatasetOp::kDropRemainder,
+                    DecodeAndResizeJpegBatchDatasetOp::kSize};
+    return Status::OK();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {
+        {DecodeAndResizeJpegBatchDatasetOp::kChannels, channels_},
+        {DecodeAndResizeJpegBatchDatasetOp::kFancyUpscaling, true},
+        {DecodeAndResizeJpegBatchDatasetOp::kDctMethod, ""},
+        {DecodeAndResizeJpegBatchDatasetOp::kHalfPixelCenters, true},
+        {DecodeAndResizeJpegBatchDatasetOp::kScale, 1.0f / 127.5f},
+        {DecodeAndResizeJpegBatchDatasetOp::kOffset, -1.0f},
+        {DecodeAndResizeJpegBatchDatasetOp::kOutputTypes, output_dtypes_},
+        {DecodeAndResizeJpegBatchDatasetOp::kOutputShapes, output_shapes_}};
+    return Status::OK();
+  }
+
+  string dataset_type() const override {
+    return DecodeAndResizeJpegBatchDatasetOp::kDatasetType;
+  }
+
+ private:
+  int64 batch_size_;
+  int64 num_parallel_calls_;
+  bool drop_remainder_;
+  std::vector<int32> size_;
+  int64 channels_;
+};
+
+class DecodeAndResizeJpegBatchDatasetOpTest : public DatasetOpsTestBase {};
+
+// Encodes an RGB gradient whose size and colors depend on `index`, so that
+// every element of the dataset decodes to a different image.
+tstring MakeTestJpeg(int index) {
+  const int height = 16 + 8 * index;
+  const int width = 24 + 4 * index;
+  std::vector<uint8> pixels(height * width * 3);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8* pixel = &pixels[(y * width + x) * 3];
+      pixel[0] = 2 * x + 10 * index;
+      pixel[1] = 3 * y;
+      pixel[2] = x + y + 20 * index;
+    }
+  }
+  jpeg::CompressFlags flags;
+  flags.format = jpeg::FORMAT_RGB;
+  flags.quality = 95;
+  return jpeg::Compress(pixels.data(), width, height, flags);
+}
+
+TensorSliceDatasetParams JpegTensorSliceDatasetParams() {
+  Tensor contents(DT_STRING, TensorShape({kNumImages}));
+  Tensor labels(DT_INT64, TensorShape({kNumImages}));
+  for (int i = 0; i < kNumImages; ++i) {
+    contents.vec<tstring>()(i) = MakeTestJpeg(i);
+    labels.vec<int64>()(i) = i;
+  }
+  return TensorSliceDatasetParams({contents, labels},
+                                  /*node_name=*/"tensor_slice");
+}
+
+// Returns the batches that the dataset is expected to produce, computed by
+// decoding each image separately.
+std::vector<Tensor> ExpectedBatches(int64 batch_size, bool drop_remainder,
+                                    int64 channels) {
+  DecodeAndResizeJpegOptions options;
+  options.flags.components = channels;
+  options.flags.dct_method = JDCT_IFAST;
+  options.half_pixel_centers = true;
+  options.scale = 1.0f / 127.5f;
+  options.offset = -1.0f;
+  DecodeAndResizeJpegContext decoder(options);
+
+  std::vector<Tensor> batches;
+  for (int start = 0; start < kNumImages; start += batch_size) {
+    const int64 size = std::min<int64>(batch_size, kNumImages - start);
+    if (size < batch_size && drop_remainder) break;
+    Tensor images(DT_FLOAT,
+                  TensorShape({size, kOutHeight, kOutWidth, channels}));
+    Tensor labels(DT_INT64, TensorShape({size}));
+    for (int i = 0; i < size; ++i) {
+      TF_CHECK_OK(decoder.Decode(MakeTestJpeg(start + i), 0, 0, 0, 0,
+                                 kOutHeight, kOutWidth));
+      decoder.Resize(images.flat<float>().data() +
+                     i * kOutHeight * kOutWidth * channels);
+      labels.vec<int64>()(i) = start + i;
+    }
+    batches.push_back(std::move(images));
+    batches.push_back(std::move(labels));
+  }
+  return batches;
+}
+
+// test case 1: batch_size = 2, num_parallel_calls = 1, drop_remainder = true,
+// channels = 3
+DecodeAndResizeJpegBatchDatasetParams DecodeAndResizeJpegBatchDatasetParams1() {
+  return DecodeAndResizeJpegBatchDatasetParams(
+      JpegTensorSliceDatasetParams(),
+      /*batch_size=*/2,
+      /*num_parallel_calls=*/1,
+      /*drop_remainder=*/true,
+      /*size=*/{kOutHeight, kOutWidth},
+      /*channels=*/3,
+      /*output_dtypes=*/{DT_FLOAT, DT_INT64},
+      /*output_shapes=*/
+      {PartialTensorShape({2, kOutHeight, kOutWidth, 3}),
+       PartialTensorShape({2})},
+      /*node_name=*/kNodeName);
+}
+
+// test case 2: batch_size = 2, num_parallel_calls = 3, drop_remainder = false,
+// channels = 3
+DecodeAndResizeJpegBatchDatasetParams DecodeAndResizeJpegBatchDatasetParams2() {
+  return DecodeAndResizeJpegBatchDatasetParams(
+      JpegTensorSliceDatasetParams(),
+      /*batch_size=*/2,
+      /*num_parallel_calls=*/3,
+      /*drop_remainder=*/false,
+      /*size=*/{kOutHeight, kOutWidth},
+      /*channels=*/3,
+      /*output_dtypes=*/{DT_FLOAT, DT_INT64},
+      /*output_shapes=*/
+      {PartialTensorShape({-1, kOutHeight, kOutWidth, 3}),
+       PartialTensorShape({-1})},
+      /*node_name=*/kNodeName);
+}
+
+// test case 3: batch_size = 4, num_parallel_calls = kAutotune,
+// drop_remainder = false, channels = 1
+DecodeAndResizeJpegBatchDatasetParams DecodeAndResizeJpegBatchDatasetParams3() {
+  return DecodeAndResizeJpegBatchDatasetParams(
+      JpegTensorSliceDatasetParams(),
+      /*batch_size=*/4,
+      /*num_parallel_calls=*/model::kAutotune,
+      /*drop_remainder=*/false,
+      /*size=*/{kOutHeight, kOutWidth},
+      /*channels=*/1,
+      /*output_dtypes=*/{DT_FLOAT, DT_INT64},
+      /*output_shapes=*/
+      {PartialTensorShape({-1, kOutHeight, kOutWidth, 1}),
+       PartialTensorShape({-1})},
+      /*node_name=*/kNodeName);
+}
+
+DecodeAndResizeJpegBatchDatasetParams
+InvalidBatchSizeDecodeAndResizeJpegBatchDatasetParams() {
+  return DecodeAndResizeJpegBatchDatasetParams(
+      JpegTensorSliceDatasetParams(),
+      /*batch_size=*/-2,
+      /*num_parallel_calls=*/1,
+      /*drop_remainder=*/false,
+      /*size=*/{kOutHeight, kOutWidth},
+      /*channels=*/3,
+      /*output_dtypes=*/{DT_FLOAT, DT_INT64},
+      /*output_shapes=*/
+      {PartialTensorShape({-1, kOutHeight, kOutWidth, 3}),
+       PartialTensorShape({-1})},
+      /*node_name=*/kNodeName);
+}
+
+DecodeAndResizeJpegBatchDatasetParams
+InvalidSizeDecodeAndResizeJpegBatchDatasetParams() {
+  return DecodeAndResizeJpegBatchDatasetParams(
+      JpegTensorSliceDatasetParams(),
+      /*batch_size=*/2,
+      /*num_parallel_calls=*/1,
+      /*drop_remainder=*/false,
+      /*size=*/{kOutHeight, 0},
+      /*channels=*/3,
+      /*output_dtypes=*/{DT_FLOAT, DT_INT64},
+      /*output_shapes=*/
+      {PartialTensorShape({-1, kOutHeight, -1, 3}), PartialTensorShape({-1})},
+      /*node_name=*/kNodeName);
+}
+
+DecodeAndResizeJpegBatchDatasetParams
+InvalidChannelsDecodeAndResizeJpegBatchDatasetParams() {
+  return DecodeAndResizeJpegBatchDatasetParams(
+      JpegTensorSliceDatasetParams(),
+      /*batch_size=*/2,
+      /*num_parallel_calls=*/1,
+      /*drop_remainder=*/false,
+      /*size=*/{kOutHeight, kOutWidth},
+      /*channels=*/4,
+      /*output_dtypes=*/{DT_FLOAT, DT_INT64},
+      /*output_shapes=*/
+      {PartialTensorShape({-1, kOutHeight, kOutWidth, 4}),
+       PartialTensorShape({-1})},
+      /*node_name=*/kNodeName);
+}
+
+std::vector<GetNextTestCase<DecodeAndResizeJpegBatchDatasetParams>>
+GetNextTestCases() {
+  return {{/*dataset_params=*/DecodeAndResizeJpegBatchDatasetParams1(),
+           /*expected_outputs=*/
+           ExpectedBatches(/*batch_size=*/2, /*drop_remainder=*/true,
+                           /*channels=*/3)},
+          {/*dataset_params=*/DecodeAndResizeJpegBatchDatasetParams2(),
+           /*expected_outputs=*/
+           ExpectedBatches(/*batch_size=*/2, /*drop_remainder=*/false,
+                           /*channels=*/3)},
+          {/*dataset_params=*/DecodeAndResizeJpegBatchDatasetParams3(),
+           /*expected_outputs=*/
+           ExpectedBatches(/*batch_size=*/4, /*drop_remainder=*/false,
+                           /*channels=*/1)}};
+}
+
+ITERATOR_GET_NEXT_TEST_P(DecodeAndResizeJpegBatchDatasetOpTest,
+                         DecodeAndResizeJpegBatchDatasetParams,
+                         GetNextTestCases())
+
+TEST_F(DecodeAndResizeJpegBatchDatasetOpTest, DatasetTypeString) {
+  auto dataset_params = DecodeAndResizeJpegBatchDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetTypeString(
+      name_utils::OpName(DecodeAndResizeJpegBatchDatasetOp::kDatasetType)));
+}
+
+std::vector<CardinalityTestCase<DecodeAndResizeJpegBatchDatasetParams>>
+CardinalityTestCases() {
+  return {{/*dataset_params=*/DecodeAndResizeJpegBatchDatasetParams1(),
+           /*expected_cardinality=*/2},
+          {/*dataset_params=*/DecodeAndResizeJpegBatchDatasetParams2(),
+           /*expected_cardinality=*/3},
+          {/*dataset_params=*/DecodeAndResizeJpegBatchDatasetParams3(),
+           /*expected_cardinality=*/2}};
+}
+
+DATASET_CARDINALITY_TEST_P(DecodeAndResizeJpegBatchDatasetOpTest,
+                           DecodeAndResizeJpegBatchDatasetParams,
+                           CardinalityTestCases())
+
+std::vector<IteratorSaveAndRestoreTestCase<
+    DecodeAndResizeJpegBatchDatasetParams>>
+IteratorSaveAndRestoreTestCases() {
+  return {{/*dataset_params=*/DecodeAndResizeJpegBatchDatasetParams1(),
+           /*breakpoints=*/{0, 1, 4},
+           /*expected_outputs=*/
+           ExpectedBatches(/*batch_size=*/2, /*drop_remainder=*/true,
+                           /*channels=*/3)},
+          {/*dataset_params=*/DecodeAndResizeJpegBatchDatasetParams2(),
+           /*breakpoints=*/{0, 1, 4},
+           /*expected_outputs=*/
+           ExpectedBatches(/*batch_size=*/2, /*drop_remainder=*/false,
+                           /*channels=*/3)}};
+}
+
+ITERATOR_SAVE_AND_RESTORE_TEST_P(DecodeAndResizeJpegBatchDatasetOpTest,
+                                 DecodeAndResizeJpegBatchDatasetParams,
+                                 IteratorSaveAndRestoreTestCases())
+
+TEST_F(DecodeAndResizeJpegBatchDatasetOpTest, InvalidBatchSize) {
+  auto dataset_params = InvalidBatchSizeDecodeAndResizeJpegBatchDatasetParams();
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            tensorflow::error::INVALID_ARGUMENT);
+}
+
+TEST_F(DecodeAndResizeJpegBatchDatasetOpTest, InvalidSize) {
+  auto dataset_params = InvalidSizeDecodeAndResizeJpegBatchDatasetParams();
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            tensorflow::error::INVALID_ARGUMENT);
+}
+
+TEST_F(DecodeAndResizeJpegBatchDatasetOpTest, InvalidChannels) {
+  auto dataset_params = InvalidChannelsDecodeAndResizeJpegBatchDatasetParams();
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            tensorflow::error::INVALID_ARGUMENT);
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
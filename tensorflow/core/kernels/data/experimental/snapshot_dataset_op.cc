@@ -72,6 +72,8 @@ namespace experimental {
 /* static */ constexpr const char* const SnapshotDatasetV2Op::kWriterPrefix;
 /* static */ constexpr const char* const SnapshotDatasetV2Op::kHashValid;
 /* static */ constexpr const char* const SnapshotDatasetV2Op::kHash;
+/* static */ constexpr const char* const
+    SnapshotDatasetV2Op::kFileFormatVersion;
 /* static */ constexpr const char* const SnapshotDatasetV2Op::kCompressionAuto;
 /* static */ constexpr const char* const SnapshotDatasetV2Op::kReaderFunc;
 /* static */ constexpr const char* const SnapshotDatasetV2Op::kShardFunc;
@@ -83,7 +85,6 @@ namespace experimental {
     SnapshotDatasetV2Op::kReaderFuncTarguments;
 /* static */ constexpr const char* const
     SnapshotDatasetV2Op::kShardFuncTarguments;
-/* static */ constexpr const int SnapshotDatasetV2Op::kFileFormatVersion;
 
 // ==== Snapshot Implementation ====
 
@@ -120,6 +121,7 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
   Dataset(OpKernelContext* ctx, const DatasetBase* input, uint64 hash,
           const std::string& path, const std::string& compression,
           const std::string& reader_prefix, const std::string& writer_prefix,
+          int file_format_version,
           std::unique_ptr<CapturedFunction> reader_func,
           std::unique_ptr<CapturedFunction> shard_func);
 
@@ -152,6 +154,9 @@ class SnapshotDatasetV2Op::Dataset : public DatasetBase {
   const std::string compression_;
   const std::string reader_prefix_;
   const std::string writer_prefix_;
+  // The file format version of the snapshots written by this dataset.
+  // Snapshots are read with the version recorded in their metadata.
+  const int file_format_version_;
 
   std::unique_ptr<CapturedFunction> reader_func_;
   std::unique_ptr<CapturedFunction> shard_func_;
@@ -309,7 +314,7 @@ SnapshotDatasetV2Op::Dataset::Dataset(
     OpKernelContext* ctx, const DatasetBase* input, uint64 hash,
     const std::string& path, const std::string& compression,
     const std::string& reader_prefix, const std::string& writer_prefix,
-    std::unique_ptr<CapturedFunction> reader_func,
+    int file_format_version, std::unique_ptr<CapturedFunction> reader_func,
     std::unique_ptr<CapturedFunction> shard_func)
     : DatasetBase(DatasetContext(ctx)),
       input_(input),
@@ -318,6 +323,7 @@ SnapshotDatasetV2Op::Dataset::Dataset(
       compression_(compression),
       reader_prefix_(reader_prefix),
       writer_prefix_(writer_prefix),
+      file_format_version_(file_format_version),
       reader_func_(std::move(reader_func)),
       shard_func_(std::move(shard_func)) {
   input_->Ref();
@@ -391,6 +397,9 @@ Status SnapshotDatasetV2Op::Dataset::AsGraphDefInternal(
   AttrValue hash_attr;
   b->BuildAttrValue(static_cast<int64>(hash_), &hash_attr);
 
+  AttrValue file_format_version_attr;
+  b->BuildAttrValue(file_format_version_, &file_format_version_attr);
+
   AttrValue reader_func_attr;
   b->BuildAttrValue(reader_func_->func(), &reader_func_attr);
 
@@ -418,6 +427,7 @@ Status SnapshotDatasetV2Op::Dataset::AsGraphDefInternal(
        {kWriterPrefix, writer_prefix_attr},
        {kHashValid, hash_valid_attr},
        {kHash, hash_attr},
+       {kFileFormatVersion, file_format_version_attr},
        {kReaderFunc, reader_func_attr},
        {kShardFunc, shard_func_attr},
        {kReaderFuncTarguments, reader_func_arguments_types_attr},
@@ -656,7 +666,7 @@ Status SnapshotDatasetV2Op::Dataset::Iterator::Writer::WriteMetadataFile(
   metadata.set_creation_timestamp(EnvTime::NowMicros());
   metadata.set_graph_hash(strings::StrCat(dataset()->hash_));
   metadata.set_run_id(strings::StrCat(run_id_));
-  metadata.set_version(kFileFormatVersion);
+  metadata.set_version(dataset()->file_format_version_);
   for (const auto& output_dtype : dataset()->output_dtypes()) {
     metadata.add_dtype(output_dtype);
   }
@@ -754,8 +764,9 @@ Status SnapshotDatasetV2Op::Dataset::Iterator::Writer::GetNextInternal(
           snapshot_util::ShardDirectory(run_dir_, shard_index);
       auto writer = std::make_unique<snapshot_util::AsyncWriter>(
           ctx->env(), shard_index, snapshot_shard_directory,
-          current_checkpoint_id_, dataset()->compression_, kFileFormatVersion,
-          dataset()->output_dtypes(), [this](Status s) {
+          current_checkpoint_id_, dataset()->compression_,
+          dataset()->file_format_version_, dataset()->output_dtypes(),
+          [this](Status s) {
             if (!s.ok()) {
               LOG(ERROR) << "AsyncWriter in snapshot writer failed: " << s;
               mutex_lock l(writer_status_mu_);
@@ -851,6 +862,13 @@ SnapshotDatasetV2Op::SnapshotDatasetV2Op(OpKernelConstruction* ctx)
   int64 hash;
   OP_REQUIRES_OK(ctx, ctx->GetAttr(kHash, &hash));
   hash_ = static_cast<uint64>(hash);
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kFileFormatVersion, &file_format_version_));
+  // Version 1 is the legacy custom format, 2 is TFRecord and 3 is the block
+  // format (see snapshot_util.h).
+  OP_REQUIRES(ctx, file_format_version_ >= 1 && file_format_version_ <= 3,
+              errors::InvalidArgument("Snapshot file format version ",
+                                      file_format_version_,
+                                      " is not supported."));
 
   OP_REQUIRES_OK(ctx, FunctionMetadata::Create(ctx, kReaderFunc, reader_params,
                                                &reader_func_metadata_));
@@ -866,6 +884,13 @@ void SnapshotDatasetV2Op::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
   std::string compression = compression_ == kCompressionAuto
                                 ? io::compression::kSnappy
                                 : compression_;
+  OP_REQUIRES(ctx,
+              file_format_version_ != 3 ||
+                  compression == io::compression::kNone ||
+                  compression == io::compression::kSnappy,
+              errors::InvalidArgument("Compression ", compression,
+                                      " is not supported by snapshot file "
+                                      "format version 3."));
   uint64 hash;
   if (hash_valid_) {
     hash = hash_;
@@ -895,7 +920,7 @@ void SnapshotDatasetV2Op::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
 
   *output = new SnapshotDatasetV2Op::Dataset(
       ctx, input, hash, path, compression, reader_prefix_, writer_prefix_,
-      std::move(reader_func), std::move(shard_func));
+      file_format_version_, std::move(reader_func), std::move(shard_func));
 }
 
 namespace {
@@ -48,6 +48,7 @@ class SnapshotDatasetV2Op : public UnaryDatasetOpKernel {
   static constexpr const char* const kWriterPrefix = "writer_prefix";
   static constexpr const char* const kHashValid = "hash_valid";
   static constexpr const char* const kHash = "hash";
+  static constexpr const char* const kFileFormatVersion = "file_format_version";
   static constexpr const char* const kCompressionAuto = "AUTO";
   static constexpr const char* const kReaderFunc = "reader_func";
   static constexpr const char* const kShardFunc = "shard_func";
@@ -68,8 +69,6 @@ class SnapshotDatasetV2Op : public UnaryDatasetOpKernel {
                    DatasetBase** output) override;
 
  private:
-  static constexpr const int kFileFormatVersion = 2;
-
   class Dataset;
 
   const int graph_def_version_;
@@ -81,6 +80,7 @@ class SnapshotDatasetV2Op : public UnaryDatasetOpKernel {
   std::string writer_prefix_;
   bool hash_valid_;
   uint64 hash_;
+  int file_format_version_;
 
   std::shared_ptr<FunctionMetadata> reader_func_metadata_;
   std::shared_ptr<FunctionMetadata> shard_func_metadata_;
@@ -48,6 +48,11 @@ namespace snapshot_util {
     CustomReader::kSnappyReaderInputBufferSizeBytes;
 /* static */ constexpr const int64
     CustomReader::kSnappyReaderOutputBufferSizeBytes;
+/* static */ constexpr const int64 BlockWriter::kTargetBlockSizeBytes;
+/* static */ constexpr const int64 BlockWriter::kMaxBlockElements;
+/* static */ constexpr const size_t BlockWriter::kFooterSize;
+/* static */ constexpr const uint64 BlockWriter::kFooterMagic;
+/* static */ constexpr const int BlockReader::kMaxParallelBlocks;
 
 std::string HashDirectory(const std::string& path, uint64 hash) {
   return io::JoinPath(
@@ -92,6 +97,10 @@ Status Writer::Create(Env* env, const std::string& filename,
       *out_writer =
           absl::make_unique<TFRecordWriter>(filename, compression_type);
       break;
+    case 3:
+      *out_writer =
+          absl::make_unique<BlockWriter>(filename, compression_type, dtypes);
+      break;
     default:
       return errors::InvalidArgument("Snapshot writer version: ", version,
                                      " is not supported.");
@@ -305,6 +314,143 @@ Status CustomWriter::WriteRecord(const absl::Cord& data) {
 }
 #endif  // PLATFORM_GOOGLE
 
+BlockWriter::BlockWriter(const std::string& filename,
+                         const std::string& compression_type,
+                         const DataTypeVector& dtypes)
+    : filename_(filename),
+      compression_type_(compression_type),
+      dtypes_(dtypes),
+      index_(absl::make_unique<experimental::SnapshotBlockIndex>()) {}
+
+Status BlockWriter::Initialize(tensorflow::Env* env) {
+  if (compression_type_ != io::compression::kNone &&
+      compression_type_ != io::compression::kSnappy) {
+    return errors::InvalidArgument("Compression ", compression_type_,
+                                   " is not supported.");
+  }
+  TF_RETURN_IF_ERROR(env->NewWritableFile(filename_, &dest_));
+  simple_tensor_mask_.reserve(dtypes_.size());
+  for (const auto& dtype : dtypes_) {
+    simple_tensor_mask_.push_back(DataTypeCanUseMemcpy(dtype));
+  }
+  columns_.resize(dtypes_.size());
+  return Status::OK();
+}
+
+Status BlockWriter::WriteTensors(const std::vector<Tensor>& tensors) {
+  if (tensors.size() != dtypes_.size()) {
+    return errors::InvalidArgument("Expected ", dtypes_.size(),
+                                   " tensors but got ", tensors.size(), ".");
+  }
+  for (int i = 0, end = tensors.size(); i < end; ++i) {
+    num_buffered_bytes_ += tensors[i].TotalBytes();
+    columns_[i].push_back(tensors[i]);
+  }
+  num_buffered_elements_++;
+  if (num_buffered_elements_ >= kMaxBlockElements ||
+      num_buffered_bytes_ >= kTargetBlockSizeBytes) {
+    return FlushBlock();
+  }
+  return Status::OK();
+}
+
+Status BlockWriter::FlushBlock() {
+  if (num_buffered_elements_ == 0) {
+    return Status::OK();
+  }
+  profiler::TraceMe activity(
+      [&]() { return absl::StrCat(kClassName, kSeparator, "FlushBlock"); },
+      profiler::TraceMeLevel::kInfo);
+  experimental::SnapshotBlockMetadata* metadata = index_->add_block();
+  metadata->set_offset(offset_);
+  metadata->set_num_elements(num_buffered_elements_);
+
+  // Non-memcpy-able tensors are stored as serialized `TensorProto`s.
+  std::vector<std::vector<std::string>> serialized(columns_.size());
+  int64 total_size = 0;
+  for (int i = 0, num_columns = columns_.size(); i < num_columns; ++i) {
+    const std::vector<Tensor>& column = columns_[i];
+    experimental::SnapshotColumnMetadata* column_metadata =
+        metadata->add_column();
+    bool uniform_shape = true;
+    for (const Tensor& tensor : column) {
+      experimental::TensorMetadata* tensor_metadata =
+          column_metadata->add_tensor_metadata();
+      tensor.shape().AsProto(tensor_metadata->mutable_tensor_shape());
+      uniform_shape = uniform_shape && tensor.shape() == column[0].shape();
+      int64 size;
+      if (simple_tensor_mask_[i]) {
+        size = tensor.tensor_data().size();
+      } else {
+        TensorProto proto;
+        tensor.AsProtoTensorContent(&proto);
+        serialized[i].push_back(proto.SerializeAsString());
+        size = serialized[i].back().size();
+      }
+      tensor_metadata->set_tensor_size_bytes(size);
+      total_size += size;
+    }
+    column_metadata->set_uniform_shape(uniform_shape);
+  }
+
+  std::string uncompressed;
+  uncompressed.resize(total_size);
+  char* position = &uncompressed[0];
+  for (int i = 0, num_columns = columns_.size(); i < num_columns; ++i) {
+    for (int j = 0, num_elements = columns_[i].size(); j < num_elements; ++j) {
+      StringPiece data = simple_tensor_mask_[i]
+                             ? columns_[i][j].tensor_data()
+                             : StringPiece(serialized[i][j]);
+      memcpy(position, data.data(), data.size());
+      position += data.size();
+    }
+    columns_[i].clear();
+  }
+  DCHECK_EQ(position, uncompressed.data() + total_size);
+  metadata->set_uncompressed_size_bytes(total_size);
+
+  if (compression_type_ == io::compression::kSnappy) {
+    std::string compressed;
+    if (!port::Snappy_Compress(uncompressed.data(), total_size, &compressed)) {
+      return errors::Internal("Failed to compress using snappy.");
+    }
+    uncompressed.swap(compressed);
+  }
+  metadata->set_compressed_size_bytes(uncompressed.size());
+  TF_RETURN_IF_ERROR(dest_->Append(uncompressed));
+  offset_ += uncompressed.size();
+  num_buffered_elements_ = 0;
+  num_buffered_bytes_ = 0;
+  return Status::OK();
+}
+
+Status BlockWriter::Sync() {
+  TF_RETURN_IF_ERROR(FlushBlock());
+  return dest_->Sync();
+}
+
+Status BlockWriter::Close() {
+  if (dest_ != nullptr) {
+    TF_RETURN_IF_ERROR(FlushBlock());
+    const int64 index_offset = offset_;
+    TF_RETURN_IF_ERROR(dest_->Append(index_->SerializeAsString()));
+    char footer[kFooterSize];
+    core::EncodeFixed64(footer, index_offset);
+    core::EncodeFixed64(footer + sizeof(uint64), kFooterMagic);
+    TF_RETURN_IF_ERROR(dest_->Append(StringPiece(footer, sizeof(footer))));
+    TF_RETURN_IF_ERROR(dest_->Close());
+    dest_ = nullptr;
+  }
+  return Status::OK();
+}
+
+BlockWriter::~BlockWriter() {
+  Status s = Close();
+  if (!s.ok()) {
+    LOG(ERROR) << "Could not finish writing file: " << s;
+  }
+}
+
 Status Reader::Create(Env* env, const std::string& filename,
                       const string& compression_type, int version,
                       const DataTypeVector& dtypes,
@@ -322,6 +468,10 @@ Status Reader::Create(Env* env, const std::string& filename,
       *out_reader =
           absl::make_unique<TFRecordReader>(filename, compression_type, dtypes);
       break;
+    case 3:
+      *out_reader =
+          absl::make_unique<BlockReader>(filename, compression_type, dtypes);
+      break;
     default:
       return errors::InvalidArgument("Snapshot reader version: ", version,
                                      " is not supported.");
@@ -842,6 +992,274 @@ Status CustomReader::ReadRecord(absl::Cord* record) {
 }
 #endif
 
+BlockReader::BlockReader(const std::string& filename,
+                         const string& compression_type,
+                         const DataTypeVector& dtypes)
+    : filename_(filename),
+      compression_type_(compression_type),
+      dtypes_(dtypes),
+      index_(absl::make_unique<experimental::SnapshotBlockIndex>()) {}
+
+BlockReader::~BlockReader() {
+  // Wait for the pending decodes, which reference `file_` and `index_`.
+  for (auto& block : pending_blocks_) {
+    block->done.WaitForNotification();
+  }
+}
+
+Status BlockReader::Initialize(Env* env) {
+  if (compression_type_ != io::compression::kNone &&
+      compression_type_ != io::compression::kSnappy) {
+    return errors::InvalidArgument("Compression ", compression_type_,
+                                   " is not supported.");
+  }
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename_, &file_));
+  uint64 file_size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(filename_, &file_size));
+  if (file_size < BlockWriter::kFooterSize) {
+    return errors::DataLoss("Snapshot file ", filename_,
+                            " is too small to contain a block index.");
+  }
+
+  char footer_scratch[BlockWriter::kFooterSize];
+  StringPiece footer;
+  TF_RETURN_IF_ERROR(file_->Read(file_size - BlockWriter::kFooterSize,
+                                 BlockWriter::kFooterSize, &footer,
+                                 footer_scratch));
+  if (footer.size() != BlockWriter::kFooterSize ||
+      core::DecodeFixed64(footer.data() + sizeof(uint64)) !=
+          BlockWriter::kFooterMagic) {
+    return errors::DataLoss("Snapshot file ", filename_,
+                            " has a corrupted footer.");
+  }
+  const uint64 index_offset = core::DecodeFixed64(footer.data());
+  if (index_offset > file_size - BlockWriter::kFooterSize) {
+    return errors::DataLoss("Snapshot file ", filename_,
+                            " has an invalid block index offset.");
+  }
+  const size_t index_size =
+      file_size - BlockWriter::kFooterSize - index_offset;
+  auto index_scratch = absl::make_unique<char[]>(index_size);
+  StringPiece index;
+  TF_RETURN_IF_ERROR(
+      file_->Read(index_offset, index_size, &index, index_scratch.get()));
+  if (index.size() != index_size ||
+      !index_->ParseFromArray(index.data(), index.size())) {
+    return errors::DataLoss("Could not parse SnapshotBlockIndex");
+  }
+
+  simple_tensor_mask_.reserve(dtypes_.size());
+  for (const auto& dtype : dtypes_) {
+    simple_tensor_mask_.push_back(DataTypeCanUseMemcpy(dtype));
+  }
+  num_parallel_blocks_ =
+      std::max(1, std::min(kMaxParallelBlocks, port::MaxParallelism()));
+  thread_pool_ = absl::make_unique<thread::ThreadPool>(
+      env, ThreadOptions(), "snapshot_block_reader", num_parallel_blocks_);
+  ScheduleBlocks();
+  return Status::OK();
+}
+
+void BlockReader::ScheduleBlocks() {
+  while (static_cast<int>(pending_blocks_.size()) < num_parallel_blocks_ &&
+         next_block_ < index_->block_size()) {
+    auto block = std::make_shared<DecodedBlock>();
+    const experimental::SnapshotBlockMetadata* metadata =
+        &index_->block(next_block_);
+    thread_pool_->Schedule([this, block, metadata]() {
+      block->status = DecodeBlock(*metadata, &block->elements);
+      block->done.Notify();
+    });
+    pending_blocks_.push_back(std::move(block));
+    next_block_++;
+  }
+}
+
+Status BlockReader::ReadTensors(std::vector<Tensor>* read_tensors) {
+  profiler::TraceMe activity(
+      [&]() { return absl::StrCat(kClassName, kSeparator, "ReadTensors"); },
+      profiler::TraceMeLevel::kInfo);
+  while (!pending_blocks_.empty()) {
+    DecodedBlock* block = pending_blocks_.front().get();
+    block->done.WaitForNotification();
+    TF_RETURN_IF_ERROR(block->status);
+    if (next_element_ < static_cast<int64>(block->elements.size())) {
+      std::vector<Tensor>& element = block->elements[next_element_++];
+      read_tensors->reserve(element.size());
+      for (auto& tensor : element) {
+        read_tensors->push_back(std::move(tensor));
+      }
+      return Status::OK();
+    }
+    pending_blocks_.pop_front();
+    next_element_ = 0;
+    ScheduleBlocks();
+  }
+  return errors::OutOfRange("No more blocks in snapshot file ", filename_);
+}
+
+Status BlockReader::SkipRecords(int64 num_records) {
+  while (num_records > 0) {
+    if (!pending_blocks_.empty()) {
+      DecodedBlock* block = pending_blocks_.front().get();
+      block->done.WaitForNotification();
+      TF_RETURN_IF_ERROR(block->status);
+      const int64 remaining = block->elements.size() - next_element_;
+      if (num_records < remaining) {
+        next_element_ += num_records;
+        return Status::OK();
+      }
+      num_records -= remaining;
+      pending_blocks_.pop_front();
+      next_element_ = 0;
+      continue;
+    }
+    if (next_block_ == index_->block_size()) {
+      return errors::OutOfRange("No more blocks in snapshot file ", filename_);
+    }
+    // Blocks that are skipped entirely are neither read nor decoded.
+    const int64 num_elements = index_->block(next_block_).num_elements();
+    if (num_records < num_elements) {
+      ScheduleBlocks();
+    } else {
+      num_records -= num_elements;
+      next_block_++;
+    }
+  }
+  ScheduleBlocks();
+  return Status::OK();
+}
+
+Status BlockReader::DecodeBlock(
+    const experimental::SnapshotBlockMetadata& metadata,
+    std::vector<std::vector<Tensor>>* elements) {
+  profiler::TraceMe activity(
+      [&]() { return absl::StrCat(kClassName, kSeparator, "DecodeBlock"); },
+      profiler::TraceMeLevel::kInfo);
+  const int64 num_elements = metadata.num_elements();
+  if (metadata.column_size() != dtypes_.size()) {
+    return errors::DataLoss("Expected ", dtypes_.size(),
+                            " components per element but found ",
+                            metadata.column_size(), ".");
+  }
+  auto compressed_scratch =
+      absl::make_unique<char[]>(metadata.compressed_size_bytes());
+  StringPiece compressed;
+  TF_RETURN_IF_ERROR(file_->Read(metadata.offset(),
+                                 metadata.compressed_size_bytes(), &compressed,
+                                 compressed_scratch.get()));
+  if (compressed.size() != metadata.compressed_size_bytes()) {
+    return errors::DataLoss("Could not read block at offset ",
+                            metadata.offset(), " of ", filename_);
+  }
+
+  // Prepares the destination buffers. Memcpy-able components with a uniform
+  // shape are decompressed into a single batch tensor, other memcpy-able
+  // components into per-element tensors, and the remaining components into
+  // buffers holding serialized `TensorProto`s.
+  std::vector<Tensor> batches(dtypes_.size());
+  std::vector<std::vector<Tensor>> tensors(dtypes_.size());
+  std::vector<std::vector<std::string>> protos(dtypes_.size());
+  std::vector<struct iovec> iov;
+  int64 total_size = 0;
+  auto add_iov = [&iov, &total_size](char* base, size_t size) {
+    iov.push_back({base, size});
+    total_size += size;
+  };
+  for (int i = 0, num_columns = dtypes_.size(); i < num_columns; ++i) {
+    const experimental::SnapshotColumnMetadata& column = metadata.column(i);
+    if (column.tensor_metadata_size() != num_elements) {
+      return errors::DataLoss("Expected ", num_elements, " tensors but found ",
+                              column.tensor_metadata_size(), ".");
+    }
+    if (simple_tensor_mask_[i] && column.uniform_shape() && num_elements > 0) {
+      TensorShape shape({num_elements});
+      shape.AppendShape(TensorShape(column.tensor_metadata(0).tensor_shape()));
+      batches[i] = Tensor(dtypes_[i], shape);
+      StringPiece data = batches[i].tensor_data();
+      add_iov(const_cast<char*>(data.data()), data.size());
+    } else if (simple_tensor_mask_[i]) {
+      tensors[i].reserve(num_elements);
+      for (const auto& tensor_metadata : column.tensor_metadata()) {
+        tensors[i].emplace_back(dtypes_[i],
+                                TensorShape(tensor_metadata.tensor_shape()));
+        StringPiece data = tensors[i].back().tensor_data();
+        add_iov(const_cast<char*>(data.data()), data.size());
+      }
+    } else {
+      protos[i].reserve(num_elements);
+      for (const auto& tensor_metadata : column.tensor_metadata()) {
+        protos[i].emplace_back(tensor_metadata.tensor_size_bytes(), '\0');
+        add_iov(&protos[i].back()[0], protos[i].back().size());
+      }
+    }
+  }
+  if (total_size != metadata.uncompressed_size_bytes()) {
+    return errors::DataLoss("Uncompressed size mismatch. The block metadata "
+                            "expects ",
+                            metadata.uncompressed_size_bytes(),
+                            " bytes whereas the tensor metadata suggests ",
+                            total_size);
+  }
+
+  if (compression_type_ == io::compression::kSnappy) {
+    size_t size;
+    if (!port::Snappy_GetUncompressedLength(compressed.data(),
+                                            compressed.size(), &size) ||
+        size != total_size) {
+      return errors::DataLoss("Snappy uncompressed length mismatch.");
+    }
+    if (!port::Snappy_UncompressToIOVec(compressed.data(), compressed.size(),
+                                        iov.data(), iov.size())) {
+      return errors::Internal("Failed to perform snappy decompression.");
+    }
+  } else {
+    if (compressed.size() != total_size) {
+      return errors::DataLoss("Block size mismatch.");
+    }
+    const char* position = compressed.data();
+    for (const auto& entry : iov) {
+      memcpy(entry.iov_base, position, entry.iov_len);
+      position += entry.iov_len;
+    }
+  }
+
+  elements->resize(num_elements);
+  for (auto& element : *elements) {
+    element.reserve(dtypes_.size());
+  }
+  for (int i = 0, num_columns = dtypes_.size(); i < num_columns; ++i) {
+    for (int64 j = 0; j < num_elements; ++j) {
+      if (batches[i].IsInitialized()) {
+        // Slicing shares the batch buffer. Slices that do not satisfy the
+        // alignment requirement are copied.
+        Tensor slice = batches[i].SubSlice(j);
+        if (slice.IsAligned()) {
+          (*elements)[j].push_back(std::move(slice));
+        } else {
+          Tensor copy(slice.dtype(), slice.shape());
+          memcpy(const_cast<char*>(copy.tensor_data().data()),
+                 slice.tensor_data().data(), slice.tensor_data().size());
+          (*elements)[j].push_back(std::move(copy));
+        }
+      } else if (simple_tensor_mask_[i]) {
+        (*elements)[j].push_back(std::move(tensors[i][j]));
+      } else {
+        TensorProto proto;
+        if (!proto.ParseFromArray(protos[i][j].data(), protos[i][j].size())) {
+          return errors::DataLoss("Could not parse TensorProto");
+        }
+        Tensor tensor;
+        if (!tensor.FromProto(proto)) {
+          return errors::DataLoss("Could not parse Tensor");
+        }
+        (*elements)[j].push_back(std::move(tensor));
+      }
+    }
+  }
+  return Status::OK();
+}
+
 Status WriteMetadataFile(Env* env, const string& dir,
                          const experimental::SnapshotMetadataRecord* metadata) {
   string metadata_filename = io::JoinPath(dir, kMetadataFilename);
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_SNAPSHOT_UTIL_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_SNAPSHOT_UTIL_H_
 
+#include <deque>
+
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
@@ -25,8 +27,10 @@ limitations under the License.
 #include "tensorflow/core/lib/io/record_writer.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 
@@ -36,6 +40,8 @@ namespace data {
 
 namespace experimental {
 
+class SnapshotBlockIndex;
+class SnapshotBlockMetadata;
 class SnapshotMetadataRecord;
 class SnapshotTensorMetadata;
 
@@ -163,6 +169,56 @@ class CustomWriter : public Writer {
   int num_complex_ = 0;
 };
 
+// Writes snapshots with a block file format (version 3).
+//
+// Elements are buffered into large blocks. Within a block, the tensors of each
+// component are stored next to each other (column grouping), and each block is
+// compressed as a whole. The file ends with a `SnapshotBlockIndex` describing
+// all blocks, followed by a footer holding the offset of the index, so that
+// readers can preallocate outputs and decode blocks in parallel.
+class BlockWriter : public Writer {
+ public:
+  // A block is written out once its uncompressed size reaches this size.
+  static constexpr const int64 kTargetBlockSizeBytes = 16 << 20;  // 16 MiB
+  // A block is written out once it holds this many elements.
+  static constexpr const int64 kMaxBlockElements = 1024;
+  static constexpr const size_t kFooterSize = 2 * sizeof(uint64);
+  static constexpr const uint64 kFooterMagic = 0x7464736e61706233ull;
+
+  static constexpr const char* const kClassName = "SnapshotBlockWriter";
+  static constexpr const char* const kSeparator = "::";
+
+  BlockWriter(const std::string& filename, const std::string& compression_type,
+              const DataTypeVector& dtypes);
+
+  Status WriteTensors(const std::vector<Tensor>& tensors) override;
+
+  Status Sync() override;
+
+  Status Close() override;
+
+  ~BlockWriter() override;
+
+ protected:
+  Status Initialize(tensorflow::Env* env) override;
+
+ private:
+  // Compresses and writes out the buffered elements as a single block.
+  Status FlushBlock();
+
+  std::unique_ptr<WritableFile> dest_;
+  const std::string filename_;
+  const std::string compression_type_;
+  const DataTypeVector dtypes_;
+  std::vector<bool> simple_tensor_mask_;  // true for simple, false for complex.
+  // Buffered tensors of the current block, grouped by component.
+  std::vector<std::vector<Tensor>> columns_;
+  int64 num_buffered_elements_ = 0;
+  int64 num_buffered_bytes_ = 0;
+  int64 offset_ = 0;
+  std::unique_ptr<experimental::SnapshotBlockIndex> index_;
+};
+
 // Interface class for reading snapshot files previous written with Writer.
 class Reader {
  public:
@@ -280,6 +336,66 @@ class CustomReader : public Reader {
   std::vector<bool> simple_tensor_mask_;  // true for simple, false for complex.
 };
 
+// Reads snapshots previously written with `BlockWriter`.
+//
+// Blocks are read and decoded ahead of the consumer on a private thread pool.
+// Components with memcpy-able dtypes and a uniform shape within a block are
+// decompressed directly into a single batch tensor, which is then sliced into
+// the per-element tensors without copying.
+class BlockReader : public Reader {
+ public:
+  // Maximum number of blocks that are decoded ahead of the consumer.
+  static constexpr const int kMaxParallelBlocks = 8;
+
+  static constexpr const char* const kClassName = "SnapshotBlockReader";
+  static constexpr const char* const kSeparator = "::";
+
+  BlockReader(const std::string& filename, const string& compression_type,
+              const DataTypeVector& dtypes);
+
+  Status ReadTensors(std::vector<Tensor>* read_tensors) override;
+
+  // Skips whole blocks without reading or decoding them when possible.
+  Status SkipRecords(int64 num_records) override;
+
+  ~BlockReader() override;
+
+ protected:
+  Status Initialize(Env* env) override;
+
+ private:
+  // The decoded elements of a block.
+  struct DecodedBlock {
+    Notification done;
+    Status status;
+    std::vector<std::vector<Tensor>> elements;
+  };
+
+  // Schedules decoding of the next blocks until `kMaxParallelBlocks` blocks
+  // are pending or all blocks have been scheduled.
+  void ScheduleBlocks();
+
+  // Reads and decodes the block described by `metadata`.
+  Status DecodeBlock(const experimental::SnapshotBlockMetadata& metadata,
+                     std::vector<std::vector<Tensor>>* elements);
+
+  const std::string filename_;
+  const string compression_type_;
+  const DataTypeVector dtypes_;
+  std::vector<bool> simple_tensor_mask_;  // true for simple, false for complex.
+  std::unique_ptr<RandomAccessFile> file_;
+  std::unique_ptr<experimental::SnapshotBlockIndex> index_;
+  int num_parallel_blocks_ = 1;
+  int64 next_block_ = 0;
+  // Index of the next element to return from the front pending block.
+  int64 next_element_ = 0;
+  std::deque<std::shared_ptr<DecodedBlock>> pending_blocks_;
+
+  // This has to be last so that pending decodes finish before the members
+  // they use are destroyed.
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+};
+
 // Writes snapshot metadata to the given directory.
 Status WriteMetadataFile(Env* env, const string& dir,
                          const experimental::SnapshotMetadataRecord* metadata);
@@ -89,6 +89,98 @@ TEST(SnapshotUtilTest, CombinationRoundTripTest) {
   SnapshotRoundTrip(io::compression::kNone, 2);
   SnapshotRoundTrip(io::compression::kGzip, 2);
   SnapshotRoundTrip(io::compression::kSnappy, 2);
+
+  SnapshotRoundTrip(io::compression::kNone, 3);
+  SnapshotRoundTrip(io::compression::kSnappy, 3);
+}
+
+// Writes `num_elements` elements with a fixed-shape, a variable-shape and a
+// string component and returns the written elements.
+std::vector<std::vector<Tensor>> WriteMixedElements(
+    const std::string& filename, const std::string& compression_type,
+    int num_elements) {
+  DataTypeVector dtypes = {DT_FLOAT, DT_INT64, DT_STRING};
+  std::vector<std::vector<Tensor>> elements;
+  std::unique_ptr<Writer> writer;
+  TF_CHECK_OK(Writer::Create(Env::Default(), filename, compression_type,
+                             /*version=*/3, dtypes, &writer));
+  for (int i = 0; i < num_elements; ++i) {
+    Tensor fixed(DT_FLOAT, TensorShape({16}));
+    fixed.flat<float>().setConstant(i);
+    Tensor variable(DT_INT64, TensorShape({i % 5}));
+    variable.flat<int64>().setConstant(i);
+    Tensor str(tstring(strings::StrCat("element_", i)));
+    elements.push_back({fixed, variable, str});
+    TF_CHECK_OK(writer->WriteTensors(elements.back()));
+  }
+  TF_CHECK_OK(writer->Close());
+  return elements;
+}
+
+void ExpectEqualElements(const std::vector<Tensor>& expected,
+                         const std::vector<Tensor>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].DebugString(/*num_values=*/16),
+              actual[i].DebugString(/*num_values=*/16));
+  }
+}
+
+TEST(SnapshotUtilTest, BlockFormatMixedComponents) {
+  for (const auto& compression_type :
+       {io::compression::kNone, io::compression::kSnappy}) {
+    std::string filename;
+    EXPECT_TRUE(Env::Default()->LocalTempFilename(&filename));
+    // Spans several blocks, including a partial last block.
+    const int num_elements = 2 * BlockWriter::kMaxBlockElements + 7;
+    auto elements =
+        WriteMixedElements(filename, compression_type, num_elements);
+
+    std::unique_ptr<Reader> reader;
+    TF_ASSERT_OK(Reader::Create(Env::Default(), filename, compression_type,
+                                /*version=*/3, {DT_FLOAT, DT_INT64, DT_STRING},
+                                &reader));
+    std::vector<Tensor> previous_tensors;
+    for (int i = 0; i < num_elements; ++i) {
+      std::vector<Tensor> read_tensors;
+      TF_ASSERT_OK(reader->ReadTensors(&read_tensors));
+      ExpectEqualElements(elements[i], read_tensors);
+      // The aligned fixed-shape component of elements in the same block is
+      // sliced from a single batch tensor.
+      if (i % BlockWriter::kMaxBlockElements != 0) {
+        EXPECT_TRUE(read_tensors[0].SharesBufferWith(previous_tensors[0]));
+      }
+      previous_tensors = std::move(read_tensors);
+    }
+    std::vector<Tensor> read_tensors;
+    EXPECT_TRUE(errors::IsOutOfRange(reader->ReadTensors(&read_tensors)));
+    TF_ASSERT_OK(Env::Default()->DeleteFile(filename));
+  }
+}
+
+TEST(SnapshotUtilTest, BlockFormatSkipRecords) {
+  std::string filename;
+  EXPECT_TRUE(Env::Default()->LocalTempFilename(&filename));
+  const int num_elements = 3 * BlockWriter::kMaxBlockElements;
+  auto elements =
+      WriteMixedElements(filename, io::compression::kSnappy, num_elements);
+
+  std::unique_ptr<Reader> reader;
+  TF_ASSERT_OK(Reader::Create(Env::Default(), filename,
+                              io::compression::kSnappy, /*version=*/3,
+                              {DT_FLOAT, DT_INT64, DT_STRING}, &reader));
+  int index = 0;
+  for (int64 num_skipped :
+       {int64{3}, BlockWriter::kMaxBlockElements + 11, int64{0}, int64{17}}) {
+    TF_ASSERT_OK(reader->SkipRecords(num_skipped));
+    index += num_skipped;
+    std::vector<Tensor> read_tensors;
+    TF_ASSERT_OK(reader->ReadTensors(&read_tensors));
+    ExpectEqualElements(elements[index], read_tensors);
+    index++;
+  }
+  EXPECT_TRUE(errors::IsOutOfRange(reader->SkipRecords(num_elements)));
+  TF_ASSERT_OK(Env::Default()->DeleteFile(filename));
 }
 
 void SnapshotReaderBenchmarkLoop(int iters, std::string compression_type,
@@ -145,11 +237,21 @@ void SnapshotTFRecordReaderGzipBenchmark(int iters) {
   SnapshotReaderBenchmarkLoop(iters, io::compression::kGzip, 2);
 }
 
+void SnapshotBlockReaderNoneBenchmark(int iters) {
+  SnapshotReaderBenchmarkLoop(iters, io::compression::kNone, 3);
+}
+
+void SnapshotBlockReaderSnappyBenchmark(int iters) {
+  SnapshotReaderBenchmarkLoop(iters, io::compression::kSnappy, 3);
+}
+
 BENCHMARK(SnapshotCustomReaderNoneBenchmark);
 BENCHMARK(SnapshotCustomReaderGzipBenchmark);
 BENCHMARK(SnapshotCustomReaderSnappyBenchmark);
 BENCHMARK(SnapshotTFRecordReaderNoneBenchmark);
 BENCHMARK(SnapshotTFRecordReaderGzipBenchmark);
+BENCHMARK(SnapshotBlockReaderNoneBenchmark);
+BENCHMARK(SnapshotBlockReaderSnappyBenchmark);
 
 void SnapshotWriterBenchmarkLoop(int iters, std::string compression_type,
                                  int version) {
@@ -200,12 +302,22 @@ void SnapshotTFRecordWriterSnappyBenchmark(int iters) {
   SnapshotWriterBenchmarkLoop(iters, io::compression::kSnappy, 2);
 }
 
+void SnapshotBlockWriterNoneBenchmark(int iters) {
+  SnapshotWriterBenchmarkLoop(iters, io::compression::kNone, 3);
+}
+
+void SnapshotBlockWriterSnappyBenchmark(int iters) {
+  SnapshotWriterBenchmarkLoop(iters, io::compression::kSnappy, 3);
+}
+
 BENCHMARK(SnapshotCustomWriterNoneBenchmark);
 BENCHMARK(SnapshotCustomWriterGzipBenchmark);
 BENCHMARK(SnapshotCustomWriterSnappyBenchmark);
 BENCHMARK(SnapshotTFRecordWriterNoneBenchmark);
 BENCHMARK(SnapshotTFRecordWriterGzipBenchmark);
 BENCHMARK(SnapshotTFRecordWriterSnappyBenchmark);
+BENCHMARK(SnapshotBlockWriterNoneBenchmark);
+BENCHMARK(SnapshotBlockWriterSnappyBenchmark);
 
 }  // namespace
 }  // namespace snapshot_util
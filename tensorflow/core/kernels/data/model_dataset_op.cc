@@ -37,6 +37,18 @@ constexpr int64 kOptimizationPeriodThresholdMs = 60 * EnvTime::kSecondsToMillis;
 // Default share of available RAM that can be used by model's internal buffers.
 constexpr double kRamBudgetShare = 0.5;
 
+string AlgorithmName(model::AutotuneAlgorithm algorithm) {
+  switch (algorithm) {
+    case model::AutotuneAlgorithm::HILL_CLIMB:
+      return "hill climb";
+    case model::AutotuneAlgorithm::GRADIENT_DESCENT:
+      return "gradient descent";
+    case model::AutotuneAlgorithm::MEMORY_AWARE:
+      return "memory aware";
+  }
+  return "unknown";
+}
+
 }  // namespace
 
 /* static */ constexpr const char* const ModelDatasetOp::kAlgorithm;
@@ -54,9 +66,7 @@ class ModelDatasetOp::Dataset : public DatasetBase {
         cpu_budget_(cpu_budget),
         ram_budget_(ram_budget),
         traceme_metadata_(
-            {{"algorithm", algorithm == model::AutotuneAlgorithm::HILL_CLIMB
-                               ? "hill climb"
-                               : "gradient descent"},
+            {{"algorithm", AlgorithmName(algorithm)},
              {"cpu_budget",
               strings::Printf("%lld", static_cast<long long>(cpu_budget))},
              {"ram_budget",
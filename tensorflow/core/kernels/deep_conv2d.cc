@@ -936,9 +936,17 @@ namespace functor {
 template <typename T>
 struct DeepConv2D<CPUDevice, T> {
   void operator()(OpKernelContext* ctx, const Conv2DArgs& args, const T* input,
-                  const T* filter, T* output) {
-    // TODO(andydavis) Add function to select transform based on conv params.
-    std::unique_ptr<DeepConv2DTransform<T>> transform(new WinogradTransform<T>);
+                  const T* filter, T* output,
+                  DeepConv2DTransformType transform_type) {
+    std::unique_ptr<DeepConv2DTransform<T>> transform;
+    switch (transform_type) {
+      case DeepConv2DTransformType::kWinograd2x2:
+        transform.reset(new WinogradTransform<T>);
+        break;
+      case DeepConv2DTransformType::kWinograd4x4:
+        transform.reset(new Winograd4x4Transform<T>);
+        break;
+    }
 
     const int64 in_depth = args.in_depth;
     const int64 out_depth = args.out_depth;
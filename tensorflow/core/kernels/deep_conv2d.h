@@ -94,6 +94,13 @@ struct Conv2DArgs {
         out_depth(0) {}
 };
 
+// Transforms DeepConv2D can use for 3x3 filters. Larger output tiles need
+// fewer element-wise products per output, but larger tile transforms.
+enum class DeepConv2DTransformType {
+  kWinograd2x2,  // Winograd F(2x2, 3x3), 4x4 input tiles.
+  kWinograd4x4,  // Winograd F(4x4, 3x3), 6x6 input tiles.
+};
+
 // Returns true if convolution operation specified by function arguments
 // can use DeepConv2D implementation, and false otherwise.
 // May return false based on parameters, cost, or whether feature is disabled.
@@ -107,7 +114,9 @@ namespace functor {
 template <typename Device, typename T>
 struct DeepConv2D {
   void operator()(OpKernelContext* ctx, const Conv2DArgs& args, const T* input,
-                  const T* filter, T* output);
+                  const T* filter, T* output,
+                  DeepConv2DTransformType transform_type =
+                      DeepConv2DTransformType::kWinograd2x2);
 };
 
 }  // namespace functor
@@ -155,5 +155,159 @@ TEST(DeepConv2DTransformTest, WingradOutputTransformMatrix) {
   }
 }
 
+TEST(DeepConv2DTransformTest, Winograd4x4FilterTransformMatrix) {
+  // Test that the filter transform matrix returned is the kronecker product of
+  // the following matrix with itself:
+  //
+  //   [ 1/4    0     0   ]
+  //   [-1/6  -1/6  -1/6  ]
+  //   [-1/6   1/6  -1/6  ]
+  //   [ 1/24  1/12  1/6  ]
+  //   [ 1/24 -1/12  1/6  ]
+  //   [ 0      0     1   ]
+  //
+  const int rows = 6;
+  const int cols = 3;
+
+  float transform_matrix[] = {
+      1.0 / 4,  0,         0,         //
+      -1.0 / 6, -1.0 / 6,  -1.0 / 6,  //
+      -1.0 / 6, 1.0 / 6,   -1.0 / 6,  //
+      1.0 / 24, 1.0 / 12,  1.0 / 6,   //
+      1.0 / 24, -1.0 / 12, 1.0 / 6,   //
+      0,        0,         1,         //
+  };
+
+  const int kron_rows = rows * rows;
+  const int kron_cols = cols * cols;
+
+  float transform_matrix_kron[kron_rows * kron_cols];
+
+  ComputeKroneckerProduct(rows, cols, &transform_matrix[0],
+                          &transform_matrix_kron[0]);
+
+  float transform_matrix_test[kron_rows * kron_cols];
+  Winograd4x4Transform<float> t;
+  t.GetFilterTransformMatrix(kron_rows, kron_cols, &transform_matrix_test[0]);
+
+  for (int i = 0; i < kron_rows * kron_cols; ++i) {
+    EXPECT_FLOAT_EQ(transform_matrix_kron[i], transform_matrix_test[i]);
+  }
+}
+
+TEST(DeepConv2DTransformTest, Winograd4x4InputTransformMatrix) {
+  // Test that the input transform matrix returned is the kronecker product of
+  // the following matrix with itself:
+  //
+  //   [4   0  -5   0   1   0]
+  //   [0  -4  -4   1   1   0]
+  //   [0   4  -4  -1   1   0]
+  //   [0  -2  -1   2   1   0]
+  //   [0   2  -1  -2   1   0]
+  //   [0   4   0  -5   0   1]
+  //
+  const int rows = 6;
+  const int cols = 6;
+
+  float transform_matrix[] = {4, 0,  -5, 0,  1, 0, 0, -4, -4, 1,  1, 0,
+                              0, 4,  -4, -1, 1, 0, 0, -2, -1, 2,  1, 0,
+                              0, 2,  -1, -2, 1, 0, 0, 4,  0,  -5, 0, 1};
+
+  const int kron_rows = rows * rows;
+  const int kron_cols = cols * cols;
+
+  float transform_matrix_kron[kron_rows * kron_cols];
+
+  ComputeKroneckerProduct(rows, cols, &transform_matrix[0],
+                          &transform_matrix_kron[0]);
+
+  float transform_matrix_test[kron_rows * kron_cols];
+  Winograd4x4Transform<float> t;
+  t.GetInputTransformMatrix(kron_rows, kron_cols, &transform_matrix_test[0]);
+
+  for (int i = 0; i < kron_rows * kron_cols; ++i) {
+    EXPECT_FLOAT_EQ(transform_matrix_kron[i], transform_matrix_test[i]);
+  }
+}
+
+TEST(DeepConv2DTransformTest, Winograd4x4OutputTransformMatrix) {
+  // Test that the output transform matrix returned is the kronecker product of
+  // the following matrix with itself:
+  //
+  //   [1  1  1  1  1  0]
+  //   [0  1 -1  2 -2  0]
+  //   [0  1  1  4  4  0]
+  //   [0  1 -1  8 -8  1]
+  //
+  const int rows = 4;
+  const int cols = 6;
+
+  float transform_matrix[] = {1, 1, 1,  1, 1,  0, 0, 1, -1, 2, -2, 0,
+                              0, 1, 1,  4, 4,  0, 0, 1, -1, 8, -8, 1};
+
+  const int kron_rows = rows * rows;
+  const int kron_cols = cols * cols;
+
+  float transform_matrix_kron[kron_rows * kron_cols];
+
+  ComputeKroneckerProduct(rows, cols, &transform_matrix[0],
+                          &transform_matrix_kron[0]);
+
+  float transform_matrix_test[kron_rows * kron_cols];
+  Winograd4x4Transform<float> t;
+  t.GetOutputTransformMatrix(kron_rows, kron_cols, &transform_matrix_test[0]);
+
+  for (int i = 0; i < kron_rows * kron_cols; ++i) {
+    EXPECT_FLOAT_EQ(transform_matrix_kron[i], transform_matrix_test[i]);
+  }
+}
+
+TEST(DeepConv2DTransformTest, Winograd4x4ComputesCorrelation) {
+  // Test that transforming a 6x6 input tile and a 3x3 filter, multiplying them
+  // element-wise and transforming the product gives the 4x4 correlation of the
+  // tile with the filter.
+  Winograd4x4Transform<float> t;
+  float filter_transform[36 * 9];
+  float input_transform[36 * 36];
+  float output_transform[16 * 36];
+  t.GetFilterTransformMatrix(36, 9, filter_transform);
+  t.GetInputTransformMatrix(36, 36, input_transform);
+  t.GetOutputTransformMatrix(16, 36, output_transform);
+
+  float tile[36];
+  for (int i = 0; i < 36; ++i) tile[i] = (i * 7 % 11) - 5;
+  float filter[9];
+  for (int i = 0; i < 9; ++i) filter[i] = (i * 5 % 7) - 3;
+
+  float product[36];
+  for (int i = 0; i < 36; ++i) {
+    float transformed_filter = 0;
+    for (int j = 0; j < 9; ++j) {
+      transformed_filter += filter_transform[i * 9 + j] * filter[j];
+    }
+    float transformed_tile = 0;
+    for (int j = 0; j < 36; ++j) {
+      transformed_tile += input_transform[i * 36 + j] * tile[j];
+    }
+    product[i] = transformed_filter * transformed_tile;
+  }
+
+  for (int r = 0; r < 4; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      float output = 0;
+      for (int j = 0; j < 36; ++j) {
+        output += output_transform[(r * 4 + c) * 36 + j] * product[j];
+      }
+      float expected = 0;
+      for (int fr = 0; fr < 3; ++fr) {
+        for (int fc = 0; fc < 3; ++fc) {
+          expected += tile[(r + fr) * 6 + c + fc] * filter[fr * 3 + fc];
+        }
+      }
+      EXPECT_NEAR(expected, output, 1e-3);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -0,0 +1,146 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#define USE_EIGEN_TENSOR
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/kernels/direct_conv2d.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/direct_conv2d_tile.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+// DirectConv2D computes every output pixel as the sum, over the filter window,
+// of input pixels times filter taps, without materializing im2col patches:
+//
+// *) Filters are repacked into blocks of 'kOutDepthBlock' output channels:
+//
+//      [out_depth_blocks, filter_rows, filter_cols, in_depth, kOutDepthBlock]
+//
+//    zero padding the last block. This is the channel-blocked ("NCHWc")
+//    filter layout, applied to the output channels of a NHWC convolution so
+//    that input and output tensors keep their layout.
+// *) Output pixels are computed in [kOutColBlock, kOutDepthBlock] register
+//    tiles (see direct_conv2d_tile.h), shared with _BlockedConv2D.
+// *) Work is sharded across (batch, out_row) output rows.
+
+using direct_conv2d::kMaxInDepth;
+using direct_conv2d::kOutColBlock;
+using direct_conv2d::kOutDepthBlock;
+
+bool CanUseDirectConv2D(const Conv2DDimensions& dimensions) {
+  // Grouped convolutions are not supported.
+  return dimensions.in_depth == dimensions.patch_depth &&
+         dimensions.in_depth <= kMaxInDepth;
+}
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+namespace functor {
+
+template <typename T>
+struct DirectConv2D<CPUDevice, T> {
+  void operator()(OpKernelContext* ctx, const Conv2DDimensions& dimensions,
+                  const T* input, const T* filter, T* output) {
+    const int64 out_rows = dimensions.out_rows;
+    const int64 out_cols = dimensions.out_cols;
+    const int64 out_depth = dimensions.out_depth;
+    const int64 out_depth_blocks =
+        (out_depth + kOutDepthBlock - 1) / kOutDepthBlock;
+    const int64 filter_block_size = static_cast<int64>(dimensions.filter_rows) *
+                                    dimensions.filter_cols *
+                                    dimensions.in_depth * kOutDepthBlock;
+
+    // Allocate and fill the packed filter buffer.
+    Tensor packed_filter_tensor;
+    OP_REQUIRES_OK(ctx, ctx->allocate_temp(
+                            DataTypeToEnum<T>::value,
+                            TensorShape({out_depth_blocks, filter_block_size}),
+                            &packed_filter_tensor));
+    T* packed_filter = packed_filter_tensor.template flat<T>().data();
+    direct_conv2d::PackFilter<T>(
+        filter,
+        static_cast<int64>(dimensions.filter_rows) * dimensions.filter_cols *
+            dimensions.in_depth,
+        out_depth, packed_filter);
+
+    direct_conv2d::TileGeometry geo;
+    geo.filter_rows = dimensions.filter_rows;
+    geo.filter_cols = dimensions.filter_cols;
+    geo.in_depth = dimensions.in_depth;
+    geo.stride_rows = dimensions.stride_rows;
+    geo.stride_cols = dimensions.stride_cols;
+    geo.dilation_rows = dimensions.dilation_rows;
+    geo.dilation_cols = dimensions.dilation_cols;
+    geo.input_rows = dimensions.input_rows;
+    geo.input_cols = dimensions.input_cols;
+    geo.pad_rows = dimensions.pad_rows_before;
+    geo.pad_cols = dimensions.pad_cols_before;
+    geo.channel_block = dimensions.in_depth;
+    geo.plane_size = 0;
+
+    const int64 input_image_size = static_cast<int64>(dimensions.input_rows) *
+                                   dimensions.input_cols * dimensions.in_depth;
+
+    auto shard = [&geo, input, output, packed_filter, out_rows, out_cols,
+                  out_depth, out_depth_blocks, filter_block_size,
+                  input_image_size](int64 start, int64 limit) {
+      for (int64 row = start; row < limit; ++row) {
+        const int64 b = row / out_rows;
+        const int64 out_r = row % out_rows;
+        const T* in_image = input + b * input_image_size;
+        T* out_row = output + row * out_cols * out_depth;
+
+        for (int64 out_c = 0; out_c < out_cols; out_c += kOutColBlock) {
+          const int64 num_cols =
+              std::min<int64>(kOutColBlock, out_cols - out_c);
+
+          for (int64 ob = 0; ob < out_depth_blocks; ++ob) {
+            T acc[kOutColBlock][kOutDepthBlock] = {};
+            direct_conv2d::ComputeOutputTile<T>(
+                geo, in_image, packed_filter + ob * filter_block_size, out_r,
+                out_c, num_cols, acc);
+
+            // Store the output channels of this block, dropping the padding
+            // of the last block.
+            const int64 od_base = ob * kOutDepthBlock;
+            const int64 num_channels =
+                std::min<int64>(kOutDepthBlock, out_depth - od_base);
+            for (int64 j = 0; j < num_cols; ++j) {
+              T* out_pixel = out_row + (out_c + j) * out_depth + od_base;
+              std::copy_n(acc[j], num_channels, out_pixel);
+            }
+          }
+        }
+      }
+    };
+
+    auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
+    const int64 shard_cost = out_cols * out_depth_blocks * filter_block_size;
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          dimensions.batch * out_rows, shard_cost, shard);
+  }
+};
+
+}  // namespace functor
+
+template struct functor::DirectConv2D<CPUDevice, float>;
+
+}  // namespace tensorflow
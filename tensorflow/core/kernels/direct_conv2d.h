@@ -0,0 +1,48 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_DIRECT_CONV2D_H_
+#define TENSORFLOW_CORE_KERNELS_DIRECT_CONV2D_H_
+
+#include "tensorflow/core/kernels/conv_ops.h"
+
+namespace tensorflow {
+
+class OpKernelContext;
+
+// DirectConv2D is a Conv2D implementation specialized for convolutions with
+// few input channels (see direct_conv2d.cc for details), where the im2col
+// patches built for a GEMM-based convolution are too thin to amortize their
+// construction.
+
+// Returns true if the convolution specified by 'dimensions' can use the
+// DirectConv2D implementation, and false otherwise.
+bool CanUseDirectConv2D(const Conv2DDimensions& dimensions);
+
+namespace functor {
+
+// Computes a NHWC Conv2D of 'input' with the HWIO 'filter' directly, writing
+// the NHWC result to 'output' (see direct_conv2d.cc for details).
+template <typename Device, typename T>
+struct DirectConv2D {
+  void operator()(OpKernelContext* ctx, const Conv2DDimensions& dimensions,
+                  const T* input, const T* filter, T* output);
+};
+
+}  // namespace functor
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DIRECT_CONV2D_H_
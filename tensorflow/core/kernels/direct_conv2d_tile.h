@@ -0,0 +1,158 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_DIRECT_CONV2D_TILE_H_
+#define TENSORFLOW_CORE_KERNELS_DIRECT_CONV2D_TILE_H_
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace direct_conv2d {
+
+// Register tile shared by the direct convolutions (DirectConv2D on NHWC
+// tensors, _BlockedConv2D on the blocked CPU layout): 'kOutColBlock' adjacent
+// output pixels of one output row are computed together for a block of
+// 'kOutDepthBlock' output channels, so the innermost loops update a
+// [kOutColBlock, kOutDepthBlock] accumulator tile that fits in vector
+// registers, and each filter tap is loaded once per tile.
+constexpr int kOutDepthBlock = 8;
+constexpr int kOutColBlock = 4;
+
+// Convolutions with deeper inputs have im2col patches deep enough for the
+// GEMM based implementations to be faster, so the direct convolutions are only
+// used up to this input depth.
+constexpr int64 kMaxInDepth = 64;
+
+// Geometry of a direct convolution. The input channels of an image are stored
+// in planes of 'channel_block' channels: channel d of the input pixel (r, c)
+// is at
+//
+//   (d / channel_block) * plane_size + (r * input_cols + c) * channel_block +
+//   d % channel_block
+//
+// A NHWC image is a single plane with channel_block == in_depth.
+struct TileGeometry {
+  int64 filter_rows;
+  int64 filter_cols;
+  int64 in_depth;
+  int64 stride_rows;
+  int64 stride_cols;
+  int64 dilation_rows;
+  int64 dilation_cols;
+  int64 input_rows;
+  int64 input_cols;
+  int64 pad_rows;
+  int64 pad_cols;
+
+  int64 channel_block;
+  int64 plane_size;
+};
+
+// Copies the HWIO 'filter' with 'num_taps' = filter_rows * filter_cols *
+// in_depth rows of 'out_depth' channels to 'packed_filter' [out_depth_blocks,
+// filter_rows, filter_cols, in_depth, kOutDepthBlock], zero padding the last
+// block.
+template <typename T>
+void PackFilter(const T* filter, int64 num_taps, int64 out_depth,
+                T* packed_filter) {
+  const int64 out_depth_blocks =
+      (out_depth + kOutDepthBlock - 1) / kOutDepthBlock;
+  for (int64 ob = 0; ob < out_depth_blocks; ++ob) {
+    T* block = packed_filter + ob * num_taps * kOutDepthBlock;
+    for (int64 tap = 0; tap < num_taps; ++tap) {
+      for (int64 k = 0; k < kOutDepthBlock; ++k) {
+        const int64 od = ob * kOutDepthBlock + k;
+        block[tap * kOutDepthBlock + k] =
+            od < out_depth ? filter[tap * out_depth + od] : T(0);
+      }
+    }
+  }
+}
+
+// Accumulates into 'acc' the outputs for 'num_cols' output pixels starting at
+// (out_r, out_c) of the image 'in_image', and the output channels of the
+// packed filter block 'filter_block'.
+template <typename T>
+void ComputeOutputTile(const TileGeometry& geo, const T* in_image,
+                       const T* filter_block, const int64 out_r,
+                       const int64 out_c, const int64 num_cols,
+                       T acc[kOutColBlock][kOutDepthBlock]) {
+  const int64 in_r_base = out_r * geo.stride_rows - geo.pad_rows;
+  const int64 in_c_base = out_c * geo.stride_cols - geo.pad_cols;
+
+  for (int64 fr = 0; fr < geo.filter_rows; ++fr) {
+    const int64 in_r = in_r_base + fr * geo.dilation_rows;
+    if (in_r < 0 || in_r >= geo.input_rows) continue;
+
+    for (int64 fc = 0; fc < geo.filter_cols; ++fc) {
+      const T* taps = filter_block + (fr * geo.filter_cols + fc) *
+                                         geo.in_depth * kOutDepthBlock;
+      // Offsets of the input pixels of the tile in a plane, or -1 for the
+      // columns that read padding.
+      int64 in_offsets[kOutColBlock];
+      int num_valid = 0;
+      for (int j = 0; j < kOutColBlock; ++j) {
+        const int64 in_c =
+            in_c_base + j * geo.stride_cols + fc * geo.dilation_cols;
+        if (j < num_cols && in_c >= 0 && in_c < geo.input_cols) {
+          in_offsets[j] = (in_r * geo.input_cols + in_c) * geo.channel_block;
+          ++num_valid;
+        } else {
+          in_offsets[j] = -1;
+        }
+      }
+
+      const T* in_plane = in_image;
+      for (int64 d_base = 0; d_base < geo.in_depth;
+           d_base += geo.channel_block, in_plane += geo.plane_size) {
+        const int64 num_lanes =
+            std::min(geo.channel_block, geo.in_depth - d_base);
+        const T* plane_taps = taps + d_base * kOutDepthBlock;
+        if (num_valid == kOutColBlock) {
+          // Interior tile: all columns read valid input pixels.
+          for (int64 d = 0; d < num_lanes; ++d) {
+            const T* w = plane_taps + d * kOutDepthBlock;
+            for (int j = 0; j < kOutColBlock; ++j) {
+              const T x = in_plane[in_offsets[j] + d];
+              for (int k = 0; k < kOutDepthBlock; ++k) {
+                acc[j][k] += x * w[k];
+              }
+            }
+          }
+        } else {
+          // Boundary tile: skip the columns that read padding.
+          for (int j = 0; j < kOutColBlock; ++j) {
+            if (in_offsets[j] < 0) continue;
+            const T* in_pixel = in_plane + in_offsets[j];
+            for (int64 d = 0; d < num_lanes; ++d) {
+              const T* w = plane_taps + d * kOutDepthBlock;
+              const T x = in_pixel[d];
+              for (int k = 0; k < kOutDepthBlock; ++k) {
+                acc[j][k] += x * w[k];
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace direct_conv2d
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DIRECT_CONV2D_TILE_H_
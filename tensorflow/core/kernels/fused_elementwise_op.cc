@@ -0,0 +1,385 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/math_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+// _FusedElementwise interprets its program one tile of the flattened output at
+// a time: every op evaluates a whole tile with Eigen array expressions, which
+// are vectorized, and its result stays in a tile sized buffer in cache for the
+// ops reading it. Compared with one kernel per op, the intermediate tensors
+// are never written to memory, and the output is written once.
+
+namespace {
+
+// Number of output elements evaluated at once. The tile buffers of all inputs
+// and ops of a typical program fit in the L1 or L2 cache.
+constexpr int64 kTileSize = 512;
+
+enum class ElementwiseOp {
+  // Unary ops.
+  kAbs,
+  kCeil,
+  kElu,
+  kExp,
+  kFloor,
+  kLog,
+  kNeg,
+  kReciprocal,
+  kRelu,
+  kRelu6,
+  kRsqrt,
+  kSigmoid,
+  kSqrt,
+  kSquare,
+  kTanh,
+  // Binary ops.
+  kAdd,
+  kDiv,
+  kMaximum,
+  kMinimum,
+  kMul,
+  kSquaredDifference,
+  kSub,
+};
+
+bool IsBinary(ElementwiseOp op) { return op >= ElementwiseOp::kAdd; }
+
+Status ParseElementwiseOp(const string& name, ElementwiseOp* op) {
+  static const auto* ops = new std::unordered_map<string, ElementwiseOp>{
+      {"Abs", ElementwiseOp::kAbs},
+      {"Ceil", ElementwiseOp::kCeil},
+      {"Elu", ElementwiseOp::kElu},
+      {"Exp", ElementwiseOp::kExp},
+      {"Floor", ElementwiseOp::kFloor},
+      {"Log", ElementwiseOp::kLog},
+      {"Neg", ElementwiseOp::kNeg},
+      {"Reciprocal", ElementwiseOp::kReciprocal},
+      {"Relu", ElementwiseOp::kRelu},
+      {"Relu6", ElementwiseOp::kRelu6},
+      {"Rsqrt", ElementwiseOp::kRsqrt},
+      {"Sigmoid", ElementwiseOp::kSigmoid},
+      {"Sqrt", ElementwiseOp::kSqrt},
+      {"Square", ElementwiseOp::kSquare},
+      {"Tanh", ElementwiseOp::kTanh},
+      {"Add", ElementwiseOp::kAdd},
+      {"AddV2", ElementwiseOp::kAdd},
+      {"Div", ElementwiseOp::kDiv},
+      {"RealDiv", ElementwiseOp::kDiv},
+      {"Maximum", ElementwiseOp::kMaximum},
+      {"Minimum", ElementwiseOp::kMinimum},
+      {"Mul", ElementwiseOp::kMul},
+      {"SquaredDifference", ElementwiseOp::kSquaredDifference},
+      {"Sub", ElementwiseOp::kSub},
+  };
+  auto it = ops->find(name);
+  if (it == ops->end()) {
+    return errors::InvalidArgument("Unsupported element-wise op: ", name);
+  }
+  *op = it->second;
+  return Status::OK();
+}
+
+// Returns the approximate cost in cycles of 'op' on one element.
+template <typename T>
+int Cost(ElementwiseOp op) {
+  switch (op) {
+    case ElementwiseOp::kElu:
+    case ElementwiseOp::kExp:
+    case ElementwiseOp::kLog:
+    case ElementwiseOp::kSigmoid:
+    case ElementwiseOp::kTanh:
+      return Eigen::internal::functor_traits<
+          Eigen::internal::scalar_exp_op<T>>::Cost;
+    case ElementwiseOp::kDiv:
+    case ElementwiseOp::kReciprocal:
+    case ElementwiseOp::kRsqrt:
+    case ElementwiseOp::kSqrt:
+      return Eigen::TensorOpCost::DivCost<T>();
+    case ElementwiseOp::kMul:
+    case ElementwiseOp::kSquare:
+    case ElementwiseOp::kSquaredDifference:
+      return Eigen::TensorOpCost::MulCost<T>();
+    default:
+      return Eigen::TensorOpCost::AddCost<T>();
+  }
+}
+
+// An op of the program, reading operands 'lhs' and 'rhs' (-1 for unary ops).
+struct Instruction {
+  ElementwiseOp op;
+  int lhs;
+  int rhs;
+};
+
+// Evaluates 'instruction' on 'size' elements into 'result', which may alias
+// an operand.
+template <typename T>
+void Evaluate(const Instruction& instruction, const T* lhs, const T* rhs,
+              int64 size, T* result) {
+  using Array = Eigen::Array<T, Eigen::Dynamic, 1>;
+  const Eigen::Map<const Array> x(lhs, size);
+  Eigen::Map<Array> y(result, size);
+  if (IsBinary(instruction.op)) {
+    const Eigen::Map<const Array> z(rhs, size);
+    switch (instruction.op) {
+      case ElementwiseOp::kAdd:
+        y = x + z;
+        break;
+      case ElementwiseOp::kDiv:
+        y = x / z;
+        break;
+      case ElementwiseOp::kMaximum:
+        y = x.max(z);
+        break;
+      case ElementwiseOp::kMinimum:
+        y = x.min(z);
+        break;
+      case ElementwiseOp::kMul:
+        y = x * z;
+        break;
+      case ElementwiseOp::kSquaredDifference:
+        y = (x - z).square();
+        break;
+      default:
+        y = x - z;
+    }
+    return;
+  }
+  switch (instruction.op) {
+    case ElementwiseOp::kAbs:
+      y = x.abs();
+      break;
+    case ElementwiseOp::kCeil:
+      y = x.ceil();
+      break;
+    case ElementwiseOp::kElu:
+      y = (x < T(0)).select(x.exp() - T(1), x);
+      break;
+    case ElementwiseOp::kExp:
+      y = x.exp();
+      break;
+    case ElementwiseOp::kFloor:
+      y = x.floor();
+      break;
+    case ElementwiseOp::kLog:
+      y = x.log();
+      break;
+    case ElementwiseOp::kNeg:
+      y = -x;
+      break;
+    case ElementwiseOp::kReciprocal:
+      y = x.inverse();
+      break;
+    case ElementwiseOp::kRelu:
+      y = x.max(T(0));
+      break;
+    case ElementwiseOp::kRelu6:
+      y = x.max(T(0)).min(T(6));
+      break;
+    case ElementwiseOp::kRsqrt:
+      y = x.rsqrt();
+      break;
+    case ElementwiseOp::kSigmoid:
+      y = x.unaryExpr(Eigen::internal::scalar_logistic_op<T>());
+      break;
+    case ElementwiseOp::kSqrt:
+      y = x.sqrt();
+      break;
+    case ElementwiseOp::kSquare:
+      y = x.square();
+      break;
+    default:
+      y = x.tanh();
+  }
+}
+
+}  // namespace
+
+template <typename T>
+class FusedElementwiseOp : public OpKernel {
+ public:
+  explicit FusedElementwiseOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    std::vector<string> ops;
+    std::vector<int32> operands;
+    OP_REQUIRES_OK(context, context->GetAttr("ops", &ops));
+    OP_REQUIRES_OK(context, context->GetAttr("operands", &operands));
+    OP_REQUIRES(context, operands.size() == 2 * ops.size(),
+                errors::InvalidArgument("_FusedElementwise must have two "
+                                        "operands per op, got ",
+                                        operands.size(), " operands for ",
+                                        ops.size(), " ops"));
+    const int num_inputs = context->num_inputs();
+    for (int i = 0; i < ops.size(); ++i) {
+      Instruction instruction;
+      OP_REQUIRES_OK(context, ParseElementwiseOp(ops[i], &instruction.op));
+      instruction.lhs = operands[2 * i];
+      instruction.rhs = operands[2 * i + 1];
+      const int num_values = num_inputs + i;
+      const bool valid_rhs =
+          IsBinary(instruction.op)
+              ? instruction.rhs >= 0 && instruction.rhs < num_values
+              : instruction.rhs == -1;
+      OP_REQUIRES(
+          context,
+          instruction.lhs >= 0 && instruction.lhs < num_values && valid_rhs,
+          errors::InvalidArgument("Invalid operands ", instruction.lhs, " and ",
+                                  instruction.rhs, " of op ", i, " (", ops[i],
+                                  ")"));
+      instructions_.push_back(instruction);
+      cost_ += Cost<T>(instruction.op);
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const int num_inputs = context->num_inputs();
+    // The output has the shape of the largest input.
+    int largest = 0;
+    for (int k = 1; k < num_inputs; ++k) {
+      const Tensor& input = context->input(k);
+      const Tensor& current = context->input(largest);
+      if (input.NumElements() > current.NumElements() ||
+          (input.NumElements() == current.NumElements() &&
+           input.dims() > current.dims())) {
+        largest = k;
+      }
+    }
+    const TensorShape shape = context->input(largest).shape();
+    const int64 num_elements = shape.num_elements();
+
+    // Input k repeats along the flattened output with period periods[k].
+    std::vector<int64> periods(num_inputs);
+    std::vector<int> full_inputs;
+    for (int k = 0; k < num_inputs; ++k) {
+      const Tensor& input = context->input(k);
+      if (input.shape() == shape) {
+        periods[k] = num_elements;
+        full_inputs.push_back(k);
+        continue;
+      }
+      periods[k] = input.NumElements();
+      // Leading dimensions of size 1 do not change the period.
+      int leading_ones = 0;
+      while (leading_ones < input.dims() &&
+             input.dim_size(leading_ones) == 1) {
+        ++leading_ones;
+      }
+      const int suffix_dims = input.dims() - leading_ones;
+      bool is_suffix = suffix_dims <= shape.dims();
+      for (int d = 1; is_suffix && d <= suffix_dims; ++d) {
+        is_suffix = input.dim_size(input.dims() - d) ==
+                    shape.dim_size(shape.dims() - d);
+      }
+      OP_REQUIRES(
+          context, is_suffix && periods[k] > 0,
+          errors::InvalidArgument("Input ", k, " of shape ",
+                                  input.shape().DebugString(),
+                                  " cannot be broadcast to the output shape ",
+                                  shape.DebugString()));
+    }
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->forward_input_or_allocate_output(
+                                full_inputs, 0, shape, &output));
+    if (num_elements == 0) return;
+
+    std::vector<const T*> inputs(num_inputs);
+    for (int k = 0; k < num_inputs; ++k) {
+      inputs[k] = context->input(k).flat<T>().data();
+    }
+    T* out = output->flat<T>().data();
+    const int num_instructions = instructions_.size();
+
+    auto compute = [&](int64 begin, int64 end) {
+      // Tile buffers of the broadcast inputs and of the intermediate results.
+      std::vector<T> buffers((num_inputs + num_instructions) * kTileSize);
+      const auto buffer = [&buffers](int value) {
+        return buffers.data() + value * kTileSize;
+      };
+      std::vector<const T*> values(num_inputs + num_instructions);
+      for (int k = 0; k < num_inputs; ++k) {
+        if (periods[k] == 1) std::fill_n(buffer(k), kTileSize, inputs[k][0]);
+      }
+
+      for (int64 tile = begin; tile < end; tile += kTileSize) {
+        const int64 size = std::min(kTileSize, end - tile);
+        for (int k = 0; k < num_inputs; ++k) {
+          if (periods[k] == num_elements) {
+            values[k] = inputs[k] + tile;
+          } else if (periods[k] == 1) {
+            values[k] = buffer(k);
+          } else {
+            T* tile_buffer = buffer(k);
+            int64 offset = tile % periods[k];
+            for (int64 i = 0; i < size;) {
+              const int64 length = std::min(size - i, periods[k] - offset);
+              std::copy_n(inputs[k] + offset, length, tile_buffer + i);
+              i += length;
+              offset = 0;
+            }
+            values[k] = tile_buffer;
+          }
+        }
+        for (int j = 0; j < num_instructions; ++j) {
+          const Instruction& instruction = instructions_[j];
+          T* result = j == num_instructions - 1 ? out + tile
+                                                : buffer(num_inputs + j);
+          Evaluate<T>(instruction, values[instruction.lhs],
+                      instruction.rhs < 0 ? nullptr : values[instruction.rhs],
+                      size, result);
+          values[num_inputs + j] = result;
+        }
+      }
+    };
+
+    const CPUDevice& device = context->eigen_device<CPUDevice>();
+    const Eigen::TensorOpCost cost(
+        /*bytes_loaded=*/sizeof(T) * num_inputs,
+        /*bytes_stored=*/sizeof(T), cost_);
+    device.parallelFor(num_elements, cost, std::move(compute));
+  }
+
+ private:
+  std::vector<Instruction> instructions_;
+  int cost_ = 0;
+};
+
+#define REGISTER_CPU(T)                                                      \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("_FusedElementwise").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      FusedElementwiseOp<T>);
+
+TF_CALL_float(REGISTER_CPU);
+TF_CALL_double(REGISTER_CPU);
+
+#undef REGISTER_CPU
+
+}  // namespace tensorflow
@@ -0,0 +1,201 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedElementwiseOpTest : public OpsTestBase {
+ protected:
+  template <typename T>
+  Status InitFusedOp(int num_inputs, const std::vector<string>& ops,
+                     const std::vector<int>& operands) {
+    TF_RETURN_IF_ERROR(
+        NodeDefBuilder("fused_elementwise", "_FusedElementwise")
+            .Input(FakeInput(num_inputs, DataTypeToEnum<T>::v()))
+            .Attr("T", DataTypeToEnum<T>::v())
+            .Attr("ops", ops)
+            .Attr("operands", operands)
+            .Finalize(node_def()));
+    return InitOp();
+  }
+
+  // Runs y = Tanh(x * scale + bias) * x, where scale is a scalar and bias has
+  // the shape 'bias_shape', and compares y with the unfused computation.
+  template <typename T>
+  void RunTanhProgram(const TensorShape& x_shape,
+                      const TensorShape& bias_shape) {
+    TF_ASSERT_OK(InitFusedOp<T>(3, {"Mul", "Add", "Tanh", "Mul"},
+                                {0, 1, 3, 2, 4, -1, 5, 0}));
+
+    const auto x = [](int64 i) { return static_cast<T>(std::sin(i * 0.1)); };
+    const auto bias = [](int64 i) { return static_cast<T>(0.01 * i - 2); };
+    const T scale = 0.75;
+    AddInput<T>(x_shape, x);
+    AddInputFromArray<T>(TensorShape({}), {scale});
+    AddInput<T>(bias_shape, bias);
+    TF_ASSERT_OK(RunOpKernel());
+
+    Tensor expected(DataTypeToEnum<T>::v(), x_shape);
+    const int64 period = bias_shape.num_elements();
+    for (int64 i = 0; i < x_shape.num_elements(); ++i) {
+      expected.flat<T>()(i) = std::tanh(x(i) * scale + bias(i % period)) * x(i);
+    }
+    test::ExpectClose(expected, *GetOutput(0));
+  }
+};
+
+TEST_F(FusedElementwiseOpTest, TanhProgram_F) {
+  RunTanhProgram<float>(TensorShape({3, 500, 7}), TensorShape({500, 7}));
+}
+
+TEST_F(FusedElementwiseOpTest, TanhProgram_D) {
+  RunTanhProgram<double>(TensorShape({3, 500, 7}), TensorShape({500, 7}));
+}
+
+TEST_F(FusedElementwiseOpTest, TanhProgramWithLeadingOnes) {
+  RunTanhProgram<float>(TensorShape({40, 7}), TensorShape({1, 1, 7}));
+}
+
+TEST_F(FusedElementwiseOpTest, TanhProgramWithSameShapes) {
+  RunTanhProgram<float>(TensorShape({1000}), TensorShape({1000}));
+}
+
+TEST_F(FusedElementwiseOpTest, UnaryAndBinaryOps) {
+  // y = Relu6(Square(Sqrt(a)) - b) + Maximum(Exp(b), Sigmoid(a)) / a
+  TF_ASSERT_OK(InitFusedOp<float>(
+      2, {"Sqrt", "Square", "Sub", "Relu6", "Exp", "Sigmoid", "Maximum",
+          "RealDiv", "AddV2"},
+      {0, -1, 2, -1, 3, 1, 4, -1, 1, -1, 0, -1, 6, 7, 8, 0, 5, 9}));
+  AddInputFromArray<float>(TensorShape({4}), {1.0f, 4.0f, 9.0f, 16.0f});
+  AddInputFromArray<float>(TensorShape({4}), {-8.0f, 2.0f, 3.0f, 0.5f});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(DT_FLOAT, TensorShape({4}));
+  const float a[] = {1.0f, 4.0f, 9.0f, 16.0f};
+  const float b[] = {-8.0f, 2.0f, 3.0f, 0.5f};
+  for (int i = 0; i < 4; ++i) {
+    const float sigmoid = 1.0f / (1.0f + std::exp(-a[i]));
+    expected.flat<float>()(i) =
+        std::min(std::max(a[i] - b[i], 0.0f), 6.0f) +
+        std::max(std::exp(b[i]), sigmoid) / a[i];
+  }
+  test::ExpectClose(expected, *GetOutput(0));
+}
+
+TEST_F(FusedElementwiseOpTest, RejectsNonBroadcastableInputs) {
+  TF_ASSERT_OK(InitFusedOp<float>(2, {"Add"}, {0, 1}));
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<float>(TensorShape({2}), {1, 2});
+  const Status status = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+}
+
+TEST_F(FusedElementwiseOpTest, RejectsInvalidProgram) {
+  // Op 0 cannot read its own result.
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(InitFusedOp<float>(1, {"Add"}, {0, 1})));
+  // Unary ops have no second operand.
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(InitFusedOp<float>(1, {"Tanh"}, {0, 0})));
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(InitFusedOp<float>(1, {"Sin"}, {0, -1})));
+}
+
+// Performance benchmarks below.
+
+// y = Tanh(x * scale + bias) * x, as separate nodes or as one fused node.
+static Graph* TanhProgram(int rows, int cols, bool fused) {
+  Graph* g = new Graph(OpRegistry::Global());
+
+  Tensor x(DT_FLOAT, TensorShape({rows, cols}));
+  x.flat<float>().setRandom();
+  Tensor scale(DT_FLOAT, TensorShape({}));
+  scale.scalar<float>()() = 0.75f;
+  Tensor bias(DT_FLOAT, TensorShape({cols}));
+  bias.flat<float>().setRandom();
+
+  Node* x_node = test::graph::Constant(g, x);
+  Node* scale_node = test::graph::Constant(g, scale);
+  Node* bias_node = test::graph::Constant(g, bias);
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_FusedElementwise")
+                    .Input(std::vector<NodeBuilder::NodeOut>{
+                        x_node, scale_node, bias_node})
+                    .Attr("T", DT_FLOAT)
+                    .Attr("ops", {"Mul", "AddV2", "Tanh", "Mul"})
+                    .Attr("operands", {0, 1, 3, 2, 4, -1, 5, 0})
+                    .Finalize(g, nullptr));
+    return g;
+  }
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "Mul")
+                  .Input(x_node)
+                  .Input(scale_node)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "AddV2")
+                  .Input(node)
+                  .Input(bias_node)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "Tanh")
+                  .Input(node)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "Mul")
+                  .Input(node)
+                  .Input(x_node)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, nullptr));
+  return g;
+}
+
+#define BM_TanhProgram(R, C, FUSED, type)                                 \
+  static void BM_TanhProgram##_##type##_##R##_##C##_##FUSED(              \
+      ::testing::benchmark::State& state) {                               \
+    test::Benchmark(#type, TanhProgram(R, C, FUSED),                      \
+                    /*old_benchmark_api*/ false)                          \
+        .Run(state);                                                      \
+    state.SetItemsProcessed(static_cast<int64>(state.iterations()) * R *  \
+                            C);                                           \
+  }                                                                       \
+  BENCHMARK(BM_TanhProgram##_##type##_##R##_##C##_##FUSED);
+
+// BenchmarkName(rows, cols, fused, type)
+
+BM_TanhProgram(32, 1024, false, cpu);
+BM_TanhProgram(32, 1024, true, cpu);
+
+BM_TanhProgram(256, 1024, false, cpu);
+BM_TanhProgram(256, 1024, true, cpu);
+
+BM_TanhProgram(2048, 1024, false, cpu);
+BM_TanhProgram(2048, 1024, true, cpu);
+
+}  // namespace
+}  // end namespace tensorflow
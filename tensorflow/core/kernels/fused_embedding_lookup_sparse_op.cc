@@ -0,0 +1,346 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/resource_variable_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include <cmath>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/resource_var.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/kernels/parallel_sparse_update.h"
+#include "tensorflow/core/kernels/training_op_helpers.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/prefetch.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+namespace {
+
+enum class Combiner { kSum, kMean, kSqrtN };
+
+Status GetCombiner(OpKernelConstruction* c, Combiner* combiner) {
+  string combiner_name;
+  TF_RETURN_IF_ERROR(c->GetAttr("combiner", &combiner_name));
+  if (combiner_name == "sum") {
+    *combiner = Combiner::kSum;
+  } else if (combiner_name == "mean") {
+    *combiner = Combiner::kMean;
+  } else if (combiner_name == "sqrtn") {
+    *combiner = Combiner::kSqrtN;
+  } else {
+    return errors::InvalidArgument("Unknown combiner: ", combiner_name);
+  }
+  return Status::OK();
+}
+
+// The number of ids ahead of the current one whose rows are prefetched.
+constexpr int64 kPrefetchDistance = 4;
+
+// Validates the sparse inputs shared by the forward and gradient ops, and
+// computes the start of each segment in `segment_ids`, followed by the number
+// of ids. The segment ids must be sorted.
+template <typename Tsegmentids>
+Status ComputeSegmentStarts(const Tensor& ids, const Tensor& weights,
+                            const Tensor& segment_ids,
+                            std::vector<int64>* segment_starts) {
+  if (!TensorShapeUtils::IsVector(ids.shape())) {
+    return errors::InvalidArgument("ids should be a vector, got shape ",
+                                   ids.shape().DebugString());
+  }
+  if (!TensorShapeUtils::IsVector(segment_ids.shape()) ||
+      segment_ids.NumElements() != ids.NumElements()) {
+    return errors::InvalidArgument(
+        "segment_ids should be a vector of the size of ids, got shapes ",
+        segment_ids.shape().DebugString(), " and ", ids.shape().DebugString());
+  }
+  if (!TensorShapeUtils::IsVector(weights.shape()) ||
+      (weights.NumElements() != 0 &&
+       weights.NumElements() != ids.NumElements())) {
+    return errors::InvalidArgument(
+        "weights should be empty or a vector of the size of ids, got shapes ",
+        weights.shape().DebugString(), " and ", ids.shape().DebugString());
+  }
+
+  segment_starts->clear();
+  auto segment_vec = segment_ids.vec<Tsegmentids>();
+  const int64 N = segment_vec.size();
+  Tsegmentids previous = 0;
+  for (int64 k = 0; k < N; ++k) {
+    const Tsegmentids segment = internal::SubtleMustCopy(segment_vec(k));
+    if (segment < 0) {
+      return errors::InvalidArgument("segment ids must be >= 0, got ",
+                                     segment, " at offset ", k);
+    }
+    if (segment < previous) {
+      return errors::InvalidArgument("segment ids are not increasing: ",
+                                     segment_vec(k), " at offset ", k);
+    }
+    // Start the empty segments before this one and this one at `k`.
+    while (static_cast<int64>(segment_starts->size()) <= segment) {
+      segment_starts->push_back(k);
+    }
+    previous = segment;
+  }
+  segment_starts->push_back(N);
+  return Status::OK();
+}
+
+// Returns the factor by which the weighted sum of the segment of ids
+// [begin, end) is multiplied.
+template <typename T>
+T SegmentScale(Combiner combiner, typename TTypes<T>::ConstVec weights,
+               int64 begin, int64 end) {
+  if (combiner == Combiner::kSum || begin == end) return T(1);
+  T sum = 0;
+  for (int64 k = begin; k < end; ++k) {
+    const T w = weights.size() == 0 ? T(1) : weights(k);
+    sum += combiner == Combiner::kMean ? w : w * w;
+  }
+  return combiner == Combiner::kMean ? T(1) / sum : T(1) / std::sqrt(sum);
+}
+
+}  // namespace
+
+// Combines the rows of an embedding variable selected by `ids` within each
+// segment, without materializing the gathered rows. Segments are processed in
+// parallel blocks, and each output row is accumulated in cache while the rows
+// of the next ids are prefetched.
+template <typename T, typename Tindices, typename Tsegmentids>
+class FusedEmbeddingLookupSparseOp : public OpKernel {
+ public:
+  explicit FusedEmbeddingLookupSparseOp(OpKernelConstruction* c)
+      : OpKernel(c) {
+    OP_REQUIRES_OK(c, GetCombiner(c, &combiner_));
+  }
+
+  void Compute(OpKernelContext* c) override {
+    const Tensor& ids = c->input(1);
+    const Tensor& weights = c->input(2);
+    const Tensor& segment_ids = c->input(3);
+    std::vector<int64> segment_starts;
+    OP_REQUIRES_OK(c, ComputeSegmentStarts<Tsegmentids>(
+                          ids, weights, segment_ids, &segment_starts));
+
+    core::RefCountPtr<Var> v;
+    OP_REQUIRES_OK(c, LookupResource(c, HandleFromInput(c, 0), &v));
+    if (const ReadMostlyTensor* published = v->read_mostly_tensor()) {
+      ReadMostlyTensor::Reader reader(*published);
+      Lookup(c, reader.tensor(), segment_starts);
+      return;
+    }
+    OP_REQUIRES_OK(c, EnsureSparseVariableAccess<CPUDevice, T>(c, v.get()));
+    // Hold the lock for the whole lookup, as ResourceGather does, so that
+    // writes to the variable do not copy it.
+    tf_shared_lock ml(*v->mu());
+    Lookup(c, *v->tensor(), segment_starts);
+  }
+
+ private:
+  void Lookup(OpKernelContext* c, const Tensor& params,
+              const std::vector<int64>& segment_starts) {
+    const Tensor& ids = c->input(1);
+    const Tensor& weights = c->input(2);
+    const int64 num_segments = segment_starts.size() - 1;
+    OP_REQUIRES(c, params.dtype() == DataTypeToEnum<T>::v(),
+                errors::InvalidArgument(
+                    "Trying to read variable with wrong dtype. Expected ",
+                    DataTypeString(DataTypeToEnum<T>::v()), " got ",
+                    DataTypeString(params.dtype())));
+    OP_REQUIRES(
+        c, TensorShapeUtils::IsVectorOrHigher(params.shape()),
+        errors::InvalidArgument("params must be at least 1 dimensional"));
+
+    TensorShape output_shape = params.shape();
+    output_shape.set_dim(0, num_segments);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(c, c->allocate_output(0, output_shape, &output));
+    if (output->NumElements() == 0) return;
+
+    auto params_flat = params.flat_outer_dims<T>();
+    auto ids_vec = ids.vec<Tindices>();
+    auto weights_vec = weights.vec<T>();
+    const int64 num_rows = params_flat.dimension(0);
+    const int64 N = ids_vec.size();
+    std::vector<Tindices> rows(N);
+    for (int64 k = 0; k < N; ++k) {
+      rows[k] = internal::SubtleMustCopy(ids_vec(k));
+      OP_REQUIRES(c, FastBoundsCheck(rows[k], num_rows),
+                  errors::InvalidArgument("ids[", k, "] = ", rows[k],
+                                          " is not in [0, ", num_rows, ")"));
+    }
+
+    auto output_flat = output->flat_outer_dims<T>();
+    const int64 dim = output_flat.dimension(1);
+    const auto combine = [&](int64 begin, int64 limit) {
+      for (int64 s = begin; s < limit; ++s) {
+        auto out = output_flat.template chip<0>(s);
+        out.setZero();
+        const int64 start = segment_starts[s];
+        const int64 end = segment_starts[s + 1];
+        for (int64 k = start; k < end; ++k) {
+          if (k + kPrefetchDistance < end) {
+            port::prefetch<port::PREFETCH_HINT_T0>(
+                &params_flat(rows[k + kPrefetchDistance], 0));
+          }
+          auto row = params_flat.template chip<0>(rows[k]);
+          if (weights_vec.size() == 0) {
+            out += row;
+          } else {
+            out += row * weights_vec(k);
+          }
+        }
+        const T scale = SegmentScale<T>(combiner_, weights_vec, start, end);
+        if (scale != T(1)) {
+          out = out * scale;
+        }
+      }
+    };
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *c->device()->tensorflow_cpu_worker_threads();
+    const int64 cost_per_segment = (N / num_segments + 1) * dim * 4;
+    Shard(worker_threads.num_threads, worker_threads.workers, num_segments,
+          cost_per_segment, combine);
+  }
+
+  Combiner combiner_;
+};
+
+// Computes the gradient of the rows of the variable at the unique ids. The
+// rows are accumulated in parallel, each by a single thread in the order of
+// the ids, so the result is deterministic.
+template <typename T, typename Tindices, typename Tsegmentids>
+class FusedEmbeddingLookupSparseGradOp : public OpKernel {
+ public:
+  explicit FusedEmbeddingLookupSparseGradOp(OpKernelConstruction* c)
+      : OpKernel(c) {
+    OP_REQUIRES_OK(c, GetCombiner(c, &combiner_));
+  }
+
+  void Compute(OpKernelContext* c) override {
+    const Tensor& grad = c->input(0);
+    const Tensor& ids = c->input(1);
+    const Tensor& weights = c->input(2);
+    const Tensor& segment_ids = c->input(3);
+    std::vector<int64> segment_starts;
+    OP_REQUIRES_OK(c, ComputeSegmentStarts<Tsegmentids>(
+                          ids, weights, segment_ids, &segment_starts));
+    const int64 num_segments = segment_starts.size() - 1;
+    OP_REQUIRES(
+        c, TensorShapeUtils::IsVectorOrHigher(grad.shape()),
+        errors::InvalidArgument("grad must be at least 1 dimensional"));
+    OP_REQUIRES(c, grad.dim_size(0) >= num_segments,
+                errors::InvalidArgument("grad has ", grad.dim_size(0),
+                                        " rows, but there are ", num_segments,
+                                        " segments"));
+
+    // Number the unique ids in order of first occurrence.
+    auto ids_vec = ids.vec<Tindices>();
+    const int64 N = ids_vec.size();
+    std::vector<int64> unique_offsets(N);
+    std::vector<Tindices> unique_ids;
+    absl::flat_hash_map<Tindices, int64> unique_offset_of_id;
+    unique_offset_of_id.reserve(N);
+    for (int64 k = 0; k < N; ++k) {
+      auto it = unique_offset_of_id.emplace(ids_vec(k), unique_ids.size());
+      if (it.second) unique_ids.push_back(ids_vec(k));
+      unique_offsets[k] = it.first->second;
+    }
+    const int64 num_unique = unique_ids.size();
+
+    Tensor* unique_ids_output = nullptr;
+    OP_REQUIRES_OK(c, c->allocate_output(0, TensorShape({num_unique}),
+                                         &unique_ids_output));
+    std::copy(unique_ids.begin(), unique_ids.end(),
+              unique_ids_output->vec<Tindices>().data());
+    TensorShape values_shape = grad.shape();
+    values_shape.set_dim(0, num_unique);
+    Tensor* values = nullptr;
+    OP_REQUIRES_OK(c, c->allocate_output(1, values_shape, &values));
+    if (values->NumElements() == 0) return;
+
+    auto weights_vec = weights.vec<T>();
+    // The factor of the gradient of the output row of each id.
+    std::vector<T> scales(N);
+    for (int64 s = 0; s < num_segments; ++s) {
+      const int64 start = segment_starts[s];
+      const int64 end = segment_starts[s + 1];
+      const T scale = SegmentScale<T>(combiner_, weights_vec, start, end);
+      for (int64 k = start; k < end; ++k) {
+        scales[k] = weights_vec.size() == 0 ? scale : scale * weights_vec(k);
+      }
+    }
+
+    auto grad_flat = grad.flat_outer_dims<T>();
+    auto values_flat = values->flat_outer_dims<T>();
+    values_flat.setZero();
+    auto segment_vec = segment_ids.vec<Tsegmentids>();
+    const auto update = [&](int64 k, int64 unique_offset) {
+      values_flat.template chip<0>(unique_offset) +=
+          grad_flat.template chip<0>(segment_vec(k)) * scales[k];
+    };
+    const Eigen::TensorOpCost cost(values_flat.dimension(1) * sizeof(T) * 2,
+                                   values_flat.dimension(1) * sizeof(T),
+                                   values_flat.dimension(1) * 2);
+    ParallelSparseUpdate<int64>(
+        c->eigen_device<CPUDevice>(),
+        TTypes<int64>::ConstFlat(unique_offsets.data(), N), num_unique, cost,
+        update);
+  }
+
+ private:
+  Combiner combiner_;
+};
+
+#define REGISTER_KERNELS(T, Tindices, Tsegmentids)                          \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("FusedEmbeddingLookupSparse")                                    \
+          .Device(DEVICE_CPU)                                               \
+          .TypeConstraint<T>("dtype")                                       \
+          .TypeConstraint<Tindices>("Tindices")                             \
+          .TypeConstraint<Tsegmentids>("Tsegmentids"),                      \
+      FusedEmbeddingLookupSparseOp<T, Tindices, Tsegmentids>);              \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("FusedEmbeddingLookupSparseGrad")                                \
+          .Device(DEVICE_CPU)                                               \
+          .TypeConstraint<T>("T")                                           \
+          .TypeConstraint<Tindices>("Tindices")                             \
+          .TypeConstraint<Tsegmentids>("Tsegmentids"),                      \
+      FusedEmbeddingLookupSparseGradOp<T, Tindices, Tsegmentids>);
+
+#define REGISTER_KERNELS_ALL_INDICES(T) \
+  REGISTER_KERNELS(T, int32, int32);    \
+  REGISTER_KERNELS(T, int32, int64);    \
+  REGISTER_KERNELS(T, int64, int32);    \
+  REGISTER_KERNELS(T, int64, int64);
+
+TF_CALL_float(REGISTER_KERNELS_ALL_INDICES);
+TF_CALL_double(REGISTER_KERNELS_ALL_INDICES);
+#undef REGISTER_KERNELS_ALL_INDICES
+#undef REGISTER_KERNELS
+
+}  // namespace tensorflow
@@ -0,0 +1,290 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/resource_var.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedEmbeddingLookupSparseOpTest : public OpsTestBase {
+ protected:
+  void MakeLookup(const string& combiner) {
+    TF_ASSERT_OK(NodeDefBuilder("lookup", "FusedEmbeddingLookupSparse")
+                     .Input(FakeInput(DT_RESOURCE))
+                     .Input(FakeInput(DT_INT64))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Attr("combiner", combiner)
+                     .Attr("dtype", DT_FLOAT)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  void AddParamsInput(const Tensor& params) {
+    Var* var = new Var(DT_FLOAT);
+    *var->tensor() = params;
+    var->is_initialized = true;
+    AddResourceInput("", "params", var);
+  }
+};
+
+// The 4x2 params used by the tests: row `i` is [i, 10 * i].
+Tensor Params() {
+  return test::AsTensor<float>({0, 0, 1, 10, 2, 20, 3, 30}, {4, 2});
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, Sum) {
+  MakeLookup("sum");
+  AddParamsInput(Params());
+  AddInputFromArray<int64>(TensorShape({4}), {1, 3, 3, 2});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 0, 2, 2});
+  TF_ASSERT_OK(RunOpKernel());
+  // Segment 1 has no ids.
+  test::ExpectTensorEqual<float>(
+      *GetOutput(0), test::AsTensor<float>({4, 40, 0, 0, 5, 50}, {3, 2}));
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, WeightedMean) {
+  MakeLookup("mean");
+  AddParamsInput(Params());
+  AddInputFromArray<int64>(TensorShape({3}), {1, 3, 2});
+  AddInputFromArray<float>(TensorShape({3}), {1, 3, 2});
+  AddInputFromArray<int32>(TensorShape({3}), {0, 0, 1});
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0), test::AsTensor<float>({2.5, 25, 2, 20}, {2, 2}), 1e-5);
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, SqrtN) {
+  MakeLookup("sqrtn");
+  AddParamsInput(Params());
+  AddInputFromArray<int64>(TensorShape({2}), {1, 3});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 0});
+  TF_ASSERT_OK(RunOpKernel());
+  const float s = std::sqrt(2.0f);
+  test::ExpectTensorNear<float>(
+      *GetOutput(0), test::AsTensor<float>({4 / s, 40 / s}, {1, 2}), 1e-5);
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, InvalidInputs) {
+  MakeLookup("sum");
+  AddParamsInput(Params());
+  AddInputFromArray<int64>(TensorShape({2}), {1, 4});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 0});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "ids[1] = 4")) << s;
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, UnsortedSegments) {
+  MakeLookup("sum");
+  AddParamsInput(Params());
+  AddInputFromArray<int64>(TensorShape({2}), {1, 2});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddInputFromArray<int32>(TensorShape({2}), {1, 0});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+class FusedEmbeddingLookupSparseGradOpTest : public OpsTestBase {
+ protected:
+  void MakeGrad(const string& combiner) {
+    TF_ASSERT_OK(NodeDefBuilder("grad", "FusedEmbeddingLookupSparseGrad")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT64))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Attr("combiner", combiner)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+TEST_F(FusedEmbeddingLookupSparseGradOpTest, WeightedMean) {
+  MakeGrad("mean");
+  AddInputFromArray<float>(TensorShape({2, 2}), {1, 2, 3, 4});
+  AddInputFromArray<int64>(TensorShape({4}), {3, 1, 3, 2});
+  AddInputFromArray<float>(TensorShape({4}), {1, 3, 2, 4});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 0, 1, 1});
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<int64>(*GetOutput(0),
+                                 test::AsTensor<int64>({3, 1, 2}));
+  // Row 3 gets 1/4 of the gradient of segment 0 and 2/6 of segment 1.
+  test::ExpectTensorNear<float>(
+      *GetOutput(1),
+      test::AsTensor<float>(
+          {0.25f + 1, 0.5f + 4.0f / 3, 0.75f, 1.5f, 2, 8.0f / 3}, {3, 2}),
+      1e-5);
+}
+
+// The sparse gradient has the same rows as the gradient of the unfused
+// lookup, computed as the dense gradient of each id.
+TEST_F(FusedEmbeddingLookupSparseGradOpTest, ManyDuplicates) {
+  const int kNumIds = 1000;
+  const int kNumSegments = 50;
+  const int kDim = 16;
+  MakeGrad("sqrtn");
+  std::vector<float> grad(kNumSegments * kDim);
+  for (size_t i = 0; i < grad.size(); ++i) {
+    grad[i] = std::sin(i);
+  }
+  std::vector<int64> ids(kNumIds);
+  std::vector<int32> segment_ids(kNumIds);
+  for (int k = 0; k < kNumIds; ++k) {
+    ids[k] = (k * 7) % 13;
+    segment_ids[k] = k * kNumSegments / kNumIds;
+  }
+  AddInputFromArray<float>(TensorShape({kNumSegments, kDim}), grad);
+  AddInputFromArray<int64>(TensorShape({kNumIds}), ids);
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddInputFromArray<int32>(TensorShape({kNumIds}), segment_ids);
+  TF_ASSERT_OK(RunOpKernel());
+
+  std::vector<float> expected(13 * kDim, 0.0f);
+  const float scale = 1 / std::sqrt(1.0f * kNumIds / kNumSegments);
+  for (int k = 0; k < kNumIds; ++k) {
+    for (int j = 0; j < kDim; ++j) {
+      expected[ids[k] * kDim + j] += grad[segment_ids[k] * kDim + j] * scale;
+    }
+  }
+  const auto unique_ids = GetOutput(0)->vec<int64>();
+  const auto values = GetOutput(1)->matrix<float>();
+  ASSERT_EQ(unique_ids.size(), 13);
+  for (int u = 0; u < 13; ++u) {
+    for (int j = 0; j < kDim; ++j) {
+      EXPECT_NEAR(values(u, j), expected[unique_ids(u) * kDim + j], 1e-4);
+    }
+  }
+}
+
+// Builds a graph initializing an embedding variable of `vocab_size` rows of
+// width `dim`, and a graph combining `num_ids` random ids of it into
+// `num_segments` means, with or without the fused op.
+void MakeEmbeddingLookupGraphs(int vocab_size, int dim, int num_ids,
+                               int num_segments, bool fused, Graph** init_g,
+                               Graph** lookup_g) {
+  const auto add_var = [&](Graph* g) {
+    Node* var;
+    TF_CHECK_OK(NodeBuilder(g->NewName("var"), "VarHandleOp")
+                    .Attr("dtype", DT_FLOAT)
+                    .Attr("shape", TensorShape({vocab_size, dim}))
+                    .Attr("shared_name", "embedding")
+                    .Finalize(g, &var));
+    return var;
+  };
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    Tensor params(DT_FLOAT, TensorShape({vocab_size, dim}));
+    params.flat<float>().setRandom();
+    Node* assign;
+    TF_CHECK_OK(NodeBuilder(g->NewName("assign"), "AssignVariableOp")
+                    .Input(add_var(g))
+                    .Input(test::graph::Constant(g, params))
+                    .Attr("dtype", DT_FLOAT)
+                    .Finalize(g, &assign));
+    *init_g = g;
+  }
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor ids(DT_INT64, TensorShape({num_ids}));
+  Tensor segment_ids(DT_INT32, TensorShape({num_ids}));
+  for (int k = 0; k < num_ids; ++k) {
+    ids.flat<int64>()(k) = rnd.Uniform(vocab_size);
+    segment_ids.flat<int32>()(k) =
+        static_cast<int64>(k) * num_segments / num_ids;
+  }
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* var = add_var(g);
+  Node* ids_node = test::graph::Constant(g, ids);
+  Node* segment_ids_node = test::graph::Constant(g, segment_ids);
+  Node* lookup;
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("lookup"), "FusedEmbeddingLookupSparse")
+                    .Input(var)
+                    .Input(ids_node)
+                    .Input(test::graph::Constant(g, Tensor(DT_FLOAT, {0})))
+                    .Input(segment_ids_node)
+                    .Attr("dtype", DT_FLOAT)
+                    .Attr("combiner", "mean")
+                    .Finalize(g, &lookup));
+  } else {
+    Node* unique;
+    TF_CHECK_OK(NodeBuilder(g->NewName("unique"), "Unique")
+                    .Input(ids_node)
+                    .Finalize(g, &unique));
+    Node* gather;
+    TF_CHECK_OK(NodeBuilder(g->NewName("gather"), "ResourceGather")
+                    .Input(var)
+                    .Input(unique, 0)
+                    .Attr("dtype", DT_FLOAT)
+                    .Finalize(g, &gather));
+    TF_CHECK_OK(NodeBuilder(g->NewName("lookup"), "SparseSegmentMean")
+                    .Input(gather)
+                    .Input(unique, 1)
+                    .Input(segment_ids_node)
+                    .Finalize(g, &lookup));
+  }
+  *lookup_g = g;
+}
+
+void BM_EmbeddingLookupSparse(::testing::benchmark::State& state) {
+  const int dim = state.range(0);
+  const bool fused = state.range(1);
+  const int kVocabSize = 1 << 20;
+  const int kNumIds = 1 << 16;
+  const int kNumSegments = 1 << 11;
+
+  Graph* init;
+  Graph* lookup;
+  MakeEmbeddingLookupGraphs(kVocabSize, dim, kNumIds, kNumSegments, fused,
+                            &init, &lookup);
+  test::Benchmark("cpu", lookup, /*options=*/nullptr, init, nullptr, "",
+                  /*old_benchmark_api*/ false)
+      .Run(state);
+  state.SetItemsProcessed(static_cast<int64>(state.iterations()) * kNumIds);
+  state.SetBytesProcessed(static_cast<int64>(state.iterations()) * kNumIds *
+                          dim * sizeof(float));
+}
+
+BENCHMARK(BM_EmbeddingLookupSparse)
+    ->UseRealTime()
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(64, 0)
+    ->ArgPair(64, 1)
+    ->ArgPair(256, 0)
+    ->ArgPair(256, 1);
+
+}  // namespace
+}  // namespace tensorflow
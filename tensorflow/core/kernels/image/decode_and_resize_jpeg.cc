@@ -0,0 +1,209 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/image/decode_and_resize_jpeg.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/image_resizer_state.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns the largest libjpeg scale denominator for which the decoded crop
+// window is still at least as large as the output.
+int ChooseRatio(int64 crop_height, int64 crop_width, int64 out_height,
+                int64 out_width) {
+  for (int ratio : {8, 4, 2}) {
+    if (crop_height / ratio >= out_height && crop_width / ratio >= out_width) {
+      return ratio;
+    }
+  }
+  return 1;
+}
+
+}  // namespace
+
+Status DecodeAndResizeJpegContext::Decode(StringPiece contents, int64 crop_y,
+                                          int64 crop_x, int64 crop_height,
+                                          int64 crop_width, int64 out_height,
+                                          int64 out_width) {
+  if (contents.size() > std::numeric_limits<int>::max()) {
+    return errors::InvalidArgument("JPEG contents are too large for int: ",
+                                   contents.size());
+  }
+  if (out_height <= 0 || out_width <= 0) {
+    return errors::InvalidArgument("output dimensions must be positive");
+  }
+
+  int image_width = 0;
+  int image_height = 0;
+  if (!jpeg::GetImageInfo(contents.data(), contents.size(), &image_width,
+                          &image_height, nullptr)) {
+    return errors::InvalidArgument("Invalid JPEG data, size ",
+                                   contents.size());
+  }
+  if (crop_height == 0 && crop_width == 0) {
+    crop_y = 0;
+    crop_x = 0;
+    crop_height = image_height;
+    crop_width = image_width;
+  }
+  if (crop_height <= 0 || crop_width <= 0 || crop_y < 0 || crop_x < 0 ||
+      crop_y + crop_height > image_height ||
+      crop_x + crop_width > image_width) {
+    return errors::InvalidArgument(
+        "Invalid crop window: y=", crop_y, ", x=", crop_x, ", h=", crop_height,
+        ", w=", crop_width, " for image of height ", image_height,
+        " and width ", image_width);
+  }
+
+  jpeg::UncompressFlags flags = options_.flags;
+  flags.ratio = ChooseRatio(crop_height, crop_width, out_height, out_width);
+
+  // libjpeg crops in the coordinates of the scaled image, whose dimensions
+  // are rounded up. Decode the smallest scaled window covering the crop.
+  const int ratio = flags.ratio;
+  const int64 scaled_height = (image_height + ratio - 1) / ratio;
+  const int64 scaled_width = (image_width + ratio - 1) / ratio;
+  const int64 decoded_y = crop_y / ratio;
+  const int64 decoded_x = crop_x / ratio;
+  const int64 decoded_height =
+      std::min((crop_y + crop_height + ratio - 1) / ratio, scaled_height) -
+      decoded_y;
+  const int64 decoded_width =
+      std::min((crop_x + crop_width + ratio - 1) / ratio, scaled_width) -
+      decoded_x;
+  if (decoded_height != scaled_height || decoded_width != scaled_width) {
+    flags.crop = true;
+    flags.crop_y = decoded_y;
+    flags.crop_x = decoded_x;
+    flags.crop_height = decoded_height;
+    flags.crop_width = decoded_width;
+  }
+
+  int64 height = 0;
+  int64 width = 0;
+  uint8* buffer = jpeg::Uncompress(
+      contents.data(), contents.size(), flags, nullptr /* nwarn */,
+      [&](int w, int h, int c) -> uint8* {
+        const int64 size = static_cast<int64>(w) * h * c;
+        if (size > buffer_size_) {
+          buffer_.reset(new uint8[size]);
+          buffer_size_ = size;
+        }
+        height = h;
+        width = w;
+        channels_ = c;
+        return buffer_.get();
+      });
+  if (buffer == nullptr) {
+    return errors::InvalidArgument(
+        "jpeg::Uncompress failed. Invalid JPEG data or crop window.");
+  }
+  decoded_row_size_ = width * channels_;
+
+  ComputeInterpolationWeights(out_height, crop_y, crop_height, ratio,
+                              decoded_y, height, &ys_);
+  ComputeInterpolationWeights(out_width, crop_x, crop_width, ratio, decoded_x,
+                              width, &xs_);
+  for (CachedInterpolation& x : xs_) {
+    x.lower *= channels_;
+    x.upper *= channels_;
+  }
+  return Status::OK();
+}
+
+// Computes the interpolation weights for `out_size` samples of the
+// `crop_size` pixels of the original image starting at `crop_start`. Those
+// pixels were decoded at 1/`ratio` scale into `decoded_size` pixels, starting
+// at pixel `decoded_start` of the scaled image.
+void DecodeAndResizeJpegContext::ComputeInterpolationWeights(
+    int64 out_size, int64 crop_start, int64 crop_size, int ratio,
+    int64 decoded_start, int64 decoded_size,
+    std::vector<CachedInterpolation>* weights) {
+  const float scale =
+      CalculateResizeScale(crop_size, out_size, options_.align_corners);
+  weights->resize(out_size);
+  for (int64 i = 0; i < out_size; ++i) {
+    float in = options_.half_pixel_centers ? HalfPixelScaler()(i, scale)
+                                           : LegacyScaler()(i, scale);
+    if (ratio > 1) {
+      // Pixel `j` of the scaled image covers pixels
+      // [j * ratio, (j + 1) * ratio) of the original image.
+      in = (crop_start + in + 0.5f) / ratio - 0.5f - decoded_start;
+    }
+    const float in_f = std::floor(in);
+    CachedInterpolation& weight = (*weights)[i];
+    weight.lower = std::min(std::max(static_cast<int64>(in_f), int64{0}),
+                            decoded_size - 1);
+    weight.upper = std::min(std::max(static_cast<int64>(std::ceil(in)),
+                                     int64{0}),
+                            decoded_size - 1);
+    weight.lerp = in - in_f;
+  }
+}
+
+void DecodeAndResizeJpegContext::ResizeRows(int64 start, int64 limit,
+                                            float* output) const {
+  switch (channels_) {
+    case 1:
+      ResizeRowsImpl<1>(start, limit, output);
+      break;
+    case 3:
+      ResizeRowsImpl<3>(start, limit, output);
+      break;
+    default:
+      ResizeRowsImpl<0>(start, limit, output);
+  }
+}
+
+// The x weights have been multiplied by the number of channels. With a
+// compile-time channel count the inner loop is unrolled and vectorized by the
+// compiler.
+template <int kChannels>
+void DecodeAndResizeJpegContext::ResizeRowsImpl(int64 start, int64 limit,
+                                                float* output) const {
+  const int c_size = kChannels > 0 ? kChannels : channels_;
+  const int64 out_row_size = xs_.size() * c_size;
+  const uint8* input = buffer_.get();
+  const float scale = options_.scale;
+  const float offset = options_.offset;
+  for (int64 y = start; y < limit; ++y) {
+    const uint8* top = input + ys_[y].lower * decoded_row_size_;
+    const uint8* bottom = input + ys_[y].upper * decoded_row_size_;
+    const float y_lerp = ys_[y].lerp;
+    float* out = output + y * out_row_size;
+    for (const CachedInterpolation& x : xs_) {
+      for (int c = 0; c < c_size; ++c) {
+        const float top_left = top[x.lower + c];
+        const float top_right = top[x.upper + c];
+        const float bottom_left = bottom[x.lower + c];
+        const float bottom_right = bottom[x.upper + c];
+        const float top_value = top_left + (top_right - top_left) * x.lerp;
+        const float bottom_value =
+            bottom_left + (bottom_right - bottom_left) * x.lerp;
+        out[c] = (top_value + (bottom_value - top_value) * y_lerp) * scale +
+                 offset;
+      }
+      out += c_size;
+    }
+  }
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,103 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_IMAGE_DECODE_AND_RESIZE_JPEG_H_
+#define TENSORFLOW_CORE_KERNELS_IMAGE_DECODE_AND_RESIZE_JPEG_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/stringpiece.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Options shared by all images decoded with a `DecodeAndResizeJpegContext`.
+struct DecodeAndResizeJpegOptions {
+  // Decoding flags. `ratio` and the crop fields are chosen per image.
+  jpeg::UncompressFlags flags;
+  bool align_corners = false;
+  bool half_pixel_centers = false;
+  // Each output value is `resized * scale + offset`.
+  float scale = 1.0f;
+  float offset = 0.0f;
+};
+
+// Decodes a JPEG image, possibly at a reduced DCT scale, and bilinearly
+// resizes a window of it into a float buffer.
+//
+// The decoded pixels and interpolation weights are kept between images, so a
+// context that is reused by one thread only allocates when it sees a larger
+// image than before. `Decode` must not be called concurrently, but once it
+// returns, disjoint row ranges can be resized in parallel.
+class DecodeAndResizeJpegContext {
+ public:
+  explicit DecodeAndResizeJpegContext(const DecodeAndResizeJpegOptions& options)
+      : options_(options) {}
+
+  // Decodes the window of `contents` with the given origin and size, which
+  // is the whole image if `crop_height` and `crop_width` are both zero, in
+  // preparation for resizing it to `out_height` x `out_width`.
+  Status Decode(StringPiece contents, int64 crop_y, int64 crop_x,
+                int64 crop_height, int64 crop_width, int64 out_height,
+                int64 out_width);
+
+  // The number of channels of the last decoded image.
+  int channels() const { return channels_; }
+
+  // The estimated number of cycles it takes to resize one output row.
+  int64 CostPerRow() const { return xs_.size() * channels_ * 12; }
+
+  // Writes rows [start, limit) of the resized image to `output`, which holds
+  // `out_height * out_width * channels()` values.
+  void ResizeRows(int64 start, int64 limit, float* output) const;
+
+  // Resizes the whole image into `output`.
+  void Resize(float* output) const { ResizeRows(0, ys_.size(), output); }
+
+ private:
+  // Interpolation weights for one output row or column. The indices refer to
+  // the decoded window, which may have been downscaled by libjpeg.
+  struct CachedInterpolation {
+    int64 lower;
+    int64 upper;
+    float lerp;
+  };
+
+  void ComputeInterpolationWeights(int64 out_size, int64 crop_start,
+                                   int64 crop_size, int ratio,
+                                   int64 decoded_start, int64 decoded_size,
+                                   std::vector<CachedInterpolation>* weights);
+
+  template <int kChannels>
+  void ResizeRowsImpl(int64 start, int64 limit, float* output) const;
+
+  const DecodeAndResizeJpegOptions options_;
+  std::unique_ptr<uint8[]> buffer_;
+  int64 buffer_size_ = 0;
+  int64 decoded_row_size_ = 0;
+  int channels_ = 0;
+  std::vector<CachedInterpolation> ys_;
+  std::vector<CachedInterpolation> xs_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(DecodeAndResizeJpegContext);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_IMAGE_DECODE_AND_RESIZE_JPEG_H_
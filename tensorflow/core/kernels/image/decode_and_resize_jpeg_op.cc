@@ -0,0 +1,117 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/image_ops.cc
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/image/decode_and_resize_jpeg.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+namespace {
+
+class DecodeAndResizeJpegOp : public OpKernel {
+ public:
+  explicit DecodeAndResizeJpegOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("channels", &channels_));
+    OP_REQUIRES(context, channels_ == 0 || channels_ == 1 || channels_ == 3,
+                errors::InvalidArgument("channels must be 0, 1 or 3, got ",
+                                        channels_));
+    OP_REQUIRES_OK(context, context->GetAttr("fancy_upscaling",
+                                             &options_.flags.fancy_upscaling));
+    string dct_method;
+    OP_REQUIRES_OK(context, context->GetAttr("dct_method", &dct_method));
+    OP_REQUIRES(
+        context,
+        (dct_method.empty() || dct_method == "INTEGER_FAST" ||
+         dct_method == "INTEGER_ACCURATE"),
+        errors::InvalidArgument("dct_method must be one of "
+                                "{'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}"));
+    options_.flags.dct_method =
+        dct_method == "INTEGER_ACCURATE" ? JDCT_ISLOW : JDCT_IFAST;
+    options_.flags.components = channels_;
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("align_corners", &options_.align_corners));
+    OP_REQUIRES_OK(context, context->GetAttr("half_pixel_centers",
+                                             &options_.half_pixel_centers));
+    OP_REQUIRES(
+        context, !(options_.align_corners && options_.half_pixel_centers),
+        errors::InvalidArgument("If half_pixel_centers is True, "
+                                "align_corners must be False."));
+    OP_REQUIRES_OK(context, context->GetAttr("scale", &options_.scale));
+    OP_REQUIRES_OK(context, context->GetAttr("offset", &options_.offset));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& contents = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(contents.shape()),
+                errors::InvalidArgument("contents must be scalar, got shape ",
+                                        contents.shape().DebugString()));
+    const Tensor& crop_window = context->input(1);
+    OP_REQUIRES(context,
+                crop_window.dims() == 1 && crop_window.dim_size(0) == 4,
+                errors::InvalidArgument(
+                    "crop_window must be 1-D with four elements, got shape ",
+                    crop_window.shape().DebugString()));
+    const Tensor& size = context->input(2);
+    OP_REQUIRES(context, size.dims() == 1 && size.dim_size(0) == 2,
+                errors::InvalidArgument(
+                    "size must be 1-D with two elements, got shape ",
+                    size.shape().DebugString()));
+    const int64 out_height = size.vec<int32>()(0);
+    const int64 out_width = size.vec<int32>()(1);
+
+    // The context is local to this invocation, as the kernel may run
+    // concurrently.
+    DecodeAndResizeJpegContext decoder(options_);
+    auto crop_window_vec = crop_window.vec<int32>();
+    OP_REQUIRES_OK(context,
+                   decoder.Decode(contents.scalar<tstring>()(),
+                                  crop_window_vec(0), crop_window_vec(1),
+                                  crop_window_vec(2), crop_window_vec(3),
+                                  out_height, out_width));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(
+        context,
+        context->allocate_output(
+            0, TensorShape({out_height, out_width, decoder.channels()}),
+            &output));
+    float* output_data = output->flat<float>().data();
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, out_height,
+          decoder.CostPerRow(), [&](int64 start, int64 limit) {
+            decoder.ResizeRows(start, limit, output_data);
+          });
+  }
+
+ private:
+  int channels_;
+  DecodeAndResizeJpegOptions options_;
+};
+
+}  // namespace
+
+REGISTER_KERNEL_BUILDER(Name("DecodeAndResizeJpeg").Device(DEVICE_CPU),
+                        DecodeAndResizeJpegOp);
+
+}  // namespace tensorflow
@@ -0,0 +1,129 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+
+constexpr int kOutputSize = 224;
+
+// Returns a `width` x `height` JPEG with smooth gradients and some noise, so
+// that its entropy is closer to a natural image than a flat one.
+static Tensor MakeJpeg(int width, int height) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<uint8> pixels(width * height * 3);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8* pixel = &pixels[(y * width + x) * 3];
+      pixel[0] = (x * 255 / width + rnd.Uniform(16)) & 0xff;
+      pixel[1] = (y * 255 / height + rnd.Uniform(16)) & 0xff;
+      pixel[2] = ((x + y) * 127 / (width + height) + rnd.Uniform(16)) & 0xff;
+    }
+  }
+  jpeg::CompressFlags flags;
+  flags.format = jpeg::FORMAT_RGB;
+  flags.quality = 90;
+  Tensor contents(DT_STRING, TensorShape({}));
+  contents.scalar<tstring>()() =
+      jpeg::Compress(pixels.data(), width, height, flags);
+  return contents;
+}
+
+static Tensor OutputSize() {
+  Tensor size(DT_INT32, TensorShape({2}));
+  size.vec<int32>().setConstant(kOutputSize);
+  return size;
+}
+
+// The chain that a `tf.image.decode_jpeg`, `tf.image.resize` and a
+// normalization to [-1, 1] produce.
+static Graph* UnfusedGraph(int width, int height) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* decoded;
+  TF_CHECK_OK(NodeBuilder(g->NewName("decode"), "DecodeJpeg")
+                  .Input(test::graph::Constant(g, MakeJpeg(width, height)))
+                  .Attr("channels", 3)
+                  .Finalize(g, &decoded));
+  Node* expanded;
+  TF_CHECK_OK(NodeBuilder(g->NewName("expand_dims"), "ExpandDims")
+                  .Input(decoded)
+                  .Input(test::graph::Constant(g, test::AsScalar<int32>(0)))
+                  .Finalize(g, &expanded));
+  Node* resized;
+  TF_CHECK_OK(NodeBuilder(g->NewName("resize"), "ResizeBilinear")
+                  .Input(expanded)
+                  .Input(test::graph::Constant(g, OutputSize()))
+                  .Attr("half_pixel_centers", true)
+                  .Finalize(g, &resized));
+  Node* squeezed;
+  TF_CHECK_OK(NodeBuilder(g->NewName("squeeze"), "Squeeze")
+                  .Input(resized)
+                  .Attr("squeeze_dims", {0})
+                  .Finalize(g, &squeezed));
+  Node* scaled = test::graph::Binary(
+      g, "Mul", squeezed,
+      test::graph::Constant(g, test::AsScalar<float>(1.0f / 127.5f)));
+  test::graph::Binary(g, "Sub", scaled,
+                      test::graph::Constant(g, test::AsScalar<float>(1.0f)));
+  return g;
+}
+
+static Graph* FusedGraph(int width, int height) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor crop_window(DT_INT32, TensorShape({4}));
+  crop_window.vec<int32>().setZero();
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("decode_and_resize"),
+                          "DecodeAndResizeJpeg")
+                  .Input(test::graph::Constant(g, MakeJpeg(width, height)))
+                  .Input(test::graph::Constant(g, crop_window))
+                  .Input(test::graph::Constant(g, OutputSize()))
+                  .Attr("channels", 3)
+                  .Attr("half_pixel_centers", true)
+                  .Attr("scale", 1.0f / 127.5f)
+                  .Attr("offset", -1.0f)
+                  .Finalize(g, &ret));
+  return g;
+}
+
+// Images per second for a JPEG of the given size resized to 224x224.
+#define BM_DecodeAndResizeJpeg(FUSION, W, H)                               \
+  static void BM_DecodeAndResizeJpeg_##FUSION##_##W##_##H(                 \
+      ::testing::benchmark::State& state) {                                \
+    test::Benchmark("cpu", FUSION##Graph(W, H),                            \
+                    /*old_benchmark_api*/ false)                           \
+        .Run(state);                                                       \
+    state.SetItemsProcessed(static_cast<int64>(state.iterations()));       \
+  }                                                                        \
+  BENCHMARK(BM_DecodeAndResizeJpeg_##FUSION##_##W##_##H)->UseRealTime();
+
+BM_DecodeAndResizeJpeg(Unfused, 320, 240);
+BM_DecodeAndResizeJpeg(Fused, 320, 240);
+BM_DecodeAndResizeJpeg(Unfused, 640, 480);
+BM_DecodeAndResizeJpeg(Fused, 640, 480);
+BM_DecodeAndResizeJpeg(Unfused, 1920, 1080);
+BM_DecodeAndResizeJpeg(Fused, 1920, 1080);
+
+}  // namespace tensorflow
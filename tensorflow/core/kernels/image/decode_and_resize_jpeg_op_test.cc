@@ -0,0 +1,194 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr int kHeight = 64;
+constexpr int kWidth = 96;
+
+// Encodes a smooth RGB gradient, which DCT downscaling preserves closely.
+tstring MakeTestJpeg() {
+  std::vector<uint8> pixels(kHeight * kWidth * 3);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      uint8* pixel = &pixels[(y * kWidth + x) * 3];
+      pixel[0] = 2 * x;
+      pixel[1] = 3 * y;
+      pixel[2] = x + y;
+    }
+  }
+  jpeg::CompressFlags flags;
+  flags.format = jpeg::FORMAT_RGB;
+  flags.quality = 100;
+  flags.chroma_downsampling = false;
+  return jpeg::Compress(pixels.data(), kWidth, kHeight, flags);
+}
+
+// Decodes `contents` at full scale and resizes the crop window the way
+// `ResizeBilinear` with `half_pixel_centers` does.
+Tensor ReferenceImage(const tstring& contents, int channels, int crop_y,
+                      int crop_x, int crop_height, int crop_width,
+                      int out_height, int out_width, float scale,
+                      float offset) {
+  jpeg::UncompressFlags flags;
+  flags.components = channels;
+  flags.dct_method = JDCT_IFAST;
+  int width, height, components;
+  std::unique_ptr<uint8[]> image(
+      jpeg::Uncompress(contents.data(), contents.size(), flags, &width,
+                       &height, &components, nullptr /* nwarn */));
+  CHECK(image != nullptr);
+
+  Tensor result(DT_FLOAT, TensorShape({out_height, out_width, components}));
+  auto output = result.tensor<float, 3>();
+  const float height_scale = static_cast<float>(crop_height) / out_height;
+  const float width_scale = static_cast<float>(crop_width) / out_width;
+  auto pixel = [&](int64 y, int64 x, int c) -> float {
+    return image[((crop_y + y) * width + crop_x + x) * components + c];
+  };
+  for (int y = 0; y < out_height; ++y) {
+    const float in_y = (y + 0.5f) * height_scale - 0.5f;
+    const int64 top = std::max(static_cast<int64>(std::floor(in_y)), int64{0});
+    const int64 bottom =
+        std::min(static_cast<int64>(std::ceil(in_y)), int64{crop_height - 1});
+    const float y_lerp = in_y - std::floor(in_y);
+    for (int x = 0; x < out_width; ++x) {
+      const float in_x = (x + 0.5f) * width_scale - 0.5f;
+      const int64 left =
+          std::max(static_cast<int64>(std::floor(in_x)), int64{0});
+      const int64 right =
+          std::min(static_cast<int64>(std::ceil(in_x)), int64{crop_width - 1});
+      const float x_lerp = in_x - std::floor(in_x);
+      for (int c = 0; c < components; ++c) {
+        const float top_value =
+            pixel(top, left, c) +
+            (pixel(top, right, c) - pixel(top, left, c)) * x_lerp;
+        const float bottom_value =
+            pixel(bottom, left, c) +
+            (pixel(bottom, right, c) - pixel(bottom, left, c)) * x_lerp;
+        output(y, x, c) =
+            (top_value + (bottom_value - top_value) * y_lerp) * scale + offset;
+      }
+    }
+  }
+  return result;
+}
+
+class DecodeAndResizeJpegOpTest : public OpsTestBase {
+ protected:
+  void Init(int channels, float scale = 1.0f, float offset = 0.0f) {
+    TF_ASSERT_OK(NodeDefBuilder("op", "DecodeAndResizeJpeg")
+                     .Input(FakeInput(DT_STRING))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(DT_INT32))
+                     .Attr("channels", channels)
+                     .Attr("half_pixel_centers", true)
+                     .Attr("scale", scale)
+                     .Attr("offset", offset)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  Status Run(const tstring& contents, const std::vector<int32>& crop_window,
+             int out_height, int out_width) {
+    AddInputFromArray<tstring>(TensorShape({}), {contents});
+    AddInputFromArray<int32>(TensorShape({4}), crop_window);
+    AddInputFromArray<int32>(TensorShape({2}), {out_height, out_width});
+    return RunOpKernel();
+  }
+};
+
+TEST_F(DecodeAndResizeJpegOpTest, FullScale) {
+  const tstring contents = MakeTestJpeg();
+  Init(/*channels=*/3, /*scale=*/1.0f / 255, /*offset=*/-0.5f);
+  // The output is more than half the image size, so no DCT scaling is used.
+  TF_ASSERT_OK(Run(contents, {0, 0, 0, 0}, 40, 60));
+  test::ExpectTensorNear<float>(
+      ReferenceImage(contents, 3, 0, 0, kHeight, kWidth, 40, 60, 1.0f / 255,
+                     -0.5f),
+      *GetOutput(0), 1e-5);
+}
+
+TEST_F(DecodeAndResizeJpegOpTest, FullScaleCrop) {
+  const tstring contents = MakeTestJpeg();
+  Init(/*channels=*/3);
+  TF_ASSERT_OK(Run(contents, {8, 16, 32, 48}, 24, 40));
+  test::ExpectTensorNear<float>(
+      ReferenceImage(contents, 3, 8, 16, 32, 48, 24, 40, 1.0f, 0.0f),
+      *GetOutput(0), 1e-3);
+}
+
+TEST_F(DecodeAndResizeJpegOpTest, DctScaling) {
+  const tstring contents = MakeTestJpeg();
+  Init(/*channels=*/3);
+  // Decoded at 1/8 scale. Block averages of a linear gradient match the
+  // bilinear samples up to the JPEG error.
+  TF_ASSERT_OK(Run(contents, {0, 0, 0, 0}, 8, 12));
+  test::ExpectTensorNear<float>(
+      ReferenceImage(contents, 3, 0, 0, kHeight, kWidth, 8, 12, 1.0f, 0.0f),
+      *GetOutput(0), 4.0);
+}
+
+TEST_F(DecodeAndResizeJpegOpTest, DctScalingUnalignedCrop) {
+  const tstring contents = MakeTestJpeg();
+  Init(/*channels=*/3);
+  // Decoded at 1/4 scale from a window that is not aligned to the scale.
+  TF_ASSERT_OK(Run(contents, {4, 10, 48, 64}, 12, 16));
+  test::ExpectTensorNear<float>(
+      ReferenceImage(contents, 3, 4, 10, 48, 64, 12, 16, 1.0f, 0.0f),
+      *GetOutput(0), 4.0);
+}
+
+TEST_F(DecodeAndResizeJpegOpTest, Grayscale) {
+  const tstring contents = MakeTestJpeg();
+  Init(/*channels=*/1);
+  TF_ASSERT_OK(Run(contents, {0, 0, 0, 0}, 16, 24));
+  EXPECT_EQ(TensorShape({16, 24, 1}), GetOutput(0)->shape());
+  test::ExpectTensorNear<float>(
+      ReferenceImage(contents, 1, 0, 0, kHeight, kWidth, 16, 24, 1.0f, 0.0f),
+      *GetOutput(0), 4.0);
+}
+
+TEST_F(DecodeAndResizeJpegOpTest, InvalidCropWindow) {
+  const tstring contents = MakeTestJpeg();
+  Init(/*channels=*/3);
+  Status status = Run(contents, {32, 0, 64, kWidth}, 8, 8);
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+}
+
+TEST_F(DecodeAndResizeJpegOpTest, InvalidJpeg) {
+  Init(/*channels=*/3);
+  Status status = Run("not a jpeg", {0, 0, 0, 0}, 8, 8);
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+}
+
+}  // namespace
+}  // namespace tensorflow
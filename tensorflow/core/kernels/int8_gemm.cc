@@ -0,0 +1,90 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/int8_gemm.h"
+
+#include <tuple>
+#include <vector>
+
+#define GEMMLOWP_ALLOW_SLOW_SCALAR_FALLBACK
+#include "public/gemmlowp.h"
+#include "tensorflow/core/kernels/quantization_utils.h"
+#include "tensorflow/core/platform/dynamic_annotations.h"
+
+namespace tensorflow {
+namespace int8_gemm {
+
+InputQuantization ChooseInputQuantization(float min, float max) {
+  min = std::min(min, 0.f);
+  max = std::max(max, 0.f);
+  InputQuantization quantization;
+  quantization.scale = max > min ? (max - min) / 255.f : 1.f;
+  quantization.zero_point = static_cast<int32>(
+      std::min(std::max(std::round(-min / quantization.scale), 0.f), 255.f));
+  return quantization;
+}
+
+void QuantizeWeights(const float* weights, int64 depth, int64 channels,
+                     uint8* quantized, float* scales) {
+  for (int64 n = 0; n < channels; ++n) {
+    float max_abs = 0;
+    for (int64 d = 0; d < depth; ++d) {
+      max_abs = std::max(max_abs, std::abs(weights[d * channels + n]));
+    }
+    scales[n] = max_abs > 0 ? max_abs / 127.f : 1.f;
+    const float inverse_scale = 1.f / scales[n];
+    for (int64 d = 0; d < depth; ++d) {
+      const float q = std::round(weights[d * channels + n] * inverse_scale);
+      quantized[d * channels + n] = static_cast<uint8>(
+          std::min(std::max(q, -127.f), 127.f) + kWeightsZeroPoint);
+    }
+  }
+}
+
+void PrepareWeights(const float* weights, const float* bias, int64 depth,
+                    int64 channels, const InputQuantization& input,
+                    uint8* quantized, float* scales, float* offsets) {
+  std::vector<float> weight_scales(channels);
+  QuantizeWeights(weights, depth, channels, quantized, weight_scales.data());
+  for (int64 n = 0; n < channels; ++n) {
+    scales[n] = input.scale * weight_scales[n];
+    offsets[n] = bias != nullptr ? bias[n] : 0.f;
+  }
+}
+
+void Gemm(const uint8* in, int64 rows, int64 depth, int32 input_zero_point,
+          const uint8* weights, int64 channels, int32* out, int num_threads,
+          thread::ThreadPool* workers) {
+  gemmlowp::MatrixMap<const std::uint8_t, gemmlowp::MapOrder::RowMajor> lhs(
+      in, rows, depth, depth);
+  gemmlowp::MatrixMap<const std::uint8_t, gemmlowp::MapOrder::RowMajor> rhs(
+      weights, depth, channels, channels);
+  gemmlowp::MatrixMap<std::int32_t, gemmlowp::MapOrder::RowMajor> result(
+      out, rows, channels, channels);
+  const std::tuple<> empty_pipeline = {};
+  // With a single thread gemmlowp runs on the calling thread and does not use
+  // the workers.
+  TensorflowGemmContext context(num_threads, workers);
+  gemmlowp::GemmWithOutputPipeline<std::uint8_t, std::int32_t,
+                                   gemmlowp::DefaultL8R8BitDepthParams>(
+      &context, lhs, rhs, &result, -input_zero_point, -kWeightsZeroPoint,
+      empty_pipeline);
+  // Since gemmlowp uses assembly to write to the output, msan won't detect
+  // the output buffer as written to, so we mark it manually.
+  TF_ANNOTATE_MEMORY_IS_INITIALIZED(out, rows * channels * sizeof(int32));
+}
+
+}  // namespace int8_gemm
+}  // namespace tensorflow
@@ -0,0 +1,84 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_INT8_GEMM_H_
+#define TENSORFLOW_CORE_KERNELS_INT8_GEMM_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace int8_gemm {
+
+// Building blocks of the int8 inference kernels (_Int8MatMul, _Int8Conv2D)
+// and of the Grappler pass creating them (int8_quantization.cc):
+//
+// *) Activations are quantized per tensor, asymmetrically, to uint8 with a
+//    zero point: x ~= scale * (q - zero_point).
+// *) Weights are quantized per output channel, symmetrically, to int8:
+//    w ~= scale[n] * q. They are stored as uint8 q + kWeightsZeroPoint, so that
+//    the products are computed by gemmlowp, the uint8 GEMM of the quantized
+//    kernels, which applies both zero points and accumulates in int32 with its
+//    SIMD kernels.
+
+// Zero point of the uint8 storage of the int8 weights.
+constexpr int32 kWeightsZeroPoint = 128;
+
+// Quantization parameters of activations.
+struct InputQuantization {
+  float scale;
+  int32 zero_point;
+};
+
+// Returns the quantization parameters of activations in [min, max]. The range
+// is extended to contain 0, so that zero padding is exactly representable.
+InputQuantization ChooseInputQuantization(float min, float max);
+
+inline uint8 QuantizeInput(float x, float inverse_scale, int32 zero_point) {
+  const float q = std::nearbyint(x * inverse_scale) + zero_point;
+  return static_cast<uint8>(std::min(std::max(q, 0.f), 255.f));
+}
+
+// Quantizes the row-major float [depth, channels] 'weights' to the row-major
+// 'quantized', stored with kWeightsZeroPoint, with one scale per channel
+// written to 'scales'.
+void QuantizeWeights(const float* weights, int64 depth, int64 channels,
+                     uint8* quantized, float* scales);
+
+// Quantizes the row-major float [depth, channels] 'weights' for activations
+// quantized with 'input', and computes the per channel 'scales' and 'offsets'
+// that convert an int32 product p of Gemm() back to float, as
+// p * scales[n] + offsets[n]: the offsets hold the optional 'bias'.
+// 'quantized' has depth * channels elements.
+void PrepareWeights(const float* weights, const float* bias, int64 depth,
+                    int64 channels, const InputQuantization& input,
+                    uint8* quantized, float* scales, float* offsets);
+
+// Computes the int32 row-major [rows, channels] product 'out' of the uint8
+// row-major [rows, depth] activations 'in', less 'input_zero_point', and the
+// weights quantized by QuantizeWeights(). The product runs on up to
+// 'num_threads' threads of 'workers', or on the calling thread if
+// 'num_threads' is 1.
+void Gemm(const uint8* in, int64 rows, int64 depth, int32 input_zero_point,
+          const uint8* weights, int64 channels, int32* out, int num_threads,
+          thread::ThreadPool* workers);
+
+}  // namespace int8_gemm
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_INT8_GEMM_H_
@@ -0,0 +1,365 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/math_ops.cc (_Int8MatMul) and ../ops/nn_ops.cc
+// (_Int8Conv2D).
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "tensorflow/core/framework/kernel_shape_util.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/kernels/int8_gemm.h"
+#include "tensorflow/core/util/padding.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+// The int8 kernels take and produce float tensors, so that they can replace
+// float MatMul and Conv2D nodes one at a time:
+//
+// *) The float input is quantized to uint8 with the calibrated input_scale and
+//    input_zero_point attributes when it is read.
+// *) The int32 products of the int8 GEMM (see int8_gemm.h) are converted back
+//    to float, biased and activated in a single pass over the output, with the
+//    per channel scales and offsets precomputed by the Grappler pass.
+//
+// The weights input holds the [depth, channels] weights quantized by
+// int8_gemm::PrepareWeights().
+
+namespace {
+
+enum class Int8Activation { kNone, kRelu, kRelu6, kElu, kLeakyRelu };
+
+// Attributes shared by the int8 kernels.
+struct Int8Attributes {
+  int8_gemm::InputQuantization input;
+  Int8Activation activation;
+  float leakyrelu_alpha;
+};
+
+Status GetInt8Attributes(OpKernelConstruction* context,
+                         Int8Attributes* attributes) {
+  TF_RETURN_IF_ERROR(
+      context->GetAttr("input_scale", &attributes->input.scale));
+  TF_RETURN_IF_ERROR(
+      context->GetAttr("input_zero_point", &attributes->input.zero_point));
+  if (!(attributes->input.scale > 0) || attributes->input.zero_point < 0 ||
+      attributes->input.zero_point > 255) {
+    return errors::InvalidArgument(
+        "input_scale must be positive and input_zero_point in [0, 255], got ",
+        attributes->input.scale, " and ", attributes->input.zero_point);
+  }
+  string activation;
+  TF_RETURN_IF_ERROR(context->GetAttr("activation", &activation));
+  if (activation == "Relu") {
+    attributes->activation = Int8Activation::kRelu;
+  } else if (activation == "Relu6") {
+    attributes->activation = Int8Activation::kRelu6;
+  } else if (activation == "Elu") {
+    attributes->activation = Int8Activation::kElu;
+  } else if (activation == "LeakyRelu") {
+    attributes->activation = Int8Activation::kLeakyRelu;
+  } else {
+    attributes->activation = Int8Activation::kNone;
+  }
+  return context->GetAttr("leakyrelu_alpha", &attributes->leakyrelu_alpha);
+}
+
+// Validates the quantized weights and the per channel scales and offsets, and
+// returns the number of output channels.
+Status CheckWeights(const Tensor& weights, const Tensor& scales,
+                    const Tensor& offsets, int64 depth, int64* channels) {
+  if (!TensorShapeUtils::IsVector(scales.shape()) ||
+      !TensorShapeUtils::IsVector(offsets.shape()) ||
+      scales.dim_size(0) != offsets.dim_size(0)) {
+    return errors::InvalidArgument(
+        "scales and offsets must be vectors of the same size: ",
+        scales.shape().DebugString(), " vs ", offsets.shape().DebugString());
+  }
+  *channels = scales.dim_size(0);
+  const TensorShape expected_shape({depth, *channels});
+  if (weights.shape() != expected_shape) {
+    return errors::InvalidArgument(
+        "weights of depth ", depth, " and ", *channels,
+        " channels must have shape ", expected_shape.DebugString(), ", got ",
+        weights.shape().DebugString());
+  }
+  return Status::OK();
+}
+
+// Converts 'rows' rows of the int32 products 'acc' to the float 'out'.
+void Requantize(const Int8Attributes& attributes, const int32* acc,
+                int64 rows, int64 channels, const float* scales,
+                const float* offsets, float* out) {
+  const float alpha = attributes.leakyrelu_alpha;
+  for (int64 r = 0; r < rows; ++r) {
+    const int32* acc_row = acc + r * channels;
+    float* out_row = out + r * channels;
+    for (int64 n = 0; n < channels; ++n) {
+      const float x = acc_row[n] * scales[n] + offsets[n];
+      switch (attributes.activation) {
+        case Int8Activation::kRelu:
+          out_row[n] = std::max(x, 0.f);
+          break;
+        case Int8Activation::kRelu6:
+          out_row[n] = std::min(std::max(x, 0.f), 6.f);
+          break;
+        case Int8Activation::kElu:
+          out_row[n] = x < 0.f ? std::expm1(x) : x;
+          break;
+        case Int8Activation::kLeakyRelu:
+          out_row[n] = x < 0.f ? x * alpha : x;
+          break;
+        default:
+          out_row[n] = x;
+      }
+    }
+  }
+}
+
+// Number of im2col patch rows multiplied at once by a shard of _Int8Conv2D,
+// rounded down to whole output rows (but at least one), so that each GEMM
+// amortizes the packing of the filter.
+constexpr int64 kConvPatchRows = 256;
+
+}  // namespace
+
+class Int8MatMulOp : public OpKernel {
+ public:
+  explicit Int8MatMulOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, GetInt8Attributes(context, &attributes_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& a = context->input(0);
+    const Tensor& b = context->input(1);
+    const Tensor& scales = context->input(2);
+    const Tensor& offsets = context->input(3);
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(a.shape()),
+                errors::InvalidArgument("a must be a matrix: ",
+                                        a.shape().DebugString()));
+    const int64 rows = a.dim_size(0);
+    const int64 depth = a.dim_size(1);
+    int64 channels;
+    OP_REQUIRES_OK(context, CheckWeights(b, scales, offsets, depth, &channels));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape({rows, channels}), &output));
+    if (output->NumElements() == 0) return;
+
+    const Int8Attributes attributes = attributes_;
+    const float inverse_scale = 1.f / attributes.input.scale;
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+
+    Tensor quantized_tensor;
+    OP_REQUIRES_OK(context, context->allocate_temp(DT_UINT8, a.shape(),
+                                                   &quantized_tensor));
+    const float* in = a.flat<float>().data();
+    uint8* quantized = quantized_tensor.flat<uint8>().data();
+    Shard(worker_threads.num_threads, worker_threads.workers, a.NumElements(),
+          4, [=](int64 start, int64 limit) {
+            for (int64 i = start; i < limit; ++i) {
+              quantized[i] = int8_gemm::QuantizeInput(
+                  in[i], inverse_scale, attributes.input.zero_point);
+            }
+          });
+
+    Tensor acc_tensor;
+    OP_REQUIRES_OK(context,
+                   context->allocate_temp(DT_INT32, output->shape(),
+                                          &acc_tensor));
+    const int32* acc = acc_tensor.flat<int32>().data();
+    int8_gemm::Gemm(quantized, rows, depth, attributes.input.zero_point,
+                    reinterpret_cast<const uint8*>(b.flat<quint8>().data()),
+                    channels,
+                    acc_tensor.flat<int32>().data(), worker_threads.num_threads,
+                    worker_threads.workers);
+
+    const float* scales_data = scales.flat<float>().data();
+    const float* offsets_data = offsets.flat<float>().data();
+    float* out = output->flat<float>().data();
+    Shard(worker_threads.num_threads, worker_threads.workers, rows,
+          4 * channels, [=](int64 start, int64 limit) {
+            Requantize(attributes, acc + start * channels, limit - start,
+                       channels, scales_data, offsets_data,
+                       out + start * channels);
+          });
+  }
+
+ private:
+  Int8Attributes attributes_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("_Int8MatMul").Device(DEVICE_CPU), Int8MatMulOp);
+
+// The convolution quantizes its whole input once, then computes a few output
+// rows at a time as a GEMM of the im2col patches of the rows, [rows * out_cols,
+// filter_rows * filter_cols * in_depth], with the quantized filter. Patch
+// elements in the padding take the zero point value, which is the exact
+// quantization of 0.
+class Int8Conv2DOp : public OpKernel {
+ public:
+  explicit Int8Conv2DOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, GetInt8Attributes(context, &attributes_));
+    OP_REQUIRES_OK(context, context->GetAttr("filter_rows", &filter_rows_));
+    OP_REQUIRES_OK(context, context->GetAttr("filter_cols", &filter_cols_));
+    OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
+    OP_REQUIRES_OK(context, context->GetAttr("dilations", &dilations_));
+    OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+    OP_REQUIRES(context,
+                strides_.size() == 4 && strides_[0] == 1 && strides_[3] == 1 &&
+                    strides_[1] > 0 && strides_[2] > 0,
+                errors::InvalidArgument(
+                    "strides must have 4 positive elements, with 1 for the "
+                    "batch and channels"));
+    OP_REQUIRES(context,
+                dilations_.size() == 4 && dilations_[0] == 1 &&
+                    dilations_[3] == 1 && dilations_[1] > 0 &&
+                    dilations_[2] > 0,
+                errors::InvalidArgument(
+                    "dilations must have 4 positive elements, with 1 for the "
+                    "batch and channels"));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    const Tensor& filter = context->input(1);
+    const Tensor& scales = context->input(2);
+    const Tensor& offsets = context->input(3);
+    OP_REQUIRES(context, input.dims() == 4,
+                errors::InvalidArgument("input must be 4-dimensional: ",
+                                        input.shape().DebugString()));
+    const int64 batch = input.dim_size(0);
+    const int64 in_rows = input.dim_size(1);
+    const int64 in_cols = input.dim_size(2);
+    const int64 in_depth = input.dim_size(3);
+    const int64 depth = filter_rows_ * filter_cols_ * in_depth;
+    int64 channels;
+    OP_REQUIRES_OK(context,
+                   CheckWeights(filter, scales, offsets, depth, &channels));
+
+    int64 out_rows, out_cols, pad_rows, pad_cols, pad_after;
+    OP_REQUIRES_OK(context, GetWindowedOutputSizeVerboseV2(
+                                in_rows, filter_rows_, dilations_[1],
+                                strides_[1], padding_, &out_rows, &pad_rows,
+                                &pad_after));
+    OP_REQUIRES_OK(context, GetWindowedOutputSizeVerboseV2(
+                                in_cols, filter_cols_, dilations_[2],
+                                strides_[2], padding_, &out_cols, &pad_cols,
+                                &pad_after));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({batch, out_rows, out_cols, channels}),
+                       &output));
+    if (output->NumElements() == 0) return;
+
+    const Int8Attributes attributes = attributes_;
+    const float inverse_scale = 1.f / attributes.input.scale;
+    const uint8 zero_point = static_cast<uint8>(attributes.input.zero_point);
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+
+    Tensor quantized_tensor;
+    OP_REQUIRES_OK(context, context->allocate_temp(DT_UINT8, input.shape(),
+                                                   &quantized_tensor));
+    const float* in = input.flat<float>().data();
+    uint8* quantized = quantized_tensor.flat<uint8>().data();
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          input.NumElements(), 4, [=](int64 start, int64 limit) {
+            for (int64 i = start; i < limit; ++i) {
+              quantized[i] = int8_gemm::QuantizeInput(
+                  in[i], inverse_scale, attributes.input.zero_point);
+            }
+          });
+
+    const uint8* weights =
+        reinterpret_cast<const uint8*>(filter.flat<quint8>().data());
+    const float* scales_data = scales.flat<float>().data();
+    const float* offsets_data = offsets.flat<float>().data();
+    float* out = output->flat<float>().data();
+    const int64 filter_rows = filter_rows_;
+    const int64 filter_cols = filter_cols_;
+    const int64 stride_rows = strides_[1];
+    const int64 stride_cols = strides_[2];
+    const int64 dilation_rows = dilations_[1];
+    const int64 dilation_cols = dilations_[2];
+    const int64 units_per_gemm =
+        std::max<int64>(1, kConvPatchRows / out_cols);
+
+    // Each shard unit is one output row of one image. Consecutive units are
+    // consecutive in the output, so the patches of several units are
+    // multiplied at once.
+    auto shard = [=](int64 start, int64 limit) {
+      const int64 max_rows = std::min(units_per_gemm, limit - start) * out_cols;
+      std::vector<uint8> patches(max_rows * depth);
+      std::vector<int32> acc(max_rows * channels);
+      for (int64 first = start; first < limit; first += units_per_gemm) {
+        const int64 num_units = std::min(units_per_gemm, limit - first);
+        for (int64 u = 0; u < num_units; ++u) {
+          const int64 out_r = (first + u) % out_rows;
+          const int64 n = (first + u) / out_rows;
+          const uint8* image = quantized + n * in_rows * in_cols * in_depth;
+          for (int64 out_c = 0; out_c < out_cols; ++out_c) {
+            uint8* patch = patches.data() + (u * out_cols + out_c) * depth;
+            for (int64 fr = 0; fr < filter_rows; ++fr) {
+              const int64 in_r = out_r * stride_rows - pad_rows +
+                                 fr * dilation_rows;
+              for (int64 fc = 0; fc < filter_cols; ++fc) {
+                const int64 in_c = out_c * stride_cols - pad_cols +
+                                   fc * dilation_cols;
+                uint8* tap = patch + (fr * filter_cols + fc) * in_depth;
+                if (in_r < 0 || in_r >= in_rows || in_c < 0 ||
+                    in_c >= in_cols) {
+                  std::fill_n(tap, in_depth, zero_point);
+                } else {
+                  std::copy_n(image + (in_r * in_cols + in_c) * in_depth,
+                              in_depth, tap);
+                }
+              }
+            }
+          }
+        }
+        const int64 num_rows = num_units * out_cols;
+        int8_gemm::Gemm(patches.data(), num_rows, depth,
+                        attributes.input.zero_point, weights, channels,
+                        acc.data(), /*num_threads=*/1, /*workers=*/nullptr);
+        Requantize(attributes, acc.data(), num_rows, channels, scales_data,
+                   offsets_data, out + first * out_cols * channels);
+      }
+    };
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          batch * out_rows, out_cols * depth * channels, shard);
+  }
+
+ private:
+  Int8Attributes attributes_;
+  int32 filter_rows_;
+  int32 filter_cols_;
+  std::vector<int32> strides_;
+  std::vector<int32> dilations_;
+  Padding padding_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("_Int8Conv2D").Device(DEVICE_CPU), Int8Conv2DOp);
+
+}  // namespace tensorflow
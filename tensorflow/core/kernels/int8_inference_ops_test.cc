@@ -0,0 +1,424 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/int8_gemm.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns a tensor of deterministic pseudo random values in [lo, lo + 2].
+Tensor MakeInput(const TensorShape& shape, int seed, float lo = -1.f) {
+  Tensor t(DT_FLOAT, shape);
+  auto flat = t.flat<float>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = static_cast<float>((i * 37 + seed * 101) % 97) / 48.f + lo;
+  }
+  return t;
+}
+
+// Int8 weights of a float [depth, channels] matrix, in the form taken by the
+// int8 kernels, and their dequantized values.
+struct Int8Weights {
+  Tensor quantized;
+  Tensor scales;
+  Tensor offsets;
+  std::vector<float> dequantized;
+};
+
+Int8Weights MakeInt8Weights(const Tensor& weights, const Tensor* bias,
+                            int64 depth, int64 channels,
+                            const int8_gemm::InputQuantization& input) {
+  Int8Weights result;
+  result.quantized = Tensor(DT_QUINT8, {depth, channels});
+  result.scales = Tensor(DT_FLOAT, {channels});
+  result.offsets = Tensor(DT_FLOAT, {channels});
+  int8_gemm::PrepareWeights(
+      weights.flat<float>().data(),
+      bias != nullptr ? bias->flat<float>().data() : nullptr, depth, channels,
+      input, reinterpret_cast<uint8*>(result.quantized.flat<quint8>().data()),
+      result.scales.flat<float>().data(), result.offsets.flat<float>().data());
+
+  std::vector<uint8> quantized(depth * channels);
+  std::vector<float> weight_scales(channels);
+  int8_gemm::QuantizeWeights(weights.flat<float>().data(), depth, channels,
+                             quantized.data(), weight_scales.data());
+  result.dequantized.resize(depth * channels);
+  for (int64 i = 0; i < depth * channels; ++i) {
+    result.dequantized[i] =
+        (static_cast<int32>(quantized[i]) - int8_gemm::kWeightsZeroPoint) *
+        weight_scales[i % channels];
+  }
+  return result;
+}
+
+// Returns the value of 'x' after quantization with 'input'.
+float Dequantize(float x, const int8_gemm::InputQuantization& input) {
+  const uint8 q =
+      int8_gemm::QuantizeInput(x, 1.f / input.scale, input.zero_point);
+  return input.scale * (static_cast<int32>(q) - input.zero_point);
+}
+
+float Activation(const string& activation, float x) {
+  if (activation == "Relu") return std::max(x, 0.f);
+  if (activation == "Relu6") return std::min(std::max(x, 0.f), 6.f);
+  if (activation == "Elu") return x < 0 ? std::expm1(x) : x;
+  if (activation == "LeakyRelu") return x < 0 ? x * 0.3f : x;
+  return x;
+}
+
+TEST(Int8GemmTest, ChooseInputQuantization) {
+  // The range is extended to contain 0, which is exactly representable.
+  int8_gemm::InputQuantization q = int8_gemm::ChooseInputQuantization(1, 2);
+  EXPECT_FLOAT_EQ(q.scale, 2.f / 255.f);
+  EXPECT_EQ(q.zero_point, 0);
+  q = int8_gemm::ChooseInputQuantization(-1, 1);
+  EXPECT_FLOAT_EQ(q.scale, 2.f / 255.f);
+  EXPECT_EQ(q.zero_point, 128);
+  EXPECT_EQ(int8_gemm::QuantizeInput(0.f, 1.f / q.scale, q.zero_point), 128);
+  q = int8_gemm::ChooseInputQuantization(-4, -1);
+  EXPECT_EQ(q.zero_point, 255);
+  q = int8_gemm::ChooseInputQuantization(0, 0);
+  EXPECT_EQ(q.scale, 1.f);
+  EXPECT_EQ(q.zero_point, 0);
+}
+
+class Int8InferenceOpsTest : public OpsTestBase {
+ protected:
+  // Checks _Int8MatMul against a float MatMul of the dequantized input and
+  // weights.
+  void VerifyMatMul(int64 rows, int64 depth, int64 channels, bool with_bias,
+                    const string& activation) {
+    const Tensor a = MakeInput({rows, depth}, 1);
+    const Tensor b = MakeInput({depth, channels}, 2);
+    const Tensor bias = MakeInput({channels}, 3);
+    const int8_gemm::InputQuantization input =
+        int8_gemm::ChooseInputQuantization(-1, 1);
+    const Int8Weights weights = MakeInt8Weights(
+        b, with_bias ? &bias : nullptr, depth, channels, input);
+
+    TF_ASSERT_OK(NodeDefBuilder("int8_matmul", "_Int8MatMul")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_QUINT8))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Attr("input_scale", input.scale)
+                     .Attr("input_zero_point", input.zero_point)
+                     .Attr("activation", activation)
+                     .Attr("leakyrelu_alpha", 0.3f)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    AddInputFromArray<float>(a.shape(), a.flat<float>());
+    AddInputFromArray<quint8>(weights.quantized.shape(),
+                              weights.quantized.flat<quint8>());
+    AddInputFromArray<float>(weights.scales.shape(),
+                             weights.scales.flat<float>());
+    AddInputFromArray<float>(weights.offsets.shape(),
+                             weights.offsets.flat<float>());
+    TF_ASSERT_OK(RunOpKernel());
+
+    Tensor expected(DT_FLOAT, {rows, channels});
+    for (int64 r = 0; r < rows; ++r) {
+      for (int64 n = 0; n < channels; ++n) {
+        double sum = with_bias ? bias.flat<float>()(n) : 0;
+        for (int64 d = 0; d < depth; ++d) {
+          sum += Dequantize(a.matrix<float>()(r, d), input) *
+                 weights.dequantized[d * channels + n];
+        }
+        expected.matrix<float>()(r, n) =
+            Activation(activation, static_cast<float>(sum));
+      }
+    }
+    test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-3);
+  }
+
+  // Checks _Int8Conv2D against a NHWC convolution of the dequantized input
+  // and filter computed one output element at a time.
+  void VerifyConv2D(const TensorShape& image_shape, int filter_size,
+                    int64 out_depth, int stride, int dilation,
+                    const string& padding, const string& activation) {
+    const int64 in_depth = image_shape.dim_size(3);
+    const int64 depth = filter_size * filter_size * in_depth;
+    // Inputs in [0, 2] quantized with a nonzero zero point check that the
+    // padding, quantized to the zero point, contributes 0 to the convolution.
+    const Tensor image = MakeInput(image_shape, 1, 0.f);
+    const Tensor filter =
+        MakeInput({filter_size, filter_size, in_depth, out_depth}, 2);
+    const Tensor bias = MakeInput({out_depth}, 3);
+    const int8_gemm::InputQuantization input =
+        int8_gemm::ChooseInputQuantization(-0.5f, 2);
+    const Int8Weights weights =
+        MakeInt8Weights(filter, &bias, depth, out_depth, input);
+
+    TF_ASSERT_OK(NodeDefBuilder("int8_conv", "_Int8Conv2D")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_QUINT8))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Attr("filter_rows", filter_size)
+                     .Attr("filter_cols", filter_size)
+                     .Attr("strides", {1, stride, stride, 1})
+                     .Attr("dilations", {1, dilation, dilation, 1})
+                     .Attr("padding", padding)
+                     .Attr("input_scale", input.scale)
+                     .Attr("input_zero_point", input.zero_point)
+                     .Attr("activation", activation)
+                     .Attr("leakyrelu_alpha", 0.3f)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    AddInputFromArray<float>(image.shape(), image.flat<float>());
+    AddInputFromArray<quint8>(weights.quantized.shape(),
+                              weights.quantized.flat<quint8>());
+    AddInputFromArray<float>(weights.scales.shape(),
+                             weights.scales.flat<float>());
+    AddInputFromArray<float>(weights.offsets.shape(),
+                             weights.offsets.flat<float>());
+    TF_ASSERT_OK(RunOpKernel());
+
+    const int64 in_rows = image_shape.dim_size(1);
+    const int64 in_cols = image_shape.dim_size(2);
+    const int64 effective = (filter_size - 1) * dilation + 1;
+    int64 out_rows, out_cols, pad_rows, pad_cols;
+    if (padding == "VALID") {
+      out_rows = (in_rows - effective) / stride + 1;
+      out_cols = (in_cols - effective) / stride + 1;
+      pad_rows = pad_cols = 0;
+    } else {
+      out_rows = (in_rows + stride - 1) / stride;
+      out_cols = (in_cols + stride - 1) / stride;
+      pad_rows =
+          std::max<int64>(0, (out_rows - 1) * stride + effective - in_rows) /
+          2;
+      pad_cols =
+          std::max<int64>(0, (out_cols - 1) * stride + effective - in_cols) /
+          2;
+    }
+    Tensor expected(DT_FLOAT,
+                    {image_shape.dim_size(0), out_rows, out_cols, out_depth});
+    const auto in = image.tensor<float, 4>();
+    auto out = expected.tensor<float, 4>();
+    for (int64 n = 0; n < image_shape.dim_size(0); ++n) {
+      for (int64 r = 0; r < out_rows; ++r) {
+        for (int64 c = 0; c < out_cols; ++c) {
+          for (int64 od = 0; od < out_depth; ++od) {
+            double sum = bias.flat<float>()(od);
+            for (int64 fr = 0; fr < filter_size; ++fr) {
+              const int64 in_r = r * stride - pad_rows + fr * dilation;
+              if (in_r < 0 || in_r >= in_rows) continue;
+              for (int64 fc = 0; fc < filter_size; ++fc) {
+                const int64 in_c = c * stride - pad_cols + fc * dilation;
+                if (in_c < 0 || in_c >= in_cols) continue;
+                for (int64 d = 0; d < in_depth; ++d) {
+                  const int64 tap = (fr * filter_size + fc) * in_depth + d;
+                  sum += Dequantize(in(n, in_r, in_c, d), input) *
+                         weights.dequantized[tap * out_depth + od];
+                }
+              }
+            }
+            out(n, r, c, od) = Activation(activation, static_cast<float>(sum));
+          }
+        }
+      }
+    }
+    test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-3);
+  }
+};
+
+TEST_F(Int8InferenceOpsTest, MatMul) { VerifyMatMul(5, 7, 3, false, "None"); }
+
+TEST_F(Int8InferenceOpsTest, MatMulWithBias) {
+  VerifyMatMul(9, 33, 20, true, "None");
+}
+
+TEST_F(Int8InferenceOpsTest, MatMulManyRows) {
+  VerifyMatMul(150, 64, 17, true, "Relu");
+}
+
+TEST_F(Int8InferenceOpsTest, MatMulActivations) {
+  for (const string& activation : {"Relu", "Relu6", "Elu", "LeakyRelu"}) {
+    VerifyMatMul(6, 12, 18, true, activation);
+  }
+}
+
+TEST_F(Int8InferenceOpsTest, MatMulBadWeights) {
+  TF_ASSERT_OK(NodeDefBuilder("int8_matmul", "_Int8MatMul")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("input_scale", 0.1f)
+                   .Attr("input_zero_point", 0)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<float>(TensorShape({2, 8}), std::vector<float>(16));
+  // Weights of depth 4 instead of 8.
+  AddInputFromArray<quint8>(TensorShape({4, 3}),
+                            std::vector<quint8>(12, quint8(128)));
+  AddInputFromArray<float>(TensorShape({3}), {1, 1, 1});
+  AddInputFromArray<float>(TensorShape({3}), {0, 0, 0});
+  const Status status = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+}
+
+TEST_F(Int8InferenceOpsTest, Conv2D1x1) {
+  VerifyConv2D({1, 4, 5, 6}, 1, 5, 1, 1, "VALID", "None");
+}
+
+TEST_F(Int8InferenceOpsTest, Conv2D3x3Same) {
+  VerifyConv2D({2, 7, 6, 5}, 3, 18, 1, 1, "SAME", "Relu");
+}
+
+TEST_F(Int8InferenceOpsTest, Conv2DStrided) {
+  VerifyConv2D({1, 9, 8, 3}, 3, 7, 2, 1, "SAME", "Relu6");
+}
+
+TEST_F(Int8InferenceOpsTest, Conv2DDilated) {
+  VerifyConv2D({1, 9, 9, 4}, 3, 8, 1, 2, "VALID", "LeakyRelu");
+}
+
+// Latency of the int8 kernels against the float kernels they replace.
+
+Int8Weights MakeBenchmarkWeights(int64 depth, int64 channels) {
+  Tensor weights(DT_FLOAT, {depth, channels});
+  weights.flat<float>().setRandom();
+  Tensor bias(DT_FLOAT, {channels});
+  bias.flat<float>().setRandom();
+  return MakeInt8Weights(weights, &bias, depth, channels,
+                         int8_gemm::ChooseInputQuantization(-1, 1));
+}
+
+static Graph* FloatMatMul(int m, int k, int n) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor a(DT_FLOAT, {m, k});
+  a.flat<float>().setRandom();
+  Tensor b(DT_FLOAT, {k, n});
+  b.flat<float>().setRandom();
+  test::graph::Matmul(g, test::graph::Constant(g, a),
+                      test::graph::Constant(g, b), false, false);
+  return g;
+}
+
+static Graph* Int8MatMul(int m, int k, int n) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor a(DT_FLOAT, {m, k});
+  a.flat<float>().setRandom();
+  const Int8Weights weights = MakeBenchmarkWeights(k, n);
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_Int8MatMul")
+                  .Input(test::graph::Constant(g, a))
+                  .Input(test::graph::Constant(g, weights.quantized))
+                  .Input(test::graph::Constant(g, weights.scales))
+                  .Input(test::graph::Constant(g, weights.offsets))
+                  .Attr("input_scale", 2.f / 255.f)
+                  .Attr("input_zero_point", 128)
+                  .Finalize(g, &node));
+  return g;
+}
+
+static Graph* FloatConv2D(int batch, int size, int in_depth, int filter_size,
+                          int out_depth) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor input(DT_FLOAT, {batch, size, size, in_depth});
+  input.flat<float>().setRandom();
+  Tensor filter(DT_FLOAT, {filter_size, filter_size, in_depth, out_depth});
+  filter.flat<float>().setRandom();
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "Conv2D")
+                  .Input(test::graph::Constant(g, input))
+                  .Input(test::graph::Constant(g, filter))
+                  .Attr("T", DT_FLOAT)
+                  .Attr("strides", {1, 1, 1, 1})
+                  .Attr("padding", "SAME")
+                  .Finalize(g, &node));
+  return g;
+}
+
+static Graph* Int8Conv2D(int batch, int size, int in_depth, int filter_size,
+                         int out_depth) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor input(DT_FLOAT, {batch, size, size, in_depth});
+  input.flat<float>().setRandom();
+  const Int8Weights weights =
+      MakeBenchmarkWeights(filter_size * filter_size * in_depth, out_depth);
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_Int8Conv2D")
+                  .Input(test::graph::Constant(g, input))
+                  .Input(test::graph::Constant(g, weights.quantized))
+                  .Input(test::graph::Constant(g, weights.scales))
+                  .Input(test::graph::Constant(g, weights.offsets))
+                  .Attr("filter_rows", filter_size)
+                  .Attr("filter_cols", filter_size)
+                  .Attr("strides", {1, 1, 1, 1})
+                  .Attr("padding", "SAME")
+                  .Attr("input_scale", 2.f / 255.f)
+                  .Attr("input_zero_point", 128)
+                  .Finalize(g, &node));
+  return g;
+}
+
+#define BM_MatMulKind(KIND, M, K, N)                                       \
+  static void BM_##KIND##MatMul_##M##_##K##_##N(                           \
+      ::testing::benchmark::State& state) {                                \
+    test::Benchmark("cpu", KIND##MatMul(M, K, N),                          \
+                    /*old_benchmark_api=*/false)                           \
+        .Run(state);                                                       \
+    state.SetItemsProcessed(static_cast<int64>(state.iterations()) * M *   \
+                            K * N * 2);                                    \
+  }                                                                        \
+  BENCHMARK(BM_##KIND##MatMul_##M##_##K##_##N)->UseRealTime();
+
+#define BM_MatMul(M, K, N)       \
+  BM_MatMulKind(Float, M, K, N); \
+  BM_MatMulKind(Int8, M, K, N);
+
+BM_MatMul(1, 1024, 1024);
+BM_MatMul(16, 1024, 1024);
+BM_MatMul(128, 1024, 1024);
+BM_MatMul(128, 4096, 1024);
+
+#define BM_Conv2DKind(KIND, N, S, C, F, K)                                   \
+  static void BM_##KIND##Conv2D_##N##_##S##_##C##_##F##_##K(                 \
+      ::testing::benchmark::State& state) {                                  \
+    test::Benchmark("cpu", KIND##Conv2D(N, S, C, F, K),                      \
+                    /*old_benchmark_api=*/false)                             \
+        .Run(state);                                                         \
+    state.SetItemsProcessed(static_cast<int64>(state.iterations()) * N * S * \
+                            S * C * F * F * K * 2);                          \
+  }                                                                          \
+  BENCHMARK(BM_##KIND##Conv2D_##N##_##S##_##C##_##F##_##K)->UseRealTime();
+
+#define BM_Conv2D(N, S, C, F, K)       \
+  BM_Conv2DKind(Float, N, S, C, F, K); \
+  BM_Conv2DKind(Int8, N, S, C, F, K);
+
+BM_Conv2D(1, 56, 64, 3, 64);
+BM_Conv2D(8, 28, 128, 3, 128);
+BM_Conv2D(8, 14, 256, 1, 256);
+
+}  // namespace
+}  // namespace tensorflow
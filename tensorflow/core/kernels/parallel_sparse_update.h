@@ -0,0 +1,97 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_PARALLEL_SPARSE_UPDATE_H_
+#define TENSORFLOW_CORE_KERNELS_PARALLEL_SPARSE_UPDATE_H_
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Calls `update(i, index)` for each offset `i` of `indices`, where `index` is
+// the validated row of a variable updated at that offset, and returns -1. If
+// an index is not in [0, num_rows), returns its offset without updating any
+// row.
+//
+// The updates of distinct rows run in parallel on the threads of `d`, while
+// the updates of the same row run serially in the order of their offsets.
+// The result is thus deterministic, and the same as applying the updates
+// one by one, even with duplicate indices. `cost_per_update` is the cost of
+// one call to `update`, which decides whether it is worth parallelizing.
+template <typename Tindex, typename Update>
+Tindex ParallelSparseUpdate(const Eigen::ThreadPoolDevice& d,
+                            typename TTypes<Tindex>::ConstFlat indices,
+                            Tindex num_rows,
+                            const Eigen::TensorOpCost& cost_per_update,
+                            Update update) {
+  const Tindex N = static_cast<Tindex>(indices.size());
+  // Copy the indices before validating them, since the input may change
+  // concurrently.
+  std::vector<Tindex> rows(N);
+  for (Tindex i = 0; i < N; ++i) {
+    rows[i] = internal::SubtleMustCopy(indices(i));
+    if (!FastBoundsCheck(rows[i], num_rows)) return i;
+  }
+
+  const int num_threads =
+      Eigen::TensorCostModel<Eigen::ThreadPoolDevice>::numThreads(
+          N, cost_per_update, d.numThreads());
+  if (num_threads <= 1) {
+    for (Tindex i = 0; i < N; ++i) {
+      update(i, rows[i]);
+    }
+    return -1;
+  }
+
+  // Sort the offsets by bucket of rows with a counting sort, which keeps the
+  // offsets of each row in order. Several buckets per thread balance the
+  // load of the hot rows.
+  const int64 num_buckets = std::min<int64>(N, 4 * num_threads);
+  std::vector<int64> bucket_starts(num_buckets + 1, 0);
+  for (Tindex i = 0; i < N; ++i) {
+    ++bucket_starts[rows[i] % num_buckets + 1];
+  }
+  for (int64 b = 0; b < num_buckets; ++b) {
+    bucket_starts[b + 1] += bucket_starts[b];
+  }
+  std::vector<Tindex> offsets(N);
+  std::vector<int64> bucket_ends(bucket_starts.begin(),
+                                 bucket_starts.end() - 1);
+  for (Tindex i = 0; i < N; ++i) {
+    offsets[bucket_ends[rows[i] % num_buckets]++] = i;
+  }
+
+  d.parallelFor(num_buckets, cost_per_update * (N / num_buckets),
+                [&](Eigen::Index begin, Eigen::Index end) {
+                  for (int64 k = bucket_starts[begin]; k < bucket_starts[end];
+                       ++k) {
+                    const Tindex i = offsets[k];
+                    update(i, rows[i]);
+                  }
+                });
+  return -1;
+}
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_PARALLEL_SPARSE_UPDATE_H_
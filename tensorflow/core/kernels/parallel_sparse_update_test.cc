@@ -0,0 +1,91 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/parallel_sparse_update.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class ParallelSparseUpdateTest : public ::testing::Test {
+ protected:
+  ParallelSparseUpdateTest()
+      : thread_pool_(/*num_threads=*/4), device_(&thread_pool_, 4) {}
+
+  // Returns the offsets updated on each row, in the order of the updates.
+  std::vector<std::vector<int64>> UpdatedOffsets(const Tensor& indices,
+                                                 int64 num_rows,
+                                                 int64* bad_offset) {
+    std::vector<std::vector<int64>> offsets(num_rows);
+    mutex mu;
+    // A high cost makes sure that the updates run in parallel.
+    *bad_offset = ParallelSparseUpdate<int64>(
+        device_, indices.flat<int64>(), num_rows,
+        Eigen::TensorOpCost(1 << 20, 1 << 20, 1 << 20),
+        [&](int64 i, int64 row) {
+          mutex_lock l(mu);
+          offsets[row].push_back(i);
+        });
+    return offsets;
+  }
+
+  Eigen::ThreadPool thread_pool_;
+  Eigen::ThreadPoolDevice device_;
+};
+
+TEST_F(ParallelSparseUpdateTest, UpdatesRowsInOrderOfOffsets) {
+  constexpr int64 kNumRows = 37;
+  constexpr int64 kNumIndices = 1000;
+  Tensor indices(DT_INT64, TensorShape({kNumIndices}));
+  auto indices_flat = indices.flat<int64>();
+  std::vector<std::vector<int64>> expected(kNumRows);
+  for (int64 i = 0; i < kNumIndices; ++i) {
+    // Skewed towards the first rows, with many duplicates.
+    indices_flat(i) = (i * i) % (i % 3 == 0 ? 3 : kNumRows);
+    expected[indices_flat(i)].push_back(i);
+  }
+
+  int64 bad_offset;
+  EXPECT_EQ(UpdatedOffsets(indices, kNumRows, &bad_offset), expected);
+  EXPECT_EQ(bad_offset, -1);
+}
+
+TEST_F(ParallelSparseUpdateTest, ReturnsOffsetOfBadIndex) {
+  Tensor indices(DT_INT64, TensorShape({4}));
+  indices.flat<int64>().setValues({0, 1, 5, -1});
+
+  int64 bad_offset;
+  for (const auto& offsets : UpdatedOffsets(indices, 5, &bad_offset)) {
+    EXPECT_TRUE(offsets.empty());
+  }
+  EXPECT_EQ(bad_offset, 2);
+}
+
+TEST_F(ParallelSparseUpdateTest, UpdatesNothingWithoutIndices) {
+  Tensor indices(DT_INT64, TensorShape({0}));
+  int64 bad_offset;
+  for (const auto& offsets : UpdatedOffsets(indices, 5, &bad_offset)) {
+    EXPECT_TRUE(offsets.empty());
+  }
+  EXPECT_EQ(bad_offset, -1);
+}
+
+}  // namespace
+}  // namespace tensorflow
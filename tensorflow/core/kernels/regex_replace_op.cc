@@ -50,6 +50,14 @@ Status InternalCompute(const RE2& regex, const string& rewrite,
   }
   auto output_flat = output_tensor->flat<tstring>();
   for (size_t i = 0; i < output_flat.size(); ++i) {
+    // Checking for a match without submatches runs on RE2's DFA, which is
+    // much cheaper than the copies below, so that elements without a match
+    // are left untouched.
+    const tstring& text = output_flat(i);
+    if (!regex.Match(re2::StringPiece(text.data(), text.size()), 0,
+                     text.size(), RE2::UNANCHORED, nullptr, 0)) {
+      continue;
+    }
     // TODO(dero): Mitigate copy; Global and GlobalReplace below currently only
     // accept std::string.
     string buf = output_flat(i);
@@ -44,6 +44,12 @@ limitations under the License.
 //   that they want to perform the write without locks held
 //   (use_locking=false), we never copy even if the variable's
 //   reference count is >1.
+//
+// Variables switched to read-mostly mode (EnableVariableReadMostly)
+// are never written in place. Their value is published to readers
+// through an RCU-style pointer, so dense reads and gathers do not
+// acquire the variable's mutex at all; AssignVariableOp publishes a
+// new value, and in-place writes fail.
 
 #define EIGEN_USE_THREADS
 
@@ -141,6 +147,20 @@ void ReadVariableOp::Compute(OpKernelContext* ctx) {
                   ". This could mean that the variable was uninitialized. ",
                   status.ToString()));
 
+  if (const ReadMostlyTensor* published = variable->read_mostly_tensor()) {
+    // The published tensor is never updated in place, so it can be aliased
+    // without taking the variable's lock.
+    ReadMostlyTensor::Reader reader(*published);
+    const Tensor& t = reader.tensor();
+    OP_REQUIRES(
+        ctx, dtype_ == t.dtype(),
+        errors::InvalidArgument(
+            "Trying to read variable with wrong dtype. Expected ",
+            DataTypeString(dtype_), " got ", DataTypeString(t.dtype())));
+    ctx->set_output(0, t);
+    return;
+  }
+
   tf_shared_lock ml(*variable->mu());
   // We're acquiring a reference to the underlying buffer while
   // holding a shared lock to guarantee ordering of reads and
@@ -399,7 +419,11 @@ class AssignVariableOp : public OpKernel {
                     "Trying to assign variable with wrong dtype. Expected ",
                     DataTypeString(variable->tensor()->dtype()), " got ",
                     DataTypeString(dtype_)));
-    if (variable->copy_on_read_mode.load()) {
+    if (variable->read_mostly_tensor() != nullptr) {
+      // Lock-free readers may still be using the current buffer, so the new
+      // value is published rather than copied into it.
+      variable->SetTensor(value);
+    } else if (variable->copy_on_read_mode.load()) {
       PersistentTensor unused;
       Tensor* tmp;
       AllocatorAttributes attr;
@@ -540,6 +564,7 @@ class AssignUpdateVariableOp : public OpKernel {
     // PrepareToUpdateVariable() for commutative operations like Op ==
     // ADD if value's refcount was 1.
     mutex_lock ml(*variable->mu());
+    OP_REQUIRES_OK(context, ValidateVariableForUpdate(variable.get()));
     Tensor* var_tensor = variable->tensor();
     OP_REQUIRES(context, var_tensor->shape().IsSameSize(value.shape()),
                 errors::InvalidArgument("Cannot update variable with shape ",
@@ -620,6 +645,38 @@ REGISTER_KERNEL_BUILDER(Name("VarIsInitializedOp")
                         IsResourceInitialized<Var>);
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 
+class EnableVariableReadMostlyOp : public OpKernel {
+ public:
+  explicit EnableVariableReadMostlyOp(OpKernelConstruction* c) : OpKernel(c) {}
+
+  void Compute(OpKernelContext* context) override {
+    core::RefCountPtr<Var> variable;
+    OP_REQUIRES_OK(context, LookupResource(context, HandleFromInput(context, 0),
+                                           &variable));
+    mutex_lock ml(*variable->mu());
+    if (variable->read_mostly_tensor() != nullptr) return;
+    OP_REQUIRES(context, variable->is_initialized,
+                errors::FailedPrecondition(
+                    "Cannot switch an uninitialized variable to read-mostly "
+                    "mode."));
+    OP_REQUIRES(context, variable->tensor()->dtype() != DT_VARIANT,
+                errors::Unimplemented(
+                    "Read-mostly mode is not supported for variant "
+                    "variables."));
+    variable->PublishReadMostly();
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("EnableVariableReadMostly").Device(DEVICE_CPU),
+                        EnableVariableReadMostlyOp);
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+REGISTER_KERNEL_BUILDER(Name("EnableVariableReadMostly")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("resource"),
+                        EnableVariableReadMostlyOp);
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+
 template <typename Device, typename T, typename Index>
 class ResourceGatherOp : public OpKernel {
  public:
@@ -630,6 +687,13 @@ class ResourceGatherOp : public OpKernel {
   void Compute(OpKernelContext* c) override {
     core::RefCountPtr<Var> v;
     OP_REQUIRES_OK(c, LookupResource(c, HandleFromInput(c, 0), &v));
+    if (const ReadMostlyTensor* published = v->read_mostly_tensor()) {
+      // Read-mostly variables are never updated in place, so we gather from
+      // the published tensor without taking the variable's lock.
+      ReadMostlyTensor::Reader reader(*published);
+      Gather(c, reader.tensor());
+      return;
+    }
     OP_REQUIRES_OK(c, EnsureSparseVariableAccess<Device, T>(c, v.get()));
     // NOTE: We hold the lock for the whole gather operation instead
     // of increasing the reference count of v->tensor() to avoid a
@@ -637,7 +701,11 @@ class ResourceGatherOp : public OpKernel {
     // reference count greater than one and make a copy of the
     // (potentially very large) tensor buffer.
     tf_shared_lock ml(*v->mu());
-    const Tensor& params = *v->tensor();
+    Gather(c, *v->tensor());
+  }
+
+ private:
+  void Gather(OpKernelContext* c, const Tensor& params) {
     const Tensor& indices = c->input(1);
     OP_REQUIRES(
         c, TensorShapeUtils::IsVectorOrHigher(params.shape()),
@@ -714,7 +782,6 @@ class ResourceGatherOp : public OpKernel {
     }
   }
 
- private:
   // Add the batch offset derived from params to each batch of indices.
   // Example: batch_dims = 1, indices = [[0, 1, 2], [0, 1, 2]]
   // If indexing into a params dimension of size 4, then the indices will become
@@ -796,6 +863,11 @@ class ResourceGatherNdOp : public OpKernel {
   void Compute(OpKernelContext* c) override {
     core::RefCountPtr<Var> v;
     OP_REQUIRES_OK(c, LookupResource(c, HandleFromInput(c, 0), &v));
+    if (const ReadMostlyTensor* published = v->read_mostly_tensor()) {
+      ReadMostlyTensor::Reader reader(*published);
+      GatherNd(c, reader.tensor());
+      return;
+    }
     OP_REQUIRES_OK(c, EnsureSparseVariableAccess<Device, T>(c, v.get()));
     // NOTE: We hold the lock for the whole gather operation instead
     // of increasing the reference count of v->tensor() to avoid a
@@ -803,7 +875,11 @@ class ResourceGatherNdOp : public OpKernel {
     // reference count greater than one and make a copy of the
     // (potentially very large) tensor buffer.
     tf_shared_lock ml(*v->mu());
-    const Tensor& params = *v->tensor();
+    GatherNd(c, *v->tensor());
+  }
+
+ private:
+  void GatherNd(OpKernelContext* c, const Tensor& params) {
     const Tensor& indices = c->input(1);
 
     Tensor out;
@@ -864,10 +940,12 @@ class ResourceScatterUpdateOp : public OpKernel {
                                   c->input_dtype(0) == DT_VARIANT;
     if (is_non_pod_dtype || use_exclusive_lock_) {
       mutex_lock ml(*v->mu());
+      OP_REQUIRES_OK(c, ValidateVariableForUpdate(v.get()));
       DoCompute(c);
     } else {
       // For POD dtypes, we can safely run the update without the mutex.
       tf_shared_lock ml(*v->mu());
+      OP_REQUIRES_OK(c, ValidateVariableForUpdate(v.get()));
       DoCompute(c);
     }
   }
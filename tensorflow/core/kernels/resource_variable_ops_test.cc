@@ -0,0 +1,360 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/resource_var.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+class ReadMostlyVariableTest : public OpsTestBase {
+ protected:
+  // Makes a float variable op whose inputs are the variable and, unless
+  // `input_type` is DT_INVALID, a second input of type `input_type`.
+  void MakeOp(const string& op, DataType input_type) {
+    NodeDefBuilder builder("op", op);
+    builder.Input(FakeInput(DT_RESOURCE));
+    if (input_type != DT_INVALID) {
+      builder.Input(FakeInput(input_type));
+    }
+    TF_ASSERT_OK(builder.Attr("dtype", DT_FLOAT).Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Adds an initialized variable holding `value` as the resource input, and
+  // returns it. The variable is owned by the device's resource manager.
+  Var* AddVariableInput(const Tensor& value, bool read_mostly) {
+    Var* var = new Var(value.dtype());
+    *var->tensor() = value;
+    var->is_initialized = true;
+    if (read_mostly) {
+      mutex_lock ml(*var->mu());
+      var->PublishReadMostly();
+    }
+    AddResourceInput("", "var", var);
+    return var;
+  }
+
+  // Runs `kernel` on `inputs` with a context of its own, so that several
+  // kernels can run concurrently on the test device.
+  Status RunConcurrently(OpKernel* kernel,
+                         gtl::InlinedVector<TensorValue, 4> inputs) {
+    OpKernelContext::Params params;
+    params.device = device_;
+    params.frame_iter = FrameAndIter(0, 0);
+    params.inputs = &inputs;
+    params.op_kernel = kernel;
+    ScopedStepContainer step_container(0, [](const string&) {});
+    params.step_container = &step_container;
+    params.resource_manager = device_->resource_manager();
+    OpKernelContext context(&params);
+    device_->Compute(kernel, &context);
+    return context.status();
+  }
+};
+
+// The 4x2 variable used by the tests: row `i` is [i, 10 * i].
+Tensor Params() {
+  return test::AsTensor<float>({0, 0, 1, 10, 2, 20, 3, 30}, {4, 2});
+}
+
+TEST_F(ReadMostlyVariableTest, EnableSwitchesToReadMostlyMode) {
+  TF_ASSERT_OK(NodeDefBuilder("op", "EnableVariableReadMostly")
+                   .Input(FakeInput(DT_RESOURCE))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  Var* var = AddVariableInput(Params(), /*read_mostly=*/false);
+  TF_ASSERT_OK(RunOpKernel());
+  ASSERT_NE(var->read_mostly_tensor(), nullptr);
+  ReadMostlyTensor::Reader reader(*var->read_mostly_tensor());
+  EXPECT_TRUE(reader.tensor().SharesBufferWith(*var->tensor()));
+  // Enabling read-mostly mode again is a no-op.
+  TF_ASSERT_OK(RunOpKernel());
+}
+
+TEST_F(ReadMostlyVariableTest, EnableFailsOnUninitializedVariable) {
+  TF_ASSERT_OK(NodeDefBuilder("op", "EnableVariableReadMostly")
+                   .Input(FakeInput(DT_RESOURCE))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  Var* var = new Var(DT_FLOAT);
+  AddResourceInput("", "var", var);
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsFailedPrecondition(s)) << s;
+  EXPECT_EQ(var->read_mostly_tensor(), nullptr);
+}
+
+TEST_F(ReadMostlyVariableTest, ReadAliasesPublishedTensor) {
+  MakeOp("ReadVariableOp", DT_INVALID);
+  Var* var = AddVariableInput(Params(), /*read_mostly=*/true);
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<float>(*GetOutput(0), Params());
+  EXPECT_TRUE(GetOutput(0)->SharesBufferWith(*var->tensor()));
+}
+
+TEST_F(ReadMostlyVariableTest, GatherDoesNotSwitchToCopyOnRead) {
+  MakeOp("ResourceGather", DT_INT32);
+  Var* var = AddVariableInput(Params(), /*read_mostly=*/true);
+  AddInputFromArray<int32>(TensorShape({3}), {3, 0, 3});
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<float>(
+      *GetOutput(0), test::AsTensor<float>({3, 30, 0, 0, 3, 30}, {3, 2}));
+  EXPECT_FALSE(var->copy_on_read_mode.load());
+}
+
+TEST_F(ReadMostlyVariableTest, GatherReportsBadIndex) {
+  MakeOp("ResourceGather", DT_INT32);
+  AddVariableInput(Params(), /*read_mostly=*/true);
+  AddInputFromArray<int32>(TensorShape({2}), {1, 4});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+TEST_F(ReadMostlyVariableTest, AssignPublishesNewTensor) {
+  MakeOp("AssignVariableOp", DT_FLOAT);
+  Var* var = AddVariableInput(Params(), /*read_mostly=*/true);
+  const Tensor old_value = *var->tensor();
+  AddInputFromArray<float>(TensorShape({1, 2}), {7, 70});
+  TF_ASSERT_OK(RunOpKernel());
+  ReadMostlyTensor::Reader reader(*var->read_mostly_tensor());
+  test::ExpectTensorEqual<float>(reader.tensor(),
+                                 test::AsTensor<float>({7, 70}, {1, 2}));
+  EXPECT_TRUE(reader.tensor().SharesBufferWith(*var->tensor()));
+  // Earlier readers keep the previous, unmodified value.
+  test::ExpectTensorEqual<float>(old_value, Params());
+}
+
+TEST_F(ReadMostlyVariableTest, InPlaceUpdatesFail) {
+  MakeOp("AssignAddVariableOp", DT_FLOAT);
+  Var* var = AddVariableInput(Params(), /*read_mostly=*/true);
+  AddInputFromArray<float>(TensorShape({4, 2}), {1, 1, 1, 1, 1, 1, 1, 1});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsFailedPrecondition(s)) << s;
+  test::ExpectTensorEqual<float>(*var->tensor(), Params());
+}
+
+TEST_F(ReadMostlyVariableTest, CountUpToPublishesNewTensor) {
+  TF_ASSERT_OK(NodeDefBuilder("op", "ResourceCountUpTo")
+                   .Input(FakeInput(DT_RESOURCE))
+                   .Attr("limit", 2)
+                   .Attr("T", DT_INT64)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddVariableInput(test::AsScalar<int64>(0), /*read_mostly=*/true);
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<int64>(*GetOutput(0), test::AsScalar<int64>(0));
+
+  // A lock-free read of the same variable sees the incremented value.
+  TF_ASSERT_OK(NodeDefBuilder("op", "ReadVariableOp")
+                   .Input(FakeInput(DT_RESOURCE))
+                   .Attr("dtype", DT_INT64)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<int64>(*GetOutput(0), test::AsScalar<int64>(1));
+}
+
+TEST_F(ReadMostlyVariableTest, EnableWhileScattering) {
+  constexpr int kNumWriters = 4;
+  TF_ASSERT_OK(NodeDefBuilder("op", "ResourceScatterAdd")
+                   .Input(FakeInput(DT_RESOURCE))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("dtype", DT_FLOAT)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  Var* var = AddVariableInput(Params(), /*read_mostly=*/false);
+  AddInputFromArray<int32>(TensorShape({4}), {0, 1, 2, 3});
+  AddInputFromArray<float>(TensorShape({4, 2}), {1, 1, 1, 1, 1, 1, 1, 1});
+  const gtl::InlinedVector<TensorValue, 4> scatter_inputs = inputs_;
+
+  NodeDef enable_def;
+  TF_ASSERT_OK(NodeDefBuilder("enable", "EnableVariableReadMostly")
+                   .Input(FakeInput(DT_RESOURCE))
+                   .Finalize(&enable_def));
+  Status status;
+  std::unique_ptr<OpKernel> enable =
+      CreateOpKernel(DEVICE_CPU, device_, allocator(), enable_def,
+                     TF_GRAPH_DEF_VERSION, &status);
+  TF_ASSERT_OK(status);
+
+  std::atomic<bool> done{false};
+  std::atomic<int> num_scatters{0};
+  std::atomic<int> num_finished_writers{0};
+  std::atomic<int> num_unexpected_errors{0};
+  Status enable_status;
+  Tensor published_value;
+  {
+    thread::ThreadPool pool(Env::Default(), "writers", kNumWriters);
+    for (int i = 0; i < kNumWriters; ++i) {
+      pool.Schedule([&]() {
+        // Scatters succeed until the variable switches to read-mostly mode,
+        // and fail from then on.
+        while (!done.load()) {
+          Status s = RunConcurrently(kernel_.get(), scatter_inputs);
+          if (!s.ok()) {
+            if (!errors::IsFailedPrecondition(s)) ++num_unexpected_errors;
+            break;
+          }
+          ++num_scatters;
+        }
+        ++num_finished_writers;
+      });
+    }
+    while (num_scatters.load() < 10 * kNumWriters &&
+           num_finished_writers.load() < kNumWriters) {
+      Env::Default()->SleepForMicroseconds(100);
+    }
+    enable_status = RunConcurrently(enable.get(), {scatter_inputs[0]});
+    if (enable_status.ok()) {
+      ReadMostlyTensor::Reader reader(*var->read_mostly_tensor());
+      published_value = tensor::DeepCopy(reader.tensor());
+    } else {
+      done.store(true);
+    }
+  }
+  TF_ASSERT_OK(enable_status);
+  EXPECT_EQ(num_unexpected_errors.load(), 0);
+  // No scatter wrote to the published tensor after it was published.
+  ReadMostlyTensor::Reader reader(*var->read_mostly_tensor());
+  test::ExpectTensorEqual<float>(reader.tensor(), published_value);
+}
+
+TEST(ReadMostlyTensorTest, ReadersSeeWholePublishedTensors) {
+  constexpr int kNumReaders = 4;
+  constexpr int kNumWrites = 200;
+  ReadMostlyTensor read_mostly;
+  Tensor initial(DT_INT32, TensorShape({256}));
+  initial.flat<int32>().setZero();
+  read_mostly.Publish(initial);
+
+  std::atomic<bool> done{false};
+  std::atomic<int> num_errors{0};
+  {
+    thread::ThreadPool pool(Env::Default(), "readers", kNumReaders);
+    for (int i = 0; i < kNumReaders; ++i) {
+      pool.Schedule([&]() {
+        int last = 0;
+        while (!done.load()) {
+          ReadMostlyTensor::Reader reader(read_mostly);
+          auto values = reader.tensor().flat<int32>();
+          // Every published tensor is constant, and later ones hold larger
+          // values.
+          if (values(0) < last) ++num_errors;
+          for (int64 j = 0; j < values.size(); ++j) {
+            if (values(j) != values(0)) ++num_errors;
+          }
+          last = values(0);
+        }
+      });
+    }
+    for (int i = 1; i <= kNumWrites; ++i) {
+      Tensor value(DT_INT32, TensorShape({256}));
+      value.flat<int32>().setConstant(i);
+      read_mostly.Publish(value);
+    }
+    done.store(true);
+  }
+  EXPECT_EQ(num_errors.load(), 0);
+  ReadMostlyTensor::Reader reader(read_mostly);
+  EXPECT_EQ(reader.tensor().flat<int32>()(0), kNumWrites);
+}
+
+// Gathers `num_readers` small batches of rows concurrently from one variable.
+void BM_ConcurrentResourceGather(::testing::benchmark::State& state) {
+  const int num_readers = state.range(0);
+  const bool read_mostly = state.range(1);
+  constexpr int kVocabSize = 1 << 16;
+  constexpr int kDim = 64;
+  constexpr int kNumIds = 64;
+
+  auto add_var = [](Graph* g) {
+    Node* var;
+    TF_CHECK_OK(NodeBuilder(g->NewName("var"), "VarHandleOp")
+                    .Attr("dtype", DT_FLOAT)
+                    .Attr("shape", TensorShape({kVocabSize, kDim}))
+                    .Attr("shared_name", "embedding")
+                    .Finalize(g, &var));
+    return var;
+  };
+
+  Graph* init = new Graph(OpRegistry::Global());
+  Tensor params(DT_FLOAT, TensorShape({kVocabSize, kDim}));
+  params.flat<float>().setRandom();
+  Node* var = add_var(init);
+  Node* assign;
+  TF_CHECK_OK(NodeBuilder(init->NewName("assign"), "AssignVariableOp")
+                  .Input(var)
+                  .Input(test::graph::Constant(init, params))
+                  .Attr("dtype", DT_FLOAT)
+                  .Finalize(init, &assign));
+  if (read_mostly) {
+    Node* enable;
+    TF_CHECK_OK(NodeBuilder(init->NewName("enable"), "EnableVariableReadMostly")
+                    .Input(var)
+                    .ControlInput(assign)
+                    .Finalize(init, &enable));
+  }
+
+  Graph* g = new Graph(OpRegistry::Global());
+  var = add_var(g);
+  for (int r = 0; r < num_readers; ++r) {
+    Tensor ids(DT_INT32, TensorShape({kNumIds}));
+    for (int k = 0; k < kNumIds; ++k) {
+      ids.flat<int32>()(k) = (r * kNumIds + k) * 997 % kVocabSize;
+    }
+    Node* gather;
+    TF_CHECK_OK(NodeBuilder(g->NewName("gather"), "ResourceGather")
+                    .Input(var)
+                    .Input(test::graph::Constant(g, ids))
+                    .Attr("dtype", DT_FLOAT)
+                    .Finalize(g, &gather));
+  }
+
+  test::Benchmark("cpu", g, /*options=*/nullptr, init, nullptr, "",
+                  /*old_benchmark_api*/ false)
+      .Run(state);
+  state.SetItemsProcessed(static_cast<int64>(state.iterations()) *
+                          num_readers * kNumIds);
+}
+
+BENCHMARK(BM_ConcurrentResourceGather)
+    ->UseRealTime()
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(64, 0)
+    ->ArgPair(64, 1);
+
+}  // namespace
+}  // namespace tensorflow
@@ -77,6 +77,75 @@ extern bool UnsortedSegmentReductionDoValidation(OpKernel* op_kernel,
                                                  const Tensor& data,
                                                  const Tensor& segment_ids,
                                                  const Tensor& num_segments);
+
+// Run of equal ids [start, end) in sorted segment ids, which reduces into row
+// `segment` of the output.
+struct SegmentRun {
+  int64 start;
+  int64 end;
+  int64 segment;
+};
+
+// Splits sorted `segment_ids` into runs of equal ids. Fails if the ids are not
+// increasing, or not in [0, num_segments).
+template <typename SegmentId>
+Status SortedSegmentRuns(typename TTypes<SegmentId>::ConstVec segment_ids,
+                         int64 num_segments, std::vector<SegmentRun>* runs) {
+  runs->clear();
+  const int64 num_indices = segment_ids.size();
+  for (int64 i = 0; i < num_indices; ++i) {
+    const SegmentId segment = internal::SubtleMustCopy(segment_ids(i));
+    if (!runs->empty()) {
+      if (segment == runs->back().segment) {
+        runs->back().end = i + 1;
+        continue;
+      }
+      if (segment < runs->back().segment) {
+        return errors::InvalidArgument("segment ids are not increasing");
+      }
+    }
+    if (!FastBoundsCheck(segment, num_segments)) {
+      return errors::InvalidArgument(
+          "Segment id ", segment, " out of range [0, ", num_segments,
+          "), possibly because 'segment_ids' input is not sorted.");
+    }
+    runs->push_back({i, i + 1, segment});
+  }
+  return Status::OK();
+}
+
+// Calls `reduce(r, runs[r])` for each of the sorted `runs` in parallel on the
+// threads of `d`, after setting the output rows of the segments between the
+// previous run and this one to `default_value`. The output rows after the last
+// run are not set. `cost_per_row` is the cost of reducing one row of the input.
+template <typename T, typename Reduce>
+void ParallelReduceSegmentRuns(const CPUDevice& d,
+                               const std::vector<SegmentRun>& runs,
+                               const T& default_value,
+                               typename TTypes<T>::Matrix output,
+                               const Eigen::TensorOpCost& cost_per_row,
+                               Reduce reduce) {
+  if (runs.empty()) return;
+  const int64 num_col = output.dimension(1);
+  const int64 rows_per_run =
+      runs.back().end / static_cast<int64>(runs.size());
+  d.parallelFor(
+      runs.size(), cost_per_row * std::max<int64>(rows_per_run, 1),
+      [&](Eigen::Index begin, Eigen::Index end) {
+        for (Eigen::Index r = begin; r < end; ++r) {
+          const int64 gap_begin = r == 0 ? 0 : runs[r - 1].segment + 1;
+          if (runs[r].segment > gap_begin) {
+            Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
+                runs[r].segment - gap_begin, num_col);
+            Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>,
+                             Eigen::Unaligned>
+                gap_slice(&output(gap_begin, 0), gap_slice_shape);
+            gap_slice.setConstant(default_value);
+          }
+          reduce(r, runs[r]);
+        }
+      });
+}
 }  // namespace internal
 
 // This operator handles reducing segments along the first dimension.
@@ -128,80 +197,42 @@ class SegmentReductionOp : public OpKernel {
 #else
     Eigen::IndexList<Eigen::type2index<0> > dims_to_reduce;
 #endif
-    Index start = 0, end = 1;
 
-    Index uninitialized_index = 0;  // Index from which the output is not set.
-    Index out_index = internal::SubtleMustCopy(segment_vec(start));
+    std::vector<internal::SegmentRun> runs;
+    OP_REQUIRES_OK(context, internal::SortedSegmentRuns<Index>(
+                                segment_vec, output_rows, &runs));
 
-    // TODO(agarwal): if this loop becomes a bottleneck, consider sharding it
-    // across threads.
+    // Each segment is a run of consecutive input rows, reduced on a single
+    // thread, while distinct segments are reduced in parallel.
     Eigen::DSizes<Eigen::DenseIndex, 1> out_slice_shape(num_col);
-    while (end <= num_indices) {
-      // We initialize next_index to 0 to avoid "warning: 'next_index' may be
-      // used uninitialized in this function" in the Mac build (since the
-      // compiler isn't smart enough to realize the code is safe).
-      Index next_index = 0;
-      if (end < num_indices) {
-        next_index = internal::SubtleMustCopy(segment_vec(end));
-        if (out_index == next_index) {
-          ++end;
-          continue;
-        }
-        // We have a new segment here.  Verify that the segment ids are growing.
-        OP_REQUIRES(context, out_index < next_index,
-                    errors::InvalidArgument("segment ids are not increasing"));
-      }
-
-      // Process segment [start, end)
-      const T* in_slice_ptr = &input_flat(start, 0);
-      typedef Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
-                               Eigen::Unaligned>
-          OutT;
-
-      OP_REQUIRES(
-          context, FastBoundsCheck(out_index, output_rows),
-          errors::InvalidArgument(
-              "Segment id ", out_index, " out of range [0, ", output_rows,
-              "), possibly because 'segment_ids' input is not sorted."));
-
-      // If there is a gap between two indices, we need to set that gap to the
-      // default value.
-      if (out_index > uninitialized_index) {
-        Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
-            out_index - uninitialized_index, num_col);
-        Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>, Eigen::Unaligned>
-            gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
-        gap_slice.setConstant(T(default_value));
-      }
-
-      T* out_slice_ptr = &output_flat(out_index, 0);
-      OutT out_slice(out_slice_ptr, out_slice_shape);
-      // We don't use out_slice.device(context->eigen_device<Device>)
-      // because these pieces of work are likely to be very small and
-      // the context switching overhead dwarfs any benefit we get from
-      // using another thread to do this work.
-      if (start == end - 1) {
-        typedef Eigen::TensorMap<Eigen::Tensor<const T, 1, Eigen::RowMajor>,
-                                 Eigen::Unaligned>
-            InT;
-        InT in_slice(in_slice_ptr, out_slice_shape);
-        out_slice = in_slice;
-      } else {
-        Eigen::DSizes<Eigen::DenseIndex, 2> in_slice_shape(end - start,
-                                                           num_col);
-        typedef Eigen::TensorMap<Eigen::Tensor<const T, 2, Eigen::RowMajor>,
-                                 Eigen::Unaligned>
-            InT;
-        InT in_slice(in_slice_ptr, in_slice_shape);
-
-        out_slice = in_slice.reduce(dims_to_reduce, Reducer());
-      }
-      if (end >= num_indices) break;
-      start = end;
-      ++end;
-      uninitialized_index = out_index + 1;
-      out_index = next_index;
-    }
+    const Eigen::TensorOpCost cost_per_row(
+        num_col * sizeof(T), 0, num_col * Eigen::TensorOpCost::AddCost<T>());
+    internal::ParallelReduceSegmentRuns<T>(
+        context->eigen_device<Device>(), runs, T(default_value), output_flat,
+        cost_per_row, [&](int64 r, const internal::SegmentRun& run) {
+          const T* in_slice_ptr = &input_flat(run.start, 0);
+          typedef Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
+                                   Eigen::Unaligned>
+              OutT;
+          T* out_slice_ptr = &output_flat(run.segment, 0);
+          OutT out_slice(out_slice_ptr, out_slice_shape);
+          if (run.start == run.end - 1) {
+            typedef Eigen::TensorMap<
+                Eigen::Tensor<const T, 1, Eigen::RowMajor>, Eigen::Unaligned>
+                InT;
+            InT in_slice(in_slice_ptr, out_slice_shape);
+            out_slice = in_slice;
+          } else {
+            Eigen::DSizes<Eigen::DenseIndex, 2> in_slice_shape(
+                run.end - run.start, num_col);
+            typedef Eigen::TensorMap<
+                Eigen::Tensor<const T, 2, Eigen::RowMajor>, Eigen::Unaligned>
+                InT;
+            InT in_slice(in_slice_ptr, in_slice_shape);
+
+            out_slice = in_slice.reduce(dims_to_reduce, Reducer());
+          }
+        });
   }
 };
 
@@ -319,24 +350,73 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
                   typename TTypes<Index>::ConstFlat segment_ids,
                   typename TTypes<T, 2>::ConstTensor data,
                   typename TTypes<T, 2>::Tensor output) {
-    output.setConstant(InitialValueF()());
+    const CPUDevice& d = ctx->eigen_device<CPUDevice>();
+    output.device(d) = output.constant(InitialValueF()());
     if (data.size() == 0) {
       return;
     }
     const int64 N = segment_ids.dimension(0);
     const int64 num_segments = output.dimension(0);
-    ReductionF reduction;
+    const int64 num_col = output.dimension(1);
+    // Copy the ids before validating them, since the input may change
+    // concurrently. Negative ids are dropped.
+    std::vector<Index> ids(N);
     for (int64 i = 0; i < N; ++i) {
-      Index j = internal::SubtleMustCopy(segment_ids(i));
-      if (j < 0) {
-        continue;
-      }
-      OP_REQUIRES(ctx, FastBoundsCheck(j, num_segments),
+      const Index j = internal::SubtleMustCopy(segment_ids(i));
+      OP_REQUIRES(ctx, j < 0 || FastBoundsCheck(j, num_segments),
                   errors::InvalidArgument(
                       "segment_ids", SliceDebugString(segment_ids_shape, i),
                       " = ", j, " is out of range [0, ", num_segments, ")"));
-      reduction(data.template chip<0>(i), output.template chip<0>(j));
+      ids[i] = j;
+    }
+
+    ReductionF reduction;
+    const Eigen::TensorOpCost cost_per_row(
+        num_col * sizeof(T), num_col * sizeof(T),
+        num_col * Eigen::TensorOpCost::AddCost<T>());
+    const int num_threads =
+        Eigen::TensorCostModel<CPUDevice>::numThreads(N, cost_per_row,
+                                                      d.numThreads());
+    if (num_threads <= 1 || num_segments < 2) {
+      for (int64 i = 0; i < N; ++i) {
+        if (ids[i] < 0) continue;
+        reduction(data.template chip<0>(i), output.template chip<0>(ids[i]));
+      }
+      return;
+    }
+
+    // Partition the segments into contiguous ranges, each reduced by a single
+    // thread, and group the offsets by range with a counting sort. The offsets
+    // of each segment stay in order, so the result is the same as the serial
+    // scatter, and no two threads write the same output row.
+    const int64 segments_per_range =
+        Eigen::divup<int64>(num_segments, 4 * num_threads);
+    const int64 num_ranges = Eigen::divup(num_segments, segments_per_range);
+    std::vector<int64> range_starts(num_ranges + 1, 0);
+    for (int64 i = 0; i < N; ++i) {
+      if (ids[i] >= 0) ++range_starts[ids[i] / segments_per_range + 1];
+    }
+    for (int64 r = 0; r < num_ranges; ++r) {
+      range_starts[r + 1] += range_starts[r];
     }
+    std::vector<int64> offsets(range_starts.back());
+    {
+      std::vector<int64> range_ends(range_starts.begin(),
+                                    range_starts.end() - 1);
+      for (int64 i = 0; i < N; ++i) {
+        if (ids[i] >= 0) offsets[range_ends[ids[i] / segments_per_range]++] = i;
+      }
+    }
+
+    d.parallelFor(num_ranges, cost_per_row * (N / num_ranges),
+                  [&](Eigen::Index begin, Eigen::Index end) {
+                    for (int64 k = range_starts[begin]; k < range_starts[end];
+                         ++k) {
+                      const int64 i = offsets[k];
+                      reduction(data.template chip<0>(i),
+                                output.template chip<0>(ids[i]));
+                    }
+                  });
   }
 };
 
@@ -514,61 +594,35 @@ class SparseSegmentReductionOpBase : public OpKernel {
     }
     auto temp_flat = temp.flat_outer_dims<float>();
 
-    int64 start = 0, end = 1;
-    // Index from which the output is not initialized.
-    SegmentId uninitialized_index = 0;
-    SegmentId out_index = internal::SubtleMustCopy(segment_vec(start));
-
-    while (true) {
-      // We initialize next_index to 0 to avoid "warning: 'next_index' may be
-      // used uninitialized in this function" in the Mac build (since the
-      // compiler isn't smart enough to realize the code is safe).
-      SegmentId next_index = 0;
-      if (end < num_indices) {
-        next_index = internal::SubtleMustCopy(segment_vec(end));
-        if (out_index == next_index) {
-          ++end;
-          continue;
-        }
-        // We have a new segment here.  Verify that the segment ids are growing.
-        OP_REQUIRES(context, out_index < next_index,
-                    errors::InvalidArgument("segment ids are not increasing"));
-      }
-
-      OP_REQUIRES(
-          context, FastBoundsCheck(out_index, output_rows),
-          errors::InvalidArgument(
-              "Segment id ", out_index, " out of range [0, ", output_rows,
-              "), possibly because 'segment_ids' input is not sorted."));
-
-      // If there is a gap between two indices, we need to set that gap to the
-      // default value.
-      if (out_index > uninitialized_index) {
-        Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
-            out_index - uninitialized_index, num_col);
-        Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>, Eigen::Unaligned>
-            gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
-        gap_slice.setConstant(default_value_);
-      }
-
-      auto out = output_flat.template chip<0>(out_index);
-      auto temp = temp_flat.template chip<0>(out_index);
-      const int bad_offset = Reduce<T, Index>(input_flat, indices_vec, start,
-                                              end - start, out, temp);
+    std::vector<internal::SegmentRun> runs;
+    OP_REQUIRES_OK(context, internal::SortedSegmentRuns<SegmentId>(
+                                segment_vec, output_rows, &runs));
+
+    // Segments are reduced in parallel. Each one records the offset of its
+    // first bad index, so that the error reported is the same as when
+    // reducing them in order.
+    std::vector<int64> bad_offsets(runs.size());
+    const Eigen::TensorOpCost cost_per_row(
+        num_col * sizeof(T), 0, num_col * Eigen::TensorOpCost::AddCost<T>());
+    internal::ParallelReduceSegmentRuns<T>(
+        context->eigen_device<Device>(), runs, default_value_, output_flat,
+        cost_per_row, [&](int64 r, const internal::SegmentRun& run) {
+          auto out = output_flat.template chip<0>(run.segment);
+          auto temp = temp_flat.template chip<0>(run.segment);
+          bad_offsets[r] = Reduce<T, Index>(input_flat, indices_vec, run.start,
+                                            run.end - run.start, out, temp);
+        });
+    for (size_t r = 0; r < runs.size(); ++r) {
+      const int64 bad_offset = bad_offsets[r];
       OP_REQUIRES(context, bad_offset < 0,
                   errors::InvalidArgument(
-                      "Bad: indices[", start + bad_offset,
-                      "] == ", indices_vec(start + bad_offset),
+                      "Bad: indices[", runs[r].start + bad_offset,
+                      "] == ", indices_vec(runs[r].start + bad_offset),
                       " out of range [0, ", input_flat.dimension(0), ")"));
-
-      start = end;
-      ++end;
-      uninitialized_index = out_index + 1;
-      out_index = next_index;
-      if (end > num_indices) break;
     }
 
     // Fill the gap at the end with the default value.
+    const int64 uninitialized_index = runs.back().segment + 1;
     if (uninitialized_index < output_rows) {
       Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
           output_rows - uninitialized_index, num_col);
@@ -16,6 +16,7 @@ limitations under the License.
 #include <functional>
 #include <vector>
 
+#include "absl/strings/match.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
@@ -31,6 +32,8 @@ limitations under the License.
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session_options.h"
@@ -38,6 +41,109 @@ limitations under the License.
 
 namespace tensorflow {
 
+class SegmentReductionOpTest : public OpsTestBase {};
+
+// Large enough for the segments to be reduced on multiple threads.
+TEST_F(SegmentReductionOpTest, UnsortedSegmentSumLargeInput) {
+  constexpr int64 kNumRows = 1 << 14;
+  constexpr int64 kNumCols = 16;
+  constexpr int64 kNumSegments = 100;
+  TF_ASSERT_OK(NodeDefBuilder("op", "UnsortedSegmentSum")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_INT32))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+
+  std::vector<float> data(kNumRows * kNumCols);
+  std::vector<int32> segment_ids(kNumRows);
+  std::vector<double> expected(kNumSegments * kNumCols, 0.0);
+  for (int64 i = 0; i < kNumRows; ++i) {
+    // Skewed towards the first segments, with some dropped negative ids.
+    segment_ids[i] =
+        i % 7 == 0 ? -1 : (i * i) % (i % 3 == 0 ? 3 : kNumSegments);
+    for (int64 j = 0; j < kNumCols; ++j) {
+      data[i * kNumCols + j] = (i + j) % 11 - 5;
+      if (segment_ids[i] >= 0) {
+        expected[segment_ids[i] * kNumCols + j] += data[i * kNumCols + j];
+      }
+    }
+  }
+  AddInputFromArray<float>(TensorShape({kNumRows, kNumCols}), data);
+  AddInputFromArray<int32>(TensorShape({kNumRows}), segment_ids);
+  AddInputFromArray<int32>(TensorShape({}), {kNumSegments});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_tensor(allocator(), DT_FLOAT,
+                         TensorShape({kNumSegments, kNumCols}));
+  test::FillValues<float>(&expected_tensor,
+                          std::vector<float>(expected.begin(), expected.end()));
+  test::ExpectTensorEqual<float>(expected_tensor, *GetOutput(0));
+}
+
+TEST_F(SegmentReductionOpTest, SparseSegmentMeanLargeInputWithGaps) {
+  constexpr int64 kNumRows = 1000;
+  constexpr int64 kNumCols = 32;
+  constexpr int64 kNumIndices = 1 << 14;
+  TF_ASSERT_OK(NodeDefBuilder("op", "SparseSegmentMean")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_INT32))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+
+  std::vector<float> data(kNumRows * kNumCols);
+  for (int64 i = 0; i < kNumRows * kNumCols; ++i) data[i] = i % 13;
+  std::vector<int32> indices(kNumIndices);
+  std::vector<int32> segment_ids(kNumIndices);
+  for (int64 i = 0; i < kNumIndices; ++i) {
+    indices[i] = (i * 31) % kNumRows;
+    // Every third segment is empty.
+    segment_ids[i] = (i / 5) * 3 / 2;
+  }
+  const int64 num_segments = segment_ids.back() + 1;
+  std::vector<double> sums(num_segments * kNumCols, 0.0);
+  std::vector<int64> counts(num_segments, 0);
+  for (int64 i = 0; i < kNumIndices; ++i) {
+    ++counts[segment_ids[i]];
+    for (int64 j = 0; j < kNumCols; ++j) {
+      sums[segment_ids[i] * kNumCols + j] += data[indices[i] * kNumCols + j];
+    }
+  }
+  std::vector<float> expected(num_segments * kNumCols, 0.0f);
+  for (int64 k = 0; k < num_segments; ++k) {
+    for (int64 j = 0; j < kNumCols; ++j) {
+      if (counts[k] > 0) {
+        expected[k * kNumCols + j] = sums[k * kNumCols + j] / counts[k];
+      }
+    }
+  }
+  AddInputFromArray<float>(TensorShape({kNumRows, kNumCols}), data);
+  AddInputFromArray<int32>(TensorShape({kNumIndices}), indices);
+  AddInputFromArray<int32>(TensorShape({kNumIndices}), segment_ids);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_tensor(allocator(), DT_FLOAT,
+                         TensorShape({num_segments, kNumCols}));
+  test::FillValues<float>(&expected_tensor, expected);
+  test::ExpectTensorNear<float>(expected_tensor, *GetOutput(0), 1e-5);
+}
+
+TEST_F(SegmentReductionOpTest, SparseSegmentSumReportsFirstBadIndex) {
+  TF_ASSERT_OK(NodeDefBuilder("op", "SparseSegmentSum")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_INT32))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<float>(TensorShape({3, 2}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 7, 1, 9});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 0, 1, 2});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "indices[1] == 7")) << s;
+}
+
 template <typename Index>
 static void BM_SegmentReduction(::testing::benchmark::State& state,
                                 const string& reduction, Index num_rows,
@@ -168,4 +274,77 @@ static void BM_SparseSegmentMeanGrad_High(::testing::benchmark::State& state) {
 BENCHMARK(BM_SparseSegmentMeanGrad_Low)->UseRealTime()->Arg(1000)->Arg(100000);
 BENCHMARK(BM_SparseSegmentMeanGrad_High)->UseRealTime()->Arg(1000)->Arg(100000);
 
+// Reduces kNumRows rows of the given width into num_segments segments, with
+// random unsorted ids, or sorted ids of sparse segments of random rows.
+static Graph* SegmentReductionGraph(const string& op, int num_segments,
+                                    int num_cols) {
+  constexpr int kNumRows = 1 << 16;
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor data(DT_FLOAT, TensorShape({kNumRows, num_cols}));
+  data.flat<float>().setRandom();
+  Tensor indices(DT_INT32, TensorShape({kNumRows}));
+  Tensor segment_ids(DT_INT32, TensorShape({kNumRows}));
+  auto indices_flat = indices.flat<int32>();
+  auto segment_ids_flat = segment_ids.flat<int32>();
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  for (int i = 0; i < kNumRows; ++i) {
+    indices_flat(i) = rnd.Uniform(kNumRows);
+    segment_ids_flat(i) = op == "UnsortedSegmentSum"
+                              ? rnd.Uniform(num_segments)
+                              : static_cast<int64>(i) * num_segments / kNumRows;
+  }
+
+  Node* node;
+  if (op == "UnsortedSegmentSum") {
+    Tensor num_segments_t(DT_INT32, TensorShape({}));
+    num_segments_t.scalar<int32>()() = num_segments;
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), op)
+                    .Input(test::graph::Constant(g, data))
+                    .Input(test::graph::Constant(g, segment_ids))
+                    .Input(test::graph::Constant(g, num_segments_t))
+                    .Finalize(g, &node));
+  } else {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), op)
+                    .Input(test::graph::Constant(g, data))
+                    .Input(test::graph::Constant(g, indices))
+                    .Input(test::graph::Constant(g, segment_ids))
+                    .Finalize(g, &node));
+  }
+  return g;
+}
+
+static void SegmentReductionHelper(::testing::benchmark::State& state,
+                                   const string& op) {
+  const int num_segments = state.range(0);
+  const int num_cols = state.range(1);
+  test::Benchmark("cpu", SegmentReductionGraph(op, num_segments, num_cols),
+                  /*old_benchmark_api*/ false)
+      .Run(state);
+  state.SetBytesProcessed(static_cast<int64>(state.iterations()) * (1 << 16) *
+                          num_cols * sizeof(float));
+}
+
+static void BM_UnsortedSegmentSum(::testing::benchmark::State& state) {
+  SegmentReductionHelper(state, "UnsortedSegmentSum");
+}
+
+static void BM_SparseSegmentMean(::testing::benchmark::State& state) {
+  SegmentReductionHelper(state, "SparseSegmentMean");
+}
+
+#define BM_SegmentReductionArgs(BM) \
+  BENCHMARK(BM)                     \
+      ->UseRealTime()               \
+      ->ArgPair(16, 8)              \
+      ->ArgPair(16, 64)             \
+      ->ArgPair(1024, 8)            \
+      ->ArgPair(1024, 64)           \
+      ->ArgPair(1024, 512)          \
+      ->ArgPair(16384, 8)           \
+      ->ArgPair(16384, 64)
+
+BM_SegmentReductionArgs(BM_UnsortedSegmentSum);
+BM_SegmentReductionArgs(BM_SparseSegmentMean);
+
 }  // namespace tensorflow
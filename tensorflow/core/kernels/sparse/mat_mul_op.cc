@@ -258,6 +258,36 @@ class CSRMatMulCPUOp : public CSRMatMulOp<CPUDevice, T> {
     return Status::OK();
   }
 
+  // Contiguous range of rows [row_begin, row_end) of a batch of the CSR Sparse
+  // Matrix, multiplied by a single thread.
+  struct RowShard {
+    int64 batch_idx;
+    int64 row_begin;
+    int64 row_end;
+  };
+
+  // Splits the rows of the given batch of the CSR Sparse Matrix into at most
+  // `num_shards` shards with about the same number of nonzeros, each row also
+  // counting as one nonzero, and appends them to `shards`.
+  void AppendRowBalancedShards(const CSRSparseMatrix& csr_matrix,
+                               const int batch_index, const int64 num_shards,
+                               std::vector<RowShard>* shards) {
+    auto row_ptrs = csr_matrix.row_pointers_vec(batch_index);
+    const int64 num_rows = row_ptrs.size() - 1;
+    const int64 total_work = row_ptrs(num_rows) - row_ptrs(0) + num_rows;
+    int64 row_begin = 0;
+    int64 num_batch_shards = 0;
+    for (int64 row = 1; row <= num_rows; ++row) {
+      const int64 work = row_ptrs(row) - row_ptrs(0) + row;
+      if (row == num_rows ||
+          work * num_shards >= total_work * (num_batch_shards + 1)) {
+        shards->push_back({batch_index, row_begin, row});
+        row_begin = row;
+        ++num_batch_shards;
+      }
+    }
+  }
+
   // Returns an Eigen::Ref expression of a sparse sub-matrix from the given
   // contiguous segment of rows of the CSR Sparse Matrix.
   Eigen::Ref<const SparseMatrix> GetSparseMatrixRef(
@@ -288,45 +318,49 @@ class CSRMatMulCPUOp : public CSRMatMulOp<CPUDevice, T> {
       OpKernelContext* ctx, const int64 batch_size, const int64 num_lhs_rows,
       const CSRSparseMatrix& lhs, const Tensor& rhs, Tensor* output) {
     // Parallelize matrix multiplication across batch dimensions and across
-    // rows in each batch.
+    // rows in each batch. Rows are split by their number of nonzeros, so that
+    // a few dense rows do not end up in the same shard.
     auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
     const int32 num_threads = worker_threads.num_threads;
-    const int64 block_size =
-        num_lhs_rows / std::max(kMaxShards, kNumShardsPerThread * num_threads);
+    const int64 num_shards_per_batch = std::min<int64>(
+        num_lhs_rows, std::max(kMaxShards, kNumShardsPerThread * num_threads));
     const int64 num_rhs_rows = rhs.dim_size(rhs.dims() - 2);
     const int64 num_rhs_cols = rhs.dim_size(rhs.dims() - 1);
+    std::vector<RowShard> shards;
+    for (int64 batch_idx = 0; batch_idx < batch_size; ++batch_idx) {
+      AppendRowBalancedShards(lhs, batch_idx, num_shards_per_batch, &shards);
+    }
     worker_threads.workers->ParallelFor(
-        batch_size * num_lhs_rows /* total */,
+        shards.size() /* total */,
         thread::ThreadPool::SchedulingParams(
             thread::ThreadPool::SchedulingStrategy::
                 kFixedBlockSize /* strategy */,
-            absl::nullopt /* cost_per_unit */, block_size),
-        [&](int64 batch_and_row_begin, int64 batch_and_row_end) {
-          HandleBatchAndRowRange(
-              num_lhs_rows, batch_and_row_begin, batch_and_row_end,
-              [&](int64 batch_idx, int64 row_begin, int64 row_end) {
-                const int64 num_shard_rows = row_end - row_begin;
-
-                // Define an Eigen::SparseMatrix over the row range:
-                // [row_begin, row_end) of the CSR SparseMatrix A.
-                std::vector<int32> row_ptrs;
-                auto sparse_matrix = GetSparseMatrixRef(
-                    lhs, batch_idx, row_begin, num_shard_rows, &row_ptrs);
-
-                // Map the corresponding rows of the rhs.
-                ConstMatrixMap rhs_map(rhs.flat<T>().data() + batch_idx *
-                                                                  num_rhs_rows *
-                                                                  num_rhs_cols,
-                                       num_rhs_rows, num_rhs_cols);
-
-                // Write to the corresponding rows of the output matrix.
-                MatrixMap output_map(
-                    output->flat<T>().data() +
-                        batch_idx * num_lhs_rows * num_rhs_cols +
-                        row_begin * num_rhs_cols,
-                    num_shard_rows, num_rhs_cols);
-                output_map.noalias() = sparse_matrix * rhs_map;
-              });
+            absl::nullopt /* cost_per_unit */, 1 /* block_size */),
+        [&](int64 shard_begin, int64 shard_end) {
+          for (int64 shard = shard_begin; shard < shard_end; ++shard) {
+            const int64 batch_idx = shards[shard].batch_idx;
+            const int64 row_begin = shards[shard].row_begin;
+            const int64 num_shard_rows = shards[shard].row_end - row_begin;
+
+            // Define an Eigen::SparseMatrix over the row range:
+            // [row_begin, row_end) of the CSR SparseMatrix A.
+            std::vector<int32> row_ptrs;
+            auto sparse_matrix = GetSparseMatrixRef(
+                lhs, batch_idx, row_begin, num_shard_rows, &row_ptrs);
+
+            // Map the corresponding rows of the rhs.
+            ConstMatrixMap rhs_map(
+                rhs.flat<T>().data() + batch_idx * num_rhs_rows * num_rhs_cols,
+                num_rhs_rows, num_rhs_cols);
+
+            // Write to the corresponding rows of the output matrix.
+            MatrixMap output_map(
+                output->flat<T>().data() +
+                    batch_idx * num_lhs_rows * num_rhs_cols +
+                    row_begin * num_rhs_cols,
+                num_shard_rows, num_rhs_cols);
+            output_map.noalias() = sparse_matrix * rhs_map;
+          }
         });
   }
 
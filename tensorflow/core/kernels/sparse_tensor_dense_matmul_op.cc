@@ -19,6 +19,8 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/sparse_tensor_dense_matmul_op.h"
 
+#include <vector>
+
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -245,6 +247,12 @@ template <typename T, typename Tindices, bool ADJ_A, bool ADJ_B>
 struct SparseTensorDenseMatMulFunctor<CPUDevice, T, Tindices, ADJ_A, ADJ_B> {
   // Vectorize certain operations above this size.
   static constexpr std::size_t kNumVectorize = 32;
+  // Multiply on multiple threads above this number of multiply-adds.
+  static constexpr int64 kMinParallelWork = 1 << 16;
+  // Number of shards of output rows allocated to each thread.
+  static constexpr int64 kNumShardsPerThread = 4;
+  // Size in bytes of the tile of an output row that is accumulated at once.
+  static constexpr int64 kTileBytes = 16 << 10;
 
   static Status Compute(const CPUDevice& d, typename TTypes<T>::Matrix out,
                         typename TTypes<Tindices>::ConstMatrix a_indices,
@@ -256,11 +264,12 @@ struct SparseTensorDenseMatMulFunctor<CPUDevice, T, Tindices, ADJ_A, ADJ_B> {
     const int lhs_index_a = ADJ_A ? 1 : 0;
     const int rhs_index_a = ADJ_A ? 0 : 1;
 
-    out.setZero();
+    if (d.numThreads() > 1 && rhs_right >= kNumVectorize &&
+        static_cast<int64>(nnz * rhs_right) >= kMinParallelWork) {
+      return ComputeParallel(d, out, a_indices, a_values, b);
+    }
 
-    // TODO(ebrevdo): After many failed experiments, can't find a multi-threaded
-    // approach that achieves the performance of the single threaded
-    // one.  Perhaps Eigen threadpool implementation is just too slow?
+    out.setZero();
 
     if (rhs_right < kNumVectorize) {
       // Disable vectorization if the RHS of output is too small
@@ -314,6 +323,114 @@ struct SparseTensorDenseMatMulFunctor<CPUDevice, T, Tindices, ADJ_A, ADJ_B> {
     }
     return Status::OK();
   }
+
+ private:
+  // Groups the nonzeros of A by output row, i.e. converts A (or A^H) to CSR,
+  // and splits the output rows into shards with about the same number of
+  // nonzeros. Each shard accumulates its output rows one tile of columns at a
+  // time, so that the tile stays in cache while the rows of B are added to it.
+  // Nonzeros of a row keep their input order, so each output element is
+  // summed in the same order as on a single thread.
+  static Status ComputeParallel(
+      const CPUDevice& d, typename TTypes<T>::Matrix out,
+      typename TTypes<Tindices>::ConstMatrix a_indices,
+      typename TTypes<T>::ConstVec a_values,
+      typename TTypes<T>::ConstMatrix b) {
+    const int64 nnz = a_values.size();
+    const int64 num_rows = out.dimension(0);
+    const int64 num_cols = out.dimension(1);
+    const int64 lhs_right = (ADJ_B ? b.dimension(1) : b.dimension(0));
+    const int lhs_index_a = ADJ_A ? 1 : 0;
+    const int rhs_index_a = ADJ_A ? 0 : 1;
+
+    // Copy and validate the indices, and count the nonzeros of each row.
+    std::vector<Tindices> rows(nnz);
+    std::vector<Tindices> cols(nnz);
+    std::vector<int64> row_starts(num_rows + 1, 0);
+    for (int64 i = 0; i < nnz; ++i) {
+      const Tindices m = internal::SubtleMustCopy(a_indices(i, lhs_index_a));
+      const Tindices k = internal::SubtleMustCopy(a_indices(i, rhs_index_a));
+      if (!FastBoundsCheck(k, lhs_right)) {
+        return KOutOfBoundsError(k, i, rhs_index_a, lhs_right);
+      }
+      if (!FastBoundsCheck(m, num_rows)) {
+        return MOutOfBoundsError(m, i, lhs_index_a, num_rows);
+      }
+      rows[i] = m;
+      cols[i] = k;
+      ++row_starts[m + 1];
+    }
+    for (int64 m = 0; m < num_rows; ++m) {
+      row_starts[m + 1] += row_starts[m];
+    }
+
+    std::vector<Tindices> csr_cols(nnz);
+    std::vector<T> csr_values(nnz);
+    {
+      std::vector<int64> next(row_starts.begin(), row_starts.end() - 1);
+      for (int64 i = 0; i < nnz; ++i) {
+        const int64 j = next[rows[i]]++;
+        csr_cols[j] = cols[i];
+        csr_values[j] = ADJ_A ? MaybeConj(a_values(i)) : a_values(i);
+      }
+    }
+
+    // Transpose and conjugate B once, so that its rows are contiguous.
+    Eigen::Tensor<T, 2, Eigen::RowMajor> b_adjoint;
+    const T* b_data = b.data();
+    if (ADJ_B) {
+      b_adjoint.resize(lhs_right, num_cols);
+      Eigen::array<int, 2> shuffle = {1, 0};
+      b_adjoint.device(d) = b.shuffle(shuffle).conjugate();
+      b_data = b_adjoint.data();
+    }
+
+    // Split the rows into shards of about the same amount of work, counting
+    // each row as one nonzero since it is zeroed.
+    const int64 num_shards =
+        std::min(num_rows, kNumShardsPerThread * d.numThreads());
+    const int64 total_work = nnz + num_rows;
+    std::vector<int64> shard_starts = {0};
+    for (int64 m = 1; m < num_rows; ++m) {
+      const int64 work = row_starts[m] + m;
+      if (work * num_shards >=
+          total_work * static_cast<int64>(shard_starts.size())) {
+        shard_starts.push_back(m);
+      }
+    }
+    shard_starts.push_back(num_rows);
+
+    const int64 tile_cols =
+        std::max<int64>(kNumVectorize, kTileBytes / sizeof(T));
+    auto multiply_shards = [&](Eigen::Index first, Eigen::Index last) {
+      const int64 row_begin = shard_starts[first];
+      const int64 row_end = shard_starts[last];
+      for (int64 col = 0; col < num_cols; col += tile_cols) {
+        const int64 tile = std::min(tile_cols, num_cols - col);
+        for (int64 m = row_begin; m < row_end; ++m) {
+          typename TTypes<T>::UnalignedVec out_tile(
+              out.data() + m * num_cols + col, tile);
+          out_tile.setZero();
+          for (int64 j = row_starts[m]; j < row_starts[m + 1]; ++j) {
+            typename TTypes<T>::UnalignedConstVec b_tile(
+                b_data + csr_cols[j] * num_cols + col, tile);
+            out_tile += b_tile * csr_values[j];
+          }
+        }
+      }
+    };
+
+    const double work_per_shard =
+        static_cast<double>(total_work) / (shard_starts.size() - 1);
+    const Eigen::TensorOpCost cost(
+        work_per_shard * num_cols * sizeof(T),
+        work_per_shard * num_cols * sizeof(T),
+        work_per_shard * num_cols *
+            (Eigen::TensorOpCost::AddCost<T>() +
+             Eigen::TensorOpCost::MulCost<T>()));
+    d.parallelFor(shard_starts.size() - 1, cost, multiply_shards);
+    return Status::OK();
+  }
 };
 
 }  // namespace functor
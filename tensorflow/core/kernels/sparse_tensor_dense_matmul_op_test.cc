@@ -15,14 +15,122 @@ limitations under the License.
 
 #include <random>
 
+#include "absl/strings/match.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 
+class SparseTensorDenseMatMulTest : public OpsTestBase {
+ protected:
+  // Multiplies a random [m, k] sparse matrix, with most nonzeros in its first
+  // rows, by a random [k, n] dense matrix, and checks the result against a
+  // naive product. The problem is large enough to run on multiple threads.
+  void RunSkewedProduct(bool adjoint_a, bool adjoint_b) {
+    constexpr int64 m = 67;
+    constexpr int64 k = 129;
+    constexpr int64 n = 96;
+    constexpr int64 nnz = 3000;
+    TF_ASSERT_OK(NodeDefBuilder("matmul", "SparseTensorDenseMatMul")
+                     .Input(FakeInput(DT_INT64))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT64))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Attr("adjoint_a", adjoint_a)
+                     .Attr("adjoint_b", adjoint_b)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> value_dist(-1.0f, 1.0f);
+    std::uniform_real_distribution<double> row_dist(0.0, 1.0);
+    std::uniform_int_distribution<int64> col_dist(0, k - 1);
+    std::vector<int64> a_indices;
+    std::vector<float> a_values;
+    std::vector<double> expected(m * n, 0.0);
+    std::vector<float> b(k * n);
+    for (float& v : b) v = value_dist(gen);
+    for (int64 i = 0; i < nnz; ++i) {
+      const int64 row = static_cast<int64>(m * std::pow(row_dist(gen), 4));
+      const int64 col = col_dist(gen);
+      const float value = value_dist(gen);
+      a_indices.push_back(adjoint_a ? col : row);
+      a_indices.push_back(adjoint_a ? row : col);
+      a_values.push_back(value);
+      for (int64 j = 0; j < n; ++j) {
+        expected[row * n + j] += value * b[col * n + j];
+      }
+    }
+
+    AddInputFromArray<int64>(TensorShape({nnz, 2}), a_indices);
+    AddInputFromArray<float>(TensorShape({nnz}), a_values);
+    AddInputFromArray<int64>(TensorShape({2}),
+                             {adjoint_a ? k : m, adjoint_a ? m : k});
+    if (adjoint_b) {
+      std::vector<float> b_transposed(n * k);
+      for (int64 i = 0; i < k; ++i) {
+        for (int64 j = 0; j < n; ++j) b_transposed[j * k + i] = b[i * n + j];
+      }
+      AddInputFromArray<float>(TensorShape({n, k}), b_transposed);
+    } else {
+      AddInputFromArray<float>(TensorShape({k, n}), b);
+    }
+    TF_ASSERT_OK(RunOpKernel());
+
+    Tensor expected_tensor(allocator(), DT_FLOAT, TensorShape({m, n}));
+    test::FillValues<float>(
+        &expected_tensor, std::vector<float>(expected.begin(), expected.end()));
+    test::ExpectTensorNear<float>(expected_tensor, *GetOutput(0), 1e-3);
+  }
+};
+
+TEST_F(SparseTensorDenseMatMulTest, SkewedRows) {
+  RunSkewedProduct(false, false);
+}
+
+TEST_F(SparseTensorDenseMatMulTest, SkewedRowsAdjointA) {
+  RunSkewedProduct(true, false);
+}
+
+TEST_F(SparseTensorDenseMatMulTest, SkewedRowsAdjointB) {
+  RunSkewedProduct(false, true);
+}
+
+TEST_F(SparseTensorDenseMatMulTest, SkewedRowsAdjointAB) {
+  RunSkewedProduct(true, true);
+}
+
+TEST_F(SparseTensorDenseMatMulTest, OutOfBoundsIndex) {
+  TF_ASSERT_OK(NodeDefBuilder("matmul", "SparseTensorDenseMatMul")
+                   .Input(FakeInput(DT_INT64))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_INT64))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("adjoint_a", false)
+                   .Attr("adjoint_b", false)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  // Enough work to run on multiple threads, with the last index out of bounds.
+  constexpr int64 nnz = 2048;
+  std::vector<int64> a_indices(2 * nnz, 0);
+  a_indices[2 * nnz - 1] = 8;
+  AddInputFromArray<int64>(TensorShape({nnz, 2}), a_indices);
+  AddInputFromArray<float>(TensorShape({nnz}), std::vector<float>(nnz, 1.0f));
+  AddInputFromArray<int64>(TensorShape({2}), {4, 8});
+  AddInputFromArray<float>(TensorShape({8, 64}), std::vector<float>(8 * 64));
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "out of bounds")) << s;
+}
+
 Node* SparseTensorDenseMatMulNode(Graph* g, Node* a_indices, Node* a_values,
                                   Node* a_shape, Node* b, bool adjoint_a,
                                   bool adjoint_b) {
@@ -117,4 +225,68 @@ BM_SparseTensorDenseMatmul(16384, 4096, 4096, 4096, false, true);
 BM_SparseTensorDenseMatmul(16384, 4096, 4096, 4096, true, false);
 BM_SparseTensorDenseMatmul(16384, 4096, 4096, 4096, true, true);
 
+// Multiplies a [m, k] sparse matrix with `nnz` nonzeros by a [k, n] dense
+// matrix. The rows of the nonzeros are uniform, or follow a power law when
+// `skewed` is set, as in the embeddings of wide and deep models.
+static Graph* SparseTensorDenseMatmulPattern(int nnz, int m, int k, int n,
+                                             bool skewed) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor a_values(DT_FLOAT, TensorShape({nnz}));
+  Tensor a_indices(DT_INT64, TensorShape({nnz, 2}));
+  Tensor a_shape(DT_INT64, TensorShape({2}));
+  a_shape.vec<int64>().setValues({m, k});
+  a_values.flat<float>().setRandom();
+  auto a_indices_t = a_indices.matrix<int64>();
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> row_dist(0.0, 1.0);
+  std::uniform_int_distribution<int64> col_dist(0, k - 1);
+  for (int32 i = 0; i < nnz; ++i) {
+    const double u = row_dist(gen);
+    a_indices_t(i, 0) = static_cast<int64>(m * (skewed ? std::pow(u, 4) : u));
+    a_indices_t(i, 1) = col_dist(gen);
+  }
+  Tensor b(DT_FLOAT, TensorShape({k, n}));
+  b.flat<float>().setRandom();
+
+  SparseTensorDenseMatMulNode(
+      g, test::graph::Constant(g, a_indices),
+      test::graph::Constant(g, a_values), test::graph::HostConstant(g, a_shape),
+      test::graph::Constant(g, b), false, false);
+  return g;
+}
+
+static void SparseTensorDenseMatmulByPattern(::testing::benchmark::State& state,
+                                             bool skewed) {
+  const int nnz = state.range(0);
+  const int n = state.range(1);
+  test::Benchmark("cpu",
+                  SparseTensorDenseMatmulPattern(nnz, 4096, 4096, n, skewed),
+                  /*old_benchmark_api*/ false)
+      .Run(state);
+  const int64 tot = static_cast<int64>(state.iterations()) * nnz * n;
+  state.SetItemsProcessed(tot);
+  state.SetBytesProcessed(tot * sizeof(float));
+}
+
+static void BM_SparseTensorDenseMatmulUniform(
+    ::testing::benchmark::State& state) {
+  SparseTensorDenseMatmulByPattern(state, /*skewed=*/false);
+}
+
+static void BM_SparseTensorDenseMatmulSkewed(
+    ::testing::benchmark::State& state) {
+  SparseTensorDenseMatmulByPattern(state, /*skewed=*/true);
+}
+
+#define BM_SparseTensorDenseMatmulPatternArgs(BM) \
+  BENCHMARK(BM)                                   \
+      ->UseRealTime()                             \
+      ->ArgPair(16384, 16)                        \
+      ->ArgPair(16384, 128)                       \
+      ->ArgPair(16384, 1024)                      \
+      ->ArgPair(262144, 128)
+
+BM_SparseTensorDenseMatmulPatternArgs(BM_SparseTensorDenseMatmulUniform);
+BM_SparseTensorDenseMatmulPatternArgs(BM_SparseTensorDenseMatmulSkewed);
+
 }  // end namespace tensorflow
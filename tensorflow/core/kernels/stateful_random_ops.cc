@@ -107,6 +107,7 @@ Status UpdateVariableAndFill(
   }
   if (alg == RNG_ALG_PHILOX) {
     TF_RETURN_IF_ERROR(CheckPhiloxState(*var_tensor, alg_tag_skip));
+    TF_RETURN_IF_ERROR(ValidateVariableForUpdate(var));
     TF_RETURN_IF_ERROR(PrepareToUpdateVariable<Device, StateElementType>(
         ctx, var_tensor, var->copy_on_read_mode.load()));
 
@@ -280,6 +281,7 @@ class RngSkipOp : public OpKernel {
     Tensor* var_tensor = var->tensor();
     OP_REQUIRES_OK(ctx, CheckState(*var_tensor));
     using T = StateElementType;
+    OP_REQUIRES_OK(ctx, ValidateVariableForUpdate(var));
     OP_REQUIRES_OK(ctx, PrepareToUpdateVariable<Device, T>(
                             ctx, var_tensor, var->copy_on_read_mode.load()));
     if (read_old_value) {
@@ -0,0 +1,170 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class StringCaseOpTest : public OpsTestBase {
+ protected:
+  Status Init(const string& op, const string& encoding) {
+    TF_CHECK_OK(NodeDefBuilder("op", op)
+                    .Input(FakeInput(DT_STRING))
+                    .Attr("encoding", encoding)
+                    .Finalize(node_def()));
+    return InitOp();
+  }
+};
+
+TEST_F(StringCaseOpTest, LowerNoEncoding) {
+  TF_ASSERT_OK(Init("StringLower", ""));
+  AddInputFromArray<tstring>(
+      TensorShape({3}),
+      {"", "Hello, World!", "A Much Longer Line Of Mixed Case ASCII Text"});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_STRING, TensorShape({3}));
+  test::FillValues<tstring>(
+      &expected,
+      {"", "hello, world!", "a much longer line of mixed case ascii text"});
+  test::ExpectTensorEqual<tstring>(expected, *GetOutput(0));
+}
+
+TEST_F(StringCaseOpTest, LowerUTF8) {
+  TF_ASSERT_OK(Init("StringLower", "utf-8"));
+  AddInputFromArray<tstring>(TensorShape({2}),
+                             {"ASCII ONLY", "CAF\xc3\x89 \xce\x94\xce\x9f"});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_STRING, TensorShape({2}));
+  test::FillValues<tstring>(&expected,
+                            {"ascii only", "caf\xc3\xa9 \xce\xb4\xce\xbf"});
+  test::ExpectTensorEqual<tstring>(expected, *GetOutput(0));
+}
+
+TEST_F(StringCaseOpTest, UpperNoEncoding) {
+  TF_ASSERT_OK(Init("StringUpper", ""));
+  // Non-ASCII bytes are left alone without an encoding.
+  AddInputFromArray<tstring>(TensorShape({2}),
+                             {"hello, world!", "caf\xc3\xa9"});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_STRING, TensorShape({2}));
+  test::FillValues<tstring>(&expected, {"HELLO, WORLD!", "CAF\xc3\xa9"});
+  test::ExpectTensorEqual<tstring>(expected, *GetOutput(0));
+}
+
+TEST_F(StringCaseOpTest, UpperUTF8) {
+  TF_ASSERT_OK(Init("StringUpper", "utf-8"));
+  AddInputFromArray<tstring>(TensorShape({2}),
+                             {"ascii only", "caf\xc3\xa9 \xce\xb4\xce\xbf"});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_STRING, TensorShape({2}));
+  test::FillValues<tstring>(&expected,
+                            {"ASCII ONLY", "CAF\xc3\x89 \xce\x94\xce\x9f"});
+  test::ExpectTensorEqual<tstring>(expected, *GetOutput(0));
+}
+
+// English and multilingual test lines for the benchmarks.
+const char* ascii_lines[] = {
+    "**TensorFlow** is an open source software library for numerical "
+    "computation using data flow graphs.",
+    "The graph nodes represent mathematical operations, while the graph edges "
+    "represent the multidimensional data arrays (tensors) that flow between "
+    "them.",
+    "This flexible architecture enables you to deploy computation to one or "
+    "more CPUs or GPUs in a desktop, server, or mobile device without "
+    "rewriting code."};
+
+const char* utf8_lines[] = {
+    "TensorFlow est une biblioth\xc3\xa8que logicielle open source pour le "
+    "calcul num\xc3\xa9rique \xc3\xa0 l'aide de graphes de flux de donn\xc3\xa9"
+    "es.",
+    "\xce\xa4\xce\xbf TensorFlow \xce\xb5\xce\xaf\xce\xbd\xce\xb1\xce\xb9 "
+    "\xce\xbc\xce\xb9\xce\xb1 \xce\xb2\xce\xb9\xce\xb2\xce\xbb\xce\xb9\xce\xbf"
+    "\xce\xb8\xce\xae\xce\xba\xce\xb7.",
+    "Die Architektur erm\xc3\xb6glicht die Berechnung auf einer oder mehreren "
+    "CPUs oder GPUs, ohne den Code neu zu schreiben."};
+
+Tensor GetTestTensor(bool ascii, int batch) {
+  const char** lines = ascii ? ascii_lines : utf8_lines;
+  const int sz = ascii ? TF_ARRAYSIZE(ascii_lines) : TF_ARRAYSIZE(utf8_lines);
+  Tensor t(DT_STRING, {batch});
+  auto s = t.flat<tstring>();
+  for (int i = 0; i < batch; ++i) {
+    s(i) = lines[i % sz];
+  }
+  return t;
+}
+
+Graph* SetupStringCaseGraph(const string& op, const string& encoding,
+                            const Tensor& input) {
+  Graph* g = new Graph(OpRegistry::Global());
+  TF_CHECK_OK(NodeBuilder("string_case_op", op)
+                  .Input(test::graph::Constant(g, input))
+                  .Attr("encoding", encoding)
+                  .Finalize(g, nullptr /* node */));
+  return g;
+}
+
+void RunStringCaseBenchmark(::testing::benchmark::State& state,
+                            const string& op, const string& encoding,
+                            bool ascii) {
+  const int batch_size = state.range(0);
+  Tensor input = GetTestTensor(ascii, batch_size);
+  int64 bytes = 0;
+  auto strings = input.flat<tstring>();
+  for (int i = 0; i < batch_size; ++i) bytes += strings(i).size();
+  Graph* g = SetupStringCaseGraph(op, encoding, input);
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64>(state.iterations()) * bytes);
+}
+
+static void BM_StringLower(::testing::benchmark::State& state) {
+  RunStringCaseBenchmark(state, "StringLower", "", /*ascii=*/true);
+}
+
+static void BM_StringLowerUTF8_Ascii(::testing::benchmark::State& state) {
+  RunStringCaseBenchmark(state, "StringLower", "utf-8", /*ascii=*/true);
+}
+
+static void BM_StringLowerUTF8(::testing::benchmark::State& state) {
+  RunStringCaseBenchmark(state, "StringLower", "utf-8", /*ascii=*/false);
+}
+
+static void BM_StringUpper(::testing::benchmark::State& state) {
+  RunStringCaseBenchmark(state, "StringUpper", "", /*ascii=*/true);
+}
+
+static void BM_StringUpperUTF8(::testing::benchmark::State& state) {
+  RunStringCaseBenchmark(state, "StringUpper", "utf-8", /*ascii=*/false);
+}
+
+BENCHMARK(BM_StringLower)->UseRealTime()->Arg(1)->Arg(64)->Arg(1024);
+BENCHMARK(BM_StringLowerUTF8_Ascii)->UseRealTime()->Arg(1)->Arg(64)->Arg(1024);
+BENCHMARK(BM_StringLowerUTF8)->UseRealTime()->Arg(1)->Arg(64)->Arg(1024);
+BENCHMARK(BM_StringUpper)->UseRealTime()->Arg(1)->Arg(64)->Arg(1024);
+BENCHMARK(BM_StringUpperUTF8)->UseRealTime()->Arg(1)->Arg(64)->Arg(1024);
+
+}  // namespace
+}  // namespace tensorflow
@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/framework/kernel_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/string_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
@@ -28,79 +29,83 @@ limitations under the License.
 namespace tensorflow {
 namespace {
 // Split input string `str` based on a character delimiter.
-// Returns a vector of StringPieces which are valid as long as input `str`
-// is valid.
+// Appends StringPieces which are valid as long as input `str` is valid to
+// `result`, and returns the number of pieces appended.
 // Note: The single character delimiter is a common case and is implemented as
 // a series of finds in the input string, making it much more efficient than
 // SplitOnCharSet.
 template <typename Predicate>
-std::vector<StringPiece> SplitOnChar(const tstring& str, const char delim,
-                                     Predicate p) {
-  std::vector<StringPiece> result;
+int64 SplitOnChar(const tstring& str, const char delim, Predicate p,
+                  std::vector<StringPiece>* result) {
+  const size_t initial_size = result->size();
   StringPiece text(str);
   auto f = text.find(delim);
   while (f != StringPiece::npos) {
     StringPiece token = text.substr(0, f);
     if (p(token)) {
-      result.emplace_back(token);
+      result->emplace_back(token);
     }
     text.remove_prefix(f + 1);
     f = text.find(delim);
   }
   if (p(text)) {
-    result.push_back(text);
+    result->push_back(text);
   }
-  return result;
+  return result->size() - initial_size;
 }
 
 // Split input string `str` based on a set of character delimiters.
-// Returns a vector of StringPieces which are valid as long as input `str`
-// is valid.
+// Appends StringPieces which are valid as long as input `str` is valid to
+// `result`, and returns the number of pieces appended.
 // Based on str_util::Split.
 template <typename Predicate>
-std::vector<StringPiece> SplitOnCharSet(const tstring& str,
-                                        const tstring& delim_set, Predicate p) {
-  std::vector<StringPiece> result;
+int64 SplitOnCharSet(const tstring& str, const ByteSet& delim_set, Predicate p,
+                     std::vector<StringPiece>* result) {
+  const size_t initial_size = result->size();
   StringPiece text(str);
-  StringPiece delims(delim_set);
   size_t token_start = 0;
-  for (size_t i = 0; i < text.size() + 1; i++) {
-    if ((i == text.size()) || (delims.find(text[i]) != StringPiece::npos)) {
-      StringPiece token(text.data() + token_start, i - token_start);
-      if (p(token)) {
-        result.emplace_back(token);
-      }
-      token_start = i + 1;
+  while (true) {
+    size_t token_end = FindFirstOf(text, token_start, delim_set);
+    if (token_end == StringPiece::npos) {
+      token_end = text.size();
+    }
+    StringPiece token(text.data() + token_start, token_end - token_start);
+    if (p(token)) {
+      result->emplace_back(token);
     }
+    if (token_end == text.size()) {
+      break;
+    }
+    token_start = token_end + 1;
   }
-  return result;
+  return result->size() - initial_size;
 }
 
 // Split input string `str` based on given delimiter.
-// Returns a vector of StringPieces which are valid as long as input `str`
-// is valid.
+// Appends StringPieces which are valid as long as input `str` is valid to
+// `result`, and returns the number of pieces appended. `delim_set` holds the
+// bytes of `delimiter`.
 template <typename Predicate>
-std::vector<StringPiece> Split(const tstring& str, const tstring& delimiter,
-                               Predicate predicate) {
+int64 Split(const tstring& str, const tstring& delimiter,
+            const ByteSet& delim_set, Predicate predicate,
+            std::vector<StringPiece>* result) {
   if (str.empty()) {
-    return std::vector<StringPiece>();
+    return 0;
   }
   if (delimiter.empty()) {
-    std::vector<StringPiece> result;
-    result.resize(str.size());
     for (size_t i = 0; i < str.size(); ++i) {
-      result[i] = StringPiece(str.data() + i, 1);
+      result->emplace_back(str.data() + i, 1);
     }
-    return result;
+    return str.size();
   }
   if (delimiter.size() == 1) {
-    return SplitOnChar(str, delimiter[0], predicate);
+    return SplitOnChar(str, delimiter[0], predicate, result);
   }
-  return SplitOnCharSet(str, delimiter, predicate);
+  return SplitOnCharSet(str, delim_set, predicate, result);
 }
 
-std::vector<StringPiece> SplitV2(const tstring& str, StringPiece sep,
-                                 int maxsplit) {
+int64 SplitV2(const tstring& str, StringPiece sep, int maxsplit,
+              std::vector<StringPiece>* result) {
   // This SplitV2 method matches the behavior of python's str.split:
   //   If sep is given, consecutive delimiters are not grouped together
   //   and are deemed to delimit empty strings (for example, '1,,2'.split(',')
@@ -115,46 +120,51 @@ std::vector<StringPiece> SplitV2(const tstring& str, StringPiece sep,
   //   splitting an empty string or a string consisting of just whitespace
   //   with a None separator returns [].
 
-  std::vector<StringPiece> result;
-
+  const size_t initial_size = result->size();
   StringPiece text(str);
   if (maxsplit == 0) {
-    result.emplace_back(text);
-    return result;
+    result->emplace_back(text);
+    return 1;
   }
 
   if (sep.empty()) {
-    StringPiece token;
-    // Remove leading whitespaces.
-    str_util::RemoveLeadingWhitespace(&text);
+    const ByteSet& whitespace = AsciiWhitespace();
+    // Skip leading whitespace.
+    size_t token_start = FindFirstNotOf(text, 0, whitespace);
     int split = 0;
-    while (str_util::ConsumeNonWhitespace(&text, &token)) {
-      result.push_back(token);
-      str_util::RemoveLeadingWhitespace(&text);
+    while (token_start != StringPiece::npos) {
+      size_t token_end = FindFirstOf(text, token_start, whitespace);
+      if (token_end == StringPiece::npos) {
+        token_end = text.size();
+      }
+      result->push_back(text.substr(token_start, token_end - token_start));
+      token_start = FindFirstNotOf(text, token_end, whitespace);
       ++split;
       if (maxsplit > 0 && split == maxsplit) {
-        result.push_back(text);
-        return result;
+        result->push_back(token_start == StringPiece::npos
+                              ? StringPiece()
+                              : text.substr(token_start));
+        break;
       }
     }
-    return result;
+    return result->size() - initial_size;
   }
-  auto p = std::search(text.begin(), text.end(), sep.begin(), sep.end());
+  size_t p = text.find(sep);
   int split = 0;
-  while (p != text.end()) {
-    StringPiece token = text.substr(0, p - text.begin());
-    result.push_back(token);
+  while (p != StringPiece::npos) {
+    StringPiece token = text.substr(0, p);
+    result->push_back(token);
     text.remove_prefix(token.size());
     text.remove_prefix(sep.size());
     ++split;
     if (maxsplit > 0 && split == maxsplit) {
-      result.push_back(StringPiece(text));
-      return result;
+      result->push_back(StringPiece(text));
+      return result->size() - initial_size;
     }
-    p = std::search(text.begin(), text.end(), sep.begin(), sep.end());
+    p = text.find(sep);
   }
-  result.push_back(text);
-  return result;
+  result->push_back(text);
+  return result->size() - initial_size;
 }
 
 }  // namespace
@@ -189,6 +199,7 @@ class StringSplitOp : public OpKernel {
                                 delimiter_tensor->shape().DebugString()));
     const auto delimiter_vec = delimiter_tensor->flat<tstring>();
     const tstring& delimiter = delimiter_vec(0);
+    const ByteSet delimiter_set(delimiter);
     // Empty delimiter means split the input character by character.
     std::vector<StringPiece> tokens;
     // Guess that we'll be unpacking a handful of tokens per example.
@@ -199,15 +210,14 @@ class StringSplitOp : public OpKernel {
     int64 max_num_entries = 0;
     std::vector<int64> num_indices(batch_size);
     for (int64 i = 0; i < batch_size; ++i) {
-      std::vector<StringPiece> parts =
-          skip_empty_ ? Split(input_vec(i), delimiter, str_util::SkipEmpty())
-                      : Split(input_vec(i), delimiter, str_util::AllowEmpty());
-      int64 n_entries = parts.size();
+      int64 n_entries =
+          skip_empty_ ? Split(input_vec(i), delimiter, delimiter_set,
+                              str_util::SkipEmpty(), &tokens)
+                      : Split(input_vec(i), delimiter, delimiter_set,
+                              str_util::AllowEmpty(), &tokens);
       num_indices[i] = n_entries;
       output_size += n_entries;
       max_num_entries = std::max(max_num_entries, n_entries);
-      tokens.insert(tokens.end(), std::make_move_iterator(parts.begin()),
-                    std::make_move_iterator(parts.end()));
     }
 
     Tensor* sp_indices_t;
@@ -272,12 +282,10 @@ class StringSplitV2Op : public OpKernel {
     int64 max_num_entries = 0;
     std::vector<int64> num_indices(batch_size);
     for (int64 i = 0; i < batch_size; ++i) {
-      std::vector<StringPiece> parts = SplitV2(input_vec(i), sep, maxsplit_);
-      int64 n_entries = parts.size();
+      int64 n_entries = SplitV2(input_vec(i), sep, maxsplit_, &tokens);
       num_indices[i] = n_entries;
       output_size += n_entries;
       max_num_entries = std::max(max_num_entries, n_entries);
-      tokens.insert(tokens.end(), parts.begin(), parts.end());
     }
 
     Tensor* sp_indices_t;
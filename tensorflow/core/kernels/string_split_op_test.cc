@@ -64,10 +64,10 @@ Tensor GetTestTensor(int batch) {
   return t;
 }
 
-Graph* SetupStringSplitGraph(const Tensor& input) {
+Graph* SetupStringSplitGraph(const Tensor& input, const string& delimiter) {
   Graph* g = new Graph(OpRegistry::Global());
   Tensor delim(DT_STRING, TensorShape({}));
-  delim.flat<tstring>().setConstant(" ");
+  delim.flat<tstring>().setConstant(delimiter);
 
   TF_CHECK_OK(NodeBuilder("string_split_op", "StringSplit")
                   .Input(test::graph::Constant(g, input))
@@ -80,7 +80,7 @@ static void BM_StringSplit(::testing::benchmark::State& state) {
   const int batch_size = state.range(0);
 
   Tensor input = GetTestTensor(batch_size);
-  Graph* g = SetupStringSplitGraph(input);
+  Graph* g = SetupStringSplitGraph(input, " ");
   test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
   state.SetItemsProcessed(static_cast<int64>(state.iterations()));
 }
@@ -95,10 +95,29 @@ BENCHMARK(BM_StringSplit)
     ->Arg(128)
     ->Arg(256);
 
-Graph* SetupStringSplitV2Graph(const Tensor& input) {
+static void BM_StringSplitCharSet(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+
+  Tensor input = GetTestTensor(batch_size);
+  Graph* g = SetupStringSplitGraph(input, " ,.()");
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetItemsProcessed(static_cast<int64>(state.iterations()));
+}
+
+BENCHMARK(BM_StringSplitCharSet)
+    ->UseRealTime()
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128)
+    ->Arg(256);
+
+Graph* SetupStringSplitV2Graph(const Tensor& input, const string& separator) {
   Graph* g = new Graph(OpRegistry::Global());
   Tensor sep(DT_STRING, TensorShape({}));
-  sep.flat<tstring>().setConstant(" ");
+  sep.flat<tstring>().setConstant(separator);
 
   TF_CHECK_OK(NodeBuilder("string_split_op", "StringSplitV2")
                   .Input(test::graph::Constant(g, input))
@@ -111,7 +130,7 @@ static void BM_StringSplitV2(::testing::benchmark::State& state) {
   const int batch_size = state.range(0);
 
   Tensor input = GetTestTensor(batch_size);
-  Graph* g = SetupStringSplitV2Graph(input);
+  Graph* g = SetupStringSplitV2Graph(input, " ");
   test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
   state.SetItemsProcessed(static_cast<int64>(state.iterations()));
 }
@@ -126,4 +145,24 @@ BENCHMARK(BM_StringSplitV2)
     ->Arg(128)
     ->Arg(256);
 
+static void BM_StringSplitV2Whitespace(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+
+  Tensor input = GetTestTensor(batch_size);
+  // An empty separator splits on runs of whitespace.
+  Graph* g = SetupStringSplitV2Graph(input, "");
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetItemsProcessed(static_cast<int64>(state.iterations()));
+}
+
+BENCHMARK(BM_StringSplitV2Whitespace)
+    ->UseRealTime()
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128)
+    ->Arg(256);
+
 }  // end namespace tensorflow
@@ -17,11 +17,11 @@ limitations under the License.
 
 #include <string>
 
-#include "absl/strings/ascii.h"
 #include "unicode/unistr.h"  // from @icu
 #include "tensorflow/core/framework/kernel_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/string_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/strings/str_util.h"
@@ -49,13 +49,22 @@ class StringUpperOp : public OpKernel {
     auto output = output_tensor->flat<tstring>();
     if (encoding_.empty()) {
       for (int64 i = 0; i < input.size(); ++i) {
-        StringPiece entry(input(i));
-        output(i) = absl::AsciiStrToUpper(entry);
+        const tstring& entry = input(i);
+        output(i).resize_uninitialized(entry.size());
+        AsciiToUpper(entry.data(), entry.size(), output(i).mdata());
       }
     } else {
       // The validation of utf-8 has already been done in GetAttr above.
       for (int64 i = 0; i < input.size(); ++i) {
-        icu::UnicodeString us(input(i).c_str(), "UTF-8");
+        const tstring& entry = input(i);
+        // Case mapping of pure ASCII text stays within ASCII, so it doesn't
+        // need ICU.
+        if (AsciiPrefixLength(entry) == entry.size()) {
+          output(i).resize_uninitialized(entry.size());
+          AsciiToUpper(entry.data(), entry.size(), output(i).mdata());
+          continue;
+        }
+        icu::UnicodeString us(entry.c_str(), "UTF-8");
         us.toUpper();
         us.toUTF8String(output(i));
       }
@@ -14,6 +14,13 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/string_util.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #include "tensorflow/core/lib/core/errors.h"
 
 namespace tensorflow {
@@ -61,4 +68,180 @@ int32 UTF8StrLen(const string& str) {
   return result;
 }
 
+ByteSet::ByteSet(StringPiece bytes) {
+  for (char c : bytes) {
+    if (table_[static_cast<uint8>(c)]) continue;
+    table_[static_cast<uint8>(c)] = true;
+    if (num_bytes_ < kMaxVectorBytes) {
+      bytes_[num_bytes_] = c;
+    }
+    ++num_bytes_;
+  }
+}
+
+namespace {
+
+// Returns the position of the first byte at or after `pos` in `text` whose
+// membership in `table` equals `member`, or StringPiece::npos.
+template <bool member>
+size_t FindFirst(StringPiece text, size_t pos, const bool* table,
+                 const char* bytes, int num_bytes) {
+  const char* data = text.data();
+  const size_t size = text.size();
+  size_t i = pos;
+#if defined(__SSE2__)
+  if (num_bytes <= ByteSet::kMaxVectorBytes) {
+    __m128i needles[ByteSet::kMaxVectorBytes];
+    for (int k = 0; k < num_bytes; ++k) {
+      needles[k] = _mm_set1_epi8(bytes[k]);
+    }
+    for (; i + 16 <= size; i += 16) {
+      const __m128i chunk =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      __m128i matches = _mm_setzero_si128();
+      for (int k = 0; k < num_bytes; ++k) {
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, needles[k]));
+      }
+      int mask = _mm_movemask_epi8(matches);
+      if (!member) mask = ~mask & 0xFFFF;
+      if (mask != 0) return i + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    if (table[static_cast<uint8>(data[i])] == member) return i;
+  }
+  return StringPiece::npos;
+}
+
+// Flips the case bit of the ASCII letters in [first, first + 25].
+void FlipAsciiCase(const char* in, size_t size, char* out, char first) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  {
+    const __m256i offset = _mm256_set1_epi8(static_cast<char>(0x80 - first));
+    const __m256i limit = _mm256_set1_epi8(static_cast<char>(0x80 + 26));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    for (; i + 32 <= size; i += 32) {
+      const __m256i chunk =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+      // Bytes in [first, first + 25] map to the 26 smallest signed values.
+      const __m256i in_range =
+          _mm256_cmpgt_epi8(limit, _mm256_add_epi8(chunk, offset));
+      _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(out + i),
+          _mm256_xor_si256(chunk, _mm256_and_si256(in_range, flip)));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    const __m128i offset = _mm_set1_epi8(static_cast<char>(0x80 - first));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(0x80 + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    for (; i + 16 <= size; i += 16) {
+      const __m128i chunk =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+      // Bytes in [first, first + 25] map to the 26 smallest signed values.
+      const __m128i in_range =
+          _mm_cmplt_epi8(_mm_add_epi8(chunk, offset), limit);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                       _mm_xor_si128(chunk, _mm_and_si128(in_range, flip)));
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    const char c = in[i];
+    out[i] = static_cast<uint8>(c - first) < 26 ? c ^ 0x20 : c;
+  }
+}
+
+inline bool IsContinuationByte(uint8 c) { return (c & 0xC0) == 0x80; }
+
+}  // namespace
+
+size_t FindFirstOf(StringPiece text, size_t pos, const ByteSet& set) {
+  return FindFirst<true>(text, pos, set.table_, set.bytes_, set.num_bytes_);
+}
+
+size_t FindFirstNotOf(StringPiece text, size_t pos, const ByteSet& set) {
+  return FindFirst<false>(text, pos, set.table_, set.bytes_, set.num_bytes_);
+}
+
+const ByteSet& AsciiWhitespace() {
+  static const ByteSet* whitespace = new ByteSet(" \t\n\v\f\r");
+  return *whitespace;
+}
+
+size_t AsciiPrefixLength(StringPiece text) {
+  const char* data = text.data();
+  const size_t size = text.size();
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 32 <= size; i += 32) {
+    const int mask = _mm256_movemask_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+#endif
+#if defined(__SSE2__)
+  for (; i + 16 <= size; i += 16) {
+    const int mask = _mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+#endif
+  while (i < size && static_cast<uint8>(data[i]) < 0x80) ++i;
+  return i;
+}
+
+void AsciiToLower(const char* in, size_t size, char* out) {
+  FlipAsciiCase(in, size, out, 'A');
+}
+
+void AsciiToUpper(const char* in, size_t size, char* out) {
+  FlipAsciiCase(in, size, out, 'a');
+}
+
+bool IsValidUTF8(StringPiece text) {
+  const uint8* p = reinterpret_cast<const uint8*>(text.data());
+  const uint8* const end = p + text.size();
+  while (p < end) {
+    p += AsciiPrefixLength(
+        StringPiece(reinterpret_cast<const char*>(p), end - p));
+    if (p == end) return true;
+    const uint8 c = *p;
+    if (c < 0xC2) {
+      // A continuation byte, or the lead byte of an overlong 2-byte sequence.
+      return false;
+    } else if (c < 0xE0) {
+      if (end - p < 2 || !IsContinuationByte(p[1])) return false;
+      p += 2;
+    } else if (c < 0xF0) {
+      if (end - p < 3 || !IsContinuationByte(p[1]) ||
+          !IsContinuationByte(p[2])) {
+        return false;
+      }
+      // Overlong encodings and UTF-16 surrogates.
+      if ((c == 0xE0 && p[1] < 0xA0) || (c == 0xED && p[1] > 0x9F)) {
+        return false;
+      }
+      p += 3;
+    } else if (c < 0xF5) {
+      if (end - p < 4 || !IsContinuationByte(p[1]) ||
+          !IsContinuationByte(p[2]) || !IsContinuationByte(p[3])) {
+        return false;
+      }
+      // Overlong encodings and code points above U+10FFFF.
+      if ((c == 0xF0 && p[1] < 0x90) || (c == 0xF4 && p[1] > 0x8F)) {
+        return false;
+      }
+      p += 4;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace tensorflow
@@ -16,6 +16,8 @@ limitations under the License.
 #define TENSORFLOW_CORE_KERNELS_STRING_UTIL_H_
 
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
 
@@ -82,6 +84,86 @@ bool BackNUTF8CharPositions(const StringPiece in,
   return utf8_chars_counted == num_utf8_chars_to_shift;
 }
 
+// Byte-level scanning helpers for the string ops. They process 16 bytes at a
+// time with SSE2 (32 with AVX2, when the build enables it) and fall back to
+// scalar loops on other platforms.
+
+// A set of bytes to scan strings for, e.g. a set of delimiters.
+class ByteSet {
+ public:
+  // Sets with at most this many distinct bytes are matched with vector
+  // compares; larger sets are matched through a lookup table.
+  static constexpr int kMaxVectorBytes = 8;
+
+  explicit ByteSet(StringPiece bytes);
+
+  bool Contains(char c) const { return table_[static_cast<uint8>(c)]; }
+
+ private:
+  friend size_t FindFirstOf(StringPiece text, size_t pos, const ByteSet& set);
+  friend size_t FindFirstNotOf(StringPiece text, size_t pos,
+                               const ByteSet& set);
+
+  bool table_[256] = {};
+  char bytes_[kMaxVectorBytes] = {};
+  int num_bytes_ = 0;
+};
+
+// Returns the position of the first byte at or after `pos` in `text` which is
+// in `set`, or StringPiece::npos if there is none.
+size_t FindFirstOf(StringPiece text, size_t pos, const ByteSet& set);
+
+// Returns the position of the first byte at or after `pos` in `text` which is
+// not in `set`, or StringPiece::npos if there is none.
+size_t FindFirstNotOf(StringPiece text, size_t pos, const ByteSet& set);
+
+// Returns the ASCII whitespace bytes, as classified by `isspace` in the C
+// locale.
+const ByteSet& AsciiWhitespace();
+
+// Returns the length of the longest prefix of `text` consisting of ASCII
+// bytes.
+size_t AsciiPrefixLength(StringPiece text);
+
+// Writes the `size` bytes at `in` to `out`, converting ASCII letters to lower
+// or upper case. Other bytes are copied unchanged. `in` and `out` may be the
+// same buffer.
+void AsciiToLower(const char* in, size_t size, char* out);
+void AsciiToUpper(const char* in, size_t size, char* out);
+
+// Returns whether `text` is valid UTF-8. Overlong encodings, surrogates and
+// code points above U+10FFFF are invalid, as they are for ICU's converters.
+bool IsValidUTF8(StringPiece text);
+
+// Calls `f(code_point, num_bytes)` for each code point of `text`, which must
+// be valid UTF-8 according to `IsValidUTF8`.
+template <typename F>
+void ForEachValidUTF8CodePoint(StringPiece text, F f) {
+  const uint8* p = reinterpret_cast<const uint8*>(text.data());
+  const uint8* const end = p + text.size();
+  while (p < end) {
+    const size_t ascii =
+        AsciiPrefixLength(StringPiece(reinterpret_cast<const char*>(p),
+                                      end - p));
+    for (const uint8* ascii_end = p + ascii; p < ascii_end; ++p) {
+      f(static_cast<int32>(*p), 1);
+    }
+    if (p == end) break;
+    if (*p < 0xE0) {
+      f(((p[0] & 0x1F) << 6) | (p[1] & 0x3F), 2);
+      p += 2;
+    } else if (*p < 0xF0) {
+      f(((p[0] & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F), 3);
+      p += 3;
+    } else {
+      f(((p[0] & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) |
+            (p[3] & 0x3F),
+        4);
+      p += 4;
+    }
+  }
+}
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_KERNELS_STRING_UTIL_H_
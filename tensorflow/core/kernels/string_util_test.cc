@@ -0,0 +1,107 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/string_util.h"
+
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Long enough to cover the vector loops as well as the scalar tails.
+string Repeat(StringPiece piece, int n) {
+  string result;
+  for (int i = 0; i < n; ++i) result.append(piece.data(), piece.size());
+  return result;
+}
+
+TEST(StringUtilTest, FindFirstOfSmallSet) {
+  const ByteSet set(" ,");
+  const string text = Repeat("abcdefgh", 9) + "," + Repeat("x", 40) + " y";
+  EXPECT_EQ(72, FindFirstOf(text, 0, set));
+  EXPECT_EQ(72, FindFirstOf(text, 72, set));
+  EXPECT_EQ(113, FindFirstOf(text, 73, set));
+  EXPECT_EQ(StringPiece::npos, FindFirstOf(text, 114, set));
+  EXPECT_EQ(StringPiece::npos, FindFirstOf(text, text.size(), set));
+  EXPECT_EQ(StringPiece::npos, FindFirstOf("", 0, set));
+}
+
+TEST(StringUtilTest, FindFirstOfLargeSet) {
+  const ByteSet set("0123456789\xff");
+  const string text = Repeat("abcdefgh", 5) + "\xff" + Repeat("z", 20) + "7";
+  EXPECT_EQ(40, FindFirstOf(text, 0, set));
+  EXPECT_EQ(61, FindFirstOf(text, 41, set));
+  EXPECT_TRUE(set.Contains('\xff'));
+  EXPECT_FALSE(set.Contains('a'));
+}
+
+TEST(StringUtilTest, FindFirstNotOf) {
+  const string text = Repeat(" \t\n", 30) + "word" + Repeat(" ", 20);
+  EXPECT_EQ(90, FindFirstNotOf(text, 0, AsciiWhitespace()));
+  EXPECT_EQ(91, FindFirstNotOf(text, 91, AsciiWhitespace()));
+  EXPECT_EQ(StringPiece::npos, FindFirstNotOf(text, 94, AsciiWhitespace()));
+  EXPECT_EQ(94, FindFirstOf(text, 90, AsciiWhitespace()));
+}
+
+TEST(StringUtilTest, AsciiPrefixLength) {
+  EXPECT_EQ(0, AsciiPrefixLength(""));
+  EXPECT_EQ(5, AsciiPrefixLength("hello"));
+  const string text = Repeat("ascii", 10) + "\xc3\xa9" + "tail";
+  EXPECT_EQ(50, AsciiPrefixLength(text));
+  EXPECT_EQ(0, AsciiPrefixLength("\xe2\x82\xac"));
+}
+
+TEST(StringUtilTest, AsciiCaseConversion) {
+  const string text = Repeat("Hello, World! @[`{ \xc3\x89", 5);
+  string lower(text.size(), '\0');
+  AsciiToLower(text.data(), text.size(), &lower[0]);
+  EXPECT_EQ(Repeat("hello, world! @[`{ \xc3\x89", 5), lower);
+
+  string upper = text;
+  AsciiToUpper(upper.data(), upper.size(), &upper[0]);
+  EXPECT_EQ(Repeat("HELLO, WORLD! @[`{ \xc3\x89", 5), upper);
+}
+
+TEST(StringUtilTest, IsValidUTF8) {
+  EXPECT_TRUE(IsValidUTF8(""));
+  EXPECT_TRUE(IsValidUTF8(Repeat("plain ascii ", 10)));
+  EXPECT_TRUE(IsValidUTF8("caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80"));
+  EXPECT_TRUE(IsValidUTF8("\xf4\x8f\xbf\xbf"));  // U+10FFFF
+
+  EXPECT_FALSE(IsValidUTF8("\x80"));              // Stray continuation byte.
+  EXPECT_FALSE(IsValidUTF8("\xc0\xaf"));          // Overlong '/'.
+  EXPECT_FALSE(IsValidUTF8("\xe0\x80\xaf"));      // Overlong '/'.
+  EXPECT_FALSE(IsValidUTF8("\xed\xa0\x80"));      // Surrogate U+D800.
+  EXPECT_FALSE(IsValidUTF8("\xf4\x90\x80\x80"));  // U+110000.
+  EXPECT_FALSE(IsValidUTF8("\xf5\x80\x80\x80"));
+  EXPECT_FALSE(IsValidUTF8(Repeat("a", 40) + "\xe2\x82"));  // Truncated.
+}
+
+TEST(StringUtilTest, ForEachValidUTF8CodePoint) {
+  std::vector<std::pair<int32, int>> code_points;
+  ForEachValidUTF8CodePoint("a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80z",
+                            [&](int32 code_point, int num_bytes) {
+                              code_points.emplace_back(code_point, num_bytes);
+                            });
+  const std::vector<std::pair<int32, int>> expected = {
+      {'a', 1}, {0xE9, 2}, {0x20AC, 3}, {0x1F600, 4}, {'z', 1}};
+  EXPECT_EQ(expected, code_points);
+}
+
+}  // namespace
+}  // namespace tensorflow
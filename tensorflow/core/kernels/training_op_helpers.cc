@@ -27,4 +27,13 @@ void MaybeForwardRefInputToRefOutput(OpKernelContext* ctx, int input,
   }
 }
 
+Status ValidateVariableForUpdate(const Var* var) {
+  if (var->read_mostly_tensor() != nullptr) {
+    return errors::FailedPrecondition(
+        "Cannot update a variable in read-mostly mode in place; it can only be "
+        "assigned a new value with AssignVariableOp.");
+  }
+  return Status::OK();
+}
+
 }  // end namespace tensorflow
@@ -25,15 +25,27 @@ limitations under the License.
 
 namespace tensorflow {
 
+// Returns an error if `var` is in read-mostly mode, where its buffer can be
+// read without holding the variable's lock and must not be updated in place.
+// Switching a variable to read-mostly mode holds its mutex exclusively, so
+// in-place writers must call this while holding the mutex, shared or
+// exclusively, for the result to hold until they release it.
+Status ValidateVariableForUpdate(const Var* var);
+
 // Must be called before performing a sparse operation on a variable. Ensures
 // that no concurrent dense operations can happen while holding the variable's
-// lock.
+// lock. Fails on read-mostly variables, which sparse readers should read
+// through `Var::read_mostly_tensor()` instead. The variable can still switch
+// to read-mostly mode before the caller grabs its mutex, so sparse writers
+// must call `ValidateVariableForUpdate()` again once they hold it.
 template <typename Device, typename T>
 Status EnsureSparseVariableAccess(OpKernelContext* ctx, Var* var) {
+  TF_RETURN_IF_ERROR(ValidateVariableForUpdate(var));
   if (var->copy_on_read_mode.load()) {
     return Status::OK();
   }
   mutex_lock ml(*var->mu());
+  TF_RETURN_IF_ERROR(ValidateVariableForUpdate(var));
   // Once copy-on-read mode is True the refcount is guaranteed to be 1. This can
   // also happen if there are no concurrent reads of the variable and
   // copy-on-read mode is false.
@@ -247,6 +259,7 @@ Status GetInputTensorFromVariable(OpKernelContext* ctx, int input,
       *out = *var->tensor();
       return Status::OK();
     }
+    TF_RETURN_IF_ERROR(ValidateVariableForUpdate(var.get()));
     TF_RETURN_IF_ERROR(PrepareToUpdateVariable<Device, T>(
         ctx, var->tensor(), var->copy_on_read_mode.load()));
     *out = *var->tensor();
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/kernels/parallel_sparse_update.h"
 #include "tensorflow/core/kernels/training_op_helpers.h"
 #include "tensorflow/core/kernels/variable_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -40,6 +41,19 @@ inline T sgn(const T x) {
   T one(1);
   return (x == zero ? zero : (x < zero ? -one : one));
 }
+
+// Returns the rough cost of a sparse update of a row of `inner_dim` elements
+// in `num_slots` variables from the matching row of the gradient, with
+// `num_ops` arithmetic operations per element. It only decides whether the
+// updates are worth running in parallel.
+template <typename T>
+Eigen::TensorOpCost SparseUpdateCost(int64 inner_dim, int num_slots,
+                                     int num_ops) {
+  return Eigen::TensorOpCost(inner_dim * sizeof(T) * (num_slots + 1),
+                             inner_dim * sizeof(T) * num_slots,
+                             inner_dim * num_ops *
+                                 Eigen::TensorOpCost::MulCost<T>());
+}
 }  // namespace
 
 namespace functor {
@@ -401,17 +415,12 @@ struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
         l2_shrinkage_scalar = l2_shrinkage();
       }
       T lr_power_scalar = lr_power();
+      Tindex bad_i;
       if (inner_dim > 1) {
         const Tindex first_dim_size =
             static_cast<Tindex>(var_flat.dimension(0));
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          if (!FastBoundsCheck(index, first_dim_size)) {
-            return errors::InvalidArgument(
-                strings::StrCat("Index ", index, " at offset ", i,
-                                " in indices is out of range"));
-          }
+        const auto update = [&](Tindex i, Tindex index) {
           auto accum = accum_flat.template chip<0>(index);
           auto linear = linear_flat.template chip<0>(index);
           auto grad = grad_flat.template chip<0>(i);
@@ -479,18 +488,16 @@ struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
           } else {
             COMPUTE_FTRL(grad, grad);
           }
-        }
+        };
 #undef COMPUTE_FTRL
+        bad_i = ParallelSparseUpdate<Tindex>(
+            d, indices_vec, first_dim_size,
+            SparseUpdateCost<T>(inner_dim, /*num_slots=*/3, /*num_ops=*/20),
+            update);
       } else {
         const Tindex first_dim_size = accum_flat.size();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          if (!FastBoundsCheck(index, first_dim_size)) {
-            return errors::InvalidArgument(
-                strings::StrCat("Index ", index, " at offset ", i,
-                                " in indices is out of range"));
-          }
+        const auto update = [&](Tindex i, Tindex index) {
           T& a = accum_flat(index);
           T& l = linear_flat(index);
           T& v = var_flat(index);
@@ -514,7 +521,16 @@ struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
                           lr_power_scalar, multiply_linear_by_lr);
           a = updated_a;
           l = updated_l;
-        }
+        };
+        bad_i = ParallelSparseUpdate<Tindex>(
+            d, indices_vec, first_dim_size,
+            SparseUpdateCost<T>(inner_dim, /*num_slots=*/3, /*num_ops=*/20),
+            update);
+      }
+      if (bad_i >= 0) {
+        return errors::InvalidArgument(
+            strings::StrCat("Index ", indices_vec(bad_i), " at offset ", bad_i,
+                            " in indices is out of range"));
       }
     }
     return Status::OK();
@@ -562,11 +578,8 @@ struct SparseApplyKerasMomentum<CPUDevice, T, Tindex> {
                     typename TTypes<Tindex>::ConstFlat indices,
                     typename TTypes<T>::ConstScalar momentum,
                     bool use_nesterov) {
-    const Tindex N = static_cast<Tindex>(indices.size());
     const Tindex first_dim_size = static_cast<Tindex>(var.dimension(0));
-    for (Tindex i = 0; i < N; i++) {
-      const Tindex index = internal::SubtleMustCopy(indices(i));
-      if (!FastBoundsCheck(index, first_dim_size)) return i;
+    const auto update = [&](Tindex i, Tindex index) {
       auto a = accum.template chip<0>(index);
       auto g = grad.template chip<0>(i);
       auto v = var.template chip<0>(index);
@@ -576,8 +589,11 @@ struct SparseApplyKerasMomentum<CPUDevice, T, Tindex> {
       } else {
         v += a;
       }
-    }
-    return -1;
+    };
+    return ParallelSparseUpdate<Tindex>(
+        d, indices, first_dim_size,
+        SparseUpdateCost<T>(var.dimension(1), /*num_slots=*/2, /*num_ops=*/6),
+        update);
   }
 };
 
@@ -1085,16 +1101,7 @@ class SparseApplyAdadeltaOp : public OpKernel {
 
     if (N > 0) {
       const Tindex first_dim_size = var.dim_size(0);
-      // Validate all the indices are in range
       auto indices_vec = indices.vec<Tindex>();
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = indices_vec(i);
-        OP_REQUIRES(ctx, index >= 0 && index < first_dim_size,
-                    errors::InvalidArgument(
-                        strings::StrCat("Index ", index, " at offset ", i,
-                                        " in indices is out of range")));
-      }
-
       auto var_flat = var.flat_outer_dims<T>();
       auto accum_grad_flat = accum_grad.flat_outer_dims<T>();
       auto accum_update_flat = accum_update.flat_outer_dims<T>();
@@ -1103,8 +1110,7 @@ class SparseApplyAdadeltaOp : public OpKernel {
       const T rho_scalar = rho.scalar<T>()();
       const T epsilon_scalar = epsilon.scalar<T>()();
 
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = indices_vec(i);
+      const auto update_row = [&](Tindex i, Tindex index) {
         auto accum_ = accum_grad_flat.template chip<0>(index);
         auto accum_update_ = accum_update_flat.template chip<0>(index);
         auto grad_ = grad_flat.template chip<0>(i);
@@ -1119,7 +1125,16 @@ class SparseApplyAdadeltaOp : public OpKernel {
         accum_update_ =
             accum_update_ * accum_update_.constant(rho_scalar) +
             update.square() * update.constant(static_cast<T>(1) - rho_scalar);
-      }
+      };
+      const Tindex bad_i = ParallelSparseUpdate<Tindex>(
+          ctx->eigen_device<CPUDevice>(), indices_vec, first_dim_size,
+          SparseUpdateCost<T>(var_flat.dimension(1), /*num_slots=*/3,
+                              /*num_ops=*/12),
+          update_row);
+      OP_REQUIRES(ctx, bad_i < 0,
+                  errors::InvalidArgument(strings::StrCat(
+                      "Index ", indices_vec(bad_i), " at offset ", bad_i,
+                      " in indices is out of range")));
     }
 
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
@@ -1276,9 +1291,13 @@ class SparseApplyProximalGradientDescentOp : public OpKernel {
                     "Inner dimension should be greater than zero."));
 
     if (N > 0) {
+      const CPUDevice& d = ctx->eigen_device<CPUDevice>();
+      const Eigen::TensorOpCost cost = SparseUpdateCost<T>(
+          inner_dim, /*num_slots=*/1, /*num_ops=*/8);
+      auto indices_vec = indices.vec<Tindex>();
+      Tindex bad_i;
       if (inner_dim > 1) {
         const Tindex first_dim_size = var.dim_size(0);
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat_outer_dims<T>();
         auto grad_flat = grad.flat_outer_dims<T>();
         T lr_scalar = lr.scalar<T>()();
@@ -1286,12 +1305,7 @@ class SparseApplyProximalGradientDescentOp : public OpKernel {
         T l2_scalar = l2.scalar<T>()();
 
         // TODO(xbing): extract the common logic for the Fobos update.
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        const auto update = [&](Tindex i, Tindex index) {
           auto g = grad_flat.template chip<0>(i);
           auto v = var_flat.template chip<0>(index);
           // compute learning_rate for current step.
@@ -1309,9 +1323,10 @@ class SparseApplyProximalGradientDescentOp : public OpKernel {
             v = prox_v /
                 (v.constant(1.0) + v.constant(l2_scalar) * learning_rate);
           }
-        }
+        };
+        bad_i = ParallelSparseUpdate<Tindex>(d, indices_vec, first_dim_size,
+                                             cost, update);
       } else {
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat<T>();
         auto grad_flat = grad.flat<T>();
         T lr_scalar = lr.scalar<T>()();
@@ -1319,12 +1334,7 @@ class SparseApplyProximalGradientDescentOp : public OpKernel {
         T l2_scalar = l2.scalar<T>()();
         const Tindex first_dim_size = var_flat.size();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        const auto update = [&](Tindex i, Tindex index) {
           const T& g = grad_flat(i);
           auto learning_rate = lr_scalar;
           auto prox_v = var_flat(index);
@@ -1338,8 +1348,14 @@ class SparseApplyProximalGradientDescentOp : public OpKernel {
           } else {
             var_flat(index) = prox_v / (1.0 + l2_scalar * learning_rate);
           }
-        }
+        };
+        bad_i = ParallelSparseUpdate<Tindex>(d, indices_vec, first_dim_size,
+                                             cost, update);
       }
+      OP_REQUIRES(ctx, bad_i < 0,
+                  errors::InvalidArgument(strings::StrCat(
+                      "Index ", indices_vec(bad_i), " at offset ", bad_i,
+                      " in indices is out of range")));
     }
 
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
@@ -1749,73 +1765,49 @@ class SparseApplyAdagradOp : public OpKernel {
     const auto& d = ctx->eigen_cpu_device();
 
     if (N > 0) {
-      const int in_bytes = inner_dim * sizeof(T) * 3;
-      const int out_bytes = inner_dim * sizeof(T) * 2;
-      const int cycles = inner_dim * (Eigen::TensorOpCost::AddCost<T>() * 2 +
-                                      Eigen::TensorOpCost::MulCost<T>() * 2);
-      const Eigen::TensorOpCost cost(in_bytes, out_bytes, cycles);
+      const Eigen::TensorOpCost cost =
+          SparseUpdateCost<T>(inner_dim, /*num_slots=*/2, /*num_ops=*/4);
+      const Tindex first_dim_size = var.dim_size(0);
+      auto indices_vec = indices.vec<Tindex>();
+      T lr_scalar = lr.scalar<T>()();
+      Tindex bad_i;
 
       if (inner_dim > 1) {
-        const Tindex first_dim_size = var.dim_size(0);
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat_outer_dims<T>();
         auto accum_flat = accum.flat_outer_dims<T>();
         auto grad_flat = grad.flat_outer_dims<T>();
-        T lr_scalar = lr.scalar<T>()();
-
-        for (Tindex i = 0; i < N; ++i) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
-        }
 
-        const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
-          for (Tindex i = start_idx; i < end_idx; ++i) {
-            const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-            auto a = accum_flat.template chip<0>(index);
-            auto g = grad_flat.template chip<0>(i);
-            auto v = var_flat.template chip<0>(index);
-            if (update_slots_) {
-              a += g.square();
-            }
-            v -= g.constant(lr_scalar) * g * a.rsqrt();
+        const auto update = [&](Tindex i, Tindex index) {
+          auto a = accum_flat.template chip<0>(index);
+          auto g = grad_flat.template chip<0>(i);
+          auto v = var_flat.template chip<0>(index);
+          if (update_slots_) {
+            a += g.square();
           }
+          v -= g.constant(lr_scalar) * g * a.rsqrt();
         };
-
-        d.parallelFor(N, cost, shard);
-
+        bad_i = ParallelSparseUpdate<Tindex>(d, indices_vec, first_dim_size,
+                                             cost, update);
       } else {
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat<T>();
         auto accum_flat = accum.flat<T>();
         auto grad_flat = grad.flat<T>();
-        T lr_scalar = lr.scalar<T>()();
-        const Tindex first_dim_size = accum_flat.size();
-
-        for (Tindex i = 0; i < N; ++i) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
-        }
 
-        const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
-          for (Tindex i = start_idx; i < end_idx; ++i) {
-            const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-            T& a = accum_flat(index);
-            const T& g = grad_flat(i);
-            if (update_slots_) {
-              a += g * g;
-            }
-            var_flat(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
+        const auto update = [&](Tindex i, Tindex index) {
+          T& a = accum_flat(index);
+          const T& g = grad_flat(i);
+          if (update_slots_) {
+            a += g * g;
           }
+          var_flat(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
         };
-
-        d.parallelFor(N, cost, shard);
+        bad_i = ParallelSparseUpdate<Tindex>(d, indices_vec, first_dim_size,
+                                             cost, update);
       }
+      OP_REQUIRES(ctx, bad_i < 0,
+                  errors::InvalidArgument(strings::StrCat(
+                      "Index ", indices_vec(bad_i), " at offset ", bad_i,
+                      " in indices is out of range")));
     }
 
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
@@ -1916,77 +1908,52 @@ class SparseApplyAdagradV2Op : public OpKernel {
     const auto& d = ctx->eigen_cpu_device();
 
     if (N > 0) {
-      const int in_bytes = inner_dim * sizeof(T) * 3;
-      const int out_bytes = inner_dim * sizeof(T) * 2;
-      const int cycles = inner_dim * (Eigen::TensorOpCost::AddCost<T>() * 2 +
-                                      Eigen::TensorOpCost::MulCost<T>() * 2);
-      const Eigen::TensorOpCost cost(in_bytes, out_bytes, cycles);
+      const Eigen::TensorOpCost cost =
+          SparseUpdateCost<T>(inner_dim, /*num_slots=*/2, /*num_ops=*/5);
+      const Tindex first_dim_size = var.dim_size(0);
+      auto indices_vec = indices.vec<Tindex>();
+      const T lr_scalar = lr.scalar<T>()();
+      const T epsilon_scalar = epsilon.scalar<T>()();
+      Tindex bad_i;
 
       if (inner_dim > 1) {
-        const Tindex first_dim_size = var.dim_size(0);
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat_outer_dims<T>();
         auto accum_flat = accum.flat_outer_dims<T>();
         auto grad_flat = grad.flat_outer_dims<T>();
-        const T lr_scalar = lr.scalar<T>()();
-        const T epsilon_scalar = epsilon.scalar<T>()();
-
-        for (Tindex i = 0; i < N; ++i) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
-        }
 
-        const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
-          for (Tindex i = start_idx; i < end_idx; ++i) {
-            const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-            auto a = accum_flat.template chip<0>(index);
-            auto g = grad_flat.template chip<0>(i);
-            auto v = var_flat.template chip<0>(index);
-            if (update_slots_) {
-              a += g.square();
-            }
-            v -= g.constant(lr_scalar) * g /
-                 (a.sqrt() + a.constant(epsilon_scalar));
+        const auto update = [&](Tindex i, Tindex index) {
+          auto a = accum_flat.template chip<0>(index);
+          auto g = grad_flat.template chip<0>(i);
+          auto v = var_flat.template chip<0>(index);
+          if (update_slots_) {
+            a += g.square();
           }
+          v -= g.constant(lr_scalar) * g /
+               (a.sqrt() + a.constant(epsilon_scalar));
         };
-
-        d.parallelFor(N, cost, shard);
-
+        bad_i = ParallelSparseUpdate<Tindex>(d, indices_vec, first_dim_size,
+                                             cost, update);
       } else {
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat<T>();
         auto accum_flat = accum.flat<T>();
         auto grad_flat = grad.flat<T>();
-        T lr_scalar = lr.scalar<T>()();
-        const T epsilon_scalar = epsilon.scalar<T>()();
-        const Tindex first_dim_size = accum_flat.size();
 
-        for (Tindex i = 0; i < N; ++i) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
-        }
-
-        const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
-          for (Tindex i = start_idx; i < end_idx; ++i) {
-            const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-            T& a = accum_flat(index);
-            const T& g = grad_flat(i);
-            if (update_slots_) {
-              a += g * g;
-            }
-            var_flat(index) -=
-                lr_scalar * g / (Eigen::numext::sqrt(a) + epsilon_scalar);
+        const auto update = [&](Tindex i, Tindex index) {
+          T& a = accum_flat(index);
+          const T& g = grad_flat(i);
+          if (update_slots_) {
+            a += g * g;
           }
+          var_flat(index) -=
+              lr_scalar * g / (Eigen::numext::sqrt(a) + epsilon_scalar);
         };
-
-        d.parallelFor(N, cost, shard);
+        bad_i = ParallelSparseUpdate<Tindex>(d, indices_vec, first_dim_size,
+                                             cost, update);
       }
+      OP_REQUIRES(ctx, bad_i < 0,
+                  errors::InvalidArgument(strings::StrCat(
+                      "Index ", indices_vec(bad_i), " at offset ", bad_i,
+                      " in indices is out of range")));
     }
 
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
@@ -2097,9 +2064,13 @@ class SparseApplyProximalAdagradOp : public OpKernel {
                     "Inner dimension should be greater than zero."));
 
     if (N > 0) {
+      const CPUDevice& d = ctx->eigen_device<CPUDevice>();
+      const Eigen::TensorOpCost cost = SparseUpdateCost<T>(
+          inner_dim, /*num_slots=*/2, /*num_ops=*/12);
+      auto indices_vec = indices.vec<Tindex>();
+      Tindex bad_i;
       if (inner_dim > 1) {
         const Tindex first_dim_size = var.dim_size(0);
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat_outer_dims<T>();
         auto accum_flat = accum.flat_outer_dims<T>();
         auto grad_flat = grad.flat_outer_dims<T>();
@@ -2107,12 +2078,7 @@ class SparseApplyProximalAdagradOp : public OpKernel {
         T l1_scalar = l1.scalar<T>()();
         T l2_scalar = l2.scalar<T>()();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        const auto update = [&](Tindex i, Tindex index) {
           auto a = accum_flat.template chip<0>(index);
           auto g = grad_flat.template chip<0>(i);
           auto v = var_flat.template chip<0>(index);
@@ -2132,9 +2098,10 @@ class SparseApplyProximalAdagradOp : public OpKernel {
             v = prox_v /
                 (v.constant(1.0) + v.constant(l2_scalar) * learning_rate);
           }
-        }
+        };
+        bad_i = ParallelSparseUpdate<Tindex>(d, indices_vec, first_dim_size,
+                                             cost, update);
       } else {
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat<T>();
         auto accum_flat = accum.flat<T>();
         auto grad_flat = grad.flat<T>();
@@ -2143,12 +2110,7 @@ class SparseApplyProximalAdagradOp : public OpKernel {
         T l2_scalar = l2.scalar<T>()();
         const Tindex first_dim_size = accum_flat.size();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        const auto update = [&](Tindex i, Tindex index) {
           T& a = accum_flat(index);
           const T& g = grad_flat(i);
           a += g * g;
@@ -2164,8 +2126,14 @@ class SparseApplyProximalAdagradOp : public OpKernel {
           } else {
             var_flat(index) = prox_v / (1.0 + l2_scalar * learning_rate);
           }
-        }
+        };
+        bad_i = ParallelSparseUpdate<Tindex>(d, indices_vec, first_dim_size,
+                                             cost, update);
       }
+      OP_REQUIRES(ctx, bad_i < 0,
+                  errors::InvalidArgument(strings::StrCat(
+                      "Index ", indices_vec(bad_i), " at offset ", bad_i,
+                      " in indices is out of range")));
     }
 
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
@@ -3070,12 +3038,7 @@ class SparseApplyMomentumOp : public OpKernel {
       T lr_scalar = lr.scalar<T>()();
       T momentum_scalar = momentum.scalar<T>()();
 
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-        OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                    errors::InvalidArgument(
-                        strings::StrCat("Index ", index, " at offset ", i,
-                                        " in indices is out of range")));
+      const auto update = [&](Tindex i, Tindex index) {
         auto a = accum_flat.template chip<0>(index);
         auto g = grad_flat.template chip<0>(i);
         auto v = var_flat.template chip<0>(index);
@@ -3086,7 +3049,16 @@ class SparseApplyMomentumOp : public OpKernel {
         } else {
           v -= a.constant(lr_scalar) * a;
         }
-      }
+      };
+      const Tindex bad_i = ParallelSparseUpdate<Tindex>(
+          ctx->eigen_device<CPUDevice>(), indices_vec, first_dim_size,
+          SparseUpdateCost<T>(var_flat.dimension(1), /*num_slots=*/2,
+                              /*num_ops=*/6),
+          update);
+      OP_REQUIRES(ctx, bad_i < 0,
+                  errors::InvalidArgument(strings::StrCat(
+                      "Index ", indices_vec(bad_i), " at offset ", bad_i,
+                      " in indices is out of range")));
     }
 
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
@@ -4121,16 +4093,7 @@ class SparseApplyRMSPropOp : public OpKernel {
 
     if (N > 0) {
       const Tindex first_dim_size = var.dim_size(0);
-      // Validate all the indices are in range
       auto indices_vec = indices.vec<Tindex>();
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = indices_vec(i);
-        OP_REQUIRES(ctx, index >= 0 && index < first_dim_size,
-                    errors::InvalidArgument(
-                        strings::StrCat("Index ", index, " at offset ", i,
-                                        " in indices is out of range")));
-      }
-
       auto var_flat = var.flat_outer_dims<T>();
       auto ms_flat = ms.flat_outer_dims<T>();
       auto mom_flat = mom.flat_outer_dims<T>();
@@ -4140,9 +4103,7 @@ class SparseApplyRMSPropOp : public OpKernel {
       const T epsilon_scalar = epsilon.scalar<T>()();
       const T momentum_scalar = momentum.scalar<T>()();
 
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = indices_vec(i);
-
+      const auto update = [&](Tindex i, Tindex index) {
         auto ms_ = ms_flat.template chip<0>(index);
         auto mom_ = mom_flat.template chip<0>(index);
         auto grad_ = grad_flat.template chip<0>(i);
@@ -4155,7 +4116,16 @@ class SparseApplyRMSPropOp : public OpKernel {
 
         auto v = var_flat.template chip<0>(index);
         v -= mom_;
-      }
+      };
+      const Tindex bad_i = ParallelSparseUpdate<Tindex>(
+          ctx->eigen_device<CPUDevice>(), indices_vec, first_dim_size,
+          SparseUpdateCost<T>(var_flat.dimension(1), /*num_slots=*/3,
+                              /*num_ops=*/10),
+          update);
+      OP_REQUIRES(ctx, bad_i < 0,
+                  errors::InvalidArgument(strings::StrCat(
+                      "Index ", indices_vec(bad_i), " at offset ", bad_i,
+                      " in indices is out of range")));
     }
 
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
@@ -4259,16 +4229,7 @@ class SparseApplyCenteredRMSPropOp : public OpKernel {
 
     if (N > 0) {
       const Tindex first_dim_size = var.dim_size(0);
-      // Validate all the indices are in range
       auto indices_vec = indices.vec<Tindex>();
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = indices_vec(i);
-        OP_REQUIRES(ctx, index >= 0 && index < first_dim_size,
-                    errors::InvalidArgument(
-                        strings::StrCat("Index ", index, " at offset ", i,
-                                        " in indices is out of range")));
-      }
-
       auto var_flat = var.flat_outer_dims<T>();
       auto ms_flat = ms.flat_outer_dims<T>();
       auto mg_flat = mg.flat_outer_dims<T>();
@@ -4279,9 +4240,7 @@ class SparseApplyCenteredRMSPropOp : public OpKernel {
       const T epsilon_scalar = epsilon.scalar<T>()();
       const T momentum_scalar = momentum.scalar<T>()();
 
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = indices_vec(i);
-
+      const auto update = [&](Tindex i, Tindex index) {
         auto ms_ = ms_flat.template chip<0>(index);
         auto mom_ = mom_flat.template chip<0>(index);
         auto grad_ = grad_flat.template chip<0>(i);
@@ -4297,7 +4256,16 @@ class SparseApplyCenteredRMSPropOp : public OpKernel {
                denom_.rsqrt() * ms_.constant(lr_scalar) * grad_;
         auto v = var_flat.template chip<0>(index);
         v -= mom_;
-      }
+      };
+      const Tindex bad_i = ParallelSparseUpdate<Tindex>(
+          ctx->eigen_device<CPUDevice>(), indices_vec, first_dim_size,
+          SparseUpdateCost<T>(var_flat.dimension(1), /*num_slots=*/4,
+                              /*num_ops=*/14),
+          update);
+      OP_REQUIRES(ctx, bad_i < 0,
+                  errors::InvalidArgument(strings::StrCat(
+                      "Index ", indices_vec(bad_i), " at offset ", bad_i,
+                      " in indices is out of range")));
     }
 
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
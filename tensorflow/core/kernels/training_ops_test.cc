@@ -13,6 +13,11 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/ops_util.h"
@@ -198,6 +203,82 @@ BENCHMARK(BM_SparseAdagrad)
     ->ArgPair(128, 32 << 10)
     ->ArgPair(128, 128 << 10);
 
+// Returns `n` indices of rows in [0, m), drawn from a Zipf distribution with
+// exponent 1, as the ids of embedding lookups often are. Most of the indices
+// are thus duplicates of a few hot rows.
+static Node* ZipfIndices(Graph* g, int m, int n) {
+  std::vector<double> cdf(m);
+  double sum = 0;
+  for (int i = 0; i < m; ++i) {
+    sum += 1.0 / (i + 1);
+    cdf[i] = sum;
+  }
+  std::mt19937 rng(301);
+  std::uniform_real_distribution<double> uniform(0, sum);
+  Tensor data(DT_INT32, TensorShape({n}));
+  auto indices = data.flat<int32>();
+  for (int i = 0; i < n; ++i) {
+    indices(i) = std::min<int>(
+        m - 1, std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) -
+                   cdf.begin());
+  }
+  return test::graph::Constant(g, data);
+}
+
+static void SparseFtrl(int32 m, int32 n, int32 d, Graph** init_g,
+                       Graph** train_g) {
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    auto var = Var(g, m, d);
+    auto accum = Var(g, m, d);
+    auto linear = Var(g, m, d);
+    auto zero = Zeros(g, m, d);
+    test::graph::Assign(g, var, zero);
+    test::graph::Assign(g, accum, Random(g, m, d));
+    test::graph::Assign(g, linear, zero);
+    *init_g = g;
+  }
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    auto var = Var(g, m, d);
+    auto accum = Var(g, m, d);
+    auto linear = Var(g, m, d);
+    auto grad = Random(g, n, d);
+    auto indices = ZipfIndices(g, m, n);
+    auto lr = Scalar(g, 0.01);
+    auto l1 = Scalar(g, 0.0);
+    auto l2 = Scalar(g, 0.0);
+    auto lr_power = Scalar(g, -0.5);
+    test::graph::Multi(
+        g, "SparseApplyFtrl",
+        {var, accum, linear, grad, indices, lr, l1, l2, lr_power});
+    *train_g = g;
+  }
+}
+
+// Updates `n` rows of width 64 of a table of `m` rows, at Zipfian indices.
+static void BM_SparseFtrlZipf(::testing::benchmark::State& state) {
+  const int m = state.range(0);
+  const int n = state.range(1);
+  const int d = 64;
+
+  Graph* init;
+  Graph* train;
+  SparseFtrl(m, n, d, &init, &train);
+  test::Benchmark("cpu", train, GetMultiThreadedOptions(), init, nullptr, "",
+                  /*old_benchmark_api*/ false)
+      .Run(state);
+  const int64 tot = static_cast<int64>(state.iterations()) * n * d;
+  state.SetItemsProcessed(tot);
+  state.SetBytesProcessed(tot * sizeof(float));
+}
+BENCHMARK(BM_SparseFtrlZipf)
+    ->UseRealTime()
+    ->ArgPair(1 << 10, 1 << 10)
+    ->ArgPair(1 << 10, 16 << 10)
+    ->ArgPair(64 << 10, 16 << 10)
+    ->ArgPair(64 << 10, 64 << 10);
+
 static void Momentum(int32 n, Graph** init_g, Graph** train_g) {
   TensorShape shape({n});
   {
@@ -119,10 +119,10 @@ void unicode_error_callback(const void* context, UConverterToUnicodeArgs* args,
 // encoding position.
 // callback: function(UChar32 codepoint, int num_bytes_consumed_from_source_str,
 //                    bool fatal_format_error)
-void IterateUnicodeString(const string& str, UConverter* converter,
+void IterateUnicodeString(StringPiece str, UConverter* converter,
                           std::function<void(UChar32, int, bool)> callback) {
   const char* source = str.data();
-  const char* limit = str.data() + str.length();
+  const char* limit = str.data() + str.size();
   UErrorCode status = U_ZERO_ERROR;
 
   UConverterToUCallback oldAction = nullptr;
@@ -259,6 +259,11 @@ class UnicodeTranscodeOp : public OpKernel {
                    ParseUnicodeEncoding(output_encoding, &output_encoding_));
 
     OP_REQUIRES_OK(ctx, ctx->GetAttr("input_encoding", &input_encoding_));
+    // Valid UTF-8 transcodes to itself unless control characters are
+    // replaced.
+    identity_for_valid_utf8_ = input_encoding_ == "UTF-8" &&
+                               output_encoding_ == UnicodeEncoding::UTF8 &&
+                               !error_options_.replace_control_chars;
     // Make a temporary UConverter to ensure it will create without error
     // at execution time (and to warm any data caches the converter needs).
     // This instance is not used.
@@ -303,6 +308,9 @@ class UnicodeTranscodeOp : public OpKernel {
     auto output_flat = output_tensor->flat<tstring>();
     bool found_any_format_error = false;
     for (size_t i = 0; i < output_flat.size(); ++i) {
+      if (identity_for_valid_utf8_ && IsValidUTF8(output_flat(i))) {
+        continue;
+      }
       Transcode(&(output_flat(i)), input_encoder->converter_,
                 &found_any_format_error);
     }
@@ -347,6 +355,8 @@ class UnicodeTranscodeOp : public OpKernel {
   string input_encoding_;
   ErrorOptions error_options_;
   UnicodeEncoding output_encoding_ = UnicodeEncoding::UTF8;
+  // Whether strings which are valid UTF-8 are left unchanged.
+  bool identity_for_valid_utf8_ = false;
 };
 
 REGISTER_KERNEL_BUILDER(Name("UnicodeTranscode").Device(DEVICE_CPU),
@@ -359,6 +369,7 @@ class UnicodeDecodeBaseOp : public OpKernel {
       : OpKernel(ctx), generate_offsets_(generate_offsets) {
     OP_REQUIRES_OK(ctx, GetErrorOptions(ctx, &error_options_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("input_encoding", &input_encoding_));
+    input_is_utf8_ = input_encoding_ == "UTF-8";
     // Make a temporary UConverter to ensure it will create without error
     // at execution time (and to warm any data caches the converter needs).
     // This instance is not used.
@@ -428,13 +439,23 @@ class UnicodeDecodeBaseOp : public OpKernel {
     int row_split_index = 0;
     SPLITS_TYPE next_row_split = 0;
     for (int i = 0; i < input_vec.size(); ++i) {
-      const string& input = input_vec(i);
+      StringPiece input(input_vec(i));
       // Convert input strings into unicode values. Output to a list of
       // char_values, record row splits and char_to_byte_starts, which are all
       // the fields needed to construct a RaggedTensor.
       out_row_splits(row_split_index) = next_row_split;
       row_split_index++;
       int current_offset = 0;
+      if (input_is_utf8_ && IsValidUTF8(input)) {
+        // Valid UTF-8 has no format errors for ICU to report or replace, so
+        // it can be decoded without a converter.
+        ForEachValidUTF8CodePoint(input, [&](int32 char_value, int length) {
+          Decode(ctx, &char_values, &offset_values, &current_offset,
+                 &next_row_split, char_value, length,
+                 /*found_any_format_error=*/false);
+        });
+        continue;
+      }
       IterateUnicodeString(
           input, input_encoder->converter_,
           std::bind(&UnicodeDecodeBaseOp::Decode, this, ctx, &char_values,
@@ -473,6 +494,8 @@ class UnicodeDecodeBaseOp : public OpKernel {
 
  private:
   string input_encoding_;
+  // Whether `input_encoding_` is UTF-8, which has a fast decoding path.
+  bool input_is_utf8_ = false;
   ErrorOptions error_options_;
   bool generate_offsets_ = false;
 };
@@ -16,6 +16,7 @@ limitations under the License.
 #include <functional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/framework/bounds_check.h"
@@ -26,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/bfloat16.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace {
@@ -68,6 +70,153 @@ struct UniqueOpHashMap<bfloat16, TIndex> {
   using map_type = std::unordered_map<bfloat16, TIndex>;
 };
 
+// Vectors with fewer elements are uniquified by a single thread.
+constexpr int64 kMinParallelUniqueSize = 1 << 16;
+
+// Computes the unique elements of `input` along `axis`, which is its only
+// dimension of size greater than 1, and their counts, like `UniqueOp` does,
+// on the `num_threads` threads of `workers`.
+//
+// The positions of the elements are first partitioned by hash, keeping their
+// order within each partition. Each partition is then uniquified by a single
+// thread with its own hash map, which finds the first occurrence of each
+// element. Finally, the first occurrences are ranked by position, so that the
+// unique elements are in the same order as with a single thread.
+template <typename T, typename TIndex>
+void ParallelUnique(OpKernelContext* context, const Tensor& input, int64 axis,
+                    int num_threads, thread::ThreadPool* workers,
+                    typename TTypes<TIndex>::Vec idx_vec) {
+  using MapType = typename UniqueOpHashMap<T, TIndex>::map_type;
+  auto Tin = input.flat<T>();
+  const int64 N = static_cast<int64>(Tin.size());
+
+  // Use a few partitions per thread to balance skewed inputs. The positions
+  // are also split into as many chunks of consecutive positions.
+  int num_partitions = 2;
+  int partition_bits = 1;
+  while (num_partitions < 4 * num_threads && num_partitions < 256) {
+    num_partitions *= 2;
+    ++partition_bits;
+  }
+  const int64 P = num_partitions;
+  auto chunk_begin = [N, P](int64 chunk) { return chunk * N / P; };
+
+  // Partition the positions by the high bits of the mixed hash of their
+  // elements, which are not the bits used by the hash maps.
+  const typename MapType::hasher hasher;
+  std::vector<uint8> partitions(N);
+  // The number of positions of each chunk in each partition, and then the
+  // start of these positions in `positions`.
+  std::vector<int64> chunk_offsets(P * P, 0);
+  Shard(num_threads, workers, P, N / P * 20, [&](int64 start, int64 limit) {
+    for (int64 c = start; c < limit; ++c) {
+      int64* counts = &chunk_offsets[c * P];
+      for (int64 i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+        const uint64 h = static_cast<uint64>(hasher(Tin(i)));
+        partitions[i] = static_cast<uint8>((h * 0x9E3779B97F4A7C15ull) >>
+                                           (64 - partition_bits));
+        ++counts[partitions[i]];
+      }
+    }
+  });
+  std::vector<int64> partition_starts(P + 1);
+  int64 offset = 0;
+  for (int64 p = 0; p < P; ++p) {
+    partition_starts[p] = offset;
+    for (int64 c = 0; c < P; ++c) {
+      const int64 count = chunk_offsets[c * P + p];
+      chunk_offsets[c * P + p] = offset;
+      offset += count;
+    }
+  }
+  partition_starts[P] = N;
+  std::vector<int64> positions(N);
+  Shard(num_threads, workers, P, N / P * 5, [&](int64 start, int64 limit) {
+    for (int64 c = start; c < limit; ++c) {
+      int64* next = &chunk_offsets[c * P];
+      for (int64 i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+        positions[next[partitions[i]]++] = i;
+      }
+    }
+  });
+
+  // Find the first occurrence of the element at each position, and the
+  // number of occurrences of each element.
+  std::vector<int64> first_positions(N);
+  std::vector<std::vector<int64>> partition_firsts(P);
+  std::vector<std::vector<TIndex>> partition_counts(P);
+  Shard(num_threads, workers, P, N / P * 100, [&](int64 start, int64 limit) {
+    for (int64 p = start; p < limit; ++p) {
+      std::vector<int64>& firsts = partition_firsts[p];
+      std::vector<TIndex>& counts = partition_counts[p];
+      MapType uniq;
+      uniq.reserve(2 * (partition_starts[p + 1] - partition_starts[p]));
+      for (int64 k = partition_starts[p]; k < partition_starts[p + 1]; ++k) {
+        const int64 i = positions[k];
+        auto it = uniq.emplace(Tin(i), static_cast<TIndex>(firsts.size()));
+        if (it.second) {
+          firsts.push_back(i);
+          counts.push_back(0);
+        }
+        first_positions[i] = firsts[it.first->second];
+        ++counts[it.first->second];
+      }
+    }
+  });
+
+  // Rank the first occurrences by position.
+  std::vector<int64> chunk_ranks(P + 1, 0);
+  Shard(num_threads, workers, P, N / P * 2, [&](int64 start, int64 limit) {
+    for (int64 c = start; c < limit; ++c) {
+      for (int64 i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+        chunk_ranks[c + 1] += first_positions[i] == i;
+      }
+    }
+  });
+  for (int64 c = 0; c < P; ++c) {
+    chunk_ranks[c + 1] += chunk_ranks[c];
+  }
+  const int64 uniq_size = chunk_ranks[P];
+
+  TensorShape output_shape(input.shape());
+  output_shape.set_dim(axis, uniq_size);
+  Tensor* output = nullptr;
+  OP_REQUIRES_OK(context, context->allocate_output(0, output_shape, &output));
+  auto Tout = output->flat<T>();
+  Shard(num_threads, workers, P, N / P * 5, [&](int64 start, int64 limit) {
+    for (int64 c = start; c < limit; ++c) {
+      int64 rank = chunk_ranks[c];
+      for (int64 i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+        if (first_positions[i] == i) {
+          idx_vec(i) = rank;
+          Tout(rank) = Tin(i);
+          ++rank;
+        }
+      }
+    }
+  });
+  Shard(num_threads, workers, P, N / P * 5, [&](int64 start, int64 limit) {
+    for (int64 i = chunk_begin(start); i < chunk_begin(limit); ++i) {
+      idx_vec(i) = idx_vec(first_positions[i]);
+    }
+  });
+
+  if (context->num_outputs() > 2) {
+    Tensor* count_output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                2, TensorShape({uniq_size}), &count_output));
+    auto count_output_vec = count_output->template vec<TIndex>();
+    Shard(num_threads, workers, P, N / P * 5, [&](int64 start, int64 limit) {
+      for (int64 p = start; p < limit; ++p) {
+        for (size_t u = 0; u < partition_firsts[p].size(); ++u) {
+          count_output_vec(idx_vec(partition_firsts[p][u])) =
+              partition_counts[p][u];
+        }
+      }
+    });
+  }
+}
+
 // `UniqueOp` computes the unique elements in the input tensor.
 //
 // * `T` is the element type.
@@ -142,6 +291,17 @@ class UniqueOp : public OpKernel {
                                 1, TensorShape({new_sizes[1]}), &idx));
     auto idx_vec = idx->template vec<TIndex>();
 
+    const DeviceBase::CpuWorkerThreads* worker_threads =
+        context->device()->tensorflow_cpu_worker_threads();
+    if (new_sizes[0] == 1 && new_sizes[2] == 1 &&
+        new_sizes[1] >= kMinParallelUniqueSize && worker_threads != nullptr &&
+        worker_threads->num_threads > 1) {
+      ParallelUnique<T, TIndex>(context, input, axis,
+                                worker_threads->num_threads,
+                                worker_threads->workers, idx_vec);
+      return;
+    }
+
     int64 uniq_size;
     if (new_sizes[0] == 1 && new_sizes[2] == 1) {
       // Specialized and faster implementation when unique is run over single
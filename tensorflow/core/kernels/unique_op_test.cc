@@ -15,11 +15,15 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <unordered_map>
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
@@ -28,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
@@ -37,6 +42,85 @@ namespace {
 
 const int kMaxStrLen = 40;
 
+class UniqueOpTest : public OpsTestBase {
+ protected:
+  void MakeUniqueWithCounts(DataType dtype) {
+    TF_ASSERT_OK(NodeDefBuilder("unique", "UniqueWithCounts")
+                     .Input(FakeInput(dtype))
+                     .Attr("out_idx", DT_INT32)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+// Large inputs are uniquified by several threads, with the same results as a
+// single thread.
+TEST_F(UniqueOpTest, LargeInputKeepsFirstOccurrenceOrder) {
+  const int dim = 1 << 18;
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<int64> x(dim);
+  for (int i = 0; i < dim; ++i) {
+    // Mix a few hot elements with many rare ones.
+    x[i] = rnd.OneIn(2) ? rnd.Uniform(16) : rnd.Uniform64(dim) << 20;
+  }
+
+  std::unordered_map<int64, int32> ids;
+  std::vector<int64> y;
+  std::vector<int32> idx;
+  std::vector<int32> count;
+  for (int64 value : x) {
+    auto it = ids.emplace(value, y.size());
+    if (it.second) {
+      y.push_back(value);
+      count.push_back(0);
+    }
+    idx.push_back(it.first->second);
+    ++count[it.first->second];
+  }
+
+  MakeUniqueWithCounts(DT_INT64);
+  AddInputFromArray<int64>(TensorShape({dim}), x);
+  TF_ASSERT_OK(RunOpKernel());
+  const int64 uniq_size = y.size();
+  test::ExpectTensorEqual<int64>(
+      *GetOutput(0), test::AsTensor<int64>(y, TensorShape({uniq_size})));
+  test::ExpectTensorEqual<int32>(
+      *GetOutput(1), test::AsTensor<int32>(idx, TensorShape({dim})));
+  test::ExpectTensorEqual<int32>(
+      *GetOutput(2), test::AsTensor<int32>(count, TensorShape({uniq_size})));
+}
+
+TEST_F(UniqueOpTest, LargeInputOfFloats) {
+  const int dim = 1 << 17;
+  std::vector<float> x(dim);
+  for (int i = 0; i < dim; ++i) {
+    x[i] = i % 3 == 0 ? 0.5f : (i % 1000) * 0.25f;
+  }
+  x[7] = -0.0f;
+  x[8] = 0.0f;
+
+  MakeUniqueWithCounts(DT_FLOAT);
+  AddInputFromArray<float>(TensorShape({dim}), x);
+  TF_ASSERT_OK(RunOpKernel());
+  auto y = GetOutput(0)->flat<float>();
+  auto idx = GetOutput(1)->flat<int32>();
+  auto count = GetOutput(2)->flat<int32>();
+  ASSERT_EQ(y.size(), 1000);
+  EXPECT_EQ(y(0), 0.5f);
+  EXPECT_EQ(y(1), 0.25f);
+  // -0.0 and 0.0 are the same element.
+  EXPECT_EQ(idx(7), idx(8));
+  for (int i = 0; i < dim; ++i) {
+    EXPECT_EQ(y(idx(i)), x[i]);
+  }
+  int64 total = 0;
+  for (int i = 0; i < count.size(); ++i) {
+    total += count(i);
+  }
+  EXPECT_EQ(total, dim);
+}
+
 TensorProto GetRandomInt32TensorProto(int dim, int max_int) {
   TensorProto tensor_proto;
   tensor_proto.set_dtype(DT_INT32);
@@ -149,6 +233,43 @@ void BM_Unique_STRING(::testing::benchmark::State& state) {
                           sizeof(tstring));
 }
 
+// Uniquifies `dim` random elements in [0, `max_int`) with the intra-op
+// threads of the host, as deduplicating embedding ids does.
+void BM_UniqueWithCounts_INT64(::testing::benchmark::State& state) {
+  const int dim = state.range(0);
+  const int max_int = state.range(1);
+
+  Graph* g = new Graph(OpRegistry::Global());
+
+  Tensor input(DT_INT64, TensorShape({dim}));
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  auto input_flat = input.flat<int64>();
+  for (int i = 0; i < dim; ++i) {
+    input_flat(i) = rnd.Uniform(max_int);
+  }
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "UniqueWithCounts")
+                  .Input(test::graph::Constant(g, input))
+                  .Attr("T", DT_INT64)
+                  .Finalize(g, &node));
+  FixupSourceAndSinkEdges(g);
+
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64>(state.iterations()) * dim *
+                          sizeof(int64));
+}
+
+BENCHMARK(BM_UniqueWithCounts_INT64)
+    ->UseRealTime()
+    ->ArgPair(4 * 1024 * 1024, 1024)
+    ->ArgPair(4 * 1024 * 1024, 64 * 1024)
+    ->ArgPair(4 * 1024 * 1024, 1024 * 1024)
+    ->ArgPair(4 * 1024 * 1024, 64 * 1024 * 1024)
+    ->ArgPair(16 * 1024 * 1024, 1024 * 1024)
+    ->ArgPair(16 * 1024 * 1024, 64 * 1024 * 1024);
+
 BENCHMARK(BM_Unique_INT32)
     ->UseRealTime()
     ->ArgPair(32, 1024 * 1024)
@@ -372,6 +372,129 @@ void WinogradTransform<T>::GetOutputTransformMatrix(const int64 rows,
   transform_matrix[3 * cols + 15] = T(1.0);
 };
 
+// Winograd F(4x4, 3x3) DeepConv2DTransform implementation for 3x3 filters.
+// Each 6x6 input tile produces a 4x4 output tile, which needs 36 element-wise
+// products per tile instead of the 64 needed by two F(2x2, 3x3) tiles covering
+// the same outputs, at the cost of larger transforms and slightly lower
+// numerical accuracy. Transform matrices are from Lavin, Gray.
+
+template <typename T>
+class Winograd4x4Transform : public DeepConv2DTransform<T> {
+ public:
+  typedef typename DeepConv2DTransform<T>::Shape Shape;
+
+  Winograd4x4Transform()
+      : filter_shape_(3, 3), input_shape_(6, 6), output_shape_(4, 4) {}
+
+  virtual void GetFilterTransformMatrix(const int64 rows, const int64 cols,
+                                        T* transform_matrix) const;
+
+  virtual void GetInputTransformMatrix(const int64 rows, const int64 cols,
+                                       T* transform_matrix) const;
+
+  virtual void GetOutputTransformMatrix(const int64 rows, const int64 cols,
+                                        T* transform_matrix) const;
+
+  virtual const Shape& filter_shape() const { return filter_shape_; }
+  virtual const Shape& input_shape() const { return input_shape_; }
+  virtual const Shape& output_shape() const { return output_shape_; }
+
+ private:
+  // Writes the kronecker product 'M * M' of the 'm_rows' x 'm_cols' row-major
+  // matrix 'm' to 'transform_matrix', which must be [m_rows^2, m_cols^2].
+  static void ComputeKroneckerProduct(const int64 m_rows, const int64 m_cols,
+                                      const double* m, const int64 rows,
+                                      const int64 cols, T* transform_matrix);
+
+  const Shape filter_shape_;
+  const Shape input_shape_;
+  const Shape output_shape_;
+};
+
+template <typename T>
+void Winograd4x4Transform<T>::ComputeKroneckerProduct(
+    const int64 m_rows, const int64 m_cols, const double* m, const int64 rows,
+    const int64 cols, T* transform_matrix) {
+  CHECK_EQ(rows, m_rows * m_rows);
+  CHECK_EQ(cols, m_cols * m_cols);
+  for (int64 i = 0; i < m_rows; ++i) {
+    for (int64 j = 0; j < m_cols; ++j) {
+      const double v = m[i * m_cols + j];
+      for (int64 k = 0; k < m_rows; ++k) {
+        for (int64 l = 0; l < m_cols; ++l) {
+          const int64 row = i * m_rows + k;
+          const int64 col = j * m_cols + l;
+          transform_matrix[row * cols + col] = T(v * m[k * m_cols + l]);
+        }
+      }
+    }
+  }
+}
+
+// The filter transform matrix is the kronecker product 'M * M' of the
+// following matrix 'M':
+//
+//   [ 1/4    0     0   ]
+//   [-1/6  -1/6  -1/6  ]
+//   [-1/6   1/6  -1/6  ]
+//   [ 1/24  1/12  1/6  ]
+//   [ 1/24 -1/12  1/6  ]
+//   [ 0      0     1   ]
+//
+// The data layout of 'transform_matrix':
+//   [input_tile_spatial_size, filter_spatial_size]
+//
+template <typename T>
+void Winograd4x4Transform<T>::GetFilterTransformMatrix(
+    const int64 rows, const int64 cols, T* transform_matrix) const {
+  static const double kMatrix[] = {
+      1.0 / 4,  0.0,       0.0,      -1.0 / 6, -1.0 / 6, -1.0 / 6,
+      -1.0 / 6, 1.0 / 6,   -1.0 / 6, 1.0 / 24, 1.0 / 12, 1.0 / 6,
+      1.0 / 24, -1.0 / 12, 1.0 / 6,  0.0,      0.0,      1.0};
+  ComputeKroneckerProduct(6, 3, kMatrix, rows, cols, transform_matrix);
+}
+
+// The input transform matrix is the kronecker product 'M * M' of the
+// following matrix 'M':
+//
+//   [4   0  -5   0   1   0]
+//   [0  -4  -4   1   1   0]
+//   [0   4  -4  -1   1   0]
+//   [0  -2  -1   2   1   0]
+//   [0   2  -1  -2   1   0]
+//   [0   4   0  -5   0   1]
+//
+// Data layout of 'transform_matrix':
+//   [tile_spatial_size, tile_spatial_size]
+//
+template <typename T>
+void Winograd4x4Transform<T>::GetInputTransformMatrix(
+    const int64 rows, const int64 cols, T* transform_matrix) const {
+  static const double kMatrix[] = {
+      4, 0,  -5, 0,  1, 0, 0, -4, -4, 1,  1, 0, 0, 4, -4, -1, 1, 0,
+      0, -2, -1, 2,  1, 0, 0, 2,  -1, -2, 1, 0, 0, 4, 0,  -5, 0, 1};
+  ComputeKroneckerProduct(6, 6, kMatrix, rows, cols, transform_matrix);
+}
+
+// The output transform matrix is the kronecker product 'M * M' of the
+// following matrix 'M':
+//
+//   [1  1  1  1  1  0]
+//   [0  1 -1  2 -2  0]
+//   [0  1  1  4  4  0]
+//   [0  1 -1  8 -8  1]
+//
+// Data layout of 'transform_matrix':
+//   [out_tile_spatial_size, tile_spatial_size]
+//
+template <typename T>
+void Winograd4x4Transform<T>::GetOutputTransformMatrix(
+    const int64 rows, const int64 cols, T* transform_matrix) const {
+  static const double kMatrix[] = {1, 1, 1,  1, 1,  0, 0, 1, -1, 2, -2, 0,
+                                   0, 1, 1,  4, 4,  0, 0, 1, -1, 8, -8, 1};
+  ComputeKroneckerProduct(4, 6, kMatrix, rows, cols, transform_matrix);
+}
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_KERNELS_WINOGRAD_TRANSFORM_H_
@@ -309,6 +309,35 @@ REGISTER_OP("ExperimentalDatasetToTFRecord")
     .SetIsStateful()
     .SetShapeFn(shape_inference::NoOutputs);
 
+REGISTER_OP("DecodeAndResizeJpegBatchDataset")
+    .Input("input_dataset: variant")
+    .Input("batch_size: int64")
+    .Input("num_parallel_calls: int64")
+    .Input("drop_remainder: bool")
+    .Input("size: int32")
+    .Output("handle: variant")
+    .Attr("channels: int = 3")
+    .Attr("fancy_upscaling: bool = true")
+    .Attr("dct_method: string = ''")
+    .Attr("half_pixel_centers: bool = true")
+    .Attr("scale: float = 1.0")
+    .Attr("offset: float = 0.0")
+    .Attr("output_types: list(type) >= 1")
+    .Attr("output_shapes: list(shape) >= 1")
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      // batch_size, num_parallel_calls, and drop_remainder are 0-D scalars.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
+      // size is a 1-D vector of height and width.
+      shape_inference::ShapeHandle size;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 1, &size));
+      shape_inference::DimensionHandle unused_dim;
+      TF_RETURN_IF_ERROR(c->WithValue(c->Dim(size, 0), 2, &unused_dim));
+      return shape_inference::ScalarShape(c);
+    });
+
 REGISTER_OP("DenseToSparseBatchDataset")
     .Input("input_dataset: variant")
     .Input("batch_size: int64")
@@ -970,6 +999,7 @@ REGISTER_OP("SnapshotDatasetV2")
     .Attr("writer_prefix: string = ''")
     .Attr("hash_valid: bool = false")
     .Attr("hash: int = 0")
+    .Attr("file_format_version: int = 2")
     .Attr("reader_func: func")
     .Attr("shard_func: func")
     .Attr("Treader_func_args: list(type) >= 0")
@@ -308,6 +308,35 @@ REGISTER_OP("_UnaryOpsComposition")
 expected to create these operators.
 )doc");
 
+REGISTER_OP("_FusedElementwise")
+    .Input("inputs: N * T")
+    .Output("y: T")
+    .Attr("N: int >= 1")
+    .Attr("T: {float, double}")
+    .Attr("ops: list(string) >= 1")
+    .Attr("operands: list(int)")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle out = c->input(0);
+      for (int i = 1; i < c->num_inputs(); ++i) {
+        TF_RETURN_IF_ERROR(BroadcastBinaryOpOutputShapeFnHelper(
+            c, out, c->input(i), /*incompatible_shape_error=*/true, &out));
+      }
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Evaluates a connected expression of element-wise ops in a single pass.
+
+The expression is a program of `ops`, each reading the two operands
+`operands[2 * i]` and `operands[2 * i + 1]` (-1 for the second operand of unary
+ops). Operand k < N is `inputs[k]`, and operand N + j is the result of op j < i.
+`y` is the result of the last op. Inputs must have the shape of `y`, a single
+element, or the shape of trailing dimensions of `y`.
+
+*NOTE*: Do not invoke this operator directly in Python. Graph rewrite pass is
+expected to create these operators.
+)doc");
+
 #undef UNARY
 #undef UNARY_REAL
 #undef UNARY_COMPLEX
@@ -978,6 +1007,49 @@ _FusedConv2D output.
 expected to create these operators.
 )doc");
 
+REGISTER_OP("_Int8MatMul")
+    .Input("a: float")
+    .Input("b: quint8")
+    .Input("scales: float")
+    .Input("offsets: float")
+    .Output("product: float")
+    .Attr("input_scale: float")
+    .Attr("input_zero_point: int")
+    .Attr("activation: {'None', 'Relu', 'Relu6', 'Elu', 'LeakyRelu'} = 'None'")
+    .Attr("leakyrelu_alpha: float = 0.2")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle a;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 2, &a));
+      ShapeHandle b;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 2, &b));
+      ShapeHandle scales;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &scales));
+      ShapeHandle offsets;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 1, &offsets));
+      DimensionHandle depth;
+      TF_RETURN_IF_ERROR(c->Merge(c->Dim(a, 1), c->Dim(b, 0), &depth));
+      DimensionHandle channels;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(scales, 0), c->Dim(offsets, 0), &channels));
+      TF_RETURN_IF_ERROR(c->Merge(channels, c->Dim(b, 1), &channels));
+      c->set_output(0, c->Matrix(c->Dim(a, 0), channels));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Performs an int8 MatMul of the float `a` with the quantized weights `b`,
+followed by an `activation`.
+
+`a` is quantized on the fly to uint8 with `input_scale` and `input_zero_point`.
+`b` holds the [depth, channels] int8 weights quantized per output channel and
+stored as uint8 with a zero point of 128, as described in kernels/int8_gemm.h.
+Output channel n of the int32 product p of the zero point corrected operands is
+converted to `activation(p * scales[n] + offsets[n])`, where `scales` folds the
+quantization scales and `offsets` holds the bias.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is
+expected to create these operators.
+)doc");
+
 // --------------------------------------------------------------------------
 
 // For operations where the output is a reduction function along some
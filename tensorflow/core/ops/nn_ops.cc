@@ -424,6 +424,307 @@ output.
 create these operators.
 )doc");
 
+// --------------------------------------------------------------------------
+// Ops on the blocked CPU layout, created by the Grappler CPU blocked layout
+// optimizer (see grappler/optimizers/cpu_blocked_layout_optimizer.cc). A
+// [batch, rows, cols, channels] tensor is stored in the blocked layout as
+// [batch, ceil(channels / 8), rows, cols, 8]: the channels of a pixel are
+// split in blocks of 8, one SIMD register of floats, that are contiguous in
+// memory. The padding channels of the last block have unspecified values and
+// are ignored by the blocked ops.
+
+namespace {
+
+constexpr int64 kChannelBlockSize = 8;
+
+// Sets 'out' to the blocked layout shape of a [batch, rows, cols, channels]
+// tensor.
+Status MakeBlockedShape(InferenceContext* c, DimensionHandle batch,
+                        DimensionHandle rows, DimensionHandle cols,
+                        DimensionHandle channels, ShapeHandle* out) {
+  DimensionHandle blocks;
+  TF_RETURN_IF_ERROR(c->Add(channels, kChannelBlockSize - 1, &blocks));
+  TF_RETURN_IF_ERROR(c->Divide(blocks, kChannelBlockSize,
+                               /*evenly_divisible=*/false, &blocks));
+  *out = c->MakeShape(
+      {batch, blocks, rows, cols, c->MakeDim(kChannelBlockSize)});
+  return Status::OK();
+}
+
+// Checks that input 'index' has the blocked layout, and returns its shape.
+Status BlockedInput(InferenceContext* c, int index, ShapeHandle* input) {
+  TF_RETURN_IF_ERROR(c->WithRank(c->input(index), 5, input));
+  DimensionHandle unused;
+  return c->WithValue(c->Dim(*input, 4), kChannelBlockSize, &unused);
+}
+
+// Computes the output rows and columns of a windowed op on the blocked 'input'
+// from the window sizes, and the 'strides', 'padding' and optional 'dilations'
+// attributes, all in NHWC order.
+Status BlockedWindowedOutputSize(
+    InferenceContext* c, ShapeHandle input,
+    shape_inference::DimensionOrConstant window_rows,
+    shape_inference::DimensionOrConstant window_cols,
+    DimensionHandle* out_rows, DimensionHandle* out_cols) {
+  std::vector<int32> strides;
+  TF_RETURN_IF_ERROR(c->GetAttr("strides", &strides));
+  if (strides.size() != 4 || strides[0] != 1 || strides[3] != 1) {
+    return errors::InvalidArgument(
+        "strides must have 4 elements, with 1 for the batch and channels");
+  }
+  std::vector<int32> dilations = {1, 1, 1, 1};
+  if (c->GetAttr("dilations", &dilations).ok() &&
+      (dilations.size() != 4 || dilations[0] != 1 || dilations[3] != 1)) {
+    return errors::InvalidArgument(
+        "dilations must have 4 elements, with 1 for the batch and channels");
+  }
+  Padding padding;
+  TF_RETURN_IF_ERROR(c->GetAttr("padding", &padding));
+  TF_RETURN_IF_ERROR(GetWindowedOutputSizeFromDimsV2(
+      c, c->Dim(input, 2), window_rows, dilations[1], strides[1], padding,
+      /*padding_before=*/-1, /*padding_after=*/-1, out_rows));
+  return GetWindowedOutputSizeFromDimsV2(
+      c, c->Dim(input, 3), window_cols, dilations[2], strides[2], padding,
+      /*padding_before=*/-1, /*padding_after=*/-1, out_cols);
+}
+
+Status BlockedPoolShape(InferenceContext* c) {
+  ShapeHandle input;
+  TF_RETURN_IF_ERROR(BlockedInput(c, 0, &input));
+  std::vector<int32> ksize;
+  TF_RETURN_IF_ERROR(c->GetAttr("ksize", &ksize));
+  if (ksize.size() != 4 || ksize[0] != 1 || ksize[3] != 1) {
+    return errors::InvalidArgument(
+        "ksize must have 4 elements, with 1 for the batch and channels");
+  }
+  DimensionHandle out_rows, out_cols;
+  TF_RETURN_IF_ERROR(BlockedWindowedOutputSize(c, input, ksize[1], ksize[2],
+                                               &out_rows, &out_cols));
+  c->set_output(0, c->MakeShape({c->Dim(input, 0), c->Dim(input, 1), out_rows,
+                                 out_cols, c->Dim(input, 4)}));
+  return Status::OK();
+}
+
+}  // namespace
+
+REGISTER_OP("_ToBlockedLayout")
+    .Input("input: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 4, &input));
+      ShapeHandle output;
+      TF_RETURN_IF_ERROR(MakeBlockedShape(c, c->Dim(input, 0),
+                                          c->Dim(input, 1), c->Dim(input, 2),
+                                          c->Dim(input, 3), &output));
+      c->set_output(0, output);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Converts a NHWC tensor to the blocked CPU layout.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is expected to
+create these operators.
+)doc");
+
+REGISTER_OP("_FromBlockedLayout")
+    .Input("input: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .Attr("channels: int >= 1")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(BlockedInput(c, 0, &input));
+      int64 channels;
+      TF_RETURN_IF_ERROR(c->GetAttr("channels", &channels));
+      DimensionHandle unused;
+      TF_RETURN_IF_ERROR(c->WithValue(
+          c->Dim(input, 1),
+          (channels + kChannelBlockSize - 1) / kChannelBlockSize, &unused));
+      c->set_output(0, c->MakeShape({c->Dim(input, 0), c->Dim(input, 2),
+                                     c->Dim(input, 3), channels}));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Converts a tensor in the blocked CPU layout with `channels` channels to NHWC.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is expected to
+create these operators.
+)doc");
+
+REGISTER_OP("_BlockedConv2D")
+    .Input("input: T")
+    .Input("filter: T")
+    .Input("args: num_args * T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .Attr("num_args: int >= 0")
+    .Attr("strides: list(int)")
+    .Attr(GetPaddingAttrString())
+    .Attr("dilations: list(int) = [1, 1, 1, 1]")
+    .Attr("fused_ops: list(string) = []")
+    .Attr("leakyrelu_alpha: float = 0.2")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(BlockedInput(c, 0, &input));
+      ShapeHandle filter;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 4, &filter));
+
+      // The input blocks must hold the filter input channels.
+      ShapeHandle filter_blocks;
+      TF_RETURN_IF_ERROR(MakeBlockedShape(c, c->Dim(input, 0),
+                                          c->Dim(input, 2), c->Dim(input, 3),
+                                          c->Dim(filter, 2), &filter_blocks));
+      DimensionHandle unused;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(input, 1), c->Dim(filter_blocks, 1), &unused));
+
+      DimensionHandle out_rows, out_cols;
+      TF_RETURN_IF_ERROR(BlockedWindowedOutputSize(
+          c, input, c->Dim(filter, 0), c->Dim(filter, 1), &out_rows,
+          &out_cols));
+      ShapeHandle output;
+      TF_RETURN_IF_ERROR(MakeBlockedShape(c, c->Dim(input, 0), out_rows,
+                                          out_cols, c->Dim(filter, 3),
+                                          &output));
+      c->set_output(0, output);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Performs a NHWC convolution of an `input` in the blocked CPU layout with a HWIO
+`filter`, followed by the operations specified by `fused_ops`, producing an
+output in the blocked CPU layout.
+
+Supported `fused_ops` are [], [BiasAdd] and [BiasAdd, A], where A is one of
+{"Elu","LeakyRelu","Relu","Relu6"}. The bias is the only element of `args`.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is expected to
+create these operators.
+)doc");
+
+REGISTER_OP("_BlockedBiasAdd")
+    .Input("value: T")
+    .Input("bias: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(BlockedInput(c, 0, &input));
+      ShapeHandle bias;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &bias));
+      c->set_output(0, input);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Adds `bias`, with one element per channel, to a `value` in the blocked CPU
+layout.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is expected to
+create these operators.
+)doc");
+
+REGISTER_OP("_BlockedMaxPool")
+    .Input("input: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .Attr("ksize: list(int) >= 4")
+    .Attr("strides: list(int) >= 4")
+    .Attr(GetPaddingAttrString())
+    .SetShapeFn(BlockedPoolShape)
+    .Doc(R"doc(
+Performs NHWC max pooling of an `input` in the blocked CPU layout.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is expected to
+create these operators.
+)doc");
+
+REGISTER_OP("_BlockedAvgPool")
+    .Input("input: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .Attr("ksize: list(int) >= 4")
+    .Attr("strides: list(int) >= 4")
+    .Attr(GetPaddingAttrString())
+    .SetShapeFn(BlockedPoolShape)
+    .Doc(R"doc(
+Performs NHWC average pooling of an `input` in the blocked CPU layout.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is expected to
+create these operators.
+)doc");
+
+REGISTER_OP("_Int8Conv2D")
+    .Input("input: float")
+    .Input("filter: quint8")
+    .Input("scales: float")
+    .Input("offsets: float")
+    .Output("output: float")
+    .Attr("filter_rows: int >= 1")
+    .Attr("filter_cols: int >= 1")
+    .Attr("strides: list(int)")
+    .Attr(GetPaddingAttrString())
+    .Attr("dilations: list(int) = [1, 1, 1, 1]")
+    .Attr("input_scale: float")
+    .Attr("input_zero_point: int")
+    .Attr("activation: {'None', 'Relu', 'Relu6', 'Elu', 'LeakyRelu'} = 'None'")
+    .Attr("leakyrelu_alpha: float = 0.2")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 4, &input));
+      ShapeHandle filter;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 2, &filter));
+      ShapeHandle scales;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &scales));
+      ShapeHandle offsets;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 1, &offsets));
+      DimensionHandle channels;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(scales, 0), c->Dim(offsets, 0), &channels));
+      TF_RETURN_IF_ERROR(c->Merge(channels, c->Dim(filter, 1), &channels));
+
+      int32 filter_rows, filter_cols;
+      TF_RETURN_IF_ERROR(c->GetAttr("filter_rows", &filter_rows));
+      TF_RETURN_IF_ERROR(c->GetAttr("filter_cols", &filter_cols));
+      std::vector<int32> strides;
+      TF_RETURN_IF_ERROR(c->GetAttr("strides", &strides));
+      std::vector<int32> dilations;
+      TF_RETURN_IF_ERROR(c->GetAttr("dilations", &dilations));
+      if (strides.size() != 4 || dilations.size() != 4) {
+        return errors::InvalidArgument(
+            "strides and dilations must have 4 elements");
+      }
+      Padding padding;
+      TF_RETURN_IF_ERROR(c->GetAttr("padding", &padding));
+      DimensionHandle out_rows, out_cols;
+      TF_RETURN_IF_ERROR(GetWindowedOutputSizeFromDimsV2(
+          c, c->Dim(input, 1), filter_rows, dilations[1], strides[1], padding,
+          /*padding_before=*/-1, /*padding_after=*/-1, &out_rows));
+      TF_RETURN_IF_ERROR(GetWindowedOutputSizeFromDimsV2(
+          c, c->Dim(input, 2), filter_cols, dilations[2], strides[2], padding,
+          /*padding_before=*/-1, /*padding_after=*/-1, &out_cols));
+      c->set_output(
+          0, c->MakeShape({c->Dim(input, 0), out_rows, out_cols, channels}));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Performs an int8 NHWC Conv2D of the float `input` with the quantized `filter`,
+followed by an `activation`.
+
+`input` is quantized on the fly to uint8 with `input_scale` and
+`input_zero_point`. `filter` holds the int8 weights of a HWIO filter with
+`filter_rows` rows and `filter_cols` columns, reshaped to
+[filter_rows * filter_cols * in_depth, out_depth], quantized per output channel
+and stored as uint8 with a zero point of 128, as described in
+kernels/int8_gemm.h. Output channel n of the int32 convolution p of the zero
+point corrected operands is converted to
+`activation(p * scales[n] + offsets[n])`, where `scales` folds the quantization
+scales and `offsets` holds the bias.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is expected to
+create these operators.
+)doc");
+
 namespace {
 
 Status CommonFusedConvCalculations(InferenceContext* c, bool has_resize) {
@@ -215,6 +215,10 @@ REGISTER_OP("VarIsInitializedOp")
     .Output("is_initialized: bool")
     .SetShapeFn(tensorflow::shape_inference::ScalarShape);
 
+REGISTER_OP("EnableVariableReadMostly")
+    .Input("resource: resource")
+    .SetShapeFn(shape_inference::NoOutputs);
+
 Status VariableShapeShapeFn(InferenceContext* c) {
   auto* handle_data = c->input_handle_shapes_and_types(0);
   if (handle_data == nullptr || handle_data->empty()) {
@@ -301,6 +305,72 @@ REGISTER_OP("ResourceGatherNd")
     .Attr("Tindices: {int32,int64}")
     .SetShapeFn(shape_inference::GatherNdShape);
 
+REGISTER_OP("FusedEmbeddingLookupSparse")
+    .Input("resource: resource")
+    .Input("ids: Tindices")
+    .Input("weights: dtype")
+    .Input("segment_ids: Tsegmentids")
+    .Output("output: dtype")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'mean'")
+    .Attr("dtype: {float, double}")
+    .Attr("Tindices: {int32, int64}")
+    .Attr("Tsegmentids: {int32, int64} = DT_INT32")
+    .SetShapeFn([](InferenceContext* c) {
+      std::vector<ShapeAndType> handle_shape_and_type;
+      TF_RETURN_IF_ERROR(shape_inference::ValidateVariableResourceHandle(
+          c, &handle_shape_and_type));
+      ShapeHandle params_shape;
+      TF_RETURN_IF_ERROR(
+          c->WithRankAtLeast(handle_shape_and_type[0].shape, 1, &params_shape));
+
+      ShapeHandle ids_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &ids_shape));
+      ShapeHandle unused;
+      // The weights are either empty or have the shape of the ids.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 1, &unused));
+      TF_RETURN_IF_ERROR(c->Merge(ids_shape, c->input(3), &unused));
+
+      ShapeHandle subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(params_shape, 1, &subshape));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(
+          c->Vector(InferenceContext::kUnknownDim), subshape, &out));
+      c->set_output(0, out);
+      return Status::OK();
+    });
+
+REGISTER_OP("FusedEmbeddingLookupSparseGrad")
+    .Input("grad: T")
+    .Input("ids: Tindices")
+    .Input("weights: T")
+    .Input("segment_ids: Tsegmentids")
+    .Output("unique_ids: Tindices")
+    .Output("values: T")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'mean'")
+    .Attr("T: {float, double}")
+    .Attr("Tindices: {int32, int64}")
+    .Attr("Tsegmentids: {int32, int64} = DT_INT32")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle grad_shape;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &grad_shape));
+      ShapeHandle ids_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &ids_shape));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 1, &unused));
+      TF_RETURN_IF_ERROR(c->Merge(ids_shape, c->input(3), &unused));
+
+      ShapeHandle subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(grad_shape, 1, &subshape));
+      ShapeHandle values_shape;
+      TF_RETURN_IF_ERROR(c->Concatenate(
+          c->Vector(InferenceContext::kUnknownDim), subshape, &values_shape));
+      c->set_output(0, c->Vector(InferenceContext::kUnknownDim));
+      c->set_output(1, values_shape);
+      return Status::OK();
+    });
+
 namespace {
 
 Status ResourceScatterUpdateShape(InferenceContext* c) {
@@ -441,6 +441,7 @@ class OptimizeDatasetTest(test_base.DatasetTestBase, parameterized.TestCase):
   def testOptimizationEnabled(self):
     """Tests the optimization settings by enabling all."""
     options = dataset_ops.Options()
+    options.experimental_optimization.decode_and_resize_fusion = True
     options.experimental_optimization.filter_fusion = True
     options.experimental_optimization.filter_with_random_uniform_fusion = True
     options.experimental_optimization.hoist_random_uniform = True
@@ -458,6 +459,7 @@ class OptimizeDatasetTest(test_base.DatasetTestBase, parameterized.TestCase):
     options.experimental_slack = True
 
     expected_optimizations_enabled = [
+        "decode_and_resize_fusion",
         "filter_fusion",
         "filter_with_random_uniform_fusion",
         "hoist_random_uniform",
@@ -489,6 +491,7 @@ class OptimizeDatasetTest(test_base.DatasetTestBase, parameterized.TestCase):
   def testOptimizationDisabled(self):
     """Tests the optimization settings by disabling all."""
     options = dataset_ops.Options()
+    options.experimental_optimization.decode_and_resize_fusion = False
     options.experimental_optimization.filter_fusion = False
     options.experimental_optimization.filter_with_random_uniform_fusion = False
     options.experimental_optimization.hoist_random_uniform = False
@@ -507,6 +510,7 @@ class OptimizeDatasetTest(test_base.DatasetTestBase, parameterized.TestCase):
 
     expected_optimizations_enabled = []
     expected_optimizations_disabled = [
+        "decode_and_resize_fusion",
         "filter_fusion",
         "filter_with_random_uniform_fusion",
         "hoist_random_uniform",
@@ -584,6 +588,26 @@ class OptimizeDatasetTest(test_base.DatasetTestBase, parameterized.TestCase):
       self.assertEqual(algorithm,
                        optimization_options._AutotuneAlgorithm.HILL_CLIMB)
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(autotune_minimize_memory=[True, False, None])))
+  def testAutotuneMinimizeMemorySettings(self, autotune_minimize_memory):
+    options = dataset_ops.Options()
+    if autotune_minimize_memory is not None:
+      options.experimental_optimization.autotune_minimize_memory = (
+          autotune_minimize_memory)
+
+    autotune_settings = options._autotune_settings()
+    algorithm = autotune_settings[1]
+
+    if autotune_minimize_memory is True:  # pylint: disable=g-bool-id-comparison
+      self.assertEqual(algorithm,
+                       optimization_options._AutotuneAlgorithm.MEMORY_AWARE)
+    else:
+      self.assertEqual(algorithm,
+                       optimization_options._AutotuneAlgorithm.HILL_CLIMB)
+
   @combinations.generate(
       combinations.times(
           test_base.default_test_combinations(),
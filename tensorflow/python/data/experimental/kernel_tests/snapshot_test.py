@@ -153,6 +153,51 @@ class SnapshotDatasetTest(reader_dataset_ops_test_base.TFRecordDatasetTestBase,
         snapshot.snapshot(self._snapshot_dir, compression="SNAPPY"))
     self.assertDatasetProduces(dataset2, expected)
 
+  @combinations.generate(
+      combinations.times(test_base.default_test_combinations(),
+                         combinations.combine(compression=["", "SNAPPY"])))
+  def testReadSnapshotDatasetBlockFileFormat(self, compression):
+    self.createTFRecords()
+    filenames = self._test_filenames
+    expected = [
+        (f * 100 + r, b"Record %d of file %d" % (r, f))  # pylint:disable=g-complex-comprehension
+        for f in range(0, 10)
+        for r in range(0, 100)
+    ]
+
+    def make_dataset(file_format_version):
+      dataset = core_readers._TFRecordDataset(filenames).enumerate()
+      return snapshot._SnapshotDataset(
+          dataset,
+          self._snapshot_dir,
+          shard_func=lambda index, _: index % 4,
+          compression=compression,
+          file_format_version=file_format_version)
+
+    dataset = make_dataset(file_format_version=3)
+    self.assertDatasetProducesSet(dataset, expected)
+    self.assertSnapshotDirectoryContains(
+        self._snapshot_dir,
+        num_fingerprints=1,
+        num_runs_per_fingerprint=1,
+        num_snapshot_shards_per_run=4)
+
+    # The snapshot is read with the version recorded in its metadata.
+    self.removeTFRecords()
+    dataset2 = make_dataset(file_format_version=None)
+    self.assertDatasetProducesSet(dataset2, expected)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testSnapshotDatasetInvalidFileFormatVersion(self):
+    dataset = dataset_ops.Dataset.range(10)
+    with self.assertRaises(errors.InvalidArgumentError):
+      dataset = snapshot._SnapshotDataset(
+          dataset,
+          self._snapshot_dir,
+          shard_func=lambda x: x,
+          file_format_version=4)
+      self.evaluate(self.getNext(dataset)())
+
   @combinations.generate(test_base.default_test_combinations())
   def testReadSnapshotDatasetCustomShardFn(self):
     self.createTFRecords()
@@ -30,6 +30,7 @@ class _AutotuneAlgorithm(enum.Enum):
   """Controls what algorithm is used in the autotune implementation."""
   HILL_CLIMB = 0
   GRADIENT_DESCENT = 1
+  MEMORY_AWARE = 2
 
 
 @tf_export("data.experimental.MapVectorizationOptions")
@@ -108,6 +109,19 @@ class OptimizationOptions(options.OptionsBase):
       "also autotune buffer sizes for datasets with parallelism. If None,"
       " defaults to False.")
 
+  autotune_minimize_memory = options.create_option(
+      name="autotune_minimize_memory",
+      ty=bool,
+      docstring=
+      "When autotuning is enabled (through `autotune`), determines whether to "
+      "tune parallelism and buffer sizes for the smallest amount of buffered "
+      "memory that still achieves the target throughput, shrinking buffers "
+      "that do not contribute to throughput. This only selects the autotuning "
+      "algorithm: buffer sizes are tuned only for transformations whose buffer "
+      "size is autotuned, so set `autotune_buffers` as well to have autotuning "
+      "inject and tune buffers after asynchronous transformations. If None, "
+      "defaults to False.")
+
   autotune_cpu_budget = options.create_option(
       name="autotune_cpu_budget",
       ty=int,
@@ -125,6 +139,15 @@ class OptimizationOptions(options.OptionsBase):
       "budget to use. Values greater than the available RAM in bytes may "
       "result in OOM. If None, defaults to half of the available RAM in bytes.")
 
+  decode_and_resize_fusion = options.create_option(
+      name="decode_and_resize_fusion",
+      ty=bool,
+      docstring=
+      "Whether to fuse JPEG decoding, bilinear resizing and scalar "
+      "normalization in map transformations into a single op that decodes at "
+      "a reduced scale when possible. The results are close to, but not "
+      "identical to, the unfused ones. If None, defaults to False.")
+
   filter_fusion = options.create_option(
       name="filter_fusion",
       ty=bool,
@@ -236,6 +259,8 @@ class OptimizationOptions(options.OptionsBase):
     # Set these options if they are explicitly set by the user.
     if self.autotune is False:  # pylint: disable=g-bool-id-comparison
       autotune = False
+    if self.autotune_minimize_memory:
+      algorithm = _AutotuneAlgorithm.MEMORY_AWARE
     if self.autotune_cpu_budget is not None:
       cpu_budget = self.autotune_cpu_budget
     if self.autotune_ram_budget is not None:
@@ -259,6 +284,7 @@ class OptimizationOptions(options.OptionsBase):
       result = MapVectorizationOptions()._graph_rewrites()  # pylint: disable=protected-access
 
     all_optimizations = [
+        "decode_and_resize_fusion",
         "filter_fusion",
         "filter_with_random_uniform_fusion",
         "hoist_random_uniform",
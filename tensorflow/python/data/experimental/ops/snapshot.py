@@ -204,7 +204,8 @@ class _SnapshotDataset(dataset_ops.UnaryUnchangedStructureDataset):
                compression=None,
                reader_func=None,
                pending_snapshot_expiry_seconds=None,
-               use_legacy_function=False):
+               use_legacy_function=False,
+               file_format_version=None):
 
     if reader_func is None:
       reader_func = lambda datasets: datasets.interleave(  # pylint:disable=g-long-lambda
@@ -242,6 +243,7 @@ class _SnapshotDataset(dataset_ops.UnaryUnchangedStructureDataset):
         self._reader_func.function.captured_inputs,
         self._shard_func.function.captured_inputs,
         compression=compression,
+        file_format_version=file_format_version,
         reader_func=self._reader_func.function,
         shard_func=self._shard_func.function,
         **self._flat_structure)
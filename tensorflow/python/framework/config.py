@@ -223,6 +223,9 @@ def set_optimizer_experimental_options(options):
         GPUs and above. Without the use of loss scaling, this can cause
         numerical underflow (see
         `keras.mixed_precision.experimental.LossScaleOptimizer`).
+      - cpu_blocked_layout: Convert chains of CPU convolutions, poolings and
+        element-wise ops to a channel-blocked layout, converting the layout
+        only at the boundaries of the chains.
       - disable_meta_optimizer: Disable the entire meta optimizer.
       - min_graph_nodes: The minimum number of nodes in a graph to optimizer.
         For smaller graphs, optimization is skipped.
@@ -2162,6 +2162,56 @@ def _GatherGrad(op, grad):
   return (ops.IndexedSlices(values, indices, params_shape), None)
 
 
+@ops.RegisterGradient("FusedEmbeddingLookupSparse")
+def _FusedEmbeddingLookupSparseGrad(op, grad):
+  """Gradient for fused embedding lookup op."""
+  handle = op.inputs[0]
+  ids, weights, segment_ids = op.inputs[1:]
+  unique_ids, values = (
+      gen_resource_variable_ops.fused_embedding_lookup_sparse_grad(
+          grad, ids, weights, segment_ids, combiner=op.get_attr("combiner")))
+  params_shape = variable_shape(handle)
+  params_grad = ops.IndexedSlices(values, unique_ids, params_shape)
+  if weights.shape.num_elements() == 0:
+    return (params_grad, None, None, None)
+  # Empty weights mean a weight of 1 for every id; pad them so the same
+  # formulas apply, and slice the result back to the shape of `weights`.
+  num_ids = array_ops.size(ids)
+  num_weights = array_ops.size(weights)
+  w = array_ops.concat(
+      [weights, array_ops.ones([num_ids - num_weights], dtype=weights.dtype)],
+      0)
+  # Flatten the per-id rows of the parameters, the incoming gradient and the
+  # forward output to [num_ids, row_size].
+  rows = array_ops.reshape(
+      gen_resource_variable_ops.resource_gather(handle, ids, dtype=grad.dtype),
+      [num_ids, -1])
+  grad_rows = array_ops.reshape(
+      array_ops.gather(grad, segment_ids), [num_ids, -1])
+  combiner = compat.as_str(op.get_attr("combiner"))
+  if combiner == "sum":
+    weights_grad = math_ops.reduce_sum(grad_rows * rows, 1)
+  else:
+    out_rows = array_ops.reshape(
+        array_ops.gather(op.outputs[0], segment_ids), [num_ids, -1])
+    if combiner == "mean":
+      # out = sum(w * row) / sum(w)
+      scale = array_ops.gather(
+          math_ops.reciprocal(math_ops.segment_sum(w, segment_ids)),
+          segment_ids)
+      weights_grad = scale * math_ops.reduce_sum(
+          grad_rows * (rows - out_rows), 1)
+    else:
+      # out = sum(w * row) / sqrt(sum(w * w))
+      scale = array_ops.gather(
+          math_ops.rsqrt(math_ops.segment_sum(w * w, segment_ids)),
+          segment_ids)
+      weights_grad = scale * math_ops.reduce_sum(
+          grad_rows * (rows - array_ops.expand_dims(w * scale, 1) * out_rows),
+          1)
+  return (params_grad, None, weights_grad[:num_weights], None)
+
+
 def _to_proto_fn(v, export_scope=None):
   """Converts Variable and ResourceVariable to VariableDef for collections."""
   return v.to_proto(export_scope=export_scope)